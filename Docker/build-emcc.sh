@@ -20,6 +20,19 @@ BUILD_UNFINISHED=${BUILD_UNFINISHED:-}
 # GENERATE_SOURCE_MAPS: set to "ON" to generate source maps
 # (will disable several optimizations)
 GENERATE_SOURCE_MAPS=${GENERATE_SOURCE_MAPS:-}
+# BUILD_SIMD: set to "OFF" to skip the SIMD128 + LTO <puzzle>.simd.wasm flavour
+BUILD_SIMD=${BUILD_SIMD:-ON}
+# BUILD_THREADS: set to "ON" to also build the pthreads <puzzle>.threads.wasm
+# flavour (used only when the web app is built with VITE_WASM_THREADS)
+BUILD_THREADS=${BUILD_THREADS:-OFF}
+# BUILD_SHARED_CORE: set to "ON" to also build puzzles-core.wasm plus a
+# <puzzle>.side.wasm per puzzle (used only with VITE_WASM_SHARED_CORE)
+BUILD_SHARED_CORE=${BUILD_SHARED_CORE:-OFF}
+# BUILD_TRACING: set to "ON" to compile in midend tracing (Frontend.getTraceEvents)
+BUILD_TRACING=${BUILD_TRACING:-OFF}
+# PUZZLE_PACKS: semicolon-separated list of puzzles to ship packs of pregenerated
+#   games for (default: WEBAPP_PUZZLE_PACKS in webapp.cmake; set empty for none)
+# PUZZLE_PACK_COUNT: number of games per preset in each pack
 # JOBS: number of parallel builds to run, default is number of processors
 JOBS=${JOBS:-$(nproc 2>/dev/null || echo 1)}
 
@@ -29,6 +42,9 @@ JOBS=${JOBS:-$(nproc 2>/dev/null || echo 1)}
 SRC_DIR=/app/puzzles
 # Generated build files:
 BUILD_DIR=/app/build
+BUILD_DIR_SIMD=/app/build-simd
+BUILD_DIR_THREADS=/app/build-threads
+BUILD_DIR_SHARED_CORE=/app/build-core
 # Deliverables output:
 DIST_DIR=/app/assets/puzzles
 DIST_DIR_MANUAL="${DIST_DIR}/manual"
@@ -46,21 +62,54 @@ VERSION="${VCSID}"
 VER="Version ${VERSION}"
 
 CMAKE_ARGS=(
-  -B "${BUILD_DIR}"
   -S "${SRC_DIR}"
   -DCMAKE_BUILD_TYPE="${BUILDTYPE}"
   -DWEB_APP=true
   -DCMAKE_C_FLAGS="-DVER='\"${VER}\"' -DVERSIONINFO_BINARY_VERSION='${BINARY_VERSION}'"
   -DPUZZLES_ENABLE_UNFINISHED="${BUILD_UNFINISHED}"
   -DVCSID="${VCSID}"
+  -DWASM_TRACING="${BUILD_TRACING}"
 )
+if [ -n "${PUZZLE_PACKS+set}" ]; then
+  CMAKE_ARGS+=(-DWEBAPP_PUZZLE_PACKS="${PUZZLE_PACKS}")
+fi
+if [ -n "${PUZZLE_PACK_COUNT:-}" ]; then
+  CMAKE_ARGS+=(-DWEBAPP_PUZZLE_PACK_COUNT="${PUZZLE_PACK_COUNT}")
+fi
 
-emcmake cmake "${CMAKE_ARGS[@]}"
+emcmake cmake -B "${BUILD_DIR}" "${CMAKE_ARGS[@]}"
 (
   cd "${BUILD_DIR}"
   make -j"${JOBS}" VERBOSE="${VERBOSE:-}"
 )
 
+if [ "${BUILD_SIMD}" = "ON" ]; then
+  echo "[INFO] Building SIMD wasm puzzles..."
+  emcmake cmake -B "${BUILD_DIR_SIMD}" "${CMAKE_ARGS[@]}" -DWASM_SIMD=ON
+  (
+    cd "${BUILD_DIR_SIMD}"
+    make -j"${JOBS}" VERBOSE="${VERBOSE:-}"
+  )
+fi
+
+if [ "${BUILD_THREADS}" = "ON" ]; then
+  echo "[INFO] Building threads wasm puzzles..."
+  emcmake cmake -B "${BUILD_DIR_THREADS}" "${CMAKE_ARGS[@]}" -DWASM_THREADS=ON
+  (
+    cd "${BUILD_DIR_THREADS}"
+    make -j"${JOBS}" VERBOSE="${VERBOSE:-}"
+  )
+fi
+
+if [ "${BUILD_SHARED_CORE}" = "ON" ]; then
+  echo "[INFO] Building shared core and side module wasm puzzles..."
+  emcmake cmake -B "${BUILD_DIR_SHARED_CORE}" "${CMAKE_ARGS[@]}" -DWASM_SHARED_CORE=ON
+  (
+    cd "${BUILD_DIR_SHARED_CORE}"
+    make -j"${JOBS}" VERBOSE="${VERBOSE:-}"
+  )
+fi
+
 
 # --- Deliverables ---
 echo "[INFO] Delivering..."
@@ -97,9 +146,50 @@ if [[ -d "${BUILD_DIR}/unreleased" ]]; then
   cp "${BUILD_DIR}"/unreleased/*.{wasm,map} "${DIST_DIR}/" \
     || echo "[WARN] No unreleased .wasm files found."
 fi
+# The SIMD flavour uses the same emcc runtime, so only its wasm is needed.
+if [ "${BUILD_SIMD}" = "ON" ]; then
+  for dir in "${BUILD_DIR_SIMD}" "${BUILD_DIR_SIMD}/unfinished" "${BUILD_DIR_SIMD}/unreleased"; do
+    if [[ -d "${dir}" ]]; then
+      cp "${dir}"/*.simd.wasm "${dir}"/*.simd.wasm.map "${DIST_DIR}/" \
+        || echo "[WARN] No .simd.wasm files found in ${dir}."
+    fi
+  done
+fi
+# The threads flavour has its own runtime, which also starts the pthread
+# Workers from its own (renamed) script.
+if [ "${BUILD_THREADS}" = "ON" ]; then
+  sed -e 's/nullgame\.threads\.js/emcc-runtime-threads.js/g' \
+    "${BUILD_DIR_THREADS}"/nullgame.threads.js > "${DIST_DIR}/emcc-runtime-threads.js" \
+    || echo "[WARN] nullgame.threads.js not found in ${BUILD_DIR_THREADS}."
+  for dir in "${BUILD_DIR_THREADS}" "${BUILD_DIR_THREADS}/unfinished" "${BUILD_DIR_THREADS}/unreleased"; do
+    if [[ -d "${dir}" ]]; then
+      cp "${dir}"/*.threads.wasm "${dir}"/*.threads.wasm.map "${DIST_DIR}/" \
+        || echo "[WARN] No .threads.wasm files found in ${dir}."
+    fi
+  done
+fi
+# The shared core has its own runtime (it's a dynamic linking main module).
+if [ "${BUILD_SHARED_CORE}" = "ON" ]; then
+  cp "${BUILD_DIR_SHARED_CORE}"/puzzles-core.js "${DIST_DIR}/emcc-runtime-core.js" \
+    || echo "[WARN] puzzles-core.js not found in ${BUILD_DIR_SHARED_CORE}."
+  cp "${BUILD_DIR_SHARED_CORE}"/puzzles-core.wasm "${DIST_DIR}/" \
+    || echo "[WARN] puzzles-core.wasm not found in ${BUILD_DIR_SHARED_CORE}."
+  for dir in "${BUILD_DIR_SHARED_CORE}" "${BUILD_DIR_SHARED_CORE}/unfinished" "${BUILD_DIR_SHARED_CORE}/unreleased"; do
+    if [[ -d "${dir}" ]]; then
+      cp "${dir}"/*.side.wasm "${DIST_DIR}/" \
+        || echo "[WARN] No .side.wasm files found in ${dir}."
+    fi
+  done
+fi
 shopt -u nullglob
 
 cp "${BUILD_DIR}/catalog.json" "${DIST_DIR}/" || echo "[WARN] No catalog.json found."
+cp "${BUILD_DIR}/puzzle-metadata.json" "${DIST_DIR}/" \
+  || echo "[WARN] No puzzle-metadata.json found."
+if [[ -d "${BUILD_DIR}/packs" ]]; then
+  mkdir -p "${DIST_DIR}/packs"
+  cp "${BUILD_DIR}"/packs/*.pack "${DIST_DIR}/packs/"
+fi
 if [[ -f "${BUILD_DIR}/source-file-list.txt" ]]; then
   cp "${BUILD_DIR}/source-file-list.txt" "${DIST_DIR}/"
 fi
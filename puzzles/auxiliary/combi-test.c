@@ -21,5 +21,28 @@ int main(int argc, char *argv[])
         }
         printf("\n");
     }
+
+    /* The bitmask version should find the same number of sets of r. */
+    if (r >= 1 && n <= COMBI_MASK_BITS) {
+        combi_mask set;
+        int count = 0;
+
+        for (set = first_combi_mask(r); set; set = next_combi_mask(set, n)) {
+            int bits = 0;
+            for (i = 0; i < n; i++)
+                if (set & ((combi_mask)1 << i))
+                    bits++;
+            if (bits != r) {
+                printf("mask %#llx has %d elements\n", set, bits);
+                exit(1);
+            }
+            count++;
+        }
+        if (count != c->total) {
+            printf("%d masks, expected %d\n", count, c->total);
+            exit(1);
+        }
+        printf("%d masks.\n", count);
+    }
     free_combi(c);
 }
@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <string.h>
+#include <time.h>
 
 #include "puzzles.h"
 
@@ -209,6 +210,169 @@ static void test_findloop(struct graph *graph)
     findloop_free_state(fls);
 }
 
+/*
+ * Check findloop_rerun against a from-scratch findloop_run, by
+ * toggling a few random edges of the graph at a time.
+ */
+static void test_findloop_rerun(struct graph *graph, random_state *rs)
+{
+    struct neighbour_ctx ctx;
+    struct findloopstate *fls, *fls_ref;
+    int n = graph->nvertices;
+    int *changed = snewn(6, int);
+    int step, k, u, v;
+
+    fls = findloop_new_state(n);
+    fls_ref = findloop_new_state(n);
+    ctx.graph = graph;
+    findloop_run(fls, n, neighbour_fn, (void*)&ctx);
+
+    for (step = 0; step < 10; step++) {
+        int nchanged = 0, ntoggles = 1 + random_upto(rs, 3);
+        bool ret, ret_ref;
+
+        for (k = 0; k < ntoggles; k++) {
+            u = random_upto(rs, n);
+            v = random_upto(rs, n);
+            if (u == v)
+                continue;
+            graph->adj[u * n + v] = graph->adj[v * n + u] =
+                !graph->adj[u * n + v];
+            changed[nchanged++] = u;
+            changed[nchanged++] = v;
+        }
+
+        ret = findloop_rerun(fls, n, changed, nchanged,
+                             neighbour_fn, (void*)&ctx);
+        ret_ref = findloop_run(fls_ref, n, neighbour_fn, (void*)&ctx);
+        if (ret != ret_ref) {
+            printf("\nfindloop_rerun returned %s, findloop_run %s\n",
+                   ret ? "true" : "false", ret_ref ? "true" : "false");
+            exit(1);
+        }
+
+        for (u = 0; u < n; u++) {
+            for (v = u + 1; v < n; v++) {
+                int uv, vv, uv_ref, vv_ref;
+                bool br, br_ref;
+
+                if (!graph->adj[u * n + v])
+                    continue;
+                br = findloop_is_bridge(fls, u, v, &uv, &vv);
+                br_ref = findloop_is_bridge(fls_ref, u, v, &uv_ref, &vv_ref);
+                if (br != br_ref || (br && (uv != uv_ref || vv != vv_ref)) ||
+                    findloop_is_loop_edge(fls, u, v) !=
+                    findloop_is_loop_edge(fls_ref, u, v)) {
+                    printf("\nfindloop_rerun disagrees with findloop_run "
+                           "about edge (%d, %d)\n", u, v);
+                    exit(1);
+                }
+            }
+        }
+    }
+
+    sfree(changed);
+    findloop_free_state(fls);
+    findloop_free_state(fls_ref);
+}
+
+/*
+ * Benchmark: a w x w square grid graph with each edge present with a
+ * given probability, which is roughly what Slant, Net and friends
+ * present to findloop. (Adjacency matrices would be too big here.)
+ */
+struct gridgraph {
+    int w;
+    bool *right, *down;
+};
+
+struct grid_neighbour_ctx {
+    struct gridgraph *gg;
+    int n, i, neighbours[4];
+};
+
+static int grid_neighbour_fn(int vertex, void *vctx)
+{
+    struct grid_neighbour_ctx *ctx = (struct grid_neighbour_ctx *)vctx;
+
+    if (vertex >= 0) {
+        struct gridgraph *gg = ctx->gg;
+        int w = gg->w, x = vertex % w, y = vertex / w;
+        ctx->n = ctx->i = 0;
+        if (x+1 < w && gg->right[vertex])
+            ctx->neighbours[ctx->n++] = vertex + 1;
+        if (x > 0 && gg->right[vertex - 1])
+            ctx->neighbours[ctx->n++] = vertex - 1;
+        if (y+1 < w && gg->down[vertex])
+            ctx->neighbours[ctx->n++] = vertex + w;
+        if (y > 0 && gg->down[vertex - w])
+            ctx->neighbours[ctx->n++] = vertex - w;
+    }
+
+    if (ctx->i < ctx->n)
+        return ctx->neighbours[ctx->i++];
+    return -1;
+}
+
+static void benchmark(random_state *rs)
+{
+    static const int sizes[] = { 8, 16, 32, 64, 128, 256 };
+    static const int densities[] = { 30, 50, 70 }; /* percent */
+    size_t si, di;
+
+    printf("Benchmarking findloop_run against findloop_rerun after "
+           "toggling one edge\n");
+    printf("%8s %8s %14s %14s\n", "vertices", "density",
+           "run (us)", "rerun (us)");
+
+    for (si = 0; si < lenof(sizes); si++) {
+        for (di = 0; di < lenof(densities); di++) {
+            struct gridgraph gg;
+            struct grid_neighbour_ctx ctx;
+            struct findloopstate *fls;
+            int w = sizes[si], n = w * w, i, iters = 2000000 / n;
+            int changed[2];
+            clock_t start;
+            double t_run, t_rerun;
+
+            gg.w = w;
+            gg.right = snewn(n, bool);
+            gg.down = snewn(n, bool);
+            for (i = 0; i < n; i++) {
+                gg.right[i] = random_upto(rs, 100) < densities[di];
+                gg.down[i] = random_upto(rs, 100) < densities[di];
+            }
+            ctx.gg = &gg;
+            fls = findloop_new_state(n);
+
+            start = clock();
+            for (i = 0; i < iters; i++) {
+                int e = random_upto(rs, n);
+                gg.right[e] = !gg.right[e];
+                findloop_run(fls, n, grid_neighbour_fn, &ctx);
+            }
+            t_run = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+            start = clock();
+            for (i = 0; i < iters; i++) {
+                int e = random_upto(rs, n);
+                gg.right[e] = !gg.right[e];
+                changed[0] = e;
+                changed[1] = (e % w + 1 < w) ? e + 1 : e;
+                findloop_rerun(fls, n, changed, 2, grid_neighbour_fn, &ctx);
+            }
+            t_rerun = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+            printf("%8d %7d%% %14.2f %14.2f\n", n, densities[di],
+                   t_run * 1e6 / iters, t_rerun * 1e6 / iters);
+
+            findloop_free_state(fls);
+            sfree(gg.right);
+            sfree(gg.down);
+        }
+    }
+}
+
 static void error_exit(const char *fmt, ...)
 {
     va_list ap;
@@ -222,10 +386,13 @@ static void error_exit(const char *fmt, ...)
 
 static void usage(void)
 {
-    printf("Usage: %s [--help] [--seed seed] [--iterations iterations]",
+    printf("Usage: %s [--help] [--seed seed] [--iterations iterations]"
+           " [--benchmark]",
            progname);
     printf("   verifies the findloop algorithm works as expected, "
            "by comparing to a simple implementation");
+    printf("   --benchmark: instead, time findloop_rerun against "
+           "findloop_run");
 }
 
 static const char *const testgraphs[] = {
@@ -241,6 +408,7 @@ int main(int argc, char **argv)
 {
     const char *random_seed = "12345";
     int iterations = 10000;
+    bool do_benchmark = false;
     size_t i;
     random_state *rs;
 
@@ -258,11 +426,20 @@ int main(int argc, char **argv)
 	    if (--argc == 0)
 		error_exit("--iterations needs an argument");
 	    iterations = atoi(*++argv);
+	} else if (!strcmp(arg, "--benchmark")) {
+	    do_benchmark = true;
 	} else {
 	    error_exit("unrecognized argument");
 	}
     }
 
+    if (do_benchmark) {
+        rs = random_new(random_seed, strlen(random_seed));
+        benchmark(rs);
+        random_free(rs);
+        return 0;
+    }
+
     printf("Testing %d fixed test cases\n", (int)lenof(testgraphs));
 
     for (i = 0; i < lenof(testgraphs); i++) {
@@ -278,6 +455,7 @@ int main(int argc, char **argv)
     while (iterations --> 0) {
         struct graph *graph = graph_random(rs, 2, 100);
         test_findloop(graph);
+        test_findloop_rerun(graph, rs);
         graph_free(graph);
     }
     random_free(rs);
@@ -0,0 +1,330 @@
+/*
+ * gridbench.c: scaling benchmark for the aperiodic grids (Penrose,
+ * hats and spectres), which get much slower to build as they get
+ * bigger. Where hat-test, spectre-test and penrose-test check that
+ * the tilings are right, this times grid_new on a sweep of sizes,
+ * split into the stages it reports through grid_set_phase_hook:
+ *
+ *   tiling      the tiling generator walking its coordinate system
+ *   dots        adding each tile as a face, de-duplicating its
+ *               corners against the dots so far (a hashset lookup)
+ *   trim        grid_trim_vigorously
+ *   consistent  grid_make_consistent
+ *   index       grid_make_index
+ *
+ * Usage: gridbench [--seed SEED] [--count N] [--sizes W,W,...]
+ *                  [TILING ...]
+ *
+ * TILING is one of penrose-p2, penrose-p3, hats or spectres (default
+ * all four). Each is built as a square of each size in --sizes, in
+ * the units Loopy's width and height are given in (default
+ * 5,10,20,40), N times (default 5) from grid descriptions generated
+ * from random seeds derived from SEED, the size and the index, so two
+ * builds given the same arguments build exactly the same grids.
+ *
+ * Output is JSON, on standard output:
+ *
+ *   { "seed": ..., "count": N, "unit": "us", "results": [
+ *     { "tiling": "hats", "size": 10, "faces": ..., "dots": ...,
+ *       "total": TIMES,
+ *       "phases": { "tiling": TIMES, "dots": TIMES, ... } }, ... ] }
+ *
+ * where TIMES gives the mean, min and max over the N grids of the
+ * time spent (wall-clock, in microseconds), and faces and dots count
+ * those of the finished grid (averaged likewise). Time spent in
+ * grid_new before its first phase marker (validating and decoding
+ * the description) is reported as phase "other". In a build with
+ * MEMORY_STATS, each TIMES also has "allocs", the mean number of
+ * allocations made, and each result has "peak", the mean of the most
+ * memory allocated at once, in bytes.
+ */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L /* for clock_gettime */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "puzzles.h"
+#include "grid.h"
+
+#define MAX_PHASES 8
+
+static const struct {
+    const char *name;
+    grid_type type;
+} tilings[] = {
+    {"penrose-p2", GRID_PENROSE_P2},
+    {"penrose-p3", GRID_PENROSE_P3},
+    {"hats", GRID_HATS},
+    {"spectres", GRID_SPECTRES},
+};
+#define NTILINGS lenof(tilings)
+
+struct phase {
+    const char *name;
+    double total, min, max;            /* seconds, over all grids */
+    double this_grid;                  /* seconds, in the current grid */
+    unsigned long allocs;
+};
+
+struct gridbench_job {
+    struct phase total;
+    struct phase phases[MAX_PHASES];   /* phases[0] is "other" */
+    int nphases;
+
+    /* State of the grid in progress */
+    int current;                       /* index into phases */
+    double last;
+    unsigned long last_allocs;
+};
+
+/*
+ * The phase hook is called twice per tile, so this needs a clock
+ * that's cheap to read: clock() is a system call on some platforms.
+ */
+static double now(void)
+{
+#ifdef CLOCK_MONOTONIC
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+static unsigned long allocs_now(void)
+{
+    memory_stats stats;
+    memory_stats_get(&stats);
+    return stats.allocs;
+}
+
+/* Charge everything since the last phase change to the current phase. */
+static void gridbench_charge(struct gridbench_job *job)
+{
+    double t = now();
+    unsigned long allocs = allocs_now();
+
+    job->phases[job->current].this_grid += t - job->last;
+    job->phases[job->current].allocs += allocs - job->last_allocs;
+    job->last = t;
+    job->last_allocs = allocs;
+}
+
+static void phase_init(struct phase *p, const char *name)
+{
+    p->name = name;
+    p->total = p->max = 0.0;
+    p->min = -1.0;
+    p->this_grid = 0.0;
+    p->allocs = 0;
+}
+
+/* Adds the current grid's time to a phase's statistics. */
+static void phase_finish_grid(struct phase *p)
+{
+    p->total += p->this_grid;
+    if (p->min < 0 || p->this_grid < p->min)
+        p->min = p->this_grid;
+    if (p->this_grid > p->max)
+        p->max = p->this_grid;
+    p->this_grid = 0.0;
+}
+
+static void gridbench_phase(void *ctx, const char *name)
+{
+    struct gridbench_job *job = (struct gridbench_job *)ctx;
+    int i;
+
+    gridbench_charge(job);
+
+    for (i = 0; i < job->nphases; i++)
+        if (!strcmp(job->phases[i].name, name))
+            break;
+    if (i == job->nphases) {
+        if (job->nphases == MAX_PHASES)
+            fatal("gridbench: too many grid phases");
+        phase_init(&job->phases[i], name);
+        job->nphases++;
+    }
+    job->current = i;
+}
+
+static void print_json_string(const char *s)
+{
+    putchar('"');
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\')
+            putchar('\\');
+        putchar(*s);
+    }
+    putchar('"');
+}
+
+/* Prints TIMES for a phase of count grids. */
+static void print_times(const struct phase *p, int count)
+{
+    printf("{\"mean\": %.1f, \"min\": %.1f, \"max\": %.1f",
+           p->total / count * 1e6, (p->min < 0 ? 0.0 : p->min) * 1e6,
+           p->max * 1e6);
+    if (memory_stats_enabled())
+        printf(", \"allocs\": %.0f", (double)p->allocs / count);
+    printf("}");
+}
+
+static bool first_result = true;
+
+static void gridbench_size(int t, int size, const char *seed, int count)
+{
+    struct gridbench_job job[1];
+    double faces = 0.0, dots = 0.0, peak = 0.0;
+    char *seedstr = snewn(strlen(seed) + 80, char);
+    const char *err;
+    int i, ph;
+
+    err = grid_validate_params(tilings[t].type, size, size);
+    if (err) {
+        fprintf(stderr, "gridbench: %s at size %d: %s\n",
+                tilings[t].name, size, err);
+        exit(1);
+    }
+
+    phase_init(&job->total, "total");
+    phase_init(&job->phases[0], "other");
+    job->nphases = 1;
+
+    for (i = 0; i < count; i++) {
+        random_state *rs;
+        char *desc;
+        grid *g;
+        memory_stats before, after;
+
+        sprintf(seedstr, "%s-%s-%d-%d", seed, tilings[t].name, size, i);
+        rs = random_new(seedstr, strlen(seedstr));
+        desc = grid_new_desc(tilings[t].type, size, size, rs);
+        random_free(rs);
+
+        job->current = 0;
+        memory_stats_reset();
+        memory_stats_get(&before);
+        grid_set_phase_hook(gridbench_phase, job);
+        job->last = now();
+        job->last_allocs = before.allocs;
+        g = grid_new(tilings[t].type, size, size, desc);
+        gridbench_charge(job);
+        grid_set_phase_hook(NULL, NULL);
+        memory_stats_get(&after);
+
+        for (ph = 0; ph < job->nphases; ph++) {
+            job->total.this_grid += job->phases[ph].this_grid;
+            phase_finish_grid(&job->phases[ph]);
+        }
+        job->total.allocs += after.allocs - before.allocs;
+        phase_finish_grid(&job->total);
+
+        faces += g->num_faces;
+        dots += g->num_dots;
+        peak += (double)(after.peak - before.live);
+        grid_free(g);
+        sfree(desc);
+    }
+    sfree(seedstr);
+
+    printf("%s\n    {\"tiling\": ", first_result ? "" : ",");
+    first_result = false;
+    print_json_string(tilings[t].name);
+    printf(", \"size\": %d, \"faces\": %.0f, \"dots\": %.0f,\n"
+           "     \"total\": ", size, faces / count, dots / count);
+    print_times(&job->total, count);
+    printf(",\n     \"phases\": {");
+    for (ph = 0; ph < job->nphases; ph++) {
+        printf("%s\n       ", ph ? "," : "");
+        print_json_string(job->phases[ph].name);
+        printf(": ");
+        print_times(&job->phases[ph], count);
+    }
+    printf("}");
+    if (memory_stats_enabled())
+        printf(",\n     \"peak\": %.0f", peak / count);
+    printf("}");
+    fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    const char *seed = "gridbench";
+    const char *sizestr = "5,10,20,40";
+    int count = 5;
+    bool doing_opts = true, chosen[NTILINGS], any_chosen = false;
+    int *sizes, nsizes;
+    const char *p;
+    int i, t;
+
+    for (t = 0; t < NTILINGS; t++)
+        chosen[t] = false;
+
+    for (i = 1; i < argc; i++) {
+        p = argv[i];
+
+        if (doing_opts && !strcmp(p, "--seed") && i+1 < argc) {
+            seed = argv[++i];
+        } else if (doing_opts && !strcmp(p, "--count") && i+1 < argc) {
+            count = atoi(argv[++i]);
+        } else if (doing_opts && !strcmp(p, "--sizes") && i+1 < argc) {
+            sizestr = argv[++i];
+        } else if (doing_opts && !strcmp(p, "--")) {
+            doing_opts = false;
+        } else if (doing_opts && p[0] == '-') {
+            fprintf(stderr, "gridbench: unrecognised option '%s'\n", p);
+            fprintf(stderr, "usage: gridbench [--seed SEED] [--count N] "
+                    "[--sizes W,W,...] [TILING ...]\n");
+            return 1;
+        } else {
+            for (t = 0; t < NTILINGS; t++)
+                if (!strcmp(p, tilings[t].name))
+                    break;
+            if (t == NTILINGS) {
+                fprintf(stderr, "gridbench: unknown tiling '%s' (expected "
+                        "penrose-p2, penrose-p3, hats or spectres)\n", p);
+                return 1;
+            }
+            chosen[t] = any_chosen = true;
+        }
+    }
+    if (count < 1) {
+        fprintf(stderr, "gridbench: --count must be at least 1\n");
+        return 1;
+    }
+
+    sizes = snewn(strlen(sizestr) + 1, int);
+    nsizes = 0;
+    for (p = sizestr; *p; p += strspn(p, ",")) {
+        sizes[nsizes] = atoi(p);
+        if (sizes[nsizes] < 1) {
+            fprintf(stderr, "gridbench: bad size in '%s'\n", sizestr);
+            return 1;
+        }
+        nsizes++;
+        p += strcspn(p, ",");
+    }
+
+    /* Every grid is built from scratch, not fetched from the cache. */
+    grid_cache_disable();
+
+    printf("{\"seed\": ");
+    print_json_string(seed);
+    printf(", \"count\": %d, \"unit\": \"us\", \"results\": [", count);
+    for (t = 0; t < NTILINGS; t++)
+        if (chosen[t] || !any_chosen)
+            for (i = 0; i < nsizes; i++)
+                gridbench_size(t, sizes[i], seed, count);
+    printf("\n]}\n");
+
+    sfree(sizes);
+    return 0;
+}
@@ -0,0 +1,220 @@
+/*
+ * Test code for hashset.c. This keeps a record of which of a fixed
+ * universe of keys ought to be in the set, and checks every
+ * operation's result against it, and the set's whole contents (by
+ * iteration) every so often.
+ *
+ * Each run is repeated with a hash function which throws most of the
+ * key away, so that long runs of colliding elements, and deletions
+ * from the middle of them, get plenty of exercise.
+ *
+ * With --bench, it compares the time taken to build a set of N
+ * elements and look them all up against tree234.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "puzzles.h"
+#include "tree234.h"
+
+#define NKEYS 5000
+
+static int badhash;
+
+static unsigned long testhash(const void *av)
+{
+    int a = *(const int *)av;
+    if (badhash)
+        a /= 64;
+    return hash_ints(&a, 1);
+}
+
+static bool testeq(const void *av, const void *bv)
+{
+    return *(const int *)av == *(const int *)bv;
+}
+
+static int testcmp(void *av, void *bv)
+{
+    int a = *(int *)av, b = *(int *)bv;
+    return a < b ? -1 : a > b ? +1 : 0;
+}
+
+static double seconds(clock_t start)
+{
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void benchmark(int n, int reps)
+{
+    int *keys = snewn(n, int), rep, i;
+    double thash = 0, ttree = 0;
+    clock_t start;
+
+    for (i = 0; i < n; i++)
+        keys[i] = (rand() % 32768) * 32768 + rand() % 32768;
+
+    for (rep = 0; rep < reps; rep++) {
+        hashset *hs;
+        tree234 *t;
+
+        start = clock();
+        hs = hashset_new(testhash, testeq);
+        for (i = 0; i < n; i++)
+            hashset_add(hs, &keys[i]);
+        for (i = 0; i < n; i++)
+            if (!hashset_find(hs, &keys[i]))
+                abort();
+        hashset_free(hs);
+        thash += seconds(start);
+
+        start = clock();
+        t = newtree234(testcmp);
+        for (i = 0; i < n; i++)
+            add234(t, &keys[i]);
+        for (i = 0; i < n; i++)
+            if (!find234(t, &keys[i], NULL))
+                abort();
+        freetree234(t);
+        ttree += seconds(start);
+    }
+
+    printf("%d elements, %d repetitions: hashset %.3fs, tree234 %.3fs\n",
+           n, reps, thash, ttree);
+    sfree(keys);
+}
+
+/* Returns an error message, or NULL if the set's contents are right. */
+static const char *checkcontents(hashset *hs, const int *keys,
+                                 const bool *present, int npresent)
+{
+    bool *seen = snewn(NKEYS, bool);
+    const char *fail = NULL;
+    size_t pos = 0;
+    int *elem, nseen = 0;
+
+    memset(seen, 0, NKEYS * sizeof(bool));
+    while ((elem = hashset_next(hs, &pos)) != NULL) {
+        int i = elem - keys;
+        if (i < 0 || i >= NKEYS || !present[i]) {
+            fail = "iteration found an element not in the set";
+            break;
+        }
+        if (seen[i]) {
+            fail = "iteration found an element twice";
+            break;
+        }
+        seen[i] = true;
+        nseen++;
+    }
+    if (!fail && nseen != npresent)
+        fail = "iteration missed elements";
+    if (!fail && (int)hashset_count(hs) != npresent)
+        fail = "wrong count";
+    sfree(seen);
+    return fail;
+}
+
+static bool run(int iteration)
+{
+    int *keys = snewn(NKEYS, int);
+    bool *present = snewn(NKEYS, bool);
+    hashset *hs = hashset_new(testhash, testeq);
+    int op, i, npresent = 0, range;
+    const char *fail = NULL;
+
+    for (i = 0; i < NKEYS; i++) {
+        keys[i] = i;
+        present[i] = false;
+    }
+
+    /*
+     * Work with a varying fraction of the keys, so that the set
+     * spends some runs mostly growing and others churning at a
+     * steady size.
+     */
+    range = 16 + (iteration * 97) % (NKEYS - 16);
+
+    for (op = 0; op < 20000 && !fail; op++) {
+        int key;
+        int *ret;
+
+        i = rand() % range;
+        key = i;                       /* a copy, to look up by value */
+        switch (rand() % 3) {
+          case 0:
+            ret = hashset_add(hs, &keys[i]);
+            if (ret != &keys[i])
+                fail = "add returned the wrong element";
+            if (!present[i])
+                npresent++;
+            present[i] = true;
+            break;
+          case 1:
+            ret = hashset_find(hs, &key);
+            if (ret != (present[i] ? &keys[i] : NULL))
+                fail = "find returned the wrong element";
+            break;
+          case 2:
+            ret = hashset_del(hs, &key);
+            if (ret != (present[i] ? &keys[i] : NULL))
+                fail = "del returned the wrong element";
+            if (present[i])
+                npresent--;
+            present[i] = false;
+            break;
+        }
+        if (!fail && (int)hashset_count(hs) != npresent)
+            fail = "wrong count";
+        if (!fail && op % 1000 == 999)
+            fail = checkcontents(hs, keys, present, npresent);
+    }
+    if (!fail) {
+        /* Everything still there must be findable. */
+        for (i = 0; i < NKEYS && !fail; i++) {
+            int key = i;
+            if (hashset_find(hs, &key) != (present[i] ? &keys[i] : NULL))
+                fail = "find returned the wrong element at the end";
+        }
+    }
+    if (!fail)
+        fail = checkcontents(hs, keys, present, npresent);
+
+    if (fail)
+        printf("Failed at iteration %d%s, op %d: %s\n", iteration,
+               badhash ? " (bad hash)" : "", op, fail);
+    hashset_free(hs);
+    sfree(keys);
+    sfree(present);
+    return !fail;
+}
+
+int main(int argc, char **argv)
+{
+    int iteration;
+    unsigned seed;
+
+    if (argc > 1 && !strcmp(argv[1], "--bench")) {
+        int n = (argc > 2 ? atoi(argv[2]) : 1000000);
+        int reps = (argc > 3 ? atoi(argv[3]) : 5);
+        srand(0);
+        benchmark(n, reps);
+        return 0;
+    }
+
+    seed = (argc > 1 ? strtoul(argv[1], NULL, 0) : time(NULL));
+    printf("Random seed = %u\n", seed);
+    srand(seed);
+
+    for (iteration = 0; iteration < 200; iteration++) {
+        badhash = iteration % 2;
+        if (!run(iteration))
+            return 1;
+    }
+
+    printf("OK\n");
+    return 0;
+}
@@ -157,6 +157,7 @@ static bool unit_tests(void)
     HatCoords *hc_in, *hc_out;
 
     ctx->rs = NULL;
+    ctx->nspare = 0;
     ctx->prototype = hat_coords_construct(TT_KITE, 0, TT_HAT, 0, TT_H, -1);
 
     /* Simple steps within a hat */
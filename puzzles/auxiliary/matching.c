@@ -41,12 +41,10 @@ static void deallocate(void)
     sfree(scratch);
 }
 
-static void find_and_check_matching(void)
+static void check_matching(void)
 {
     int i, j, k;
 
-    count = matching_with_scratch(scratch, nl, nr, adjlists, adjsizes,
-                                  rs, outl, outr);
     matching_witness(scratch, nl, nr, witness);
 
     for (i = j = 0; i < nl; i++) {
@@ -92,6 +90,13 @@ static void find_and_check_matching(void)
     }
 }
 
+static void find_and_check_matching(void)
+{
+    count = matching_with_scratch(scratch, nl, nr, adjlists, adjsizes,
+                                  rs, outl, outr);
+    check_matching();
+}
+
 struct nodename {
     const char *name;
     int index;
@@ -327,6 +332,69 @@ static void test_subsets(void)
     deallocate();
 }
 
+static void test_incremental(void)
+{
+    int n = 40;
+    int i, j, step, fresh;
+    int *adjptr, *freshl;
+    bool *edges;
+    void *freshscratch;
+    random_state *ers;
+    static const char seed[] = "fixed random seed for repeatability";
+
+    /*
+     * Start from a random sparse graph, then repeatedly add or
+     * remove one random edge and repair the matching with
+     * matching_resume. Every time, the result must be a valid
+     * maximum matching, i.e. pass the witness check and be the same
+     * size as one found from scratch.
+     */
+
+    ers = random_new(seed, strlen(seed));
+
+    allocate(n, n, n*n);
+    edges = snewn(n*n, bool);
+    for (i = 0; i < n*n; i++)
+        edges[i] = random_upto(ers, 20) == 0;
+    freshl = snewn(n, int);
+    freshscratch = smalloc(matching_scratch_size(n, n));
+
+    for (step = 0; step < 10000; step++) {
+        if (step > 0) {
+            i = random_upto(ers, n*n);
+            edges[i] = !edges[i];
+        }
+
+        adjptr = adjdata;
+        for (i = 0; i < n; i++) {
+            adjlists[i] = adjptr;
+            for (j = 0; j < n; j++)
+                if (edges[i*n+j])
+                    *adjptr++ = j;
+            adjsizes[i] = adjptr - adjlists[i];
+        }
+
+        if (step == 0)
+            count = matching_with_scratch(scratch, n, n, adjlists, adjsizes,
+                                          NULL, outl, outr);
+        else
+            count = matching_resume(scratch, n, n, adjlists, adjsizes,
+                                    NULL, outl, outr);
+        check_matching();
+
+        fresh = matching_with_scratch(freshscratch, n, n, adjlists,
+                                      adjsizes, NULL, freshl, NULL);
+        assert(count == fresh);
+    }
+
+    printf("incremental matching: %d steps OK\n", step);
+    sfree(edges);
+    sfree(freshl);
+    sfree(freshscratch);
+    random_free(ers);
+    deallocate();
+}
+
 int main(int argc, char **argv)
 {
     static const char stdin_identifier[] = "<standard input>";
@@ -391,6 +459,7 @@ int main(int argc, char **argv)
         }
 
         test_subsets();
+        test_incremental();
     }
 
     return 0;
@@ -0,0 +1,169 @@
+/*
+ * puzzlelib-test.c: check that libpuzzles gives the same answers from
+ * many threads at once as it does from one.
+ *
+ * Usage: puzzlelib-test [--threads N] [--count N] [GAME[:PARAMS] ...]
+ *
+ * For each GAME (default: all of them), N game IDs (default 20) are
+ * generated at PARAMS (default: the game's defaults), and validated,
+ * solved and graded, with every game's jobs running at once on the
+ * threads (default 8). (So any caches the games keep start off empty
+ * with all the threads using them.) Then the same IDs are generated
+ * again one at a time. Any ID which comes out differently, or fails
+ * to validate, is reported, as are solver and grading failures (other
+ * than "Solution not known for this puzzle"). The exit status is 0
+ * only if there were none.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "puzzlelib.h"
+
+struct job {
+    const char *name;
+    char *params, seed[40];
+    char *expected, *id;
+    const char *error;
+};
+
+struct ctx {
+    struct job *jobs;
+    int njobs, next;
+    pthread_mutex_t lock;
+};
+
+static void run_job(struct job *job)
+{
+    const char *err;
+    char *move;
+
+    job->id = puzzlelib_generate(job->name, job->params, job->seed, &err);
+    if (!job->id) {
+        job->error = err;
+        return;
+    }
+    job->error = puzzlelib_validate(job->name, job->id);
+    if (job->error)
+        return;
+    move = puzzlelib_solve(job->name, job->id, &err);
+    if (move)
+        puzzlelib_free(move);
+    else if (strcmp(err, "Solution not known for this puzzle") &&
+             strcmp(err, "This game has no solver"))
+        job->error = err;
+    if (job->error)
+        return;
+    move = puzzlelib_grade(job->name, job->id, &err);
+    if (move)
+        puzzlelib_free(move);
+    else if (strcmp(err, "This game has no graded solver"))
+        job->error = err;
+}
+
+static void *thread_main(void *vctx)
+{
+    struct ctx *ctx = (struct ctx *)vctx;
+
+    while (1) {
+        int i;
+
+        pthread_mutex_lock(&ctx->lock);
+        i = ctx->next++;
+        pthread_mutex_unlock(&ctx->lock);
+        if (i >= ctx->njobs)
+            return NULL;
+        run_job(&ctx->jobs[i]);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char **names;
+    int ngames, nnames = 0, nthreads = 8, count = 20, i, j, k, errors = 0;
+    struct ctx ctx[1];
+    pthread_t *threads;
+
+    for (ngames = 0; puzzlelib_game_name(ngames); ngames++);
+    names = malloc((argc + ngames) * sizeof(*names));
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--threads") && i+1 < argc) {
+            nthreads = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--count") && i+1 < argc) {
+            count = atoi(argv[++i]);
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "usage: puzzlelib-test [--threads N] "
+                    "[--count N] [GAME[:PARAMS] ...]\n");
+            return 1;
+        } else {
+            names[nnames++] = argv[i];
+        }
+    }
+    if (!nnames)
+        for (i = 0; i < ngames; i++)
+            names[nnames++] = puzzlelib_game_name(i);
+    if (nthreads < 1 || count < 1) {
+        fprintf(stderr, "puzzlelib-test: --threads and --count must be "
+                "at least 1\n");
+        return 1;
+    }
+
+    ctx->njobs = nnames * count;
+    ctx->jobs = malloc(ctx->njobs * sizeof(struct job));
+    for (i = k = 0; i < nnames; i++) {
+        char *name = strcpy(malloc(strlen(names[i]) + 1), names[i]);
+        char *params = strchr(name, ':');
+
+        if (params)
+            *params++ = '\0';
+        else
+            params = puzzlelib_default_params(name);
+        if (!params) {
+            fprintf(stderr, "puzzlelib-test: unknown game '%s'\n", name);
+            return 1;
+        }
+        for (j = 0; j < count; j++, k++) {
+            struct job *job = &ctx->jobs[k];
+
+            job->name = name;
+            job->params = params;
+            sprintf(job->seed, "puzzlelib-test-%d", j);
+        }
+    }
+
+    ctx->next = 0;
+    pthread_mutex_init(&ctx->lock, NULL);
+    threads = malloc(nthreads * sizeof(pthread_t));
+    for (i = 0; i < nthreads; i++)
+        if (pthread_create(&threads[i], NULL, thread_main, ctx)) {
+            fprintf(stderr, "puzzlelib-test: unable to create thread\n");
+            return 1;
+        }
+    for (i = 0; i < nthreads; i++)
+        pthread_join(threads[i], NULL);
+
+    for (k = 0; k < ctx->njobs; k++) {
+        struct job *job = &ctx->jobs[k];
+        const char *err;
+
+        if (job->error) {
+            printf("%s %s#%s: %s\n", job->name, job->params, job->seed,
+                   job->error);
+            errors++;
+            continue;
+        }
+        job->expected = puzzlelib_generate(job->name, job->params,
+                                           job->seed, &err);
+        if (strcmp(job->id, job->expected)) {
+            printf("%s %s#%s: generated %s on several threads but %s on "
+                   "one\n", job->name, job->params, job->seed,
+                   job->id, job->expected);
+            errors++;
+        }
+    }
+    printf("%d games, %d IDs, %d errors\n", nnames, ctx->njobs, errors);
+    return errors ? 1 : 0;
+}
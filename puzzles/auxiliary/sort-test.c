@@ -18,51 +18,184 @@ static int resetcmp(const void *av, const void *bv)
     return a < b ? -1 : a > b ? +1 : 0;
 }
 
+/*
+ * Ways of filling the key array, chosen to include the inputs that
+ * tend to upset quicksorts: already sorted, reversed, and lots of
+ * repeated values.
+ */
+enum { KEYS_RANDOM, KEYS_SORTED, KEYS_REVERSED, KEYS_FEW, KEYS_SAME,
+       KEYS_ORGAN, NKEYTYPES };
+
+static void makekeys(int *keys, int n, int type)
+{
+    int j;
+    for (j = 0; j < n; j++) {
+        switch (type) {
+          case KEYS_RANDOM: keys[j] = rand() - RAND_MAX/2; break;
+          case KEYS_SORTED: keys[j] = j; break;
+          case KEYS_REVERSED: keys[j] = n - j; break;
+          case KEYS_FEW: keys[j] = rand() % 4; break;
+          case KEYS_SAME: keys[j] = 17; break;
+          case KEYS_ORGAN: keys[j] = (j < n/2 ? j : n - j); break;
+        }
+    }
+}
+
+/*
+ * Check that data[] is a permutation of 0,...,n-1 sorted by keys[].
+ * If stable is set, also check that equal keys kept their order.
+ */
+static const char *checksort(const int *data, const int *keys, int n,
+                             bool stable)
+{
+    int *reset;
+    const char *fail = NULL;
+    int j;
+
+    for (j = 1; j < n; j++) {
+        if (keys[data[j]] < keys[data[j-1]])
+            fail = "output misordered";
+        else if (stable && keys[data[j]] == keys[data[j-1]] &&
+                 data[j] < data[j-1])
+            fail = "output not stable";
+    }
+    if (!fail) {
+        reset = snewn(n, int);
+        memcpy(reset, data, n * sizeof(*data));
+        qsort(reset, n, sizeof(*reset), resetcmp);
+        for (j = 0; j < n; j++)
+            if (reset[j] != j)
+                fail = "output not permuted";
+        sfree(reset);
+    }
+    return fail;
+}
+
+static void report(const char *what, int iteration, int n,
+                   const int *data, const int *keys, const char *fail)
+{
+    int j;
+    printf("Failed %s at iteration %d: %s\n", what, iteration, fail);
+    printf("Key values:\n");
+    for (j = 0; j < n; j++)
+        printf("  [%2d] %10d\n", j, keys[j]);
+    printf("Output sorted order:\n");
+    for (j = 0; j < n; j++)
+        printf("  [%2d] %10d\n", data[j], keys[data[j]]);
+}
+
+static double seconds(clock_t start)
+{
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+/*
+ * Benchmark mode: time each sorting routine against the C library's
+ * qsort on arrays of the given size, for each kind of input.
+ */
+static void benchmark(int n, int reps)
+{
+    static const char *const typenames[NKEYTYPES] = {
+        "random", "sorted", "reversed", "few", "same", "organ"
+    };
+    int *data = snewn(n, int), *keys = snewn(n, int), *ints = snewn(n, int);
+    int type, rep, j;
+
+    printf("%d elements, %d repetitions\n", n, reps);
+    printf("%-10s %10s %10s %10s %10s\n", "keys",
+           "arraysort", "qsort", "sort_ints", "by_key");
+    for (type = 0; type < NKEYTYPES; type++) {
+        double tarray = 0, tqsort = 0, tints = 0, tkey = 0;
+        clock_t start;
+
+        for (rep = 0; rep < reps; rep++) {
+            makekeys(keys, n, type);
+
+            for (j = 0; j < n; j++) data[j] = j;
+            start = clock();
+            arraysort(data, n, testcmp, keys);
+            tarray += seconds(start);
+
+            memcpy(ints, keys, n * sizeof(*ints));
+            start = clock();
+            qsort(ints, n, sizeof(*ints), compare_integers);
+            tqsort += seconds(start);
+
+            memcpy(ints, keys, n * sizeof(*ints));
+            start = clock();
+            sort_integers(ints, n);
+            tints += seconds(start);
+
+            for (j = 0; j < n; j++) data[j] = j;
+            start = clock();
+            sort_by_int_key(data, n, keys);
+            tkey += seconds(start);
+        }
+
+        printf("%-10s %9.3fs %9.3fs %9.3fs %9.3fs\n", typenames[type],
+               tarray, tqsort, tints, tkey);
+    }
+
+    sfree(data);
+    sfree(keys);
+    sfree(ints);
+}
+
 int main(int argc, char **argv)
 {
     typedef int Array[3723];
-    Array data, keys;
+    Array data, keys, ints;
     int iteration;
     unsigned seed;
 
+    if (argc > 1 && !strcmp(argv[1], "--bench")) {
+        int n = (argc > 2 ? atoi(argv[2]) : 1000000);
+        int reps = (argc > 3 ? atoi(argv[3]) : 5);
+        srand(0);
+        benchmark(n, reps);
+        return 0;
+    }
+
     seed = (argc > 1 ? strtoul(argv[1], NULL, 0) : time(NULL));
     printf("Random seed = %u\n", seed);
     srand(seed);
 
     for (iteration = 0; iteration < 10000; iteration++) {
-        int j;
+        int j, n;
         const char *fail = NULL;
 
-        for (j = 0; j < lenof(data); j++) {
-            data[j] = j;
-            keys[j] = rand();
-        }
-
-        arraysort(data, lenof(data), testcmp, keys);
+        /*
+         * Mostly use the full array, but also try small sizes, to
+         * exercise the paths that skip quicksort or radix sort.
+         */
+        n = (iteration % 4 ? (int)lenof(data) : iteration % 97);
+        makekeys(keys, n, iteration % NKEYTYPES);
 
-        for (j = 1; j < lenof(data); j++) {
-            if (keys[data[j]] < keys[data[j-1]])
-                fail = "output misordered";
-        }
-        if (!fail) {
-            Array reset;
-            memcpy(reset, data, sizeof(data));
-            qsort(reset, lenof(reset), sizeof(*reset), resetcmp);
-            for (j = 0; j < lenof(reset); j++)
-                if (reset[j] != j)
-                    fail = "output not permuted";
+        for (j = 0; j < n; j++)
+            data[j] = j;
+        arraysort(data, n, testcmp, keys);
+        if ((fail = checksort(data, keys, n, false)) != NULL) {
+            report("arraysort", iteration, n, data, keys, fail);
+            return 1;
         }
 
-        if (fail) {
-            printf("Failed at iteration %d: %s\n", iteration, fail);
-            printf("Key values:\n");
-            for (j = 0; j < lenof(keys); j++)
-                printf("  [%2d] %10d\n", j, keys[j]);
-            printf("Output sorted order:\n");
-            for (j = 0; j < lenof(data); j++)
-                printf("  [%2d] %10d\n", data[j], keys[data[j]]);
+        for (j = 0; j < n; j++)
+            data[j] = j;
+        sort_by_int_key(data, n, keys);
+        if ((fail = checksort(data, keys, n, true)) != NULL) {
+            report("sort_by_int_key", iteration, n, data, keys, fail);
             return 1;
         }
+
+        memcpy(ints, keys, n * sizeof(*ints));
+        sort_integers(ints, n);
+        for (j = 0; j < n; j++)
+            if (ints[j] != keys[data[j]]) {
+                printf("Failed sort_integers at iteration %d: "
+                       "element %d is %d, should be %d\n",
+                       iteration, j, ints[j], keys[data[j]]);
+                return 1;
+            }
     }
 
     printf("OK\n");
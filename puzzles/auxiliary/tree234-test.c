@@ -741,6 +741,50 @@ int main(void) {
     assert(tree3 == join234(tree3, tree));
     verifytree(tree3, array, 2);
     verifytree(tree, array, 0);
+    freetree234(tree);
+    freetree234(tree2);
+    freetree234(tree3);
+    freetree234(tree4);
+
+    /*
+     * Test bulk construction of a tree from a sorted array, at
+     * every size from empty up to the full set of strings.
+     */
+    tree = newtree234(mycmp);
+    for (i = 0; i < (int)NSTR; i++)
+	add234(tree, strings[i]);
+    arraylen = count234(tree);
+    for (i = 0; i < arraylen; i++)
+	array[i] = index234(tree, i);
+    freetree234(tree);
+    for (i = 0; i <= arraylen; i++) {
+	printf("building sorted tree of size %d\n", i);
+	tree = buildsorted234(mycmp, array, i);
+	verifytree(tree, array, i);
+	freetree234(tree);
+    }
+
+    /*
+     * Join halves of two different split trees, so that neither
+     * side owns its node pool outright, and check that both
+     * survivors are still sound.
+     */
+    for (i = 0; i <= arraylen; i++) {
+	tree234 *tree5;
+	tree = buildsorted234(mycmp, array, arraylen);
+	tree2 = splitpos234(tree, i, false);
+	tree3 = buildsorted234(mycmp, array, arraylen);
+	tree4 = splitpos234(tree3, i, true);
+	tree5 = join234(tree4, tree2);
+	assert(tree5 == tree4);
+	verifytree(tree4, array, arraylen);
+	freetree234(tree2);
+	freetree234(tree4);
+	verifytree(tree, array, i);
+	verifytree(tree3, array+i, arraylen-i);
+	freetree234(tree);
+	freetree234(tree3);
+    }
 
     return 0;
 }
@@ -0,0 +1,364 @@
+/*
+ * batchgen.c: multi-threaded batch puzzle generation, for the
+ * command-line --generate mode of the Unix front end.
+ *
+ * The serial --generate loop generates one game ID after another in a
+ * single midend. Here, the same set of game IDs is spread over a pool
+ * of threads, each of which owns its own midend (and hence its own
+ * random_state). All the midends share the one game vtable, which is
+ * harmless, since a game's functions keep their state in the
+ * structures they are passed rather than in globals. (The exceptions
+ * are grid.c's cache of recently built grids, which we turn off, and
+ * a few games' caches of tables, which take the cache lock.)
+ *
+ * Jobs are distributed with a simple work-stealing scheme. The job
+ * list (ordered by parameter string, then by index within it) is
+ * initially split into equal contiguous ranges, one per thread. Each
+ * thread takes jobs from the front of its own range; a thread whose
+ * range is empty steals the back half of another thread's range. So
+ * a thread that was unlucky enough to be handed all the hard presets
+ * is relieved by the others once they run out of easy ones.
+ *
+ * Every job's game ID is a fixed function of its position in the job
+ * list, so the output for a given seed is the same regardless of how
+ * many threads there are or which thread generated it. The calling
+ * thread writes out results in job order, each as soon as it and all
+ * the jobs before it are finished.
+ *
+ * When printing, the calling thread instead renders each puzzle into
+ * a streaming document, overlapping with generation of later ones.
+ * Then we want to keep the number of finished-but-unprinted puzzles
+ * (each holding a couple of game_states) small, so jobs are handed
+ * out strictly in order from one shared queue, and a thread won't
+ * start a job too far ahead of the one being printed.
+ */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L /* for clock_gettime */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "puzzles.h"
+#include "grid.h"
+
+struct batchgen_queue {
+    pthread_mutex_t lock;
+    int lo, hi;                        /* jobs [lo,hi) not yet taken */
+};
+
+struct batchgen_result {
+    char *output;                      /* line(s) to print, or NULL */
+    char *error;                       /* error message, or NULL */
+    document *doc;                     /* puzzle to print, or NULL */
+    bool done;
+};
+
+/* How many jobs per thread may run ahead of printing. */
+#define BATCHGEN_PRINT_WINDOW 4
+
+struct batchgen_ctx {
+    const game *thegame;
+    const char *const *pstrs;
+    int npstrs, n;
+    const struct batchgen_options *opts;
+
+    int njobs, nthreads;
+    struct batchgen_queue *queues;
+    struct batchgen_result *results;
+
+    /*
+     * Protects the 'done' flags in results[], and in printing mode
+     * the in-order job counter. 'cond' is signalled whenever a job
+     * finishes or a result is consumed.
+     */
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool in_order;
+    int next, consumed, window;
+};
+
+struct batchgen_thread {
+    struct batchgen_ctx *ctx;
+    int index;
+    pthread_t thread;
+};
+
+/*
+ * Take a job from our own queue, or failing that steal half of
+ * someone else's. Returns false when there's no work left anywhere.
+ */
+static bool batchgen_take(struct batchgen_ctx *ctx, int self, int *job)
+{
+    struct batchgen_queue *q = &ctx->queues[self];
+    int k;
+
+    if (ctx->in_order) {
+        bool got;
+
+        pthread_mutex_lock(&ctx->lock);
+        while (ctx->next < ctx->njobs &&
+               ctx->next >= ctx->consumed + ctx->window)
+            pthread_cond_wait(&ctx->cond, &ctx->lock);
+        got = ctx->next < ctx->njobs;
+        if (got)
+            *job = ctx->next++;
+        pthread_mutex_unlock(&ctx->lock);
+        return got;
+    }
+
+    pthread_mutex_lock(&q->lock);
+    if (q->lo < q->hi) {
+        *job = q->lo++;
+        pthread_mutex_unlock(&q->lock);
+        return true;
+    }
+    pthread_mutex_unlock(&q->lock);
+
+    for (k = 1; k < ctx->nthreads; k++) {
+        struct batchgen_queue *victim =
+            &ctx->queues[(self + k) % ctx->nthreads];
+        int avail, take, mid;
+
+        pthread_mutex_lock(&victim->lock);
+        avail = victim->hi - victim->lo;
+        if (avail <= 0) {
+            pthread_mutex_unlock(&victim->lock);
+            continue;
+        }
+        take = (avail + 1) / 2;
+        mid = victim->hi - take;
+        victim->hi = mid;
+        pthread_mutex_unlock(&victim->lock);
+
+        /*
+         * Run the first stolen job ourselves, and leave the rest in
+         * our own queue, where they can in turn be stolen from us.
+         */
+        pthread_mutex_lock(&q->lock);
+        q->lo = mid + 1;
+        q->hi = mid + take;
+        pthread_mutex_unlock(&q->lock);
+        *job = mid;
+        return true;
+    }
+
+    return false;
+}
+
+static double thread_cpu_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+/*
+ * Build the game ID for a job, by the same rule as the serial
+ * --generate loop: if the parameter string has a random seed, then
+ * every game after the first gets a distinguishing suffix.
+ */
+static char *batchgen_job_id(struct batchgen_ctx *ctx, int job)
+{
+    const char *arg = ctx->pstrs[job / ctx->n];
+    int i = job % ctx->n;
+    char *pstr = snewn(strlen(arg) + 40, char);
+
+    strcpy(pstr, arg);
+    if (i > 0 && strchr(arg, '#'))
+        sprintf(pstr + strlen(pstr), "-%d", i);
+    return pstr;
+}
+
+static void batchgen_run_job(struct batchgen_ctx *ctx, midend *me, int job)
+{
+    const game *thegame = ctx->thegame;
+    struct batchgen_result *result = &ctx->results[job];
+    char *pstr, *seed, *id;
+    const char *err;
+    char errbuf[400];
+    double before = 0.0, elapsed = 0.0;
+
+    pstr = batchgen_job_id(ctx, job);
+    err = midend_game_id(me, pstr);
+    if (err) {
+        sprintf(errbuf, "error parsing '%.100s': %.100s", pstr, err);
+        result->error = dupstr(errbuf);
+        sfree(pstr);
+        return;
+    }
+    sfree(pstr);
+
+    if (ctx->opts->time_generation)
+        before = thread_cpu_time();
+
+    midend_new_game(me);
+
+    if (ctx->opts->time_generation)
+        elapsed = thread_cpu_time() - before;
+
+    seed = midend_get_random_seed(me);
+
+    if (ctx->opts->test_solve && thegame->can_solve) {
+        /* As in the serial loop: discard the aux_info, then solve. */
+        char *game_id = midend_get_game_id(me);
+        err = midend_game_id(me, game_id);
+        sfree(game_id);
+        if (err) {
+            sprintf(errbuf, "%.100s %.100s: game id re-entry error: %.100s",
+                    thegame->name, seed, err);
+            result->error = dupstr(errbuf);
+            sfree(seed);
+            return;
+        }
+        midend_new_game(me);
+
+        err = midend_solve(me);
+        if (err && strcmp(err, "Solution not known for this puzzle")) {
+            sprintf(errbuf, "%.100s %.100s: solve error: %.100s",
+                    thegame->name, seed, err);
+            result->error = dupstr(errbuf);
+            sfree(seed);
+            return;
+        }
+    }
+
+    if (ctx->opts->doc) {
+        /*
+         * Capture the puzzle (and its solution, if wanted, which is
+         * best done here while we still have the aux_info) in a
+         * private document, for the calling thread to print.
+         */
+        result->doc = document_new(1, 1, 1.0F);
+        err = midend_print_puzzle(me, result->doc, ctx->opts->with_soln);
+        if (err) {
+            sprintf(errbuf, "%.100s %.100s: error in printing: %.100s",
+                    thegame->name, seed, err);
+            result->error = dupstr(errbuf);
+        }
+    } else if (ctx->opts->time_generation) {
+        result->output = snewn(strlen(thegame->name) + strlen(seed) + 40,
+                               char);
+        sprintf(result->output, "%s %s: %.6f",
+                thegame->name, seed, elapsed);
+    } else {
+        id = midend_get_game_id(me);
+        result->output = id;
+    }
+    sfree(seed);
+}
+
+static void *batchgen_thread_main(void *vthread)
+{
+    struct batchgen_thread *th = (struct batchgen_thread *)vthread;
+    struct batchgen_ctx *ctx = th->ctx;
+    midend *me = midend_new(NULL, ctx->thegame, NULL, NULL);
+    int job;
+
+    while (batchgen_take(ctx, th->index, &job)) {
+        batchgen_run_job(ctx, me, job);
+
+        pthread_mutex_lock(&ctx->lock);
+        ctx->results[job].done = true;
+        pthread_cond_broadcast(&ctx->cond);
+        pthread_mutex_unlock(&ctx->lock);
+    }
+
+    midend_free(me);
+    return NULL;
+}
+
+int batch_generate(const game *thegame, const char *const *pstrs, int npstrs,
+                   int n, const struct batchgen_options *opts, FILE *out)
+{
+    struct batchgen_ctx ctx[1];
+    struct batchgen_thread *threads;
+    int i, job, ret = 0;
+
+    ctx->thegame = thegame;
+    ctx->pstrs = pstrs;
+    ctx->npstrs = npstrs;
+    ctx->n = n;
+    ctx->opts = opts;
+    ctx->njobs = npstrs * n;
+    ctx->nthreads = opts->nthreads;
+    if (ctx->nthreads > ctx->njobs)
+        ctx->nthreads = ctx->njobs;
+    if (ctx->nthreads < 1)
+        ctx->nthreads = 1;
+
+    ctx->results = snewn(ctx->njobs, struct batchgen_result);
+    for (job = 0; job < ctx->njobs; job++) {
+        ctx->results[job].output = ctx->results[job].error = NULL;
+        ctx->results[job].doc = NULL;
+        ctx->results[job].done = false;
+    }
+
+    pthread_mutex_init(&ctx->lock, NULL);
+    pthread_cond_init(&ctx->cond, NULL);
+    ctx->in_order = (opts->doc != NULL);
+    ctx->next = ctx->consumed = 0;
+    ctx->window = BATCHGEN_PRINT_WINDOW * ctx->nthreads;
+
+    ctx->queues = snewn(ctx->nthreads, struct batchgen_queue);
+    for (i = 0; i < ctx->nthreads; i++) {
+        pthread_mutex_init(&ctx->queues[i].lock, NULL);
+        ctx->queues[i].lo = (int)((long)ctx->njobs * i / ctx->nthreads);
+        ctx->queues[i].hi = (int)((long)ctx->njobs * (i+1) / ctx->nthreads);
+    }
+
+    grid_cache_disable();
+    threadpool_lock_caches();
+
+    threads = snewn(ctx->nthreads, struct batchgen_thread);
+    for (i = 0; i < ctx->nthreads; i++) {
+        threads[i].ctx = ctx;
+        threads[i].index = i;
+        if (pthread_create(&threads[i].thread, NULL,
+                           batchgen_thread_main, &threads[i]))
+            fatal("batch_generate: unable to create thread %d", i);
+    }
+    for (job = 0; job < ctx->njobs; job++) {
+        struct batchgen_result *result = &ctx->results[job];
+
+        pthread_mutex_lock(&ctx->lock);
+        while (!result->done)
+            pthread_cond_wait(&ctx->cond, &ctx->lock);
+        pthread_mutex_unlock(&ctx->lock);
+
+        if (result->error) {
+            fprintf(stderr, "%s\n", result->error);
+            ret = 1;
+        } else if (result->doc) {
+            document_transfer(opts->doc, result->doc);
+        } else if (result->output) {
+            fprintf(out, "%s\n", result->output);
+            fflush(out);
+        }
+        sfree(result->output);
+        sfree(result->error);
+        if (result->doc)
+            document_free(result->doc);
+
+        pthread_mutex_lock(&ctx->lock);
+        ctx->consumed++;
+        pthread_cond_broadcast(&ctx->cond);
+        pthread_mutex_unlock(&ctx->lock);
+    }
+
+    for (i = 0; i < ctx->nthreads; i++)
+        pthread_join(threads[i].thread, NULL);
+
+    pthread_mutex_destroy(&ctx->lock);
+    pthread_cond_destroy(&ctx->cond);
+    for (i = 0; i < ctx->nthreads; i++)
+        pthread_mutex_destroy(&ctx->queues[i].lock);
+    sfree(threads);
+    sfree(ctx->queues);
+    sfree(ctx->results);
+    return ret;
+}
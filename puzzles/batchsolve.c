@@ -0,0 +1,372 @@
+/*
+ * batchsolve.c: solve a stream of game IDs for one puzzle, for
+ * grading and verifying large collections of them.
+ *
+ * Usage: batchsolve [--threads N] [--batch N] [--grade] GAME [FILE]
+ *
+ * GAME is the short name (as in the executable, e.g. "tracks").
+ * Game IDs, of the PARAMS:DESC form, are read one per line from FILE,
+ * or standard input if there isn't one. Blank lines are skipped.
+ *
+ * Each ID is run through the same steps as entering it in the game
+ * and pressing Solve: validate_desc, new_game, and the game's own
+ * solver (the one its STANDALONE_SOLVER build also uses), with no aux
+ * info to help. The resulting move is then executed, as a check that
+ * the game accepts it. (Not that it completes the puzzle: some games,
+ * such as Rect and Undead, don't count a Solve move as completing it.)
+ * One line is printed per ID, in input order:
+ *
+ *   LINE RESULT TIME[ MESSAGE]
+ *
+ * where LINE is the ID's line number in the input, TIME is the CPU
+ * time taken over it in microseconds, and RESULT is one of:
+ *
+ *   solved    the solver returned a move, and the game executed it
+ *   rejected  the solver returned a move which the game wouldn't execute
+ *   failed    the solver gave up, with MESSAGE
+ *   invalid   the game ID was rejected, with MESSAGE
+ *
+ * With --grade, each ID is graded instead, by the game's grade
+ * function: one run of its solver at the highest difficulty, which
+ * reports the hardest level of deduction needed. Its RESULT is then
+ *
+ *   graded    with the difficulty level's name as MESSAGE
+ *
+ * or failed or invalid as above. This gives the same grades as the
+ * game's standalone solver's -g, without running a process per ID.
+ *
+ * A summary of the counts and the throughput goes to standard error.
+ * The exit status is 0 only if every ID was solved (or graded).
+ *
+ * The IDs are read in batches (of 4096 by default), each of which is
+ * solved on threadpool.c's pool of threads (one per processor by
+ * default) before being printed. So the output is the same however
+ * many threads there are, apart from the times.
+ */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L /* for clock_gettime */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "puzzles.h"
+#include "grid.h"
+
+enum { SOLVED, REJECTED, FAILED, INVALID, GRADED, NRESULTS };
+static const char *const result_names[NRESULTS] = {
+    "solved", "rejected", "failed", "invalid", "graded"
+};
+
+struct batchsolve_item {
+    char *id;                          /* game ID, or NULL if blank */
+    int line;
+    int result;
+    char *message;                     /* dynamically allocated, or NULL */
+    double time;                       /* in seconds */
+};
+
+struct batchsolve_ctx {
+    const game *thegame;
+    bool grade;
+    struct batchsolve_item *items;
+    int base;                          /* index of task 0 in items */
+};
+
+static double thread_cpu_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static double wall_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+/*
+ * Read a line of any length, without its newline. Returns NULL at
+ * the end of the file.
+ */
+static char *read_line(FILE *fp)
+{
+    size_t len = 0, size = 256;
+    char *buf = snewn(size, char);
+    int c;
+
+    while ((c = getc(fp)) != EOF && c != '\n') {
+        if (len + 1 >= size) {
+            size = size * 5 / 4 + 256;
+            buf = sresize(buf, size, char);
+        }
+        buf[len++] = c;
+    }
+    if (c == EOF && len == 0) {
+        sfree(buf);
+        return NULL;
+    }
+    if (len > 0 && buf[len-1] == '\r')
+        len--;
+    buf[len] = '\0';
+    return buf;
+}
+
+static void batchsolve_id(const game *thegame, bool grade,
+                          struct batchsolve_item *item)
+{
+    char *id = item->id, *desc, *move;
+    game_params *params;
+    game_state *state, *solved;
+    const char *err;
+
+    desc = strchr(id, ':');
+    if (!desc) {
+        item->result = INVALID;
+        item->message = dupstr(strchr(id, '#') ?
+                               "Random seeds are not game IDs" :
+                               "Game ID has no ':'");
+        return;
+    }
+    *desc++ = '\0';
+
+    params = thegame->default_params();
+    thegame->decode_params(params, id);
+    err = thegame->validate_params(params, false);
+    if (!err)
+        err = thegame->validate_desc(params, desc);
+    if (err) {
+        item->result = INVALID;
+        item->message = dupstr(err);
+        thegame->free_params(params);
+        return;
+    }
+
+    state = thegame->new_game(NULL, params, desc);
+    err = NULL;
+    if (grade) {
+        item->message = thegame->grade(state, &err);
+        if (item->message) {
+            item->result = GRADED;
+        } else {
+            item->result = FAILED;
+            item->message = dupstr(err ? err : "Solver returned no grade");
+        }
+        thegame->free_game(state);
+        thegame->free_params(params);
+        return;
+    }
+    move = thegame->solve(state, state, NULL, &err);
+    if (!move) {
+        item->result = FAILED;
+        item->message = dupstr(err ? err : "Solver returned no move");
+    } else {
+        solved = thegame->execute_move(state, move);
+        if (solved) {
+            item->result = SOLVED;
+            thegame->free_game(solved);
+        } else {
+            item->result = REJECTED;
+        }
+        sfree(move);
+    }
+    thegame->free_game(state);
+    thegame->free_params(params);
+}
+
+static void batchsolve_task(void *vctx, int i)
+{
+    struct batchsolve_ctx *ctx = (struct batchsolve_ctx *)vctx;
+    struct batchsolve_item *item = &ctx->items[ctx->base + i];
+    double before;
+
+    if (!item->id)
+        return;
+    before = thread_cpu_time();
+    batchsolve_id(ctx->thegame, ctx->grade, item);
+    item->time = thread_cpu_time() - before;
+}
+
+static int compare_doubles(const void *av, const void *bv)
+{
+    double a = *(const double *)av, b = *(const double *)bv;
+    return a < b ? -1 : a > b ? +1 : 0;
+}
+
+/* Nearest-rank percentile of n sorted samples. */
+static double percentile(const double *sorted, int n, int pc)
+{
+    int rank = (pc * n + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: batchsolve [--threads N] [--batch N] [--grade] "
+            "GAME [FILE]\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *gamename = NULL, *filename = NULL;
+    const game *thegame;
+    int nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN), batch = 4096;
+    bool doing_opts = true, grade = false;
+    struct batchsolve_ctx ctx[1];
+    int counts[NRESULTS];
+    double *times = NULL, start, elapsed, total;
+    int ntimes = 0, timesize = 0, line = 0, n, i, j;
+    bool eof = false;
+    FILE *fp;
+
+    for (i = 1; i < argc; i++) {
+        const char *p = argv[i];
+
+        if (doing_opts && !strcmp(p, "--threads") && i+1 < argc) {
+            nthreads = atoi(argv[++i]);
+        } else if (doing_opts && !strcmp(p, "--batch") && i+1 < argc) {
+            batch = atoi(argv[++i]);
+        } else if (doing_opts && !strcmp(p, "--grade")) {
+            grade = true;
+        } else if (doing_opts && !strcmp(p, "--")) {
+            doing_opts = false;
+        } else if (doing_opts && p[0] == '-' && p[1]) {
+            fprintf(stderr, "batchsolve: unrecognised option '%s'\n", p);
+            usage();
+            return 1;
+        } else if (!gamename) {
+            gamename = p;
+        } else if (!filename) {
+            filename = p;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (!gamename) {
+        usage();
+        return 1;
+    }
+    if (batch < 1) {
+        fprintf(stderr, "batchsolve: --batch must be at least 1\n");
+        return 1;
+    }
+
+    for (j = 0; j < gamecount; j++)
+        if (!strcmp(gamename, gamelist[j]->htmlhelp_topic))
+            break;
+    if (j == gamecount) {
+        fprintf(stderr, "batchsolve: unknown game '%s'\n", gamename);
+        return 1;
+    }
+    thegame = gamelist[j];
+    if (!thegame->can_solve) {
+        fprintf(stderr, "batchsolve: %s has no solver\n", gamename);
+        return 1;
+    }
+    if (grade && !thegame->grade) {
+        fprintf(stderr, "batchsolve: %s has no graded solver\n", gamename);
+        return 1;
+    }
+
+    if (!filename || !strcmp(filename, "-")) {
+        fp = stdin;
+    } else if (!(fp = fopen(filename, "r"))) {
+        fprintf(stderr, "batchsolve: unable to open '%s'\n", filename);
+        return 1;
+    }
+
+    /* Games with grids share a cache of them, which isn't thread-safe. */
+    grid_cache_disable();
+    threadpool_start(nthreads);
+
+    ctx->thegame = thegame;
+    ctx->grade = grade;
+    ctx->items = snewn(batch, struct batchsolve_item);
+    memset(counts, 0, sizeof(counts));
+    start = wall_time();
+
+    while (!eof) {
+        for (n = 0; n < batch; n++) {
+            struct batchsolve_item *item = &ctx->items[n];
+            char *id = read_line(fp);
+
+            if (!id) {
+                eof = true;
+                break;
+            }
+            item->line = ++line;
+            item->id = id[strspn(id, " \t")] ? id : NULL;
+            if (!item->id)
+                sfree(id);
+            item->message = NULL;
+        }
+
+        /*
+         * Some games fill in static tables the first time they need
+         * them, so do the very first ID on its own before starting
+         * the other threads.
+         */
+        ctx->base = 0;
+        if (line == n && n > 1) {
+            batchsolve_task(ctx, 0);
+            ctx->base = 1;
+        }
+        parallel_run(batchsolve_task, ctx, n - ctx->base);
+
+        for (i = 0; i < n; i++) {
+            struct batchsolve_item *item = &ctx->items[i];
+
+            if (!item->id)
+                continue;
+            printf("%d %s %.1f%s%s\n", item->line,
+                   result_names[item->result], item->time * 1e6,
+                   item->message ? " " : "",
+                   item->message ? item->message : "");
+            counts[item->result]++;
+            if (ntimes >= timesize) {
+                timesize = timesize * 5 / 4 + 1024;
+                times = sresize(times, timesize, double);
+            }
+            times[ntimes++] = item->time;
+            sfree(item->id);
+            sfree(item->message);
+        }
+        fflush(stdout);
+    }
+
+    elapsed = wall_time() - start;
+    if (fp != stdin)
+        fclose(fp);
+
+    fprintf(stderr, "batchsolve: %d IDs in %.2fs with %d thread%s",
+            ntimes, elapsed, parallel_nthreads(),
+            parallel_nthreads() == 1 ? "" : "s");
+    if (elapsed > 0)
+        fprintf(stderr, " (%.1f/s)", ntimes / elapsed);
+    fprintf(stderr, ":");
+    for (i = 0; i < NRESULTS; i++)
+        fprintf(stderr, "%s %d %s", i ? "," : "", counts[i], result_names[i]);
+    fprintf(stderr, "\n");
+    if (ntimes > 0) {
+        total = 0.0;
+        for (i = 0; i < ntimes; i++)
+            total += times[i];
+        qsort(times, ntimes, sizeof(double), compare_doubles);
+        fprintf(stderr, "batchsolve: time per ID (us): mean %.1f, p50 %.1f, "
+                "p90 %.1f, p99 %.1f, max %.1f\n", total / ntimes * 1e6,
+                percentile(times, ntimes, 50) * 1e6,
+                percentile(times, ntimes, 90) * 1e6,
+                percentile(times, ntimes, 99) * 1e6, times[ntimes-1] * 1e6);
+    }
+
+    sfree(times);
+    sfree(ctx->items);
+    return counts[grade ? GRADED : SOLVED] == ntimes ? 0 : 1;
+}
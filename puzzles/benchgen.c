@@ -0,0 +1,361 @@
+/*
+ * benchgen.c: generation-time benchmark for all puzzles.
+ *
+ * Unlike benchmark.sh, which reports only the mean generation time
+ * per preset, this records the whole distribution: the aim is to
+ * find the presets whose slowest generations are many times their
+ * typical one. Generators which mark their phases with
+ * generation_phase() also get a breakdown of where the time went.
+ *
+ * Usage: benchgen [--seed SEED] [--count N] [GAME[:PARAMS] ...]
+ *
+ * GAME is the short name (as in the executable, e.g. "tracks"). With
+ * no PARAMS, every preset of GAME is benchmarked; with no GAME at
+ * all, every preset of every game. Each preset gets N generations
+ * (default 100), from random seeds derived from SEED and the
+ * generation's index, so two builds given the same arguments
+ * generate exactly the same puzzles.
+ *
+ * Output is JSON, on standard output:
+ *
+ *   { "seed": ..., "count": N, "unit": "us", "results": [
+ *     { "game": "slant", "params": "12x10de",
+ *       "total": STATS,
+ *       "phases": { "grid": STATS, "solve": STATS, ... } }, ... ] }
+ *
+ * where STATS is an object giving the mean, p50, p90, p99 and max of
+ * the per-generation times (for a phase, the total time spent in it
+ * by each generation), plus a histogram: a list of [lower bound,
+ * count] pairs for the non-empty buckets, with four buckets per
+ * doubling of the time. Time spent in new_desc before its first phase
+ * marker is reported as phase "other". Times are CPU time, in
+ * microseconds.
+ *
+ * In a build with MEMORY_STATS, each result also has
+ *
+ *   "memory": { "peak": COUNTS, "allocs": COUNTS }
+ *
+ * giving the most memory each generation had allocated at once, in
+ * bytes, and the number of allocations it made; COUNTS is an object
+ * giving their mean, p50, p90, p99 and max.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef NO_TGMATH_H
+#  include <math.h>
+#else
+#  include <tgmath.h>
+#endif
+
+#include "puzzles.h"
+
+#define HIST_BUCKETS_PER_OCTAVE 4
+#define HIST_MAX_BUCKETS (32 * HIST_BUCKETS_PER_OCTAVE)
+
+#define MAX_PHASES 16
+
+struct phase {
+    const char *name;
+    double *samples;                   /* per generation, in seconds */
+};
+
+struct benchgen_job {
+    int count;
+    struct phase phases[MAX_PHASES];   /* phases[0] is "other" */
+    int nphases;
+
+    /* State of the generation in progress */
+    int gen;
+    int current;                       /* index into phases */
+    clock_t last;
+};
+
+static double elapsed_since(clock_t *last)
+{
+    clock_t now = clock();
+    double ret = (double)(now - *last) / CLOCKS_PER_SEC;
+    *last = now;
+    return ret;
+}
+
+static void benchgen_phase(void *ctx, const char *name)
+{
+    struct benchgen_job *job = (struct benchgen_job *)ctx;
+    int i;
+
+    job->phases[job->current].samples[job->gen] += elapsed_since(&job->last);
+
+    for (i = 0; i < job->nphases; i++)
+        if (!strcmp(job->phases[i].name, name))
+            break;
+    if (i == job->nphases) {
+        if (job->nphases == MAX_PHASES)
+            fatal("benchgen: too many generation phases");
+        job->phases[i].name = name;
+        job->phases[i].samples = snewn(job->count, double);
+        memset(job->phases[i].samples, 0, job->count * sizeof(double));
+        job->nphases++;
+    }
+    job->current = i;
+}
+
+static int compare_doubles(const void *av, const void *bv)
+{
+    double a = *(const double *)av, b = *(const double *)bv;
+    return a < b ? -1 : a > b ? +1 : 0;
+}
+
+static void print_json_string(const char *s)
+{
+    putchar('"');
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\')
+            putchar('\\');
+        putchar(*s);
+    }
+    putchar('"');
+}
+
+/* Nearest-rank percentile of n sorted samples. */
+static double percentile(const double *sorted, int n, int pc)
+{
+    int rank = (pc * n + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+/* Prints STATS for samples (in seconds), which it sorts in place. */
+static void print_stats(double *samples, int n)
+{
+    int hist[HIST_MAX_BUCKETS];
+    double total = 0.0;
+    int i, b;
+    const char *sep;
+
+    qsort(samples, n, sizeof(double), compare_doubles);
+
+    memset(hist, 0, sizeof(hist));
+    for (i = 0; i < n; i++) {
+        double us = samples[i] * 1e6;
+        total += samples[i];
+        /* Everything under 1us goes in the first bucket. */
+        b = us > 1.0 ? (int)floor(log2(us) * HIST_BUCKETS_PER_OCTAVE) : 0;
+        if (b >= HIST_MAX_BUCKETS)
+            b = HIST_MAX_BUCKETS - 1;
+        hist[b]++;
+    }
+
+    printf("{\"mean\": %.1f, \"p50\": %.1f, \"p90\": %.1f, "
+           "\"p99\": %.1f, \"max\": %.1f, \"histogram\": [",
+           total / n * 1e6, percentile(samples, n, 50) * 1e6,
+           percentile(samples, n, 90) * 1e6,
+           percentile(samples, n, 99) * 1e6, samples[n-1] * 1e6);
+    sep = "";
+    for (b = 0; b < HIST_MAX_BUCKETS; b++)
+        if (hist[b]) {
+            printf("%s[%.1f, %d]", sep,
+                   b ? pow(2.0, (double)b / HIST_BUCKETS_PER_OCTAVE) : 0.0,
+                   hist[b]);
+            sep = ", ";
+        }
+    printf("]}");
+}
+
+/* Prints COUNTS for samples, which it sorts in place. */
+static void print_counts(double *samples, int n)
+{
+    double total = 0.0;
+    int i;
+
+    qsort(samples, n, sizeof(double), compare_doubles);
+    for (i = 0; i < n; i++)
+        total += samples[i];
+    printf("{\"mean\": %.0f, \"p50\": %.0f, \"p90\": %.0f, "
+           "\"p99\": %.0f, \"max\": %.0f}", total / n,
+           percentile(samples, n, 50), percentile(samples, n, 90),
+           percentile(samples, n, 99), samples[n-1]);
+}
+
+static bool first_result = true;
+
+static void benchgen_params(const game *ourgame, game_params *params,
+                            const char *seed, int count)
+{
+    struct benchgen_job job[1];
+    double *totals = snewn(count, double);
+    double *peaks = snewn(count, double), *allocs = snewn(count, double);
+    char *pstr, *seedstr;
+    int i;
+
+    job->count = count;
+    job->nphases = 1;
+    job->phases[0].name = "other";
+    job->phases[0].samples = snewn(count, double);
+    memset(job->phases[0].samples, 0, count * sizeof(double));
+
+    seedstr = snewn(strlen(seed) + 40, char);
+    set_generation_phase_hook(benchgen_phase, job);
+    for (i = 0; i < count; i++) {
+        random_state *rs;
+        char *desc, *aux = NULL;
+        clock_t start;
+        memory_stats before, after;
+
+        sprintf(seedstr, "%s-%d", seed, i);
+        rs = random_new(seedstr, strlen(seedstr));
+
+        job->gen = i;
+        job->current = 0;
+        memory_stats_reset();
+        memory_stats_get(&before);
+        start = job->last = clock();
+        desc = ourgame->new_desc(params, rs, &aux, false);
+        job->phases[job->current].samples[i] += elapsed_since(&job->last);
+        totals[i] = (double)(job->last - start) / CLOCKS_PER_SEC;
+        memory_stats_get(&after);
+        peaks[i] = (double)(after.peak - before.live);
+        allocs[i] = (double)after.allocs;
+
+        sfree(desc);
+        sfree(aux);
+        random_free(rs);
+    }
+    set_generation_phase_hook(NULL, NULL);
+    sfree(seedstr);
+
+    pstr = ourgame->encode_params(params, true);
+    printf("%s\n    {\"game\": ", first_result ? "" : ",");
+    first_result = false;
+    print_json_string(ourgame->htmlhelp_topic);
+    printf(", \"params\": ");
+    print_json_string(pstr);
+    printf(",\n     \"total\": ");
+    print_stats(totals, count);
+    /* Games that don't mark their phases only have "other". */
+    if (job->nphases > 1) {
+        printf(",\n     \"phases\": {");
+        for (i = 0; i < job->nphases; i++) {
+            printf("%s\n       ", i ? "," : "");
+            print_json_string(job->phases[i].name);
+            printf(": ");
+            print_stats(job->phases[i].samples, count);
+        }
+        printf("}");
+    }
+    if (memory_stats_enabled()) {
+        printf(",\n     \"memory\": {\"peak\": ");
+        print_counts(peaks, count);
+        printf(", \"allocs\": ");
+        print_counts(allocs, count);
+        printf("}");
+    }
+    printf("}");
+    fflush(stdout);
+    sfree(pstr);
+
+    for (i = 0; i < job->nphases; i++)
+        sfree(job->phases[i].samples);
+    sfree(totals);
+    sfree(peaks);
+    sfree(allocs);
+}
+
+static void benchgen_menu(const game *ourgame, struct preset_menu *menu,
+                          const char *seed, int count)
+{
+    int i;
+
+    for (i = 0; i < menu->n_entries; i++) {
+        if (menu->entries[i].params)
+            benchgen_params(ourgame, menu->entries[i].params, seed, count);
+        else
+            benchgen_menu(ourgame, menu->entries[i].submenu, seed, count);
+    }
+}
+
+static void benchgen_game(const game *ourgame, const char *pstr,
+                          const char *seed, int count)
+{
+    if (pstr) {
+        game_params *params = ourgame->default_params();
+        const char *err;
+
+        ourgame->decode_params(params, pstr);
+        err = ourgame->validate_params(params, true);
+        if (err) {
+            fprintf(stderr, "benchgen: %s: invalid params '%s': %s\n",
+                    ourgame->htmlhelp_topic, pstr, err);
+            exit(1);
+        }
+        benchgen_params(ourgame, params, seed, count);
+        ourgame->free_params(params);
+    } else {
+        /* The midend knows how to build the preset menu. */
+        midend *me = midend_new(NULL, ourgame, NULL, NULL);
+        benchgen_menu(ourgame, midend_get_presets(me, NULL), seed, count);
+        midend_free(me);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *seed = "benchgen";
+    int count = 100;
+    bool doing_opts = true;
+    const char **args = snewn(argc, const char *);
+    int nargs = 0;
+    int i, j;
+
+    for (i = 1; i < argc; i++) {
+        const char *p = argv[i];
+
+        if (doing_opts && !strcmp(p, "--seed") && i+1 < argc) {
+            seed = argv[++i];
+        } else if (doing_opts && !strcmp(p, "--count") && i+1 < argc) {
+            count = atoi(argv[++i]);
+        } else if (doing_opts && !strcmp(p, "--")) {
+            doing_opts = false;
+        } else if (doing_opts && p[0] == '-') {
+            fprintf(stderr, "benchgen: unrecognised option '%s'\n", p);
+            fprintf(stderr, "usage: benchgen [--seed SEED] [--count N] "
+                    "[GAME[:PARAMS] ...]\n");
+            return 1;
+        } else {
+            args[nargs++] = p;
+        }
+    }
+    if (count < 1) {
+        fprintf(stderr, "benchgen: --count must be at least 1\n");
+        return 1;
+    }
+
+    printf("{\"seed\": ");
+    print_json_string(seed);
+    printf(", \"count\": %d, \"unit\": \"us\", \"results\": [", count);
+
+    for (i = 0; i < nargs; i++) {
+        char *name = dupstr(args[i]), *colon = strchr(name, ':');
+
+        if (colon)
+            *colon++ = '\0';
+        for (j = 0; j < gamecount; j++)
+            if (!strcmp(name, gamelist[j]->htmlhelp_topic))
+                break;
+        if (j == gamecount) {
+            fprintf(stderr, "benchgen: unknown game '%s'\n", name);
+            return 1;
+        }
+        benchgen_game(gamelist[j], colon, seed, count);
+        sfree(name);
+    }
+
+    if (!nargs)
+        for (j = 0; j < gamecount; j++)
+            benchgen_game(gamelist[j], NULL, seed, count);
+
+    printf("\n]}\n");
+    sfree(args);
+    return 0;
+}
@@ -6,6 +6,20 @@
 # Expects to be run in the cmake build directory, where it can find
 # both the game binaries themselves and the file gamelist.txt that
 # lists them.
+#
+# This only gives mean times. For the full distribution of generation
+# times per preset, broken down by generation phase, run benchgen. For
+# the time the solvers take on their own, run benchsolve, whose output
+# benchmark.pl also formats.
+
+# Set BENCHMARK_THREADS to generate each game's presets in a single
+# process, spread over that many threads. (The per-seed output is
+# the same either way; only the wall-clock time changes.)
+threads=${BENCHMARK_THREADS:-}
+
+# Set BENCHMARK_COUNT to generate some number of games per preset
+# other than 100.
+count=${BENCHMARK_COUNT:-100}
 
 # If any arguments are provided, use those as the list of games to
 # benchmark. Otherwise, read the full list from gamelist.txt.
@@ -16,12 +30,23 @@ fi
 failures=false
 
 for game in "$@"; do
+    if test -n "$threads"; then
+        if ! env -i ./$game --test-solve --time-generation \
+                            --threads "$threads" --all-presets \
+                            --generate "$count";
+        then
+            echo "${game} failed to generate" >&2
+            failures=true
+        fi
+        continue
+    fi
+
     # Use 'env -i' to suppress any environment variables that might
     # change the preset list for a puzzle (e.g. user-defined extras)
     presets=$(env -i ./$game --list-presets | cut -f1 -d' ')
     for preset in $presets; do
 	if ! env -i ./$game --test-solve --time-generation \
-                            --generate 100 $preset;
+                            --generate "$count" $preset;
         then
             echo "${game} ${preset} failed to generate" >&2
         fi
@@ -0,0 +1,247 @@
+/*
+ * benchsolve.c: solver-time benchmark for all puzzles.
+ *
+ * benchmark.sh and benchgen time generation, which for most puzzles
+ * includes running the solver many times over, so a change in either
+ * shows up in both. This times the solvers on their own, over a fixed
+ * corpus of game IDs, so that solver regressions can be tracked
+ * independently of the generators.
+ *
+ * Usage: benchsolve [--seed SEED] [--count N] [--repeat N]
+ *                   [GAME[:PARAMS] ...]
+ *
+ * GAME is the puzzle id, as in generated-games.h (the source file
+ * name, e.g. "tracks"): unlike the help topics which benchgen and
+ * batchsolve go by, these cover the unreleased puzzles too. With no
+ * PARAMS, every preset of GAME is benchmarked; with no GAME at all,
+ * every preset of every puzzle that has a solver. For each preset, a
+ * corpus of N game IDs (default 20) is generated first, untimed, from
+ * random seeds derived from SEED and the ID's index, as benchgen does:
+ * so two builds given the same arguments solve exactly the same
+ * puzzles, as long as the generators haven't changed.
+ *
+ * Each ID is then run through the same steps as batchsolve (and as
+ * entering it in the game and pressing Solve): validate_desc,
+ * new_game, and the game's solver, with no aux info. The whole corpus
+ * is solved once untimed, to warm up, and then N more times (default
+ * 3, set by --repeat), keeping each ID's fastest time.
+ *
+ * Output is in the same form as benchmark.sh's, so that benchmark.pl
+ * can format it into a web page: one line per ID,
+ *
+ *   NAME PARAMS#INDEX: TIME
+ *
+ * with TIME the CPU time in seconds. Solve failures are reported on
+ * standard error (apart from "Solution not known for this puzzle",
+ * from games which can't solve without aux info), and make the exit
+ * status 1.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "puzzles.h"
+
+#define GAME(x) { #x, &x },
+static const struct {
+    const char *id;
+    const game *game;
+} games[] = {
+#include "generated-games.h"
+};
+#undef GAME
+
+static bool failures = false;
+
+/*
+ * Solve one ID. Returns the error from the solver, or NULL if it
+ * returned a move.
+ */
+static const char *benchsolve_id(const game *ourgame,
+                                 const game_params *params, const char *desc)
+{
+    game_state *state;
+    const char *err;
+    char *move;
+
+    err = ourgame->validate_desc(params, desc);
+    if (err)
+        return err;
+    state = ourgame->new_game(NULL, params, desc);
+    err = NULL;
+    move = ourgame->solve(state, state, NULL, &err);
+    if (move) {
+        sfree(move);
+        err = NULL;
+    } else if (!err) {
+        err = "Solver returned no move";
+    }
+    ourgame->free_game(state);
+    return err;
+}
+
+static void benchsolve_params(const game *ourgame, game_params *params,
+                              const char *seed, int count, int repeat)
+{
+    char **descs = snewn(count, char *);
+    double *times = snewn(count, double);
+    char *pstr, *seedstr;
+    int i, r;
+
+    pstr = ourgame->encode_params(params, true);
+
+    /* Generate the corpus. */
+    seedstr = snewn(strlen(seed) + 40, char);
+    for (i = 0; i < count; i++) {
+        random_state *rs;
+        char *aux = NULL;
+
+        sprintf(seedstr, "%s-%d", seed, i);
+        rs = random_new(seedstr, strlen(seedstr));
+        descs[i] = ourgame->new_desc(params, rs, &aux, false);
+        sfree(aux);
+        random_free(rs);
+    }
+    sfree(seedstr);
+
+    /* Warm up, and check the solver can cope with every ID. */
+    for (i = 0; i < count; i++) {
+        const char *err = benchsolve_id(ourgame, params, descs[i]);
+        if (err && strcmp(err, "Solution not known for this puzzle")) {
+            fprintf(stderr, "benchsolve: %s %s#%d: solve error: %s\n",
+                    ourgame->name, pstr, i, err);
+            failures = true;
+        }
+    }
+
+    for (r = 0; r < repeat; r++) {
+        for (i = 0; i < count; i++) {
+            clock_t start = clock();
+            double elapsed;
+
+            benchsolve_id(ourgame, params, descs[i]);
+            elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+            if (r == 0 || elapsed < times[i])
+                times[i] = elapsed;
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        printf("%s %s#%d: %.6f\n", ourgame->name, pstr, i, times[i]);
+        sfree(descs[i]);
+    }
+    fflush(stdout);
+
+    sfree(pstr);
+    sfree(times);
+    sfree(descs);
+}
+
+static void benchsolve_menu(const game *ourgame, struct preset_menu *menu,
+                            const char *seed, int count, int repeat)
+{
+    int i;
+
+    for (i = 0; i < menu->n_entries; i++) {
+        if (menu->entries[i].params)
+            benchsolve_params(ourgame, menu->entries[i].params,
+                              seed, count, repeat);
+        else
+            benchsolve_menu(ourgame, menu->entries[i].submenu,
+                            seed, count, repeat);
+    }
+}
+
+static void benchsolve_game(const char *id, const game *ourgame,
+                            const char *pstr, const char *seed,
+                            int count, int repeat)
+{
+    if (pstr) {
+        game_params *params = ourgame->default_params();
+        const char *err;
+
+        ourgame->decode_params(params, pstr);
+        err = ourgame->validate_params(params, true);
+        if (err) {
+            fprintf(stderr, "benchsolve: %s: invalid params '%s': %s\n",
+                    id, pstr, err);
+            exit(1);
+        }
+        benchsolve_params(ourgame, params, seed, count, repeat);
+        ourgame->free_params(params);
+    } else {
+        /* The midend knows how to build the preset menu. */
+        midend *me = midend_new(NULL, ourgame, NULL, NULL);
+        benchsolve_menu(ourgame, midend_get_presets(me, NULL),
+                        seed, count, repeat);
+        midend_free(me);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *seed = "benchsolve";
+    int count = 20, repeat = 3;
+    bool doing_opts = true;
+    const char **args = snewn(argc, const char *);
+    int nargs = 0;
+    int i, j;
+
+    for (i = 1; i < argc; i++) {
+        const char *p = argv[i];
+
+        if (doing_opts && !strcmp(p, "--seed") && i+1 < argc) {
+            seed = argv[++i];
+        } else if (doing_opts && !strcmp(p, "--count") && i+1 < argc) {
+            count = atoi(argv[++i]);
+        } else if (doing_opts && !strcmp(p, "--repeat") && i+1 < argc) {
+            repeat = atoi(argv[++i]);
+        } else if (doing_opts && !strcmp(p, "--")) {
+            doing_opts = false;
+        } else if (doing_opts && p[0] == '-') {
+            fprintf(stderr, "benchsolve: unrecognised option '%s'\n", p);
+            fprintf(stderr, "usage: benchsolve [--seed SEED] [--count N] "
+                    "[--repeat N] [GAME[:PARAMS] ...]\n");
+            return 1;
+        } else {
+            args[nargs++] = p;
+        }
+    }
+    if (count < 1 || repeat < 1) {
+        fprintf(stderr, "benchsolve: --count and --repeat must be at "
+                "least 1\n");
+        return 1;
+    }
+
+    for (i = 0; i < nargs; i++) {
+        char *name = dupstr(args[i]), *colon = strchr(name, ':');
+
+        if (colon)
+            *colon++ = '\0';
+        for (j = 0; j < lenof(games); j++)
+            if (!strcmp(name, games[j].id))
+                break;
+        if (j == lenof(games)) {
+            fprintf(stderr, "benchsolve: unknown game '%s'\n", name);
+            return 1;
+        }
+        if (!games[j].game->can_solve) {
+            fprintf(stderr, "benchsolve: %s has no solver\n", name);
+            return 1;
+        }
+        benchsolve_game(games[j].id, games[j].game, colon,
+                        seed, count, repeat);
+        sfree(name);
+    }
+
+    if (!nargs)
+        for (j = 0; j < lenof(games); j++)
+            if (games[j].game->can_solve)
+                benchsolve_game(games[j].id, games[j].game, NULL,
+                                seed, count, repeat);
+
+    sfree(args);
+    return failures ? 1 : 0;
+}
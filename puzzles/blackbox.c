@@ -676,6 +676,26 @@ static int laser_exit(game_state *state, int entryno)
     return fire_laser_internal(state, x, y, direction);
 }
 
+/*
+ * Work out where every laser would come out, as laser_exit would,
+ * into exits[]. Lasers are reversible, so one which comes out of
+ * another range square would come out of this one if fired from
+ * there, and each such pair only needs tracing once.
+ */
+static void laser_exits(game_state *state, int *exits)
+{
+    int i;
+
+    for (i = 0; i < state->nlasers; i++)
+        exits[i] = LASER_EMPTY;
+    for (i = 0; i < state->nlasers; i++)
+        if (exits[i] == LASER_EMPTY) {
+            exits[i] = laser_exit(state, i);
+            if (RANGECHECK(state, exits[i]))
+                exits[exits[i]] = i;
+        }
+}
+
 static void fire_laser(game_state *state, int entryno)
 {
     int exitno, x, y, direction;
@@ -708,6 +728,7 @@ static int check_guesses(game_state *state, bool cagey)
 {
     game_state *solution, *guesses;
     int i, x, y, n, unused, tmp;
+    int *stateexits, *guessexits;
     bool tmpb;
     int ret = 0;
 
@@ -732,10 +753,18 @@ static int check_guesses(game_state *state, bool cagey)
 		    GRID(guesses, x, y) |= BALL_CORRECT;
 	    }
 	}
+	/*
+	 * Neither set of balls changes from here on, so trace every
+	 * laser through each of them just once.
+	 */
+	stateexits = snewn(state->nlasers, int);
+	guessexits = snewn(state->nlasers, int);
+	laser_exits(state, stateexits);
+	laser_exits(guesses, guessexits);
 	n = 0;
 	for (i = 0; i < guesses->nlasers; i++) {
 	    if (guesses->exits[i] != LASER_EMPTY &&
-		guesses->exits[i] != laser_exit(guesses, i))
+		guesses->exits[i] != guessexits[i])
 		n++;
 	}
 	if (n) {
@@ -755,13 +784,15 @@ static int check_guesses(game_state *state, bool cagey)
 	    random_free(rs);
 	    for (i = 0; i < guesses->nlasers; i++) {
 		if (guesses->exits[i] != LASER_EMPTY &&
-		    guesses->exits[i] != laser_exit(guesses, i) &&
+		    guesses->exits[i] != guessexits[i] &&
 		    n-- == 0) {
 		    state->exits[i] |= LASER_WRONG;
-		    tmp = laser_exit(state, i);
+		    tmp = stateexits[i];
 		    if (RANGECHECK(state, tmp))
 			state->exits[tmp] |= LASER_WRONG;
 		    state->justwrong = true;
+		    sfree(stateexits);
+		    sfree(guessexits);
 		    free_game(guesses);
 		    return 0;
 		}
@@ -770,7 +801,7 @@ static int check_guesses(game_state *state, bool cagey)
 	n = 0;
 	for (i = 0; i < guesses->nlasers; i++) {
 	    if (guesses->exits[i] == LASER_EMPTY &&
-		laser_exit(state, i) != laser_exit(guesses, i))
+		stateexits[i] != guessexits[i])
 		n++;
 	}
 	if (n) {
@@ -790,19 +821,23 @@ static int check_guesses(game_state *state, bool cagey)
 	    random_free(rs);
 	    for (i = 0; i < guesses->nlasers; i++) {
 		if (guesses->exits[i] == LASER_EMPTY &&
-		    laser_exit(state, i) != laser_exit(guesses, i) &&
+		    stateexits[i] != guessexits[i] &&
 		    n-- == 0) {
 		    fire_laser(state, i);
 		    state->exits[i] |= LASER_OMITTED;
-		    tmp = laser_exit(state, i);
+		    tmp = stateexits[i];
 		    if (RANGECHECK(state, tmp))
 			state->exits[tmp] |= LASER_OMITTED;
 		    state->justwrong = true;
+		    sfree(stateexits);
+		    sfree(guessexits);
 		    free_game(guesses);
 		    return 0;
 		}
 	    }
 	}
+	sfree(stateexits);
+	sfree(guessexits);
 	free_game(guesses);
     }
 
@@ -1567,7 +1602,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
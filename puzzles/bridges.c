@@ -147,8 +147,21 @@ struct game_params {
 typedef unsigned int grid_type; /* change me later if we invent > 16 bits of flags. */
 
 struct solver_state {
-    DSF *dsf, *tmpdsf;
+    DSF *dsf;
     int *comptspaces, *tmpcompspaces;
+
+    /*
+     * The solver's own record of which islands are connected, indexed
+     * by island number. It's a dsf without path compression, so that
+     * the stage 3 solver can undo its trial joins by unwinding 'trail'
+     * rather than copying the whole thing. Each root also counts the
+     * islands in its group, and how many of them don't have exactly
+     * the right number of bridges.
+     */
+    int *parent, *nislands, *nunfull;
+    struct solver_undo { int *where, was; } *trail;
+    int ntrail, trailsize;
+
     int refcount;
 };
 
@@ -939,100 +952,137 @@ static char *game_state_diff(const game_state *src, const game_state *dest)
 /* This function is optimised; a Quantify showed that lots of grid-generation time
  * (>50%) was spent in here. Hence the IDX() stuff. */
 
-static void map_update_possibles(game_state *state)
+/* Set possv down column x. */
+static void map_update_possv(game_state *state, int x)
 {
-    int x, y, s, e, i, np, maxb, w = state->w, idx;
+    int y, s, e, i, np, maxb, w = state->w, idx;
     bool bl;
     struct island *is_s = NULL, *is_f = NULL;
 
-    /* Run down vertical stripes [un]setting possv... */
-    for (x = 0; x < state->w; x++) {
-        idx = x;
-        s = e = -1;
-        bl = false;
-        maxb = state->params.maxb;     /* placate optimiser */
-        /* Unset possible flags until we find an island. */
-        for (y = 0; y < state->h; y++) {
-            is_s = IDX(state, gridi, idx);
-            if (is_s) {
-                maxb = is_s->count;
-                break;
-            }
-
-            IDX(state, possv, idx) = 0;
-            idx += w;
+    idx = x;
+    s = e = -1;
+    bl = false;
+    maxb = state->params.maxb;     /* placate optimiser */
+    /* Unset possible flags until we find an island. */
+    for (y = 0; y < state->h; y++) {
+        is_s = IDX(state, gridi, idx);
+        if (is_s) {
+            maxb = is_s->count;
+            break;
         }
-        for (; y < state->h; y++) {
-            maxb = min(maxb, IDX(state, maxv, idx));
-            is_f = IDX(state, gridi, idx);
-            if (is_f) {
-                assert(is_s);
-                np = min(maxb, is_f->count);
 
-                if (s != -1) {
-                    for (i = s; i <= e; i++) {
-                        INDEX(state, possv, x, i) = bl ? 0 : np;
-                    }
+        IDX(state, possv, idx) = 0;
+        idx += w;
+    }
+    for (; y < state->h; y++) {
+        maxb = min(maxb, IDX(state, maxv, idx));
+        is_f = IDX(state, gridi, idx);
+        if (is_f) {
+            assert(is_s);
+            np = min(maxb, is_f->count);
+
+            if (s != -1) {
+                for (i = s; i <= e; i++) {
+                    INDEX(state, possv, x, i) = bl ? 0 : np;
                 }
-                s = y+1;
-                bl = false;
-                is_s = is_f;
-                maxb = is_s->count;
-            } else {
-                e = y;
-                if (IDX(state,grid,idx) & (G_LINEH|G_NOLINEV)) bl = true;
             }
-            idx += w;
-        }
-        if (s != -1) {
-            for (i = s; i <= e; i++)
-                INDEX(state, possv, x, i) = 0;
+            s = y+1;
+            bl = false;
+            is_s = is_f;
+            maxb = is_s->count;
+        } else {
+            e = y;
+            if (IDX(state,grid,idx) & (G_LINEH|G_NOLINEV)) bl = true;
         }
+        idx += w;
     }
+    if (s != -1) {
+        for (i = s; i <= e; i++)
+            INDEX(state, possv, x, i) = 0;
+    }
+}
 
-    /* ...and now do horizontal stripes [un]setting possh. */
-    /* can we lose this clone'n'hack? */
-    for (y = 0; y < state->h; y++) {
-        idx = y*w;
-        s = e = -1;
-        bl = false;
-        maxb = state->params.maxb;     /* placate optimiser */
-        for (x = 0; x < state->w; x++) {
-            is_s = IDX(state, gridi, idx);
-            if (is_s) {
-                maxb = is_s->count;
-                break;
-            }
+/* Set possh along row y. (Can we lose this clone'n'hack?) */
+static void map_update_possh(game_state *state, int y)
+{
+    int x, s, e, i, np, maxb, w = state->w, idx;
+    bool bl;
+    struct island *is_s = NULL, *is_f = NULL;
 
-            IDX(state, possh, idx) = 0;
-            idx += 1;
+    idx = y*w;
+    s = e = -1;
+    bl = false;
+    maxb = state->params.maxb;     /* placate optimiser */
+    for (x = 0; x < state->w; x++) {
+        is_s = IDX(state, gridi, idx);
+        if (is_s) {
+            maxb = is_s->count;
+            break;
         }
-        for (; x < state->w; x++) {
-            maxb = min(maxb, IDX(state, maxh, idx));
-            is_f = IDX(state, gridi, idx);
-            if (is_f) {
-                assert(is_s);
-                np = min(maxb, is_f->count);
 
-                if (s != -1) {
-                    for (i = s; i <= e; i++) {
-                        INDEX(state, possh, i, y) = bl ? 0 : np;
-                    }
+        IDX(state, possh, idx) = 0;
+        idx += 1;
+    }
+    for (; x < state->w; x++) {
+        maxb = min(maxb, IDX(state, maxh, idx));
+        is_f = IDX(state, gridi, idx);
+        if (is_f) {
+            assert(is_s);
+            np = min(maxb, is_f->count);
+
+            if (s != -1) {
+                for (i = s; i <= e; i++) {
+                    INDEX(state, possh, i, y) = bl ? 0 : np;
                 }
-                s = x+1;
-                bl = false;
-                is_s = is_f;
-                maxb = is_s->count;
-            } else {
-                e = x;
-                if (IDX(state,grid,idx) & (G_LINEV|G_NOLINEH)) bl = true;
             }
-            idx += 1;
-        }
-        if (s != -1) {
-            for (i = s; i <= e; i++)
-                INDEX(state, possh, i, y) = 0;
+            s = x+1;
+            bl = false;
+            is_s = is_f;
+            maxb = is_s->count;
+        } else {
+            e = x;
+            if (IDX(state,grid,idx) & (G_LINEV|G_NOLINEH)) bl = true;
         }
+        idx += 1;
+    }
+    if (s != -1) {
+        for (i = s; i <= e; i++)
+            INDEX(state, possh, i, y) = 0;
+    }
+}
+
+static void map_update_possibles(game_state *state)
+{
+    int x, y;
+
+    /* Run down vertical stripes [un]setting possv... */
+    for (x = 0; x < state->w; x++)
+        map_update_possv(state, x);
+
+    /* ...and now do horizontal stripes [un]setting possh. */
+    for (y = 0; y < state->h; y++)
+        map_update_possh(state, y);
+}
+
+/*
+ * Bring the possibles up to date after solve_join(is, direction, ...),
+ * assuming they were up to date before. Its bridges, NOLINE flags or
+ * maxima only affect the stripe they lie along, and the stripes
+ * crossing them.
+ */
+static void map_update_possibles_join(struct island *is, int direction)
+{
+    game_state *state = is->state;
+    int x, y, ox = ISLAND_ORTHX(is, direction), oy = ISLAND_ORTHY(is, direction);
+
+    if (is->adj.points[direction].dx) {
+        map_update_possh(state, is->y);
+        for (x = min(is->x, ox) + 1; x < max(is->x, ox); x++)
+            map_update_possv(state, x);
+    } else {
+        map_update_possv(state, is->x);
+        for (y = min(is->y, oy) + 1; y < max(is->y, oy); y++)
+            map_update_possh(state, y);
     }
 }
 
@@ -1281,26 +1331,111 @@ static void map_clear(game_state *state)
     }
 }
 
+/* --- Island groups, for the solver --- */
+
+static void solver_set(struct solver_state *ss, int *where, int value)
+{
+    if (ss->ntrail >= ss->trailsize) {
+        ss->trailsize = ss->ntrail * 5 / 4 + 64;
+        ss->trail = sresize(ss->trail, ss->trailsize, struct solver_undo);
+    }
+    ss->trail[ss->ntrail].where = where;
+    ss->trail[ss->ntrail].was = *where;
+    ss->ntrail++;
+    *where = value;
+}
+
+/* Put everything back as it was when ss->ntrail was 'mark'. */
+static void solver_undo(struct solver_state *ss, int mark)
+{
+    while (ss->ntrail > mark) {
+        ss->ntrail--;
+        *ss->trail[ss->ntrail].where = ss->trail[ss->ntrail].was;
+    }
+}
+
+static int solver_group(struct solver_state *ss, int i)
+{
+    while (ss->parent[i] != i)
+        i = ss->parent[i];
+    return i;
+}
+
+static void solver_merge(struct solver_state *ss, int a, int b)
+{
+    a = solver_group(ss, a);
+    b = solver_group(ss, b);
+    if (a == b) return;
+    if (ss->nislands[a] < ss->nislands[b]) {
+        int t = a; a = b; b = t;
+    }
+    solver_set(ss, &ss->parent[b], a);
+    solver_set(ss, &ss->nislands[a], ss->nislands[a] + ss->nislands[b]);
+    solver_set(ss, &ss->nunfull[a], ss->nunfull[a] + ss->nunfull[b]);
+}
+
+static bool island_unfull(struct island *is)
+{
+    return island_countbridges(is) != is->count;
+}
+
+/* Set up the island groups from the bridges already in place. */
+static void solver_group_islands(game_state *state)
+{
+    struct solver_state *ss = state->solver;
+    struct island *is, *is_join;
+    int i, j;
+
+    for (i = 0; i < state->n_islands; i++) {
+        ss->parent[i] = i;
+        ss->nislands[i] = 1;
+        ss->nunfull[i] = island_unfull(&state->islands[i]) ? 1 : 0;
+    }
+    for (i = 0; i < state->n_islands; i++) {
+        is = &state->islands[i];
+        for (j = 0; j < is->adj.npoints; j++) {
+            is_join = island_find_connection(is, j);
+            if (is_join)
+                solver_merge(ss, i, is_join - state->islands);
+        }
+    }
+    ss->ntrail = 0;
+}
+
 static void solve_join(struct island *is, int direction, int n, bool is_max)
 {
     struct island *is_orth;
-    int d1, d2;
-    DSF *dsf = is->state->solver->dsf;
-    game_state *state = is->state; /* for DINDEX */
+    struct solver_state *ss = is->state->solver;
+    int i1 = is - is->state->islands, i2, g;
+    bool unfull1 = false, unfull2 = false;
 
     is_orth = INDEX(is->state, gridi,
                     ISLAND_ORTHX(is, direction),
                     ISLAND_ORTHY(is, direction));
     assert(is_orth);
+    i2 = is_orth - is->state->islands;
     /*debug(("...joining (%d,%d) to (%d,%d) with %d bridge(s).\n",
            is->x, is->y, is_orth->x, is_orth->y, n));*/
+    if (!is_max) {
+        unfull1 = island_unfull(is);
+        unfull2 = island_unfull(is_orth);
+    }
     island_join(is, is_orth, n, is_max);
 
-    if (n > 0 && !is_max) {
-        d1 = DINDEX(is->x, is->y);
-        d2 = DINDEX(is_orth->x, is_orth->y);
-        if (!dsf_equivalent(dsf, d1, d2))
-            dsf_merge(dsf, d1, d2);
+    if (!is_max) {
+        /* Keep the groups' counts of unfinished islands up to date. */
+        if (island_unfull(is) != unfull1) {
+            g = solver_group(ss, i1);
+            solver_set(ss, &ss->nunfull[g], ss->nunfull[g] +
+                       (unfull1 ? -1 : +1));
+        }
+        if (island_unfull(is_orth) != unfull2) {
+            g = solver_group(ss, i2);
+            solver_set(ss, &ss->nunfull[g], ss->nunfull[g] +
+                       (unfull2 ? -1 : +1));
+        }
+        if (n > 0)
+            solver_merge(ss, i1, i2);
     }
 }
 
@@ -1400,9 +1535,7 @@ static bool solve_island_stage1(struct island *is, bool *didsth_r)
 static bool solve_island_checkloop(struct island *is, int direction)
 {
     struct island *is_orth;
-    DSF *dsf = is->state->solver->dsf;
-    int d1, d2;
-    game_state *state = is->state;
+    struct solver_state *ss = is->state->solver;
 
     if (is->state->allowloops)
         return false; /* don't care anyway */
@@ -1416,9 +1549,8 @@ static bool solve_island_checkloop(struct island *is, int direction)
                     ISLAND_ORTHY(is,direction));
     if (!is_orth) return false;
 
-    d1 = DINDEX(is->x, is->y);
-    d2 = DINDEX(is_orth->x, is_orth->y);
-    if (dsf_equivalent(dsf, d1, d2)) {
+    if (solver_group(ss, is - is->state->islands) ==
+        solver_group(ss, is_orth - is->state->islands)) {
         /* two islands are connected already; don't join them. */
         return true;
     }
@@ -1476,9 +1608,9 @@ static bool solve_island_stage2(struct island *is, bool *didsth_r)
 static bool solve_island_subgroup(struct island *is, int direction)
 {
     struct island *is_join;
-    int nislands;
-    DSF *dsf = is->state->solver->dsf;
+    struct solver_state *ss = is->state->solver;
     game_state *state = is->state;
+    int g;
 
     debug(("..checking subgroups.\n"));
 
@@ -1502,10 +1634,10 @@ static bool solve_island_subgroup(struct island *is, int direction)
         }
     }
 
-    /* Check group membership for is->dsf; if it's full return 1. */
-    if (map_group_check(state, dsf_canonify(dsf, DINDEX(is->x,is->y)),
-                        false, &nislands)) {
-        if (nislands < state->n_islands) {
+    /* Check is's group; if it's full return 1. */
+    g = solver_group(ss, is - state->islands);
+    if (ss->nunfull[g] == 0) {
+        if (ss->nislands[g] < state->n_islands) {
             /* we have a full subgroup that isn't the whole set.
              * This isn't allowed. */
             debug(("island at (%d,%d) makes full subgroup, disallowing.\n",
@@ -1535,10 +1667,11 @@ static bool solve_island_impossible(game_state *state)
     return false;
 }
 
-/* Bear in mind that this function is really rather inefficient. */
+/* Bear in mind that this function is really rather inefficient.
+ * It expects the possibles to be up to date, and leaves them so. */
 static bool solve_island_stage3(struct island *is, bool *didsth_r)
 {
-    int i, n, x, y, missing, spc, curr, maxb;
+    int i, n, x, y, missing, spc, curr, maxb, mark;
     bool didsth = false;
     struct solver_state *ss = is->state->solver;
 
@@ -1561,12 +1694,12 @@ static bool solve_island_stage3(struct island *is, bool *didsth_r)
         /* Now we know that this island could have more bridges,
          * to bring the total from curr+1 to curr+spc. */
         maxb = -1;
-        /* We have to squirrel the dsf away and restore it afterwards;
-         * it is additive only, and can't be removed from. */
-        dsf_copy(ss->tmpdsf, ss->dsf);
+        /* The island groups can only be merged, not split, so we undo
+         * our changes to them afterwards. */
+        mark = ss->ntrail;
         for (n = curr+1; n <= curr+spc; n++) {
             solve_join(is, i, n, false);
-            map_update_possibles(is->state);
+            map_update_possibles_join(is, i);
 
             if (solve_island_subgroup(is, i) ||
                 solve_island_impossible(is->state)) {
@@ -1579,7 +1712,7 @@ static bool solve_island_stage3(struct island *is, bool *didsth_r)
             }
         }
         solve_join(is, i, curr, false); /* put back to before. */
-        dsf_copy(ss->dsf, ss->tmpdsf);
+        solver_undo(ss, mark);
 
         if (maxb != -1) {
             /*debug_state(is->state);*/
@@ -1592,7 +1725,7 @@ static bool solve_island_stage3(struct island *is, bool *didsth_r)
             }
             didsth = true;
         }
-        map_update_possibles(is->state);
+        map_update_possibles_join(is, i);
     }
 
     for (i = 0; i < is->adj.npoints; i++) {
@@ -1635,7 +1768,7 @@ static bool solve_island_stage3(struct island *is, bool *didsth_r)
          * a bridge.
          */
         bool got = false;
-        int before[4];
+        int before[4] = { 0 };         /* placate optimiser */
         int j;
 
         spc = island_adjspace(is, true, missing, i);
@@ -1648,7 +1781,7 @@ static bool solve_island_stage3(struct island *is, bool *didsth_r)
                                   is->adj.points[j].dx ? G_LINEH : G_LINEV);
         if (before[i] != 0) continue;  /* this idea is pointless otherwise */
 
-        dsf_copy(ss->tmpdsf, ss->dsf);
+        mark = ss->ntrail;
 
         for (j = 0; j < is->adj.npoints; j++) {
             spc = island_adjspace(is, true, missing, j);
@@ -1656,24 +1789,24 @@ static bool solve_island_stage3(struct island *is, bool *didsth_r)
             if (j == i) continue;
             solve_join(is, j, before[j] + spc, false);
         }
-        map_update_possibles(is->state);
 
+        /* (This doesn't look at the possibles, so we needn't update
+         * them for the trial, only after it if we do add a bridge.) */
         if (solve_island_subgroup(is, -1))
             got = true;
 
         for (j = 0; j < is->adj.npoints; j++)
             solve_join(is, j, before[j], false);
-        dsf_copy(ss->dsf, ss->tmpdsf);
+        solver_undo(ss, mark);
 
         if (got) {
             debug(("island at (%d,%d) must connect in direction (%d,%d) to"
                    " avoid full subgroup.\n",
                    is->x, is->y, is->adj.points[i].dx, is->adj.points[i].dy));
             solve_join(is, i, 1, false);
+            map_update_possibles_join(is, i);
             didsth = true;
         }
-
-        map_update_possibles(is->state);
     }
 
     if (didsth) *didsth_r = didsth;
@@ -1686,8 +1819,15 @@ if (GRID(state, is->x, is->y) & G_MARK) {            \
     continue;                                        \
 } } while(0)
 
-static int solve_sub(game_state *state, int difficulty, int depth)
+/*
+ * If stepped is non-NULL (for hints), stop at the first island where
+ * any stage makes a deduction, rather than going on until stuck, and
+ * set *stepped to whether there was one.
+ */
+static int solve_sub(game_state *state, int difficulty, int depth,
+                     bool *stepped)
 {
+    bool one_step = (stepped != NULL);
     struct island *is;
     int i;
 
@@ -1696,31 +1836,40 @@ static int solve_sub(game_state *state, int difficulty, int depth)
 
         /* First island iteration: things we can work out by looking at
          * properties of the island as a whole. */
-        for (i = 0; i < state->n_islands; i++) {
+        for (i = 0; i < state->n_islands && !(one_step && didsth); i++) {
             is = &state->islands[i];
             if (!solve_island_stage1(is, &didsth)) return 0;
         }
-        if (didsth) continue;
-        else if (difficulty < 1) break;
+        if (didsth) {
+            if (!one_step) continue;
+            *stepped = true;
+            break;
+        } else if (difficulty < 1) break;
 
         /* Second island iteration: thing we can work out by looking at
          * properties of individual island connections. */
-        for (i = 0; i < state->n_islands; i++) {
+        for (i = 0; i < state->n_islands && !(one_step && didsth); i++) {
             is = &state->islands[i];
             CONTINUE_IF_FULL;
             if (!solve_island_stage2(is, &didsth)) return 0;
         }
-        if (didsth) continue;
-        else if (difficulty < 2) break;
+        if (didsth) {
+            if (!one_step) continue;
+            *stepped = true;
+            break;
+        } else if (difficulty < 2) break;
 
         /* Third island iteration: things we can only work out by looking
          * at groups of islands. */
-        for (i = 0; i < state->n_islands; i++) {
+        for (i = 0; i < state->n_islands && !(one_step && didsth); i++) {
             is = &state->islands[i];
             if (!solve_island_stage3(is, &didsth)) return 0;
         }
-        if (didsth) continue;
-        else if (difficulty < 3) break;
+        if (didsth) {
+            if (!one_step) continue;
+            *stepped = true;
+            break;
+        } else if (difficulty < 3) break;
 
         /* If we can be bothered, write a recursive solver to finish here. */
         break;
@@ -1732,15 +1881,17 @@ static int solve_sub(game_state *state, int difficulty, int depth)
 static void solve_for_hint(game_state *state)
 {
     map_group(state);
-    solve_sub(state, 10, 0);
+    solver_group_islands(state);
+    solve_sub(state, 10, 0, NULL);
 }
 
 static int solve_from_scratch(game_state *state, int difficulty)
 {
     map_clear(state);
     map_group(state);
+    solver_group_islands(state);
     map_update_possibles(state);
-    return solve_sub(state, difficulty, 0);
+    return solve_sub(state, difficulty, 0, NULL);
 }
 
 /* --- New game functions --- */
@@ -1783,7 +1934,11 @@ static game_state *new_state(const game_params *params)
 
     ret->solver = snew(struct solver_state);
     ret->solver->dsf = dsf_new(wh);
-    ret->solver->tmpdsf = dsf_new(wh);
+    ret->solver->parent = snewn(wh, int);
+    ret->solver->nislands = snewn(wh, int);
+    ret->solver->nunfull = snewn(wh, int);
+    ret->solver->trail = NULL;
+    ret->solver->ntrail = ret->solver->trailsize = 0;
 
     ret->solver->refcount = 1;
 
@@ -1833,7 +1988,10 @@ static void free_game(game_state *state)
 {
     if (--state->solver->refcount <= 0) {
         dsf_free(state->solver->dsf);
-        dsf_free(state->solver->tmpdsf);
+        sfree(state->solver->parent);
+        sfree(state->solver->nislands);
+        sfree(state->solver->nunfull);
+        sfree(state->solver->trail);
         sfree(state->solver);
     }
 
@@ -2696,6 +2854,35 @@ static char *solve_game(const game_state *state, const game_state *currstate,
     return ret;
 }
 
+static char *solve_step(const game_state *state, const game_state *currstate,
+                        const char *aux, const char **error)
+{
+    char *ret = NULL;
+    game_state *solved = dup_game(currstate);
+    bool stepped;
+
+    map_group(solved);
+    solver_group_islands(solved);
+    /*
+     * Some deductions (a lower maximum number of bridges) can't be
+     * expressed as a move, so keep stepping until there's one that
+     * can, or the solver has nothing more.
+     */
+    do {
+        stepped = false;
+        solve_sub(solved, 10, 0, &stepped);
+        sfree(ret);
+        ret = game_state_diff(currstate, solved);
+    } while (stepped && !strcmp(ret, "S"));
+    free_game(solved);
+    if (!strcmp(ret, "S")) {
+        sfree(ret);
+        *error = "No further deductions found";
+        return NULL;
+    }
+    return ret;
+}
+
 /* ----------------------------------------------------------------------
  * Drawing routines.
  */
@@ -3324,7 +3511,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    solve_step,
+    NULL, /* grade */
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     get_prefs, set_prefs,
     new_ui,
@@ -11,6 +11,7 @@ set(NAME_PREFIX ""
 in a crowded bin directory, e.g. \"sgt-\"")
 
 find_package(PkgConfig REQUIRED)
+find_package(Threads REQUIRED)
 
 find_program(HALIBUT halibut)
 if(NOT HALIBUT)
@@ -39,10 +40,10 @@ endif()
 include_directories(${GTK_INCLUDE_DIRS})
 link_directories(${GTK_LIBRARY_DIRS})
 
-set(platform_common_sources gtk.c printing.c)
+set(platform_common_sources gtk.c printing.c batchgen.c threadpool.c)
 set(platform_gui_libs ${GTK_LIBRARIES})
 
-set(platform_libs -lm)
+set(platform_libs -lm Threads::Threads)
 
 set(build_icons TRUE)
 if(CMAKE_CROSSCOMPILING)
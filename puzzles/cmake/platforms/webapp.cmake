@@ -6,7 +6,7 @@
 enable_language(CXX)
 
 # (Can't include webapp.cpp in platform_common_sources -- see note below.)
-set(platform_common_sources)
+set(platform_common_sources printing.c)
 set(platform_gui_libs)
 set(platform_libs embind)
 set(CMAKE_EXECUTABLE_SUFFIX ".js")
@@ -14,6 +14,73 @@ set(CMAKE_EXECUTABLE_SUFFIX ".js")
 set(WASM ON
         CACHE BOOL "Compile to WebAssembly rather than plain JavaScript")
 
+# The SIMD flavour is built in a separate build tree, and emitted as
+# <puzzle>.simd.wasm alongside the baseline <puzzle>.wasm. The worker
+# picks it at runtime on browsers that support wasm SIMD128.
+set(WASM_SIMD OFF
+        CACHE BOOL "Build the SIMD128 + LTO flavour (<puzzle>.simd.wasm)")
+# Likewise the threads flavour, <puzzle>.threads.wasm, which runs
+# parallel_run() tasks on a pool of pthreads. That needs
+# SharedArrayBuffer, so the worker only picks it when the page is
+# cross-origin isolated (see VITE_WASM_THREADS in vite.config.ts).
+set(WASM_THREADS OFF
+        CACHE BOOL "Build the pthreads flavour (<puzzle>.threads.wasm)")
+# And the shared core flavour: one puzzles-core.wasm holding libcore and
+# webapp.cpp, plus a <puzzle>.side.wasm for each puzzle holding just its
+# own code, dynamically linked to the core at load time. Someone who
+# plays several puzzles then downloads and compiles the common code
+# once. (The worker uses it when built with VITE_WASM_SHARED_CORE.)
+set(WASM_SHARED_CORE OFF
+        CACHE BOOL "Build puzzles-core.wasm and <puzzle>.side.wasm")
+# Tracing of the midend's hot paths (see midend_set_trace_clock) is
+# compiled out unless this is on. It's not a separate flavour: a build
+# with it has Frontend.getTraceEvents return events once setTracing is
+# called, and one without always returns none.
+set(WASM_TRACING OFF
+        CACHE BOOL "Compile in midend tracing (MIDEND_TRACING)")
+# Snapshot the memory written by static initialisation into the
+# module's data segments at link time (Binaryen's wasm-ctor-eval), so
+# instantiation doesn't run it again. This stops at the first
+# constructor that calls out to JS, and isn't possible for the threads
+# or shared core flavours, which ignore it.
+set(WASM_EVAL_CTORS ON
+        CACHE BOOL "Evaluate static constructors at build time (EVAL_CTORS)")
+# Puzzles to ship packs of pregenerated games for (see puzzlepack.c),
+# with this many games for each of their presets. Generating them runs
+# every preset's generator that many times under node, so this is
+# limited to the puzzles whose hardest presets are slow.
+set(WEBAPP_PUZZLE_PACKS "galaxies;solo"
+        CACHE STRING "Puzzles to build packs of pregenerated games for")
+set(WEBAPP_PUZZLE_PACK_COUNT 20
+        CACHE STRING "Number of games per preset in each puzzle pack")
+set(wasm_flavour_suffix "")
+set(wasm_flavour_flags "")
+if(WASM_SIMD)
+    string(APPEND wasm_flavour_suffix ".simd")
+    string(APPEND wasm_flavour_flags " -msimd128 -flto -O3")
+endif()
+if(WASM_THREADS)
+    string(APPEND wasm_flavour_suffix ".threads")
+    string(APPEND wasm_flavour_flags " -pthread")
+    list(APPEND platform_common_sources threadpool.c)
+endif()
+if(WASM_EVAL_CTORS AND NOT WASM_THREADS AND NOT WASM_SHARED_CORE)
+    set(wasm_eval_ctors_flags "-sEVAL_CTORS=1")
+else()
+    set(wasm_eval_ctors_flags "")
+endif()
+if(WASM_THREADS AND MEMORY_STATS)
+    # (malloc.c's counts aren't thread-safe.)
+    message(FATAL_ERROR "MEMORY_STATS can't be combined with WASM_THREADS")
+endif()
+if(WASM_SHARED_CORE)
+    if(WASM_SIMD OR WASM_THREADS)
+        message(FATAL_ERROR "WASM_SHARED_CORE can't be combined with other flavours")
+    endif()
+    # Dynamic linking needs position-independent code throughout.
+    string(APPEND wasm_flavour_flags " -fPIC")
+endif()
+
 find_program(HALIBUT halibut)
 if(NOT HALIBUT)
     message(WARNING "HTML documentation cannot be built (did not find halibut)")
@@ -41,7 +108,11 @@ set(CMAKE_CXX_STANDARD 23)
 set(CMAKE_CXX_STANDARD_REQUIRED ON)
 set(CMAKE_CXX_EXTENSIONS OFF)
 
-set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -DNARROW_BORDERS")
+set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -DNARROW_BORDERS ${wasm_flavour_flags}")
+set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} ${wasm_flavour_flags}")
+if(WASM_TRACING)
+    add_compile_definitions(MIDEND_TRACING)
+endif()
 
 # -lexports.js prevents wasmImports name minification, which allows reusing
 # a single emcc runtime wrapper for all <puzzle>.wasm. (The linker doesn't
@@ -60,6 +131,8 @@ set(CMAKE_CXX_LINK_FLAGS "${CMAKE_CXX_LINK_FLAGS} \
 -sMODULARIZE=1 \
 -sWASM=1 \
 -sWASM_BIGINT \
+${wasm_flavour_flags} \
+${wasm_eval_ctors_flags} \
 ")
 
 set(build_cli_programs FALSE)
@@ -76,6 +149,30 @@ function(set_platform_gui_target_properties TARGET)
 endfunction()
 
 function(set_platform_puzzle_target_properties NAME TARGET)
+    if(WASM_SHARED_CORE)
+        # Build the side module instead of the standalone puzzle.
+        # (Its undefined symbols, including all of libcore's, are
+        # resolved from puzzles-core.wasm when it's loaded.)
+        set_target_properties(${TARGET} PROPERTIES EXCLUDE_FROM_ALL TRUE)
+        add_executable(${NAME}-side ${CMAKE_CURRENT_SOURCE_DIR}/${NAME}.c)
+        set_target_properties(${NAME}-side PROPERTIES
+            OUTPUT_NAME "${NAME}" SUFFIX ".side.wasm")
+        target_link_options(${NAME}-side PRIVATE -sSIDE_MODULE=1)
+        return()
+    endif()
+    if(wasm_flavour_suffix)
+        set_target_properties(${TARGET} PROPERTIES
+            OUTPUT_NAME "${NAME}${wasm_flavour_suffix}")
+    endif()
+    if(WASM_THREADS)
+        # Start threadpool.c's helpers' Web Workers up front (one per
+        # core, less the calling thread, and capped as it is). A thread
+        # whose Worker had to be loaded on demand couldn't start while
+        # the generator blocks waiting for it.
+        target_link_options(${TARGET} PRIVATE
+            "-sPTHREAD_POOL_SIZE=Math.min(navigator.hardwareConcurrency,8)-1"
+        )
+    endif()
     # Always build with source maps to allow extracting dependency licenses.
     # As of emsdk 4.0.15, -gsource-map alone does not disable optimizations,
     # so does not (significantly) increase the size of the generated wasm.
@@ -139,11 +236,86 @@ function(build_platform_extras)
     string(JSON catalog_json SET "${catalog_json}" "puzzleIds" "${puzzle_ids_arr}")
     file(WRITE ${CMAKE_CURRENT_BINARY_DIR}/catalog.json "${catalog_json}")
 
+    # Generate puzzle-metadata.json: each puzzle's static game fields,
+    # presets and config descriptions, so the app can show them without
+    # loading the puzzle's wasm. puzzlemeta is built as a plain C
+    # program (not a web module, which is why it's C-linked and so
+    # escapes CMAKE_CXX_LINK_FLAGS above), and run under node (emcmake's
+    # CMAKE_CROSSCOMPILING_EMULATOR). Only the baseline build needs it.
+    if(NOT wasm_flavour_suffix AND NOT WASM_SHARED_CORE)
+        write_generated_games_header()
+        add_executable(puzzlemeta
+            ${CMAKE_SOURCE_DIR}/puzzlemeta.c
+            ${CMAKE_SOURCE_DIR}/nullfe.c
+            ${puzzle_sources})
+        target_compile_definitions(puzzlemeta PRIVATE COMBINED)
+        target_include_directories(puzzlemeta PRIVATE ${generated_include_dir})
+        target_link_libraries(puzzlemeta common)
+        # (SINGLE_FILE keeps its wasm out of the *.wasm delivered as puzzles.)
+        target_link_options(puzzlemeta PRIVATE -sENVIRONMENT=node -sSINGLE_FILE=1)
+        add_custom_command(OUTPUT ${CMAKE_CURRENT_BINARY_DIR}/puzzle-metadata.json
+                COMMENT "Generating puzzle-metadata.json"
+                COMMAND puzzlemeta > ${CMAKE_CURRENT_BINARY_DIR}/puzzle-metadata.json
+                DEPENDS puzzlemeta)
+        add_custom_target(puzzle-metadata ALL
+                DEPENDS ${CMAKE_CURRENT_BINARY_DIR}/puzzle-metadata.json)
+
+        # Likewise puzzlepack, which writes packs/<puzzle>.pack. (It
+        # uses NODERAWFS to write the binary file directly.)
+        if(WEBAPP_PUZZLE_PACKS)
+            add_executable(puzzlepack
+                ${CMAKE_SOURCE_DIR}/puzzlepack.c
+                ${CMAKE_SOURCE_DIR}/nullfe.c
+                ${puzzle_sources})
+            target_compile_definitions(puzzlepack PRIVATE COMBINED)
+            target_compile_options(puzzlepack PRIVATE -sUSE_ZLIB=1)
+            target_include_directories(puzzlepack PRIVATE ${generated_include_dir})
+            target_link_libraries(puzzlepack common)
+            target_link_options(puzzlepack PRIVATE
+                -sENVIRONMENT=node -sSINGLE_FILE=1 -sNODERAWFS=1 -sUSE_ZLIB=1)
+            set(pack_files)
+            foreach(name ${WEBAPP_PUZZLE_PACKS})
+                set(pack_file ${CMAKE_CURRENT_BINARY_DIR}/packs/${name}.pack)
+                add_custom_command(OUTPUT ${pack_file}
+                        COMMENT "Generating packs/${name}.pack"
+                        COMMAND ${CMAKE_COMMAND} -E make_directory
+                            ${CMAKE_CURRENT_BINARY_DIR}/packs
+                        COMMAND puzzlepack --count ${WEBAPP_PUZZLE_PACK_COUNT}
+                            ${pack_file} ${name}
+                        DEPENDS puzzlepack)
+                list(APPEND pack_files ${pack_file})
+            endforeach()
+            add_custom_target(puzzle-packs ALL DEPENDS ${pack_files})
+        endif()
+    endif()
+
+    if(WASM_SHARED_CORE)
+        # The core is linked with all of libcore (and libc), whether or
+        # not any one puzzle uses it, since side modules can only import
+        # what the core exports. The puzzle itself is found at runtime
+        # (see get_game() in webapp.cpp).
+        add_executable(puzzles-core
+            ${CMAKE_SOURCE_DIR}/webapp.cpp
+            ${CMAKE_SOURCE_DIR}/printing.c
+            ${CMAKE_SOURCE_DIR}/hat.c
+            ${CMAKE_SOURCE_DIR}/spectre.c
+            $<TARGET_OBJECTS:core_obj>)
+        target_link_libraries(puzzles-core ${platform_libs})
+        target_compile_definitions(puzzles-core PRIVATE WEBAPP_SHARED_CORE)
+        target_link_options(puzzles-core PRIVATE
+            -sMAIN_MODULE=1
+            "--emit-tsd" "puzzles-core.d.ts"
+        )
+        # (dependencies.json comes from the baseline build.)
+        return()
+    endif()
+
     # Generate dependencies.json from wasm source maps
     if(JQ AND PYTHON3)
         set(puzzle_map_files)
         foreach(name ${puzzle_names})
-            list(APPEND puzzle_map_files "$<TARGET_FILE_DIR:${name}>/${name}.wasm.map")
+            list(APPEND puzzle_map_files
+                "$<TARGET_FILE_DIR:${name}>/${name}${wasm_flavour_suffix}.wasm.map")
         endforeach()
 
         add_custom_command(OUTPUT ${CMAKE_CURRENT_BINARY_DIR}/dependencies.json
@@ -14,6 +14,84 @@ if(USE_DRAW_POLYGON_FALLBACK)
   add_compile_definitions(USE_DRAW_POLYGON_FALLBACK)
 endif()
 
+# Count live and peak bytes in smalloc and friends (see memory_stats_get),
+# reported by benchgen and the web app's Frontend.getMemoryStats.
+option(MEMORY_STATS "keep memory use statistics in malloc.c" off)
+if(MEMORY_STATS)
+  add_compile_definitions(MEMORY_STATS)
+endif()
+
+# Profile-guided optimisation, in two passes over the same build
+# directory: configure with PGO=generate, build, and run a training
+# workload, which writes profile data to PGO_PROFILE; then reconfigure
+# with PGO=use and build again. pgo.sh does all of that, training on
+# the same generation and solving runs as benchmark.sh and benchsolve.
+set(PGO "" CACHE STRING
+  "profile-guided optimisation pass: 'generate', 'use', or empty")
+set(PGO_PROFILE "${CMAKE_BINARY_DIR}/pgo-profile" CACHE PATH
+  "directory for profile-guided optimisation data")
+if(PGO)
+  include(CheckCCompilerFlag)
+  if(CMAKE_C_COMPILER MATCHES "emcc")
+    # Instrumented wasm has nowhere to write its profile.
+    message(FATAL_ERROR "PGO isn't supported for Emscripten builds")
+  elseif(NOT (CMAKE_C_COMPILER_ID MATCHES "GNU" OR
+      CMAKE_C_COMPILER_ID MATCHES "Clang"))
+    message(FATAL_ERROR "PGO needs GCC or Clang")
+  endif()
+  if(PGO STREQUAL "generate")
+    # Start from a clean slate, or stale counts would be added to.
+    file(GLOB pgo_stale ${PGO_PROFILE}/*.gcda ${PGO_PROFILE}/*.profraw
+      ${PGO_PROFILE}/*.profdata)
+    if(pgo_stale)
+      file(REMOVE ${pgo_stale})
+    endif()
+    file(MAKE_DIRECTORY ${PGO_PROFILE})
+    set(pgo_flags "-fprofile-generate=${PGO_PROFILE}")
+    if(CMAKE_C_COMPILER_ID MATCHES "GNU")
+      # batchgen and the thread pool update counters from many threads.
+      set(pgo_flags "${pgo_flags} -fprofile-update=prefer-atomic")
+    endif()
+  elseif(PGO STREQUAL "use")
+    if(CMAKE_C_COMPILER_ID MATCHES "Clang")
+      # Clang wants the raw profiles from every process merged first.
+      find_program(LLVM_PROFDATA llvm-profdata)
+      if(NOT LLVM_PROFDATA)
+        message(FATAL_ERROR "PGO with Clang needs llvm-profdata")
+      endif()
+      file(GLOB pgo_raw ${PGO_PROFILE}/*.profraw)
+      if(NOT pgo_raw)
+        message(FATAL_ERROR "no profile data in ${PGO_PROFILE}")
+      endif()
+      execute_process(
+        COMMAND ${LLVM_PROFDATA} merge -o ${PGO_PROFILE}/merged.profdata
+          ${pgo_raw}
+        RESULT_VARIABLE pgo_result)
+      if(NOT pgo_result EQUAL 0)
+        message(FATAL_ERROR "llvm-profdata failed to merge ${PGO_PROFILE}")
+      endif()
+      # Functions compiled differently in different programs (e.g.
+      # with and without COMBINED) don't match their profiles.
+      set(pgo_flags "-fprofile-use=${PGO_PROFILE}/merged.profdata \
+-Wno-profile-instr-out-of-date")
+    else()
+      set(pgo_flags "-fprofile-use=${PGO_PROFILE} -Wno-missing-profile")
+      # The training workload never draws anything, so the front ends'
+      # code is untrained: don't optimise it for size as if it were
+      # never run.
+      check_c_compiler_flag(-fprofile-partial-training
+        HAVE_PROFILE_PARTIAL_TRAINING)
+      if(HAVE_PROFILE_PARTIAL_TRAINING)
+        set(pgo_flags "${pgo_flags} -fprofile-partial-training")
+      endif()
+    endif()
+  else()
+    message(FATAL_ERROR "PGO must be 'generate', 'use' or empty")
+  endif()
+  set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} ${pgo_flags}")
+  set(CMAKE_EXE_LINKER_FLAGS "${CMAKE_EXE_LINKER_FLAGS} ${pgo_flags}")
+endif()
+
 # Don't disable assertions, even in release mode.  Our assertions
 # generally aren't expensive and protect against more annoying crashes
 # and memory corruption.
@@ -164,10 +242,12 @@ function(puzzle NAME)
 endfunction()
 
 # The main function called from the top-level CMakeLists.txt to define
-# a command-line helper tool.
+# a command-line helper tool. It's linked with nullfe.c, unless
+# OWN_FRONTEND says it provides the front end functions itself (and
+# wants the real drawing.c rather than nullfe's stubs).
 function(cliprogram NAME)
   cmake_parse_arguments(OPT
-    "CORE_LIB;SDL2_LIB" "" "COMPILE_DEFINITIONS" ${ARGN})
+    "CORE_LIB;SDL2_LIB;OWN_FRONTEND" "" "COMPILE_DEFINITIONS" ${ARGN})
 
   if(OPT_CORE_LIB)
     set(lib core)
@@ -176,8 +256,12 @@ function(cliprogram NAME)
   endif()
 
   if(build_cli_programs AND ((NOT OPT_SDL2_LIB) OR BUILD_SDL_PROGRAMS))
-    add_executable(${NAME} ${PUZZLES_ROOT_DIR}/nullfe.c
-      ${OPT_UNPARSED_ARGUMENTS})
+    if(OPT_OWN_FRONTEND)
+      add_executable(${NAME} ${OPT_UNPARSED_ARGUMENTS})
+    else()
+      add_executable(${NAME} ${PUZZLES_ROOT_DIR}/nullfe.c
+        ${OPT_UNPARSED_ARGUMENTS})
+    endif()
     target_link_libraries(${NAME} ${lib} ${platform_libs})
     if(OPT_COMPILE_DEFINITIONS)
       target_compile_definitions(${NAME} PRIVATE ${OPT_COMPILE_DEFINITIONS})
@@ -71,3 +71,15 @@ void free_combi(combi_ctx *combi)
     sfree(combi->a);
     sfree(combi);
 }
+
+bool foreach_combi_mask(int r, int n, bool (*fn)(void *ctx, combi_mask set),
+                        void *ctx)
+{
+    combi_mask set;
+
+    assert(r >= 1 && r <= n && n <= COMBI_MASK_BITS);
+    for (set = first_combi_mask(r); set; set = next_combi_mask(set, n))
+        if (!fn(ctx, set))
+            return false;
+    return true;
+}
@@ -0,0 +1,139 @@
+/*
+ * cowarray.c: implement chunked copy-on-write arrays, so that a game
+ * whose moves change only a few cells of a big grid can dup its
+ * game_state without copying the whole grid.
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "puzzles.h"
+
+/*
+ * Implementation: the array is divided into chunks of COW_CHUNK
+ * elements (the last one possibly short), each of which is a
+ * separately allocated block, headed by a reference count. Duplicating the
+ * array copies only the list of chunk pointers and increments their
+ * reference counts; writing to an element first replaces its chunk
+ * with a private copy if anything else is sharing it.
+ *
+ * So the cost of dup_game for a game using these is proportional to
+ * the number of chunks rather than the number of cells, and each
+ * state kept in the undo chain costs one chunk per chunk actually
+ * modified by its move, rather than a whole grid.
+ */
+
+static int chunk_bytes(const cow_array *a, int c)
+{
+    int len = a->n - (c << COW_CHUNK_SHIFT);
+    return (len < COW_CHUNK ? len : COW_CHUNK) * a->eltsize;
+}
+
+/* Allocate a chunk with a reference count of 1 and undefined data. */
+static unsigned char *chunk_new(int bytes)
+{
+    union cow_chunk_header *header = (union cow_chunk_header *)
+        smalloc(sizeof(union cow_chunk_header) + bytes);
+    header->refcount = 1;
+    return (unsigned char *)(header + 1);
+}
+
+static void chunk_free(unsigned char *chunk)
+{
+    sfree(((union cow_chunk_header *)chunk) - 1);
+}
+
+cow_array *cow_new(int n, int eltsize)
+{
+    cow_array *a = snew(cow_array);
+    int c;
+
+    assert(n >= 0 && eltsize > 0);
+    a->n = n;
+    a->eltsize = eltsize;
+    a->nchunks = (n + COW_CHUNK - 1) >> COW_CHUNK_SHIFT;
+    a->chunks = snewn(a->nchunks, unsigned char *);
+    for (c = 0; c < a->nchunks; c++) {
+        int bytes = chunk_bytes(a, c);
+        a->chunks[c] = chunk_new(bytes);
+        memset(a->chunks[c], 0, bytes);
+    }
+    return a;
+}
+
+cow_array *cow_dup(const cow_array *a)
+{
+    cow_array *ret = snew(cow_array);
+    int c;
+
+    *ret = *a;                         /* structure copy */
+    ret->chunks = snewn(a->nchunks, unsigned char *);
+    for (c = 0; c < a->nchunks; c++) {
+        ret->chunks[c] = a->chunks[c];
+        COW_CHUNK_REFCOUNT(ret->chunks[c])++;
+    }
+    return ret;
+}
+
+void cow_free(cow_array *a)
+{
+    int c;
+
+    if (!a)
+        return;
+    for (c = 0; c < a->nchunks; c++)
+        if (--COW_CHUNK_REFCOUNT(a->chunks[c]) == 0)
+            chunk_free(a->chunks[c]);
+    sfree(a->chunks);
+    sfree(a);
+}
+
+int cow_len(const cow_array *a)
+{
+    return a->n;
+}
+
+/* Make chunk c private to a, so it can be written. */
+unsigned char *cow_unshare(cow_array *a, int c)
+{
+    unsigned char *chunk = a->chunks[c];
+
+    if (COW_CHUNK_REFCOUNT(chunk) > 1) {
+        int bytes = chunk_bytes(a, c);
+        unsigned char *copy = chunk_new(bytes);
+        memcpy(copy, chunk, bytes);
+        COW_CHUNK_REFCOUNT(chunk)--;
+        a->chunks[c] = chunk = copy;
+    }
+    return chunk;
+}
+
+void cow_read_all(const cow_array *a, void *out)
+{
+    unsigned char *p = (unsigned char *)out;
+    int c;
+
+    for (c = 0; c < a->nchunks; c++) {
+        int bytes = chunk_bytes(a, c);
+        memcpy(p, a->chunks[c], bytes);
+        p += bytes;
+    }
+}
+
+void cow_write_all(cow_array *a, const void *in)
+{
+    const unsigned char *p = (const unsigned char *)in;
+    int c;
+
+    /*
+     * Only unshare the chunks that actually change, so that (for
+     * instance) a solve move that leaves most of the grid alone still
+     * shares most of it.
+     */
+    for (c = 0; c < a->nchunks; c++) {
+        int bytes = chunk_bytes(a, c);
+        if (memcmp(a->chunks[c], p, bytes))
+            memcpy(cow_unshare(a, c), p, bytes);
+        p += bytes;
+    }
+}
@@ -184,6 +184,13 @@ struct grid_square {
     int directions[8];                 /* bit masks showing point pairs */
     bool flip;
     int tetra_class;
+
+    /*
+     * Where each orthogonal move (LEFT to DOWN) goes: the square
+     * sharing that direction's edge, or -1 if there isn't one. Filled
+     * in by find_grid_moves, not by enum_grid_squares.
+     */
+    int dest[4];
 };
 
 struct game_params {
@@ -198,11 +205,26 @@ struct game_params {
     int d1, d2;
 };
 
+struct bbox {
+    float l, r, u, d;
+};
+
 typedef struct game_grid game_grid;
 struct game_grid {
     int refcount;
+    int order, d1, d2;                 /* the params it was built for */
     struct grid_square *squares;
     int nsquares;
+    struct bbox bb;
+
+    /*
+     * For a move in each orthogonal direction from a square with each
+     * value of flip, the indices in the destination square of the two
+     * points of the edge it rolls over (see find_move_dest). Every
+     * square with the same flip is laid out the same way, so these
+     * are the same all over the grid.
+     */
+    unsigned char dkey[2][4][2];
 };
 
 #define SET_SQUARE(state, i, val) \
@@ -601,6 +623,248 @@ static const char *validate_params(const game_params *params, bool full)
     return NULL;
 }
 
+static void add_grid_square_callback(void *ctx, struct grid_square *sq)
+{
+    game_grid *grid = (game_grid *)ctx;
+
+    grid->squares[grid->nsquares++] = *sq;   /* structure copy */
+}
+
+/*
+ * Square index in a triangular grid: the rowlen(row) down-pointing
+ * triangles of each row come first, then its up-pointing ones, in
+ * order of x. Both are identified by ix, twice their x coordinate (see
+ * enum_grid_squares). Returns -1 if there's no such triangle.
+ */
+static int tri_rowlen(const game_grid *grid, int row)
+{
+    return (row < grid->d2 ? row + grid->d1 :
+            2*grid->d2 + grid->d1 - row);
+}
+
+static int tri_index(const game_grid *grid, const int *rowstart,
+                     int row, int ix, bool down)
+{
+    int n, i;
+
+    if (row < 0 || row >= grid->d1 + grid->d2)
+        return -1;
+    n = tri_rowlen(grid, row);
+    if (!down)
+        n += (row < grid->d2 ? +1 : -1);
+    i = ix + n - 1;
+    if (i < 0 || (i & 1) || i/2 >= n)
+        return -1;
+    return rowstart[row] + (down ? 0 : tri_rowlen(grid, row)) + i/2;
+}
+
+/*
+ * Fill in every square's dest table, and the grid's dkey table, so
+ * that making a move doesn't have to search the whole grid for the
+ * square on the other side of an edge.
+ */
+static void find_grid_moves(game_grid *grid)
+{
+    bool known[2][4];
+    int i, j, d;
+
+    if (grid->order == 4) {
+        for (i = 0; i < grid->nsquares; i++) {
+            struct grid_square *sq = &grid->squares[i];
+            int x = i % grid->d1, y = i / grid->d1;
+
+            sq->dest[LEFT] = (x > 0 ? i - 1 : -1);
+            sq->dest[RIGHT] = (x+1 < grid->d1 ? i + 1 : -1);
+            sq->dest[UP] = (y > 0 ? i - grid->d1 : -1);
+            sq->dest[DOWN] = (y+1 < grid->d2 ? i + grid->d1 : -1);
+        }
+    } else {
+        int nrows = grid->d1 + grid->d2, row;
+        int *rowstart = snewn(nrows, int);
+
+        for (row = i = 0; row < nrows; row++) {
+            rowstart[row] = i;
+            i += 2 * tri_rowlen(grid, row) + (row < grid->d2 ? +1 : -1);
+        }
+        assert(i == grid->nsquares);
+
+        /*
+         * A triangle's left and right neighbours are the ones of the
+         * other kind either side of it in its row; a down-pointing
+         * one's upper neighbour is the up-pointing one above it in
+         * the previous row, and vice versa.
+         */
+        for (row = 0; row < nrows; row++)
+            for (i = rowstart[row];
+                 i < (row+1 < nrows ? rowstart[row+1] : grid->nsquares);
+                 i++) {
+                struct grid_square *sq = &grid->squares[i];
+                int ix = (int)floor(sq->x * 2 + 0.5F);
+
+                sq->dest[LEFT] = tri_index(grid, rowstart, row, ix - 1,
+                                           !sq->flip);
+                sq->dest[RIGHT] = tri_index(grid, rowstart, row, ix + 1,
+                                            !sq->flip);
+                sq->dest[UP] = (sq->flip ? tri_index(
+                                    grid, rowstart, row - 1, ix, false) : -1);
+                sq->dest[DOWN] = (sq->flip ? -1 : tri_index(
+                                      grid, rowstart, row + 1, ix, true));
+            }
+        sfree(rowstart);
+    }
+
+    /*
+     * Find the indices of each edge's points in the square on the
+     * other side (in the order of that square's points), from the
+     * first square with a move in that direction.
+     */
+    memset(known, 0, sizeof(known));
+    for (i = 0; i < grid->nsquares; i++) {
+        struct grid_square *sq = &grid->squares[i];
+        for (d = LEFT; d <= DOWN; d++) {
+            int mask = sq->directions[d], match = 0, e;
+            const struct grid_square *dsq;
+            float points[4];
+
+            if (mask == 0)
+                sq->dest[d] = -1;
+            if (sq->dest[d] < 0 || known[sq->flip][d])
+                continue;
+            dsq = &grid->squares[sq->dest[d]];
+
+            for (j = e = 0; e < sq->npoints; e++)
+                if (mask & (1 << e)) {
+                    points[j*2] = sq->points[e*2];
+                    points[j*2+1] = sq->points[e*2+1];
+                    j++;
+                }
+            for (j = 0; j < dsq->npoints; j++) {
+                float dist;
+
+                dist = (SQ(dsq->points[j*2] - points[0]) +
+                        SQ(dsq->points[j*2+1] - points[1]));
+                if (dist < 0.1F)
+                    grid->dkey[sq->flip][d][match++] = j;
+                dist = (SQ(dsq->points[j*2] - points[2]) +
+                        SQ(dsq->points[j*2+1] - points[3]));
+                if (dist < 0.1F)
+                    grid->dkey[sq->flip][d][match++] = j;
+            }
+            assert(match == 2);
+            known[sq->flip][d] = true;
+        }
+    }
+}
+
+static void find_bbox_callback(void *ctx, struct grid_square *sq)
+{
+    struct bbox *bb = (struct bbox *)ctx;
+    int i;
+
+    for (i = 0; i < sq->npoints; i++) {
+        if (bb->l > sq->points[i*2]) bb->l = sq->points[i*2];
+        if (bb->r < sq->points[i*2]) bb->r = sq->points[i*2];
+        if (bb->u > sq->points[i*2+1]) bb->u = sq->points[i*2+1];
+        if (bb->d < sq->points[i*2+1]) bb->d = sq->points[i*2+1];
+    }
+}
+
+static game_grid *new_grid(const game_params *params)
+{
+    game_grid *grid = snew(game_grid);
+    int area;
+
+    grid->order = solids[params->solid]->order;
+    grid->d1 = params->d1;
+    grid->d2 = params->d2;
+    area = grid_area(params->d1, params->d2, grid->order);
+    grid->squares = snewn(area, struct grid_square);
+    grid->nsquares = 0;
+    enum_grid_squares(params, add_grid_square_callback, grid);
+    assert(grid->nsquares == area);
+    find_grid_moves(grid);
+
+    /*
+     * These should be hugely more than the real bounding box will
+     * be.
+     */
+    grid->bb.l = 2.0F * (params->d1 + params->d2);
+    grid->bb.r = -2.0F * (params->d1 + params->d2);
+    grid->bb.u = 2.0F * (params->d1 + params->d2);
+    grid->bb.d = -2.0F * (params->d1 + params->d2);
+    for (area = 0; area < grid->nsquares; area++)
+        find_bbox_callback(&grid->bb, &grid->squares[area]);
+
+    grid->refcount = 1;
+    return grid;
+}
+
+/*
+ * Cache of recently built grids, since every stage of setting up a
+ * game (generating it, sizing the window, and making the initial
+ * state) wants the same one, and building a big one takes a while.
+ * Grids depend only on the solid's order and the dimensions, and
+ * aren't changed once built. The cache holds a reference to each,
+ * most recently used first. Reference counts are shared with other
+ * threads' game states via the cache, so they're only changed under
+ * the cache lock.
+ */
+#define GRID_CACHE_SIZE 4
+
+static game_grid *grid_cache[GRID_CACHE_SIZE];
+static int grid_cache_len = 0;
+
+static void put_grid_locked(game_grid *grid)
+{
+    if (--grid->refcount <= 0) {
+        sfree(grid->squares);
+        sfree(grid);
+    }
+}
+
+/* Returns a new reference to the grid for params. */
+static game_grid *get_grid(const game_params *params)
+{
+    int order = solids[params->solid]->order, i;
+    game_grid *grid;
+
+    cache_lock();
+    for (i = 0; i < grid_cache_len; i++) {
+        grid = grid_cache[i];
+        if (grid->order == order && grid->d1 == params->d1 &&
+            grid->d2 == params->d2)
+            break;
+    }
+    if (i < grid_cache_len) {
+        grid = grid_cache[i];
+    } else {
+        /* Built with the lock held, so no other thread builds it too. */
+        grid = new_grid(params);       /* with the cache's reference */
+        if (grid_cache_len == GRID_CACHE_SIZE) {
+            /* Evict the least recently used grid. */
+            i = --grid_cache_len;
+            put_grid_locked(grid_cache[i]);
+        } else {
+            i = grid_cache_len;
+        }
+        grid_cache_len++;
+    }
+
+    /* Move the entry to the front. */
+    memmove(grid_cache + 1, grid_cache, i * sizeof(*grid_cache));
+    grid_cache[0] = grid;
+    grid->refcount++;
+    cache_unlock();
+    return grid;
+}
+
+static void put_grid(game_grid *grid)
+{
+    cache_lock();
+    put_grid_locked(grid);
+    cache_unlock();
+}
+
 struct grid_data {
     int *gridptrs[4];
     int nsquares[4];
@@ -628,6 +892,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 			   char **aux, bool interactive)
 {
     struct grid_data data;
+    game_grid *grid;
     int i, j, k, m, area, facesperclass;
     bool *flags;
     char *desc, *p;
@@ -652,7 +917,10 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 	data.nsquares[i] = 0;
     }
     data.squareindex = 0;
-    enum_grid_squares(params, classify_grid_square_callback, &data);
+    grid = get_grid(params);
+    for (i = 0; i < grid->nsquares; i++)
+        classify_grid_square_callback(&data, &grid->squares[i]);
+    put_grid(grid);
 
     facesperclass = solids[params->solid]->nfaces / data.nclasses;
 
@@ -726,13 +994,6 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     return desc;
 }
 
-static void add_grid_square_callback(void *ctx, struct grid_square *sq)
-{
-    game_grid *grid = (game_grid *)ctx;
-
-    grid->squares[grid->nsquares++] = *sq;   /* structure copy */
-}
-
 static int lowest_face(const struct solid *solid)
 {
     int i, j, best;
@@ -903,20 +1164,11 @@ static const char *validate_desc(const game_params *params, const char *desc)
 static game_state *new_game(midend *me, const game_params *params,
                             const char *desc)
 {
-    game_grid *grid = snew(game_grid);
     game_state *state = snew(game_state);
-    int area;
 
     state->params = *params;           /* structure copy */
     state->solid = solids[params->solid];
-
-    area = grid_area(params->d1, params->d2, state->solid->order);
-    grid->squares = snewn(area, struct grid_square);
-    grid->nsquares = 0;
-    enum_grid_squares(params, add_grid_square_callback, grid);
-    assert(grid->nsquares == area);
-    state->grid = grid;
-    grid->refcount = 1;
+    state->grid = get_grid(params);
 
     state->facecolours = snewn(state->solid->nfaces, int);
     memset(state->facecolours, 0, state->solid->nfaces * sizeof(int));
@@ -998,7 +1250,9 @@ static game_state *dup_game(const game_state *state)
            ret->solid->nfaces * sizeof(int));
     ret->current = state->current;
     ret->grid = state->grid;
+    cache_lock();
     ret->grid->refcount++;
+    cache_unlock();
     ret->bluemask = snewn((ret->grid->nsquares + 31) / 32, unsigned long);
     memcpy(ret->bluemask, state->bluemask, (ret->grid->nsquares + 31) / 32 *
 	   sizeof(unsigned long));
@@ -1020,10 +1274,7 @@ static game_state *dup_game(const game_state *state)
 
 static void free_game(game_state *state)
 {
-    if (--state->grid->refcount <= 0) {
-	sfree(state->grid->squares);
-	sfree(state->grid);
-    }
+    put_grid(state->grid);
     sfree(state->bluemask);
     sfree(state->facecolours);
     sfree(state);
@@ -1054,51 +1305,31 @@ struct game_drawstate {
 static int find_move_dest(const game_state *from, int direction,
 			  int *skey, int *dkey)
 {
+    const struct grid_square *sq = &from->grid->squares[from->current];
     int mask, dest, i, j;
-    float points[4];
 
     /*
      * Find the two points in the current grid square which
      * correspond to this move.
      */
-    mask = from->grid->squares[from->current].directions[direction];
+    assert(direction <= DOWN);
+    mask = sq->directions[direction];
     if (mask == 0)
         return -1;
-    for (i = j = 0; i < from->grid->squares[from->current].npoints; i++)
-        if (mask & (1 << i)) {
-            points[j*2] = from->grid->squares[from->current].points[i*2];
-            points[j*2+1] = from->grid->squares[from->current].points[i*2+1];
-            skey[j] = i;
-            j++;
-        }
+    for (i = j = 0; i < sq->npoints; i++)
+        if (mask & (1 << i))
+            skey[j++] = i;
     assert(j == 2);
 
     /*
-     * Now find the other grid square which shares those points.
-     * This is our move destination.
+     * The other grid square which shares those points, and where
+     * they are in it, were worked out when the grid was built.
      */
-    dest = -1;
-    for (i = 0; i < from->grid->nsquares; i++)
-        if (i != from->current) {
-            int match = 0;
-            float dist;
-
-            for (j = 0; j < from->grid->squares[i].npoints; j++) {
-                dist = (SQ(from->grid->squares[i].points[j*2] - points[0]) +
-                        SQ(from->grid->squares[i].points[j*2+1] - points[1]));
-                if (dist < 0.1F)
-                    dkey[match++] = j;
-                dist = (SQ(from->grid->squares[i].points[j*2] - points[2]) +
-                        SQ(from->grid->squares[i].points[j*2+1] - points[3]));
-                if (dist < 0.1F)
-                    dkey[match++] = j;
-            }
-
-            if (match == 2) {
-                dest = i;
-                break;
-            }
-        }
+    dest = sq->dest[direction];
+    if (dest >= 0) {
+        dkey[0] = from->grid->dkey[sq->flip][direction][0];
+        dkey[1] = from->grid->dkey[sq->flip][direction][1];
+    }
 
     return dest;
 }
@@ -1449,37 +1680,12 @@ static game_state *execute_move(const game_state *from, const char *move)
  * Drawing routines.
  */
 
-struct bbox {
-    float l, r, u, d;
-};
-
-static void find_bbox_callback(void *ctx, struct grid_square *sq)
-{
-    struct bbox *bb = (struct bbox *)ctx;
-    int i;
-
-    for (i = 0; i < sq->npoints; i++) {
-        if (bb->l > sq->points[i*2]) bb->l = sq->points[i*2];
-        if (bb->r < sq->points[i*2]) bb->r = sq->points[i*2];
-        if (bb->u > sq->points[i*2+1]) bb->u = sq->points[i*2+1];
-        if (bb->d < sq->points[i*2+1]) bb->d = sq->points[i*2+1];
-    }
-}
-
 static struct bbox find_bbox(const game_params *params)
 {
-    struct bbox bb;
-
-    /*
-     * These should be hugely more than the real bounding box will
-     * be.
-     */
-    bb.l = 2.0F * (params->d1 + params->d2);
-    bb.r = -2.0F * (params->d1 + params->d2);
-    bb.u = 2.0F * (params->d1 + params->d2);
-    bb.d = -2.0F * (params->d1 + params->d2);
-    enum_grid_squares(params, find_bbox_callback, &bb);
+    game_grid *grid = get_grid(params);
+    struct bbox bb = grid->bb;
 
+    put_grid(grid);
     return bb;
 }
 
@@ -1759,7 +1965,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     false, NULL, /* solve */
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
@@ -249,6 +249,77 @@ static bool addremcommon(int w, int h, int x, int y, int *own, int val)
     return (count == 2);
 }
 
+/*
+ * Work out whether the square yx can safely be added to, or removed
+ * from, each omino. We don't take account of other ominoes in this
+ * process, so we will often end up knowing that a square can be
+ * poached from one omino by another.
+ *
+ * For each square, there may be up to four ominoes to which it can
+ * be added (those to which it is 4-adjacent).
+ *
+ * Both answers depend only on the ownership of the 3x3 block centred
+ * on yx, plus the size of yx's own omino. So when ownership changes,
+ * only the squares around the changed ones need recomputing.
+ */
+static void find_addrem(int w, int h, int yx, int *own, const int *sizes,
+                        bool *removable, int *addable)
+{
+    int x = yx % w, y = yx / w;
+    int curr = own[yx];
+    int dir;
+
+    if (curr < 0) {
+        removable[yx] = false;         /* can't remove if not owned! */
+    } else if (sizes[curr] == 1) {
+        removable[yx] = true;          /* can always remove a singleton */
+    } else {
+        /*
+         * See if this square can be removed from its omino without
+         * disconnecting it.
+         */
+        removable[yx] = addremcommon(w, h, x, y, own, curr);
+    }
+
+    for (dir = 0; dir < 4; dir++) {
+        int dx = (dir == 0 ? -1 : dir == 1 ? +1 : 0);
+        int dy = (dir == 2 ? -1 : dir == 3 ? +1 : 0);
+        int sx = x + dx, sy = y + dy;
+        int syx = sy*w+sx;
+
+        addable[yx*4+dir] = -1;
+
+        if (sx < 0 || sx >= w || sy < 0 || sy >= h)
+            continue;                  /* no omino here! */
+        if (own[syx] < 0)
+            continue;                  /* also no omino here */
+        if (own[syx] == own[yx])
+            continue;                  /* we already got one */
+        if (!addremcommon(w, h, x, y, own, own[syx]))
+            continue;                  /* would non-simply connect the omino */
+
+        addable[yx*4+dir] = own[syx];
+    }
+}
+
+/*
+ * Determine whether square yx can be added to omino j in the current
+ * state of the grid, given that it could be at the top of the loop
+ * in divvy_rectangle_attempt. The only thing that can have changed
+ * since then is that j may have had a square temporarily taken away,
+ * so it's only necessary to re-check addremcommon.
+ */
+static bool still_addable(int w, int h, int yx, int *own,
+                          const int *addable, int j)
+{
+    int dir;
+
+    for (dir = 0; dir < 4; dir++)
+        if (addable[yx*4+dir] == j)
+            return addremcommon(w, h, yx%w, yx/w, own, j);
+    return false;
+}
+
 /*
  * w and h are the dimensions of the rectangle.
  * 
@@ -262,22 +333,29 @@ static bool addremcommon(int w, int h, int x, int y, int *own, int val)
  */
 DSF *divvy_rectangle_attempt(int w, int h, int k, random_state *rs)
 {
-    int *order, *queue, *tmp, *own, *sizes, *addable;
+    int *order, *pos, *queue, *tmp, *own, *sizes, *addable;
+    int *members, *memberidx, *cands, *seen, *changed;
     DSF *retdsf, *tmpdsf;
     bool *removable;
     int wh = w*h;
-    int i, j, n, x, y, qhead, qtail;
+    int i, j, n, x, y, qhead, qtail, firstfree, ncands, nchanged, stamp;
 
     n = wh / k;
     assert(wh == k*n);
 
     order = snewn(wh, int);
+    pos = snewn(wh, int);
     tmp = snewn(wh, int);
     own = snewn(wh, int);
     sizes = snewn(n, int);
     queue = snewn(n, int);
     addable = snewn(wh*4, int);
     removable = snewn(wh, bool);
+    members = snewn(n*(k+1), int);
+    memberidx = snewn(wh, int);
+    cands = snewn(4*(k+1), int);
+    seen = snewn(wh, int);
+    changed = snewn(n+1, int);
     retdsf = tmpdsf = NULL;
 
     /*
@@ -285,22 +363,43 @@ DSF *divvy_rectangle_attempt(int w, int h, int k, random_state *rs)
      * used for iterating over the grid whenever we need to search
      * for something. This prevents directional bias and arranges
      * for the answer to be non-deterministic.
+     *
+     * pos[] is the inverse permutation. We only ever need to search
+     * the squares next to one particular omino, so rather than
+     * scanning the whole grid in this order, we collect those
+     * squares and sort them by their position in it.
      */
     for (i = 0; i < wh; i++)
 	order[i] = i;
     shuffle(order, wh, sizeof(*order), rs);
+    for (i = 0; i < wh; i++)
+        pos[order[i]] = i;
 
     /*
      * Begin by choosing a starting square at random for each
      * omino.
+     *
+     * members[j*(k+1) + ...] lists the sizes[j] squares of omino j,
+     * and memberidx[] gives each owned square's index in that list.
+     * (There's room for k+1 members, because while we're shuffling
+     * squares along a chain of ominoes one of them can briefly hold
+     * an extra square.)
      */
     for (i = 0; i < wh; i++) {
 	own[i] = -1;
+        seen[i] = 0;
     }
     for (i = 0; i < n; i++) {
 	own[order[i]] = i;
 	sizes[i] = 1;
+        members[i*(k+1)] = order[i];
+        memberidx[order[i]] = 0;
     }
+    firstfree = n;
+    stamp = 0;
+
+    for (i = 0; i < wh; i++)
+        find_addrem(w, h, i, own, sizes, removable, addable);
 
     /*
      * Now repeatedly pick a random omino which isn't already at
@@ -326,57 +425,6 @@ DSF *divvy_rectangle_attempt(int w, int h, int k, random_state *rs)
 	}
 #endif
 
-	/*
-	 * Go over the grid and figure out which squares can
-	 * safely be added to, or removed from, each omino. We
-	 * don't take account of other ominoes in this process, so
-	 * we will often end up knowing that a square can be
-	 * poached from one omino by another.
-	 * 
-	 * For each square, there may be up to four ominoes to
-	 * which it can be added (those to which it is
-	 * 4-adjacent).
-	 */
-	for (y = 0; y < h; y++) {
-	    for (x = 0; x < w; x++) {
-		int yx = y*w+x;
-		int curr = own[yx];
-		int dir;
-
-		if (curr < 0) {
-		    removable[yx] = false; /* can't remove if not owned! */
-		} else if (sizes[curr] == 1) {
-		    removable[yx] = true; /* can always remove a singleton */
-		} else {
-		    /*
-		     * See if this square can be removed from its
-		     * omino without disconnecting it.
-		     */
-		    removable[yx] = addremcommon(w, h, x, y, own, curr);
-		}
-
-		for (dir = 0; dir < 4; dir++) {
-		    int dx = (dir == 0 ? -1 : dir == 1 ? +1 : 0);
-		    int dy = (dir == 2 ? -1 : dir == 3 ? +1 : 0);
-		    int sx = x + dx, sy = y + dy;
-		    int syx = sy*w+sx;
-
-		    addable[yx*4+dir] = -1;
-
-		    if (sx < 0 || sx >= w || sy < 0 || sy >= h)
-			continue;      /* no omino here! */
-		    if (own[syx] < 0)
-			continue;      /* also no omino here */
-		    if (own[syx] == own[yx])
-			continue;      /* we already got one */
-		    if (!addremcommon(w, h, x, y, own, own[syx]))
-			continue;      /* would non-simply connect the omino */
-		    
-		    addable[yx*4+dir] = own[syx];
-		}
-	    }
-	}
-
 	for (i = j = 0; i < n; i++)
 	    if (sizes[i] < k)
 		tmp[j++] = i;
@@ -411,10 +459,34 @@ DSF *divvy_rectangle_attempt(int w, int h, int k, random_state *rs)
 	tmp[2*j] = tmp[2*j+1] = -2;    /* special value: `starting point' */
 
 	while (qhead < qtail) {
-	    int tmpsq;
+	    int tmpsq, c, found;
 
 	    j = queue[qhead];
 
+            /*
+             * Any square we could add to omino j must be 4-adjacent
+             * to one of its squares. Collect all of those, and sort
+             * them into the order in which we want to try them.
+             */
+            stamp++;
+            ncands = 0;
+            for (i = 0; i < sizes[j]; i++) {
+                int m = members[j*(k+1)+i], dir;
+
+                for (dir = 0; dir < 4; dir++) {
+                    int sx = m%w + (dir == 0 ? -1 : dir == 1 ? +1 : 0);
+                    int sy = m/w + (dir == 2 ? -1 : dir == 3 ? +1 : 0);
+
+                    if (sx < 0 || sx >= w || sy < 0 || sy >= h)
+                        continue;
+                    if (seen[sy*w+sx] == stamp)
+                        continue;
+                    seen[sy*w+sx] = stamp;
+                    cands[ncands++] = pos[sy*w+sx];
+                }
+            }
+            sort_integers(cands, ncands);
+
 	    /*
 	     * We wish to expand omino j. However, we might have
 	     * got here by omino j having a square stolen from it,
@@ -433,48 +505,35 @@ DSF *divvy_rectangle_attempt(int w, int h, int k, random_state *rs)
 	     * unclaimed square into which we can expand omino j.
 	     * If we find one, the entire bfs terminates.
 	     */
-	    for (i = 0; i < wh; i++) {
-		int dir;
-
-		if (own[order[i]] != -1)
-		    continue;	       /* this square is claimed */
-
-		/*
-		 * Special case: if our current omino was size 1
-		 * and then had a square stolen from it, it's now
-		 * size zero, which means it's valid to `expand'
-		 * it into _any_ unclaimed square.
-		 */
-		if (sizes[j] == 1 && tmpsq >= 0)
-		    break;	       /* got one */
-
-		/*
-		 * Failing that, we must do the full test for
-		 * addability.
-		 */
-		for (dir = 0; dir < 4; dir++)
-		    if (addable[order[i]*4+dir] == j) {
-			/*
-			 * We know this square is addable to this
-			 * omino with the grid in the state it had
-			 * at the top of the loop. However, we
-			 * must now check that it's _still_
-			 * addable to this omino when the omino is
-			 * missing a square. To do this it's only
-			 * necessary to re-check addremcommon.
-			 */
-			if (!addremcommon(w, h, order[i]%w, order[i]/w,
-					  own, j))
-			    continue;
-			break;
-		    }
-		if (dir == 4)
-		    continue;	       /* we can't add this square to j */
-
-		break;		       /* got one! */
-	    }
-	    if (i < wh) {
-		i = order[i];
+            found = -1;
+            if (sizes[j] == 1 && tmpsq >= 0) {
+                /*
+                 * Special case: if our current omino was size 1
+                 * and then had a square stolen from it, it's now
+                 * size zero, which means it's valid to `expand'
+                 * it into _any_ unclaimed square. Squares never
+                 * become unclaimed again once claimed, so the first
+                 * one in order can be found by advancing a cursor.
+                 */
+                while (own[order[firstfree]] != -1)
+                    firstfree++;
+                found = order[firstfree];
+            } else {
+                /*
+                 * Failing that, we must do the full test for
+                 * addability.
+                 */
+                for (c = 0; c < ncands; c++) {
+                    i = order[cands[c]];
+                    if (own[i] == -1 && still_addable(w, h, i, own,
+                                                      addable, j)) {
+                        found = i;
+                        break;
+                    }
+                }
+            }
+	    if (found >= 0) {
+		i = found;
 
 		/*
 		 * Restore the temporarily removed square _before_
@@ -492,8 +551,25 @@ DSF *divvy_rectangle_attempt(int w, int h, int k, random_state *rs)
 #ifdef DIVVY_DIAGNOSTICS
 		printf("(%d,%d)", i%w, i/w);
 #endif
+                nchanged = 0;
 		while (1) {
+                    int old = own[i];
+
+                    /*
+                     * Move square i out of its old omino's member
+                     * list (swapping the last member into its
+                     * place) and into j's.
+                     */
+                    if (old >= 0) {
+                        int last = members[old*(k+1) + --sizes[old]];
+                        members[old*(k+1) + memberidx[i]] = last;
+                        memberidx[last] = memberidx[i];
+                    }
+                    memberidx[i] = sizes[j];
+                    members[j*(k+1) + sizes[j]++] = i;
+
 		    own[i] = j;
+                    changed[nchanged++] = i;
 #ifdef DIVVY_DIAGNOSTICS
 		    printf(" -> %d", j);
 #endif
@@ -510,9 +586,33 @@ DSF *divvy_rectangle_attempt(int w, int h, int k, random_state *rs)
 #endif
 
 		/*
-		 * Increment the size of the starting omino.
+		 * The member list updates above have already
+		 * incremented the size of the starting omino, and
+		 * left every other omino the size it was. So all
+		 * that's left is to update the addability and
+		 * removability of everything near a square that
+		 * changed hands. (That covers the starting omino's
+		 * other square if it's just grown out of being a
+		 * singleton, since it must be adjacent to the new
+		 * one.)
 		 */
-		sizes[j]++;
+                stamp++;
+                for (c = 0; c < nchanged; c++) {
+                    int dx, dy;
+                    x = changed[c] % w;
+                    y = changed[c] / w;
+                    for (dy = -1; dy <= +1; dy++)
+                        for (dx = -1; dx <= +1; dx++) {
+                            int sx = x+dx, sy = y+dy;
+                            if (sx < 0 || sx >= w || sy < 0 || sy >= h)
+                                continue;
+                            if (seen[sy*w+sx] == stamp)
+                                continue;
+                            seen[sy*w+sx] = stamp;
+                            find_addrem(w, h, sy*w+sx, own, sizes,
+                                        removable, addable);
+                        }
+                }
 
 		/*
 		 * Terminate the bfs loop.
@@ -526,42 +626,28 @@ DSF *divvy_rectangle_attempt(int w, int h, int k, random_state *rs)
 	     * to investigate expanding it into squares which are
 	     * claimed by ominoes the bfs has not yet visited.
 	     */
-	    for (i = 0; i < wh; i++) {
-		int dir, nj;
+	    for (c = 0; c < ncands; c++) {
+		int nj;
 
-		nj = own[order[i]];
+                i = order[cands[c]];
+		nj = own[i];
 		if (nj < 0 || tmp[2*nj] != -1)
 		    continue;	       /* unclaimed, or owned by wrong omino */
-		if (!removable[order[i]])
+		if (!removable[i])
 		    continue;	       /* its omino won't let it go */
-
-		for (dir = 0; dir < 4; dir++)
-		    if (addable[order[i]*4+dir] == j) {
-			/*
-			 * As above, re-check addremcommon.
-			 */
-			if (!addremcommon(w, h, order[i]%w, order[i]/w,
-					  own, j))
-			    continue;
-
-			/*
-			 * We have found a square we can use to
-			 * expand omino j, at the expense of the
-			 * as-yet unvisited omino nj. So add this
-			 * to the bfs queue.
-			 */
-			assert(qtail < n);
-			queue[qtail++] = nj;
-			tmp[2*nj] = j;
-			tmp[2*nj+1] = order[i];
-
-			/*
-			 * Now terminate the loop over dir, to
-			 * ensure we don't accidentally add the
-			 * same omino twice to the queue.
-			 */
-			break;
-		    }
+                if (!still_addable(w, h, i, own, addable, j))
+                    continue;          /* we can't add this square to j */
+
+                /*
+                 * We have found a square we can use to expand omino
+                 * j, at the expense of the as-yet unvisited omino
+                 * nj. So add this to the bfs queue. (Setting tmp
+                 * for nj ensures we won't add it twice.)
+                 */
+                assert(qtail < n);
+                queue[qtail++] = nj;
+                tmp[2*nj] = j;
+                tmp[2*nj+1] = i;
 	    }
 
 	    /*
@@ -641,6 +727,7 @@ DSF *divvy_rectangle_attempt(int w, int h, int k, random_state *rs)
      * Free our temporary working space.
      */
     sfree(order);
+    sfree(pos);
     sfree(tmp);
     dsf_free(tmpdsf);
     sfree(own);
@@ -648,6 +735,11 @@ DSF *divvy_rectangle_attempt(int w, int h, int k, random_state *rs)
     sfree(queue);
     sfree(addable);
     sfree(removable);
+    sfree(members);
+    sfree(memberidx);
+    sfree(cands);
+    sfree(seen);
+    sfree(changed);
 
     /*
      * And we're done.
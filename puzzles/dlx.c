@@ -0,0 +1,237 @@
+/*
+ * Implementation of dlx.h.
+ *
+ * The matrix is the usual one of doubly linked lists of nodes, kept
+ * in arrays and linked by index. Node 0 is the root, nodes 1 to ncols
+ * are the column headers, and the rest are the 1s of the matrix. The
+ * search is iterative rather than recursive, since its depth can be
+ * as much as the number of columns, which for large puzzles is more
+ * than is comfortable on a small stack.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "puzzles.h"
+#include "dlx.h"
+
+struct dlx {
+    int ncols, nnodes, maxnodes;
+    int *L, *R, *U, *D;                /* links */
+    int *C;                            /* column header of each node */
+    int *size;                         /* nodes in each column, by header */
+    bool *covered;                     /* by header */
+
+    int nrows, rowsize;
+    int *rowstart;                     /* first node of each row */
+
+    int *choice;                       /* search stack */
+};
+
+dlx *dlx_new(int ncols, int maxnodes)
+{
+    dlx *d = snew(dlx);
+    int total = 1 + ncols + maxnodes, i;
+
+    d->ncols = ncols;
+    d->nnodes = 1 + ncols;
+    d->maxnodes = total;
+    d->L = snewn(total, int);
+    d->R = snewn(total, int);
+    d->U = snewn(total, int);
+    d->D = snewn(total, int);
+    d->C = snewn(total, int);
+    d->size = snewn(1 + ncols, int);
+    d->covered = snewn(1 + ncols, bool);
+
+    for (i = 0; i <= ncols; i++) {
+        d->L[i] = (i == 0 ? ncols : i - 1);
+        d->R[i] = (i == ncols ? 0 : i + 1);
+        d->U[i] = d->D[i] = d->C[i] = i;
+        d->size[i] = 0;
+        d->covered[i] = false;
+    }
+
+    d->nrows = d->rowsize = 0;
+    d->rowstart = NULL;
+    d->choice = snewn(ncols + 1, int);
+    return d;
+}
+
+void dlx_free(dlx *d)
+{
+    sfree(d->L);
+    sfree(d->R);
+    sfree(d->U);
+    sfree(d->D);
+    sfree(d->C);
+    sfree(d->size);
+    sfree(d->covered);
+    sfree(d->rowstart);
+    sfree(d->choice);
+    sfree(d);
+}
+
+void dlx_add_row(dlx *d, const int *cols, int n)
+{
+    int first = d->nnodes, i;
+
+    assert(n > 0);
+    assert(d->nnodes + n <= d->maxnodes);
+
+    if (d->nrows >= d->rowsize) {
+        d->rowsize = d->nrows * 5 / 4 + 64;
+        d->rowstart = sresize(d->rowstart, d->rowsize, int);
+    }
+    d->rowstart[d->nrows++] = first;
+
+    for (i = 0; i < n; i++) {
+        int node = d->nnodes++, c = cols[i] + 1;
+
+        assert(cols[i] >= 0 && cols[i] < d->ncols);
+
+        /* Append to the bottom of column c */
+        d->C[node] = c;
+        d->U[node] = d->U[c];
+        d->D[node] = c;
+        d->D[d->U[c]] = node;
+        d->U[c] = node;
+        d->size[c]++;
+
+        /* And to the end of the row */
+        d->L[node] = (i == 0 ? node : node - 1);
+        d->R[node] = first;
+        d->R[d->L[node]] = node;
+        d->L[first] = node;
+    }
+}
+
+/* Remove column c, and every row that covers it from the other columns. */
+static void dlx_cover(dlx *d, int c)
+{
+    int i, j;
+
+    d->R[d->L[c]] = d->R[c];
+    d->L[d->R[c]] = d->L[c];
+    d->covered[c] = true;
+    for (i = d->D[c]; i != c; i = d->D[i])
+        for (j = d->R[i]; j != i; j = d->R[j]) {
+            d->D[d->U[j]] = d->D[j];
+            d->U[d->D[j]] = d->U[j];
+            d->size[d->C[j]]--;
+        }
+}
+
+/* Exactly undo dlx_cover(d, c), which must be the most recent. */
+static void dlx_uncover(dlx *d, int c)
+{
+    int i, j;
+
+    for (i = d->U[c]; i != c; i = d->U[i])
+        for (j = d->L[i]; j != i; j = d->L[j]) {
+            d->size[d->C[j]]++;
+            d->D[d->U[j]] = j;
+            d->U[d->D[j]] = j;
+        }
+    d->covered[c] = false;
+    d->R[d->L[c]] = c;
+    d->L[d->R[c]] = c;
+}
+
+/* Cover every column of the row containing node r, starting with r's. */
+static void dlx_select(dlx *d, int r)
+{
+    int j = r;
+    do {
+        dlx_cover(d, d->C[j]);
+        j = d->R[j];
+    } while (j != r);
+}
+
+static void dlx_unselect(dlx *d, int r)
+{
+    int j = r;
+    do {
+        j = d->L[j];
+        dlx_uncover(d, d->C[j]);
+    } while (j != r);
+}
+
+int dlx_count(dlx *d, const int *given, int ngiven, int limit)
+{
+    int count = 0, level = 0, ngot, c, r, j;
+
+    /*
+     * Select the given rows, unless one of them covers a column
+     * already covered by another.
+     */
+    for (ngot = 0; ngot < ngiven; ngot++) {
+        r = d->rowstart[given[ngot]];
+        j = r;
+        do {
+            if (d->covered[d->C[j]])
+                goto unselect;
+            j = d->R[j];
+        } while (j != r);
+        dlx_select(d, r);
+    }
+
+    /*
+     * Now the search proper. choice[k] is the row (or rather, its
+     * node in the column chosen at level k) currently being tried at
+     * depth k of the search; once it's back round to the column
+     * header, every row in that column has been tried.
+     */
+  forward:
+    if (d->R[0] == 0) {
+        /* Every column is covered: a solution. */
+        if (++count >= limit)
+            goto unwind;
+        goto backup;
+    }
+
+    /* Branch on the column with fewest rows. */
+    c = d->R[0];
+    for (j = d->R[c]; j != 0; j = d->R[j])
+        if (d->size[j] < d->size[c])
+            c = j;
+    dlx_cover(d, c);
+    d->choice[level] = d->D[c];
+
+  tryrow:
+    r = d->choice[level];
+    if (r == d->C[r]) {
+        /* Back at the header: this column is exhausted. */
+        dlx_uncover(d, r);
+        goto backup;
+    }
+    for (j = d->R[r]; j != r; j = d->R[j])
+        dlx_cover(d, d->C[j]);
+    level++;
+    goto forward;
+
+  backup:
+    if (level == 0)
+        goto unselect;
+    level--;
+    r = d->choice[level];
+    for (j = d->L[r]; j != r; j = d->L[j])
+        dlx_uncover(d, d->C[j]);
+    d->choice[level] = d->D[r];
+    goto tryrow;
+
+  unwind:
+    /* Stopping early: undo the rows and columns chosen so far. */
+    while (level > 0) {
+        level--;
+        r = d->choice[level];
+        for (j = d->L[r]; j != r; j = d->L[j])
+            dlx_uncover(d, d->C[j]);
+        dlx_uncover(d, d->C[r]);
+    }
+
+  unselect:
+    while (ngot > 0)
+        dlx_unselect(d, d->rowstart[given[--ngot]]);
+    return count;
+}
@@ -0,0 +1,41 @@
+/*
+ * Exact cover, by Knuth's Algorithm X with dancing links, for
+ * counting the solutions of puzzles whose rules all take the form
+ * 'exactly one of these options'.
+ *
+ * The problem is a set of columns (the constraints) and a set of
+ * rows (the options), each row covering some columns. A solution is
+ * a set of rows covering every column exactly once.
+ */
+
+#ifndef PUZZLES_DLX_H
+#define PUZZLES_DLX_H
+
+typedef struct dlx dlx;
+
+/*
+ * Create an exact cover problem with 'ncols' columns, numbered from 0,
+ * and no rows. 'maxnodes' is the total number of (row, column) pairs
+ * that will be added by dlx_add_row.
+ */
+dlx *dlx_new(int ncols, int maxnodes);
+void dlx_free(dlx *d);
+
+/*
+ * Add a row covering the 'n' columns in 'cols'. Rows are numbered
+ * from 0 in the order they're added.
+ */
+void dlx_add_row(dlx *d, const int *cols, int n);
+
+/*
+ * Count the solutions that include all 'ngiven' rows in 'given',
+ * stopping as soon as there are 'limit' of them. (So to find out if
+ * there's exactly one solution, pass a limit of 2.) Returns 0 if the
+ * given rows overlap.
+ *
+ * The problem is left as it was, so this can be called repeatedly
+ * with different given rows.
+ */
+int dlx_count(dlx *d, const int *given, int ngiven, int limit);
+
+#endif /* PUZZLES_DLX_H */
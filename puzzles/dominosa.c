@@ -352,6 +352,10 @@ struct solver_scratch {
     bool squares_by_number_initialised;
     int *wh_scratch, *pc_scratch, *pc_scratch2, *dc_scratch;
     DSF *dsf_scratch;
+
+    /* Per-subset tables for deduce_set, indexed by bitmap of squares */
+    unsigned long *set_dominoes, *set_adjacent;
+    int setsize;
 };
 
 static struct solver_scratch *solver_make_scratch(int n)
@@ -484,6 +488,8 @@ static struct solver_scratch *solver_make_scratch(int n)
     sc->pc_scratch = sc->pc_scratch2 = NULL;
     sc->dc_scratch = NULL;
     sc->dsf_scratch = NULL;
+    sc->set_dominoes = sc->set_adjacent = NULL;
+    sc->setsize = 0;
 
     return sc;
 }
@@ -512,6 +518,8 @@ static void solver_free_scratch(struct solver_scratch *sc)
     sfree(sc->pc_scratch2);
     sfree(sc->dc_scratch);
     dsf_free(sc->dsf_scratch);
+    sfree(sc->set_dominoes);
+    sfree(sc->set_adjacent);
     sfree(sc);
 }
 
@@ -1025,6 +1033,14 @@ static bool deduce_parity(struct solver_scratch *sc)
  * is small enough to let us rule out placements of those dominoes
  * elsewhere.
  */
+static int bitcount(unsigned long word)
+{
+    int count = 0;
+    for (; word; word &= word - 1)
+        count++;
+    return count;
+}
+
 static bool deduce_set(struct solver_scratch *sc, bool doubles)
 {
     struct solver_square **sqs, **sqp, **sqe;
@@ -1048,6 +1064,7 @@ static bool deduce_set(struct solver_scratch *sc, bool doubles)
             sc->squares_by_number[i] = &sc->squares[i];
         qsort(sc->squares_by_number, sc->wh, sizeof(*sc->squares_by_number),
               squares_by_number_cmpfn);
+        sc->squares_by_number_initialised = true;
     }
 
     sqp = sc->squares_by_number;
@@ -1133,12 +1150,36 @@ static bool deduce_set(struct solver_scratch *sc, bool doubles)
 
         }
 
+        /*
+         * Tabulate, for every subset of the squares, the union of
+         * their domino sets and of their adjacent[] masks, each from
+         * the subset without its lowest square.
+         */
+        if (sc->setsize < (1 << nsq)) {
+            sc->setsize = 1 << nsq;
+            sc->set_dominoes = sresize(sc->set_dominoes, sc->setsize,
+                                       unsigned long);
+            sc->set_adjacent = sresize(sc->set_adjacent, sc->setsize,
+                                       unsigned long);
+        }
+        sc->set_dominoes[0] = sc->set_adjacent[0] = 0;
+        for (squares = 1; squares < (1UL << nsq); squares++) {
+            unsigned long rest = squares & (squares - 1);
+            int bitpos = 0;
+            while (!(1 & ((squares ^ rest) >> bitpos)))
+                bitpos++;
+            sc->set_dominoes[squares] =
+                sc->set_dominoes[rest] | domino_sets[bitpos];
+            sc->set_adjacent[squares] =
+                sc->set_adjacent[rest] | adjacent[bitpos];
+        }
+
         squares_done = 0;
 
         for (squares = 0; squares < (1UL << nsq); squares++) {
-            unsigned long dominoes = 0;
+            unsigned long dominoes;
             int bitpos, nsquares, ndominoes;
-            bool got_adj_squares = false;
+            bool got_adj_squares;
             bool reported = false;
             bool rule_out_nondoubles;
             int min_nused_for_double;
@@ -1163,24 +1204,12 @@ static bool deduce_set(struct solver_scratch *sc, bool doubles)
             if (squares & squares_done)
                 continue;
 
-            nsquares = 0;
-
-            /* Make the set of dominoes that these squares can inhabit. */
-            for (bitpos = 0; bitpos < nsq; bitpos++) {
-                if (!(1 & (squares >> bitpos)))
-                    continue;          /* this bit isn't set in the mask */
-
-                if (adjacent[bitpos] & squares)
-                    got_adj_squares = true;
-
-                dominoes |= domino_sets[bitpos];
-                nsquares++;
-            }
-
-            /* Count them. */
-            ndominoes = 0;
-            for (bitpos = 0; bitpos < nsq; bitpos++)
-                ndominoes += 1 & (dominoes >> bitpos);
+            /* Find the set of dominoes that these squares can inhabit,
+             * and count them. */
+            dominoes = sc->set_dominoes[squares];
+            got_adj_squares = (sc->set_adjacent[squares] & squares) != 0;
+            nsquares = bitcount(squares);
+            ndominoes = bitcount(dominoes);
 
             /*
              * Do the two sets have the right relative size?
@@ -1841,8 +1870,9 @@ struct alloc_scratch {
 
     /* The domino layout. Indexed by squares in the usual y*w+x raster
      * order: layout[i] gives the index of the other square in the
-     * same domino as square i. */
-    int *layout;
+     * same domino as square i. (Owned by layout_ctx.) */
+    const int *layout;
+    domino_layout_ctx *layout_ctx;
 
     /* The output array, containing a number in every square. */
     int *numbers;
@@ -1878,7 +1908,8 @@ static struct alloc_scratch *alloc_make_scratch(int n)
     as->wh = as->w * as->h;
     as->dc = DCOUNT(n);
 
-    as->layout = snewn(as->wh, int);
+    as->layout_ctx = domino_layout_new_ctx(as->w, as->h);
+    as->layout = NULL;
     as->numbers = snewn(as->wh, int);
     as->vals = snewn(as->dc, struct alloc_val);
     as->locs = snewn(as->dc, struct alloc_loc);
@@ -1897,7 +1928,7 @@ static struct alloc_scratch *alloc_make_scratch(int n)
 
 static void alloc_free_scratch(struct alloc_scratch *as)
 {
-    sfree(as->layout);
+    domino_layout_free_ctx(as->layout_ctx);
     sfree(as->numbers);
     sfree(as->vals);
     sfree(as->locs);
@@ -1910,8 +1941,7 @@ static void alloc_make_layout(struct alloc_scratch *as, random_state *rs)
 {
     int i, pos;
 
-    domino_layout_prealloc(as->w, as->h, rs,
-                           as->layout, as->wh_scratch, as->wh2_scratch);
+    as->layout = domino_layout_next(as->layout_ctx, rs);
 
     for (i = pos = 0; i < as->wh; i++) {
         if (as->layout[i] > i) {
@@ -2641,6 +2671,24 @@ static char *solve_game(const game_state *state, const game_state *currstate,
     return ret;
 }
 
+static char *grade_game(const game_state *state, const char **error)
+{
+    struct solver_scratch *sc = solver_make_scratch(state->params.n);
+    int ret, diff;
+
+    solver_setup_grid(sc, state->numbers->numbers);
+    ret = run_solver(sc, DIFFCOUNT);
+    diff = sc->max_diff_used;
+    solver_free_scratch(sc);
+
+    if (ret == 0) {
+        *error = "No solution exists for this puzzle";
+        return NULL;
+    }
+    /* (Ambiguous puzzles are a difficulty level of their own.) */
+    return dupstr(dominosa_diffnames[ret > 1 ? DIFF_AMBIGUOUS : diff]);
+}
+
 static bool game_can_format_as_text_now(const game_params *params)
 {
     return params->n < 1000;
@@ -3458,7 +3506,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    NULL, /* solve_step */
+    grade_game,
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
@@ -3482,7 +3534,7 @@ const struct game thegame = {
     true, false, game_print_size, game_print,
     false,			       /* wants_statusbar */
     false, NULL,                       /* timing_state */
-    REQUIRE_RBUTTON,                   /* flags */
+    REQUIRE_RBUTTON | SOLVE_FROM_ORIG,                   /* flags */
 };
 
 #ifdef STANDALONE_SOLVER
@@ -3,33 +3,54 @@
  */
 
 #include <assert.h>
+#include <string.h>
 
 #include "puzzles.h"
 
 struct edge {
     int x1, y1;
     int x2, y2;
-    bool active;
 
-    /* whether y1 is a closed endpoint (i.e. this edge should be
-     * active when y == y1) */
-    bool closed_y1;
+    /* first scanline on which this edge is active: y1, or y1 + 1 if
+     * y1 is an open endpoint */
+    int ystart;
 
     /* (x2 - x1) / (y2 - y1) as 16.16 signed fixed point; precomputed
      * for speed */
     long inverse_slope;
+
+    /* inverse_slope * (y - y1) for the current scanline y, while
+     * this edge is active */
+    long dx;
+
+    /* x coordinate of the intersection with the current scanline */
+    int x;
 };
 
 #define FRACBITS 16
 #define ONEHALF (1 << (FRACBITS-1))
 
+/*
+ * Draw the filled spans of a run of identical scanlines, from y to
+ * y+h-1, as one rectangle each.
+ */
+static void draw_spans(drawing *dr, const int *spans, int n, int y, int h,
+                       int colour)
+{
+    int i;
+
+    for(i = 0; i + 1 < n; i += 2)
+        draw_rect(dr, spans[i], y, spans[i+1] - spans[i] + 1, h, colour);
+}
+
 void draw_polygon_fallback(drawing *dr, const int *coords, int npoints,
                            int fillcolour, int outlinecolour)
 {
     struct edge *edges;
-    int min_y = INT_MAX, max_y = INT_MIN, i, y;
+    int min_y = INT_MAX, max_y = INT_MIN, i, j, y;
     int n_edges = 0;
-    int *intersections;
+    int *starts, *active, *keys, *intersections, *spans;
+    int n_active = 0, next_start = 0, n_spans = 0, span_y = 0;
 
     if(npoints < 3)
         return;
@@ -45,8 +66,8 @@ void draw_polygon_fallback(drawing *dr, const int *coords, int npoints,
      * of "active" edges, which are those which intersect the scan
      * line at the current Y level. The X coordinates where the scan
      * line intersects each active edge are then computed via
-     * fixed-point arithmetic and stored. Finally, horizontal lines
-     * are drawn between each successive pair of intersection points,
+     * fixed-point arithmetic and stored. Finally, horizontal spans
+     * are filled between each successive pair of intersection points,
      * in the order of ascending X coordinate. This has the effect of
      * "even-odd" filling when the polygon is self-intersecting.
      *
@@ -54,15 +75,15 @@ void draw_polygon_fallback(drawing *dr, const int *coords, int npoints,
      *
      * https://www.khoury.northeastern.edu/home/fell/CS4300/Lectures/CS4300F2012-9-ScanLineFill.pdf
      *
-     * I'm fairly confident that this current implementation is
-     * correct (i.e. draws the right polygon, free from artifacts),
-     * but it isn't quite as efficient as it could be. Namely, it
-     * currently maintains the active edge set by setting the `active`
-     * flag in the `edge` array, which is quite inefficient. Perhaps
-     * future optimization could see this replaced with a tree
-     * set. Additionally, one could perhaps replace the current linear
-     * search for edge endpoints (i.e. the inner loop over `edges`) by
-     * sorting the edge table by upper and lower Y coordinate.
+     * The edge table is sorted by the scanline on which each edge
+     * becomes active, so that moving down a line only has to look at
+     * the edges starting there and the active ones, rather than every
+     * edge. The active edges are kept sorted by X: since they don't
+     * move far from one line to the next, an insertion sort is all
+     * it takes to restore the order. And rather than drawing each
+     * span as a line as soon as it's found, a run of lines with the
+     * same spans (as in the straight-sided parts of most puzzle
+     * shapes) is drawn as one draw_rect per span.
      *
      * A final caveat comes from the use of fixed point arithmetic,
      * which is motivated by performance considerations on FPU-less
@@ -79,7 +100,7 @@ void draw_polygon_fallback(drawing *dr, const int *coords, int npoints,
 
     /* Build edge table from coords. Horizontal edges are filtered
      * out, so n_edges <= n_points in general. */
-    edges = smalloc(npoints * sizeof(struct edge));
+    edges = snewn(npoints, struct edge);
 
     for(i = 0; i < npoints; i++) {
         int x1, y1, x2, y2;
@@ -113,53 +134,87 @@ void draw_polygon_fallback(drawing *dr, const int *coords, int npoints,
 
             struct edge *edge = edges + (n_edges++);
 
-            edge->active = false;
             edge->x1 = swap ? x2 : x1;
             edge->y1 = swap ? y2 : y1;
             edge->x2 = swap ? x1 : x2;
             edge->y2 = swap ? y1 : y2;
             edge->inverse_slope = ((edge->x2 - edge->x1) << FRACBITS) / (edge->y2 - edge->y1);
-            edge->closed_y1 = edge->y1 < coords[2*lower_neighbor+1];
+            /* whether y1 is a closed endpoint (i.e. this edge should
+             * be active when y == y1) */
+            edge->ystart = edge->y1 +
+                (edge->y1 < coords[2*lower_neighbor+1] ? 0 : 1);
         }
     }
 
+    /* Sort the edges into the order they become active. */
+    starts = snewn(n_edges, int);
+    keys = snewn(n_edges, int);
+    for(i = 0; i < n_edges; i++) {
+        starts[i] = i;
+        keys[i] = edges[i].ystart;
+    }
+    sort_by_int_key(starts, n_edges, keys);
+    sfree(keys);
+
+    active = snewn(n_edges, int);
     /* a generous upper bound on number of intersections is n_edges */
-    intersections = smalloc(n_edges * sizeof(int));
+    intersections = snewn(n_edges, int);
+    spans = snewn(n_edges, int);
 
     for(y = min_y; y <= max_y; y++) {
         int n_intersections = 0;
-        for(i = 0; i < n_edges; i++) {
-            struct edge *edge = edges + i;
-            /* Update active edge set. These conditions are mutually
-             * exclusive because of the invariant that y1 < y2. */
-            if(edge->y1 + (edge->closed_y1 ? 0 : 1) == y)
-                edge->active = true;
-            else if(edge->y2 + 1 == y)
-                edge->active = false;
-
-            if(edge->active) {
-                int x = edges[i].x1;
-                x += (edges[i].inverse_slope * (y - edges[i].y1) + ONEHALF) >> FRACBITS;
-                intersections[n_intersections++] = x;
-            }
+
+        /* Retire the edges that ended on the previous line, and step
+         * the rest down to this one. */
+        for(i = j = 0; i < n_active; i++) {
+            struct edge *edge = edges + active[i];
+            if(edge->y2 < y)
+                continue;
+            edge->dx += edge->inverse_slope;
+            edge->x = edge->x1 + (int)((edge->dx + ONEHALF) >> FRACBITS);
+            active[j++] = active[i];
+        }
+        n_active = j;
+
+        /* Add the edges starting on this line. */
+        for(; next_start < n_edges &&
+                edges[starts[next_start]].ystart == y; next_start++) {
+            struct edge *edge = edges + starts[next_start];
+            edge->dx = edge->inverse_slope * (y - edge->y1);
+            edge->x = edge->x1 + (int)((edge->dx + ONEHALF) >> FRACBITS);
+            active[n_active++] = starts[next_start];
+        }
+
+        /* Restore the X order, by insertion sort. */
+        for(i = 1; i < n_active; i++) {
+            int e = active[i], x = edges[e].x;
+            for(j = i; j > 0 && edges[active[j-1]].x > x; j--)
+                active[j] = active[j-1];
+            active[j] = e;
         }
 
-        qsort(intersections, n_intersections, sizeof(int), compare_integers);
+        for(i = 0; i < n_active; i++)
+            intersections[n_intersections++] = edges[active[i]].x;
 
         assert(n_intersections % 2 == 0);
         assert(n_intersections <= n_edges);
 
-        /* Draw horizontal lines between successive pairs of
-         * intersections of the scanline with active edges. */
-        for(i = 0; i + 1 < n_intersections; i += 2) {
-            draw_line(dr,
-                      intersections[i], y,
-                      intersections[i+1], y,
-                      fillcolour);
+        /* If this line's spans differ from the run above, draw that
+         * run, and start a new one. */
+        if(n_intersections != n_spans ||
+           memcmp(intersections, spans, n_spans * sizeof(int))) {
+            draw_spans(dr, spans, n_spans, span_y, y - span_y, fillcolour);
+            memcpy(spans, intersections, n_intersections * sizeof(int));
+            n_spans = n_intersections;
+            span_y = y;
         }
     }
+    draw_spans(dr, spans, n_spans, span_y, y - span_y, fillcolour);
 
+    sfree(spans);
     sfree(intersections);
+    sfree(active);
+    sfree(starts);
     sfree(edges);
 
 draw_outline:
@@ -177,21 +232,118 @@ draw_outline:
  * Standalone program to test draw_polygon_fallback(). By default,
  * creates a window and allows clicking points to build a
  * polygon. Optionally, can draw a randomly growing polygon in
- * "screensaver" mode.
+ * "screensaver" mode, or (without a window) measure throughput in
+ * "bench" mode.
  */
 
+#include <math.h>
+#include <time.h>
+
 #include <SDL.h>
 
+/* In bench mode there's no renderer, and we just count the calls. */
+static unsigned long bench_calls, bench_pixels;
+
 void draw_line(drawing *dr, int x1, int y1, int x2, int y2, int colour)
 {
     SDL_Renderer *renderer = GET_HANDLE_AS_TYPE(dr, SDL_Renderer);
+    if (!renderer) {
+        bench_calls++;
+        return;
+    }
     SDL_RenderDrawLine(renderer, x1, y1, x2, y2);
 }
 
+void draw_rect(drawing *dr, int x, int y, int w, int h, int colour)
+{
+    SDL_Renderer *renderer = GET_HANDLE_AS_TYPE(dr, SDL_Renderer);
+    SDL_Rect rect;
+    if (!renderer) {
+        bench_calls++;
+        bench_pixels += (unsigned long)w * h;
+        return;
+    }
+    rect.x = x;
+    rect.y = y;
+    rect.w = w;
+    rect.h = h;
+    SDL_RenderFillRect(renderer, &rect);
+}
+
 #define WINDOW_WIDTH 800
 #define WINDOW_HEIGHT 600
 #define MAX_SCREENSAVER_POINTS 1000
 
+/*
+ * Fill a lot of polygons of a few kinds typical of the puzzles (the
+ * small faces of a Loopy grid, larger Map regions) plus some nasty
+ * random ones, and report how fast that went and how many drawing
+ * calls it took.
+ */
+#define BENCH_POLYS 1000
+static int benchmark(int iterations)
+{
+    static const struct {
+        const char *name;
+        int npoints, radius;
+        bool random;
+    } kinds[] = {
+        { "squares", 4, 20, false },
+        { "hexagons", 6, 16, false },
+        { "map regions", 24, 60, false },
+        { "random", 50, 0, true },
+    };
+    int *polys = snewn(BENCH_POLYS * 2 * 50, int);
+    drawing dr;
+    int k, i, p, it;
+
+    dr.handle = NULL;
+    srand(1);
+
+    for (k = 0; k < (int)lenof(kinds); k++) {
+        int n = kinds[k].npoints;
+        clock_t start, end;
+        double secs;
+
+        for (p = 0; p < BENCH_POLYS; p++) {
+            int *c = polys + p * 2 * n;
+            int cx = rand() % WINDOW_WIDTH, cy = rand() % WINDOW_HEIGHT;
+            double phase = (rand() % 360) * PI / 180;
+            for (i = 0; i < n; i++) {
+                if (kinds[k].random) {
+                    c[2*i] = rand() % WINDOW_WIDTH;
+                    c[2*i+1] = rand() % WINDOW_HEIGHT;
+                } else {
+                    /* Wobbly radius for the bigger shapes, so they
+                     * aren't all convex. */
+                    int r = kinds[k].radius;
+                    if (n > 6)
+                        r = r / 2 + rand() % (r / 2);
+                    c[2*i] = cx + (int)(r * cos(phase + 2*PI*i/n));
+                    c[2*i+1] = cy + (int)(r * sin(phase + 2*PI*i/n));
+                }
+            }
+        }
+
+        bench_calls = bench_pixels = 0;
+        start = clock();
+        for (it = 0; it < iterations; it++)
+            for (p = 0; p < BENCH_POLYS; p++)
+                draw_polygon_fallback(&dr, polys + p * 2 * n, n, 1, 1);
+        end = clock();
+        secs = (double)(end - start) / CLOCKS_PER_SEC;
+
+        printf("%-12s %10.0f polygons/s %8.1f calls/polygon"
+               " %10.1f pixels/polygon\n", kinds[k].name,
+               secs > 0 ? iterations * BENCH_POLYS / secs : 0.0,
+               (double)bench_calls / ((double)iterations * BENCH_POLYS),
+               (double)bench_pixels / ((double)iterations * BENCH_POLYS));
+    }
+
+    sfree(polys);
+    return 0;
+}
+
 int main(int argc, char *argv[]) {
     SDL_Window* window = NULL;
     SDL_Event event;
@@ -204,8 +356,11 @@ int main(int argc, char *argv[]) {
     if(argc >= 2) {
 	if(!strcmp(argv[1], "--screensaver"))
 	    screensaver = true;
+	else if(!strcmp(argv[1], "--bench"))
+	    return benchmark(argc >= 3 ? atoi(argv[2]) : 100);
 	else
-	    printf("usage: %s [--screensaver]\n", argv[0]);
+	    printf("usage: %s [--screensaver | --bench [iterations]]\n",
+                   argv[0]);
     }
 
     int *poly = NULL;
@@ -0,0 +1,492 @@
+/*
+ * drawbench.c: drawing API call volume benchmark for all puzzles.
+ *
+ * The null front end used by the other command-line tools throws
+ * drawing calls away without looking at them, so nothing measures
+ * how many of them each back end's redraw function makes. But for a
+ * front end where each drawing call is expensive (such as a browser
+ * canvas), that's what decides how fast a puzzle feels. So this is a
+ * front end whose drawing API counts every call, driving each back
+ * end through a short scripted session:
+ *
+ *   first draw  the initial redraw of a new game
+ *   move        a cursor movement, then a cursor select (drawn as the
+ *               front end would at the end of any animation)
+ *   solve       the Solve operation, with its animation, if any
+ *   flash       a completion flash, from the solved position
+ *
+ * Usage: drawbench [--iterations N] [--size PIXELS] [GAME ...]
+ *
+ * GAME is the short name (as in the executable, e.g. "tracks"); with
+ * none, every game is run. Each game uses its default parameters and
+ * a fixed random seed, and is drawn in a window of (at most) PIXELS
+ * square (default 600). The counts are the same every time; the
+ * times, which are the CPU time spent in the back end's redraw
+ * function per scenario, are averaged over N runs (default 10).
+ *
+ * Output is a table per game, with one row per scenario, giving the
+ * number of redraw calls (frames) and of each kind of drawing call,
+ * the total area of the rectangles drawn by draw_rect, and the time.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "puzzles.h"
+
+/* Frame interval for animations and flashes, as a typical front end */
+#define FRAME_TIME 0.02F
+/* Length of flash to draw when the game won't say (e.g. having been
+ * solved by the Solve operation, which most games don't flash for) */
+#define DEFAULT_FLASH_TIME 0.7F
+
+enum {
+    CALL_TEXT, CALL_RECT, CALL_LINE, CALL_POLYGON, CALL_CIRCLE,
+    CALL_THICK_LINE, CALL_UPDATE, CALL_CLIP, CALL_BLITTER, CALL_SPRITE,
+    NCALLS
+};
+static const char *const call_names[NCALLS] = {
+    "text", "rect", "line", "polygon", "circle",
+    "thick", "update", "clip", "blitter", "sprite",
+};
+
+enum { FIRST_DRAW, MOVE, SOLVE, FLASH, NSCENARIOS };
+static const char *const scenario_names[NSCENARIOS] = {
+    "first draw", "move", "solve", "flash",
+};
+
+struct counts {
+    unsigned long frames;
+    unsigned long calls[NCALLS];
+    double area;                       /* pixels filled by draw_rect */
+    double time;                       /* seconds in game->redraw */
+};
+
+/* The counts being accumulated at present */
+static struct counts *current;
+
+struct blitter {
+    int w, h;
+};
+
+struct sprite {
+    int w, h;
+};
+
+static void count_text(drawing *dr, int x, int y, int fonttype,
+                       int fontsize, int align, int colour,
+                       const char *text)
+{
+    current->calls[CALL_TEXT]++;
+}
+
+static void count_rect(drawing *dr, int x, int y, int w, int h, int colour)
+{
+    current->calls[CALL_RECT]++;
+    current->area += (double)w * h;
+}
+
+static void count_line(drawing *dr, int x1, int y1, int x2, int y2,
+                       int colour)
+{
+    current->calls[CALL_LINE]++;
+}
+
+static void count_polygon(drawing *dr, const int *coords, int npoints,
+                          int fillcolour, int outlinecolour)
+{
+    current->calls[CALL_POLYGON]++;
+}
+
+static void count_circle(drawing *dr, int cx, int cy, int radius,
+                         int fillcolour, int outlinecolour)
+{
+    current->calls[CALL_CIRCLE]++;
+}
+
+static void count_update(drawing *dr, int x, int y, int w, int h)
+{
+    current->calls[CALL_UPDATE]++;
+}
+
+static void count_clip(drawing *dr, int x, int y, int w, int h)
+{
+    current->calls[CALL_CLIP]++;
+}
+
+static void count_unclip(drawing *dr)
+{
+}
+
+static void count_start_draw(drawing *dr)
+{
+}
+
+static void count_end_draw(drawing *dr)
+{
+}
+
+static blitter *count_blitter_new(drawing *dr, int w, int h)
+{
+    blitter *bl = snew(blitter);
+    bl->w = w;
+    bl->h = h;
+    return bl;
+}
+
+static void count_blitter_free(drawing *dr, blitter *bl)
+{
+    sfree(bl);
+}
+
+static void count_blitter_save(drawing *dr, blitter *bl, int x, int y)
+{
+    current->calls[CALL_BLITTER]++;
+}
+
+static void count_blitter_load(drawing *dr, blitter *bl, int x, int y)
+{
+    current->calls[CALL_BLITTER]++;
+}
+
+/*
+ * Drawing into a sprite is counted like any other drawing; the
+ * "sprite" column counts the sprites drawn.
+ */
+static sprite *count_sprite_new(drawing *dr, int w, int h)
+{
+    sprite *sp = snew(sprite);
+    sp->w = w;
+    sp->h = h;
+    return sp;
+}
+
+static void count_sprite_free(drawing *dr, sprite *sp)
+{
+    sfree(sp);
+}
+
+static void count_sprite_begin(drawing *dr, sprite *sp)
+{
+}
+
+static void count_sprite_end(drawing *dr, sprite *sp)
+{
+}
+
+static void count_sprite_draw(drawing *dr, sprite *sp, int x, int y,
+                              float angle)
+{
+    current->calls[CALL_SPRITE]++;
+}
+
+static void count_thick_line(drawing *dr, float thickness,
+                             float x1, float y1, float x2, float y2,
+                             int colour)
+{
+    current->calls[CALL_THICK_LINE]++;
+}
+
+static const drawing_api count_drawing = {
+    1,
+    count_text,
+    count_rect,
+    count_line,
+    count_polygon,
+    count_circle,
+    count_update,
+    count_clip,
+    count_unclip,
+    count_start_draw,
+    count_end_draw,
+    NULL, /* status_bar */
+    count_blitter_new,
+    count_blitter_free,
+    count_blitter_save,
+    count_blitter_load,
+    NULL, NULL, NULL, NULL, NULL, NULL, /* {begin,end}_{doc,page,puzzle} */
+    NULL, NULL,			       /* line_width, line_dotted */
+    NULL, /* text_fallback */
+    count_thick_line,
+    count_sprite_new,
+    count_sprite_free,
+    count_sprite_begin,
+    count_sprite_end,
+    count_sprite_draw,
+};
+
+/*
+ * Front end functions needed by the rest of the code.
+ */
+
+void frontend_default_colour(frontend *fe, float *output)
+{
+    output[0] = output[1] = output[2] = 0.8F;
+}
+
+void get_random_seed(void **randseed, int *randseedsize)
+{
+    char *c = snewn(1, char);
+    *c = 0;
+    *randseed = c;
+    *randseedsize = 1;
+}
+
+void activate_timer(frontend *fe)
+{
+}
+
+void deactivate_timer(frontend *fe)
+{
+}
+
+void document_add_puzzle(document *doc, const game *game, game_params *par,
+                         game_ui *ui, game_state *st, game_state *st2)
+{
+}
+
+void fatal(const char *fmt, ...)
+{
+    va_list ap;
+
+    fprintf(stderr, "fatal error: ");
+
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
+/*
+ * One frame: the back end's redraw function, as the midend would
+ * call it.
+ */
+static void redraw(const game *ourgame, drawing *dr, game_drawstate *ds,
+                   const game_state *oldstate, const game_state *newstate,
+                   game_ui *ui, float anim_time, float flash_time)
+{
+    clock_t start;
+
+    start_draw(dr);
+    start = clock();
+    ourgame->redraw(dr, ds, oldstate, newstate, +1, ui,
+                    anim_time, flash_time);
+    current->time += (double)(clock() - start) / CLOCKS_PER_SEC;
+    end_draw(dr);
+    current->frames++;
+}
+
+/*
+ * Make a move, if it is one, and draw the result. Returns the new
+ * current state (which is the old one if nothing happened).
+ */
+static game_state *make_move(const game *ourgame, drawing *dr,
+                             game_drawstate *ds, game_state *state,
+                             game_ui *ui, const char *move, bool animate)
+{
+    game_state *newstate;
+    float anim_time, t;
+
+    if (!move || move == MOVE_NO_EFFECT || move == MOVE_UNUSED)
+        return state;
+    if (move == MOVE_UI_UPDATE) {
+        redraw(ourgame, dr, ds, NULL, state, ui, 0.0F, 0.0F);
+        return state;
+    }
+
+    newstate = ourgame->execute_move(state, move);
+    if (!newstate)
+        return state;
+    ourgame->changed_state(ui, state, newstate);
+
+    anim_time = animate ? ourgame->anim_length(state, newstate, +1, ui) : 0;
+    for (t = 0; t < anim_time; t += FRAME_TIME)
+        redraw(ourgame, dr, ds, state, newstate, ui, t, 0.0F);
+    redraw(ourgame, dr, ds, NULL, newstate, ui, 0.0F, 0.0F);
+
+    ourgame->free_game(state);
+    return newstate;
+}
+
+static void drawbench_run(const game *ourgame, int size,
+                          struct counts counts[NSCENARIOS])
+{
+    game_params *params = ourgame->default_params();
+    random_state *rs = random_new("drawbench", 9);
+    midend *me = midend_new(NULL, ourgame, NULL, NULL);
+    char *desc, *aux = NULL, *move;
+    game_state *orig, *state;
+    game_drawstate *ds;
+    game_ui *ui;
+    drawing *dr;
+    float *colours;
+    int ncolours, tilesize, w, h;
+    float flash_time, t;
+
+    desc = ourgame->new_desc(params, rs, &aux, false);
+    orig = ourgame->new_game(me, params, desc);
+    state = ourgame->dup_game(orig);
+    ui = ourgame->new_ui(state);
+
+    dr = drawing_new(&count_drawing, NULL, NULL);
+    ds = ourgame->new_drawstate(dr, state);
+    colours = ourgame->colours(NULL, &ncolours);
+    sfree(colours);
+
+    /* Largest tile size that fits, as midend_size would choose. */
+    for (tilesize = 1; ; tilesize++) {
+        ourgame->compute_size(params, tilesize + 1, ui, &w, &h);
+        if (w > size || h > size || tilesize >= size)
+            break;
+    }
+    ourgame->set_size(dr, ds, params, tilesize);
+    ourgame->compute_size(params, tilesize, ui, &w, &h);
+
+    current = &counts[FIRST_DRAW];
+    start_draw(dr);
+    draw_rect(dr, 0, 0, w, h, 0);
+    end_draw(dr);
+    redraw(ourgame, dr, ds, NULL, state, ui, 0.0F, 0.0F);
+
+    current = &counts[MOVE];
+    move = ourgame->interpret_move(state, ui, ds, 0, 0, CURSOR_RIGHT);
+    state = make_move(ourgame, dr, ds, state, ui, move, false);
+    if (move != MOVE_UI_UPDATE && move != MOVE_NO_EFFECT &&
+        move != MOVE_UNUSED)
+        sfree(move);
+    move = ourgame->interpret_move(state, ui, ds, 0, 0, CURSOR_SELECT);
+    state = make_move(ourgame, dr, ds, state, ui, move, false);
+    if (move != MOVE_UI_UPDATE && move != MOVE_NO_EFFECT &&
+        move != MOVE_UNUSED)
+        sfree(move);
+
+    current = &counts[SOLVE];
+    if (ourgame->can_solve) {
+        const char *err = NULL;
+        move = ourgame->solve(orig, state, aux, &err);
+        if (move) {
+            state = make_move(ourgame, dr, ds, state, ui, move, true);
+            sfree(move);
+        }
+    }
+
+    current = &counts[FLASH];
+    flash_time = ourgame->flash_length(state, state, +1, ui);
+    if (flash_time <= 0)
+        flash_time = DEFAULT_FLASH_TIME;
+    for (t = FRAME_TIME; t < flash_time; t += FRAME_TIME)
+        redraw(ourgame, dr, ds, NULL, state, ui, 0.0F, t);
+    redraw(ourgame, dr, ds, NULL, state, ui, 0.0F, 0.0F);
+
+    current = NULL;
+    ourgame->free_drawstate(dr, ds);
+    drawing_free(dr);
+    ourgame->free_ui(ui);
+    ourgame->free_game(state);
+    ourgame->free_game(orig);
+    midend_free(me);
+    sfree(desc);
+    sfree(aux);
+    random_free(rs);
+    ourgame->free_params(params);
+}
+
+static void drawbench_game(const game *ourgame, int size, int iterations)
+{
+    struct counts counts[NSCENARIOS], run[NSCENARIOS];
+    game_params *params = ourgame->default_params();
+    char *pstr = ourgame->encode_params(params, true);
+    int i, s, c;
+
+    ourgame->free_params(params);
+    memset(counts, 0, sizeof(counts));
+    for (i = 0; i < iterations; i++) {
+        memset(run, 0, sizeof(run));
+        drawbench_run(ourgame, size, run);
+        /* The counts are the same every time: only sum the times. */
+        for (s = 0; s < NSCENARIOS; s++) {
+            double time = counts[s].time + run[s].time;
+            counts[s] = run[s];
+            counts[s].time = time;
+        }
+    }
+
+    printf("%s %s\n", ourgame->htmlhelp_topic, pstr);
+    printf("  %-10s %6s", "scenario", "frames");
+    for (c = 0; c < NCALLS; c++)
+        printf(" %7s", call_names[c]);
+    printf(" %10s %9s\n", "rect area", "time/us");
+    for (s = 0; s < NSCENARIOS; s++) {
+        printf("  %-10s %6lu", scenario_names[s], counts[s].frames);
+        for (c = 0; c < NCALLS; c++)
+            printf(" %7lu", counts[s].calls[c]);
+        printf(" %10.0f %9.1f\n", counts[s].area,
+               counts[s].time / iterations * 1e6);
+    }
+    fflush(stdout);
+    sfree(pstr);
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = 10, size = 600;
+    bool doing_opts = true, any = false;
+    int i, j;
+
+    for (i = 1; i < argc; i++) {
+        const char *p = argv[i];
+
+        if (doing_opts && !strcmp(p, "--iterations") && i+1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (doing_opts && !strcmp(p, "--size") && i+1 < argc) {
+            size = atoi(argv[++i]);
+        } else if (doing_opts && !strcmp(p, "--")) {
+            doing_opts = false;
+        } else if (doing_opts && p[0] == '-') {
+            fprintf(stderr, "drawbench: unrecognised option '%s'\n", p);
+            fprintf(stderr, "usage: drawbench [--iterations N] "
+                    "[--size PIXELS] [GAME ...]\n");
+            return 1;
+        }
+    }
+    if (iterations < 1 || size < 1) {
+        fprintf(stderr, "drawbench: --iterations and --size must be "
+                "positive\n");
+        return 1;
+    }
+
+    doing_opts = true;
+    for (i = 1; i < argc; i++) {
+        const char *p = argv[i];
+
+        if (doing_opts && (!strcmp(p, "--iterations") ||
+                           !strcmp(p, "--size"))) {
+            i++;
+            continue;
+        } else if (doing_opts && !strcmp(p, "--")) {
+            doing_opts = false;
+            continue;
+        }
+
+        any = true;
+        for (j = 0; j < gamecount; j++)
+            if (!strcmp(p, gamelist[j]->htmlhelp_topic))
+                break;
+        if (j == gamecount) {
+            fprintf(stderr, "drawbench: unknown game '%s'\n", p);
+            return 1;
+        }
+        drawbench_game(gamelist[j], size, iterations);
+    }
+
+    if (!any)
+        for (j = 0; j < gamecount; j++)
+            drawbench_game(gamelist[j], size, iterations);
+
+    return 0;
+}
@@ -266,6 +266,43 @@ void blitter_load(drawing *dr, blitter *bl, int x, int y)
     dri->pub.api->blitter_load(dr, bl, x, y);
 }
 
+/*
+ * Sprites are an optional part of the drawing API, so sprite_new()
+ * returns NULL if the front end doesn't provide them (and always when
+ * printing). Back ends must then fall back to drawing directly.
+ */
+sprite *sprite_new(drawing *dr, int w, int h)
+{
+    drawing_internal *dri = PRIVATE_CAST(dr);
+    if (!dri->pub.api->sprite_new)
+	return NULL;
+    return dri->pub.api->sprite_new(dr, w, h);
+}
+
+void sprite_free(drawing *dr, sprite *sp)
+{
+    drawing_internal *dri = PRIVATE_CAST(dr);
+    dri->pub.api->sprite_free(dr, sp);
+}
+
+void sprite_begin(drawing *dr, sprite *sp)
+{
+    drawing_internal *dri = PRIVATE_CAST(dr);
+    dri->pub.api->sprite_begin(dr, sp);
+}
+
+void sprite_end(drawing *dr, sprite *sp)
+{
+    drawing_internal *dri = PRIVATE_CAST(dr);
+    dri->pub.api->sprite_end(dr, sp);
+}
+
+void sprite_draw(drawing *dr, sprite *sp, int x, int y, float angle)
+{
+    drawing_internal *dri = PRIVATE_CAST(dr);
+    dri->pub.api->sprite_draw(dr, sp, x, y, angle);
+}
+
 void print_begin_doc(drawing *dr, int pages)
 {
     drawing_internal *dri = PRIVATE_CAST(dr);
@@ -158,14 +158,10 @@ int dsf_canonify(DSF *dsf, int n)
     return root;
 }
 
-void dsf_merge(DSF *dsf, int n1, int n2)
+static inline void dsf_merge_internal(DSF *dsf, size_t n1, size_t n2)
 {
     size_t r1, r2, s1, s2, root;
 
-    assert(0 <= n1 && n1 < dsf->size && "Overrun in dsf_merge");
-    assert(0 <= n2 && n2 < dsf->size && "Overrun in dsf_merge");
-    assert(!dsf->flip && "dsf_merge on a flip dsf");
-
     /* Find the root elements */
     r1 = dsf_find_root(dsf, n1);
     r2 = dsf_find_root(dsf, n2);
@@ -198,6 +194,15 @@ void dsf_merge(DSF *dsf, int n1, int n2)
     dsf_path_compress(dsf, n2, root);
 }
 
+void dsf_merge(DSF *dsf, int n1, int n2)
+{
+    assert(0 <= n1 && n1 < dsf->size && "Overrun in dsf_merge");
+    assert(0 <= n2 && n2 < dsf->size && "Overrun in dsf_merge");
+    assert(!dsf->flip && "dsf_merge on a flip dsf");
+
+    dsf_merge_internal(dsf, n1, n2);
+}
+
 bool dsf_equivalent(DSF *dsf, int n1, int n2)
 {
     return dsf_canonify(dsf, n1) == dsf_canonify(dsf, n2);
@@ -209,6 +214,81 @@ int dsf_size(DSF *dsf, int n)
     return dsf->parent_or_size[root] & DSF_INDEX_MASK;
 }
 
+/*
+ * Bulk operations. These touch only parent_or_size, so they're only
+ * legal on a dsf without flip tracking; in exchange, they skip the
+ * per-call checks, and dsf_canonify_all is a single sweep which never
+ * walks a path it has already compressed.
+ */
+
+void dsf_merge_pairs(DSF *dsf, const int *pairs, int npairs)
+{
+    int i;
+
+    assert(!dsf->flip && "dsf_merge_pairs on a flip dsf");
+
+    for (i = 0; i < npairs; i++) {
+        assert(0 <= pairs[2*i] && pairs[2*i] < dsf->size &&
+               0 <= pairs[2*i+1] && pairs[2*i+1] < dsf->size &&
+               "Overrun in dsf_merge_pairs");
+        dsf_merge_internal(dsf, pairs[2*i], pairs[2*i+1]);
+    }
+}
+
+void dsf_canonify_all(DSF *dsf, int *roots)
+{
+    unsigned *parent = dsf->parent_or_size;
+    size_t i, root;
+
+    assert(!dsf->flip && "dsf_canonify_all on a flip dsf");
+
+    for (i = 0; i < dsf->size; i++) {
+        if (parent[i] & DSF_FLAG_CANONICAL) {
+            root = i;
+        } else if (parent[i] < i) {
+            /* We've already been here, so we know where this leads */
+            root = parent[i] = roots[parent[i]];
+        } else {
+            root = dsf_find_root(dsf, i);
+            dsf_path_compress(dsf, i, root);
+        }
+        roots[i] = root;
+    }
+}
+
+void dsf_size_all(DSF *dsf, int *sizes)
+{
+    size_t i;
+
+    dsf_canonify_all(dsf, sizes);
+    for (i = 0; i < dsf->size; i++)
+        sizes[i] = dsf->parent_or_size[sizes[i]] & DSF_INDEX_MASK;
+}
+
+int dsf_label(DSF *dsf, int *labels)
+{
+    int *rootlabel = snewn(dsf->size, int);
+    int nlabels = 0;
+    size_t i;
+
+    dsf_canonify_all(dsf, labels);
+
+    /* Each class is numbered when its smallest element comes up */
+    for (i = 0; i < dsf->size; i++) {
+        if (labels[i] == (int)i)
+            rootlabel[i] = -1;
+    }
+    for (i = 0; i < dsf->size; i++) {
+        int root = labels[i];
+        if (rootlabel[root] < 0)
+            rootlabel[root] = nlabels++;
+        labels[i] = rootlabel[root];
+    }
+
+    sfree(rootlabel);
+    return nlabels;
+}
+
 static inline size_t dsf_find_root_flip(DSF *dsf, size_t n, unsigned *flip)
 {
     *flip = 0;
@@ -682,7 +682,7 @@ static void next_move(int nx, int ny, int ox, int oy, int gx, int gy,
         *dx = to_tile_x;
 }
 
-static bool compute_hint(const game_state *state, int *out_x, int *out_y)
+static bool greedy_hint(const game_state *state, int *out_x, int *out_y)
 {
     /* The overall solving process is this:
      * 1. Find the next piece to be put in its place
@@ -757,6 +757,420 @@ static bool compute_hint(const game_state *state, int *out_x, int *out_y)
     return true;
 }
 
+/* ----------------------------------------------------------------------
+ * Optimal hints.
+ *
+ * greedy_hint() above always makes progress, but the solution it
+ * works its way along can be several times longer than it needs to
+ * be. So first we try to find a shortest solution, by IDA* search.
+ *
+ * The search's lower bound on the moves still needed comes from an
+ * additive pattern database. The tiles are split into groups of at
+ * most PDB_GROUP tiles, and for each group a table gives the number
+ * of moves of that group's own tiles needed to get them all home,
+ * wherever they are now. Each move moves only one tile, so the sum
+ * of the groups' table entries is a lower bound on the length of a
+ * solution, and a much better one than the sum of the tiles'
+ * distances from home.
+ *
+ * A group's table is made by a breadth-first search backwards from
+ * the solved position, over every placement of the group's tiles and
+ * the gap. The tables for a puzzle size are made the first time we
+ * want a hint at that size, and kept until the program exits. The
+ * groups are made smaller as necessary to keep each table's search
+ * within 2^PDB_MAX_BITS states, so the memory this takes is bounded.
+ * Beyond PDB_MAX_TILES squares we don't bother: the search would
+ * hardly ever finish anyway.
+ *
+ * The time is bounded too: the search gives up after SEARCH_MAX_NODES
+ * nodes, and the caller falls back to greedy_hint(). As the puzzle
+ * gets closer to solved, the search gets quicker, so the optimal
+ * hints will kick in eventually.
+ */
+
+#define PDB_GROUP 5
+#define PDB_MAX_BITS 24
+#define PDB_MAX_TILES 25
+#define SEARCH_MAX_NODES 2000000L
+
+struct pdb {
+    int w, h, n;
+    int bits;                  /* bits per square number in an index */
+    int ngroups;
+    int *group;                /* tile -> the group it's in */
+    int *mult;                 /* tile -> its place value in the index */
+    unsigned char **tables;    /* one per group, indexed by placement */
+    struct pdb *next;
+};
+
+static struct pdb *pdb_cache = NULL;
+
+/*
+ * Fill in one group's table. The k tiles in the group are
+ * tiles[0..k-1]; a placement of them is indexed by the sum of
+ * pos[i] << (bits*i), and a placement of them and the gap by
+ * (placement << bits) + gap. (Not the more compact sum of pos[i] *
+ * n^i, because then taking an index apart needs divisions. The gap
+ * goes in the low bits so that most of the search's steps, which
+ * only move the gap, stay close by in memory.)
+ */
+static void pdb_build_table(int w, int h, int bits, const int *tiles, int k,
+                            unsigned char *table)
+{
+    int n = w*h, mask = (1 << bits) - 1, i, j, d, level;
+    int size, npos;
+    unsigned char *dist;
+    int *cur, *next, ncur, nnext, curlen, nextlen, *tmp;
+    int pos[PDB_GROUP];
+
+    npos = 1 << (bits*k);
+    size = npos << bits;
+
+    dist = snewn(size, unsigned char);
+    memset(dist, 0xFF, size);
+    curlen = nextlen = 1024;
+    cur = snewn(curlen, int);
+    next = snewn(nextlen, int);
+
+    j = 0;
+    for (i = k; i-- > 0 ;)
+        j = (j << bits) + (tiles[i] - 1);
+    j = (j << bits) + (n-1);
+    dist[j] = 0;
+    cur[0] = j;
+    ncur = 1;
+
+    /*
+     * Moving the gap past a tile of our own costs a move; moving it
+     * anywhere else is free. So this is a 0-1 breadth-first search:
+     * free moves go on the queue for this level, and the others on
+     * the one for the next.
+     */
+    for (level = 0; ncur > 0 && level < 0xFF; level++) {
+        nnext = 0;
+        for (i = 0; i < ncur; i++) {
+            int s = cur[i], t = s >> bits, gap = s & mask, gx, gy;
+
+            if (dist[s] != level)
+                continue;              /* since improved on */
+            for (j = 0; j < k; j++) {
+                pos[j] = t & mask;
+                t >>= bits;
+            }
+            gx = gap % w;
+            gy = gap / w;
+
+            for (d = 0; d < 4; d++) {
+                int nx = gx + (d == 0) - (d == 1);
+                int ny = gy + (d == 2) - (d == 3);
+                int np, ns, nd, shift = bits;
+
+                if (nx < 0 || nx >= w || ny < 0 || ny >= h)
+                    continue;
+                np = ny * w + nx;
+
+                ns = s + (np - gap);
+                nd = level;
+                for (j = 0; j < k; j++) {
+                    if (pos[j] == np) {
+                        ns += (gap - np) * (1 << shift);
+                        nd++;
+                        break;
+                    }
+                    shift += bits;
+                }
+                if (nd >= dist[ns])
+                    continue;
+                dist[ns] = nd;
+                if (nd == level) {
+                    if (ncur == curlen) {
+                        curlen = curlen * 3 / 2;
+                        cur = sresize(cur, curlen, int);
+                    }
+                    cur[ncur++] = ns;
+                } else {
+                    if (nnext == nextlen) {
+                        nextlen = nextlen * 3 / 2;
+                        next = sresize(next, nextlen, int);
+                    }
+                    next[nnext++] = ns;
+                }
+            }
+        }
+        tmp = cur; cur = next; next = tmp;
+        j = curlen; curlen = nextlen; nextlen = j;
+        ncur = nnext;
+    }
+
+    /*
+     * The table entry for a placement of the tiles is the best over
+     * every position of the gap. (Placements which put two tiles in
+     * the same place, or off the board, are left at 0xFF, but are
+     * never looked up.)
+     */
+    memset(table, 0xFF, npos);
+    for (i = 0; i < size; i++)
+        if (dist[i] < table[i >> bits])
+            table[i >> bits] = dist[i];
+
+    sfree(next);
+    sfree(cur);
+    sfree(dist);
+}
+
+static const struct pdb *pdb_get_locked(int w, int h)
+{
+    struct pdb *pdb;
+    int n = w*h, bits, k, j, g;
+    int tiles[PDB_GROUP];
+
+    for (pdb = pdb_cache; pdb; pdb = pdb->next)
+        if (pdb->w == w && pdb->h == h)
+            return pdb;
+
+    if (n > PDB_MAX_TILES)
+        return NULL;
+
+    /*
+     * Find the largest group size whose tables' searches fit in
+     * PDB_MAX_BITS bits (with bits for each of k tiles and the gap).
+     */
+    for (bits = 1; (1 << bits) < n; bits++);
+    k = min(PDB_GROUP, PDB_MAX_BITS / bits - 1);
+
+    pdb = snew(struct pdb);
+    pdb->w = w;
+    pdb->h = h;
+    pdb->n = n;
+    pdb->bits = bits;
+    pdb->ngroups = (n - 1 + k - 1) / k;
+    pdb->group = snewn(n, int);
+    pdb->mult = snewn(n, int);
+    pdb->tables = snewn(pdb->ngroups, unsigned char *);
+
+    /* Tiles go in groups in numerical order, so groups are mostly rows. */
+    for (g = 0; g < pdb->ngroups; g++) {
+        int ntiles = 0;
+        for (j = g*k + 1; j <= (g+1)*k && j < n; j++) {
+            pdb->group[j] = g;
+            pdb->mult[j] = 1 << (bits * ntiles);
+            tiles[ntiles++] = j;
+        }
+        pdb->tables[g] = snewn(1 << (bits * ntiles), unsigned char);
+        pdb_build_table(w, h, bits, tiles, ntiles, pdb->tables[g]);
+    }
+
+    pdb->next = pdb_cache;
+    pdb_cache = pdb;
+    return pdb;
+}
+
+/*
+ * Tables are never freed or changed once made, so only finding or
+ * making one needs the lock.
+ */
+static const struct pdb *pdb_get(int w, int h)
+{
+    const struct pdb *pdb;
+
+    cache_lock();
+    pdb = pdb_get_locked(w, h);
+    cache_unlock();
+    return pdb;
+}
+
+struct search {
+    const struct pdb *pdb;
+    int w, h, n;
+    int *tiles;                /* as in game_state, updated as we go */
+    int *index;                /* each group's current table index */
+    int gap;
+    long nodes;
+    int *path;                 /* the gap's successive positions */
+};
+
+#define SEARCH_FOUND (-1)
+#define SEARCH_ABORTED (-2)
+
+/*
+ * Search for a solution in at most bound moves, given that we've
+ * made depth moves so far and the heuristic says we have at least est
+ * to go. Returns SEARCH_FOUND, SEARCH_ABORTED, or the smallest
+ * estimated total length over the positions we couldn't explore.
+ */
+static int search(struct search *s, int depth, int est, int bound, int prev)
+{
+    int d, ret = INT_MAX;
+    int gx = s->gap % s->w, gy = s->gap / s->w;
+
+    if (depth + est > bound)
+        return depth + est;
+    if (est == 0)
+        return SEARCH_FOUND;   /* every tile is home, so the gap is too */
+    if (++s->nodes > SEARCH_MAX_NODES)
+        return SEARCH_ABORTED;
+
+    for (d = 0; d < 4; d++) {
+        int nx = gx + (d == 0) - (d == 1);
+        int ny = gy + (d == 2) - (d == 3);
+        int np, tile, g, oldindex, newest, r, gap = s->gap;
+
+        if (nx < 0 || nx >= s->w || ny < 0 || ny >= s->h)
+            continue;
+        np = ny * s->w + nx;
+        if (np == prev)
+            continue;                  /* don't just undo the last move */
+
+        tile = s->tiles[np];
+        g = s->pdb->group[tile];
+        oldindex = s->index[g];
+        s->index[g] += (gap - np) * s->pdb->mult[tile];
+        newest = est - s->pdb->tables[g][oldindex] +
+            s->pdb->tables[g][s->index[g]];
+        s->tiles[gap] = tile;
+        s->tiles[np] = 0;
+        s->gap = np;
+        s->path[depth] = np;
+
+        r = search(s, depth + 1, newest, bound, gap);
+
+        s->gap = gap;
+        s->tiles[np] = tile;
+        s->tiles[gap] = 0;
+        s->index[g] = oldindex;
+
+        if (r == SEARCH_FOUND || r == SEARCH_ABORTED)
+            return r;
+        if (r < ret)
+            ret = r;
+    }
+    return ret;
+}
+
+/*
+ * The last solution found, so that asking for hint after hint along
+ * it doesn't repeat the search each time.
+ */
+static struct {
+    int n;
+    int *tiles;                /* the position it was found from */
+    int *path;
+    int len;
+} last_solution;
+
+static bool optimal_hint(const game_state *state, int *out_x, int *out_y)
+{
+    const int w = state->w, h = state->h, n = state->n;
+    const struct pdb *pdb;
+    struct search s;
+    int i, est, bound, r;
+
+    /*
+     * See if we're somewhere along the last solution we found.
+     */
+    cache_lock();
+    if (last_solution.n == n && last_solution.len > 0) {
+        int *tiles = snewn(n, int), gap = 0;
+
+        memcpy(tiles, last_solution.tiles, n * sizeof(int));
+        for (i = 0; i < n; i++)
+            if (tiles[i] == 0)
+                gap = i;
+        for (i = 0; i < last_solution.len; i++) {
+            int np = last_solution.path[i];
+            if (!memcmp(tiles, state->tiles, n * sizeof(int)))
+                break;
+            tiles[gap] = tiles[np];
+            tiles[np] = 0;
+            gap = np;
+        }
+        sfree(tiles);
+        if (i < last_solution.len) {
+            *out_x = X(state, last_solution.path[i]);
+            *out_y = Y(state, last_solution.path[i]);
+            cache_unlock();
+            return true;
+        }
+    }
+    cache_unlock();
+
+    pdb = pdb_get(w, h);
+    if (!pdb)
+        return false;
+
+    s.pdb = pdb;
+    s.w = w;
+    s.h = h;
+    s.n = n;
+    s.tiles = snewn(n, int);
+    memcpy(s.tiles, state->tiles, n * sizeof(int));
+    s.gap = state->gap_pos;
+    s.index = snewn(pdb->ngroups, int);
+    for (i = 0; i < pdb->ngroups; i++)
+        s.index[i] = 0;
+    for (i = 0; i < n; i++)
+        if (s.tiles[i])
+            s.index[pdb->group[s.tiles[i]]] += i * pdb->mult[s.tiles[i]];
+    est = 0;
+    for (i = 0; i < pdb->ngroups; i++)
+        est += pdb->tables[i][s.index[i]];
+    s.nodes = 0;
+    s.path = NULL;
+
+    for (bound = est; ; bound = r) {
+        sfree(s.path);
+        s.path = snewn(bound > 0 ? bound : 1, int);
+        r = search(&s, 0, est, bound, -1);
+        if (r == SEARCH_FOUND || r == SEARCH_ABORTED || r == INT_MAX)
+            break;
+    }
+
+    sfree(s.index);
+    sfree(s.tiles);
+    if (r != SEARCH_FOUND || bound == 0) {
+        sfree(s.path);
+        return false;
+    }
+
+    *out_x = X(state, s.path[0]);
+    *out_y = Y(state, s.path[0]);
+
+    cache_lock();
+    sfree(last_solution.tiles);
+    sfree(last_solution.path);
+    last_solution.n = n;
+    last_solution.tiles = snewn(n, int);
+    memcpy(last_solution.tiles, state->tiles, n * sizeof(int));
+    last_solution.path = s.path;
+    last_solution.len = bound;
+    cache_unlock();
+    return true;
+}
+
+static bool compute_hint(const game_state *state, int *out_x, int *out_y)
+{
+    assert(out_x);
+    assert(out_y);
+
+    if (optimal_hint(state, out_x, out_y))
+        return true;
+    return greedy_hint(state, out_x, out_y);
+}
+
+static char *solve_step(const game_state *state, const game_state *currstate,
+                        const char *aux, const char **error)
+{
+    char buf[80];
+    int x, y;
+
+    if (!compute_hint(currstate, &x, &y)) {
+        *error = "Puzzle is already solved";
+        return NULL;
+    }
+    sprintf(buf, "M%d,%d", x, y);
+    return dupstr(buf);
+}
+
 static char *interpret_move(const game_state *state, game_ui *ui,
                             const game_drawstate *ds,
                             int x, int y, int button)
@@ -1155,7 +1569,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    solve_step,
+    NULL, /* grade */
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     get_prefs, set_prefs,
     new_ui,
@@ -299,13 +299,17 @@ struct solver_state
      * mallocing/freeing them every time that function is called. */
     int *bm, *bmminsize;
     DSF *bmdsf;
+
+    /* The squares check_capacity's flood fill has marked, so it can
+     * unmark just those rather than sweeping the whole board. */
+    int *flooded, nflooded;
 };
 
 static void print_board(int *board, int w, int h) {
     if (verbose) {
 	char *repr = board_to_string(board, w, h);
 	printv("%s\n", repr);
-	free(repr);
+	sfree(repr);
     }
 }
 
@@ -458,7 +462,7 @@ retry:
         }
     } while (change);
 
-    for (i = 0; i < sz; ++i) board[i] = dsf_size(dsf, i);
+    dsf_size_all(dsf, board);
     merge_ones(board, w, h);
 
     dsf_free(dsf);
@@ -504,22 +508,16 @@ static void expand(struct solver_state *s, int w, int h, int t, int f) {
     --s->nempty;
 }
 
-static void clear_count(int *board, int sz) {
-    int i;
-    for (i = 0; i < sz; ++i) {
-        if (board[i] >= 0) continue;
-        else if (board[i] == -SENTINEL) board[i] = EMPTY;
-        else board[i] = -board[i];
-    }
-}
-
-static void flood_count(int *board, int w, int h, int i, int n, int *c) {
+static void flood_count(struct solver_state *s, int w, int h, int i, int n,
+                        int *c) {
     const int sz = w * h;
+    int *board = s->board;
     int k;
 
     if (board[i] == EMPTY) board[i] = -SENTINEL;
     else if (board[i] == n) board[i] = -board[i];
     else return;
+    s->flooded[s->nflooded++] = i;
 
     if (--*c == 0) return;
 
@@ -528,15 +526,27 @@ static void flood_count(int *board, int w, int h, int i, int n, int *c) {
         const int y = (i / w) + dy[k];
         const int idx = w*y + x;
         if (x < 0 || x >= w || y < 0 || y >= h) continue;
-        flood_count(board, w, h, idx, n, c);
+        flood_count(s, w, h, idx, n, c);
 	if (*c == 0) return;
     }
 }
 
-static bool check_capacity(int *board, int w, int h, int i) {
-    int n = board[i];
-    flood_count(board, w, h, i, board[i], &n);
-    clear_count(board, w * h);
+/* Can the region at i still reach its full size without square
+ * 'blocked' (which must be empty, and is left so)? */
+static bool check_capacity(struct solver_state *s, int w, int h, int i,
+                           int blocked) {
+    const int sz = w * h;
+    int n = s->board[i];
+    assert(s->board[blocked] == EMPTY);
+    s->board[blocked] = -SENTINEL;
+    s->nflooded = 0;
+    flood_count(s, w, h, i, s->board[i], &n);
+    while (s->nflooded > 0) {
+        const int k = s->flooded[--s->nflooded];
+        if (s->board[k] == -SENTINEL) s->board[k] = EMPTY;
+        else s->board[k] = -s->board[k];
+    }
+    s->board[blocked] = EMPTY;
     return n == 0;
 }
 
@@ -666,9 +676,7 @@ static bool learn_expand_or_one(struct solver_state *s, int w, int h) {
 					      i, s->board[idx]))))
 		one = false;
 	    if (dsf_size(s->dsf, idx) == s->board[idx]) continue;
-	    assert(s->board[i] == EMPTY);
-	    s->board[i] = -SENTINEL;
-	    if (check_capacity(s->board, w, h, idx)) continue;
+	    if (check_capacity(s, w, h, idx, i)) continue;
 	    assert(s->board[i] == EMPTY);
 	    printv("learn: expanding in one\n");
 	    expand(s, w, h, i, idx);
@@ -806,8 +814,7 @@ static bool learn_critical_square(struct solver_state *s, int w, int h) {
 		} while (i != k);
 		if (i == k) continue; /* not within range */
 	    } else continue;
-	    s->board[j] = -SENTINEL;
-	    if (check_capacity(s->board, w, h, i)) continue;
+	    if (check_capacity(s, w, h, i, j)) continue;
 	    /* if not expanding s->board[i] to s->board[j] implies
 	     * that s->board[i] can't reach its full size, ... */
 	    assert(s->nempty);
@@ -1091,6 +1098,7 @@ static bool solver(const int *orig, int w, int h, char **solution) {
     ss.bm = snewn(sz, int);
     ss.bmdsf = dsf_new(sz);
     ss.bmminsize = snewn(sz, int);
+    ss.flooded = snewn(sz, int);
 
     printv("trying to solve this:\n");
     print_board(ss.board, w, h);
@@ -1121,6 +1129,7 @@ static bool solver(const int *orig, int w, int h, char **solution) {
     sfree(ss.bm);
     dsf_free(ss.bmdsf);
     sfree(ss.bmminsize);
+    sfree(ss.flooded);
 
     return !ss.nempty;
 }
@@ -1287,13 +1296,7 @@ static const char *validate_desc(const game_params *params, const char *desc)
     for (area = 0; *desc; ++desc) {
 	if (*desc >= 'a' && *desc <= 'z') area += *desc - 'a' + 1;
 	else if (*desc >= '0' && *desc <= m) ++area;
-	else {
-	    static char s[] =  "Invalid character '%""' in game description";
-	    int n = sprintf(s, "Invalid character '%1c' in game description",
-			    *desc);
-	    assert(n + 1 <= lenof(s)); /* +1 for the terminating NUL */
-	    return s;
-	}
+	else return "Invalid character in game description";
 	if (area > sz) return "Too much data to fit in grid";
     }
     return (area < sz) ? "Not enough data to fill grid" : NULL;
@@ -2178,7 +2181,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
@@ -2202,7 +2209,7 @@ const struct game thegame = {
     true, false, game_print_size, game_print,
     false,				   /* wants_statusbar */
     false, NULL,                       /* timing_state */
-    REQUIRE_NUMPAD,		       /* flags */
+    REQUIRE_NUMPAD | SOLVE_FROM_ORIG,		       /* flags */
 };
 
 #ifdef STANDALONE_SOLVER /* solver? hah! */
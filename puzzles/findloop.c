@@ -24,6 +24,7 @@ struct findloopstate {
     int depth, shallowest_reachable, subtree_size;
     int parent, component_root;
     int prev, next;
+    bool has_loop;                     /* only valid at component_root */
 };
 
 struct findloopstate *findloop_new_state(int nvertices)
@@ -78,8 +79,24 @@ bool findloop_is_bridge(
 	    findloop_is_bridge_oneway(pv, v, u, v_vertices, u_vertices));
 }
 
-bool findloop_run(struct findloopstate *pv, int nvertices,
-		  neighbour_fn_t neighbour, void *ctx)
+static void findloop_init_vertex(struct findloopstate *pv, int u,
+                                 int nvertices)
+{
+    pv[u].depth = -1;
+    pv[u].shallowest_reachable = nvertices;
+    pv[u].subtree_size = 1;
+    pv[u].parent = -1;
+    pv[u].component_root = u;
+    pv[u].has_loop = false;
+}
+
+/*
+ * The search itself, over the vertices in the linked list starting at
+ * 'first'. Every neighbour of a vertex in the list must be in the list
+ * too, and have been passed to findloop_init_vertex.
+ */
+static bool findloop_search(struct findloopstate *pv, int first,
+                            neighbour_fn_t neighbour, void *ctx)
 {
     int u, v, w;
     bool any_loop = false;
@@ -106,7 +123,7 @@ bool findloop_run(struct findloopstate *pv, int nvertices,
      * second time we move to the next node in the list, which is a
      * sibling or a parent, or if we're at the root of the connected
      * component will be a node in the next component. (All the nodes
-     * of the graph always appear in the list)
+     * being searched always appear in the list)
      * A linked list is used to handle the case where the same child
      * appears in two levels, to allow us to efficiently remove it from
      * its previous position.
@@ -131,19 +148,7 @@ bool findloop_run(struct findloopstate *pv, int nvertices,
      *   w = neighbour iterator
      */
 
-    for (u = 0; u < nvertices; u++) {
-	pv[u].depth = -1;
-	pv[u].shallowest_reachable = nvertices;
-	pv[u].subtree_size = 1;
-	pv[u].parent = -1;
-	pv[u].component_root = u;
-	pv[u].prev = u - 1;
-	pv[u].next = (u == nvertices - 1) ? -1 : u + 1;
-    }
-
-    debug(("------------- new find_loops, nvertices=%d\n", nvertices));
-
-    v = 0;
+    v = first;
     while (v != -1) {
 	u = v;
 	if (pv[u].depth < 0) {
@@ -183,6 +188,7 @@ bool findloop_run(struct findloopstate *pv, int nvertices,
 		    debug(("    found back-edge %d-%d\n", u, w));
 		    pv[u].shallowest_reachable =
 			min(pv[u].shallowest_reachable, pv[w].depth);
+		    pv[pv[u].component_root].has_loop = true;
 		    any_loop = true;
 		}
 	    }
@@ -204,3 +210,71 @@ bool findloop_run(struct findloopstate *pv, int nvertices,
 
     return any_loop;
 }
+
+bool findloop_run(struct findloopstate *pv, int nvertices,
+		  neighbour_fn_t neighbour, void *ctx)
+{
+    int u;
+
+    for (u = 0; u < nvertices; u++) {
+	findloop_init_vertex(pv, u, nvertices);
+	pv[u].prev = u - 1;
+	pv[u].next = (u == nvertices - 1) ? -1 : u + 1;
+    }
+
+    debug(("------------- new find_loops, nvertices=%d\n", nvertices));
+
+    return nvertices > 0 && findloop_search(pv, 0, neighbour, ctx);
+}
+
+bool findloop_rerun(struct findloopstate *pv, int nvertices,
+                    const int *changed, int nchanged,
+                    neighbour_fn_t neighbour, void *ctx)
+{
+    int i, u, first, last;
+    bool any_loop = false;
+
+    /*
+     * An edge change can only affect the components that its
+     * endpoints were in before the change (an added edge merges two
+     * of them, a deleted one may split one). So mark the old roots of
+     * those components, by temporarily setting their depth (which is
+     * otherwise 0) to -2.
+     */
+    for (i = 0; i < nchanged; i++)
+        pv[pv[changed[i]].component_root].depth = -2;
+
+    /*
+     * Chain all the vertices of the marked components into a list in
+     * increasing order, which is the order findloop_run would visit
+     * them in. That way, and since the search of each component is
+     * independent of every other, what we end up with is exactly what
+     * findloop_run would have computed afresh.
+     */
+    first = last = -1;
+    for (u = 0; u < nvertices; u++) {
+        if (pv[pv[u].component_root].depth != -2)
+            continue;
+        pv[u].prev = last;
+        pv[u].next = -1;
+        if (last >= 0)
+            pv[last].next = u;
+        else
+            first = u;
+        last = u;
+    }
+    for (u = first; u >= 0; u = pv[u].next)
+        findloop_init_vertex(pv, u, nvertices);
+
+    debug(("------------- find_loops rerun, nvertices=%d\n", nvertices));
+
+    if (first >= 0)
+        findloop_search(pv, first, neighbour, ctx);
+
+    /* The components we didn't search still know whether they had loops. */
+    for (u = 0; u < nvertices; u++)
+        if (pv[u].component_root == u && pv[u].has_loop)
+            any_loop = true;
+
+    return any_loop;
+}
@@ -678,19 +678,41 @@ static void free_game(game_state *state)
     sfree(state);
 }
 
-static void rowxor(unsigned char *row1, unsigned char *row2, int len)
+/*
+ * The solver packs each equation into a bitmap, bit j for the
+ * coefficient of square j and bit wh for the value, so that it can
+ * XOR rows together a word at a time.
+ */
+static void rowxor(unsigned long *row1, const unsigned long *row2, int len)
 {
     int i;
     for (i = 0; i < len; i++)
 	row1[i] ^= row2[i];
 }
 
+static int word_parity(unsigned long x)
+{
+    unsigned shift;
+    for (shift = BITMAP_WORD_BITS / 2; shift; shift >>= 1)
+        x ^= x >> shift;
+    return x & 1;
+}
+
+static int word_popcount(unsigned long x)
+{
+    int n = 0;
+    for (; x; x &= x - 1)
+        n++;
+    return n;
+}
+
 static char *solve_game(const game_state *state, const game_state *currstate,
                         const char *aux, const char **error)
 {
     int w = state->w, h = state->h, wh = w * h;
-    unsigned char *equations, *solution, *shortest;
-    int *und, nund;
+    int nw = BITMAP_WORDS(wh + 1);
+    unsigned long *equations, *solution, *shortest;
+    int *und, nund, *pivots;
     int rowsdone, colsdone;
     int i, j, k, len, bestlen;
     char *ret;
@@ -699,11 +721,14 @@ static char *solve_game(const game_state *state, const game_state *currstate,
      * Set up a list of simultaneous equations. Each one is of
      * length (wh+1) and has wh coefficients followed by a value.
      */
-    equations = snewn((wh + 1) * wh, unsigned char);
+    equations = snewn(nw * wh, unsigned long);
+    memset(equations, 0, nw * wh * sizeof(unsigned long));
     for (i = 0; i < wh; i++) {
 	for (j = 0; j < wh; j++)
-	    equations[i * (wh+1) + j] = currstate->matrix->matrix[j*wh+i];
-	equations[i * (wh+1) + wh] = currstate->grid[i] & 1;
+	    if (currstate->matrix->matrix[j*wh+i])
+                BITMAP_SET(equations + i * nw, j);
+	if (currstate->grid[i] & 1)
+            BITMAP_SET(equations + i * nw, wh);
     }
 
     /*
@@ -712,6 +737,7 @@ static char *solve_game(const game_state *state, const game_state *currstate,
     rowsdone = colsdone = 0;
     nund = 0;
     und = snewn(wh, int);
+    pivots = snewn(wh, int);
     do {
 	/*
 	 * Find the leftmost column which has a 1 in it somewhere
@@ -720,7 +746,7 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 	j = -1;
 	for (i = colsdone; i < wh; i++) {
 	    for (j = rowsdone; j < wh; j++)
-		if (equations[j * (wh+1) + i])
+		if (BITMAP_GET(equations + j * nw, i))
 		    break;
 	    if (j < wh)
 		break;		       /* found one */
@@ -740,10 +766,11 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 	 */
 	if (i == wh) {
 	    for (j = rowsdone; j < wh; j++)
-		if (equations[j * (wh+1) + wh]) {
+		if (BITMAP_GET(equations + j * nw, wh)) {
 		    *error = "No solution exists for this position";
 		    sfree(equations);
 		    sfree(und);
+		    sfree(pivots);
 		    return NULL;
 		}
 	    break;
@@ -753,23 +780,28 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 	 * We've found a 1. It's in column i, and the topmost 1 in
 	 * that column is in row j. Do a row-XOR to move it up to
 	 * the topmost row if it isn't already there.
+         *
+         * All the rows from here down are zero to the left of column
+         * i, so the XORs can start at the word containing it.
 	 */
 	assert(j != -1);
+        k = i / BITMAP_WORD_BITS;
 	if (j > rowsdone)
-	    rowxor(equations + rowsdone*(wh+1), equations + j*(wh+1), wh+1);
+	    rowxor(equations + rowsdone*nw + k, equations + j*nw + k, nw - k);
 
 	/*
 	 * Do row-XORs to eliminate that 1 from all rows below the
 	 * topmost row.
 	 */
 	for (j = rowsdone + 1; j < wh; j++)
-	    if (equations[j*(wh+1) + i])
-		rowxor(equations + j*(wh+1),
-		       equations + rowsdone*(wh+1), wh+1);
+	    if (BITMAP_GET(equations + j * nw, i))
+		rowxor(equations + j*nw + k,
+		       equations + rowsdone*nw + k, nw - k);
 
 	/*
 	 * Mark this row and column as done.
 	 */
+        pivots[rowsdone] = i;
 	rowsdone++;
 	colsdone = i+1;
 
@@ -784,10 +816,14 @@ static char *solve_game(const game_state *state, const game_state *currstate,
      * corresponding to a set of arbitrary choices of those
      * components not directly determined by an equation), and pick
      * one requiring the smallest number of flips.
+     *
+     * The solution is a bitmap like the equations, with bit wh
+     * always clear, so that each variable can be computed from the
+     * rest by ANDing its equation with it.
      */
-    solution = snewn(wh, unsigned char);
-    shortest = snewn(wh, unsigned char);
-    memset(solution, 0, wh);
+    solution = snewn(nw, unsigned long);
+    shortest = snewn(nw, unsigned long);
+    memset(solution, 0, nw * sizeof(unsigned long));
     bestlen = wh + 1;
     while (1) {
 	/*
@@ -795,25 +831,20 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 	 * undetermined variables.
 	 */
 	for (j = rowsdone; j-- ;) {
-	    int v;
+            const unsigned long *eq = equations + j * nw;
+	    unsigned long acc;
 
 	    /*
-	     * Find the leftmost set bit in this equation.
+	     * The leftmost set bit in this equation is its pivot.
+             * Compute that variable using the rest.
 	     */
-	    for (i = 0; i < wh; i++)
-		if (equations[j * (wh+1) + i])
-		    break;
-	    assert(i < wh);		       /* there must have been one! */
-
-	    /*
-	     * Compute this variable using the rest.
-	     */
-	    v = equations[j * (wh+1) + wh];
-	    for (k = i+1; k < wh; k++)
-		if (equations[j * (wh+1) + k])
-		    v ^= solution[k];
-
-	    solution[i] = v;
+	    i = pivots[j];
+            BITMAP_CLEAR(solution, i);
+            acc = 0;
+            for (k = i / BITMAP_WORD_BITS; k < nw; k++)
+                acc ^= eq[k] & solution[k];
+	    if (word_parity(acc) ^ BITMAP_GET(eq, wh))
+                BITMAP_SET(solution, i);
 	}
 
 	/*
@@ -821,12 +852,11 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 	 * replace the best one if this one is shorter.
 	 */
 	len = 0;
-	for (i = 0; i < wh; i++)
-	    if (solution[i])
-		len++;
+	for (k = 0; k < nw; k++)
+	    len += word_popcount(solution[k]);
 	if (len < bestlen) {
 	    bestlen = len;
-	    memcpy(shortest, solution, wh);
+	    memcpy(shortest, solution, nw * sizeof(unsigned long));
 	}
 
 	/*
@@ -835,8 +865,8 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 	 * a 0, at which point we turn it into a 1.
 	 */
 	for (i = 0; i < nund; i++) {
-	    solution[und[i]] = !solution[und[i]];
-	    if (solution[und[i]])
+	    BITMAP_FLIP(solution, und[i]);
+	    if (BITMAP_GET(solution, und[i]))
 		break;
 	}
 
@@ -856,13 +886,14 @@ static char *solve_game(const game_state *state, const game_state *currstate,
     ret = snewn(wh + 2, char);
     ret[0] = 'S';
     for (i = 0; i < wh; i++)
-	ret[i+1] = shortest[i] ? '1' : '0';
+	ret[i+1] = BITMAP_GET(shortest, i) ? '1' : '0';
     ret[wh+1] = '\0';
 
     sfree(shortest);
     sfree(solution);
     sfree(equations);
     sfree(und);
+    sfree(pivots);
 
     return ret;
 }
@@ -1327,7 +1358,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
@@ -230,68 +230,6 @@ static const char *validate_params(const game_params *params, bool full)
     return NULL;
 }
 
-#if 0
-/*
- * Bodge to permit varying the recursion depth for testing purposes.
-
-To test two Floods against each other:
-
-paste <(./flood.1 --generate 100 12x12c6m0#12345 | cut -f2 -d,) <(./flood.2 --generate 100 12x12c6m0#12345 | cut -f2 -d,) | awk '{print $2-$1}' | sort -n | uniq -c | awk '{print $2,$1}' | tee z
-
-and then run gnuplot and plot "z".
-
- */
-static int rdepth = 0;
-#define RECURSION_DEPTH (rdepth)
-void check_recursion_depth(void)
-{
-    if (!rdepth) {
-        const char *depthstr = getenv("FLOOD_DEPTH");
-        rdepth = depthstr ? atoi(depthstr) : 1;
-        rdepth = rdepth > 0 ? rdepth : 1;
-    }
-}
-#else
-/*
- * Last time I empirically checked this, depth 3 was a noticeable
- * improvement on 2, but 4 only negligibly better than 3.
- */
-#define RECURSION_DEPTH 3
-#define check_recursion_depth() (void)0
-#endif
-
-struct solver_scratch {
-    int *queue[2];
-    int *dist;
-    char *grid, *grid2;
-    char *rgrids;
-};
-
-static struct solver_scratch *new_scratch(int w, int h)
-{
-    int wh = w*h;
-    struct solver_scratch *scratch = snew(struct solver_scratch);
-    check_recursion_depth();
-    scratch->queue[0] = snewn(wh, int);
-    scratch->queue[1] = snewn(wh, int);
-    scratch->dist = snewn(wh, int);
-    scratch->grid = snewn(wh, char);
-    scratch->grid2 = snewn(wh, char);
-    scratch->rgrids = snewn(wh * RECURSION_DEPTH, char);
-    return scratch;
-}
-
-static void free_scratch(struct solver_scratch *scratch)
-{
-    sfree(scratch->queue[0]);
-    sfree(scratch->queue[1]);
-    sfree(scratch->dist);
-    sfree(scratch->grid);
-    sfree(scratch->grid2);
-    sfree(scratch->rgrids);
-    sfree(scratch);
-}
-
 #if 0
 /* Diagnostic routines you can uncomment if you need them */
 void dump_grid(int w, int h, const char *grid, const char *titlefmt, ...)
@@ -337,86 +275,6 @@ void dump_dist(int w, int h, const int *dists, const char *titlefmt, ...)
 }
 #endif
 
-/*
- * Search a grid to find the most distant square(s). Return their
- * distance and the number of them, and also the number of squares in
- * the current controlled set (i.e. at distance zero).
- */
-static void search(int w, int h, char *grid, int x0, int y0,
-                   struct solver_scratch *scratch,
-                   int *rdist, int *rnumber, int *rcontrol)
-{
-    int wh = w*h;
-    int i, qcurr, qhead, qtail, qnext, currdist, remaining;
-
-    for (i = 0; i < wh; i++)
-        scratch->dist[i] = -1;
-    scratch->queue[0][0] = y0*w+x0;
-    scratch->queue[1][0] = y0*w+x0;
-    scratch->dist[y0*w+x0] = 0;
-    currdist = 0;
-    qcurr = 0;
-    qtail = 0;
-    qhead = 1;
-    qnext = 1;
-    remaining = wh - 1;
-
-    while (1) {
-        if (qtail == qhead) {
-            /* Switch queues. */
-            if (currdist == 0)
-                *rcontrol = qhead;
-            currdist++;
-            qcurr ^= 1;                    /* switch queues */
-            qhead = qnext;
-            qtail = 0;
-            qnext = 0;
-#if 0
-            printf("switch queue, new dist %d, queue %d\n", currdist, qhead);
-#endif
-        } else if (remaining == 0 && qnext == 0) {
-            break;
-        } else {
-            int pos = scratch->queue[qcurr][qtail++];
-            int y = pos / w;
-            int x = pos % w;
-#if 0
-            printf("checking neighbours of %d,%d\n", x, y);
-#endif
-            int dir;
-            for (dir = 0; dir < 4; dir++) {
-                int y1 = y + (dir == 1 ? 1 : dir == 3 ? -1 : 0);
-                int x1 = x + (dir == 0 ? 1 : dir == 2 ? -1 : 0);
-                if (0 <= x1 && x1 < w && 0 <= y1 && y1 < h) {
-                    int pos1 = y1*w+x1;
-#if 0
-                    printf("trying %d,%d: colours %d-%d dist %d\n", x1, y1,
-                           grid[pos], grid[pos1], scratch->dist[pos]);
-#endif
-                    if (scratch->dist[pos1] == -1 &&
-                        ((grid[pos1] == grid[pos] &&
-                          scratch->dist[pos] == currdist) ||
-                         (grid[pos1] != grid[pos] &&
-                          scratch->dist[pos] == currdist - 1))) {
-#if 0
-                        printf("marking %d,%d dist %d\n", x1, y1, currdist);
-#endif
-                        scratch->queue[qcurr][qhead++] = pos1;
-                        scratch->queue[qcurr^1][qnext++] = pos1;
-                        scratch->dist[pos1] = currdist;
-                        remaining--;
-                    }
-                }
-            }
-        }
-    }
-
-    *rdist = currdist;
-    *rnumber = qhead;
-    if (currdist == 0)
-        *rcontrol = qhead;
-}
-
 /*
  * Enact a flood-fill move on a grid.
  */
@@ -467,90 +325,535 @@ static bool completed(int w, int h, char *grid)
     return true;
 }
 
+#if 0
+/*
+ * Bodge to permit varying the beam width for testing purposes.
+
+To test two Floods against each other:
+
+paste <(./flood.1 --generate 100 12x12c6m0#12345 | cut -f2 -d,) <(./flood.2 --generate 100 12x12c6m0#12345 | cut -f2 -d,) | awk '{print $2-$1}' | sort -n | uniq -c | awk '{print $2,$1}' | tee z
+
+and then run gnuplot and plot "z".
+
+ */
+static int rbeam = 0;
+#define BEAM_WIDTH (rbeam)
+void check_beam_width(void)
+{
+    if (!rbeam) {
+        const char *beamstr = getenv("FLOOD_BEAM");
+        rbeam = beamstr ? atoi(beamstr) : 1;
+        rbeam = rbeam > 0 ? rbeam : 1;
+    }
+}
+#else
+/*
+ * Last time I empirically checked this, doubling the width to 32 saved
+ * under half a percent of moves, for twice the time.
+ */
+#define BEAM_WIDTH 16
+#define check_beam_width() (void)0
+#endif
+
 /*
- * Try out every possible move on a grid, and choose whichever one
- * reduced the result of search() by the most.
+ * The solver works on the grid's regions (maximal connected areas of
+ * one colour) rather than its squares. A position is then just the
+ * set of regions flooded so far, since the flooded area's colour
+ * never matters to what it can do next: every region adjacent to it
+ * is some other colour. A move in colour c adds every region of
+ * colour c on the frontier, and the regions they border join the
+ * frontier.
+ *
+ * We search for a short solution with a beam search. Each move, we
+ * try every colour on the frontier of every position in the beam,
+ * and keep the BEAM_WIDTH best results, according to what search()
+ * says about them. A position already seen (in this move or an
+ * earlier one) is not kept again. Positions are identified by the
+ * XOR of a random key per region they contain (a Zobrist hash); a
+ * false match between two different positions, which hardly ever
+ * happens, only means a position goes unexplored.
  */
-static char choosemove_recurse(int w, int h, char *grid, int x0, int y0,
-                               int maxmove, struct solver_scratch *scratch,
-                               int depth, int *rbestdist, int *rbestnumber, int *rbestcontrol)
+
+struct position {
+    unsigned long *flooded;            /* bitmap of regions */
+    int *frontier, nfrontier;          /* regions adjacent to the flood */
+    int area;                          /* number of squares flooded */
+    uint32 hash[2];
+    int trail;                         /* index of its last move in trail */
+};
+
+struct candidate {
+    int parent;                        /* index in the current beam */
+    char move;
+    int dist, number, area;
+    uint32 hash[2];
+};
+
+struct trail {
+    int parent;                        /* earlier trail index, or -1 */
+    char move;
+};
+
+struct solver_scratch {
+    int w, h, wh, colours;
+    int nregions, nwords;
+    int *region;                       /* region containing each square */
+    int *colour, *size;                /* of each region */
+    int *adjstart, *adj;               /* region r borders adj[adjstart[r]]
+                                        * to adj[adjstart[r+1]-1] */
+    uint32 *keys;                      /* two per region */
+
+    int *queue, *dist, *seen, stamp;   /* by region */
+
+    struct position *beam, *next, tmp;
+    struct candidate *cands;
+    struct trail *trail;
+    int ntrail, trailsize;
+
+    uint32 *visited;                   /* hash set of positions, in pairs */
+    int nvisited, visitedsize;
+};
+
+static void position_init(struct solver_scratch *scratch, struct position *pos)
+{
+    pos->flooded = snewn(scratch->nwords, unsigned long);
+    pos->frontier = snewn(scratch->nregions, int);
+}
+
+static void position_free(struct position *pos)
+{
+    sfree(pos->flooded);
+    sfree(pos->frontier);
+}
+
+static struct solver_scratch *new_scratch(int w, int h, const char *grid,
+                                          int colours)
 {
     int wh = w*h;
-    char move, bestmove;
-    int dist, number, control, bestdist, bestnumber, bestcontrol;
-    char *tmpgrid;
+    struct solver_scratch *scratch = snew(struct solver_scratch);
+    random_state *keyrs;
+    int i, j, r, nadj, qhead, qtail;
+
+    check_beam_width();
+    scratch->w = w;
+    scratch->h = h;
+    scratch->wh = wh;
+    scratch->colours = colours;
+    scratch->region = snewn(wh, int);
+    scratch->queue = snewn(wh, int);
+    scratch->seen = snewn(wh, int);
+    scratch->stamp = 0;
+
+    /*
+     * Divide the grid into regions, numbering them in order of their
+     * first square so that the one containing the fill point (which
+     * is square 0) is region 0.
+     */
+    assert(FILLX == 0 && FILLY == 0);
+    for (i = 0; i < wh; i++)
+        scratch->region[i] = -1;
+    scratch->nregions = 0;
+    for (i = 0; i < wh; i++) {
+        if (scratch->region[i] >= 0)
+            continue;
+        r = scratch->nregions++;
+        scratch->region[i] = r;
+        scratch->queue[0] = i;
+        qtail = 0;
+        qhead = 1;
+        while (qtail < qhead) {
+            int pos = scratch->queue[qtail++];
+            int y = pos / w;
+            int x = pos % w;
+            int dir;
+            for (dir = 0; dir < 4; dir++) {
+                int y1 = y + (dir == 1 ? 1 : dir == 3 ? -1 : 0);
+                int x1 = x + (dir == 0 ? 1 : dir == 2 ? -1 : 0);
+                if (0 <= x1 && x1 < w && 0 <= y1 && y1 < h) {
+                    int pos1 = y1*w+x1;
+                    if (scratch->region[pos1] < 0 && grid[pos1] == grid[i]) {
+                        scratch->region[pos1] = r;
+                        scratch->queue[qhead++] = pos1;
+                    }
+                }
+            }
+        }
+    }
 
-    assert(0 <= depth && depth < RECURSION_DEPTH);
-    tmpgrid = scratch->rgrids + depth*wh;
+    scratch->colour = snewn(scratch->nregions, int);
+    scratch->size = snewn(scratch->nregions, int);
+    scratch->adjstart = snewn(scratch->nregions + 1, int);
+    for (r = 0; r < scratch->nregions; r++)
+        scratch->size[r] = scratch->adjstart[r] = 0;
+    for (i = 0; i < wh; i++) {
+        scratch->colour[scratch->region[i]] = grid[i];
+        scratch->size[scratch->region[i]]++;
+    }
 
-    bestdist = wh + 1;
-    bestnumber = 0;
-    bestcontrol = 0;
-    bestmove = -1;
+    /*
+     * Find which regions border which. Each pair of adjacent squares
+     * in different regions gives an entry in both regions' lists, so
+     * count those to find where each list starts, fill them in, and
+     * then remove the repeats.
+     */
+    for (i = 0; i < wh; i++) {
+        if (i % w + 1 < w && scratch->region[i+1] != scratch->region[i]) {
+            scratch->adjstart[scratch->region[i]]++;
+            scratch->adjstart[scratch->region[i+1]]++;
+        }
+        if (i + w < wh && scratch->region[i+w] != scratch->region[i]) {
+            scratch->adjstart[scratch->region[i]]++;
+            scratch->adjstart[scratch->region[i+w]]++;
+        }
+    }
+    for (r = nadj = 0; r < scratch->nregions; r++) {
+        int deg = scratch->adjstart[r];
+        scratch->adjstart[r] = nadj;
+        nadj += deg;
+    }
+    scratch->adjstart[scratch->nregions] = nadj;
+    scratch->adj = snewn(nadj ? nadj : 1, int);
+    scratch->dist = snewn(scratch->nregions, int);
+    for (r = 0; r < scratch->nregions; r++)
+        scratch->dist[r] = scratch->adjstart[r];   /* next free entry */
+    for (i = 0; i < wh; i++) {
+        int r0 = scratch->region[i];
+        if (i % w + 1 < w && scratch->region[i+1] != r0) {
+            int r1 = scratch->region[i+1];
+            scratch->adj[scratch->dist[r0]++] = r1;
+            scratch->adj[scratch->dist[r1]++] = r0;
+        }
+        if (i + w < wh && scratch->region[i+w] != r0) {
+            int r1 = scratch->region[i+w];
+            scratch->adj[scratch->dist[r0]++] = r1;
+            scratch->adj[scratch->dist[r1]++] = r0;
+        }
+    }
+    for (i = 0; i < scratch->nregions; i++)
+        scratch->seen[i] = -1;
+    for (r = nadj = 0; r < scratch->nregions; r++) {
+        int start = nadj;
+        for (j = scratch->adjstart[r]; j < scratch->adjstart[r+1]; j++) {
+            int r1 = scratch->adj[j];
+            if (scratch->seen[r1] != r) {
+                scratch->seen[r1] = r;
+                scratch->adj[nadj++] = r1;
+            }
+        }
+        scratch->adjstart[r] = start;
+    }
+    scratch->adjstart[scratch->nregions] = nadj;
+    for (i = 0; i < scratch->nregions; i++)
+        scratch->seen[i] = 0;
+
+    /* The keys are the same every time, to keep the solver repeatable. */
+    scratch->keys = snewn(2 * scratch->nregions, uint32);
+    keyrs = random_new("flood", 5);
+    for (i = 0; i < 2 * scratch->nregions; i++)
+        scratch->keys[i] = random_bits(keyrs, 32);
+    random_free(keyrs);
+
+    scratch->nwords = BITMAP_WORDS(scratch->nregions);
+    scratch->beam = snewn(BEAM_WIDTH, struct position);
+    scratch->next = snewn(BEAM_WIDTH, struct position);
+    for (i = 0; i < BEAM_WIDTH; i++) {
+        position_init(scratch, &scratch->beam[i]);
+        position_init(scratch, &scratch->next[i]);
+    }
+    position_init(scratch, &scratch->tmp);
+    scratch->cands = snewn(BEAM_WIDTH * colours, struct candidate);
+    scratch->trail = NULL;
+    scratch->ntrail = scratch->trailsize = 0;
+    scratch->visitedsize = 1024;
+    scratch->visited = snewn(2 * scratch->visitedsize, uint32);
+    memset(scratch->visited, 0, 2 * scratch->visitedsize * sizeof(uint32));
+    scratch->nvisited = 0;
 
-#if 0
-    dump_grid(w, h, grid, "before choosemove_recurse %d", depth);
-#endif
-    for (move = 0; move < maxmove; move++) {
-        if (grid[y0*w+x0] == move)
+    return scratch;
+}
+
+static void free_scratch(struct solver_scratch *scratch)
+{
+    int i;
+
+    for (i = 0; i < BEAM_WIDTH; i++) {
+        position_free(&scratch->beam[i]);
+        position_free(&scratch->next[i]);
+    }
+    position_free(&scratch->tmp);
+    sfree(scratch->beam);
+    sfree(scratch->next);
+    sfree(scratch->cands);
+    sfree(scratch->trail);
+    sfree(scratch->visited);
+    sfree(scratch->region);
+    sfree(scratch->colour);
+    sfree(scratch->size);
+    sfree(scratch->adjstart);
+    sfree(scratch->adj);
+    sfree(scratch->keys);
+    sfree(scratch->queue);
+    sfree(scratch->dist);
+    sfree(scratch->seen);
+    sfree(scratch);
+}
+
+/*
+ * Look a position up in the set of those already seen, and add it if
+ * asked to. Returns true if it was there already. (A hash whose
+ * second word is zero marks an empty slot, so that word always has
+ * its bottom bit set.)
+ */
+static bool visited(struct solver_scratch *scratch, const uint32 *hash,
+                    bool add)
+{
+    uint32 h0 = hash[0], h1 = hash[1] | 1;
+    int i;
+
+    if (add && scratch->nvisited * 2 >= scratch->visitedsize) {
+        uint32 *old = scratch->visited;
+        int oldsize = scratch->visitedsize;
+
+        scratch->visitedsize *= 2;
+        scratch->visited = snewn(2 * scratch->visitedsize, uint32);
+        memset(scratch->visited, 0,
+               2 * scratch->visitedsize * sizeof(uint32));
+        for (i = 0; i < oldsize; i++)
+            if (old[2*i+1]) {
+                int j = old[2*i] & (scratch->visitedsize - 1);
+                while (scratch->visited[2*j+1])
+                    j = (j + 1) & (scratch->visitedsize - 1);
+                scratch->visited[2*j] = old[2*i];
+                scratch->visited[2*j+1] = old[2*i+1];
+            }
+        sfree(old);
+    }
+
+    i = h0 & (scratch->visitedsize - 1);
+    while (scratch->visited[2*i+1]) {
+        if (scratch->visited[2*i] == h0 && scratch->visited[2*i+1] == h1)
+            return true;
+        i = (i + 1) & (scratch->visitedsize - 1);
+    }
+    if (add) {
+        scratch->visited[2*i] = h0;
+        scratch->visited[2*i+1] = h1;
+        scratch->nvisited++;
+    }
+    return false;
+}
+
+/*
+ * Make the position reached from 'from' by a move in colour 'move'.
+ */
+static void make_move(struct solver_scratch *scratch,
+                      const struct position *from, int move,
+                      struct position *to)
+{
+    int i, j, stamp = ++scratch->stamp;
+
+    memcpy(to->flooded, from->flooded, scratch->nwords * sizeof(unsigned long));
+    to->area = from->area;
+    to->hash[0] = from->hash[0];
+    to->hash[1] = from->hash[1];
+    for (i = 0; i < from->nfrontier; i++) {
+        int r = from->frontier[i];
+        if (scratch->colour[r] == move) {
+            BITMAP_SET(to->flooded, r);
+            to->area += scratch->size[r];
+            to->hash[0] ^= scratch->keys[2*r];
+            to->hash[1] ^= scratch->keys[2*r+1];
+        }
+    }
+
+    to->nfrontier = 0;
+    for (i = 0; i < from->nfrontier; i++) {
+        int r = from->frontier[i];
+        if (scratch->colour[r] != move) {
+            scratch->seen[r] = stamp;
+            to->frontier[to->nfrontier++] = r;
+        }
+    }
+    for (i = 0; i < from->nfrontier; i++) {
+        int r = from->frontier[i];
+        if (scratch->colour[r] != move)
             continue;
-        memcpy(tmpgrid, grid, wh * sizeof(*grid));
-        fill(w, h, tmpgrid, x0, y0, move, scratch->queue[0]);
-        if (completed(w, h, tmpgrid)) {
-            /*
-             * A move that wins is immediately the best, so stop
-             * searching. Record what depth of recursion that happened
-             * at, so that higher levels will choose a move that gets
-             * to a winning position sooner.
-             */
-            *rbestdist = -1;
-            *rbestnumber = depth;
-            *rbestcontrol = wh;
-            return move;
+        for (j = scratch->adjstart[r]; j < scratch->adjstart[r+1]; j++) {
+            int r1 = scratch->adj[j];
+            if (scratch->seen[r1] != stamp && !BITMAP_GET(to->flooded, r1)) {
+                scratch->seen[r1] = stamp;
+                to->frontier[to->nfrontier++] = r1;
+            }
         }
-        if (depth < RECURSION_DEPTH-1) {
-            choosemove_recurse(w, h, tmpgrid, x0, y0, maxmove, scratch,
-                               depth+1, &dist, &number, &control);
-        } else {
-#if 0
-            dump_grid(w, h, tmpgrid, "after move %d at depth %d",
-                      move, depth);
-#endif
-            search(w, h, tmpgrid, x0, y0, scratch, &dist, &number, &control);
-#if 0
-            dump_dist(w, h, scratch->dist, "after move %d at depth %d",
-                      move, depth);
-            printf("move %d at depth %d: %d at %d\n",
-                   depth, move, number, dist);
-#endif
+    }
+}
+
+/*
+ * Search outwards from a position to find the most distant region(s),
+ * i.e. those taking the most moves to reach. Return their distance
+ * and the number of them.
+ */
+static void search(struct solver_scratch *scratch, const struct position *pos,
+                   int *rdist, int *rnumber)
+{
+    int i, j, qhead, qtail, dist, number, stamp = ++scratch->stamp;
+
+    qhead = 0;
+    for (i = 0; i < pos->nfrontier; i++) {
+        int r = pos->frontier[i];
+        scratch->seen[r] = stamp;
+        scratch->dist[r] = 1;
+        scratch->queue[qhead++] = r;
+    }
+
+    dist = number = 0;
+    for (qtail = 0; qtail < qhead; qtail++) {
+        int r = scratch->queue[qtail];
+        if (scratch->dist[r] > dist) {
+            dist = scratch->dist[r];
+            number = 0;
         }
-        if (dist < bestdist ||
-            (dist == bestdist &&
-             (number < bestnumber ||
-              (number == bestnumber &&
-               (control > bestcontrol))))) {
-            bestdist = dist;
-            bestnumber = number;
-            bestcontrol = control;
-            bestmove = move;
+        number++;
+        for (j = scratch->adjstart[r]; j < scratch->adjstart[r+1]; j++) {
+            int r1 = scratch->adj[j];
+            if (scratch->seen[r1] != stamp && !BITMAP_GET(pos->flooded, r1)) {
+                scratch->seen[r1] = stamp;
+                scratch->dist[r1] = scratch->dist[r] + 1;
+                scratch->queue[qhead++] = r1;
+            }
         }
     }
-#if 0
-    printf("best at depth %d was %d (%d at %d, %d controlled)\n",
-           depth, bestmove, bestnumber, bestdist, bestcontrol);
-#endif
 
-    *rbestdist = bestdist;
-    *rbestnumber = bestnumber;
-    *rbestcontrol = bestcontrol;
-    return bestmove;
+    *rdist = dist;
+    *rnumber = number;
+}
+
+static int candidate_cmp(const void *av, const void *bv)
+{
+    const struct candidate *a = (const struct candidate *)av;
+    const struct candidate *b = (const struct candidate *)bv;
+
+    if (a->dist != b->dist)
+        return a->dist < b->dist ? -1 : +1;
+    if (a->number != b->number)
+        return a->number < b->number ? -1 : +1;
+    if (a->area != b->area)
+        return a->area > b->area ? -1 : +1;
+    if (a->parent != b->parent)
+        return a->parent < b->parent ? -1 : +1;
+    return a->move < b->move ? -1 : a->move > b->move ? +1 : 0;
+}
+
+static int add_trail(struct solver_scratch *scratch, int parent, char move)
+{
+    if (scratch->ntrail >= scratch->trailsize) {
+        scratch->trailsize = scratch->ntrail * 5 / 4 + 256;
+        scratch->trail = sresize(scratch->trail, scratch->trailsize,
+                                 struct trail);
+    }
+    scratch->trail[scratch->ntrail].parent = parent;
+    scratch->trail[scratch->ntrail].move = move;
+    return scratch->ntrail++;
 }
-static char choosemove(int w, int h, char *grid, int x0, int y0,
-                       int maxmove, struct solver_scratch *scratch)
+
+/*
+ * Find a short sequence of moves that completes a grid, and write it
+ * into 'moves' (which needs room for w*h-1 of them). Returns the
+ * number of moves.
+ */
+static int solve(int w, int h, const char *grid, int colours, char *moves)
 {
-    int tmp0, tmp1, tmp2;
-    return choosemove_recurse(w, h, grid, x0, y0, maxmove, scratch,
-                              0, &tmp0, &tmp1, &tmp2);
+    struct solver_scratch *scratch = new_scratch(w, h, grid, colours);
+    struct position *root = &scratch->beam[0];
+    int nbeam, ncands, nmoves, i, t, b, m;
+
+    if (scratch->nregions == 1) {
+        free_scratch(scratch);
+        return 0;
+    }
+
+    memset(root->flooded, 0, scratch->nwords * sizeof(unsigned long));
+    BITMAP_SET(root->flooded, 0);
+    root->nfrontier = 0;
+    for (i = scratch->adjstart[0]; i < scratch->adjstart[1]; i++)
+        root->frontier[root->nfrontier++] = scratch->adj[i];
+    root->area = scratch->size[0];
+    root->hash[0] = scratch->keys[0];
+    root->hash[1] = scratch->keys[1];
+    root->trail = -1;
+    visited(scratch, root->hash, true);
+    nbeam = 1;
+
+    while (1) {
+        struct position *tmp;
+
+        ncands = 0;
+        for (b = 0; b < nbeam; b++) {
+            struct position *pos = &scratch->beam[b];
+            int present = 0;
+
+            for (i = 0; i < pos->nfrontier; i++)
+                present |= 1 << scratch->colour[pos->frontier[i]];
+
+            for (m = 0; m < colours; m++) {
+                struct candidate *c;
+
+                if (!(present & (1 << m)))
+                    continue;
+                make_move(scratch, pos, m, &scratch->tmp);
+                if (scratch->tmp.nfrontier == 0) {
+                    /* That's everything flooded, so we're done. */
+                    t = add_trail(scratch, pos->trail, m);
+                    goto found;
+                }
+                if (visited(scratch, scratch->tmp.hash, false))
+                    continue;
+                c = &scratch->cands[ncands++];
+                c->parent = b;
+                c->move = m;
+                search(scratch, &scratch->tmp, &c->dist, &c->number);
+                c->area = scratch->tmp.area;
+                c->hash[0] = scratch->tmp.hash[0];
+                c->hash[1] = scratch->tmp.hash[1];
+            }
+        }
+
+        /*
+         * Every move from a position gets at least one more region,
+         * so there's always something new, and we can't run out.
+         */
+        assert(ncands > 0);
+        qsort(scratch->cands, ncands, sizeof(struct candidate),
+              candidate_cmp);
+
+        for (i = b = 0; i < ncands && b < BEAM_WIDTH; i++) {
+            struct candidate *c = &scratch->cands[i];
+            struct position *pos = &scratch->next[b];
+
+            if (visited(scratch, c->hash, true))
+                continue;              /* same as one we've already kept */
+            make_move(scratch, &scratch->beam[c->parent], c->move, pos);
+            pos->trail = add_trail(scratch, scratch->beam[c->parent].trail,
+                                   c->move);
+            b++;
+        }
+        nbeam = b;
+
+        tmp = scratch->beam;
+        scratch->beam = scratch->next;
+        scratch->next = tmp;
+    }
+
+  found:
+    nmoves = 0;
+    for (i = t; i >= 0; i = scratch->trail[i].parent)
+        nmoves++;
+    assert(nmoves < w*h);
+    for (i = t, m = nmoves; i >= 0; i = scratch->trail[i].parent)
+        moves[--m] = scratch->trail[i].move;
+
+    free_scratch(scratch);
+    return nmoves;
 }
 
 static char *new_game_desc(const game_params *params, random_state *rs,
@@ -558,31 +861,23 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 {
     int w = params->w, h = params->h, wh = w*h;
     int i, moves;
-    char *desc;
-    struct solver_scratch *scratch;
+    char *desc, *grid, *solution;
 
-    scratch = new_scratch(w, h);
+    grid = snewn(wh, char);
+    solution = snewn(wh, char);
 
     /*
      * Invent a random grid.
      */
     do {
         for (i = 0; i < wh; i++)
-            scratch->grid[i] = random_upto(rs, params->colours);
-    } while (completed(w, h, scratch->grid));
+            grid[i] = random_upto(rs, params->colours);
+    } while (completed(w, h, grid));
 
     /*
      * Run the solver, and count how many moves it uses.
      */
-    memcpy(scratch->grid2, scratch->grid, wh * sizeof(*scratch->grid2));
-    moves = 0;
-    check_recursion_depth();
-    while (!completed(w, h, scratch->grid2)) {
-        char move = choosemove(w, h, scratch->grid2, FILLX, FILLY,
-                               params->colours, scratch);
-        fill(w, h, scratch->grid2, FILLX, FILLY, move, scratch->queue[0]);
-        moves++;
-    }
+    moves = solve(w, h, grid, params->colours, solution);
 
     /*
      * Adjust for difficulty.
@@ -594,13 +889,14 @@ static char *new_game_desc(const game_params *params, random_state *rs,
      */
     desc = snewn(wh + 40, char);
     for (i = 0; i < wh; i++) {
-        char colour = scratch->grid[i];
+        char colour = grid[i];
         char textcolour = (colour > 9 ? 'A' : '0') + colour;
         desc[i] = textcolour;
     }
     sprintf(desc+i, ",%d", moves);
 
-    free_scratch(scratch);
+    sfree(grid);
+    sfree(solution);
 
     return desc;
 }
@@ -709,7 +1005,6 @@ static char *solve_game(const game_state *state, const game_state *currstate,
     char *moves, *ret, *p;
     int i, len, nmoves;
     char buf[256];
-    struct solver_scratch *scratch;
 
     if (currstate->complete) {
         *error = "Puzzle is already solved";
@@ -720,18 +1015,7 @@ static char *solve_game(const game_state *state, const game_state *currstate,
      * Find the best solution our solver can give.
      */
     moves = snewn(wh, char);           /* sure to be enough */
-    nmoves = 0;
-    scratch = new_scratch(w, h);
-    memcpy(scratch->grid2, currstate->grid, wh * sizeof(*scratch->grid2));
-    check_recursion_depth();
-    while (!completed(w, h, scratch->grid2)) {
-        char move = choosemove(w, h, scratch->grid2, FILLX, FILLY,
-                               currstate->colours, scratch);
-        fill(w, h, scratch->grid2, FILLX, FILLY, move, scratch->queue[0]);
-        assert(nmoves < wh);
-        moves[nmoves++] = move;
-    }
-    free_scratch(scratch);
+    nmoves = solve(w, h, currstate->grid, currstate->colours, moves);
 
     /*
      * Encode it as a move string.
@@ -1371,7 +1655,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
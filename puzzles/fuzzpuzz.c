@@ -32,15 +32,45 @@
  * mkdir fuzz-corpus && ln icons/''*.sav fuzz-corpus
  * build-clang/fuzzpuzz -fork=1 -ignore_crashes=1 -dict=fuzzpuzz.dict \
  *   fuzz-corpus
+ *
+ * Performance fuzzing: with FUZZPUZZ_PERF set in the environment,
+ * each input is also solved (midend_solve, which runs the game's own
+ * solver if the save file has no aux info), and each stage is
+ * measured, in instructions where the kernel will count them and in
+ * nanoseconds otherwise. The order of magnitude of each stage's cost
+ * is then fed back to the fuzzer as coverage (see perf_feedback), so
+ * that an input is interesting if it makes any stage slower than
+ * anything seen before, and the fuzzer works its way towards the
+ * pathologically slow ones. Under AFL++, for example:
+ *
+ * FUZZPUZZ_PERF=1 afl-fuzz -i fuzz-in -o perf-out -t 10000 \
+ *   -x fuzzpuzz.dict -- build-afl/fuzzpuzz
+ *
+ * and then triage the queue with the --perf-report mode below:
+ *
+ * fuzzpuzz --perf-report perf-out/default/queue/id* | head
  */
 
+#ifdef HAVE_LINUX_PERF_EVENT_H
+#define _DEFAULT_SOURCE /* for syscall() */
+#endif
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L /* for clock_gettime */
+#endif
+
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #ifdef __AFL_FUZZ_TESTCASE_LEN
 # include <unistd.h> /* read() is used by __AFL_FUZZ_TESTCASE_LEN. */
 #endif
+#ifdef HAVE_LINUX_PERF_EVENT_H
+# include <linux/perf_event.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#endif
 
 #include "puzzles.h"
 
@@ -56,10 +86,153 @@ extern int HF_ITER(unsigned char **, size_t *);
 
 int LLVMFuzzerTestOneInput(unsigned char *data, size_t size);
 
+/*
+ * Performance measurement. Each stage's cost is in instructions if
+ * perf_event_open will count them for us, which is much more
+ * repeatable than time (and so much less confusing to a fuzzer); if
+ * not, it's the wall-clock time in nanoseconds.
+ */
+enum { PERF_DESERIALISE, PERF_SOLVE, PERF_REDRAW, PERF_SERIALISE,
+       PERF_NSTAGES };
+
+struct perf {
+    unsigned long long cost[PERF_NSTAGES];
+    double us[PERF_NSTAGES];
+    unsigned long long start_cost;
+    double start_us;
+};
+
+static bool perf_mode;
+
+/* Called once, on the way in, by each fuzzer's entry point. */
+static void perf_init(void)
+{
+    static bool done = false;
+
+    if (!done) {
+        perf_mode = getenv("FUZZPUZZ_PERF") != NULL;
+        done = true;
+    }
+}
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+static int perf_fd = -2;               /* -2 = not tried yet */
+#endif
+
+static bool perf_counting_instructions(void)
+{
+#ifdef HAVE_LINUX_PERF_EVENT_H
+    if (perf_fd == -2) {
+        struct perf_event_attr pe;
+
+        memset(&pe, 0, sizeof(pe));
+        pe.type = PERF_TYPE_HARDWARE;
+        pe.size = sizeof(pe);
+        pe.config = PERF_COUNT_HW_INSTRUCTIONS;
+        pe.exclude_kernel = 1;
+        pe.exclude_hv = 1;
+        perf_fd = (int)syscall(SYS_perf_event_open, &pe, 0, -1, -1, 0);
+    }
+    return perf_fd >= 0;
+#else
+    return false;
+#endif
+}
+
+static double perf_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static unsigned long long perf_now_cost(double us)
+{
+    if (perf_counting_instructions()) {
+#ifdef HAVE_LINUX_PERF_EVENT_H
+        unsigned long long count;
+
+        if (read(perf_fd, &count, sizeof(count)) == sizeof(count))
+            return count;
+#endif
+    }
+    return (unsigned long long)(us * 1000);
+}
+
+static void perf_start(struct perf *perf)
+{
+    if (!perf)
+        return;
+    perf->start_us = perf_now_us();
+    perf->start_cost = perf_now_cost(perf->start_us);
+}
+
+static void perf_stop(struct perf *perf, int stage)
+{
+    double us;
+
+    if (!perf)
+        return;
+    us = perf_now_us();
+    perf->cost[stage] += perf_now_cost(us) - perf->start_cost;
+    perf->us[stage] += us - perf->start_us;
+}
+
+/*
+ * Feedback to a coverage-guided fuzzer. Each bucket, for costs from
+ * 2^n to 2^(n+1)-1, is its own function, and each stage its own case
+ * within the function, so every combination of stage and order of
+ * magnitude is a separate edge, which the fuzzer's instrumentation
+ * sees as new coverage when an input first reaches it. This works
+ * the same under AFL++, Honggfuzz and libFuzzer, without needing any
+ * of their special interfaces.
+ */
+#define PERF_NBUCKETS 48
+static volatile unsigned perf_hits[PERF_NBUCKETS][PERF_NSTAGES];
+
+#define PERF_BUCKET(n)                                          \
+    static void perf_bucket_##n(int stage)                      \
+    {                                                           \
+        switch (stage) {                                        \
+          case PERF_DESERIALISE: perf_hits[n][0]++; break;      \
+          case PERF_SOLVE: perf_hits[n][1]++; break;            \
+          case PERF_REDRAW: perf_hits[n][2]++; break;           \
+          case PERF_SERIALISE: perf_hits[n][3]++; break;        \
+        }                                                       \
+    }
+#define PERF_BUCKETS(X)                                                 \
+    X(0) X(1) X(2) X(3) X(4) X(5) X(6) X(7) X(8) X(9) X(10) X(11)       \
+    X(12) X(13) X(14) X(15) X(16) X(17) X(18) X(19) X(20) X(21) X(22)  \
+    X(23) X(24) X(25) X(26) X(27) X(28) X(29) X(30) X(31) X(32) X(33) \
+    X(34) X(35) X(36) X(37) X(38) X(39) X(40) X(41) X(42) X(43) X(44) \
+    X(45) X(46) X(47)
+PERF_BUCKETS(PERF_BUCKET)
+#define PERF_BUCKET_FN(n) perf_bucket_##n,
+static void (*const perf_buckets[PERF_NBUCKETS])(int stage) = {
+    PERF_BUCKETS(PERF_BUCKET_FN)
+};
+
+static void perf_feedback(const struct perf *perf)
+{
+    int stage, bucket;
+
+    for (stage = 0; stage < PERF_NSTAGES; stage++) {
+        unsigned long long cost = perf->cost[stage];
+
+        for (bucket = 0; cost > 1 && bucket < PERF_NBUCKETS - 1; bucket++)
+            cost >>= 1;
+        perf_buckets[bucket](stage);
+    }
+}
+
+/*
+ * Run one input through the midend. With 'perf' (which must start
+ * zeroed), also solve it, and measure each stage.
+ */
 static const char *fuzz_one(bool (*readfn)(void *, void *, int), void *rctx,
                             void (*rewindfn)(void *),
                             void (*writefn)(void *, const void *, int),
-                            void *wctx)
+                            void *wctx, struct perf *perf)
 {
     const char *err;
     char *gamename;
@@ -81,19 +254,53 @@ static const char *fuzz_one(bool (*readfn)(void *, void *, int), void *rctx,
     me = midend_new(NULL, ourgame, &drapi, NULL);
 
     rewindfn(rctx);
+    perf_start(perf);
     err = midend_deserialise(me, readfn, rctx);
+    perf_stop(perf, PERF_DESERIALISE);
     if (err != NULL) {
         midend_free(me);
         return err;
     }
     w = h = INT_MAX;
+    perf_start(perf);
     midend_size(me, &w, &h, false, 1);
+    perf_stop(perf, PERF_REDRAW);
+    if (perf) {
+        /* After midend_size, since this redraws too. */
+        perf_start(perf);
+        midend_solve(me);
+        perf_stop(perf, PERF_SOLVE);
+    }
+    perf_start(perf);
     midend_redraw(me);
+    perf_stop(perf, PERF_REDRAW);
+    perf_start(perf);
     midend_serialise(me, writefn, wctx);
+    perf_stop(perf, PERF_SERIALISE);
     midend_free(me);
     return NULL;
 }
 
+/*
+ * The fuzzers' entry point to fuzz_one, doing performance feedback
+ * if we're in that mode.
+ */
+static const char *fuzz_one_feedback(
+    bool (*readfn)(void *, void *, int), void *rctx,
+    void (*rewindfn)(void *), void (*writefn)(void *, const void *, int),
+    void *wctx)
+{
+    struct perf perf;
+    const char *err;
+
+    if (!perf_mode)
+        return fuzz_one(readfn, rctx, rewindfn, writefn, wctx, NULL);
+    memset(&perf, 0, sizeof(perf));
+    err = fuzz_one(readfn, rctx, rewindfn, writefn, wctx, &perf);
+    perf_feedback(&perf);
+    return err;
+}
+
 #if defined(__AFL_FUZZ_TESTCASE_LEN) || defined(HAVE_HF_ITER) || \
     !defined(OMIT_MAIN)
 static void savefile_write(void *wctx, const void *buf, int len)
@@ -137,7 +344,8 @@ int LLVMFuzzerTestOneInput(unsigned char *data, size_t size) {
     ctx.buf = data;
     ctx.len = size;
     ctx.pos = 0;
-    fuzz_one(mem_read, &ctx, mem_rewind, null_write, NULL);
+    perf_init();
+    fuzz_one_feedback(mem_read, &ctx, mem_rewind, null_write, NULL);
     return 0;
 }
 
@@ -148,7 +356,8 @@ static const char *fuzz_one_mem(unsigned char *data, size_t size) {
     ctx.buf = data;
     ctx.len = size;
     ctx.pos = 0;
-    return fuzz_one(mem_read, &ctx, mem_rewind, savefile_write, stdout);
+    return fuzz_one_feedback(mem_read, &ctx, mem_rewind,
+                             savefile_write, stdout);
 }
 #endif
 
@@ -174,6 +383,7 @@ int main(int argc, char **argv)
         fprintf(stderr, "usage: %s\n", argv[0]);
         return 1;
     }
+    perf_init();
 #ifdef __AFL_HAVE_MANUAL_CONTROL
     __AFL_INIT();
 #endif
@@ -198,6 +408,7 @@ int main(int argc, char **argv)
         fprintf(stderr, "usage: %s\n", argv[0]);
         return 1;
     }
+    perf_init();
     while (true) {
         unsigned char *testcase_buf;
         size_t testcase_len;
@@ -207,7 +418,8 @@ int main(int argc, char **argv)
 }
 #else
 /*
- * Stand-alone mode: just handle a single test case on stdin.
+ * Stand-alone mode: just handle a single test case on stdin, or with
+ * --perf-report, measure each of a list of files, slowest first.
  */
 static bool savefile_read(void *wctx, void *buf, int len)
 {
@@ -225,22 +437,91 @@ static void savefile_rewind(void *wctx)
     rewind(fp);
 }
 
+struct perf_result {
+    const char *filename;
+    const char *err;
+    unsigned long long total;
+    struct perf perf;
+};
+
+static int perf_result_cmp(const void *av, const void *bv)
+{
+    const struct perf_result *a = (const struct perf_result *)av;
+    const struct perf_result *b = (const struct perf_result *)bv;
+
+    if (a->total != b->total)
+        return a->total > b->total ? -1 : +1;
+    return strcmp(a->filename, b->filename);
+}
+
+static int perf_report(int nfiles, char **filenames)
+{
+    static const char *const stage_names[PERF_NSTAGES] = {
+        "deserialise", "solve", "redraw", "serialise",
+    };
+    struct perf_result *results = snewn(nfiles, struct perf_result);
+    int i, stage;
+
+    for (i = 0; i < nfiles; i++) {
+        struct perf_result *r = &results[i];
+        FILE *fp = fopen(filenames[i], "rb");
+
+        r->filename = filenames[i];
+        memset(&r->perf, 0, sizeof(r->perf));
+        if (!fp) {
+            r->err = "Unable to open file";
+        } else {
+            r->err = fuzz_one(savefile_read, fp, savefile_rewind,
+                              null_write, NULL, &r->perf);
+            fclose(fp);
+        }
+        r->total = 0;
+        for (stage = 0; stage < PERF_NSTAGES; stage++)
+            r->total += r->perf.cost[stage];
+    }
+    qsort(results, nfiles, sizeof(*results), perf_result_cmp);
+
+    printf("# costs in %s; times in microseconds\n",
+           perf_counting_instructions() ? "instructions" : "nanoseconds");
+    printf("%-14s", "# total");
+    for (stage = 0; stage < PERF_NSTAGES; stage++)
+        printf(" %14s %9s", stage_names[stage], "us");
+    printf(" file\n");
+    for (i = 0; i < nfiles; i++) {
+        struct perf_result *r = &results[i];
+
+        printf("%14llu", r->total);
+        for (stage = 0; stage < PERF_NSTAGES; stage++)
+            printf(" %14llu %9.0f", r->perf.cost[stage], r->perf.us[stage]);
+        printf(" %s", r->filename);
+        if (r->err)
+            printf(" (%s)", r->err);
+        printf("\n");
+    }
+    sfree(results);
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
     const char *err;
 
+    if (argc >= 2 && !strcmp(argv[1], "--perf-report"))
+        return perf_report(argc - 2, argv + 2);
     if (argc != 1) {
-        fprintf(stderr, "usage: %s\n", argv[0]);
+        fprintf(stderr, "usage: %s\n"
+                "       %s --perf-report FILE...\n", argv[0], argv[0]);
         return 1;
     }
 
     /* Might in theory use this mode under AFL. */
+    perf_init();
 #ifdef __AFL_HAVE_MANUAL_CONTROL
     __AFL_INIT();
 #endif
 
-    err = fuzz_one(savefile_read, stdin, savefile_rewind,
-                   savefile_write, stdout);
+    err = fuzz_one_feedback(savefile_read, stdin, savefile_rewind,
+                            savefile_write, stdout);
     if (err != NULL) {
         fprintf(stderr, "%s\n", err);
         return 1;
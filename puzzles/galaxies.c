@@ -193,7 +193,6 @@ struct game_state {
 };
 
 static bool check_complete(const game_state *state, DSF *dsf, int *colours);
-static int solver_state_inner(game_state *state, int maxdiff, int depth);
 static int solver_state(game_state *state, int maxdiff);
 static int solver_obvious(game_state *state);
 static int solver_obvious_dot(game_state *state, space *dot);
@@ -1448,17 +1447,21 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     game_state *state = blank_game(params->w, params->h), *copy;
     char *desc;
     int *scratch, sz = state->sx*state->sy, i;
-    int diff, best_wiggliness;
+    int diff, best_wiggliness, attempt = 0;
     bool cc;
 
     scratch = snewn(sz, int);
 
 generate:
+    generation_phase("grid");
     best_wiggliness = -1;
     copy = NULL;
     for (i = 0; i < GENERATE_TRIES; i++) {
         int this_wiggliness;
 
+        generation_progress(generation_retry_progress(
+            attempt, 0.8F * i / GENERATE_TRIES));
+
         do {
             clear_game(state, true);
             generate_pass(state, rs, scratch, 100, GP_DOTS);
@@ -1494,6 +1497,8 @@ generate:
     cc = check_complete(state, NULL, NULL);
     assert(cc);
 
+    generation_progress(generation_retry_progress(attempt, 0.8F));
+    generation_phase("solve");
     copy = dup_game(state);
     clear_game(copy, false);
     dbg_state(copy);
@@ -1513,7 +1518,10 @@ generate:
 #ifdef STANDALONE_SOLVER
         if (!one_try)
 #endif
+        {
+            attempt++;
             goto generate;
+        }
     }
 
 #ifdef STANDALONE_PICTURE_GENERATOR
@@ -1801,6 +1809,7 @@ typedef struct solver_ctx {
     space **scratch;    /* size sz */
     DSF *dsf;           /* size sz */
     int *iscratch;      /* size sz */
+    space **marked;     /* size sz */
 } solver_ctx;
 
 static solver_ctx *new_solver(game_state *state)
@@ -1811,6 +1820,7 @@ static solver_ctx *new_solver(game_state *state)
     sctx->scratch = snewn(sctx->sz, space *);
     sctx->dsf = dsf_new(sctx->sz);
     sctx->iscratch = snewn(sctx->sz, int);
+    sctx->marked = snewn(sctx->sz, space *);
     return sctx;
 }
 
@@ -1819,6 +1829,7 @@ static void free_solver(solver_ctx *sctx)
     sfree(sctx->scratch);
     dsf_free(sctx->dsf);
     sfree(sctx->iscratch);
+    sfree(sctx->marked);
     sfree(sctx);
 }
 
@@ -2127,19 +2138,17 @@ static bool solver_expand_checkdot(space *tile, space *dot)
 
 static void solver_expand_fromdot(game_state *state, space *dot, solver_ctx *sctx)
 {
-    int i, j, x, y, start, end, next;
-    space *sp;
-
-    /* Clear the grid of the (space) flags we'll use. */
-
-    /* This is well optimised; analysis showed that:
-        for (i = 0; i < sctx->sz; i++) state->grid[i].flags &= ~F_MARK;
-       took up ~85% of the total function time! */
-    for (y = 1; y < state->sy; y += 2) {
-        sp = &SPACE(state, 1, y);
-        for (x = 1; x < state->sx; x += 2, sp += 2)
-            sp->flags &= ~F_MARK;
-    }
+    int i, j, start, end, next, nmarked = 0;
+
+    /* We start with no tiles marked (see solver_expand_dots), and
+     * clear the ones we marked before returning, keeping a list of
+     * them in sctx->marked. Clearing the whole grid each time
+     * instead took up most of the time of this function, which is
+     * called for every dot on every pass of the solver. */
+#define MARK(sp) do {                           \
+    (sp)->flags |= F_MARK;                      \
+    sctx->marked[nmarked++] = (sp);             \
+} while (0)
 
     /* Seed the list of marked squares with two that must be associated
      * with our dot (possibly the same space) */
@@ -2155,8 +2164,9 @@ static void solver_expand_fromdot(game_state *state, space *dot, solver_ctx *sct
     assert(sctx->scratch[0]->flags & F_TILE_ASSOC);
     assert(sctx->scratch[1]->flags & F_TILE_ASSOC);
 
-    sctx->scratch[0]->flags |= F_MARK;
-    sctx->scratch[1]->flags |= F_MARK;
+    MARK(sctx->scratch[0]);
+    if (sctx->scratch[1] != sctx->scratch[0])
+        MARK(sctx->scratch[1]);
 
     debug(("%*sexpand from dot %d,%d seeded with %d,%d and %d,%d.\n",
            solver_recurse_depth*4, "", dot->x, dot->y,
@@ -2187,7 +2197,7 @@ expand:
                 debug(("%*sMarking %d,%d, no opposite.\n",
                        solver_recurse_depth*4, "",
                        tileadj[j]->x, tileadj[j]->y));
-                tileadj[j]->flags |= F_MARK;
+                MARK(tileadj[j]);
                 continue; /* no opposite, so mark for next time. */
             }
             /* If the tile had an opposite we should have either seen both of
@@ -2208,8 +2218,9 @@ expand:
             debug(("%*sMarking %d,%d and %d,%d.\n",
                    solver_recurse_depth*4, "",
                        tileadj[j]->x, tileadj[j]->y, tileadj2->x, tileadj2->y));
-            tileadj[j]->flags |= F_MARK;
-            tileadj2->flags |= F_MARK;
+            MARK(tileadj[j]);
+            if (tileadj2 != tileadj[j])
+                MARK(tileadj2);
         }
     }
     if (next > end) {
@@ -2240,6 +2251,10 @@ expand:
         }
     }
     dbg_state(state);
+
+    for (i = 0; i < nmarked; i++)
+        sctx->marked[i]->flags &= ~F_MARK;
+#undef MARK
 }
 
 static int solver_expand_postcb(game_state *state, space *tile, void *ctx)
@@ -2264,7 +2279,7 @@ static int solver_expand_dots(game_state *state, solver_ctx *sctx)
     int i;
 
     for (i = 0; i < sctx->sz; i++)
-        state->grid[i].flags &= ~(F_REACHABLE|F_MULTIPLE);
+        state->grid[i].flags &= ~(F_REACHABLE|F_MULTIPLE|F_MARK);
 
     for (i = 0; i < state->ndots; i++)
         solver_expand_fromdot(state, state->dots[i], sctx);
@@ -2470,8 +2485,11 @@ static int solver_recurse_cb(game_state *state, space *tile, void *ctx)
 
 #define MAXRECURSE 5
 
-static int solver_recurse(game_state *state, int maxdiff, int depth)
+static int solver_state_inner(solver_ctx *sctx, int maxdiff, int depth);
+
+static int solver_recurse(solver_ctx *sctx, int maxdiff, int depth)
 {
+    game_state *state = sctx->state;
     int diff = DIFF_IMPOSSIBLE, ret, n, gsz = state->sx * state->sy;
     space *ingrid, *outgrid = NULL, *bestopp;
     struct recurse_ctx rctx;
@@ -2508,7 +2526,7 @@ static int solver_recurse(game_state *state, int maxdiff, int depth)
                          state->dots[n]->x, state->dots[n]->y,
                          "Attempting for recursion");
 
-        ret = solver_state_inner(state, maxdiff, depth + 1);
+        ret = solver_state_inner(sctx, maxdiff, depth + 1);
 
 #ifdef STATIC_RECURSION_DEPTH
         solver_recurse_depth = depth;  /* restore after recursion returns */
@@ -2553,9 +2571,13 @@ static int solver_recurse(game_state *state, int maxdiff, int depth)
     return diff;
 }
 
-static int solver_state_inner(game_state *state, int maxdiff, int depth)
+/*
+ * The same solver_ctx does for every level of recursion, since all
+ * its scratch space is finished with before we recurse.
+ */
+static int solver_state_inner(solver_ctx *sctx, int maxdiff, int depth)
 {
-    solver_ctx *sctx = new_solver(state);
+    game_state *state = sctx->state;
     int ret, diff = DIFF_NORMAL;
 
 #ifdef STANDALONE_PICTURE_GENERATOR
@@ -2608,10 +2630,9 @@ cont:
     if (check_complete(state, NULL, NULL)) goto got_result;
 
     diff = (maxdiff >= DIFF_UNREASONABLE) ?
-        solver_recurse(state, maxdiff, depth) : DIFF_UNFINISHED;
+        solver_recurse(sctx, maxdiff, depth) : DIFF_UNFINISHED;
 
 got_result:
-    free_solver(sctx);
 #ifndef STANDALONE_SOLVER
     debug(("solver_state ends, diff %s:\n", galaxies_diffnames[diff]));
     dbg_state(state);
@@ -2626,7 +2647,10 @@ got_result:
 
 static int solver_state(game_state *state, int maxdiff)
 {
-    return solver_state_inner(state, maxdiff, 0);
+    solver_ctx *sctx = new_solver(state);
+    int diff = solver_state_inner(sctx, maxdiff, 0);
+    free_solver(sctx);
+    return diff;
 }
 
 #ifndef EDITOR
@@ -4129,11 +4153,15 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
 #ifdef EDITOR
     false, NULL,
 #else
     true, solve_game,
 #endif
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
@@ -20,7 +20,6 @@
 #endif
 
 #include "puzzles.h"
-#include "tree234.h"
 #include "grid.h"
 #include "penrose-legacy.h"
 #include "penrose.h"
@@ -33,6 +32,26 @@
 #define DEBUG_GRID
 */
 
+/*
+ * Phase markers for benchmarking the slow grids (see
+ * auxiliary/gridbench.c): like generation_phase, but for the stages
+ * of building one grid, so that they can be timed separately.
+ */
+static void (*grid_phase_fn)(void *ctx, const char *phase);
+static void *grid_phase_ctx;
+
+void grid_set_phase_hook(void (*fn)(void *ctx, const char *phase), void *ctx)
+{
+    grid_phase_fn = fn;
+    grid_phase_ctx = ctx;
+}
+
+static void grid_phase(const char *phase)
+{
+    if (grid_phase_fn)
+        grid_phase_fn(grid_phase_ctx, phase);
+}
+
 /* ----------------------------------------------------------------------
  * Deallocate or dereference a grid
  */
@@ -59,6 +78,18 @@ void grid_free(grid *g)
         sfree(g->faces);
         sfree(g->edges);
         sfree(g->dots);
+        sfree(g->face_start);
+        sfree(g->face_edges);
+        sfree(g->face_dots);
+        sfree(g->dot_start);
+        sfree(g->dot_edges);
+        sfree(g->dot_faces);
+        sfree(g->edge_dots);
+        sfree(g->edge_faces);
+        sfree(g->dot_x);
+        sfree(g->dot_y);
+        sfree(g->edge_index_start);
+        sfree(g->edge_index_edges);
         sfree(g);
     }
 }
@@ -73,6 +104,11 @@ static grid *grid_empty(void)
     g->dots = NULL;
     g->num_faces = g->num_edges = g->num_dots = 0;
     g->size_faces = g->size_edges = g->size_dots = 0;
+    g->face_start = g->face_edges = g->face_dots = NULL;
+    g->dot_start = g->dot_edges = g->dot_faces = NULL;
+    g->edge_dots = g->edge_faces = NULL;
+    g->dot_x = g->dot_y = NULL;
+    g->edge_index_start = g->edge_index_edges = NULL;
     g->refcount = 1;
     g->lowest_x = g->lowest_y = g->highest_x = g->highest_y = 0;
     return g;
@@ -102,6 +138,79 @@ static double point_line_distance(long px, long py,
     return det / len;
 }
 
+/*
+ * The region in which grid_nearest_edge can pick an edge is within a
+ * box around it, half the edge's length bigger all round than the
+ * edge's own bounding box. (Within that region the triangle test
+ * keeps the point between the perpendiculars at the dots, and the
+ * distance test keeps it within half the length of the edge.)
+ */
+static void grid_edge_reach(const grid *g, int e, int *x0, int *y0,
+                            int *x1, int *y1)
+{
+    int ax = g->dot_x[g->edge_dots[2*e]], ay = g->dot_y[g->edge_dots[2*e]];
+    int bx = g->dot_x[g->edge_dots[2*e+1]];
+    int by = g->dot_y[g->edge_dots[2*e+1]];
+    int r = (int)ceil(sqrt(SQ((double)ax - bx) + SQ((double)ay - by)) / 2) + 1;
+
+    *x0 = min(ax, bx) - r;
+    *y0 = min(ay, by) - r;
+    *x1 = max(ax, bx) + r;
+    *y1 = max(ay, by) + r;
+}
+
+/* Bucket the edges by the regions they can be picked from. */
+static void grid_build_edge_index(grid *g)
+{
+    int cell = max(g->tilesize, 1);
+    int x0 = INT_MAX, y0 = INT_MAX, x1 = INT_MIN, y1 = INT_MIN;
+    int nbuckets, e, bx, by, *fill;
+
+    for (e = 0; e < g->num_edges; e++) {
+        int ex0, ey0, ex1, ey1;
+        grid_edge_reach(g, e, &ex0, &ey0, &ex1, &ey1);
+        x0 = min(x0, ex0);
+        y0 = min(y0, ey0);
+        x1 = max(x1, ex1);
+        y1 = max(y1, ey1);
+    }
+    if (g->num_edges == 0)
+        x0 = y0 = x1 = y1 = 0;
+
+    g->edge_index_x = x0;
+    g->edge_index_y = y0;
+    g->edge_index_cell = cell;
+    g->edge_index_w = (x1 - x0) / cell + 1;
+    g->edge_index_h = (y1 - y0) / cell + 1;
+    nbuckets = g->edge_index_w * g->edge_index_h;
+
+    /* Count each bucket's edges, then place them, in edge order. */
+    g->edge_index_start = snewn(nbuckets + 1, int);
+    for (bx = 0; bx <= nbuckets; bx++)
+        g->edge_index_start[bx] = 0;
+    for (e = 0; e < g->num_edges; e++) {
+        int ex0, ey0, ex1, ey1;
+        grid_edge_reach(g, e, &ex0, &ey0, &ex1, &ey1);
+        for (by = (ey0 - y0) / cell; by <= (ey1 - y0) / cell; by++)
+            for (bx = (ex0 - x0) / cell; bx <= (ex1 - x0) / cell; bx++)
+                g->edge_index_start[by * g->edge_index_w + bx + 1]++;
+    }
+    for (bx = 0; bx < nbuckets; bx++)
+        g->edge_index_start[bx+1] += g->edge_index_start[bx];
+
+    g->edge_index_edges = snewn(max(g->edge_index_start[nbuckets], 1), int);
+    fill = snewn(nbuckets, int);
+    memcpy(fill, g->edge_index_start, nbuckets * sizeof(int));
+    for (e = 0; e < g->num_edges; e++) {
+        int ex0, ey0, ex1, ey1;
+        grid_edge_reach(g, e, &ex0, &ey0, &ex1, &ey1);
+        for (by = (ey0 - y0) / cell; by <= (ey1 - y0) / cell; by++)
+            for (bx = (ex0 - x0) / cell; bx <= (ex1 - x0) / cell; bx++)
+                g->edge_index_edges[fill[by * g->edge_index_w + bx]++] = e;
+    }
+    sfree(fill);
+}
+
 /* Determine nearest edge to where the user clicked.
  * (x, y) is the clicked location, converted to grid coordinates.
  * Returns the nearest edge, or NULL if no edge is reasonably
@@ -125,12 +234,23 @@ grid_edge *grid_nearest_edge(grid *g, int x, int y)
 {
     grid_edge *best_edge;
     double best_distance = 0;
-    int i;
+    int bx, by, b, i;
 
     best_edge = NULL;
 
-    for (i = 0; i < g->num_edges; i++) {
-        grid_edge *e = g->edges[i];
+    /* Only the edges in (x,y)'s bucket can be near enough. */
+    if (!g->edge_index_start)
+        grid_build_edge_index(g);
+    if (x < g->edge_index_x || y < g->edge_index_y)
+        return NULL;
+    bx = (x - g->edge_index_x) / g->edge_index_cell;
+    by = (y - g->edge_index_y) / g->edge_index_cell;
+    if (bx >= g->edge_index_w || by >= g->edge_index_h)
+        return NULL;
+    b = by * g->edge_index_w + bx;
+
+    for (i = g->edge_index_start[b]; i < g->edge_index_start[b+1]; i++) {
+        grid_edge *e = g->edges[g->edge_index_edges[i]];
         long e2; /* squared length of edge */
         long a2, b2; /* squared lengths of other sides */
         double dist;
@@ -334,32 +454,19 @@ static void grid_debug_derived(grid *g)
 #endif
 }
 
-/* Helper function for building incomplete-edges list in
- * grid_make_consistent() */
-static int grid_edge_bydots_cmpfn(void *v1, void *v2)
-{
-    grid_edge *a = v1;
-    grid_edge *b = v2;
-    grid_dot *da, *db;
-
-    /* Edges are not "normalised" - the 2 dots could be stored in any order,
-     * so we need to take this into account when comparing edges. */
-
-    /* Compare first dots */
-    da = (a->dot1 < a->dot2) ? a->dot1 : a->dot2;
-    db = (b->dot1 < b->dot2) ? b->dot1 : b->dot2;
-    if (da->index < db->index)
-        return -1;
-    if (da->index > db->index)
-        return +1;
-    /* Compare last dots */
-    da = (a->dot1 < a->dot2) ? a->dot2 : a->dot1;
-    db = (b->dot1 < b->dot2) ? b->dot2 : b->dot1;
-    if (da->index < db->index)
-        return -1;
-    if (da->index > db->index)
-        return +1;
+/* An ordered pair of dots which occur in that order around some face. */
+struct grid_dotpair {
+    int dot0, dot1;
+};
 
+static int grid_dotpair_cmp(const void *av, const void *bv)
+{
+    const struct grid_dotpair *a = (const struct grid_dotpair *)av;
+    const struct grid_dotpair *b = (const struct grid_dotpair *)bv;
+    if (a->dot0 != b->dot0)
+        return a->dot0 < b->dot0 ? -1 : +1;
+    if (a->dot1 != b->dot1)
+        return a->dot1 < b->dot1 ? -1 : +1;
     return 0;
 }
 
@@ -377,54 +484,76 @@ static int grid_edge_bydots_cmpfn(void *v1, void *v2)
  */
 static void grid_trim_vigorously(grid *g)
 {
-    int *dotpairs, *faces, *dots;
+    struct grid_dotpair *dotpairs;
+    bool *mirrored;
+    int *faces, *dots;
     DSF *dsf;
-    int i, j, k, size, newfaces, newdots;
+    int i, j, k, size, newfaces, newdots, npairs;
 
     /*
-     * First construct a matrix in which each ordered pair of dots is
-     * mapped to the index of the face in which those dots occur in
-     * that order.
+     * First list every ordered pair of dots which occur in that order
+     * around some face, sorted so that we can look pairs up quickly.
+     * (A matrix indexed by pairs of dots would be simpler, but it's
+     * quadratic in the size of the grid, and the aperiodic tilings
+     * generate grids large enough for that to matter.)
      */
-    dotpairs = snewn(g->num_dots * g->num_dots, int);
-    for (i = 0; i < g->num_dots; i++)
-        for (j = 0; j < g->num_dots; j++)
-            dotpairs[i*g->num_dots+j] = -1;
-    for (i = 0; i < g->num_faces; i++) {
+    for (i = npairs = 0; i < g->num_faces; i++)
+        npairs += g->faces[i]->order;
+    dotpairs = snewn(npairs, struct grid_dotpair);
+    for (i = k = 0; i < g->num_faces; i++) {
         grid_face *f = g->faces[i];
         int dot0 = f->dots[f->order-1]->index;
         for (j = 0; j < f->order; j++) {
             int dot1 = f->dots[j]->index;
-            dotpairs[dot0 * g->num_dots + dot1] = i;
+            dotpairs[k].dot0 = dot0;
+            dotpairs[k].dot1 = dot1;
+            k++;
             dot0 = dot1;
         }
     }
+    qsort(dotpairs, npairs, sizeof(*dotpairs), grid_dotpair_cmp);
+
+    /*
+     * Find out which pairs have a mirror-image counterpart, i.e. which
+     * edges have a face on both sides.
+     */
+    mirrored = snewn(npairs, bool);
+    for (k = 0; k < npairs; k++) {
+        struct grid_dotpair rev;
+        rev.dot0 = dotpairs[k].dot1;
+        rev.dot1 = dotpairs[k].dot0;
+        mirrored[k] = bsearch(&rev, dotpairs, npairs, sizeof(*dotpairs),
+                              grid_dotpair_cmp) != NULL;
+    }
 
     /*
      * Now we can identify landlocked dots: they're the ones all of
-     * whose edges have a mirror-image counterpart in this matrix.
+     * whose edges have a mirror-image counterpart.
      */
     dots = snewn(g->num_dots, int);
-    for (i = 0; i < g->num_dots; i++) {
+    for (i = 0; i < g->num_dots; i++)
         dots[i] = 1;
-        for (j = 0; j < g->num_dots; j++) {
-            if ((dotpairs[i*g->num_dots+j] >= 0) ^
-                (dotpairs[j*g->num_dots+i] >= 0))
-                dots[i] = 0;    /* non-duplicated edge: coastal dot */
+    for (k = 0; k < npairs; k++) {
+        if (!mirrored[k]) {
+            /* non-duplicated edge: coastal dots */
+            dots[dotpairs[k].dot0] = 0;
+            dots[dotpairs[k].dot1] = 0;
         }
     }
 
     /*
      * Now identify connected pairs of landlocked dots, and form a dsf
-     * unifying them.
+     * unifying them. (We merge in order of the larger dot index and
+     * then the smaller, since the choice between equal-sized largest
+     * components below depends on which dots end up canonical.)
      */
     dsf = dsf_new(g->num_dots);
-    for (i = 0; i < g->num_dots; i++)
-        for (j = 0; j < i; j++)
-            if (dots[i] && dots[j] &&
-                dotpairs[i*g->num_dots+j] >= 0 &&
-                dotpairs[j*g->num_dots+i] >= 0)
-                dsf_merge(dsf, i, j);
+    for (k = 0; k < npairs; k++) {
+        i = dotpairs[k].dot0;
+        j = dotpairs[k].dot1;
+        if (j < i && mirrored[k] && dots[i] && dots[j])
+            dsf_merge(dsf, i, j);
+    }
 
     /*
      * Now look for the largest component.
@@ -499,6 +628,7 @@ static void grid_trim_vigorously(grid *g)
     g->num_dots = newdots;
 
     sfree(dotpairs);
+    sfree(mirrored);
     dsf_free(dsf);
     sfree(dots);
     sfree(faces);
@@ -515,8 +645,8 @@ static void grid_trim_vigorously(grid *g)
  */
 static void grid_make_consistent(grid *g)
 {
-    int i;
-    tree234 *incomplete_edges;
+    int i, n;
+    int *incomplete_head, *incomplete_next;
 
     grid_debug_basic(g);
 
@@ -529,34 +659,46 @@ static void grid_make_consistent(grid *g)
      * dots, but only one of the edge's faces.  Later on in the iteration, we
      * will find the same edge again (unless it's on the border), but we will
      * know the other face.
-     * For efficiency, maintain a list of the incomplete edges, sorted by
-     * their dots. */
-    incomplete_edges = newtree234(grid_edge_bydots_cmpfn);
+     * For efficiency, keep the incomplete edges in a linked list for each
+     * dot, threaded through incomplete_next by edge index: each edge is
+     * filed under whichever of its dots has the lower index. No dot has
+     * many edges, so searching its list is quick. */
+    incomplete_head = snewn(g->num_dots, int);
+    for (i = 0; i < g->num_dots; i++)
+        incomplete_head[i] = -1;
+    for (i = n = 0; i < g->num_faces; i++)
+        n += g->faces[i]->order;       /* at most this many edges */
+    incomplete_next = snewn(n, int);
     for (i = 0; i < g->num_faces; i++) {
         grid_face *f = g->faces[i];
         int j;
         for (j = 0; j < f->order; j++) {
-            grid_edge e; /* fake edge for searching */
-            grid_edge *edge_found;
+            grid_dot *d1, *d2, *lo, *hi;
+            int *link;
             int j2 = j + 1;
             if (j2 == f->order)
                 j2 = 0;
-            e.dot1 = f->dots[j];
-            e.dot2 = f->dots[j2];
-            /* Use del234 instead of find234, because we always want to
-             * remove the edge if found */
-            edge_found = del234(incomplete_edges, &e);
-            if (edge_found) {
-                /* This edge already added, so fill out missing face.
-                 * Edge is already removed from incomplete_edges. */
-                edge_found->face2 = f;
+            d1 = f->dots[j];
+            d2 = f->dots[j2];
+            lo = d1->index < d2->index ? d1 : d2;
+            hi = d1->index < d2->index ? d2 : d1;
+            for (link = &incomplete_head[lo->index]; *link >= 0;
+                 link = &incomplete_next[*link]) {
+                grid_edge *e = g->edges[*link];
+                if (e->dot1 == hi || e->dot2 == hi)
+                    break;
+            }
+            if (*link >= 0) {
+                /* This edge already added, so fill out missing face,
+                 * and remove the edge from the incomplete list. */
+                g->edges[*link]->face2 = f;
+                *link = incomplete_next[*link];
             } else {
                 grid_edge *new_edge = snew(grid_edge);
-                new_edge->dot1 = e.dot1;
-                new_edge->dot2 = e.dot2;
+                new_edge->dot1 = d1;
+                new_edge->dot2 = d2;
                 new_edge->face1 = f;
                 new_edge->face2 = NULL; /* potentially infinite face */
-                add234(incomplete_edges, new_edge);
 
                 /* And add it to g->edges. */
                 if (g->num_edges >= g->size_edges) {
@@ -568,10 +710,15 @@ static void grid_make_consistent(grid *g)
                 assert(g->num_edges < INT_MAX);
                 new_edge->index = g->num_edges++;
                 g->edges[new_edge->index] = new_edge;
+
+                /* And file it as incomplete. */
+                incomplete_next[new_edge->index] = incomplete_head[lo->index];
+                incomplete_head[lo->index] = new_edge->index;
             }
         }
     }
-    freetree234(incomplete_edges);
+    sfree(incomplete_head);
+    sfree(incomplete_next);
 
     /* ====== Stage 2 ======
      * For each face, build its edge list.
@@ -805,15 +952,20 @@ static void grid_make_consistent(grid *g)
 /* Helpers for making grid-generation easier.  These functions are only
  * intended for use during grid generation. */
 
-/* Comparison function for the (tree234) sorted dot list */
-static int grid_point_cmp_fn(void *v1, void *v2)
+/* Hash and equality functions for the (hashset) dot list */
+static unsigned long grid_point_hash_fn(const void *v)
 {
-    grid_dot *p1 = v1;
-    grid_dot *p2 = v2;
-    if (p1->y != p2->y)
-        return p2->y - p1->y;
-    else
-        return p2->x - p1->x;
+    const grid_dot *p = v;
+    int coords[2];
+    coords[0] = p->x;
+    coords[1] = p->y;
+    return hash_ints(coords, 2);
+}
+static bool grid_point_eq_fn(const void *v1, const void *v2)
+{
+    const grid_dot *p1 = v1;
+    const grid_dot *p2 = v2;
+    return p1->x == p2->x && p1->y == p2->y;
 }
 /* Add a new face to the grid, with its dot list allocated. */
 static void grid_face_add_new(grid *g, int face_size)
@@ -861,7 +1013,7 @@ static grid_dot *grid_dot_add_new(grid *g, int x, int y)
 /* Retrieve a dot with these (x,y) coordinates.  Either return an existing dot
  * in the dot_list, or add a new dot to the grid (and the dot_list) and
  * return that. */
-static grid_dot *grid_get_dot(grid *g, tree234 *dot_list, int x, int y)
+static grid_dot *grid_get_dot(grid *g, hashset *dot_list, int x, int y)
 {
     grid_dot test, *ret;
 
@@ -870,12 +1022,12 @@ static grid_dot *grid_get_dot(grid *g, tree234 *dot_list, int x, int y)
     test.faces = NULL;
     test.x = x;
     test.y = y;
-    ret = find234(dot_list, &test, NULL);
+    ret = hashset_find(dot_list, &test);
     if (ret)
         return ret;
 
     ret = grid_dot_add_new(g, x, y);
-    add234(dot_list, ret);
+    hashset_add(dot_list, ret);
     return ret;
 }
 
@@ -1406,7 +1558,7 @@ void grid_find_incentre(grid_face *f)
  * a new face reuses an existing dot.  For example, two squares touching at an
  * edge would generate six unique dots: four dots from the first face, then
  * two additional dots for the second face, because we detect the other two
- * dots have already been taken up.  This list is stored in a tree234
+ * dots have already been taken up.  This list is stored in a hashset
  * called "points".  No extra memory-allocation needed here - we store the
  * actual grid_dot* pointers, which all point into the g->dots list.
  * For this reason, we have to calculate coordinates in such a way as to
@@ -1442,12 +1594,12 @@ static grid *grid_new_square(int width, int height, const char *desc)
     /* Side length */
     int a = SQUARE_TILESIZE;
 
-    tree234 *points;
+    hashset *points;
 
     grid *g = grid_empty();
     g->tilesize = a;
 
-    points = newtree234(grid_point_cmp_fn);
+    points = hashset_new(grid_point_hash_fn, grid_point_eq_fn);
 
     /* generate square faces */
     for (y = 0; y < height; y++) {
@@ -1469,7 +1621,7 @@ static grid *grid_new_square(int width, int height, const char *desc)
         }
     }
 
-    freetree234(points);
+    hashset_free(points);
 
     grid_make_consistent(g);
     return g;
@@ -1509,12 +1661,12 @@ static grid *grid_new_honeycomb(int width, int height, const char *desc)
     int a = HONEY_A;
     int b = HONEY_B;
 
-    tree234 *points;
+    hashset *points;
 
     grid *g = grid_empty();
     g->tilesize = HONEY_TILESIZE;
 
-    points = newtree234(grid_point_cmp_fn);
+    points = hashset_new(grid_point_hash_fn, grid_point_eq_fn);
 
     /* generate hexagonal faces */
     for (y = 0; y < height; y++) {
@@ -1542,7 +1694,7 @@ static grid *grid_new_honeycomb(int width, int height, const char *desc)
         }
     }
 
-    freetree234(points);
+    hashset_free(points);
 
     grid_make_consistent(g);
     return g;
@@ -1700,7 +1852,7 @@ static grid *grid_new_triangular(int width, int height, const char *desc)
          *   5x5t1:0_21120b11a1a01a1a00c1a0b211021c1h1a2a1a0a
          *   5x6t1:0_a1212c22c2a02a2f22a0c12a110d0e1c0c0a101121a1
          */
-        tree234 *points = newtree234(grid_point_cmp_fn);
+        hashset *points = hashset_new(grid_point_hash_fn, grid_point_eq_fn);
 
         for (y = 0; y < height; y++) {
             /*
@@ -1747,7 +1899,7 @@ static grid *grid_new_triangular(int width, int height, const char *desc)
             }
         }
 
-        freetree234(points);
+        hashset_free(points);
     }
 
     grid_make_consistent(g);
@@ -1789,12 +1941,12 @@ static grid *grid_new_snubsquare(int width, int height, const char *desc)
     int a = SNUBSQUARE_A;
     int b = SNUBSQUARE_B;
 
-    tree234 *points;
+    hashset *points;
 
     grid *g = grid_empty();
     g->tilesize = SNUBSQUARE_TILESIZE;
 
-    points = newtree234(grid_point_cmp_fn);
+    points = hashset_new(grid_point_hash_fn, grid_point_eq_fn);
 
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
@@ -1867,7 +2019,7 @@ static grid *grid_new_snubsquare(int width, int height, const char *desc)
         }
     }
 
-    freetree234(points);
+    hashset_free(points);
 
     grid_make_consistent(g);
     return g;
@@ -1906,12 +2058,12 @@ static grid *grid_new_cairo(int width, int height, const char *desc)
     int a = CAIRO_A;
     int b = CAIRO_B;
 
-    tree234 *points;
+    hashset *points;
 
     grid *g = grid_empty();
     g->tilesize = CAIRO_TILESIZE;
 
-    points = newtree234(grid_point_cmp_fn);
+    points = hashset_new(grid_point_hash_fn, grid_point_eq_fn);
 
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
@@ -1977,7 +2129,7 @@ static grid *grid_new_cairo(int width, int height, const char *desc)
         }
     }
 
-    freetree234(points);
+    hashset_free(points);
 
     grid_make_consistent(g);
     return g;
@@ -2017,12 +2169,12 @@ static grid *grid_new_greathexagonal(int width, int height, const char *desc)
     int a = GREATHEX_A;
     int b = GREATHEX_B;
 
-    tree234 *points;
+    hashset *points;
 
     grid *g = grid_empty();
     g->tilesize = GREATHEX_TILESIZE;
 
-    points = newtree234(grid_point_cmp_fn);
+    points = hashset_new(grid_point_hash_fn, grid_point_eq_fn);
 
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
@@ -2111,7 +2263,7 @@ static grid *grid_new_greathexagonal(int width, int height, const char *desc)
         }
     }
 
-    freetree234(points);
+    hashset_free(points);
 
     grid_make_consistent(g);
     return g;
@@ -2151,12 +2303,12 @@ static grid *grid_new_kagome(int width, int height, const char *desc)
     int a = KAGOME_A;
     int b = KAGOME_B;
 
-    tree234 *points;
+    hashset *points;
 
     grid *g = grid_empty();
     g->tilesize = KAGOME_TILESIZE;
 
-    points = newtree234(grid_point_cmp_fn);
+    points = hashset_new(grid_point_hash_fn, grid_point_eq_fn);
 
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
@@ -2211,7 +2363,7 @@ static grid *grid_new_kagome(int width, int height, const char *desc)
         }
     }
 
-    freetree234(points);
+    hashset_free(points);
 
     grid_make_consistent(g);
     return g;
@@ -2251,12 +2403,12 @@ static grid *grid_new_octagonal(int width, int height, const char *desc)
     int a = OCTAGONAL_A;
     int b = OCTAGONAL_B;
 
-    tree234 *points;
+    hashset *points;
 
     grid *g = grid_empty();
     g->tilesize = OCTAGONAL_TILESIZE;
 
-    points = newtree234(grid_point_cmp_fn);
+    points = hashset_new(grid_point_hash_fn, grid_point_eq_fn);
 
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
@@ -2298,7 +2450,7 @@ static grid *grid_new_octagonal(int width, int height, const char *desc)
         }
     }
 
-    freetree234(points);
+    hashset_free(points);
 
     grid_make_consistent(g);
     return g;
@@ -2338,12 +2490,12 @@ static grid *grid_new_kites(int width, int height, const char *desc)
     int a = KITE_A;
     int b = KITE_B;
 
-    tree234 *points;
+    hashset *points;
 
     grid *g = grid_empty();
     g->tilesize = KITE_TILESIZE;
 
-    points = newtree234(grid_point_cmp_fn);
+    points = hashset_new(grid_point_hash_fn, grid_point_eq_fn);
 
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
@@ -2422,7 +2574,7 @@ static grid *grid_new_kites(int width, int height, const char *desc)
         }
     }
 
-    freetree234(points);
+    hashset_free(points);
 
     grid_make_consistent(g);
     return g;
@@ -2475,12 +2627,12 @@ static grid *grid_new_floret(int width, int height, const char *desc)
     int qx = 4*px/5, qy = -py*2;                /* |( 60,  52)| = 79.40 */
     int rx = qx-px, ry = qy-py;                 /* |(-15,  78)| = 79.38 */
 
-    tree234 *points;
+    hashset *points;
 
     grid *g = grid_empty();
     g->tilesize = FLORET_TILESIZE;
 
-    points = newtree234(grid_point_cmp_fn);
+    points = hashset_new(grid_point_hash_fn, grid_point_eq_fn);
 
     /* generate pentagonal faces */
     for (y = 0; y < height; y++) {
@@ -2538,7 +2690,7 @@ static grid *grid_new_floret(int width, int height, const char *desc)
         }
     }
 
-    freetree234(points);
+    hashset_free(points);
 
     grid_make_consistent(g);
     return g;
@@ -2579,12 +2731,12 @@ static grid *grid_new_dodecagonal(int width, int height, const char *desc)
     int a = DODEC_A;
     int b = DODEC_B;
 
-    tree234 *points;
+    hashset *points;
 
     grid *g = grid_empty();
     g->tilesize = DODEC_TILESIZE;
 
-    points = newtree234(grid_point_cmp_fn);
+    points = hashset_new(grid_point_hash_fn, grid_point_eq_fn);
 
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
@@ -2628,7 +2780,7 @@ static grid *grid_new_dodecagonal(int width, int height, const char *desc)
 	}
     }
 
-    freetree234(points);
+    hashset_free(points);
 
     grid_make_consistent(g);
     return g;
@@ -2664,12 +2816,12 @@ static grid *grid_new_greatdodecagonal(int width, int height, const char *desc)
     int a = DODEC_A;
     int b = DODEC_B;
 
-    tree234 *points;
+    hashset *points;
 
     grid *g = grid_empty();
     g->tilesize = DODEC_TILESIZE;
 
-    points = newtree234(grid_point_cmp_fn);
+    points = hashset_new(grid_point_hash_fn, grid_point_eq_fn);
 
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
@@ -2746,7 +2898,7 @@ static grid *grid_new_greatdodecagonal(int width, int height, const char *desc)
 	}
     }
 
-    freetree234(points);
+    hashset_free(points);
 
     grid_make_consistent(g);
     return g;
@@ -2783,12 +2935,12 @@ static grid *grid_new_greatgreatdodecagonal(int width, int height, const char *d
     int a = DODEC_A;
     int b = DODEC_B;
 
-    tree234 *points;
+    hashset *points;
 
     grid *g = grid_empty();
     g->tilesize = DODEC_TILESIZE;
 
-    points = newtree234(grid_point_cmp_fn);
+    points = hashset_new(grid_point_hash_fn, grid_point_eq_fn);
 
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
@@ -2920,7 +3072,7 @@ static grid *grid_new_greatgreatdodecagonal(int width, int height, const char *d
         }
     }
 
-    freetree234(points);
+    hashset_free(points);
 
     grid_make_consistent(g);
     return g;
@@ -2957,12 +3109,12 @@ static grid *grid_new_compassdodecagonal(int width, int height, const char *desc
     int a = DODEC_A;
     int b = DODEC_B;
 
-    tree234 *points;
+    hashset *points;
 
     grid *g = grid_empty();
     g->tilesize = DODEC_TILESIZE;
 
-    points = newtree234(grid_point_cmp_fn);
+    points = hashset_new(grid_point_hash_fn, grid_point_eq_fn);
 
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
@@ -3021,7 +3173,7 @@ static grid *grid_new_compassdodecagonal(int width, int height, const char *desc
         }
     }
 
-    freetree234(points);
+    hashset_free(points);
 
     grid_make_consistent(g);
     return g;
@@ -3067,7 +3219,7 @@ typedef struct penrose_legacy_set_faces_ctx {
     int xmin, xmax, ymin, ymax;
 
     grid *g;
-    tree234 *points;
+    hashset *points;
 } penrose_legacy_set_faces_ctx;
 
 static double round_int_nearest_away(double r)
@@ -3158,7 +3310,7 @@ static grid *grid_new_penrose_legacy(int width, int height, int which,
     int xsz, ysz, xoff, yoff, aoff;
     double rradius;
 
-    tree234 *points;
+    hashset *points;
     grid *g;
 
     penrose_legacy_state ps;
@@ -3176,7 +3328,7 @@ static grid *grid_new_penrose_legacy(int width, int height, int which,
     g = grid_empty();
     g->tilesize = tilesize;
 
-    points = newtree234(grid_point_cmp_fn);
+    points = hashset_new(grid_point_hash_fn, grid_point_eq_fn);
 
     memset(&sf_ctx, 0, sizeof(sf_ctx));
     sf_ctx.g = g;
@@ -3204,7 +3356,7 @@ static grid *grid_new_penrose_legacy(int width, int height, int which,
 
     penrose_legacy(&ps, which, aoff);
 
-    freetree234(points);
+    hashset_free(points);
 
     debug(("penrose: %d faces total (equivalent to %d wide by %d high)",
            g->num_faces, g->num_faces/height, g->num_faces/width));
@@ -3380,7 +3532,7 @@ static const char *grid_validate_desc_penrose(grid_type type,
 
 struct penrosecontext {
     grid *g;
-    tree234 *points;
+    hashset *points;
     int xunit, yunit;
 };
 
@@ -3389,6 +3541,7 @@ static void grid_penrose_callback(void *vctx, const int *coords)
     struct penrosecontext *ctx = (struct penrosecontext *)vctx;
     size_t i;
 
+    grid_phase("dots");
     grid_face_add_new(ctx->g, 4);
     for (i = 0; i < 4; i++) {
         grid_dot *d = grid_get_dot(
@@ -3399,6 +3552,7 @@ static void grid_penrose_callback(void *vctx, const int *coords)
                 coords[4*i+1] * ctx->xunit, 5));
         grid_face_set_dot(ctx->g, d, i);
     }
+    grid_phase("tiling");
 }
 
 static grid *grid_new_penrose(int width, int height, int which,
@@ -3418,19 +3572,22 @@ static grid *grid_new_penrose(int width, int height, int which,
     ctx->g = grid_empty();
     ctx->g->tilesize = PENROSE_TILESIZE;
 
-    ctx->points = newtree234(grid_point_cmp_fn);
+    ctx->points = hashset_new(grid_point_hash_fn, grid_point_eq_fn);
 
     ctx->xunit = (which == PENROSE_P2 ? PENROSE_XUNIT_P2 : PENROSE_XUNIT_P3);
     ctx->yunit = (which == PENROSE_P2 ? PENROSE_YUNIT_P2 : PENROSE_YUNIT_P3);
 
     size = api_size_penrose(width, height, which);
+    grid_phase("tiling");
     penrose_tiling_generate(&params, size.h, size.w,
                             grid_penrose_callback, ctx);
 
-    freetree234(ctx->points);
+    hashset_free(ctx->points);
     sfree(params.coords);
 
+    grid_phase("trim");
     grid_trim_vigorously(ctx->g);
+    grid_phase("consistent");
     grid_make_consistent(ctx->g);
 
     /*
@@ -3586,7 +3743,7 @@ static const char *grid_validate_desc_hats(
 
 struct hatcontext {
     grid *g;
-    tree234 *points;
+    hashset *points;
 };
 
 static void grid_hats_callback(void *vctx, size_t nvertices, int *coords)
@@ -3594,6 +3751,7 @@ static void grid_hats_callback(void *vctx, size_t nvertices, int *coords)
     struct hatcontext *ctx = (struct hatcontext *)vctx;
     size_t i;
 
+    grid_phase("dots");
     grid_face_add_new(ctx->g, nvertices);
     for (i = 0; i < nvertices; i++) {
         grid_dot *d = grid_get_dot(
@@ -3602,6 +3760,7 @@ static void grid_hats_callback(void *vctx, size_t nvertices, int *coords)
             coords[2*i+1] * HATS_YUNIT);
         grid_face_set_dot(ctx->g, d, i);
     }
+    grid_phase("tiling");
 }
 
 static grid *grid_new_hats(int width, int height, const char *desc)
@@ -3617,14 +3776,17 @@ static grid *grid_new_hats(int width, int height, const char *desc)
     ctx->g = grid_empty();
     ctx->g->tilesize = HATS_TILESIZE;
 
-    ctx->points = newtree234(grid_point_cmp_fn);
+    ctx->points = hashset_new(grid_point_hash_fn, grid_point_eq_fn);
 
+    grid_phase("tiling");
     hat_tiling_generate(&hp, width, height, grid_hats_callback, ctx);
 
-    freetree234(ctx->points);
+    hashset_free(ctx->points);
     sfree(hp.coords);
 
+    grid_phase("trim");
     grid_trim_vigorously(ctx->g);
+    grid_phase("consistent");
     grid_make_consistent(ctx->g);
     return ctx->g;
 }
@@ -3732,7 +3894,7 @@ static const char *grid_validate_desc_spectres(
 
 struct spectrecontext {
     grid *g;
-    tree234 *points;
+    hashset *points;
 };
 
 static void grid_spectres_callback(void *vctx, const int *coords)
@@ -3740,6 +3902,7 @@ static void grid_spectres_callback(void *vctx, const int *coords)
     struct spectrecontext *ctx = (struct spectrecontext *)vctx;
     size_t i;
 
+    grid_phase("dots");
     grid_face_add_new(ctx->g, SPECTRE_NVERTICES);
     for (i = 0; i < SPECTRE_NVERTICES; i++) {
         grid_dot *d = grid_get_dot(
@@ -3750,6 +3913,7 @@ static void grid_spectres_callback(void *vctx, const int *coords)
              n_times_root_k(coords[4*i+3] * SPECTRE_UNIT, 3)));
         grid_face_set_dot(ctx->g, d, i);
     }
+    grid_phase("tiling");
 }
 
 static grid *grid_new_spectres(int width, int height, const char *desc)
@@ -3767,14 +3931,17 @@ static grid *grid_new_spectres(int width, int height, const char *desc)
     ctx->g = grid_empty();
     ctx->g->tilesize = SPECTRE_TILESIZE;
 
-    ctx->points = newtree234(grid_point_cmp_fn);
+    ctx->points = hashset_new(grid_point_hash_fn, grid_point_eq_fn);
 
+    grid_phase("tiling");
     spectre_tiling_generate(&sp, width2, height2, grid_spectres_callback, ctx);
 
-    freetree234(ctx->points);
+    hashset_free(ctx->points);
     sfree(sp.coords);
 
+    grid_phase("trim");
     grid_trim_vigorously(ctx->g);
+    grid_phase("consistent");
     grid_make_consistent(ctx->g);
 
     /*
@@ -3847,12 +4014,153 @@ const char *grid_validate_desc(grid_type type, int width, int height,
     }
 }
 
+/*
+ * Fill in the index arrays in a finished grid. This has to wait until
+ * the generator has finished with it entirely, since some of them
+ * move the dots after grid_make_consistent.
+ */
+static void grid_make_index(grid *g)
+{
+    int i, j, k, n;
+
+#define FACE_INDEX(f) ((f) ? (f)->index : -1)
+
+    g->face_start = snewn(g->num_faces + 1, int);
+    for (i = n = 0; i < g->num_faces; i++) {
+        g->face_start[i] = n;
+        n += g->faces[i]->order;
+    }
+    g->face_start[i] = n;
+    g->face_edges = snewn(n, int);
+    g->face_dots = snewn(n, int);
+    for (i = 0; i < g->num_faces; i++) {
+        grid_face *f = g->faces[i];
+        k = g->face_start[i];
+        for (j = 0; j < f->order; j++) {
+            g->face_edges[k + j] = f->edges[j]->index;
+            g->face_dots[k + j] = f->dots[j]->index;
+        }
+    }
+
+    g->dot_start = snewn(g->num_dots + 1, int);
+    for (i = n = 0; i < g->num_dots; i++) {
+        g->dot_start[i] = n;
+        n += g->dots[i]->order;
+    }
+    g->dot_start[i] = n;
+    g->dot_edges = snewn(n, int);
+    g->dot_faces = snewn(n, int);
+    g->dot_x = snewn(g->num_dots, int);
+    g->dot_y = snewn(g->num_dots, int);
+    for (i = 0; i < g->num_dots; i++) {
+        grid_dot *d = g->dots[i];
+        k = g->dot_start[i];
+        for (j = 0; j < d->order; j++) {
+            g->dot_edges[k + j] = d->edges[j]->index;
+            g->dot_faces[k + j] = FACE_INDEX(d->faces[j]);
+        }
+        g->dot_x[i] = d->x;
+        g->dot_y[i] = d->y;
+    }
+
+    g->edge_dots = snewn(2 * g->num_edges, int);
+    g->edge_faces = snewn(2 * g->num_edges, int);
+    for (i = 0; i < g->num_edges; i++) {
+        grid_edge *e = g->edges[i];
+        g->edge_dots[2*i] = e->dot1->index;
+        g->edge_dots[2*i+1] = e->dot2->index;
+        g->edge_faces[2*i] = FACE_INDEX(e->face1);
+        g->edge_faces[2*i+1] = FACE_INDEX(e->face2);
+    }
+
+#undef FACE_INDEX
+}
+
+/*
+ * Cache of recently built grids. Grids are immutable once built
+ * (apart from incentres, which are filled in the same way by anyone
+ * who asks for them), so a game asking for a grid we built a moment
+ * ago - typically new_game following new_desc, or a restart - can
+ * simply be given another reference to it. The cache holds one
+ * reference of its own to each grid in it, most recently used first.
+ */
+#define GRID_CACHE_SIZE 4
+
+struct grid_cache_entry {
+    grid_type type;
+    int width, height;
+    char *desc;                        /* may be NULL */
+    grid *g;
+};
+
+static struct grid_cache_entry grid_cache[GRID_CACHE_SIZE];
+static int grid_cache_len = 0;
+static bool grid_cache_enabled = true;
+
+static void grid_cache_clear(void)
+{
+    while (grid_cache_len > 0) {
+        struct grid_cache_entry *e = &grid_cache[--grid_cache_len];
+        sfree(e->desc);
+        grid_free(e->g);
+    }
+}
+
+void grid_cache_disable(void)
+{
+    grid_cache_clear();
+    grid_cache_enabled = false;
+}
+
 grid *grid_new(grid_type type, int width, int height, const char *desc)
 {
     const char *err = grid_validate_desc(type, width, height, desc);
+    struct grid_cache_entry found;
+    int i;
+
     if (err) assert(!"Invalid grid description.");
 
-    return grid_news[type](width, height, desc);
+    if (!grid_cache_enabled) {
+        grid *g = grid_news[type](width, height, desc);
+        grid_phase("index");
+        grid_make_index(g);
+        return g;
+    }
+
+    for (i = 0; i < grid_cache_len; i++) {
+        struct grid_cache_entry *e = &grid_cache[i];
+        if (e->type == type && e->width == width && e->height == height &&
+            (desc ? e->desc && !strcmp(e->desc, desc) : !e->desc))
+            break;
+    }
+
+    if (i < grid_cache_len) {
+        found = grid_cache[i];
+    } else {
+        found.type = type;
+        found.width = width;
+        found.height = height;
+        found.desc = desc ? dupstr(desc) : NULL;
+        found.g = grid_news[type](width, height, desc);
+        grid_phase("index");
+        grid_make_index(found.g);
+        if (grid_cache_len == GRID_CACHE_SIZE) {
+            /* Evict the least recently used grid. */
+            i = --grid_cache_len;
+            sfree(grid_cache[i].desc);
+            grid_free(grid_cache[i].g);
+        } else {
+            i = grid_cache_len;
+        }
+        grid_cache_len++;
+    }
+
+    /* Move the entry to the front. */
+    memmove(grid_cache + 1, grid_cache, i * sizeof(*grid_cache));
+    grid_cache[0] = found;
+
+    found.g->refcount++;
+    return found.g;
 }
 
 void grid_compute_size(grid_type type, int width, int height,
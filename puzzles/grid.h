@@ -80,6 +80,26 @@ typedef struct grid {
   int num_edges, size_edges; grid_edge **edges;
   int num_dots,  size_dots;  grid_dot **dots;
 
+  /*
+   * The same incidence relationships again, as flat arrays of
+   * indices, for solvers and generators whose inner loops would
+   * otherwise chase pointers all over the heap. These are filled in
+   * by grid_new once the grid is complete.
+   *
+   * The edges around face f are face_edges[face_start[f]] up to (not
+   * including) face_edges[face_start[f+1]], in the same order as
+   * f->edges, and similarly face_dots for f->dots. dot_start,
+   * dot_edges and dot_faces do the same for dots. Edge e joins dots
+   * edge_dots[2*e] (dot1) and edge_dots[2*e+1] (dot2), and
+   * edge_faces[2*e] and edge_faces[2*e+1] are face1 and face2.
+   * Anywhere a face pointer would be NULL for the infinite outside
+   * face, the index is -1.
+   */
+  int *face_start, *face_edges, *face_dots;
+  int *dot_start, *dot_edges, *dot_faces;
+  int *edge_dots, *edge_faces;
+  int *dot_x, *dot_y;
+
   /* Cache the bounding-box of the grid, so the drawing-code can quickly
    * figure out the proper scaling to draw onto a given area. */
   int lowest_x, lowest_y, highest_x, highest_y;
@@ -90,6 +110,21 @@ typedef struct grid {
    * of a square cell. */
   int tilesize;
 
+  /*
+   * Spatial index for grid_nearest_edge, built by its first call (so
+   * shared by everything holding a reference to the grid). The index
+   * divides the plane from (edge_index_x, edge_index_y) into
+   * edge_index_w by edge_index_h square buckets of side
+   * edge_index_cell. Bucket b lists, in increasing order, the edges
+   * edge_index_edges[edge_index_start[b]] up to (not including)
+   * edge_index_edges[edge_index_start[b+1]]: those that
+   * grid_nearest_edge could pick for some point in the bucket.
+   * edge_index_start is NULL until the index is built.
+   */
+  int edge_index_x, edge_index_y, edge_index_cell;
+  int edge_index_w, edge_index_h;
+  int *edge_index_start, *edge_index_edges;
+
   /* We really don't want to copy this monstrosity!
    * A grid is immutable once generated.
    */
@@ -131,10 +166,23 @@ char *grid_new_desc(grid_type type, int width, int height, random_state *rs);
 const char *grid_validate_desc(grid_type type, int width, int height,
                                const char *desc);
 
+/* Returns a reference to a grid, which may be shared with other
+ * callers (and with a small cache of recently built grids inside
+ * grid.c); release it with grid_free. Grids must not be modified. */
 grid *grid_new(grid_type type, int width, int height, const char *desc);
 
 void grid_free(grid *g);
 
+/* The grid cache isn't thread-safe. Programs that create grids on
+ * more than one thread must call this first. */
+void grid_cache_disable(void);
+
+/* For benchmarks: fn is called as grid_new moves on to each stage of
+ * building a Penrose, hat or spectre grid ("tiling", "dots", "trim",
+ * "consistent", "index"), with the tiling and dots stages alternating
+ * as each tile is added. Global, and not thread-safe. */
+void grid_set_phase_hook(void (*fn)(void *ctx, const char *phase), void *ctx);
+
 grid_edge *grid_nearest_edge(grid *g, int x, int y);
 
 void grid_compute_size(grid_type type, int width, int height,
@@ -380,6 +380,9 @@ struct frontend {
     const float *colours;
     cairo_t *cr;
     cairo_surface_t *image;
+#if GTK_CHECK_VERSION(3,0,0)
+    cairo_region_t *damage;	       /* draw_update areas this frame */
+#endif
     GdkColor background;	       /* for painting outside puzzle area */
 #else
     GdkPixmap *pixmap;
@@ -473,6 +476,7 @@ struct frontend {
 struct blitter {
 #ifdef USE_CAIRO
     cairo_surface_t *image;
+    cairo_t *cr;                       /* on image, kept between saves */
 #else
     GdkPixmap *pixmap;
 #endif
@@ -820,24 +824,36 @@ static void setup_blitter(frontend *fe,  blitter *bl, int w, int h)
      * during the first call to blitter_save.
      */
     bl->image = NULL;
+    bl->cr = NULL;
 }
 
 static void teardown_blitter(blitter *bl)
 {
-    if (bl->image)
+    if (bl->image) {
+        cairo_destroy(bl->cr);
         cairo_surface_destroy(bl->image);
+    }
 }
 
 static void do_blitter_save(frontend *fe, blitter *bl, int x, int y)
 {
-    cairo_t *cr;
-    if (!bl->image)
+    /*
+     * Blitters are typically saved and loaded once per animation
+     * frame, so the surface and a context to copy into it are made
+     * once and kept. The copy replaces what's there, so there's no
+     * need to blend it.
+     */
+    if (!bl->image) {
         bl->image = cairo_surface_create_similar(
             fe->image, CAIRO_CONTENT_COLOR, bl->w, bl->h);
-    cr = cairo_create(bl->image);
-    cairo_set_source_surface(cr, fe->image, -x, -y);
-    cairo_paint(cr);
-    cairo_destroy(cr);
+        bl->cr = cairo_create(bl->image);
+        cairo_set_operator(bl->cr, CAIRO_OPERATOR_SOURCE);
+    }
+    cairo_set_source_surface(bl->cr, fe->image, -x, -y);
+    cairo_paint(bl->cr);
+    /* Don't keep fe->image alive as the source, in case it's about to
+     * be replaced by a resize. */
+    cairo_set_source_rgb(bl->cr, 0, 0, 0);
 }
 
 static void do_blitter_load(frontend *fe, blitter *bl, int x, int y)
@@ -1350,6 +1366,9 @@ static void gtk_start_draw(drawing *dr)
     fe->bbox_r = 0;
     fe->bbox_u = fe->h;
     fe->bbox_d = 0;
+#if GTK_CHECK_VERSION(3,0,0)
+    fe->damage = cairo_region_create();
+#endif
     setup_drawing(fe);
 }
 
@@ -1468,6 +1487,20 @@ static void gtk_blitter_load(drawing *dr, blitter *bl, int x, int y)
 static void gtk_draw_update(drawing *dr, int x, int y, int w, int h)
 {
     frontend *fe = GET_HANDLE_AS_TYPE(dr, frontend);
+#if GTK_CHECK_VERSION(3,0,0)
+    /*
+     * Keep the updated areas themselves, not just their bounding box,
+     * so that (say) a cursor move from one corner of the puzzle to
+     * the other doesn't repaint everything in between. The margin is
+     * for antialiasing, as below.
+     */
+    cairo_rectangle_int_t rect;
+    rect.x = x - 1;
+    rect.y = y - 1;
+    rect.width = w + 2;
+    rect.height = h + 2;
+    cairo_region_union_rectangle(fe->damage, &rect);
+#endif
     if (fe->bbox_l > x  ) fe->bbox_l = x  ;
     if (fe->bbox_r < x+w) fe->bbox_r = x+w;
     if (fe->bbox_u > y  ) fe->bbox_u = y  ;
@@ -1480,6 +1513,15 @@ static void gtk_end_draw(drawing *dr)
 
     teardown_drawing(fe);
 
+#if GTK_CHECK_VERSION(3,0,0)
+    /* One expose for the whole frame, covering just what changed. */
+    if (!cairo_region_is_empty(fe->damage) && !fe->headless) {
+        cairo_region_translate(fe->damage, fe->ox, fe->oy);
+        gtk_widget_queue_draw_region(fe->area, fe->damage);
+    }
+    cairo_region_destroy(fe->damage);
+    fe->damage = NULL;
+#else
     if (fe->bbox_l < fe->bbox_r && fe->bbox_u < fe->bbox_d && !fe->headless) {
 #ifdef USE_CAIRO
         gtk_widget_queue_draw_area(fe->area,
@@ -1495,6 +1537,7 @@ static void gtk_end_draw(drawing *dr)
 			  fe->bbox_d - fe->bbox_u + 2);
 #endif
     }
+#endif
 }
 
 #ifdef USE_PANGO
@@ -4310,10 +4353,98 @@ static void list_presets_from_menu(struct preset_menu *menu)
     }
 }
 
+static void collect_presets_from_menu(struct preset_menu *menu,
+                                      char ***pstrs, int *npstrs, int *size)
+{
+    int i;
+
+    for (i = 0; i < menu->n_entries; i++) {
+        if (menu->entries[i].params) {
+            if (*npstrs >= *size) {
+                *size = *size * 5 / 4 + 16;
+                *pstrs = sresize(*pstrs, *size, char *);
+            }
+            (*pstrs)[(*npstrs)++] = thegame.encode_params(
+                menu->entries[i].params, true);
+        } else {
+            collect_presets_from_menu(menu->entries[i].submenu,
+                                      pstrs, npstrs, size);
+        }
+    }
+}
+
+/*
+ * Multi-threaded version of the --generate loop, used if --threads
+ * or --all-presets is given. Every parameter string is given a random
+ * seed (if it doesn't already have one), so that the same seed
+ * produces the same output however the work is divided.
+ */
+static int batch_generate_main(const char *pname, const char *arg,
+                               bool all_presets, int ngenerate,
+                               const struct batchgen_options *opts)
+{
+    char **pstrs = NULL;
+    int npstrs = 0, size = 0, i, ret;
+    char seedbuf[40];
+
+    {
+        void *randseed;
+        int randseedsize;
+        random_state *rs;
+
+        get_random_seed(&randseed, &randseedsize);
+        rs = random_new(randseed, randseedsize);
+        sprintf(seedbuf, "#%lu", random_bits(rs, 31));
+        random_free(rs);
+        sfree(randseed);
+    }
+
+    if (all_presets) {
+        midend *me = midend_new(NULL, &thegame, NULL, NULL);
+        if (arg) {
+            fprintf(stderr, "%s: '--all-presets' cannot be combined with "
+                    "a game parameter string\n", pname);
+            midend_free(me);
+            return 1;
+        }
+        collect_presets_from_menu(midend_get_presets(me, NULL),
+                                  &pstrs, &npstrs, &size);
+        midend_free(me);
+    } else {
+        pstrs = snewn(1, char *);
+        if (arg) {
+            pstrs[0] = dupstr(arg);
+        } else {
+            game_params *params = thegame.default_params();
+            pstrs[0] = thegame.encode_params(params, true);
+            thegame.free_params(params);
+        }
+        npstrs = 1;
+    }
+
+    for (i = 0; i < npstrs; i++) {
+        if (!strchr(pstrs[i], '#')) {
+            pstrs[i] = sresize(pstrs[i], strlen(pstrs[i]) +
+                               strlen(seedbuf) + 1, char);
+            strcat(pstrs[i], seedbuf);
+        }
+    }
+
+    ret = batch_generate(&thegame, (const char *const *)pstrs, npstrs,
+                         ngenerate, opts, stdout);
+
+    for (i = 0; i < npstrs; i++)
+        sfree(pstrs[i]);
+    sfree(pstrs);
+    return ret;
+}
+
 int main(int argc, char **argv)
 {
     char *pname = argv[0];
     int ngenerate = 0, px = 1, py = 1;
+    int nthreads = 0;
+    bool all_presets = false;
     bool print = false;
     bool time_generation = false, test_solve = false, list_presets = false;
     bool delete_prefs_action = false;
@@ -4369,6 +4500,21 @@ int main(int argc, char **argv)
 		}
 	    } else
 		ngenerate = 1;
+	} else if (doing_opts && !strcmp(p, "--threads")) {
+	    if (--ac > 0) {
+		nthreads = atoi(*++av);
+		if (nthreads < 1) {
+		    fprintf(stderr, "%s: '--threads' expected a positive "
+                            "number\n", pname);
+		    return 1;
+		}
+	    } else {
+		fprintf(stderr, "%s: '--threads' expected a number\n",
+			pname);
+		return 1;
+	    }
+	} else if (doing_opts && !strcmp(p, "--all-presets")) {
+            all_presets = true;
 	} else if (doing_opts && !strcmp(p, "--time-generation")) {
             time_generation = true;
 	} else if (doing_opts && !strcmp(p, "--test-solve")) {
@@ -4525,6 +4671,7 @@ int main(int argc, char **argv)
 	midend *me;
 	char *id;
 	document *doc = NULL;
+	psdata *ps = NULL;
 
         /*
          * If we're in this branch, we should display any pending
@@ -4538,6 +4685,41 @@ int main(int argc, char **argv)
 
 	n = ngenerate;
 
+        if (nthreads > 0 || all_presets) {
+            struct batchgen_options opts;
+            psdata *ps = NULL;
+            int ret;
+
+            if (ngenerate == 0 || savefile) {
+                fprintf(stderr, "%s: '--threads' and '--all-presets' are "
+                        "only supported with '--generate'\n", pname);
+                return 1;
+            }
+            if (print && time_generation) {
+                fprintf(stderr, "%s: '--time-generation' is not supported "
+                        "with '--print' and '--threads'\n", pname);
+                return 1;
+            }
+            opts.nthreads = nthreads > 0 ? nthreads : 1;
+            opts.time_generation = time_generation;
+            opts.test_solve = test_solve;
+            opts.doc = NULL;
+            opts.with_soln = soln;
+            if (print) {
+                opts.doc = document_new(px, py, scale);
+                ps = ps_init(stdout, colour);
+                document_stream_begin(opts.doc, ps_drawing_api(ps));
+            }
+            ret = batch_generate_main(pname, arg, all_presets,
+                                      ngenerate, &opts);
+            if (print) {
+                document_stream_end(opts.doc);
+                document_free(opts.doc);
+                ps_free(ps);
+            }
+            return ret;
+        }
+
 	me = midend_new(NULL, &thegame, NULL, NULL);
 	i = 0;
 
@@ -4546,8 +4728,15 @@ int main(int argc, char **argv)
 	if (!savefile && savesuffix)
 	    savefile = "";
 
-	if (print)
+	/*
+	 * Printed output is streamed a page at a time, so that we
+	 * needn't keep every puzzle in memory until the end.
+	 */
+	if (print) {
 	    doc = document_new(px, py, scale);
+	    ps = ps_init(stdout, colour);
+	    document_stream_begin(doc, ps_drawing_api(ps));
+	}
 
 	/*
 	 * In this loop, we either generate a game ID or read one
@@ -4704,8 +4893,7 @@ int main(int argc, char **argv)
 	}
 
 	if (doc) {
-	    psdata *ps = ps_init(stdout, colour);
-	    document_print(doc, ps_drawing_api(ps));
+	    document_stream_end(doc);
 	    document_free(doc);
 	    ps_free(ps);
 	}
@@ -4744,6 +4932,9 @@ int main(int argc, char **argv)
         if (!headless)
             gtk_init(&argc, &argv);
 
+        /* Let generators spread their work over the available cores. */
+        threadpool_start((int)sysconf(_SC_NPROCESSORS_ONLN));
+
 	fe = new_window(arg, argtype, &error, headless);
 
 	if (!fe) {
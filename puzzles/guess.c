@@ -7,6 +7,7 @@
 #include <string.h>
 #include <assert.h>
 #include <ctype.h>
+#include <limits.h>
 #ifdef NO_TGMATH_H
 #  include <math.h>
 #else
@@ -402,6 +403,9 @@ done:
     return ret;
 }
 
+struct guess_solver;
+static void guess_solver_reset(struct guess_solver *gs);
+
 struct game_ui {
     game_params params;
     pegrow curr_pegs; /* half-finished current move */
@@ -415,6 +419,7 @@ struct game_ui {
 
     bool show_labels;                   /* label the colours with numbers */
     pegrow hint;
+    struct guess_solver *solver;        /* for hints; see compute_hint */
 };
 
 static game_ui *new_ui(const game_state *state)
@@ -454,10 +459,14 @@ static void set_prefs(game_ui *ui, const config_item *cfg)
     ui->show_labels = cfg[PREF_SHOW_LABELS].u.boolean.bval;
 }
 
+static void guess_solver_free(struct guess_solver *gs);
+
 static void free_ui(game_ui *ui)
 {
     if (ui->hint)
         free_pegrow(ui->hint);
+    if (ui->solver)
+        guess_solver_free(ui->solver);
     if (ui->curr_pegs)
         free_pegrow(ui->curr_pegs);
     sfree(ui->holds);
@@ -517,6 +526,8 @@ static void game_changed_state(game_ui *ui, const game_state *oldstate,
     if (newstate->next_go < oldstate->next_go) {
         sfree(ui->hint);
         ui->hint = NULL;
+        if (ui->solver)
+            guess_solver_reset(ui->solver);
     }
 
     /* Implement holds, clear other pegs.
@@ -681,7 +692,241 @@ static char *encode_move(const game_state *from, game_ui *ui)
     return buf;
 }
 
-static void compute_hint(const game_state *state, game_ui *ui)
+/* ----------------------------------------------------------------------
+ * Minimax solver, for hints.
+ *
+ * This plays Knuth's strategy for Mastermind: each guess is the one
+ * whose worst-case feedback leaves the fewest codes consistent with
+ * everything seen so far, preferring a guess which could itself be
+ * the answer, and then the lexicographically first. It works over a
+ * list of every possible code (every markable row without blanks,
+ * since solutions never have any), so it's only set up when that
+ * list is of a sensible length; and it only does the full minimax
+ * when the number of (guess, code) pairs to score is within budget,
+ * taking the first consistent code otherwise (as the old-style hint
+ * would). Early in a large game that's the usual case, but each guess
+ * cuts the consistent codes down quickly.
+ *
+ * A solver kept in the game_ui for repeated hints also precomputes
+ * the score of every (guess, code) pair, if there are few enough.
+ */
+#define GUESS_MAX_CODES 131072          /* list of codes */
+#define GUESS_MINIMAX_BUDGET 16777216   /* scores per minimax choice */
+#define GUESS_TABLE_BUDGET 4194304      /* bytes of precomputed scores */
+
+struct guess_solver {
+    int npegs, ncolours, ncodes;
+    unsigned char *pegs;        /* ncodes rows of npegs colours */
+    unsigned char *counts;      /* ncodes rows of ncolours colour counts */
+    unsigned char *table;       /* ncodes*ncodes scores, if precomputed */
+    bool want_table;
+    unsigned long *consistent;  /* bitmap of codes fitting the feedback */
+    int nguesses;               /* how many guesses that has checked */
+};
+
+static void guess_solver_fill(struct guess_solver *gs, const game_params *params,
+                              unsigned char *row, int depth, int *n)
+{
+    int c, i;
+
+    if (depth == gs->npegs) {
+        memcpy(gs->pegs + *n * gs->npegs, row, gs->npegs);
+        memset(gs->counts + *n * gs->ncolours, 0, gs->ncolours);
+        for (i = 0; i < gs->npegs; i++)
+            gs->counts[*n * gs->ncolours + row[i] - 1]++;
+        (*n)++;
+        return;
+    }
+    for (c = 1; c <= gs->ncolours; c++) {
+        for (i = 0; !params->allow_multiple && i < depth; i++)
+            if (row[i] == c) break;
+        if (params->allow_multiple || i == depth) {
+            row[depth] = c;
+            guess_solver_fill(gs, params, row, depth + 1, n);
+        }
+    }
+}
+
+/* Returns NULL if there are too many codes. */
+static struct guess_solver *guess_solver_new(const game_params *params,
+                                             bool want_table)
+{
+    struct guess_solver *gs;
+    unsigned char *row;
+    long ncodes = 1;
+    int i, n = 0;
+
+    for (i = 0; i < params->npegs; i++) {
+        ncodes *= params->allow_multiple ? params->ncolours :
+            params->ncolours - i;
+        if (ncodes > GUESS_MAX_CODES)
+            return NULL;
+    }
+
+    gs = snew(struct guess_solver);
+    gs->npegs = params->npegs;
+    gs->ncolours = params->ncolours;
+    gs->ncodes = ncodes;
+    gs->pegs = snewn(ncodes * gs->npegs, unsigned char);
+    gs->counts = snewn(ncodes * gs->ncolours, unsigned char);
+    gs->table = NULL;
+    gs->want_table = want_table &&
+        (double)ncodes * ncodes <= GUESS_TABLE_BUDGET;
+    gs->consistent = snewn(BITMAP_WORDS(ncodes), unsigned long);
+    row = snewn(gs->npegs, unsigned char);
+    guess_solver_fill(gs, params, row, 0, &n);
+    assert(n == ncodes);
+    sfree(row);
+    guess_solver_reset(gs);
+    return gs;
+}
+
+static void guess_solver_free(struct guess_solver *gs)
+{
+    sfree(gs->pegs);
+    sfree(gs->counts);
+    sfree(gs->table);
+    sfree(gs->consistent);
+    sfree(gs);
+}
+
+/* Forget the guesses checked so far, as after an undo. */
+static void guess_solver_reset(struct guess_solver *gs)
+{
+    int i;
+    for (i = 0; i < BITMAP_WORDS(gs->ncodes); i++)
+        gs->consistent[i] = ~0UL;
+    gs->nguesses = 0;
+}
+
+/*
+ * The feedback from guessing pegs (with colour counts counts) when
+ * the answer is code c, as a single number: as mark_pegs would
+ * compute it, but with the colour counts done in advance.
+ */
+static int guess_score(const struct guess_solver *gs,
+                       const unsigned char *pegs, const unsigned char *counts,
+                       int c)
+{
+    const unsigned char *cpegs = gs->pegs + c * gs->npegs;
+    const unsigned char *ccounts = gs->counts + c * gs->ncolours;
+    int nc_place = 0, nc_total = 0, i;
+
+    for (i = 0; i < gs->npegs; i++)
+        if (pegs[i] == cpegs[i]) nc_place++;
+    for (i = 0; i < gs->ncolours; i++)
+        nc_total += min(counts[i], ccounts[i]);
+    return nc_place * (gs->npegs + 1) + nc_total - nc_place;
+}
+
+/*
+ * Returns the index of the code to guess next in state, or -1 if no
+ * code is consistent with its feedback.
+ */
+static int guess_solver_choose(struct guess_solver *gs,
+                               const game_state *state)
+{
+    unsigned char *pegs = snewn(gs->npegs, unsigned char);
+    unsigned char *counts = snewn(gs->ncolours, unsigned char);
+    int *cons, ncons, *sizes, nscores = (gs->npegs + 1) * (gs->npegs + 1);
+    int i, j, g, ncands, best, bestworst;
+    bool bestcons;
+
+    /* Rule out the codes which don't fit any new feedback. */
+    for (; gs->nguesses < state->next_go; gs->nguesses++) {
+        const pegrow guess = state->guesses[gs->nguesses];
+        int nc_place = 0, nc_colour = 0, target;
+
+        memset(counts, 0, gs->ncolours);
+        for (i = 0; i < gs->npegs; i++) {
+            pegs[i] = guess->pegs[i];
+            if (pegs[i] > 0)
+                counts[pegs[i] - 1]++;
+            if (guess->feedback[i] == FEEDBACK_CORRECTPLACE) nc_place++;
+            if (guess->feedback[i] == FEEDBACK_CORRECTCOLOUR) nc_colour++;
+        }
+        target = nc_place * (gs->npegs + 1) + nc_colour;
+        for (j = 0; j < gs->ncodes; j++)
+            if (BITMAP_GET(gs->consistent, j) &&
+                guess_score(gs, pegs, counts, j) != target)
+                BITMAP_CLEAR(gs->consistent, j);
+    }
+    sfree(pegs);
+    sfree(counts);
+
+    cons = snewn(gs->ncodes, int);
+    ncons = 0;
+    for (j = 0; j < gs->ncodes; j++)
+        if (BITMAP_GET(gs->consistent, j))
+            cons[ncons++] = j;
+
+    if (ncons <= 2) {
+        /* Nothing to choose between. */
+        best = ncons ? cons[0] : -1;
+        sfree(cons);
+        return best;
+    }
+
+    /*
+     * Try every code as a guess if that's affordable. If not, try
+     * just the consistent ones; and if even that's too many, try an
+     * evenly spaced sample of them, and judge each try by how it
+     * splits up the same sample.
+     */
+    if ((double)gs->ncodes * ncons <= GUESS_MINIMAX_BUDGET) {
+        ncands = gs->ncodes;
+    } else {
+        int step = 1;
+        while ((double)((ncons + step - 1) / step) *
+               ((ncons + step - 1) / step) > GUESS_MINIMAX_BUDGET)
+            step++;
+        for (i = j = 0; j < ncons; j += step)
+            cons[i++] = cons[j];
+        ncons = ncands = i;
+    }
+
+    if (gs->want_table && ncands == gs->ncodes && !gs->table) {
+        gs->table = snewn(gs->ncodes * gs->ncodes, unsigned char);
+        assert(nscores <= 256);
+        for (g = 0; g < gs->ncodes; g++)
+            for (j = 0; j < gs->ncodes; j++)
+                gs->table[g * gs->ncodes + j] = guess_score(
+                    gs, gs->pegs + g * gs->npegs,
+                    gs->counts + g * gs->ncolours, j);
+    }
+
+    sizes = snewn(nscores, int);
+    best = -1;
+    bestworst = INT_MAX;
+    bestcons = false;
+    for (i = 0; i < ncands; i++) {
+        int worst = 0;
+        bool iscons;
+
+        g = ncands == gs->ncodes ? i : cons[i];
+        memset(sizes, 0, nscores * sizeof(int));
+        for (j = 0; j < ncons && worst <= bestworst; j++) {
+            int score = gs->table ? gs->table[g * gs->ncodes + cons[j]] :
+                guess_score(gs, gs->pegs + g * gs->npegs,
+                            gs->counts + g * gs->ncolours, cons[j]);
+            if (++sizes[score] > worst)
+                worst = sizes[score];
+        }
+        iscons = BITMAP_GET(gs->consistent, g);
+        if (worst < bestworst ||
+            (worst == bestworst && iscons && !bestcons)) {
+            best = g;
+            bestworst = worst;
+            bestcons = iscons;
+        }
+    }
+
+    sfree(sizes);
+    sfree(cons);
+    return best;
+}
+
+static void compute_hint_search(const game_state *state, game_ui *ui)
 {
     /* Suggest the lexicographically first row consistent with all
      * previous feedback.  This is not only a useful hint, but also
@@ -805,6 +1050,56 @@ increase_mincolour:
     }
 }
 
+static void compute_hint(const game_state *state, game_ui *ui)
+{
+    int code;
+
+    /*
+     * Where the minimax solver above can be set up, it gives the
+     * hint. (The guess it suggests need not be consistent with the
+     * feedback so far, if a different one will narrow things down
+     * faster.) Otherwise, fall back to the search below.
+     */
+    if (!ui->solver)
+        ui->solver = guess_solver_new(&state->params, true);
+    if (ui->solver && (code = guess_solver_choose(ui->solver, state)) >= 0) {
+        int i;
+        for (i = 0; i < state->params.npegs; ++i)
+            ui->curr_pegs->pegs[i] =
+                ui->solver->pegs[code * state->params.npegs + i];
+
+        ui->markable = true;
+        ui->peg_cur = state->params.npegs;
+        ui->display_cur = true;
+        return;
+    }
+
+    compute_hint_search(state, ui);
+}
+
+static char *solve_step(const game_state *orig, const game_state *curr,
+                        const char *aux, const char **error)
+{
+    game_ui *ui;
+    char *ret = NULL;
+
+    if (curr->solved) {
+        *error = "Game is already over";
+        return NULL;
+    }
+
+    /* A hint here is a one-off, so isn't worth a table of scores. */
+    ui = new_ui(curr);
+    ui->solver = guess_solver_new(&curr->params, false);
+    compute_hint(curr, ui);
+    if (ui->markable)
+        ret = encode_move(curr, ui);
+    else
+        *error = "No code is consistent with the feedback so far";
+    free_ui(ui);
+    return ret;
+}
+
 static char *interpret_move(const game_state *from, game_ui *ui,
                             const game_drawstate *ds,
                             int x, int y, int button)
@@ -1550,7 +1845,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    solve_step,
+    NULL, /* grade */
+    NULL, /* speculate */
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     get_prefs, set_prefs,
     new_ui,
@@ -0,0 +1,187 @@
+/*
+ * hashset.c: an unordered set of pointers, for callers which only
+ * ever look things up in it and would otherwise be paying for a
+ * tree234's ordering.
+ */
+
+#include <assert.h>
+
+#include "puzzles.h"
+
+/*
+ * Implementation: open addressing with linear probing, in a table
+ * whose size is a power of two and which is never more than 2/3
+ * full. Each slot remembers its element's hash as well as the
+ * element, so that a probe only calls the equality function on an
+ * element whose hash matches, and growing the table never calls the
+ * hash function at all.
+ *
+ * Deletion moves later elements of the same run back into the gap
+ * (rather than leaving a tombstone), so every run stays contiguous
+ * and a lookup can always stop at the first empty slot.
+ */
+
+struct hashset_slot {
+    void *elem;                        /* NULL if the slot is empty */
+    unsigned long hash;
+};
+
+struct hashset {
+    hashset_hashfn_t hash;
+    hashset_eqfn_t eq;
+    size_t size, count;                /* size is a power of two */
+    struct hashset_slot *slots;
+};
+
+#define HASHSET_MINSIZE 16
+
+hashset *hashset_new(hashset_hashfn_t hash, hashset_eqfn_t eq)
+{
+    hashset *hs = snew(hashset);
+    size_t i;
+
+    hs->hash = hash;
+    hs->eq = eq;
+    hs->size = HASHSET_MINSIZE;
+    hs->count = 0;
+    hs->slots = snewn(hs->size, struct hashset_slot);
+    for (i = 0; i < hs->size; i++)
+        hs->slots[i].elem = NULL;
+    return hs;
+}
+
+void hashset_free(hashset *hs)
+{
+    sfree(hs->slots);
+    sfree(hs);
+}
+
+size_t hashset_count(const hashset *hs)
+{
+    return hs->count;
+}
+
+/*
+ * Find the slot holding an element equal to elem (whose hash is
+ * 'hash'), or else the empty slot where it would go.
+ */
+static size_t hashset_probe(const hashset *hs, const void *elem,
+                            unsigned long hash)
+{
+    size_t mask = hs->size - 1, i = hash & mask;
+
+    while (hs->slots[i].elem) {
+        if (hs->slots[i].hash == hash && hs->eq(hs->slots[i].elem, elem))
+            break;
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static void hashset_grow(hashset *hs)
+{
+    struct hashset_slot *old = hs->slots;
+    size_t oldsize = hs->size, i;
+
+    hs->size *= 2;
+    hs->slots = snewn(hs->size, struct hashset_slot);
+    for (i = 0; i < hs->size; i++)
+        hs->slots[i].elem = NULL;
+    for (i = 0; i < oldsize; i++) {
+        if (old[i].elem) {
+            size_t mask = hs->size - 1, j = old[i].hash & mask;
+            while (hs->slots[j].elem)
+                j = (j + 1) & mask;
+            hs->slots[j] = old[i];
+        }
+    }
+    sfree(old);
+}
+
+void *hashset_add(hashset *hs, void *elem)
+{
+    unsigned long hash;
+    size_t i;
+
+    assert(elem);
+    hash = hs->hash(elem);
+    i = hashset_probe(hs, elem, hash);
+    if (hs->slots[i].elem)
+        return hs->slots[i].elem;
+
+    if (3 * (hs->count + 1) > 2 * hs->size) {
+        hashset_grow(hs);
+        i = hashset_probe(hs, elem, hash);
+    }
+    hs->slots[i].elem = elem;
+    hs->slots[i].hash = hash;
+    hs->count++;
+    return elem;
+}
+
+void *hashset_find(const hashset *hs, const void *elem)
+{
+    return hs->slots[hashset_probe(hs, elem, hs->hash(elem))].elem;
+}
+
+void *hashset_del(hashset *hs, const void *elem)
+{
+    size_t mask = hs->size - 1, i, j;
+    void *ret;
+
+    i = hashset_probe(hs, elem, hs->hash(elem));
+    ret = hs->slots[i].elem;
+    if (!ret)
+        return NULL;
+    hs->count--;
+
+    /*
+     * Close the gap at i: any later element in the run which isn't
+     * already between its home slot and the gap can move into it,
+     * leaving a new gap behind.
+     */
+    for (j = (i + 1) & mask; hs->slots[j].elem; j = (j + 1) & mask) {
+        size_t home = hs->slots[j].hash & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            hs->slots[i] = hs->slots[j];
+            i = j;
+        }
+    }
+    hs->slots[i].elem = NULL;
+    return ret;
+}
+
+void *hashset_next(const hashset *hs, size_t *pos)
+{
+    while (*pos < hs->size) {
+        void *elem = hs->slots[(*pos)++].elem;
+        if (elem)
+            return elem;
+    }
+    return NULL;
+}
+
+/*
+ * Each int is mixed in with a multiply and a rotation, and the
+ * result finished off with MurmurHash3's 32-bit finaliser so that
+ * its low bits (the ones which pick a slot) depend on all of it.
+ * Everything's kept to 32 bits, so the hashes are the same whatever
+ * size an unsigned long is.
+ */
+unsigned long hash_ints(const int *ints, size_t n)
+{
+    unsigned long h = 0x811C9DC5UL;
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        h = ((h ^ (unsigned long)(unsigned)ints[i]) * 0x9E3779B1UL)
+            & 0xFFFFFFFFUL;
+        h = ((h << 13) | (h >> 19)) & 0xFFFFFFFFUL;
+    }
+    h ^= h >> 16;
+    h = (h * 0x85EBCA6BUL) & 0xFFFFFFFFUL;
+    h ^= h >> 13;
+    h = (h * 0xC2B2AE35UL) & 0xFFFFFFFFUL;
+    h ^= h >> 16;
+    return h;
+}
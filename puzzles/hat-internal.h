@@ -239,13 +239,26 @@ static inline void hat_coords_debug(const char *prefix, HatCoords *hc,
  * deterministic with them.)
  */
 
+#define HATCTX_NSPARE 16
+
 typedef struct HatContext {
     random_state *rs;
     HatCoords *prototype;
+
+    /*
+     * HatCoords objects freed via hatctx_coords_free, kept for reuse
+     * so that stepping around a large tiling doesn't have to allocate
+     * and free a pair of heap blocks for every single kite. Anyone
+     * setting up a HatContext by hand must set nspare to 0.
+     */
+    HatCoords *spare[HATCTX_NSPARE];
+    size_t nspare;
 } HatContext;
 
 void hatctx_init_random(HatContext *ctx, random_state *rs);
 void hatctx_cleanup(HatContext *ctx);
+HatCoords *hatctx_coords_copy(HatContext *ctx, HatCoords *hc_in);
+void hatctx_coords_free(HatContext *ctx, HatCoords *hc);
 HatCoords *hatctx_initial_coords(HatContext *ctx);
 void hatctx_extend_coords(HatContext *ctx, HatCoords *hc, size_t n);
 HatCoords *hatctx_step(HatContext *ctx, HatCoords *hc_in, KiteStep step);
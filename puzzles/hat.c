@@ -418,6 +418,32 @@ HatCoords *hat_coords_copy(HatCoords *hc_in)
     return hc_out;
 }
 
+/*
+ * Versions of hat_coords_copy and hat_coords_free which recycle
+ * HatCoords objects through the context's spare list.
+ */
+HatCoords *hatctx_coords_copy(HatContext *ctx, HatCoords *hc_in)
+{
+    HatCoords *hc_out;
+
+    if (ctx->nspare == 0)
+        return hat_coords_copy(hc_in);
+
+    hc_out = ctx->spare[--ctx->nspare];
+    hat_coords_make_space(hc_out, hc_in->nc);
+    memcpy(hc_out->c, hc_in->c, hc_in->nc * sizeof(*hc_out->c));
+    hc_out->nc = hc_in->nc;
+    return hc_out;
+}
+
+void hatctx_coords_free(HatContext *ctx, HatCoords *hc)
+{
+    if (hc && ctx->nspare < HATCTX_NSPARE)
+        ctx->spare[ctx->nspare++] = hc;
+    else
+        hat_coords_free(hc);
+}
+
 static const MetatilePossibleParent *choose_mpp(
     random_state *rs, const MetatilePossibleParent *parents, size_t nparents)
 {
@@ -452,6 +478,7 @@ void hatctx_init_random(HatContext *ctx, random_state *rs)
         rs, starting_hats, lenof(starting_hats));
 
     ctx->rs = rs;
+    ctx->nspare = 0;
     ctx->prototype = hat_coords_new();
     hat_coords_make_space(ctx->prototype, 3);
     ctx->prototype->c[2].type = starting_hat->type;
@@ -477,6 +504,7 @@ static void init_coords_params(HatContext *ctx,
     size_t i;
 
     ctx->rs = NULL;
+    ctx->nspare = 0;
     ctx->prototype = hat_coords_new();
 
     assert(hp->ncoords >= 3);
@@ -505,7 +533,7 @@ static void init_coords_params(HatContext *ctx,
 
 HatCoords *hatctx_initial_coords(HatContext *ctx)
 {
-    return hat_coords_copy(ctx->prototype);
+    return hatctx_coords_copy(ctx, ctx->prototype);
 }
 
 /*
@@ -549,6 +577,8 @@ void hatctx_extend_coords(HatContext *ctx, HatCoords *hc, size_t n)
 void hatctx_cleanup(HatContext *ctx)
 {
     hat_coords_free(ctx->prototype);
+    while (ctx->nspare > 0)
+        hat_coords_free(ctx->spare[--ctx->nspare]);
 }
 
 /*
@@ -576,7 +606,7 @@ static HatCoords *try_step_coords_kitemap(
          * Success! We've got coordinates for the next kite in this
          * direction.
          */
-        HatCoords *hc_out = hat_coords_copy(hc_in);
+        HatCoords *hc_out = hatctx_coords_copy(ctx, hc_in);
 
         hc_out->c[2].index = ke->meta;
         hc_out->c[2].type = children[meta2type][ke->meta];
@@ -625,14 +655,14 @@ static HatCoords *try_step_coords_metamap(
         else
             hc_out = try_step_coords_kitemap(ctx, hc_curr, step);
         if (hc_out) {
-            hat_coords_free(hc_tmp);
+            hatctx_coords_free(ctx, hc_tmp);
             return hc_out;
         }
 
         me = &metamap[meta3type][metamap_index(meta, meta2)];
         assert(me->meta != -1);
         if (me->meta == meta_orig && me->meta2 == meta2_orig) {
-            hat_coords_free(hc_tmp);
+            hatctx_coords_free(ctx, hc_tmp);
             return NULL;
         }
 
@@ -651,7 +681,7 @@ static HatCoords *try_step_coords_metamap(
          * just use a separate copy.
          */
         if (!hc_tmp)
-            hc_tmp = hat_coords_copy(hc_in);
+            hc_tmp = hatctx_coords_copy(ctx, hc_in);
 
         hc_tmp->c[depth+1].index = meta2;
         hc_tmp->c[depth+1].type = children[meta3type][meta2];
@@ -724,7 +754,7 @@ void hat_tiling_randomise(struct HatPatchParams *hp, int w, int h,
     coords[s->curr_index] = hatctx_initial_coords(ctx);
 
     while (hat_kiteenum_next(s)) {
-        hat_coords_free(coords[s->curr_index]);
+        hatctx_coords_free(ctx, coords[s->curr_index]);
         coords[s->curr_index] = hatctx_step(
             ctx, coords[s->last_index], s->last_step);
     }
@@ -735,9 +765,9 @@ void hat_tiling_randomise(struct HatPatchParams *hp, int w, int h,
         hp->coords[i] = ctx->prototype->c[i].index;
     hp->final_metatile = tilechars[ctx->prototype->c[hp->ncoords].type];
 
-    hatctx_cleanup(ctx);
     for (i = 0; i < lenof(coords); i++)
-        hat_coords_free(coords[i]);
+        hatctx_coords_free(ctx, coords[i]);
+    hatctx_cleanup(ctx);
 }
 
 const char *hat_tiling_params_invalid(const struct HatPatchParams *hp)
@@ -878,14 +908,14 @@ void hat_tiling_generate(const struct HatPatchParams *hp, int w, int h,
                      report_hat, report_hat_ctx);
 
     while (hat_kiteenum_next(s)) {
-        hat_coords_free(coords[s->curr_index]);
+        hatctx_coords_free(ctx, coords[s->curr_index]);
         coords[s->curr_index] = hatctx_step(
             ctx, coords[s->last_index], s->last_step);
         maybe_report_hat(w, h, *s->curr, coords[s->curr_index],
                          report_hat, report_hat_ctx);
     }
 
-    hatctx_cleanup(ctx);
     for (i = 0; i < lenof(coords); i++)
-        hat_coords_free(coords[i]);
+        hatctx_coords_free(ctx, coords[i]);
+    hatctx_cleanup(ctx);
 }
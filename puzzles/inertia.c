@@ -729,6 +729,7 @@ static char *solve_game(const game_state *state, const game_state *currstate,
     int *nodes, *nodeindex, *edges, *backedges, *edgei, *backedgei, *circuit;
     int nedges;
     int *dist, *dist2, *list;
+    int *cdist, *cdist2, *gemnodes, ngemnodes, ncircuitnodes, newlo, newhi;
     int *unvisited;
     int circuitlen, circuitsize;
     int head, tail, pass, i, j, n, x, y, d, dd;
@@ -898,6 +899,30 @@ static char *solve_game(const game_state *state, const game_state *currstate,
     dist2 = snewn(n, int);
     list = snewn(n, int);
 
+    /*
+     * cdist[] and cdist2[] give the distance from and to the nearest
+     * vertex in the tour, which only ever gains vertices in the main
+     * loop, so those only need updating from the new ones each time
+     * round. ncircuitnodes counts the distinct vertices in the tour
+     * (which are exactly the ones at distance zero).
+     */
+    cdist = snewn(n, int);
+    cdist2 = snewn(n, int);
+    for (i = 0; i < n; i++)
+	cdist[i] = cdist2[i] = -1;
+    ncircuitnodes = 0;
+    newlo = newhi = 0;		       /* range of new vertices in circuit */
+
+    /*
+     * And here are all the nodes that might be the next target gem,
+     * in order.
+     */
+    gemnodes = snewn(n, int);
+    ngemnodes = 0;
+    for (i = 0; i < n; i++)
+	if (unvisited[nodes[i] / DP1])
+	    gemnodes[ngemnodes++] = i;
+
     err = NULL;
     soln = NULL;
 
@@ -944,26 +969,30 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 	 * reachable node here and still get a valid tour as
 	 * output. I hope that picking a nearby one will result in
 	 * generally good tours.
+	 *
+	 * The distances from last time round are still right for
+	 * the old part of the tour, so we only bfs from the new
+	 * vertices, and only as far as they bring something closer.
 	 */
 	for (pass = 0; pass < 2; pass++) {
 	    int *ep = (pass == 0 ? edges : backedges);
 	    int *ei = (pass == 0 ? edgei : backedgei);
-	    int *dp = (pass == 0 ? dist : dist2);
+	    int *dp = (pass == 0 ? cdist : cdist2);
 	    head = tail = 0;
-	    for (i = 0; i < n; i++)
-		dp[i] = -1;
-	    for (i = 0; i < circuitlen; i++) {
+	    for (i = newlo; i <= newhi; i++) {
 		int ni = circuit[i];
-		if (dp[ni] < 0) {
+		if (dp[ni] != 0) {
 		    dp[ni] = 0;
 		    list[tail++] = ni;
+		    if (pass == 0)
+			ncircuitnodes++;
 		}
 	    }
 	    while (head < tail) {
 		int ni = list[head++];
 		for (i = ei[ni]; i < ei[ni+1]; i++) {
 		    int ti = ep[i];
-		    if (ti >= 0 && dp[ti] < 0) {
+		    if (ti >= 0 && (dp[ti] < 0 || dp[ti] > dp[ni] + 1)) {
 			dp[ti] = dp[ni] + 1;
 			list[tail++] = ti;
 		    }
@@ -973,16 +1002,20 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 	/* Now find the nearest unvisited gem. */
 	bestdist = -1;
 	target = -1;
-	for (i = 0; i < n; i++) {
-	    if (unvisited[nodes[i] / DP1] &&
-		dist[i] >= 0 && dist2[i] >= 0) {
-		int thisdist = dist[i] + dist2[i];
+	for (i = j = 0; i < ngemnodes; i++) {
+	    int ni = gemnodes[i];
+	    if (!unvisited[nodes[ni] / DP1])
+		continue;
+	    gemnodes[j++] = ni;
+	    if (cdist[ni] >= 0 && cdist2[ni] >= 0) {
+		int thisdist = cdist[ni] + cdist2[ni];
 		if (bestdist < 0 || bestdist > thisdist) {
 		    bestdist = thisdist;
-		    target = i;
+		    target = ni;
 		}
 	    }
 	}
+	ngemnodes = j;
 
 	if (target < 0) {
 	    /*
@@ -1011,6 +1044,7 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 	    int *ep = (pass == 0 ? edges : backedges);
 	    int *ei = (pass == 0 ? edgei : backedgei);
 	    int *dp = (pass == 0 ? dist : dist2);
+	    int reached = 0;
 
 	    for (i = 0; i < n; i++)
 		dp[i] = -1;
@@ -1019,7 +1053,12 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 	    dp[target] = 0;
 	    list[tail++] = target;
 
-	    while (head < tail) {
+	    /*
+	     * We can stop once we've reached every vertex of the
+	     * tour: everything nearer than those (which is all the
+	     * paths back to the target go through) is done by then.
+	     */
+	    while (head < tail && reached < ncircuitnodes) {
 		int ni = list[head++];
 		for (i = ei[ni]; i < ei[ni+1]; i++) {
 		    int ti = ep[i];
@@ -1027,6 +1066,8 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 			dp[ti] = dp[ni] + 1;
 /*printf("pass %d: set dist of vertex %d to %d (via %d)\n", pass, ti, dp[ti], ni);*/
 			list[tail++] = ti;
+			if (cdist[ti] == 0)
+			    reached++;
 		    }
 		}
 	    }
@@ -1171,6 +1212,8 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 	    assert(pos >= 0 && pos < wh);
 	    unvisited[pos] = false;
 	}
+	newlo = n1;
+	newhi = n2;
     }
 
 #ifdef TSP_DIAGNOSTICS
@@ -1422,6 +1465,9 @@ static char *solve_game(const game_state *state, const game_state *currstate,
     sfree(list);
     sfree(dist);
     sfree(dist2);
+    sfree(cdist);
+    sfree(cdist2);
+    sfree(gemnodes);
     sfree(unvisited);
     sfree(circuit);
     sfree(backedgei);
@@ -2222,7 +2268,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
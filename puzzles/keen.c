@@ -16,6 +16,7 @@
 
 #include "puzzles.h"
 #include "latin.h"
+#include "tree234.h"
 
 /*
  * Difficulty levels. I do some macro ickery here to ensure that my
@@ -242,8 +243,145 @@ struct solver_ctx {
     digit *soln;
     digit *dscratch;
     int *iscratch;
+    int *counts;
 };
 
+/*
+ * Table of the multisets of digits which can fill an addition or
+ * multiplication clue box of a given size: that is, every
+ * non-decreasing sequence of n digits from 1 to w with the right
+ * sum or product. These don't depend on anything else about the
+ * box, so rather than search all the ways of filling a box from
+ * scratch on every solver pass, we work them out once and keep them
+ * in a cache shared between solver calls (and between attempts at
+ * generating a grid, which is where it pays off).
+ *
+ * The layout of each multiset within its box is still down to the
+ * solver, but searching the permutations of a handful of multisets
+ * whose digits are all still possible in the box is much cheaper
+ * than searching everything with the right total.
+ */
+struct cage_sets {
+    int w, n;
+    long op, value;
+    int nsets;
+    digit *sets;                       /* nsets runs of n digits */
+};
+
+static int cage_sets_cmp(void *av, void *bv)
+{
+    const struct cage_sets *a = (const struct cage_sets *)av;
+    const struct cage_sets *b = (const struct cage_sets *)bv;
+
+    if (a->w != b->w) return a->w < b->w ? -1 : +1;
+    if (a->n != b->n) return a->n < b->n ? -1 : +1;
+    if (a->op != b->op) return a->op < b->op ? -1 : +1;
+    if (a->value != b->value) return a->value < b->value ? -1 : +1;
+    return 0;
+}
+
+static tree234 *cage_sets_cache;
+
+static const struct cage_sets *find_cage_sets_locked(int w, int n, long op,
+                                                     long value)
+{
+    struct cage_sets key, *cs;
+    digit d[MAXBLK+1];
+    int size = 0, i, j;
+    long total;
+
+    if (!cage_sets_cache)
+        cage_sets_cache = newtree234(cage_sets_cmp);
+
+    key.w = w;
+    key.n = n;
+    key.op = op;
+    key.value = value;
+    cs = find234(cage_sets_cache, &key, NULL);
+    if (cs)
+        return cs;
+
+    cs = snew(struct cage_sets);
+    *cs = key;
+    cs->nsets = 0;
+    cs->sets = NULL;
+
+    /*
+     * Enumerate the non-decreasing sequences, in the same iterative
+     * style as the solver. A clue box is a connected region of n
+     * squares, so it spans at most n+1 rows and columns between
+     * them, and hence (since no digit can repeat within a row or
+     * column) no digit can occur in it more than (n+1)/2 times.
+     */
+    assert(n <= MAXBLK);
+    i = 0;
+    d[0] = 0;
+    total = value;                     /* start with the identity */
+    while (1) {
+        if (i < n) {
+            for (j = max(d[i] + 1, i > 0 ? d[i-1] : 1); j <= w; j++) {
+                if (op == C_ADD ? (total < (long)j * (n-i)) :
+                    (total % j != 0))
+                    continue;      /* this one won't fit */
+                if (op == C_ADD && total - j > (long)w * (n-i-1))
+                    continue;      /* the rest can't make up the sum */
+                if (i >= (n+1)/2 && d[i - (n+1)/2] == j)
+                    continue;      /* too many of this digit */
+                break;
+            }
+
+            if (j > w) {
+                /* No valid values left; drop back. */
+                i--;
+                if (i < 0)
+                    break;         /* overall iteration is finished */
+                if (op == C_ADD)
+                    total += d[i];
+                else
+                    total *= d[i];
+            } else {
+                /* Got a valid value; store it and move on. */
+                d[i++] = j;
+                if (op == C_ADD)
+                    total -= j;
+                else
+                    total /= j;
+                d[i] = 0;
+            }
+        } else {
+            if (total == (op == C_ADD ? 0 : 1)) {
+                if (cs->nsets == size) {
+                    size = size * 3 / 2 + 16;
+                    cs->sets = sresize(cs->sets, size * n, digit);
+                }
+                memcpy(cs->sets + cs->nsets * n, d, n);
+                cs->nsets++;
+            }
+            i--;
+            if (op == C_ADD)
+                total += d[i];
+            else
+                total *= d[i];
+        }
+    }
+
+    add234(cage_sets_cache, cs);
+    return cs;
+}
+
+/* Entries are never freed or changed once added, so only finding or
+ * adding one needs the lock. */
+static const struct cage_sets *find_cage_sets(int w, int n, long op,
+                                              long value)
+{
+    const struct cage_sets *cs;
+
+    cache_lock();
+    cs = find_cage_sets_locked(w, n, op, value);
+    cache_unlock();
+    return cs;
+}
+
 static void solver_clue_candidate(struct solver_ctx *ctx, int diff, int box)
 {
     int w = ctx->w;
@@ -334,7 +472,7 @@ static int solver_common(struct latin_solver *solver, void *vctx, int diff)
     struct solver_ctx *ctx = (struct solver_ctx *)vctx;
     int w = ctx->w;
     int box, i, j, k;
-    int ret = 0, total;
+    int ret = 0;
 
     /*
      * Iterate over each clue box and deduce what we can.
@@ -399,71 +537,90 @@ static int solver_common(struct latin_solver *solver, void *vctx, int diff)
 	    break;
 
 	  case C_ADD:
-	  case C_MUL:
+	  case C_MUL: {
 	    /*
-	     * For these clue types, I have no alternative but to go
-	     * through all possible number combinations.
+	     * For these clue types, go through each multiset of
+	     * digits that satisfies the clue (see find_cage_sets),
+	     * skipping any containing a digit that's already ruled
+	     * out of the whole box, and try every way of laying out
+	     * the rest.
 	     *
 	     * Instead of a tedious physical recursion, I iterate in
 	     * the scratch array through all possibilities. At any
 	     * given moment, i indexes the element of the box that
-	     * will next be incremented.
+	     * will next be incremented, and ctx->counts[j] says how
+	     * many more js the layout needs.
 	     */
-	    i = 0;
-	    ctx->dscratch[i] = 0;
-	    total = value;	       /* start with the identity */
-	    while (1) {
-		if (i < n) {
-		    /*
-		     * Find the next valid value for cell i.
-		     */
-		    for (j = ctx->dscratch[i] + 1; j <= w; j++) {
-			if (op == C_ADD ? (total < j) : (total % j != 0))
-			    continue;  /* this one won't fit */
-			if (!solver->cube[sq[i]*w+j-1])
-			    continue;  /* this one is ruled out already */
-			for (k = 0; k < i; k++)
-			    if (ctx->dscratch[k] == j &&
-				(sq[k] % w == sq[i] % w ||
-				 sq[k] / w == sq[i] / w))
-				break; /* clashes with another row/col */
-			if (k < i)
-			    continue;
-
-			/* Found one. */
-			break;
-		    }
+	    const struct cage_sets *cs = find_cage_sets(w, n, op, value);
+	    unsigned avail = 0;
+	    int set;
 
-		    if (j > w) {
-			/* No valid values left; drop back. */
-			i--;
-			if (i < 0)
-			    break;     /* overall iteration is finished */
-			if (op == C_ADD)
-			    total += ctx->dscratch[i];
-			else
-			    total *= ctx->dscratch[i];
+	    for (i = 0; i < n; i++)
+		for (j = 1; j <= w; j++)
+		    if (solver->cube[sq[i]*w+j-1])
+			avail |= 1 << j;
+
+	    for (set = 0; set < cs->nsets; set++) {
+		const digit *digits = cs->sets + set * n;
+		unsigned need = 0;
+
+		for (i = 0; i < n; i++)
+		    need |= 1 << digits[i];
+		if (need & ~avail)
+		    continue;
+
+		for (j = 1; j <= w; j++)
+		    ctx->counts[j] = 0;
+		for (i = 0; i < n; i++)
+		    ctx->counts[digits[i]]++;
+
+		i = 0;
+		ctx->dscratch[i] = 0;
+		while (1) {
+		    if (i < n) {
+			/*
+			 * Find the next valid value for cell i.
+			 */
+			for (j = ctx->dscratch[i] + 1; j <= w; j++) {
+			    if (!ctx->counts[j])
+				continue;  /* none of this one left */
+			    if (!solver->cube[sq[i]*w+j-1])
+				continue;  /* this one is ruled out already */
+			    for (k = 0; k < i; k++)
+				if (ctx->dscratch[k] == j &&
+				    (sq[k] % w == sq[i] % w ||
+				     sq[k] / w == sq[i] / w))
+				    break; /* clashes with another row/col */
+			    if (k < i)
+				continue;
+
+			    /* Found one. */
+			    break;
+			}
+
+			if (j > w) {
+			    /* No valid values left; drop back. */
+			    i--;
+			    if (i < 0)
+				break; /* this multiset is finished */
+			    ctx->counts[ctx->dscratch[i]]++;
+			} else {
+			    /* Got a valid value; store it and move on. */
+			    ctx->dscratch[i++] = j;
+			    ctx->counts[j]--;
+			    ctx->dscratch[i] = 0;
+			}
 		    } else {
-			/* Got a valid value; store it and move on. */
-			ctx->dscratch[i++] = j;
-			if (op == C_ADD)
-			    total -= j;
-			else
-			    total /= j;
-			ctx->dscratch[i] = 0;
-		    }
-		} else {
-		    if (total == (op == C_ADD ? 0 : 1))
+			/* Every digit of the multiset is placed. */
 			solver_clue_candidate(ctx, diff, box);
-		    i--;
-		    if (op == C_ADD)
-			total += ctx->dscratch[i];
-		    else
-			total *= ctx->dscratch[i];
+			i--;
+			ctx->counts[ctx->dscratch[i]]++;
+		    }
 		}
 	    }
 
 	    break;
+	  }
 	}
 
         /*
@@ -691,7 +848,7 @@ static int solver(int w, DSF *dsf, long *clues, digit *soln, int maxdiff)
     int a = w*w;
     struct solver_ctx ctx;
     int ret;
-    int i, j, n, m;
+    int i, n, m, *label;
     
     ctx.w = w;
     ctx.soln = soln;
@@ -705,30 +862,39 @@ static int solver(int w, DSF *dsf, long *clues, digit *soln, int maxdiff)
      * because the 'cube' array in the general Latin square solver
      * puts x first (oops).
      */
-    for (ctx.nboxes = i = 0; i < a; i++)
-	if (dsf_canonify(dsf, i) == i)
-	    ctx.nboxes++;
+    label = snewn(a, int);
+    ctx.nboxes = dsf_label(dsf, label);
     ctx.boxlist = snewn(a, int);
     ctx.boxes = snewn(ctx.nboxes+1, int);
     ctx.clues = snewn(ctx.nboxes, long);
     ctx.whichbox = snewn(a, int);
-    for (n = m = i = 0; i < a; i++)
-	if (dsf_minimal(dsf, i) == i) {
-	    ctx.clues[n] = clues[i];
-	    ctx.boxes[n] = m;
-	    for (j = 0; j < a; j++)
-		if (dsf_minimal(dsf, j) == i) {
-		    ctx.boxlist[m++] = (j % w) * w + (j / w);   /* transpose */
-		    ctx.whichbox[ctx.boxlist[m-1]] = n;
-		}
-	    n++;
-	}
-    assert(n == ctx.nboxes);
-    assert(m == a);
-    ctx.boxes[n] = m;
+    for (n = 0; n <= ctx.nboxes; n++)
+	ctx.boxes[n] = 0;
+    for (i = 0; i < a; i++)
+	ctx.boxes[label[i]]++;
+    for (n = 1; n <= ctx.nboxes; n++)
+	ctx.boxes[n] += ctx.boxes[n-1];
+    /*
+     * Now boxes[n] is the end of box n's section of boxlist. Fill
+     * the sections in from the back, so that each ends up in
+     * increasing order of square, with boxes[n] wound back to its
+     * start; and the clue for each box comes from its smallest
+     * square, which is the dsf_minimal one and the one we see last.
+     */
+    for (i = a; i-- > 0 ;) {
+	n = label[i];
+	m = --ctx.boxes[n];
+	ctx.boxlist[m] = (i % w) * w + (i / w);   /* transpose */
+	ctx.whichbox[ctx.boxlist[m]] = n;
+	ctx.clues[n] = clues[i];
+    }
+    assert(ctx.boxes[0] == 0);
+    assert(ctx.boxes[ctx.nboxes] == a);
+    sfree(label);
 
     ctx.dscratch = snewn(a+1, digit);
     ctx.iscratch = snewn(max(a+1, 4*w), int);
+    ctx.counts = snewn(w+1, int);
 
     ret = latin_solver(soln, w, maxdiff,
 		       DIFF_EASY, DIFF_HARD, DIFF_EXTREME,
@@ -737,6 +903,7 @@ static int solver(int w, DSF *dsf, long *clues, digit *soln, int maxdiff)
 
     sfree(ctx.dscratch);
     sfree(ctx.iscratch);
+    sfree(ctx.counts);
     sfree(ctx.whichbox);
     sfree(ctx.boxlist);
     sfree(ctx.boxes);
@@ -898,6 +1065,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 {
     int w = params->w, a = w*w;
     digit *grid, *soln;
+    struct latin_generate_scratch *latinscratch;
     int *order, *revorder, *singletons;
     DSF *dsf;
     long *clues, *cluevals;
@@ -931,7 +1099,8 @@ done
     if (w == 3 && diff > DIFF_NORMAL)
 	diff = DIFF_NORMAL;
 
-    grid = NULL;
+    grid = snewn(a, digit);
+    latinscratch = latin_generate_new_scratch(w);
 
     order = snewn(a, int);
     revorder = snewn(a, int);
@@ -945,8 +1114,7 @@ done
 	/*
 	 * First construct a latin square to be the solution.
 	 */
-	sfree(grid);
-	grid = latin_generate(w, rs);
+	latin_generate_with_scratch(latinscratch, grid, rs);
 
 	/*
 	 * Divide the grid into arbitrarily sized blocks, but so as
@@ -1285,6 +1453,7 @@ done
     (*aux)[a+1] = '\0';
 
     sfree(grid);
+    latin_generate_free_scratch(latinscratch);
     sfree(order);
     sfree(revorder);
     sfree(singletons);
@@ -1505,6 +1674,38 @@ static char *solve_game(const game_state *state, const game_state *currstate,
     return out;
 }
 
+static char *grade_game(const game_state *state, const char **error)
+{
+    int w = state->par.w, a = w*w;
+    digit *soln = snewn(a, digit);
+    int ret;
+
+    memset(soln, 0, a);
+    ret = solver(w, state->clues->dsf, state->clues->clues,
+                 soln, DIFFCOUNT-1);
+    if (ret == DIFF_NORMAL) {
+        /*
+         * At any level above Easy, the solver skips the Easy
+         * deductions (see solver_easy), so an Easy puzzle comes out
+         * as Normal. Check for that.
+         */
+        memset(soln, 0, a);
+        if (solver(w, state->clues->dsf, state->clues->clues,
+                   soln, DIFF_EASY) == DIFF_EASY)
+            ret = DIFF_EASY;
+    }
+    sfree(soln);
+
+    if (ret == diff_impossible) {
+        *error = "No solution exists for this puzzle";
+        return NULL;
+    } else if (ret == diff_ambiguous) {
+        *error = "Multiple solutions exist for this puzzle";
+        return NULL;
+    }
+    return dupstr(keen_diffnames[ret]);
+}
+
 struct game_ui {
     /*
      * These are the coordinates of the currently highlighted
@@ -2532,7 +2733,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    NULL, /* solve_step */
+    grade_game,
+    NULL, /* speculate */
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     get_prefs, set_prefs,
     new_ui,
@@ -2556,7 +2761,7 @@ const struct game thegame = {
     true, false, game_print_size, game_print,
     false,			       /* wants_statusbar */
     false, NULL,                       /* timing_state */
-    REQUIRE_RBUTTON | REQUIRE_NUMPAD,  /* flags */
+    REQUIRE_RBUTTON | REQUIRE_NUMPAD | SOLVE_FROM_ORIG,  /* flags */
 };
 
 #ifdef STANDALONE_SOLVER
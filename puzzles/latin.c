@@ -139,7 +139,8 @@ int latin_solver_elim(struct latin_solver *solver, int start, int step
 }
 
 struct latin_solver_scratch {
-    unsigned char *grid, *rowidx, *colidx, *set;
+    unsigned char *grid, *rowidx, *colidx;
+    uint32 *rowmask;
     int *neighbours, *bfsqueue;
 #ifdef STANDALONE_SOLVER
     int *bfsprev;
@@ -159,10 +160,12 @@ int latin_solver_set(struct latin_solver *solver,
     char **names = solver->names;
 #endif
     int i, j, n, count;
-    unsigned char *grid = scratch->grid;
     unsigned char *rowidx = scratch->rowidx;
     unsigned char *colidx = scratch->colidx;
-    unsigned char *set = scratch->set;
+    uint32 *rowmask = scratch->rowmask;
+    uint32 set, all, bits;
+
+    assert(o <= 32);
 
     /*
      * We are passed a o-by-o matrix of booleans. Our first job
@@ -197,11 +200,18 @@ int latin_solver_set(struct latin_solver *solver,
     assert(n == j);
 
     /*
-     * And create the smaller matrix.
+     * And create the smaller matrix, as a bitmask per row. Column j
+     * of the matrix is bit n-1-j, so that counting upwards through
+     * the sets of columns below visits them in the same order as
+     * the binary increment this used to do on an array of flags,
+     * with column n-1 as the least significant digit.
      */
-    for (i = 0; i < n; i++)
+    for (i = 0; i < n; i++) {
+        rowmask[i] = 0;
         for (j = 0; j < n; j++)
-            grid[i*o+j] = solver->cube[start+rowidx[i]*step1+colidx[j]*step2];
+            if (solver->cube[start+rowidx[i]*step1+colidx[j]*step2])
+                rowmask[i] |= (uint32)1 << (n-1-j);
+    }
 
     /*
      * Having done that, we now have a matrix in which every row
@@ -211,7 +221,8 @@ int latin_solver_set(struct latin_solver *solver,
      * columns) whose width and height add up to n.
      */
 
-    memset(set, 0, n);
+    all = n ? ((uint32)2 << (n-1)) - 1 : 0;
+    set = 0;
     count = 0;
     while (1) {
         /*
@@ -225,16 +236,9 @@ int latin_solver_set(struct latin_solver *solver,
              * the positions listed in `set'.
              */
             int rows = 0;
-            for (i = 0; i < n; i++) {
-                bool ok = true;
-                for (j = 0; j < n; j++)
-                    if (set[j] && grid[i*o+j]) {
-                        ok = false;
-                        break;
-                    }
-                if (ok)
+            for (i = 0; i < n; i++)
+                if (!(rowmask[i] & set))
                     rows++;
-            }
 
             /*
              * We expect never to be able to get _more_ than
@@ -275,15 +279,9 @@ int latin_solver_set(struct latin_solver *solver,
                  * positions in the cube to meddle with.
                  */
                 for (i = 0; i < n; i++) {
-                    bool ok = true;
-                    for (j = 0; j < n; j++)
-                        if (set[j] && grid[i*o+j]) {
-                            ok = false;
-                            break;
-                        }
-                    if (!ok) {
+                    if (rowmask[i] & set) {
                         for (j = 0; j < n; j++)
-                            if (!set[j] && grid[i*o+j]) {
+                            if (rowmask[i] & ~set & ((uint32)1 << (n-1-j))) {
                                 int fpos = (start+rowidx[i]*step1+
                                             colidx[j]*step2);
 #ifdef STANDALONE_SOLVER
@@ -323,16 +321,13 @@ int latin_solver_set(struct latin_solver *solver,
         }
 
         /*
-         * Binary increment: change the rightmost 0 to a 1, and
-         * change all 1s to the right of it to 0s.
+         * Move on to the next set of columns, and count them.
          */
-        i = n;
-        while (i > 0 && set[i-1])
-            set[--i] = 0, count--;
-        if (i > 0)
-            set[--i] = 1, count++;
-        else
+        set = (set + 1) & all;
+        if (!set)
             break;                     /* done */
+        for (count = 0, bits = set; bits; bits &= bits-1)
+            count++;
     }
 
     return 0;
@@ -540,7 +535,7 @@ struct latin_solver_scratch *latin_solver_new_scratch(struct latin_solver *solve
     scratch->grid = snewn(o*o, unsigned char);
     scratch->rowidx = snewn(o, unsigned char);
     scratch->colidx = snewn(o, unsigned char);
-    scratch->set = snewn(o, unsigned char);
+    scratch->rowmask = snewn(o, uint32);
     scratch->neighbours = snewn(3*o, int);
     scratch->bfsqueue = snewn(o*o, int);
 #ifdef STANDALONE_SOLVER
@@ -556,7 +551,7 @@ void latin_solver_free_scratch(struct latin_solver_scratch *scratch)
 #endif
     sfree(scratch->bfsqueue);
     sfree(scratch->neighbours);
-    sfree(scratch->set);
+    sfree(scratch->rowmask);
     sfree(scratch->colidx);
     sfree(scratch->rowidx);
     sfree(scratch->grid);
@@ -762,10 +757,14 @@ static int latin_solver_recurse
         /* we were complete already. */
         return 0;
     else {
-        int i, j;
+        int i, j, nfilled;
         digit *list, *ingrid, *outgrid;
         int diff = diff_impossible;    /* no solution found yet */
 
+        for (nfilled = i = 0; i < o*o; i++)
+            if (solver->grid[i])
+                nfilled++;
+
         /*
          * Attempt recursion.
          */
@@ -804,6 +803,10 @@ static int latin_solver_recurse
 	    void *newctx;
 	    struct latin_solver subsolver;
 
+            /* Give up if the front end has run out of patience. */
+            if (solver_progress((float)nfilled / (o*o)))
+                break;
+
             memcpy(outgrid, ingrid, o*o);
             outgrid[y*o+x] = list[i];
 
@@ -1135,14 +1138,51 @@ void latin_debug(digit *sq, int o)
  * Generation.
  */
 
-digit *latin_generate(int o, random_state *rs)
-{
-    digit *sq;
+struct latin_generate_scratch {
+    int o;
+    void *matching_scratch;
     int *adjdata, *adjsizes, *matching;
     int **adjlists;
-    void *scratch;
-    int i, j, k;
     digit *row;
+    digit *square;                     /* for latin_generate_rect */
+};
+
+struct latin_generate_scratch *latin_generate_new_scratch(int o)
+{
+    struct latin_generate_scratch *scratch =
+        snew(struct latin_generate_scratch);
+    scratch->o = o;
+    scratch->matching_scratch = smalloc(matching_scratch_size(o, o));
+    scratch->adjdata = snewn(o*o, int);
+    scratch->adjlists = snewn(o, int *);
+    scratch->adjsizes = snewn(o, int);
+    scratch->matching = snewn(o, int);
+    scratch->row = snewn(o, digit);
+    scratch->square = snewn(o*o, digit);
+    return scratch;
+}
+
+void latin_generate_free_scratch(struct latin_generate_scratch *scratch)
+{
+    sfree(scratch->square);
+    sfree(scratch->row);
+    sfree(scratch->matching);
+    sfree(scratch->adjsizes);
+    sfree(scratch->adjlists);
+    sfree(scratch->adjdata);
+    sfree(scratch->matching_scratch);
+    sfree(scratch);
+}
+
+void latin_generate_with_scratch(struct latin_generate_scratch *scratch,
+                                 digit *sq, random_state *rs)
+{
+    int o = scratch->o;
+    int *adjdata = scratch->adjdata, *adjsizes = scratch->adjsizes;
+    int *matching = scratch->matching;
+    int **adjlists = scratch->adjlists;
+    digit *row = scratch->row;
+    int i, j, k;
 
     /*
      * To efficiently generate a latin square in such a way that
@@ -1155,31 +1195,22 @@ digit *latin_generate(int o, random_state *rs)
      * the theorem guarantees that we will never have to backtrack.
      *
      * To find a viable row at each stage, we can make use of the
-     * support functions in matching.c.
+     * support functions in matching.c, whose workspace (along with
+     * everything else we need) is in the scratch space, so that a
+     * generator making many attempts doesn't reallocate it every
+     * time.
      */
 
-    sq = snewn(o*o, digit);
-
     /*
      * matching.c will take care of randomising the generation of each
      * row of the square, but in case this entire method of generation
      * introduces a really subtle top-to-bottom directional bias,
      * we'll also generate the rows themselves in random order.
      */
-    row = snewn(o, digit);
     for (i = 0; i < o; i++)
 	row[i] = i;
     shuffle(row, i, sizeof(*row), rs);
 
-    /*
-     * Set up the infrastructure for the matching subroutine.
-     */
-    scratch = smalloc(matching_scratch_size(o, o));
-    adjdata = snewn(o*o, int);
-    adjlists = snewn(o, int *);
-    adjsizes = snewn(o, int);
-    matching = snewn(o, int);
-
     /*
      * Now generate each row of the latin square.
      */
@@ -1204,8 +1235,8 @@ digit *latin_generate(int o, random_state *rs)
 	/*
 	 * Run the matching algorithm.
 	 */
-	j = matching_with_scratch(scratch, o, o, adjlists, adjsizes,
-                                  rs, matching, NULL);
+	j = matching_with_scratch(scratch->matching_scratch, o, o,
+                                  adjlists, adjsizes, rs, matching, NULL);
 	assert(j == o);   /* by the above theorem, this must have succeeded */
 
 	/*
@@ -1215,38 +1246,42 @@ digit *latin_generate(int o, random_state *rs)
 	for (j = 0; j < o; j++)
 	    sq[row[i]*o + j] = matching[j] + 1;
     }
+}
 
-    /*
-     * Done. Free our internal workspaces...
-     */
-    sfree(matching);
-    sfree(adjlists);
-    sfree(adjsizes);
-    sfree(adjdata);
-    sfree(scratch);
-    sfree(row);
+digit *latin_generate(int o, random_state *rs)
+{
+    struct latin_generate_scratch *scratch = latin_generate_new_scratch(o);
+    digit *sq = snewn(o*o, digit);
 
-    /*
-     * ... and return our completed latin square.
-     */
+    latin_generate_with_scratch(scratch, sq, rs);
+    latin_generate_free_scratch(scratch);
     return sq;
 }
 
-digit *latin_generate_rect(int w, int h, random_state *rs)
+void latin_generate_rect_with_scratch(struct latin_generate_scratch *scratch,
+                                      int w, int h, digit *rect,
+                                      random_state *rs)
 {
-    int o = max(w, h), x, y;
-    digit *latin, *latin_rect;
+    int o = scratch->o, x, y;
 
-    latin = latin_generate(o, rs);
-    latin_rect = snewn(w*h, digit);
+    assert(o == max(w, h));
+    latin_generate_with_scratch(scratch, scratch->square, rs);
 
     for (x = 0; x < w; x++) {
         for (y = 0; y < h; y++) {
-            latin_rect[y*w + x] = latin[y*o + x];
+            rect[y*w + x] = scratch->square[y*o + x];
         }
     }
+}
+
+digit *latin_generate_rect(int w, int h, random_state *rs)
+{
+    struct latin_generate_scratch *scratch =
+        latin_generate_new_scratch(max(w, h));
+    digit *latin_rect = snewn(w*h, digit);
 
-    sfree(latin);
+    latin_generate_rect_with_scratch(scratch, w, h, latin_rect, rs);
+    latin_generate_free_scratch(scratch);
     return latin_rect;
 }
 
@@ -119,6 +119,20 @@ digit *latin_generate(int o, random_state *rs);
 /* The order of the latin rectangle is max(w,h). */
 digit *latin_generate_rect(int w, int h, random_state *rs);
 
+/* Workspace for generators which make many attempts: a scratch space
+ * of order o can be used for any number of latin_generate_with_scratch
+ * calls, which write an o*o square into sq, or (if o == max(w,h)) of
+ * latin_generate_rect_with_scratch calls. Either gives exactly what
+ * the allocating version would have, given the same random_state. */
+struct latin_generate_scratch; /* private to latin.c */
+struct latin_generate_scratch *latin_generate_new_scratch(int o);
+void latin_generate_free_scratch(struct latin_generate_scratch *scratch);
+void latin_generate_with_scratch(struct latin_generate_scratch *scratch,
+                                 digit *sq, random_state *rs);
+void latin_generate_rect_with_scratch(struct latin_generate_scratch *scratch,
+                                      int w, int h, digit *rect,
+                                      random_state *rs);
+
 bool latin_check(digit *sq, int order); /* true => not a latin square */
 
 void latin_debug(digit *sq, int order);
@@ -287,5 +287,135 @@ void domino_layout_prealloc(int w, int h, random_state *rs,
     }
 }
 
+/*
+ * A domino layout context, for generators which throw layouts away
+ * and try again: it keeps its buffers from one layout to the next.
+ */
+struct domino_layout_ctx {
+    int w, h;
+    int *grid, *grid2, *list;
+    bool laid;
+};
+
+domino_layout_ctx *domino_layout_new_ctx(int w, int h)
+{
+    domino_layout_ctx *ctx = snew(domino_layout_ctx);
+    int wh = w*h;
+
+    ctx->w = w;
+    ctx->h = h;
+    ctx->grid = snewn(wh, int);
+    ctx->grid2 = snewn(wh, int);
+    ctx->list = snewn(2*wh, int);
+    ctx->laid = false;
+    return ctx;
+}
+
+void domino_layout_free_ctx(domino_layout_ctx *ctx)
+{
+    sfree(ctx->grid);
+    sfree(ctx->grid2);
+    sfree(ctx->list);
+    sfree(ctx);
+}
+
+/*
+ * Returns a new random layout (in the same form as domino_layout), in
+ * the context's own buffer, which is only valid until the next call.
+ */
+const int *domino_layout_next(domino_layout_ctx *ctx, random_state *rs)
+{
+    domino_layout_prealloc(ctx->w, ctx->h, rs,
+                           ctx->grid, ctx->grid2, ctx->list);
+    ctx->laid = true;
+    return ctx->grid;
+}
+
+/*
+ * Try one move, from square (x,y) in direction dir (0-3): two
+ * parallel dominoes side by side in a 2x2 square can be turned
+ * through 90 degrees, and a domino in line with the singleton square
+ * (if the area is odd) can slide along into it.
+ */
+static void domino_layout_move(domino_layout_ctx *ctx, int x, int y, int dir)
+{
+    int w = ctx->w, h = ctx->h, *grid = ctx->grid, i = y*w + x;
+    int dx = (dir == 0 ? -1 : dir == 1 ? +1 : 0);
+    int dy = (dir == 2 ? -1 : dir == 3 ? +1 : 0);
+    int j = grid[i], i2, j2;
+
+    if (j == i) {
+        /* The singleton: slide in the domino beyond it, if that
+         * domino lies in line with the direction. */
+        if (x + 2*dx < 0 || x + 2*dx >= w || y + 2*dy < 0 || y + 2*dy >= h)
+            return;
+        i2 = i + dy*w + dx;
+        j2 = i2 + dy*w + dx;
+        if (grid[i2] != j2)
+            return;
+        grid[i] = i2;
+        grid[i2] = i;
+        grid[j2] = j2;
+        return;
+    }
+
+    /* Only directions perpendicular to this domino can turn it. */
+    if ((j == i+1 || j == i-1) ? dy == 0 : dx == 0)
+        return;
+    if (x + dx < 0 || x + dx >= w || y + dy < 0 || y + dy >= h)
+        return;
+    i2 = i + dy*w + dx;
+    j2 = j + dy*w + dx;
+    if (grid[i2] != j2)
+        return;                        /* not a parallel domino */
+    grid[i] = i2;
+    grid[i2] = i;
+    grid[j] = j2;
+    grid[j2] = j;
+}
+
+/*
+ * Like domino_layout_next, but makes the new layout by randomly
+ * rearranging the last one (if there was one), which is cheaper than
+ * laying a new one from scratch.
+ *
+ * Each sweep tries a move in a random direction from every square.
+ * Any layout can be turned into any other by a sequence of moves, but
+ * after a few sweeps the layouts are still noticeably related (after
+ * four, about 37% of squares are paired as they were, against 30%
+ * between unrelated layouts). So this is only a win for a generator
+ * whose rejected layouts aren't to blame for the rejection: for
+ * Dominosa and Magnets, a layout is a small part of the cost of an
+ * attempt, and the related layouts fail more often than fresh ones,
+ * so those generators use domino_layout_next.
+ */
+const int *domino_layout_rearrange(domino_layout_ctx *ctx, random_state *rs,
+                                   int sweeps)
+{
+    int pass, x, y, nbits = 0;
+    unsigned long bits = 0;
+
+    if (!ctx->laid)
+        return domino_layout_next(ctx, rs);
+
+    for (pass = 0; pass < sweeps; pass++) {
+        for (y = 0; y < ctx->h; y++) {
+            for (x = 0; x < ctx->w; x++) {
+                /* Random bits are drawn 32 at a time, since asking
+                 * random_upto for each move would cost more than all
+                 * the rest. */
+                if (nbits == 0) {
+                    bits = random_bits(rs, 32);
+                    nbits = 16;
+                }
+                domino_layout_move(ctx, x, y, bits & 3);
+                bits >>= 2;
+                nbits--;
+            }
+        }
+    }
+    return ctx->grid;
+}
+
 /* vim: set shiftwidth=4 :set textwidth=80: */
 
@@ -125,16 +125,33 @@ struct game_params {
 
 #define F_MARK          32
 
+struct game_cell {
+    int lights;         /* For black squares, (optionally) the number
+                           of surrounding lights. For non-black squares,
+                           the number of times it's lit. */
+    unsigned int flags;
+};
+
+/* The extent of clear space in each square's row and column, i.e. how
+ * far a light there would shine. This only depends on where the black
+ * squares are, so it's worked out once when first needed and shared
+ * between all the states of a game. */
+struct sightlines {
+    int refcount;
+    int *ext;           /* minx, maxx, miny, maxy for each square */
+};
+
 struct game_state {
     int w, h, nlights;
-    int *lights;        /* For black squares, (optionally) the number
-                           of surrounding lights. For non-black squares,
-                           the number of times it's lit. size h*w*/
-    unsigned int *flags;        /* size h*w */
+    cow_array *cells;   /* of struct game_cell, size h*w */
+    struct sightlines *sight;   /* NULL until list_lights needs it */
     bool completed, used_solve;
 };
 
-#define GRID(gs,grid,x,y) (gs->grid[(y)*((gs)->w) + (x)])
+#define GRID(gs,grid,x,y) \
+    (COW_GET(struct game_cell, (gs)->cells, (y)*((gs)->w) + (x)).grid)
+#define GRID_PUT(gs,grid,x,y) \
+    (COW_PUT(struct game_cell, (gs)->cells, (y)*((gs)->w) + (x)).grid)
 
 /* A ll_data holds information about which lights would be lit by
  * a particular grid location's light (or conversely, which locations
@@ -387,11 +404,9 @@ static game_state *new_state(const game_params *params)
 
     ret->w = params->w;
     ret->h = params->h;
-    ret->lights = snewn(ret->w * ret->h, int);
+    ret->cells = cow_new(ret->w * ret->h, sizeof(struct game_cell));
+    ret->sight = NULL;
     ret->nlights = 0;
-    memset(ret->lights, 0, ret->w * ret->h * sizeof(int));
-    ret->flags = snewn(ret->w * ret->h, unsigned int);
-    memset(ret->flags, 0, ret->w * ret->h * sizeof(unsigned int));
     ret->completed = false;
     ret->used_solve = false;
     return ret;
@@ -404,23 +419,30 @@ static game_state *dup_game(const game_state *state)
     ret->w = state->w;
     ret->h = state->h;
 
-    ret->lights = snewn(ret->w * ret->h, int);
-    memcpy(ret->lights, state->lights, ret->w * ret->h * sizeof(int));
+    ret->cells = cow_dup(state->cells);
+    ret->sight = state->sight;
+    if (ret->sight) ret->sight->refcount++;
     ret->nlights = state->nlights;
 
-    ret->flags = snewn(ret->w * ret->h, unsigned int);
-    memcpy(ret->flags, state->flags, ret->w * ret->h * sizeof(unsigned int));
-
     ret->completed = state->completed;
     ret->used_solve = state->used_solve;
 
     return ret;
 }
 
+static void drop_sightlines(game_state *state)
+{
+    if (state->sight && --state->sight->refcount <= 0) {
+        sfree(state->sight->ext);
+        sfree(state->sight);
+    }
+    state->sight = NULL;
+}
+
 static void free_game(game_state *state)
 {
-    sfree(state->lights);
-    sfree(state->flags);
+    drop_sightlines(state);
+    cow_free(state->cells);
     sfree(state);
 }
 
@@ -573,13 +595,14 @@ static bool grid_correct(game_state *state)
 static void clean_board(game_state *state, bool leave_blacks)
 {
     int x,y;
+    if (!leave_blacks) drop_sightlines(state);
     for (x = 0; x < state->w; x++) {
         for (y = 0; y < state->h; y++) {
             if (leave_blacks)
-                GRID(state, flags, x, y) &= F_BLACK;
+                GRID_PUT(state, flags, x, y) &= F_BLACK;
             else
-                GRID(state, flags, x, y) = 0;
-            GRID(state, lights, x, y) = 0;
+                GRID_PUT(state, flags, x, y) = 0;
+            GRID_PUT(state, lights, x, y) = 0;
         }
     }
     state->nlights = 0;
@@ -628,7 +651,7 @@ static void set_blacks(game_state *state, const game_params *params,
             x = random_upto(rs,rw);
             y = random_upto(rs,rh);
         } while (GRID(state,flags,x,y) & F_BLACK);
-        GRID(state, flags, x, y) |= F_BLACK;
+        GRID_PUT(state, flags, x, y) |= F_BLACK;
     }
 
     /* Copy required region. */
@@ -652,7 +675,7 @@ static void set_blacks(game_state *state, const game_params *params,
                 ys[1] = state->h - 1 - y;
             }
             for (i = 1; i < degree; i++) {
-                GRID(state, flags, xs[i], ys[i]) =
+                GRID_PUT(state, flags, xs[i], ys[i]) =
                     GRID(state, flags, xs[0], ys[0]);
             }
         }
@@ -660,45 +683,72 @@ static void set_blacks(game_state *state, const game_params *params,
     /* SYMM_ROT4 misses the middle square above; fix that here. */
     if (degree == 4 && rotate && wodd &&
         (random_upto(rs,100) <= (unsigned int)params->blackpc))
-        GRID(state,flags,
-             state->w/2 + wodd - 1, state->h/2 + hodd - 1) |= F_BLACK;
+        GRID_PUT(state,flags,
+                 state->w/2 + wodd - 1, state->h/2 + hodd - 1) |= F_BLACK;
 
 #ifdef SOLVER_DIAGNOSTICS
     if (verbose) debug_state(state);
 #endif
 }
 
+/* Works out the sightlines for the current layout of black squares,
+ * one run of clear squares at a time. */
+static void make_sightlines(game_state *state)
+{
+    int w = state->w, h = state->h, x, y, start, i;
+    struct sightlines *sl = snew(struct sightlines);
+
+    sl->refcount = 1;
+    sl->ext = snewn(4 * w * h, int);
+
+    for (y = 0; y < h; y++) {
+        for (start = x = 0; x <= w; x++) {
+            if (x < w && !(GRID(state, flags, x, y) & F_BLACK)) continue;
+            for (i = start; i < x; i++) {
+                sl->ext[4*(y*w+i) + 0] = start;
+                sl->ext[4*(y*w+i) + 1] = x-1;
+            }
+            if (x < w) {
+                /* A black square lights nothing but itself. */
+                sl->ext[4*(y*w+x) + 0] = sl->ext[4*(y*w+x) + 1] = x;
+            }
+            start = x+1;
+        }
+    }
+    for (x = 0; x < w; x++) {
+        for (start = y = 0; y <= h; y++) {
+            if (y < h && !(GRID(state, flags, x, y) & F_BLACK)) continue;
+            for (i = start; i < y; i++) {
+                sl->ext[4*(i*w+x) + 2] = start;
+                sl->ext[4*(i*w+x) + 3] = y-1;
+            }
+            if (y < h)
+                sl->ext[4*(y*w+x) + 2] = sl->ext[4*(y*w+x) + 3] = y;
+            start = y+1;
+        }
+    }
+
+    state->sight = sl;
+}
+
 /* Fills in (does not allocate) a ll_data with all the tiles that would
  * be illuminated by a light at point (ox,oy). If origin is true then the
  * origin is included in this list. */
 static void list_lights(game_state *state, int ox, int oy, bool origin,
                         ll_data *lld)
 {
-    int x,y;
-
-    lld->ox = lld->minx = lld->maxx = ox;
-    lld->oy = lld->miny = lld->maxy = oy;
-    lld->include_origin = origin;
+    const int *ext;
 
-    y = oy;
-    for (x = ox-1; x >= 0; x--) {
-        if (GRID(state, flags, x, y) & F_BLACK) break;
-        if (x < lld->minx) lld->minx = x;
-    }
-    for (x = ox+1; x < state->w; x++) {
-        if (GRID(state, flags, x, y) & F_BLACK) break;
-        if (x > lld->maxx) lld->maxx = x;
-    }
+    if (!state->sight) make_sightlines(state);
+    ext = state->sight->ext + 4 * (oy * state->w + ox);
 
-    x = ox;
-    for (y = oy-1; y >= 0; y--) {
-        if (GRID(state, flags, x, y) & F_BLACK) break;
-        if (y < lld->miny) lld->miny = y;
-    }
-    for (y = oy+1; y < state->h; y++) {
-        if (GRID(state, flags, x, y) & F_BLACK) break;
-        if (y > lld->maxy) lld->maxy = y;
-    }
+    lld->ox = ox;
+    lld->oy = oy;
+    lld->minx = ext[0];
+    lld->maxx = ext[1];
+    lld->miny = ext[2];
+    lld->maxy = ext[3];
+    lld->include_origin = origin;
 }
 
 /* Makes sure a light is the given state, editing the lights table to suit the
@@ -712,17 +762,17 @@ static void set_light(game_state *state, int ox, int oy, bool on)
 
     if (!on && GRID(state,flags,ox,oy) & F_LIGHT) {
         diff = -1;
-        GRID(state,flags,ox,oy) &= ~F_LIGHT;
+        GRID_PUT(state,flags,ox,oy) &= ~F_LIGHT;
         state->nlights--;
     } else if (on && !(GRID(state,flags,ox,oy) & F_LIGHT)) {
         diff = 1;
-        GRID(state,flags,ox,oy) |= F_LIGHT;
+        GRID_PUT(state,flags,ox,oy) |= F_LIGHT;
         state->nlights++;
     }
 
     if (diff != 0) {
         list_lights(state,ox,oy,true,&lld);
-        FOREACHLIT(&lld, GRID(state,lights,lx,ly) += diff; );
+        FOREACHLIT(&lld, GRID_PUT(state,lights,lx,ly) += diff; );
     }
 }
 
@@ -751,7 +801,7 @@ static void place_lights(game_state *state, random_state *rs)
     /* Place a light on all grid squares without lights. */
     for (x = 0; x < state->w; x++) {
         for (y = 0; y < state->h; y++) {
-            GRID(state, flags, x, y) &= ~F_MARK; /* we use this later. */
+            GRID_PUT(state, flags, x, y) &= ~F_MARK; /* we use this later. */
             if (GRID(state, flags, x, y) & F_BLACK) continue;
             set_light(state, x, y, true);
         }
@@ -776,7 +826,7 @@ static void place_lights(game_state *state, random_state *rs)
         if (n == 0) {
             /* No, it wouldn't, so we can remove them all. */
             FOREACHLIT(&lld, set_light(state,lx,ly, false); );
-            GRID(state,flags,x,y) |= F_MARK;
+            GRID_PUT(state,flags,x,y) |= F_MARK;
         }
 
         if (!grid_overlap(state)) {
@@ -808,8 +858,8 @@ static void place_numbers(game_state *state)
                 if (GRID(state,flags,s.points[i].x, s.points[i].y) & F_LIGHT)
                     n++;
             }
-            GRID(state,flags,x,y) |= F_NUMBERED;
-            GRID(state,lights,x,y) = n;
+            GRID_PUT(state,flags,x,y) |= F_NUMBERED;
+            GRID_PUT(state,lights,x,y) = n;
         }
     }
 }
@@ -900,10 +950,10 @@ static bool try_solve_number(game_state *state, int nx, int ny,
     if (nl == 0) {
         /* we have placed all lights we need to around here; all remaining
          * surrounds are therefore IMPOSSIBLE. */
-        GRID(state,flags,nx,ny) |= F_NUMBERUSED;
+        GRID_PUT(state,flags,nx,ny) |= F_NUMBERUSED;
         for (i = 0; i < s.npoints; i++) {
             if (!(s.points[i].f & F_MARK)) {
-                GRID(state,flags,s.points[i].x,s.points[i].y) |= F_IMPOSSIBLE;
+                GRID_PUT(state,flags,s.points[i].x,s.points[i].y) |= F_IMPOSSIBLE;
                 ret = true;
             }
         }
@@ -914,7 +964,7 @@ static bool try_solve_number(game_state *state, int nx, int ny,
 #endif
     } else if (nl == ns) {
         /* we have as many lights to place as spaces; fill them all. */
-        GRID(state,flags,nx,ny) |= F_NUMBERUSED;
+        GRID_PUT(state,flags,nx,ny) |= F_NUMBERUSED;
         for (i = 0; i < s.npoints; i++) {
             if (!(s.points[i].f & F_MARK)) {
                 set_light(state, s.points[i].x,s.points[i].y, true);
@@ -1042,7 +1092,7 @@ static void trl_callback_discount(game_state *state, int dx, int dy,
         if (scratch[i].n == 0) return;
     }
     /* The light ruled out everything in scratch. Yay. */
-    GRID(state,flags,dx,dy) |= F_IMPOSSIBLE;
+    GRID_PUT(state,flags,dx,dy) |= F_IMPOSSIBLE;
 #ifdef SOLVER_DIAGNOSTICS
     debug(("Set reduction discounted square at (%d,%d):\n", dx,dy));
     if (verbose) debug_state(state);
@@ -1209,7 +1259,7 @@ static bool discount_clue(game_state *state, int x, int y,
     bool didsth = false;
     unsigned int flags;
     surrounds s, sempty;
-    combi_ctx *combi;
+    combi_mask set;
 
     if (m == 0) return false;
 
@@ -1243,17 +1293,17 @@ static bool discount_clue(game_state *state, int x, int y,
 
     if (m < 0 || m > n) return false; /* become impossible. */
 
-    combi = new_combi(n - m + 1, n);
-    while (next_combi(combi)) {
+    for (set = first_combi_mask(n - m + 1); set;
+         set = next_combi_mask(set, n)) {
         discount_clear(state, scratch, &slen);
-        for (i = 0; i < combi->r; i++) {
-            scratch[slen].x = sempty.points[combi->a[i]].x;
-            scratch[slen].y = sempty.points[combi->a[i]].y;
+        for (i = 0; i < n; i++) {
+            if (!(set & ((combi_mask)1 << i))) continue;
+            scratch[slen].x = sempty.points[i].x;
+            scratch[slen].y = sempty.points[i].y;
             slen++;
         }
         if (discount_set(state, scratch, slen)) didsth = true;
     }
-    free_combi(combi);
 #ifdef SOLVER_DIAGNOSTICS
     if (didsth) debug(("  [from clue at (%d,%d)].\n", x, y));
 #endif
@@ -1388,7 +1438,7 @@ reduction_success:
 #ifdef SOLVER_DIAGNOSTICS
         debug(("Recursing #1: trying (%d,%d) as IMPOSSIBLE\n", bestx, besty));
 #endif
-        GRID(state,flags,bestx,besty) |= F_IMPOSSIBLE;
+        GRID_PUT(state,flags,bestx,besty) |= F_IMPOSSIBLE;
         self_soluble = solve_sub(state, solve_flags,  depth+1, maxdepth);
 
         if (!(solve_flags & F_SOLVE_FORCEUNIQUE) && self_soluble > 0) {
@@ -1419,10 +1469,8 @@ reduction_success:
         } else if (self_soluble <= 0) {
             /* copy solved and we didn't, so copy in copy's (now solved)
              * flags and light state. */
-            memcpy(state->lights, scopy->lights,
-                   scopy->w * scopy->h * sizeof(int));
-            memcpy(state->flags, scopy->flags,
-                   scopy->w * scopy->h * sizeof(unsigned int));
+            cow_free(state->cells);
+            state->cells = cow_dup(scopy->cells);
             ret = copy_soluble;
         } else {
             ret = copy_soluble + self_soluble;
@@ -1452,7 +1500,7 @@ static int dosolve(game_state *state, int solve_flags, int *maxdepth)
 
     for (x = 0; x < state->w; x++) {
         for (y = 0; y < state->h; y++) {
-            GRID(state,flags,x,y) &= ~F_NUMBERUSED;
+            GRID_PUT(state,flags,x,y) &= ~F_NUMBERUSED;
         }
     }
     nsol = solve_sub(state, solve_flags, 0, maxdepth);
@@ -1466,8 +1514,8 @@ static int strip_unused_nums(game_state *state)
         for (y = 0; y < state->h; y++) {
             if ((GRID(state,flags,x,y) & F_NUMBERED) &&
                 !(GRID(state,flags,x,y) & F_NUMBERUSED)) {
-                GRID(state,flags,x,y) &= ~F_NUMBERED;
-                GRID(state,lights,x,y) = 0;
+                GRID_PUT(state,flags,x,y) &= ~F_NUMBERED;
+                GRID_PUT(state,lights,x,y) = 0;
                 n++;
             }
         }
@@ -1483,8 +1531,8 @@ static void unplace_lights(game_state *state)
         for (y = 0; y < state->h; y++) {
             if (GRID(state,flags,x,y) & F_LIGHT)
                 set_light(state,x,y,false);
-            GRID(state,flags,x,y) &= ~F_IMPOSSIBLE;
-            GRID(state,flags,x,y) &= ~F_NUMBERUSED;
+            GRID_PUT(state,flags,x,y) &= ~F_IMPOSSIBLE;
+            GRID_PUT(state,flags,x,y) &= ~F_NUMBERUSED;
         }
     }
 }
@@ -1588,11 +1636,11 @@ static char *new_game_desc(const game_params *params_in, random_state *rs,
                 x = numindices[j] % params->w;
                 if (!(GRID(news, flags, x, y) & F_NUMBERED)) continue;
                 num = GRID(news, lights, x, y);
-                GRID(news, lights, x, y) = 0;
-                GRID(news, flags, x, y) &= ~F_NUMBERED;
+                GRID_PUT(news, lights, x, y) = 0;
+                GRID_PUT(news, flags, x, y) &= ~F_NUMBERED;
                 if (!puzzle_is_good(news, params->difficulty)) {
-                    GRID(news, lights, x, y) = num;
-                    GRID(news, flags, x, y) |= F_NUMBERED;
+                    GRID_PUT(news, lights, x, y) = num;
+                    GRID_PUT(news, flags, x, y) |= F_NUMBERED;
                 } else
                     debug(("Removed (%d,%d) still soluble.\n", x, y));
             }
@@ -1700,12 +1748,12 @@ static game_state *new_game(midend *me, const game_params *params,
 
             switch (c) {
 	      case '0': case '1': case '2': case '3': case '4':
-                GRID(ret,flags,x,y) |= F_NUMBERED;
-                GRID(ret,lights,x,y) = (c - '0');
+                GRID_PUT(ret,flags,x,y) |= F_NUMBERED;
+                GRID_PUT(ret,lights,x,y) = (c - '0');
                 /* run-on... */
 
 	      case 'B':
-                GRID(ret,flags,x,y) |= F_BLACK;
+                GRID_PUT(ret,flags,x,y) |= F_BLACK;
                 break;
 
 	      case 'S':
@@ -2051,11 +2099,11 @@ static game_state *execute_move(const game_state *state, const char *move)
 
             /* LIGHT and IMPOSSIBLE are mutually exclusive. */
             if (c == 'L') {
-                GRID(ret, flags, x, y) &= ~F_IMPOSSIBLE;
+                GRID_PUT(ret, flags, x, y) &= ~F_IMPOSSIBLE;
                 set_light(ret, x, y, !(flags & F_LIGHT));
             } else {
                 set_light(ret, x, y, false);
-                GRID(ret, flags, x, y) ^= F_IMPOSSIBLE;
+                GRID_PUT(ret, flags, x, y) ^= F_IMPOSSIBLE;
             }
             move += n;
         } else goto badmove;
@@ -2190,7 +2238,7 @@ static unsigned int tile_flags(game_drawstate *ds, const game_state *state,
 static void tile_redraw(drawing *dr, game_drawstate *ds, const game_ui *ui,
                         const game_state *state, int x, int y)
 {
-    unsigned int ds_flags = GRID(ds, flags, x, y);
+    unsigned int ds_flags = ds->flags[y*ds->w + x];
     int dx = COORD(x), dy = COORD(y);
     int lit = (ds_flags & DF_FLASH) ? COL_GRID : COL_LIT;
 
@@ -2260,8 +2308,8 @@ static void game_redraw(drawing *dr, game_drawstate *ds,
     for (x = 0; x < ds->w; x++) {
         for (y = 0; y < ds->h; y++) {
             unsigned int ds_flags = tile_flags(ds, state, ui, x, y, flashing);
-            if (ds_flags != GRID(ds, flags, x, y)) {
-                GRID(ds, flags, x, y) = ds_flags;
+            if (ds_flags != ds->flags[y*ds->w + x]) {
+                ds->flags[y*ds->w + x] = ds_flags;
                 tile_redraw(dr, ds, ui, state, x, y);
             }
         }
@@ -2385,7 +2433,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     get_prefs, set_prefs,
     new_ui,
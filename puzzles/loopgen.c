@@ -15,7 +15,6 @@
 #endif
 
 #include "puzzles.h"
-#include "tree234.h"
 #include "grid.h"
 #include "loopgen.h"
 
@@ -30,6 +29,12 @@ struct face_score {
     int white_score;
     int black_score;
     unsigned long random;
+    /* Numbers of edge-neighbours coloured white and black, kept up to
+     * date as faces are coloured, from which the scores follow. */
+    int white_nbrs;
+    int black_nbrs;
+    /* The last face whose colouring made us look at this one. */
+    int visited;
     /* No need to store a grid_face* here.  The 'face_scores' array will
      * be a list of 'face_score' objects, one for each face of the grid, so
      * the position (index) within the 'face_scores' array will determine
@@ -76,6 +81,101 @@ static int black_sort_cmpfn(void *v1, void *v2)
     return generic_sort_cmpfn(v1, v2, offsetof(struct face_score,black_score));
 }
 
+/*
+ * The candidate faces for one colour, in a binary heap ordered by one
+ * of the comparison functions above, so the best is at the top. Each
+ * face's position in the heap is kept, so that a face can be removed,
+ * or moved after its score changes, without searching for it.
+ *
+ * Unlike a tree234, this can't be walked in sorted order. But nothing
+ * needs to: without a bias function we only want the top, and with
+ * one we look at every candidate anyway, so ties can be broken with
+ * the comparison function directly.
+ */
+struct face_heap {
+    struct face_score *scores;
+    int (*cmp)(void *, void *);
+    int *faces;                        /* the heap itself */
+    int *pos;                          /* of each face in faces[], or -1 */
+    int n;
+};
+
+static void face_heap_init(struct face_heap *h, struct face_score *scores,
+                           int (*cmp)(void *, void *), int num_faces)
+{
+    int i;
+
+    h->scores = scores;
+    h->cmp = cmp;
+    h->faces = snewn(num_faces, int);
+    h->pos = snewn(num_faces, int);
+    for (i = 0; i < num_faces; i++)
+        h->pos[i] = -1;
+    h->n = 0;
+}
+
+static void face_heap_free(struct face_heap *h)
+{
+    sfree(h->faces);
+    sfree(h->pos);
+}
+
+static bool face_heap_before(struct face_heap *h, int i, int j)
+{
+    return h->cmp(h->scores + h->faces[i], h->scores + h->faces[j]) < 0;
+}
+
+static void face_heap_swap(struct face_heap *h, int i, int j)
+{
+    int t = h->faces[i];
+    h->faces[i] = h->faces[j];
+    h->faces[j] = t;
+    h->pos[h->faces[i]] = i;
+    h->pos[h->faces[j]] = j;
+}
+
+/* Restore the heap property after faces[i] may have moved either way. */
+static void face_heap_fix(struct face_heap *h, int i)
+{
+    while (i > 0 && face_heap_before(h, i, (i-1)/2)) {
+        face_heap_swap(h, i, (i-1)/2);
+        i = (i-1)/2;
+    }
+    while (true) {
+        int c = 2*i+1;
+        if (c >= h->n)
+            break;
+        if (c+1 < h->n && face_heap_before(h, c+1, c))
+            c++;
+        if (!face_heap_before(h, c, i))
+            break;
+        face_heap_swap(h, i, c);
+        i = c;
+    }
+}
+
+static void face_heap_add(struct face_heap *h, int face)
+{
+    assert(h->pos[face] < 0);
+    h->faces[h->n] = face;
+    h->pos[face] = h->n++;
+    face_heap_fix(h, h->n - 1);
+}
+
+static void face_heap_del(struct face_heap *h, int face)
+{
+    int i = h->pos[face];
+
+    if (i < 0)
+        return;
+    h->pos[face] = -1;
+    if (i < --h->n) {
+        h->faces[i] = h->faces[h->n];
+        h->pos[h->faces[i]] = i;
+        face_heap_fix(h, i);
+    }
+}
+
 /* 'board' is an array of enum face_colour, indicating which faces are
  * currently black/white/grey.  'colour' is FACE_WHITE or FACE_BLACK.
  * Returns whether it's legal to colour the given face with this colour. */
@@ -83,9 +183,13 @@ static bool can_colour_face(grid *g, char* board, int face_index,
                             enum face_colour colour)
 {
     int i, j;
-    grid_face *test_face = g->faces[face_index];
-    grid_face *starting_face, *current_face;
-    grid_dot *starting_dot;
+    const int *face_edges = g->face_edges + g->face_start[face_index];
+    const int *face_dots = g->face_dots + g->face_start[face_index];
+    int order = g->face_start[face_index + 1] - g->face_start[face_index];
+    const int *dot_faces;
+    int dot_order;
+    int starting_face, current_face;
+    int starting_dot;
     int transitions;
     bool current_state, s; /* equal or not-equal to 'colour' */
     bool found_same_coloured_neighbour = false;
@@ -93,10 +197,10 @@ static bool can_colour_face(grid *g, char* board, int face_index,
 
     /* Can only consider a face for colouring if it's adjacent to a face
      * with the same colour. */
-    for (i = 0; i < test_face->order; i++) {
-        grid_edge *e = test_face->edges[i];
-        grid_face *f = (e->face1 == test_face) ? e->face2 : e->face1;
-        if (FACE_COLOUR(f) == colour) {
+    for (i = 0; i < order; i++) {
+        const int *ef = g->edge_faces + 2 * face_edges[i];
+        int f = (ef[0] == face_index) ? ef[1] : ef[0];
+        if (FACE_INDEX_COLOUR(f) == colour) {
             found_same_coloured_neighbour = true;
             break;
         }
@@ -128,9 +232,16 @@ static bool can_colour_face(grid *g, char* board, int face_index,
      * j points to a face around the i^th dot.
      * The current face will always be:
      *     test_face->dots[i]->faces[j]
+     * which, in the grid's index arrays, is dot_faces[j] once we've
+     * pointed dot_faces at the faces of the i^th dot.
      * We assume dots go clockwise around the test face,
      * and faces go clockwise around dots. */
 
+#define SET_DOT(i) ( \
+        dot_faces = g->dot_faces + g->dot_start[face_dots[i]], \
+        dot_order = g->dot_start[face_dots[i] + 1] - \
+                    g->dot_start[face_dots[i]] )
+
     /*
      * The end condition is slightly fiddly. In sufficiently strange
      * degenerate grids, our test face may be adjacent to the same
@@ -153,48 +264,50 @@ static bool can_colour_face(grid *g, char* board, int face_index,
      */
 
     i = j = 0;
-    current_face = test_face->dots[0]->faces[0];
-    if (current_face == test_face) {
+    SET_DOT(0);
+    current_face = dot_faces[0];
+    if (current_face == face_index) {
         j = 1;
-        current_face = test_face->dots[0]->faces[1];
+        current_face = dot_faces[1];
     }
     transitions = 0;
-    current_state = (FACE_COLOUR(current_face) == colour);
-    starting_dot = NULL;
-    starting_face = NULL;
+    current_state = (FACE_INDEX_COLOUR(current_face) == colour);
+    starting_dot = -1;
+    starting_face = -1;
     while (true) {
         /* Advance to next face.
          * Need to loop here because it might take several goes to
          * find it. */
         while (true) {
             j++;
-            if (j == test_face->dots[i]->order)
+            if (j == dot_order)
                 j = 0;
 
-            if (test_face->dots[i]->faces[j] == test_face) {
+            if (dot_faces[j] == face_index) {
                 /* Advance to next dot round test_face, then
                  * find current_face around new dot
                  * and advance to the next face clockwise */
                 i++;
-                if (i == test_face->order)
+                if (i == order)
                     i = 0;
-                for (j = 0; j < test_face->dots[i]->order; j++) {
-                    if (test_face->dots[i]->faces[j] == current_face)
+                SET_DOT(i);
+                for (j = 0; j < dot_order; j++) {
+                    if (dot_faces[j] == current_face)
                         break;
                 }
                 /* Must actually find current_face around new dot,
                  * or else something's wrong with the grid. */
-                assert(j != test_face->dots[i]->order);
+                assert(j != dot_order);
                 /* Found, so advance to next face and try again */
             } else {
                 break;
             }
         }
         /* (i,j) are now advanced to next face */
-        current_face = test_face->dots[i]->faces[j];
-        s = (FACE_COLOUR(current_face) == colour);
-	if (!starting_dot) {
-	    starting_dot = test_face->dots[i];
+        current_face = dot_faces[j];
+        s = (FACE_INDEX_COLOUR(current_face) == colour);
+	if (starting_dot < 0) {
+	    starting_dot = face_dots[i];
 	    starting_face = current_face;
 	    current_state = s;
 	} else {
@@ -204,27 +317,27 @@ static bool can_colour_face(grid *g, char* board, int face_index,
 		if (transitions > 2)
 		    break;
 	    }
-	    if (test_face->dots[i] == starting_dot &&
+	    if (face_dots[i] == starting_dot &&
 		current_face == starting_face)
 		break;
         }
     }
 
+#undef SET_DOT
+
     return (transitions == 2) ? true : false;
 }
 
 /* Count the number of neighbours of 'face', having colour 'colour' */
-static int face_num_neighbours(grid *g, char *board, grid_face *face,
+static int face_num_neighbours(grid *g, char *board, int face,
                                enum face_colour colour)
 {
     int colour_count = 0;
     int i;
-    grid_face *f;
-    grid_edge *e;
-    for (i = 0; i < face->order; i++) {
-        e = face->edges[i];
-        f = (e->face1 == face) ? e->face2 : e->face1;
-        if (FACE_COLOUR(f) == colour)
+    for (i = g->face_start[face]; i < g->face_start[face + 1]; i++) {
+        const int *ef = g->edge_faces + 2 * g->face_edges[i];
+        int f = (ef[0] == face) ? ef[1] : ef[0];
+        if (FACE_INDEX_COLOUR(f) == colour)
             ++colour_count;
     }
     return colour_count;
@@ -234,13 +347,37 @@ static int face_num_neighbours(grid *g, char *board, grid_face *face,
  * as the next face to colour white or black.  We want to encourage moving
  * into grey areas and increasing loopiness, so we give scores according to
  * how many of the face's neighbours are currently coloured the same as the
- * proposed colour. */
-static int face_score(grid *g, char *board, grid_face *face,
-                      enum face_colour colour)
+ * proposed colour.  (generate_loop keeps count of those as it goes, rather
+ * than calling face_num_neighbours every time.) */
+static int face_score(int num_same_coloured_neighbours)
 {
     /* Simple formula: score = 0 - num. same-coloured neighbours,
      * so a higher score means fewer same-coloured neighbours. */
-    return -face_num_neighbours(g, board, face, colour);
+    return -num_same_coloured_neighbours;
+}
+
+/*
+ * Re-examine a grey face as a candidate for one colour, given its
+ * cached neighbour count for that colour, after a nearby face has been
+ * coloured: put it in, or take it out of, or move it within, that
+ * colour's heap. A face with no neighbours of the colour can't have
+ * it, so the full check in can_colour_face isn't needed.
+ */
+static void update_candidate(grid *g, char *board, struct face_heap *h,
+                             int face, enum face_colour colour,
+                             int *score, int nbrs)
+{
+    if (nbrs > 0 && can_colour_face(g, board, face, colour)) {
+        if (h->pos[face] < 0) {
+            *score = face_score(nbrs);
+            face_heap_add(h, face);
+        } else if (*score != face_score(nbrs)) {
+            *score = face_score(nbrs);
+            face_heap_fix(h, h->pos[face]);
+        }
+    } else {
+        face_heap_del(h, face);
+    }
 }
 
 /*
@@ -306,9 +443,8 @@ void generate_loop(grid *g, char *board, random_state *rs,
     int num_faces = g->num_faces;
     struct face_score *face_scores; /* Array of face_score objects */
     struct face_score *fs; /* Points somewhere in the above list */
-    struct grid_face *cur_face;
-    tree234 *lightable_faces_sorted;
-    tree234 *darkable_faces_sorted;
+    int cur_face;
+    struct face_heap lightable_faces, darkable_faces;
     int *face_list;
     bool do_random_pass;
 
@@ -320,6 +456,7 @@ void generate_loop(grid *g, char *board, random_state *rs,
     for (i = 0; i < num_faces; i++) {
         face_scores[i].random = random_bits(rs, 31);
         face_scores[i].black_score = face_scores[i].white_score = 0;
+        face_scores[i].visited = -1;
     }
     
     /* Colour a random, finite face white.  The infinite face is implicitly
@@ -333,34 +470,35 @@ void generate_loop(grid *g, char *board, random_state *rs,
      * their score and choose randomly from that with appropriate skew.
      * In order to avoid consistently biasing towards particular faces, we
      * need the sort order _within_ each group of scores to be completely
-     * random.  But it would be abusing the hospitality of the tree234 data
-     * structure if our comparison function were nondeterministic :-).  So with
+     * random.  But it would be abusing the hospitality of the heap
+     * if our comparison function were nondeterministic :-).  So with
      * each face we associate a random number that does not change during a
      * particular run of the generator, and use that as a secondary sort key.
      * Yes, this means we will be biased towards particular random faces in
      * any one run but that doesn't actually matter. */
 
-    lightable_faces_sorted = newtree234(white_sort_cmpfn);
-    darkable_faces_sorted = newtree234(black_sort_cmpfn);
+    face_heap_init(&lightable_faces, face_scores, white_sort_cmpfn, num_faces);
+    face_heap_init(&darkable_faces, face_scores, black_sort_cmpfn, num_faces);
 
     /* Initialise the lists of lightable and darkable faces.  This is
      * slightly different from the code inside the while-loop, because we need
      * to check every face of the board (the grid structure does not keep a
      * list of the infinite face's neighbours). */
     for (i = 0; i < num_faces; i++) {
-        grid_face *f = g->faces[i];
         struct face_score *fs = face_scores + i;
+        fs->white_nbrs = face_num_neighbours(g, board, i, FACE_WHITE);
+        fs->black_nbrs = face_num_neighbours(g, board, i, FACE_BLACK);
         if (board[i] != FACE_GREY) continue;
         /* We need the full colourability check here, it's not enough simply
          * to check neighbourhood.  On some grids, a neighbour of the infinite
          * face is not necessarily darkable. */
         if (can_colour_face(g, board, i, FACE_BLACK)) {
-            fs->black_score = face_score(g, board, f, FACE_BLACK);
-            add234(darkable_faces_sorted, fs);
+            fs->black_score = face_score(fs->black_nbrs);
+            face_heap_add(&darkable_faces, i);
         }
         if (can_colour_face(g, board, i, FACE_WHITE)) {
-            fs->white_score = face_score(g, board, f, FACE_WHITE);
-            add234(lightable_faces_sorted, fs);
+            fs->white_score = face_score(fs->white_nbrs);
+            face_heap_add(&lightable_faces, i);
         }
     }
 
@@ -368,9 +506,9 @@ void generate_loop(grid *g, char *board, random_state *rs,
     while (true)
     {
         enum face_colour colour;
-        tree234 *faces_to_pick;
-        int c_lightable = count234(lightable_faces_sorted);
-        int c_darkable = count234(darkable_faces_sorted);
+        struct face_heap *faces_to_pick;
+        int c_lightable = lightable_faces.n;
+        int c_darkable = darkable_faces.n;
         if (c_lightable == 0 && c_darkable == 0) {
             /* No more faces we can use at all. */
             break;
@@ -382,40 +520,39 @@ void generate_loop(grid *g, char *board, random_state *rs,
         colour = random_upto(rs, 2) ? FACE_WHITE : FACE_BLACK;
 
         if (colour == FACE_WHITE)
-            faces_to_pick = lightable_faces_sorted;
+            faces_to_pick = &lightable_faces;
         else
-            faces_to_pick = darkable_faces_sorted;
+            faces_to_pick = &darkable_faces;
         if (bias) {
             /*
              * Go through all the candidate faces and pick the one the
              * bias function likes best, breaking ties using the
-             * ordering in our tree234 (which is why we replace only
+             * heap's ordering (so that we pick the same face as if
+             * we'd gone through them in that order and replaced only
              * if score > bestscore, not >=).
              */
             int j, k;
             struct face_score *best = NULL;
             int score, bestscore = 0;
 
-            for (j = 0;
-                 (fs = (struct face_score *)index234(faces_to_pick, j))!=NULL;
-                 j++) {
-
-                assert(fs);
-                k = fs - face_scores;
+            for (j = 0; j < faces_to_pick->n; j++) {
+                k = faces_to_pick->faces[j];
+                fs = face_scores + k;
                 assert(board[k] == FACE_GREY);
                 board[k] = colour;
                 score = bias(biasctx, board, k);
                 board[k] = FACE_GREY;
                 bias(biasctx, board, k); /* let bias know we put it back */
 
-                if (!best || score > bestscore) {
+                if (!best || score > bestscore ||
+                    (score == bestscore && faces_to_pick->cmp(fs, best) < 0)) {
                     bestscore = score;
                     best = fs;
                 }
             }
             fs = best;
         } else {
-            fs = (struct face_score *)index234(faces_to_pick, 0);
+            fs = face_scores + faces_to_pick->faces[0];
         }
         assert(fs);
         i = fs - face_scores;
@@ -426,61 +563,66 @@ void generate_loop(grid *g, char *board, random_state *rs,
 
         /* Remove this newly-coloured face from the lists.  These lists should
          * only contain grey faces. */
-        del234(lightable_faces_sorted, fs);
-        del234(darkable_faces_sorted, fs);
+        face_heap_del(&lightable_faces, i);
+        face_heap_del(&darkable_faces, i);
 
         /* Remember which face we've just coloured */
-        cur_face = g->faces[i];
+        cur_face = i;
+
+        /* Its edge-neighbours each have one more neighbour of its colour. */
+        for (i = g->face_start[cur_face]; i < g->face_start[cur_face + 1];
+             i++) {
+            const int *ef = g->edge_faces + 2 * g->face_edges[i];
+            int fi = (ef[0] == cur_face) ? ef[1] : ef[0];
+
+            if (fi < 0)
+                continue;
+            if (colour == FACE_WHITE)
+                face_scores[fi].white_nbrs++;
+            else
+                face_scores[fi].black_nbrs++;
+        }
 
         /* The face we've just coloured potentially affects the colourability
          * and the scores of any neighbouring faces (touching at a corner or
          * edge).  So the search needs to be conducted around all faces
          * touching the one we've just lit.  Iterate over its corners, then
-         * over each corner's faces.  For each such face, we remove it from
-         * the lists, recalculate any scores, then add it back to the lists
-         * (depending on whether it is lightable, darkable or both). */
-        for (i = 0; i < cur_face->order; i++) {
-            grid_dot *d = cur_face->dots[i];
-            for (j = 0; j < d->order; j++) {
-                grid_face *f = d->faces[j];
-                int fi; /* face index of f */
-
-                if (f == NULL)
+         * over each corner's faces.  Each such face is re-examined just
+         * once, even if it touches several of our corners: its scores are
+         * recalculated from the neighbour counts, and it's put into,
+         * taken out of or moved within the lists as necessary. */
+        for (i = g->face_start[cur_face]; i < g->face_start[cur_face + 1];
+             i++) {
+            int d = g->face_dots[i];
+            for (j = g->dot_start[d]; j < g->dot_start[d + 1]; j++) {
+                int fi = g->dot_faces[j]; /* face index */
+
+                if (fi < 0)
                     continue;
-                if (f == cur_face)
+                if (fi == cur_face)
                     continue;
                 
                 /* If the face is already coloured, it won't be on our
-                 * lightable/darkable lists anyway, so we can skip it without 
-                 * bothering with the removal step. */
-                if (FACE_COLOUR(f) != FACE_GREY) continue; 
+                 * lightable/darkable lists anyway, so we can skip it. */
+                if (board[fi] != FACE_GREY) continue; 
 
-                /* Find the face index and face_score* corresponding to f */
-                fi = f->index;
+                /* Find the face_score* corresponding to fi */
                 fs = face_scores + fi;
+                if (fs->visited == cur_face)
+                    continue;
+                fs->visited = cur_face;
 
-                /* Remove from lightable list if it's in there.  We do this,
-                 * even if it is still lightable, because the score might
-                 * be different, and we need to remove-then-add to maintain
-                 * correct sort order. */
-                del234(lightable_faces_sorted, fs);
-                if (can_colour_face(g, board, fi, FACE_WHITE)) {
-                    fs->white_score = face_score(g, board, f, FACE_WHITE);
-                    add234(lightable_faces_sorted, fs);
-                }
-                /* Do the same for darkable list. */
-                del234(darkable_faces_sorted, fs);
-                if (can_colour_face(g, board, fi, FACE_BLACK)) {
-                    fs->black_score = face_score(g, board, f, FACE_BLACK);
-                    add234(darkable_faces_sorted, fs);
-                }
+                update_candidate(g, board, &lightable_faces, fi, FACE_WHITE,
+                                 &fs->white_score, fs->white_nbrs);
+                update_candidate(g, board, &darkable_faces, fi, FACE_BLACK,
+                                 &fs->black_score, fs->black_nbrs);
             }
         }
     }
 
     /* Clean up */
-    freetree234(lightable_faces_sorted);
-    freetree234(darkable_faces_sorted);
+    face_heap_free(&lightable_faces);
+    face_heap_free(&darkable_faces);
     sfree(face_scores);
 
     /* The next step requires a shuffled list of all faces */
@@ -517,14 +659,13 @@ void generate_loop(grid *g, char *board, random_state *rs,
             enum face_colour opp =
                 (board[j] == FACE_WHITE) ? FACE_BLACK : FACE_WHITE;
             if (can_colour_face(g, board, j, opp)) {
-                grid_face *face = g->faces[j];
                 if (do_random_pass) {
                     /* final random pass */
                     if (!random_upto(rs, 10))
                         board[j] = opp;
                 } else {
                     /* normal pass - flip when neighbour count is 1 */
-                    if (face_num_neighbours(g, board, face, opp) == 1) {
+                    if (face_num_neighbours(g, board, j, opp) == 1) {
                         board[j] = opp;
                         flipped = true;
                     }
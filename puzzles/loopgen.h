@@ -15,6 +15,9 @@ enum face_colour { FACE_WHITE, FACE_GREY, FACE_BLACK };
     ( (face) == NULL ? FACE_BLACK : \
 	  board[(face)->index] )
 
+/* The same, given a face index, with -1 meaning the infinite face. */
+#define FACE_INDEX_COLOUR(fi) ( (fi) < 0 ? FACE_BLACK : board[fi] )
+
 typedef int (*loopgen_bias_fn_t)(void *ctx, char *board, int face);
 
 /* 'board' should be a char array whose length is the same as
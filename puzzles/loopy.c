@@ -165,6 +165,12 @@ typedef struct solver_state {
     bool *dot_solved, *face_solved;
     DSF *dotdsf;
 
+    /* For each dot and face, which of the per-dot and per-face solvers
+     * (DIRTY_* flags below) might find something new there, because
+     * something they look at has changed since they last visited it.
+     * The rest would only repeat deductions already made. */
+    unsigned char *dot_dirty, *face_dirty;
+
     /* Information for Normal level deductions:
      * For each dline, store a bitmask for whether we know:
      * (bit 0) at least one is YES
@@ -175,6 +181,11 @@ typedef struct solver_state {
     DSF *linedsf;
 } solver_state;
 
+enum {
+    DIRTY_TRIVIAL = 1,                 /* for trivial_deductions */
+    DIRTY_DLINE = 2                    /* for dline_deductions */
+};
+
 /*
  * Difficulty levels. I do some macro ickery here to ensure that my
  * enum and the various forms of my name list always match up.
@@ -240,12 +251,24 @@ struct game_drawstate {
     char *lines;
     bool *clue_error;
     bool *clue_satisfied;
+
+    /*
+     * Spatial index of everything we draw, so that redrawing a small
+     * rectangle only has to look at the objects near it; see
+     * build_redraw_index.
+     */
+    int *bboxes;                       /* x,y,w,h per object */
+    int binsize, nbinx, nbiny;
+    int *binstart, *binobjs;
+    unsigned *seen, stamp;             /* objects already found */
+    int *objs;                         /* scratch for game_redraw_in_rect */
+    int *changed;                      /* scratch for game_redraw */
 };
 
 static const char *validate_desc(const game_params *params, const char *desc);
 static int dot_order(const game_state* state, int i, char line_type);
 static int face_order(const game_state* state, int i, char line_type);
-static solver_state *solve_game_rec(const solver_state *sstate);
+static void solve_game_rec(solver_state *sstate);
 
 #ifdef DEBUG_CACHES
 static void check_caches(const solver_state* sstate);
@@ -423,6 +446,11 @@ static solver_state *new_solver_state(const game_state *state, int diff) {
     ret->face_no_count = snewn(num_faces, char);
     memset(ret->face_no_count, 0, num_faces);
 
+    ret->dot_dirty = snewn(num_dots, unsigned char);
+    memset(ret->dot_dirty, DIRTY_TRIVIAL | DIRTY_DLINE, num_dots);
+    ret->face_dirty = snewn(num_faces, unsigned char);
+    memset(ret->face_dirty, DIRTY_TRIVIAL | DIRTY_DLINE, num_faces);
+
     if (diff < DIFF_NORMAL) {
         ret->dlines = NULL;
     } else {
@@ -450,6 +478,8 @@ static void free_solver_state(solver_state *sstate) {
         sfree(sstate->dot_no_count);
         sfree(sstate->face_yes_count);
         sfree(sstate->face_no_count);
+        sfree(sstate->dot_dirty);
+        sfree(sstate->face_dirty);
 
         /* OK, because sfree(NULL) is a no-op */
         sfree(sstate->dlines);
@@ -459,57 +489,6 @@ static void free_solver_state(solver_state *sstate) {
     }
 }
 
-static solver_state *dup_solver_state(const solver_state *sstate) {
-    game_state *state = sstate->state;
-    int num_dots = state->game_grid->num_dots;
-    int num_faces = state->game_grid->num_faces;
-    int num_edges = state->game_grid->num_edges;
-    solver_state *ret = snew(solver_state);
-
-    ret->state = state = dup_game(sstate->state);
-
-    ret->solver_status = sstate->solver_status;
-    ret->diff = sstate->diff;
-
-    ret->dotdsf = dsf_new(num_dots);
-    ret->looplen = snewn(num_dots, int);
-    dsf_copy(ret->dotdsf, sstate->dotdsf);
-    memcpy(ret->looplen, sstate->looplen,
-           num_dots * sizeof(int));
-
-    ret->dot_solved = snewn(num_dots, bool);
-    ret->face_solved = snewn(num_faces, bool);
-    memcpy(ret->dot_solved, sstate->dot_solved, num_dots * sizeof(bool));
-    memcpy(ret->face_solved, sstate->face_solved, num_faces * sizeof(bool));
-
-    ret->dot_yes_count = snewn(num_dots, char);
-    memcpy(ret->dot_yes_count, sstate->dot_yes_count, num_dots);
-    ret->dot_no_count = snewn(num_dots, char);
-    memcpy(ret->dot_no_count, sstate->dot_no_count, num_dots);
-
-    ret->face_yes_count = snewn(num_faces, char);
-    memcpy(ret->face_yes_count, sstate->face_yes_count, num_faces);
-    ret->face_no_count = snewn(num_faces, char);
-    memcpy(ret->face_no_count, sstate->face_no_count, num_faces);
-
-    if (sstate->dlines) {
-        ret->dlines = snewn(2*num_edges, char);
-        memcpy(ret->dlines, sstate->dlines,
-               2*num_edges);
-    } else {
-        ret->dlines = NULL;
-    }
-
-    if (sstate->linedsf) {
-        ret->linedsf = dsf_new_flip(num_edges);
-        dsf_copy(ret->linedsf, sstate->linedsf);
-    } else {
-        ret->linedsf = NULL;
-    }
-
-    return ret;
-}
-
 static game_params *default_params(void)
 {
     game_params *ret = snew(game_params);
@@ -1067,6 +1046,11 @@ static game_drawstate *game_new_drawstate(drawing *dr, const game_state *state)
     ds->textx = snewn(num_faces, int);
     ds->texty = snewn(num_faces, int);
     ds->flashing = false;
+    ds->bboxes = NULL;
+    ds->binstart = ds->binobjs = NULL;
+    ds->seen = NULL;
+    ds->objs = NULL;
+    ds->changed = snewn(num_faces + num_edges, int);
 
     memset(ds->lines, LINE_UNKNOWN, num_edges);
     memset(ds->clue_error, 0, num_faces * sizeof(bool));
@@ -1077,8 +1061,23 @@ static game_drawstate *game_new_drawstate(drawing *dr, const game_state *state)
     return ds;
 }
 
+static void free_redraw_index(game_drawstate *ds)
+{
+    sfree(ds->bboxes);
+    sfree(ds->binstart);
+    sfree(ds->binobjs);
+    sfree(ds->seen);
+    sfree(ds->objs);
+    ds->bboxes = NULL;
+    ds->binstart = ds->binobjs = NULL;
+    ds->seen = NULL;
+    ds->objs = NULL;
+}
+
 static void game_free_drawstate(drawing *dr, game_drawstate *ds)
 {
+    free_redraw_index(ds);
+    sfree(ds->changed);
     sfree(ds->textx);
     sfree(ds->texty);
     sfree(ds->clue_error);
@@ -1216,6 +1215,19 @@ static void check_caches(const solver_state* sstate)
 /* Sets the line (with index i) to the new state 'line_new', and updates
  * the cached counts of any affected faces and dots.
  * Returns true if this actually changed the line's state. */
+/* Flag a dot, and every face around it, as worth another look. */
+static void solver_mark_dot(solver_state *sstate, int d,
+                            unsigned char dotflags, unsigned char faceflags)
+{
+    grid *g = sstate->state->game_grid;
+    int k;
+
+    sstate->dot_dirty[d] |= dotflags;
+    for (k = g->dot_start[d]; k < g->dot_start[d + 1]; k++)
+        if (g->dot_faces[k] >= 0)
+            sstate->face_dirty[g->dot_faces[k]] |= faceflags;
+}
+
 static bool solver_set_line(solver_state *sstate, int i,
                             enum line_state line_new
 #ifdef SHOW_WORKING
@@ -1225,7 +1237,7 @@ static bool solver_set_line(solver_state *sstate, int i,
 {
     game_state *state = sstate->state;
     grid *g;
-    grid_edge *e;
+    const int *edge_dots, *edge_faces;
 
     assert(line_new != LINE_UNKNOWN);
 
@@ -1243,29 +1255,42 @@ static bool solver_set_line(solver_state *sstate, int i,
 #endif
 
     g = state->game_grid;
-    e = g->edges[i];
+    edge_dots = g->edge_dots + 2 * i;
+    edge_faces = g->edge_faces + 2 * i;
 
     /* Update the cache for both dots and both faces affected by this. */
     if (line_new == LINE_YES) {
-        sstate->dot_yes_count[e->dot1->index]++;
-        sstate->dot_yes_count[e->dot2->index]++;
-        if (e->face1) {
-            sstate->face_yes_count[e->face1->index]++;
+        sstate->dot_yes_count[edge_dots[0]]++;
+        sstate->dot_yes_count[edge_dots[1]]++;
+        if (edge_faces[0] >= 0) {
+            sstate->face_yes_count[edge_faces[0]]++;
         }
-        if (e->face2) {
-            sstate->face_yes_count[e->face2->index]++;
+        if (edge_faces[1] >= 0) {
+            sstate->face_yes_count[edge_faces[1]]++;
         }
     } else {
-        sstate->dot_no_count[e->dot1->index]++;
-        sstate->dot_no_count[e->dot2->index]++;
-        if (e->face1) {
-            sstate->face_no_count[e->face1->index]++;
+        sstate->dot_no_count[edge_dots[0]]++;
+        sstate->dot_no_count[edge_dots[1]]++;
+        if (edge_faces[0] >= 0) {
+            sstate->face_no_count[edge_faces[0]]++;
         }
-        if (e->face2) {
-            sstate->face_no_count[e->face2->index]++;
+        if (edge_faces[1] >= 0) {
+            sstate->face_no_count[edge_faces[1]]++;
         }
     }
 
+    /* Both dots' counts have changed, and so have the faces on either
+     * side; but trivial_deductions also looks at every line meeting a
+     * corner of a face, so it wants all the faces around both dots. */
+    solver_mark_dot(sstate, edge_dots[0], DIRTY_TRIVIAL | DIRTY_DLINE,
+                    DIRTY_TRIVIAL);
+    solver_mark_dot(sstate, edge_dots[1], DIRTY_TRIVIAL | DIRTY_DLINE,
+                    DIRTY_TRIVIAL);
+    if (edge_faces[0] >= 0)
+        sstate->face_dirty[edge_faces[0]] |= DIRTY_DLINE;
+    if (edge_faces[1] >= 0)
+        sstate->face_dirty[edge_faces[1]] |= DIRTY_DLINE;
+
     check_caches(sstate);
     return true;
 }
@@ -1286,10 +1311,9 @@ static bool merge_dots(solver_state *sstate, int edge_index)
 {
     int i, j, len;
     grid *g = sstate->state->game_grid;
-    grid_edge *e = g->edges[edge_index];
 
-    i = e->dot1->index;
-    j = e->dot2->index;
+    i = g->edge_dots[2 * edge_index];
+    j = g->edge_dots[2 * edge_index + 1];
 
     i = dsf_canonify(sstate->dotdsf, i);
     j = dsf_canonify(sstate->dotdsf, j);
@@ -1347,12 +1371,10 @@ static int dot_order(const game_state* state, int dot, char line_type)
 {
     int n = 0;
     grid *g = state->game_grid;
-    grid_dot *d = g->dots[dot];
     int i;
 
-    for (i = 0; i < d->order; i++) {
-        grid_edge *e = d->edges[i];
-        if (state->lines[e->index] == line_type)
+    for (i = g->dot_start[dot]; i < g->dot_start[dot + 1]; i++) {
+        if (state->lines[g->dot_edges[i]] == line_type)
             ++n;
     }
     return n;
@@ -1364,12 +1386,10 @@ static int face_order(const game_state* state, int face, char line_type)
 {
     int n = 0;
     grid *g = state->game_grid;
-    grid_face *f = g->faces[face];
     int i;
 
-    for (i = 0; i < f->order; i++) {
-        grid_edge *e = f->edges[i];
-        if (state->lines[e->index] == line_type)
+    for (i = g->face_start[face]; i < g->face_start[face + 1]; i++) {
+        if (state->lines[g->face_edges[i]] == line_type)
             ++n;
     }
     return n;
@@ -1383,17 +1403,15 @@ static bool dot_setall(solver_state *sstate, int dot,
     bool retval = false, r;
     game_state *state = sstate->state;
     grid *g;
-    grid_dot *d;
     int i;
 
     if (old_type == new_type)
         return false;
 
     g = state->game_grid;
-    d = g->dots[dot];
 
-    for (i = 0; i < d->order; i++) {
-        int line_index = d->edges[i]->index;
+    for (i = g->dot_start[dot]; i < g->dot_start[dot + 1]; i++) {
+        int line_index = g->dot_edges[i];
         if (state->lines[line_index] == old_type) {
             r = solver_set_line(sstate, line_index, new_type);
             assert(r);
@@ -1410,17 +1428,15 @@ static bool face_setall(solver_state *sstate, int face,
     bool retval = false, r;
     game_state *state = sstate->state;
     grid *g;
-    grid_face *f;
     int i;
 
     if (old_type == new_type)
         return false;
 
     g = state->game_grid;
-    f = g->faces[face];
 
-    for (i = 0; i < f->order; i++) {
-        int line_index = f->edges[i]->index;
+    for (i = g->face_start[face]; i < g->face_start[face + 1]; i++) {
+        int line_index = g->face_edges[i];
         if (state->lines[line_index] == old_type) {
             r = solver_set_line(sstate, line_index, new_type);
             assert(r);
@@ -1468,15 +1484,13 @@ static void add_full_clues(game_state *state, random_state *rs)
 static bool game_has_unique_soln(const game_state *state, int diff)
 {
     bool ret;
-    solver_state *sstate_new;
     solver_state *sstate = new_solver_state(state, diff);
 
-    sstate_new = solve_game_rec(sstate);
+    solve_game_rec(sstate);
 
-    assert(sstate_new->solver_status != SOLVER_MISTAKE);
-    ret = (sstate_new->solver_status == SOLVER_SOLVED);
+    assert(sstate->solver_status != SOLVER_MISTAKE);
+    ret = (sstate->solver_status == SOLVER_SOLVED);
 
-    free_solver_state(sstate_new);
     free_solver_state(sstate);
 
     return ret;
@@ -1485,7 +1499,7 @@ static bool game_has_unique_soln(const game_state *state, int diff)
 
 /* Remove clues one at a time at random. */
 static game_state *remove_clues(game_state *state, random_state *rs,
-                                int diff)
+                                int diff, int attempt)
 {
     int *face_list;
     int num_faces = state->game_grid->num_faces;
@@ -1504,6 +1518,9 @@ static game_state *remove_clues(game_state *state, random_state *rs,
     shuffle(face_list, num_faces, sizeof(int), rs);
 
     for (n = 0; n < num_faces; ++n) {
+        generation_progress(generation_retry_progress(
+            attempt, 0.25F + 0.75F * n / num_faces));
+
         saved_ret = dup_game(ret);
         ret->clues[face_list[n]] = -1;
 
@@ -1528,7 +1545,9 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     grid *g;
     game_state *state = snew(game_state);
     game_state *state_new;
+    int attempt = 0;
 
+    generation_phase("grid");
     grid_desc = grid_new_desc(grid_types[params->type], params->w, params->h, rs);
     state->game_grid = g = loopy_generate_grid(params, grid_desc);
 
@@ -1547,22 +1566,28 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     state->solved = false;
     state->cheated = false;
 
+    generation_progress(generation_retry_progress(attempt, 0.0F));
+
     /* Get a new random solvable board with all its clues filled in.  Yes, this
      * can loop for ever if the params are suitably unfavourable, but
      * preventing games smaller than 4x4 seems to stop this happening */
     do {
+        generation_phase("clues");
         add_full_clues(state, rs);
+        generation_phase("solve");
     } while (!game_has_unique_soln(state, params->diff));
 
-    state_new = remove_clues(state, rs, params->diff);
+    generation_progress(generation_retry_progress(attempt, 0.25F));
+    state_new = remove_clues(state, rs, params->diff, attempt);
     free_game(state);
     state = state_new;
 
-
+    generation_phase("grade");
     if (params->diff > 0 && game_has_unique_soln(state, params->diff-1)) {
 #ifdef SHOW_WORKING
         fprintf(stderr, "Rejecting board, it is too easy\n");
 #endif
+        attempt++;
         goto newboard_please;
     }
 
@@ -1921,20 +1946,20 @@ static bool check_completion(game_state *state)
 
 /* i points to the first edge of the dline pair, reading clockwise around
  * the dot. */
-static int dline_index_from_dot(grid *g, grid_dot *d, int i)
+static int dline_index_from_dot(grid *g, int d, int i)
 {
-    grid_edge *e = d->edges[i];
+    int e = g->dot_edges[g->dot_start[d] + i];
     int ret;
 #ifdef DEBUG_DLINES
-    grid_edge *e2;
+    int e2;
     int i2 = i+1;
-    if (i2 == d->order) i2 = 0;
-    e2 = d->edges[i2];
+    if (g->dot_start[d] + i2 == g->dot_start[d + 1]) i2 = 0;
+    e2 = g->dot_edges[g->dot_start[d] + i2];
 #endif
-    ret = 2 * (e->index) + ((e->dot1 == d) ? 1 : 0);
+    ret = 2 * e + ((g->edge_dots[2 * e] == d) ? 1 : 0);
 #ifdef DEBUG_DLINES
     printf("dline_index_from_dot: d=%d,i=%d, edges [%d,%d] - %d\n",
-           (int)(d->index), i, (int)(e->index), (int)(e2 ->index), ret);
+           d, i, e, e2, ret);
 #endif
     return ret;
 }
@@ -1942,21 +1967,21 @@ static int dline_index_from_dot(grid *g, grid_dot *d, int i)
  * the face.  That is, the edges of the dline, starting at edge{i}, read
  * anti-clockwise around the face.  By layout conventions, the common dot
  * of the dline will be f->dots[i] */
-static int dline_index_from_face(grid *g, grid_face *f, int i)
+static int dline_index_from_face(grid *g, int f, int i)
 {
-    grid_edge *e = f->edges[i];
-    grid_dot *d = f->dots[i];
+    int e = g->face_edges[g->face_start[f] + i];
+    int d = g->face_dots[g->face_start[f] + i];
     int ret;
 #ifdef DEBUG_DLINES
-    grid_edge *e2;
+    int e2;
     int i2 = i - 1;
-    if (i2 < 0) i2 += f->order;
-    e2 = f->edges[i2];
+    if (i2 < 0) i2 += g->face_start[f + 1] - g->face_start[f];
+    e2 = g->face_edges[g->face_start[f] + i2];
 #endif
-    ret = 2 * (e->index) + ((e->dot1 == d) ? 1 : 0);
+    ret = 2 * e + ((g->edge_dots[2 * e] == d) ? 1 : 0);
 #ifdef DEBUG_DLINES
     printf("dline_index_from_face: f=%d,i=%d, edges [%d,%d] - %d\n",
-           (int)(f->index), i, (int)(e->index), (int)(e2->index), ret);
+           f, i, e, e2, ret);
 #endif
     return ret;
 }
@@ -1964,17 +1989,31 @@ static bool is_atleastone(const char *dline_array, int index)
 {
     return BIT_SET(dline_array[index], 0);
 }
-static bool set_atleastone(char *dline_array, int index)
+/* Set a dline bit, and if that's news, flag the dline's dot and the
+ * faces around it for dline_deductions.  (By dline_index_from_dot, an
+ * odd index belongs to the edge's first dot.) */
+static bool set_dline_bit(solver_state *sstate, int index, int bit)
 {
-    return SET_BIT(dline_array[index], 0);
+    grid *g = sstate->state->game_grid;
+    int e = index / 2;
+
+    if (!SET_BIT(sstate->dlines[index], bit))
+        return false;
+    solver_mark_dot(sstate, g->edge_dots[2 * e + 1 - (index & 1)],
+                    DIRTY_DLINE, DIRTY_DLINE);
+    return true;
+}
+static bool set_atleastone(solver_state *sstate, int index)
+{
+    return set_dline_bit(sstate, index, 0);
 }
 static bool is_atmostone(const char *dline_array, int index)
 {
     return BIT_SET(dline_array[index], 1);
 }
-static bool set_atmostone(char *dline_array, int index)
+static bool set_atmostone(solver_state *sstate, int index)
 {
-    return SET_BIT(dline_array[index], 1);
+    return set_dline_bit(sstate, index, 1);
 }
 
 static void array_setall(char *array, char from, char to, int len)
@@ -1997,11 +2036,12 @@ static void array_setall(char *array, char from, char to, int len)
  * and set their corresponding dline to atleastone.  (Setting atmostone
  * already happens in earlier dline deductions) */
 static bool dline_set_opp_atleastone(solver_state *sstate,
-                                     grid_dot *d, int edge)
+                                     int d, int edge)
 {
     game_state *state = sstate->state;
     grid *g = state->game_grid;
-    int N = d->order;
+    const int *dot_edges = g->dot_edges + g->dot_start[d];
+    int N = g->dot_start[d + 1] - g->dot_start[d];
     int opp, opp2;
     for (opp = 0; opp < N; opp++) {
         int opp_dline_index;
@@ -2014,13 +2054,13 @@ static bool dline_set_opp_atleastone(solver_state *sstate,
         opp2 = opp + 1;
         if (opp2 == N) opp2 = 0;
         /* Check if opp, opp2 point to LINE_UNKNOWNs */
-        if (state->lines[d->edges[opp]->index] != LINE_UNKNOWN)
+        if (state->lines[dot_edges[opp]] != LINE_UNKNOWN)
             continue;
-        if (state->lines[d->edges[opp2]->index] != LINE_UNKNOWN)
+        if (state->lines[dot_edges[opp2]] != LINE_UNKNOWN)
             continue;
         /* Found opposite UNKNOWNS and they're next to each other */
         opp_dline_index = dline_index_from_dot(g, d, opp);
-        return set_atleastone(sstate->dlines, opp_dline_index);
+        return set_atleastone(sstate, opp_dline_index);
     }
     return false;
 }
@@ -2038,18 +2078,18 @@ static bool face_setall_identical(solver_state *sstate, int face_index,
     bool retval = false;
     game_state *state = sstate->state;
     grid *g = state->game_grid;
-    grid_face *f = g->faces[face_index];
-    int N = f->order;
+    const int *face_edges = g->face_edges + g->face_start[face_index];
+    int N = g->face_start[face_index + 1] - g->face_start[face_index];
     int i, j;
     int can1, can2;
     bool inv1, inv2;
 
     for (i = 0; i < N; i++) {
-        int line1_index = f->edges[i]->index;
+        int line1_index = face_edges[i];
         if (state->lines[line1_index] != LINE_UNKNOWN)
             continue;
         for (j = i + 1; j < N; j++) {
-            int line2_index = f->edges[j]->index;
+            int line2_index = face_edges[j];
             if (state->lines[line2_index] != LINE_UNKNOWN)
                 continue;
 
@@ -2068,13 +2108,13 @@ static bool face_setall_identical(solver_state *sstate, int face_index,
 /* Given a dot or face, and a count of LINE_UNKNOWNs, find them and
  * return the edge indices into e. */
 static void find_unknowns(game_state *state,
-    grid_edge **edge_list, /* Edge list to search (from a face or a dot) */
+    const int *edge_list, /* Edge list to search (from a face or a dot) */
     int expected_count, /* Number of UNKNOWNs (comes from solver's cache) */
     int *e /* Returned edge indices */)
 {
     int c = 0;
     while (c < expected_count) {
-        int line_index = (*edge_list)->index;
+        int line_index = *edge_list;
         if (state->lines[line_index] == LINE_UNKNOWN) {
             e[c] = line_index;
             c++;
@@ -2089,7 +2129,7 @@ static void find_unknowns(game_state *state,
  * Returns the difficulty level of the next solver that should be used,
  * or DIFF_MAX if no progress was made. */
 static int parity_deductions(solver_state *sstate,
-    grid_edge **edge_list, /* Edge list (from a face or a dot) */
+    const int *edge_list, /* Edge list (from a face or a dot) */
     int total_parity, /* Expected number of YESs modulo 2 (either 0 or 1) */
     int unknown_count)
 {
@@ -2203,15 +2243,18 @@ static int trivial_deductions(solver_state *sstate)
 
     /* Per-face deductions */
     for (i = 0; i < g->num_faces; i++) {
-        grid_face *f = g->faces[i];
+        const int *face_edges = g->face_edges + g->face_start[i];
+        int order = g->face_start[i + 1] - g->face_start[i];
 
-        if (sstate->face_solved[i])
+        if (sstate->face_solved[i] ||
+            !(sstate->face_dirty[i] & DIRTY_TRIVIAL))
             continue;
+        sstate->face_dirty[i] &= ~DIRTY_TRIVIAL;
 
         current_yes = sstate->face_yes_count[i];
         current_no  = sstate->face_no_count[i];
 
-        if (current_yes + current_no == f->order)  {
+        if (current_yes + current_no == order)  {
             sstate->face_solved[i] = true;
             continue;
         }
@@ -2237,19 +2280,19 @@ static int trivial_deductions(solver_state *sstate)
             continue;
         }
 
-        if (f->order - state->clues[i] < current_no) {
+        if (order - state->clues[i] < current_no) {
             sstate->solver_status = SOLVER_MISTAKE;
             return DIFF_EASY;
         }
-        if (f->order - state->clues[i] == current_no) {
+        if (order - state->clues[i] == current_no) {
             if (face_setall(sstate, i, LINE_UNKNOWN, LINE_YES))
                 diff = min(diff, DIFF_EASY);
             sstate->face_solved[i] = true;
             continue;
         }
 
-        if (f->order - state->clues[i] == current_no + 1 &&
-            f->order - current_yes - current_no > 2) {
+        if (order - state->clues[i] == current_no + 1 &&
+            order - current_yes - current_no > 2) {
             /*
              * One small refinement to the above: we also look for any
              * adjacent pair of LINE_UNKNOWNs around the face with
@@ -2260,23 +2303,25 @@ static int trivial_deductions(solver_state *sstate)
              */
             int j, k, e1, e2, e, d;
 
-            for (j = 0; j < f->order; j++) {
-                e1 = f->edges[j]->index;
-                e2 = f->edges[j+1 < f->order ? j+1 : 0]->index;
+            for (j = 0; j < order; j++) {
+                const int *d1, *d2;
+
+                e1 = face_edges[j];
+                e2 = face_edges[j+1 < order ? j+1 : 0];
+                d1 = g->edge_dots + 2 * e1;
+                d2 = g->edge_dots + 2 * e2;
 
-                if (g->edges[e1]->dot1 == g->edges[e2]->dot1 ||
-                    g->edges[e1]->dot1 == g->edges[e2]->dot2) {
-                    d = g->edges[e1]->dot1->index;
+                if (d1[0] == d2[0] || d1[0] == d2[1]) {
+                    d = d1[0];
                 } else {
-                    assert(g->edges[e1]->dot2 == g->edges[e2]->dot1 ||
-                           g->edges[e1]->dot2 == g->edges[e2]->dot2);
-                    d = g->edges[e1]->dot2->index;
+                    assert(d1[1] == d2[0] || d1[1] == d2[1]);
+                    d = d1[1];
                 }
 
                 if (state->lines[e1] == LINE_UNKNOWN &&
                     state->lines[e2] == LINE_UNKNOWN) {
-                    for (k = 0; k < g->dots[d]->order; k++) {
-                        int e = g->dots[d]->edges[k]->index;
+                    for (k = g->dot_start[d]; k < g->dot_start[d + 1]; k++) {
+                        int e = g->dot_edges[k];
                         if (state->lines[e] == LINE_YES)
                             goto found;    /* multi-level break */
                     }
@@ -2289,8 +2334,8 @@ static int trivial_deductions(solver_state *sstate)
              * If we get here, we've found such a pair of edges, and
              * they're e1 and e2.
              */
-            for (j = 0; j < f->order; j++) {
-                e = f->edges[j]->index;
+            for (j = 0; j < order; j++) {
+                e = face_edges[j];
                 if (state->lines[e] == LINE_UNKNOWN && e != e1 && e != e2) {
                     bool r = solver_set_line(sstate, e, LINE_YES);
                     assert(r);
@@ -2304,15 +2349,16 @@ static int trivial_deductions(solver_state *sstate)
 
     /* Per-dot deductions */
     for (i = 0; i < g->num_dots; i++) {
-        grid_dot *d = g->dots[i];
+        int order = g->dot_start[i + 1] - g->dot_start[i];
         int yes, no, unknown;
 
-        if (sstate->dot_solved[i])
+        if (sstate->dot_solved[i] || !(sstate->dot_dirty[i] & DIRTY_TRIVIAL))
             continue;
+        sstate->dot_dirty[i] &= ~DIRTY_TRIVIAL;
 
         yes = sstate->dot_yes_count[i];
         no = sstate->dot_no_count[i];
-        unknown = d->order - yes - no;
+        unknown = order - yes - no;
 
         if (yes == 0) {
             if (unknown == 0) {
@@ -2401,18 +2447,21 @@ static int dline_deductions(solver_state *sstate)
     for (i = 0; i < g->num_faces; i++) {
         int maxs[MAX_FACE_SIZE][MAX_FACE_SIZE];
         int mins[MAX_FACE_SIZE][MAX_FACE_SIZE];
-        grid_face *f = g->faces[i];
-        int N = f->order;
+        const int *face_edges = g->face_edges + g->face_start[i];
+        int N = g->face_start[i + 1] - g->face_start[i];
         int j,m;
         int clue = state->clues[i];
         assert(N <= MAX_FACE_SIZE);
         if (sstate->face_solved[i])
             continue;
         if (clue < 0) continue;
+        if (!(sstate->face_dirty[i] & DIRTY_DLINE))
+            continue;
+        sstate->face_dirty[i] &= ~DIRTY_DLINE;
 
         /* Calculate the (j,j+1) entries */
         for (j = 0; j < N; j++) {
-            int edge_index = f->edges[j]->index;
+            int edge_index = face_edges[j];
             int dline_index;
             enum line_state line1 = state->lines[edge_index];
             enum line_state line2;
@@ -2422,8 +2471,8 @@ static int dline_deductions(solver_state *sstate)
             maxs[j][k] = (line1 == LINE_NO) ? 0 : 1;
             mins[j][k] = (line1 == LINE_YES) ? 1 : 0;
             /* Calculate the (j,j+2) entries */
-            dline_index = dline_index_from_face(g, f, k);
-            edge_index = f->edges[k]->index;
+            dline_index = dline_index_from_face(g, i, k);
+            edge_index = face_edges[k];
             line2 = state->lines[edge_index];
             k++;
             if (k >= N) k = 0;
@@ -2467,8 +2516,7 @@ static int dline_deductions(solver_state *sstate)
         /* See if we can make any deductions */
         for (j = 0; j < N; j++) {
             int k;
-            grid_edge *e = f->edges[j];
-            int line_index = e->index;
+            int line_index = face_edges[j];
             int dline_index;
 
             if (state->lines[line_index] != LINE_UNKNOWN)
@@ -2502,27 +2550,26 @@ static int dline_deductions(solver_state *sstate)
              * in square grids. */
             if (sstate->diff >= DIFF_TRICKY) {
                 /* Now see if we can make dline deduction for edges{j,j+1} */
-                e = f->edges[k];
-                if (state->lines[e->index] != LINE_UNKNOWN)
+                if (state->lines[face_edges[k]] != LINE_UNKNOWN)
                     /* Only worth doing this for an UNKNOWN,UNKNOWN pair.
                      * Dlines where one of the edges is known, are handled in the
                      * dot-deductions */
                     continue;
     
-                dline_index = dline_index_from_face(g, f, k);
+                dline_index = dline_index_from_face(g, i, k);
                 k++;
                 if (k >= N) k = 0;
     
                 /* minimum YESs in the complement of this dline */
                 if (mins[k][j] > clue - 2) {
                     /* Adding 2 YESs would break the clue */
-                    if (set_atmostone(dlines, dline_index))
+                    if (set_atmostone(sstate, dline_index))
                         diff = min(diff, DIFF_NORMAL);
                 }
                 /* maximum YESs in the complement of this dline */
                 if (maxs[k][j] < clue) {
                     /* Adding 2 NOs would mean not enough YESs */
-                    if (set_atleastone(dlines, dline_index))
+                    if (set_atleastone(sstate, dline_index))
                         diff = min(diff, DIFF_NORMAL);
                 }
             }
@@ -2535,12 +2582,13 @@ static int dline_deductions(solver_state *sstate)
     /* ------ Dot deductions ------ */
 
     for (i = 0; i < g->num_dots; i++) {
-        grid_dot *d = g->dots[i];
-        int N = d->order;
+        const int *dot_edges = g->dot_edges + g->dot_start[i];
+        int N = g->dot_start[i + 1] - g->dot_start[i];
         int yes, no, unknown;
         int j;
-        if (sstate->dot_solved[i])
+        if (sstate->dot_solved[i] || !(sstate->dot_dirty[i] & DIRTY_DLINE))
             continue;
+        sstate->dot_dirty[i] &= ~DIRTY_DLINE;
         yes = sstate->dot_yes_count[i];
         no = sstate->dot_no_count[i];
         unknown = N - yes - no;
@@ -2552,19 +2600,19 @@ static int dline_deductions(solver_state *sstate)
             enum line_state line1, line2;
             k = j + 1;
             if (k >= N) k = 0;
-            dline_index = dline_index_from_dot(g, d, j);
-            line1_index = d->edges[j]->index;
-            line2_index = d->edges[k] ->index;
+            dline_index = dline_index_from_dot(g, i, j);
+            line1_index = dot_edges[j];
+            line2_index = dot_edges[k];
             line1 = state->lines[line1_index];
             line2 = state->lines[line2_index];
 
             /* Infer dline state from line state */
             if (line1 == LINE_NO || line2 == LINE_NO) {
-                if (set_atmostone(dlines, dline_index))
+                if (set_atmostone(sstate, dline_index))
                     diff = min(diff, DIFF_NORMAL);
             }
             if (line1 == LINE_YES || line2 == LINE_YES) {
-                if (set_atleastone(dlines, dline_index))
+                if (set_atleastone(sstate, dline_index))
                     diff = min(diff, DIFF_NORMAL);
             }
             /* Infer line state from dline state */
@@ -2610,10 +2658,10 @@ static int dline_deductions(solver_state *sstate)
                 }
             }
             if (yes == 1) {
-                if (set_atmostone(dlines, dline_index))
+                if (set_atmostone(sstate, dline_index))
                     diff = min(diff, DIFF_NORMAL);
                 if (unknown == 2) {
-                    if (set_atleastone(dlines, dline_index))
+                    if (set_atleastone(sstate, dline_index))
                         diff = min(diff, DIFF_NORMAL);
                 }
             }
@@ -2638,8 +2686,8 @@ static int dline_deductions(solver_state *sstate)
                             continue;
                         if (j == N-1 && opp == 0)
                             continue;
-                        opp_dline_index = dline_index_from_dot(g, d, opp);
-                        if (set_atmostone(dlines, opp_dline_index))
+                        opp_dline_index = dline_index_from_dot(g, i, opp);
+                        if (set_atmostone(sstate, opp_dline_index))
                             diff = min(diff, DIFF_NORMAL);
                     }
                     if (yes == 0 && is_atmostone(dlines, dline_index)) {
@@ -2651,7 +2699,7 @@ static int dline_deductions(solver_state *sstate)
                                 int opp_index;
                                 if (opp == j || opp == k)
                                     continue;
-                                opp_index = d->edges[opp]->index;
+                                opp_index = dot_edges[opp];
                                 if (state->lines[opp_index] == LINE_UNKNOWN) {
                                     solver_set_line(sstate, opp_index,
                                                     LINE_YES);
@@ -2663,7 +2711,7 @@ static int dline_deductions(solver_state *sstate)
                              * already set atmostone, so set atleastone as
                              * well.
                              */
-                            if (dline_set_opp_atleastone(sstate, d, j))
+                            if (dline_set_opp_atleastone(sstate, i, j))
                                 diff = min(diff, DIFF_NORMAL);
                         }
                     }
@@ -2702,7 +2750,7 @@ static int linedsf_deductions(solver_state *sstate)
         if (clue < 0)
             continue;
 
-        N = g->faces[i]->order;
+        N = g->face_start[i + 1] - g->face_start[i];
         yes = sstate->face_yes_count[i];
         if (yes + 1 == clue) {
             if (face_setall_identical(sstate, i, LINE_NO))
@@ -2720,32 +2768,33 @@ static int linedsf_deductions(solver_state *sstate)
 
         /* Deductions with small number of LINE_UNKNOWNs, based on overall
          * parity of lines. */
-        diff_tmp = parity_deductions(sstate, g->faces[i]->edges,
+        diff_tmp = parity_deductions(sstate,
+                                     g->face_edges + g->face_start[i],
                                      (clue - yes) % 2, unknown);
         diff = min(diff, diff_tmp);
     }
 
     /* ------ Dot deductions ------ */
     for (i = 0; i < g->num_dots; i++) {
-        grid_dot *d = g->dots[i];
-        int N = d->order;
+        const int *dot_edges = g->dot_edges + g->dot_start[i];
+        int N = g->dot_start[i + 1] - g->dot_start[i];
         int j;
         int yes, no, unknown;
         /* Go through dlines, and do any dline<->linedsf deductions wherever
          * we find two UNKNOWNS. */
         for (j = 0; j < N; j++) {
-            int dline_index = dline_index_from_dot(g, d, j);
+            int dline_index = dline_index_from_dot(g, i, j);
             int line1_index;
             int line2_index;
             int can1, can2;
             bool inv1, inv2;
             int j2;
-            line1_index = d->edges[j]->index;
+            line1_index = dot_edges[j];
             if (state->lines[line1_index] != LINE_UNKNOWN)
                 continue;
             j2 = j + 1;
             if (j2 == N) j2 = 0;
-            line2_index = d->edges[j2]->index;
+            line2_index = dot_edges[j2];
             if (state->lines[line2_index] != LINE_UNKNOWN)
                 continue;
             /* Infer dline flags from linedsf */
@@ -2753,9 +2802,9 @@ static int linedsf_deductions(solver_state *sstate)
             can2 = dsf_canonify_flip(sstate->linedsf, line2_index, &inv2);
             if (can1 == can2 && inv1 != inv2) {
                 /* These are opposites, so set dline atmostone/atleastone */
-                if (set_atmostone(dlines, dline_index))
+                if (set_atmostone(sstate, dline_index))
                     diff = min(diff, DIFF_NORMAL);
-                if (set_atleastone(dlines, dline_index))
+                if (set_atleastone(sstate, dline_index))
                     diff = min(diff, DIFF_NORMAL);
                 continue;
             }
@@ -2772,7 +2821,7 @@ static int linedsf_deductions(solver_state *sstate)
         yes = sstate->dot_yes_count[i];
         no = sstate->dot_no_count[i];
         unknown = N - yes - no;
-        diff_tmp = parity_deductions(sstate, d->edges,
+        diff_tmp = parity_deductions(sstate, dot_edges,
                                      yes % 2, unknown);
         diff = min(diff, diff_tmp);
     }
@@ -2812,7 +2861,7 @@ static int loop_deductions(solver_state *sstate)
     int shortest_chainlen = g->num_dots;
     int dots_connected;
     bool progress = false;
-    int i;
+    int i, j;
 
     /*
      * Go through the grid and update for all the new edges.
@@ -2867,9 +2916,8 @@ static int loop_deductions(solver_state *sstate)
      * loop it would create is a solution.
      */
     for (i = 0; i < g->num_edges; i++) {
-        grid_edge *e = g->edges[i];
-        int d1 = e->dot1->index;
-        int d2 = e->dot2->index;
+        int d1 = g->edge_dots[2 * i];
+        int d2 = g->edge_dots[2 * i + 1];
         int eqclass, val;
         if (state->lines[i] != LINE_UNKNOWN)
             continue;
@@ -2905,15 +2953,12 @@ static int loop_deductions(solver_state *sstate)
              * side of this edge.
              */
             sm1_nearby = 0;
-            if (e->face1) {
-                int f = e->face1->index;
-                int c = state->clues[f];
-                if (c >= 0 && sstate->face_yes_count[f] == c - 1)
-                    sm1_nearby++;
-            }
-            if (e->face2) {
-                int f = e->face2->index;
-                int c = state->clues[f];
+            for (j = 0; j < 2; j++) {
+                int f = g->edge_faces[2 * i + j];
+                int c;
+                if (f < 0)
+                    continue;
+                c = state->clues[f];
                 if (c >= 0 && sstate->face_yes_count[f] == c - 1)
                     sm1_nearby++;
             }
@@ -2955,12 +3000,12 @@ static int loop_deductions(solver_state *sstate)
     return progress ? DIFF_EASY : DIFF_MAX;
 }
 
-/* This will return a dynamically allocated solver_state containing the (more)
- * solved grid */
-static solver_state *solve_game_rec(const solver_state *sstate_start)
+/* Run the solvers on sstate, leaving it (more) solved. There's no
+ * guessing, so nothing ever has to be undone, and every caller is
+ * finished with the starting state: hence we work on it in place
+ * rather than on a copy. */
+static void solve_game_rec(solver_state *sstate)
 {
-    solver_state *sstate;
-
     /* Index of the solver we should call next. */
     int i = 0;
     
@@ -2980,13 +3025,11 @@ static solver_state *solve_game_rec(const solver_state *sstate_start)
     int threshold_diff = 0;
     int threshold_index = 0;
     
-    sstate = dup_solver_state(sstate_start);
-
     check_caches(sstate);
 
     while (i < NUM_SOLVERS) {
         if (sstate->solver_status == SOLVER_MISTAKE)
-            return sstate;
+            return;
         if (sstate->solver_status == SOLVER_SOLVED ||
             sstate->solver_status == SOLVER_AMBIGUOUS) {
             /* solver finished */
@@ -3016,32 +3059,28 @@ static solver_state *solve_game_rec(const solver_state *sstate_start)
         /* s/LINE_UNKNOWN/LINE_NO/g */
         array_setall(sstate->state->lines, LINE_UNKNOWN, LINE_NO,
                      sstate->state->game_grid->num_edges);
-        return sstate;
     }
-
-    return sstate;
 }
 
 static char *solve_game(const game_state *state, const game_state *currstate,
                         const char *aux, const char **error)
 {
     char *soln = NULL;
-    solver_state *sstate, *new_sstate;
+    solver_state *sstate;
 
     sstate = new_solver_state(state, DIFF_MAX);
-    new_sstate = solve_game_rec(sstate);
+    solve_game_rec(sstate);
 
-    if (new_sstate->solver_status == SOLVER_SOLVED) {
-        soln = encode_solve_move(new_sstate->state);
-    } else if (new_sstate->solver_status == SOLVER_AMBIGUOUS) {
-        soln = encode_solve_move(new_sstate->state);
+    if (sstate->solver_status == SOLVER_SOLVED) {
+        soln = encode_solve_move(sstate->state);
+    } else if (sstate->solver_status == SOLVER_AMBIGUOUS) {
+        soln = encode_solve_move(sstate->state);
         /**error = "Solver found ambiguous solutions"; */
     } else {
-        soln = encode_solve_move(new_sstate->state);
+        soln = encode_solve_move(sstate->state);
         /**error = "Solver failed"; */
     }
 
-    free_solver_state(new_sstate);
     free_solver_state(sstate);
 
     return soln;
@@ -3415,36 +3454,161 @@ static bool boxes_intersect(int x0, int y0, int w0, int h0,
     return (x0 < x1+w1 && x1 < x0+w0 && y0 < y1+h1 && y1 < y0+h0);
 }
 
+/*
+ * The objects we draw are numbered for the spatial index: clues
+ * first (one per face, though only faces with clues are indexed),
+ * then edges, then dots. That's also the order they're drawn in, so
+ * sorting a list of objects puts it in drawing order.
+ */
+#define OBJ_EDGE(g) ((g)->num_faces)
+#define OBJ_DOT(g) ((g)->num_faces + (g)->num_edges)
+#define NOBJS(g) ((g)->num_faces + (g)->num_edges + (g)->num_dots)
+
+static void obj_bins(const game_drawstate *ds, int obj,
+                     int *bx0, int *by0, int *bx1, int *by1)
+{
+    const int *bb = ds->bboxes + 4*obj;
+
+    *bx0 = max(bb[0] / ds->binsize, 0);
+    *by0 = max(bb[1] / ds->binsize, 0);
+    *bx1 = min((bb[0] + bb[2] - 1) / ds->binsize, ds->nbinx - 1);
+    *by1 = min((bb[1] + bb[3] - 1) / ds->binsize, ds->nbiny - 1);
+}
+
+/*
+ * Work out the bounding box of every clue, edge and dot, and sort
+ * them into square bins about the size of a grid square, so that
+ * game_redraw_in_rect can find the objects intersecting its
+ * rectangle without testing every object in the grid. The bins are
+ * stored as one array of objects, with binstart giving where each
+ * bin's list begins.
+ */
+static void build_redraw_index(game_drawstate *ds, const game_state *state)
+{
+    grid *g = state->game_grid;
+    int nobjs = NOBJS(g);
+    int i, nbins, pass;
+    int *pos;
+
+    ds->bboxes = snewn(4 * nobjs, int);
+    for (i = 0; i < g->num_faces; i++) {
+        int *bb = ds->bboxes + 4*i;
+        if (state->clues[i] >= 0)
+            face_text_bbox(ds, g, g->faces[i], &bb[0], &bb[1], &bb[2], &bb[3]);
+        else
+            bb[0] = bb[1] = bb[2] = bb[3] = 0;
+    }
+    for (i = 0; i < g->num_edges; i++) {
+        int *bb = ds->bboxes + 4*(OBJ_EDGE(g) + i);
+        edge_bbox(ds, g, g->edges[i], &bb[0], &bb[1], &bb[2], &bb[3]);
+    }
+    for (i = 0; i < g->num_dots; i++) {
+        int *bb = ds->bboxes + 4*(OBJ_DOT(g) + i);
+        dot_bbox(ds, g, g->dots[i], &bb[0], &bb[1], &bb[2], &bb[3]);
+    }
+
+    ds->binsize = max(ds->tilesize, 1);
+    ds->nbinx = 1 + (int)((long)(g->highest_x - g->lowest_x) * ds->tilesize /
+                          g->tilesize + 2 * BORDER(ds->tilesize)) /
+        ds->binsize;
+    ds->nbiny = 1 + (int)((long)(g->highest_y - g->lowest_y) * ds->tilesize /
+                          g->tilesize + 2 * BORDER(ds->tilesize)) /
+        ds->binsize;
+    nbins = ds->nbinx * ds->nbiny;
+
+    /*
+     * Two passes: count the objects in each bin, then (having turned
+     * the counts into start positions) fill them in.
+     */
+    ds->binstart = snewn(nbins + 1, int);
+    for (i = 0; i <= nbins; i++)
+        ds->binstart[i] = 0;
+    pos = NULL;
+    for (pass = 0; pass < 2; pass++) {
+        for (i = 0; i < nobjs; i++) {
+            int bx0, by0, bx1, by1, bx, by;
+            if (ds->bboxes[4*i+2] <= 0)
+                continue;
+            obj_bins(ds, i, &bx0, &by0, &bx1, &by1);
+            for (by = by0; by <= by1; by++)
+                for (bx = bx0; bx <= bx1; bx++) {
+                    int b = by * ds->nbinx + bx;
+                    if (pass == 0)
+                        ds->binstart[b+1]++;
+                    else
+                        ds->binobjs[pos[b]++] = i;
+                }
+        }
+        if (pass == 0) {
+            for (i = 0; i < nbins; i++)
+                ds->binstart[i+1] += ds->binstart[i];
+            ds->binobjs = snewn(max(ds->binstart[nbins], 1), int);
+            pos = snewn(nbins, int);
+            memcpy(pos, ds->binstart, nbins * sizeof(int));
+        }
+    }
+    sfree(pos);
+
+    ds->seen = snewn(nobjs, unsigned);
+    for (i = 0; i < nobjs; i++)
+        ds->seen[i] = 0;
+    ds->stamp = 0;
+    ds->objs = snewn(nobjs, int);
+}
+
 static void game_redraw_in_rect(drawing *dr, game_drawstate *ds,
                                 const game_ui *ui, const game_state *state,
                                 int x, int y, int w, int h)
 {
     grid *g = state->game_grid;
-    int i, phase;
-    int bx, by, bw, bh;
+    int i, phase, nobjs;
+    int bx0, by0, bx1, by1, bx, by;
 
     clip(dr, x, y, w, h);
     draw_rect(dr, x, y, w, h, COL_BACKGROUND);
 
-    for (i = 0; i < g->num_faces; i++) {
-        if (state->clues[i] >= 0) {
-            face_text_bbox(ds, g, g->faces[i], &bx, &by, &bw, &bh);
-            if (boxes_intersect(x, y, w, h, bx, by, bw, bh))
-                game_redraw_clue(dr, ds, state, i);
+    /*
+     * Find everything intersecting the rectangle, from the bins it
+     * covers. An object can be in several of those, so mark each
+     * one found with the current stamp.
+     */
+    if (++ds->stamp == 0) {
+        for (i = 0; i < NOBJS(g); i++)
+            ds->seen[i] = 0;
+        ds->stamp = 1;
+    }
+    nobjs = 0;
+    bx0 = max(x / ds->binsize, 0);
+    by0 = max(y / ds->binsize, 0);
+    bx1 = min((x + w - 1) / ds->binsize, ds->nbinx - 1);
+    by1 = min((y + h - 1) / ds->binsize, ds->nbiny - 1);
+    for (by = by0; by <= by1; by++)
+        for (bx = bx0; bx <= bx1; bx++) {
+            int b = by * ds->nbinx + bx;
+            for (i = ds->binstart[b]; i < ds->binstart[b+1]; i++) {
+                int obj = ds->binobjs[i];
+                const int *bb = ds->bboxes + 4*obj;
+                if (ds->seen[obj] != ds->stamp &&
+                    boxes_intersect(x, y, w, h, bb[0], bb[1], bb[2], bb[3])) {
+                    ds->seen[obj] = ds->stamp;
+                    ds->objs[nobjs++] = obj;
+                }
+            }
         }
-    }
+    qsort(ds->objs, nobjs, sizeof(int), compare_integers);
+
+    for (i = 0; i < nobjs && ds->objs[i] < OBJ_EDGE(g); i++)
+        game_redraw_clue(dr, ds, state, ds->objs[i]);
     for (phase = 0; phase < NPHASES; phase++) {
-        for (i = 0; i < g->num_edges; i++) {
-            edge_bbox(ds, g, g->edges[i], &bx, &by, &bw, &bh);
-            if (boxes_intersect(x, y, w, h, bx, by, bw, bh))
-                game_redraw_line(dr, ds, ui, state, i, phase);
-        }
-    }
-    for (i = 0; i < g->num_dots; i++) {
-        dot_bbox(ds, g, g->dots[i], &bx, &by, &bw, &bh);
-        if (boxes_intersect(x, y, w, h, bx, by, bw, bh))
-            game_redraw_dot(dr, ds, state, i);
+        int j;
+        for (j = i; j < nobjs && ds->objs[j] < OBJ_DOT(g); j++)
+            game_redraw_line(dr, ds, ui, state,
+                             ds->objs[j] - OBJ_EDGE(g), phase);
     }
+    while (i < nobjs && ds->objs[i] < OBJ_DOT(g))
+        i++;
+    for (; i < nobjs; i++)
+        game_redraw_dot(dr, ds, state, ds->objs[i] - OBJ_DOT(g));
 
     unclip(dr);
     draw_update(dr, x, y, w, h);
@@ -3455,16 +3619,19 @@ static void game_redraw(drawing *dr, game_drawstate *ds,
                         int dir, const game_ui *ui,
                         float animtime, float flashtime)
 {
-#define REDRAW_OBJECTS_LIMIT 16		/* Somewhat arbitrary tradeoff */
-
     grid *g = state->game_grid;
     int border = BORDER(ds->tilesize);
     int i;
     bool flash_changed;
     bool redraw_everything = false;
 
-    int edges[REDRAW_OBJECTS_LIMIT], nedges = 0;
-    int faces[REDRAW_OBJECTS_LIMIT], nfaces = 0;
+    /*
+     * Redrawing an object's rectangle redraws a dozen or so objects,
+     * so past about this many it's cheaper to redraw everything.
+     */
+    int limit = max(16, (g->num_edges + g->num_faces) / 12);
+    int *faces = ds->changed, nfaces = 0;
+    int *edges = ds->changed + g->num_faces, nedges = 0;
 
     /* Redrawing is somewhat involved.
      *
@@ -3480,7 +3647,10 @@ static void game_redraw(drawing *dr, game_drawstate *ds,
      * it with background, and then redraw (a plausible but conservative
      * guess at) the objects which intersect the rectangle; if several
      * objects need redrawing, we'll do them individually.  However, if lots
-     * of objects are affected, we'll just redraw everything.
+     * of objects are affected, we'll just redraw everything.  Finding the
+     * objects in a rectangle uses a spatial index (see build_redraw_index),
+     * so the cost of a redraw depends on how much changed rather than on
+     * the size of the grid.
      *
      * The reason for all of this is that it's just not safe to do the redraw
      * piecemeal.  If you try to draw an antialiased diagonal line over
@@ -3491,6 +3661,9 @@ static void game_redraw(drawing *dr, game_drawstate *ds,
      * what needs doing, and the second actually does it.
      */
 
+    if (!ds->bboxes)
+        build_redraw_index(ds, state);
+
     if (!ds->started) {
 	redraw_everything = true;
         /*
@@ -3555,10 +3728,7 @@ static void game_redraw(drawing *dr, game_drawstate *ds,
             clue_satisfied != ds->clue_satisfied[i]) {
             ds->clue_error[i] = clue_mistake;
             ds->clue_satisfied[i] = clue_satisfied;
-            if (nfaces == REDRAW_OBJECTS_LIMIT)
-                redraw_everything = true;
-            else
-                faces[nfaces++] = i;
+            faces[nfaces++] = i;
         }
     }
 
@@ -3580,14 +3750,13 @@ static void game_redraw(drawing *dr, game_drawstate *ds,
         if (new_ds != ds->lines[i] ||
             (flash_changed && state->lines[i] == LINE_YES)) {
             ds->lines[i] = new_ds;
-            if (nedges == REDRAW_OBJECTS_LIMIT)
-                redraw_everything = true;
-            else
-                edges[nedges++] = i;
+            edges[nedges++] = i;
         }
     }
 
     /* Pass one is now done.  Now we do the actual drawing. */
+    if (nfaces + nedges > limit)
+        redraw_everything = true;
     if (redraw_everything) {
         int grid_width = g->highest_x - g->lowest_x;
         int grid_height = g->highest_y - g->lowest_y;
@@ -3763,7 +3932,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     get_prefs, set_prefs,
     new_ui,
@@ -3787,7 +3960,7 @@ const struct game thegame = {
     true, false, game_print_size, game_print,
     false /* wants_statusbar */,
     false, NULL,                       /* timing_state */
-    STYLUS_SUPPORT,                          /* mouse_priorities */
+    STYLUS_SUPPORT | SOLVE_FROM_ORIG,                          /* mouse_priorities */
 };
 
 #ifdef STANDALONE_SOLVER
@@ -3859,19 +4032,17 @@ int main(int argc, char **argv)
      */
     ret = -1;			       /* placate optimiser */
     for (diff = 0; diff < DIFF_MAX; diff++) {
-	solver_state *sstate_new;
 	solver_state *sstate = new_solver_state((game_state *)s, diff);
 
-	sstate_new = solve_game_rec(sstate);
+	solve_game_rec(sstate);
 
-	if (sstate_new->solver_status == SOLVER_MISTAKE)
+	if (sstate->solver_status == SOLVER_MISTAKE)
 	    ret = 0;
-	else if (sstate_new->solver_status == SOLVER_SOLVED)
+	else if (sstate->solver_status == SOLVER_SOLVED)
 	    ret = 1;
 	else
 	    ret = 2;
 
-	free_solver_state(sstate_new);
 	free_solver_state(sstate);
 
 	if (ret < 2)
@@ -3890,25 +4061,23 @@ int main(int argc, char **argv)
 	    else if (ret == 1)
 		printf("Difficulty rating: %s\n", diffnames[diff]);
 	} else {
-	    solver_state *sstate_new;
 	    solver_state *sstate = new_solver_state((game_state *)s, diff);
 
 	    /* If we supported a verbose solver, we'd set verbosity here */
 
-	    sstate_new = solve_game_rec(sstate);
+	    solve_game_rec(sstate);
 
-	    if (sstate_new->solver_status == SOLVER_MISTAKE)
+	    if (sstate->solver_status == SOLVER_MISTAKE)
 		printf("Puzzle is inconsistent\n");
 	    else {
-		assert(sstate_new->solver_status == SOLVER_SOLVED);
+		assert(sstate->solver_status == SOLVER_SOLVED);
 		if (s->grid_type == 0) {
-		    fputs(game_text_format(sstate_new->state), stdout);
+		    fputs(game_text_format(sstate->state), stdout);
 		} else {
 		    printf("Unable to output non-square grids\n");
 		}
 	    }
 
-	    free_solver_state(sstate_new);
 	    free_solver_state(sstate);
 	}
     }
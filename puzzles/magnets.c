@@ -808,6 +808,109 @@ static int check_completion(game_state *state)
 static const int dx[4] = {-1, 1, 0, 0};
 static const int dy[4] = {0, 0, -1, 1};
 
+/*
+ * The solver's deductions run on a propagator (see propagate.c), so
+ * that each of them only looks again at the squares and rows/columns
+ * where it might find something new. They're listed here in the order
+ * the propagator prefers them; the tricky ones start at
+ * RULE_ADVANCEDFULL.
+ *
+ * RULE_FORCE looks again at a square when it changes, and
+ * RULE_NEITHER at both squares of its domino. The line deductions
+ * look at rows and columns, numbered as lines: column x is line x,
+ * and row y is line w+y.
+ */
+enum {
+    RULE_FORCE, RULE_NEITHER,
+    RULE_CHECKFULL, RULE_ODDLENGTH,
+    RULE_ADVANCEDFULL, RULE_NONNEUTRAL,
+    RULE_COUNTDOMINOES_N, RULE_COUNTDOMINOES_NN,
+    NRULES
+};
+
+struct solver_scratch {
+    int w, h, wh;
+    game_state *state;          /* being solved, for the rules */
+    propagator *prop;
+    int *counts;                /* size 3*(w+h): set squares of each
+                                 * colour in each line */
+};
+
+static int solve_force(void *vsc, int rule, int i);
+static int solve_neither(void *vsc, int rule, int i);
+static int solve_line(void *vsc, int rule, int line);
+
+/* Get ready to solve a state (which must have the same dominoes as
+ * the one the scratch was made for), from the flags it has now. */
+static void solver_scratch_reset(struct solver_scratch *sc,
+                                 game_state *state)
+{
+    int i, line, w = sc->w, h = sc->h;
+
+    sc->state = state;
+    propagate_reset(sc->prop);
+    memset(sc->counts, 0, 3*(w+h) * sizeof(int));
+    for (i = 0; i < sc->wh; i++) {
+        if (state->flags[i] & GS_SET) {
+            for (line = i%w; line < w+h; line = w + i/w) {
+                sc->counts[line*3 + state->grid[i]]++;
+                if (line >= w) break;
+            }
+        }
+    }
+}
+
+static struct solver_scratch *solver_scratch_new(game_state *state)
+{
+    struct solver_scratch *sc = snew(struct solver_scratch);
+    int i, w = state->w, h = state->h, wh = state->wh;
+    int squares, dominoes, lines;
+
+    sc->w = w;
+    sc->h = h;
+    sc->wh = wh;
+    sc->counts = snewn(3*(w+h), int);
+
+    sc->prop = propagate_new(wh);
+    squares = propagate_add_type(sc->prop, wh);
+    dominoes = propagate_add_type(sc->prop, wh);
+    lines = propagate_add_type(sc->prop, w+h);
+    propagate_add_rule(sc->prop, "forced by flags", squares, solve_force);
+    propagate_add_rule(sc->prop, "neither tile magnet", dominoes,
+                       solve_neither);
+    propagate_add_rule(sc->prop, "row/col full", lines, solve_line);
+    propagate_add_rule(sc->prop, "odd length", lines, solve_line);
+    propagate_add_rule(sc->prop, "advanced full", lines, solve_line);
+    propagate_add_rule(sc->prop, "non-neutral", lines, solve_line);
+    propagate_add_rule(sc->prop, "count dominoes (neutral)", lines,
+                       solve_line);
+    propagate_add_rule(sc->prop, "count dominoes (non-neutral)", lines,
+                       solve_line);
+
+    for (i = 0; i < wh; i++) {
+        propagate_watch(sc->prop, squares, i, i);
+        propagate_watch(sc->prop, dominoes, i, i);
+        propagate_watch(sc->prop, dominoes, i, state->common->dominoes[i]);
+        propagate_watch(sc->prop, lines, i, i%w);
+        propagate_watch(sc->prop, lines, i, w + i/w);
+    }
+    solver_scratch_reset(sc, state);
+    return sc;
+}
+
+static void solver_scratch_free(struct solver_scratch *sc)
+{
+    propagate_free(sc->prop);
+    sfree(sc->counts);
+    sfree(sc);
+}
+
+/* Note that the flags of square i have changed. */
+static void solve_changed(game_state *state, int i, struct solver_scratch *sc)
+{
+    propagate_changed(sc->prop, i);
+}
+
 static void solve_clearflags(game_state *state)
 {
     int i;
@@ -822,7 +925,8 @@ static void solve_clearflags(game_state *state)
 /* Knowing a given cell cannot be a certain colour also tells us
  * something about the other cell in that domino. */
 static int solve_unflag(game_state *state, int i, int which,
-                        const char *why, rowcol *rc)
+                        const char *why, rowcol *rc,
+                        struct solver_scratch *sc)
 {
     int ii, ret = 0;
 #if defined DEBUGGING || defined STANDALONE_SOLVER
@@ -848,12 +952,14 @@ static int solve_unflag(game_state *state, int i, int which,
     }
     if (POSSIBLE(i, which)) {
         state->flags[i] |= NOTFLAG(which);
+        solve_changed(state, i, sc);
         ret++;
         debug(("solve_unflag: (%d,%d) CANNOT be %s (%s)",
                i%w, i/w, NAME(which), why));
     }
     if (POSSIBLE(ii, OPPOSITE(which))) {
         state->flags[ii] |= NOTFLAG(OPPOSITE(which));
+        solve_changed(state, ii, sc);
         ret++;
         debug(("solve_unflag: (%d,%d) CANNOT be %s (%s, other half)",
                ii%w, ii/w, NAME(OPPOSITE(which)), why));
@@ -869,7 +975,8 @@ static int solve_unflag(game_state *state, int i, int which,
     return ret;
 }
 
-static int solve_unflag_surrounds(game_state *state, int i, int which)
+static int solve_unflag_surrounds(game_state *state, int i, int which,
+                                  struct solver_scratch *sc)
 {
     int x = i%state->w, y = i/state->w, xx, yy, j, ii;
 
@@ -880,7 +987,7 @@ static int solve_unflag_surrounds(game_state *state, int i, int which)
         if (!INGRID(state, xx, yy)) continue;
 
         ii = yy*state->w+xx;
-        if (solve_unflag(state, ii, which, "adjacent to set cell", NULL) < 0)
+        if (solve_unflag(state, ii, which, "adjacent to set cell", NULL, sc) < 0)
             return -1;
     }
     return 0;
@@ -889,12 +996,10 @@ static int solve_unflag_surrounds(game_state *state, int i, int which)
 /* Sets a cell to a particular colour, and also perform other
  * housekeeping around that. */
 static int solve_set(game_state *state, int i, int which,
-                     const char *why, rowcol *rc)
+                     const char *why, rowcol *rc,
+                     struct solver_scratch *sc)
 {
-    int ii;
-#if defined DEBUGGING || defined STANDALONE_SOLVER
-    int w = state->w;
-#endif
+    int ii, w = state->w;
 
     ii = state->common->dominoes[i];
 
@@ -936,9 +1041,9 @@ static int solve_set(game_state *state, int i, int which,
            i%w, i/w, NAME(which), why));
 
     if (which != NEUTRAL) {
-        if (solve_unflag_surrounds(state, i, which) < 0)
+        if (solve_unflag_surrounds(state, i, which, sc) < 0)
             return -1;
-        if (solve_unflag_surrounds(state, ii, OPPOSITE(which)) < 0)
+        if (solve_unflag_surrounds(state, ii, OPPOSITE(which), sc) < 0)
             return -1;
     }
 
@@ -948,6 +1053,13 @@ static int solve_set(game_state *state, int i, int which,
     state->flags[i] |= GS_SET;
     state->flags[ii] |= GS_SET;
 
+    sc->counts[(i%w)*3 + which]++;
+    sc->counts[(w + i/w)*3 + which]++;
+    sc->counts[(ii%w)*3 + OPPOSITE(which)]++;
+    sc->counts[(w + ii/w)*3 + OPPOSITE(which)]++;
+    solve_changed(state, i, sc);
+    solve_changed(state, ii, sc);
+
     debug(("solve_set: (%d,%d) set to %s (%s)", i%w, i/w, NAME(which), why));
 
     return 1;
@@ -977,7 +1089,8 @@ static void solve_counts(game_state *state, rowcol rc, int *counts, int *unset)
     }
 }
 
-static int solve_checkfull(game_state *state, rowcol rc, int *counts)
+static int solve_checkfull(game_state *state, rowcol rc, int *counts,
+                           struct solver_scratch *sc)
 {
     int starti = rc.i, j, which, didsth = 0, target;
     int unset[4];
@@ -1006,7 +1119,7 @@ static int solve_checkfull(game_state *state, rowcol rc, int *counts)
                 if (state->flags[rc.i] & GS_SET) continue;
                 if (!POSSIBLE(rc.i, which)) continue;
 
-                if (solve_unflag(state, rc.i, which, "row/col full", &rc) < 0)
+                if (solve_unflag(state, rc.i, which, "row/col full", &rc, sc) < 0)
                     return -1;
                 didsth = 1;
             }
@@ -1017,7 +1130,8 @@ static int solve_checkfull(game_state *state, rowcol rc, int *counts)
                 if (state->flags[rc.i] & GS_SET) continue;
                 if (!POSSIBLE(rc.i, which)) continue;
 
-                if (solve_set(state, rc.i, which, "row/col needs all unset", &rc) < 0)
+                if (solve_set(state, rc.i, which, "row/col needs all unset",
+                              &rc, sc) < 0)
                     return -1;
                 didsth = 1;
             }
@@ -1026,7 +1140,7 @@ static int solve_checkfull(game_state *state, rowcol rc, int *counts)
     return didsth;
 }
 
-static int solve_startflags(game_state *state)
+static int solve_startflags(game_state *state, struct solver_scratch *sc)
 {
     int x, y, i;
 
@@ -1036,7 +1150,8 @@ static int solve_startflags(game_state *state)
             if (state->common->dominoes[i] == i) continue;
             if (state->grid[i] != NEUTRAL ||
                 state->flags[i] & GS_SET) {
-                if (solve_set(state, i, state->grid[i], "initial set-and-hold", NULL) < 0)
+                if (solve_set(state, i, state->grid[i], "initial set-and-hold",
+                              NULL, sc) < 0)
                     return -1;
             }
         }
@@ -1044,81 +1159,53 @@ static int solve_startflags(game_state *state)
     return 0;
 }
 
-typedef int (*rowcolfn)(game_state *state, rowcol rc, int *counts);
-
-static int solve_rowcols(game_state *state, rowcolfn fn)
-{
-    int x, y, didsth = 0, ret;
-    rowcol rc;
-    int counts[4];
-
-    for (x = 0; x < state->w; x++) {
-        rc = mkrowcol(state, x, COLUMN);
-        solve_counts(state, rc, counts, NULL);
-
-        ret = fn(state, rc, counts);
-        if (ret < 0) return ret;
-        didsth += ret;
-    }
-    for (y = 0; y < state->h; y++) {
-        rc = mkrowcol(state, y, ROW);
-        solve_counts(state, rc, counts, NULL);
-
-        ret = fn(state, rc, counts);
-        if (ret < 0) return ret;
-        didsth += ret;
-    }
-    return didsth;
-}
-
-static int solve_force(game_state *state)
+static int solve_force(void *vsc, int rule, int i)
 {
-    int i, which, didsth = 0;
+    struct solver_scratch *sc = (struct solver_scratch *)vsc;
+    game_state *state = sc->state;
+    int which;
     unsigned long f;
 
-    for (i = 0; i < state->wh; i++) {
-        if (state->flags[i] & GS_SET) continue;
-        if (state->common->dominoes[i] == i) continue;
-
-        f = state->flags[i] & GS_NOTMASK;
-        which = -1;
-        if (f == (GS_NOTPOSITIVE|GS_NOTNEGATIVE))
-            which = NEUTRAL;
-        if (f == (GS_NOTPOSITIVE|GS_NOTNEUTRAL))
-            which = NEGATIVE;
-        if (f == (GS_NOTNEGATIVE|GS_NOTNEUTRAL))
-            which = POSITIVE;
-        if (which != -1) {
-            if (solve_set(state, i, which, "forced by flags", NULL) < 0)
-                return -1;
-            didsth = 1;
-        }
-    }
-    return didsth;
+    if (state->flags[i] & GS_SET) return 0;
+    if (state->common->dominoes[i] == i) return 0;
+
+    f = state->flags[i] & GS_NOTMASK;
+    which = -1;
+    if (f == (GS_NOTPOSITIVE|GS_NOTNEGATIVE))
+        which = NEUTRAL;
+    if (f == (GS_NOTPOSITIVE|GS_NOTNEUTRAL))
+        which = NEGATIVE;
+    if (f == (GS_NOTNEGATIVE|GS_NOTNEUTRAL))
+        which = POSITIVE;
+    if (which == -1) return 0;
+    if (solve_set(state, i, which, "forced by flags", NULL, sc) < 0)
+        return -1;
+    return 1;
 }
 
-static int solve_neither(game_state *state)
+static int solve_neither(void *vsc, int rule, int i)
 {
-    int i, j, didsth = 0;
+    struct solver_scratch *sc = (struct solver_scratch *)vsc;
+    game_state *state = sc->state;
+    int j;
 
-    for (i = 0; i < state->wh; i++) {
-        if (state->flags[i] & GS_SET) continue;
-        j = state->common->dominoes[i];
-        if (i == j) continue;
-
-        if (((state->flags[i] & GS_NOTPOSITIVE) &&
-             (state->flags[j] & GS_NOTPOSITIVE)) ||
-            ((state->flags[i] & GS_NOTNEGATIVE) &&
-             (state->flags[j] & GS_NOTNEGATIVE))) {
-            if (solve_set(state, i, NEUTRAL, "neither tile magnet", NULL) < 0)
-                return -1;
-            didsth = 1;
-        }
+    if (state->flags[i] & GS_SET) return 0;
+    j = state->common->dominoes[i];
+    if (i == j) return 0;
+
+    if (((state->flags[i] & GS_NOTPOSITIVE) &&
+         (state->flags[j] & GS_NOTPOSITIVE)) ||
+        ((state->flags[i] & GS_NOTNEGATIVE) &&
+         (state->flags[j] & GS_NOTNEGATIVE))) {
+        if (solve_set(state, i, NEUTRAL, "neither tile magnet", NULL, sc) < 0)
+            return -1;
+        return 1;
     }
-    return didsth;
+    return 0;
 }
 
-static int solve_advancedfull(game_state *state, rowcol rc, int *counts)
+static int solve_advancedfull(game_state *state, rowcol rc, int *counts,
+                              struct solver_scratch *sc)
 {
     int i, j, nfound = 0, ret = 0;
     bool clearpos = false, clearneg = false;
@@ -1181,12 +1268,14 @@ static int solve_advancedfull(game_state *state, rowcol rc, int *counts)
         if (state->flags[i] & GS_MARK) continue;
 
         if (clearpos && !(state->flags[i] & GS_NOTPOSITIVE)) {
-            if (solve_unflag(state, i, POSITIVE, "row/col full (+ve) [tricky]", &rc) < 0)
+            if (solve_unflag(state, i, POSITIVE, "row/col full (+ve) [tricky]",
+                             &rc, sc) < 0)
                 return -1;
             ret++;
         }
         if (clearneg && !(state->flags[i] & GS_NOTNEGATIVE)) {
-            if (solve_unflag(state, i, NEGATIVE, "row/col full (-ve) [tricky]", &rc) < 0)
+            if (solve_unflag(state, i, NEGATIVE, "row/col full (-ve) [tricky]",
+                             &rc, sc) < 0)
                 return -1;
             ret++;
         }
@@ -1197,7 +1286,8 @@ static int solve_advancedfull(game_state *state, rowcol rc, int *counts)
 
 /* If we only have one neutral still to place on a row/column then no
    dominoes entirely in that row/column can be neutral. */
-static int solve_nonneutral(game_state *state, rowcol rc, int *counts)
+static int solve_nonneutral(game_state *state, rowcol rc, int *counts,
+                            struct solver_scratch *sc)
 {
     int i, j, ret = 0;
 
@@ -1209,7 +1299,8 @@ static int solve_nonneutral(game_state *state, rowcol rc, int *counts)
         if (state->common->dominoes[i] != i+rc.di) continue;
 
         if (!(state->flags[i] & GS_NOTNEUTRAL)) {
-            if (solve_unflag(state, i, NEUTRAL, "single neutral in row/col [tricky]", &rc) < 0)
+            if (solve_unflag(state, i, NEUTRAL, "single neutral in row/col [tricky]",
+                             &rc, sc) < 0)
                 return -1;
             ret++;
         }
@@ -1220,7 +1311,8 @@ static int solve_nonneutral(game_state *state, rowcol rc, int *counts)
 /* If we need to fill all unfilled cells with +-, and we need 1 more of
  * one than the other, and we have a single odd-numbered region of unfilled
  * cells, that odd-numbered region must start and end with the extra number. */
-static int solve_oddlength(game_state *state, rowcol rc, int *counts)
+static int solve_oddlength(game_state *state, rowcol rc, int *counts,
+                           struct solver_scratch *sc)
 {
     int i, j, ret = 0, extra, tpos, tneg;
     int start = -1, length = 0, startodd = -1;
@@ -1264,7 +1356,8 @@ static int solve_oddlength(game_state *state, rowcol rc, int *counts)
         startodd = start;
     }
     if (startodd != -1)
-        ret = solve_set(state, startodd, extra, "odd-length section start", &rc);
+        ret = solve_set(state, startodd, extra, "odd-length section start",
+                        &rc, sc);
 
     return ret;
 
@@ -1279,7 +1372,8 @@ twoodd:
 /* Count the number of remaining empty dominoes in any row/col.
  * If that number is equal to the #remaining positive,
  * or to the #remaining negative, no empty cells can be neutral. */
-static int solve_countdominoes_neutral(game_state *state, rowcol rc, int *counts)
+static int solve_countdominoes_neutral(game_state *state, rowcol rc, int *counts,
+                                       struct solver_scratch *sc)
 {
     int i, j, ndom = 0, ret = 0;
     bool nonn = false;
@@ -1312,7 +1406,8 @@ static int solve_countdominoes_neutral(game_state *state, rowcol rc, int *counts
         if (state->flags[i] & GS_SET) continue;
 
         if (!(state->flags[i] & GS_NOTNEUTRAL)) {
-            if (solve_unflag(state, i, NEUTRAL, "all dominoes +/- [tricky]", &rc) < 0)
+            if (solve_unflag(state, i, NEUTRAL, "all dominoes +/- [tricky]",
+                             &rc, sc) < 0)
                 return -1;
             ret++;
         }
@@ -1345,7 +1440,8 @@ static int solve_domino_count(game_state *state, rowcol rc, int i, int which)
 
 /* Count number of dominoes we could put each of + and - into. If it is equal
  * to the #left, any domino we can only put + or - in one cell of must have it. */
-static int solve_countdominoes_nonneutral(game_state *state, rowcol rc, int *counts)
+static int solve_countdominoes_nonneutral(game_state *state, rowcol rc, int *counts,
+                                          struct solver_scratch *sc)
 {
     int which, w, i, j, ndom = 0, didsth = 0, toset;
 
@@ -1370,7 +1466,8 @@ static int solve_countdominoes_nonneutral(game_state *state, rowcol rc, int *cou
                     assert(POSSIBLE(i+rc.di, which));
                     toset = i+rc.di;
                 }
-                if (solve_set(state, toset, which, "all empty dominoes need +/- [tricky]", &rc) < 0)
+                if (solve_set(state, toset, which,
+                              "all empty dominoes need +/- [tricky]", &rc, sc) < 0)
                     return -1;
                 didsth++;
             }
@@ -1381,44 +1478,80 @@ static int solve_countdominoes_nonneutral(game_state *state, rowcol rc, int *cou
 
 /* danger, evil macro. can't use the do { ... } while(0) trick because
  * the continue breaks. */
-#define SOLVE_FOR_ROWCOLS(fn) \
-    ret = solve_rowcols(state, fn); \
-    if (ret < 0) { debug(("%s said impossible, cannot solve", #fn)); return -1; } \
-    if (ret > 0) continue
+typedef int (*rowcolfn)(game_state *state, rowcol rc, int *counts,
+                        struct solver_scratch *sc);
+
+static const rowcolfn line_rules[NRULES] = {
+    NULL, NULL,
+    solve_checkfull, solve_oddlength,
+    solve_advancedfull, solve_nonneutral,
+    solve_countdominoes_neutral, solve_countdominoes_nonneutral,
+};
 
-static int solve_state(game_state *state, int diff)
+/* Run a line deduction on one row or column. */
+static int solve_line(void *vsc, int rule, int line)
+{
+    struct solver_scratch *sc = (struct solver_scratch *)vsc;
+    game_state *state = sc->state;
+    int w = state->w, ret;
+    rowcol rc;
+    int counts[4];
+
+    if (line < w)
+        rc = mkrowcol(state, line, COLUMN);
+    else
+        rc = mkrowcol(state, line - w, ROW);
+    memcpy(counts, sc->counts + line*3, 3 * sizeof(int));
+    counts[3] = 0;
+
+    ret = line_rules[rule](state, rc, counts, sc);
+    if (ret < 0)
+        debug(("%s %d: %s said impossible, cannot solve", rc.name, rc.num,
+               propagate_get_stats(sc->prop, rule)->name));
+    return ret;
+}
+
+/* Solve a state, reusing a scratch made for it (or one with the same
+ * dominoes), as the generator does for each attempt on a layout. */
+static int solve_state_with(game_state *state, int diff,
+                            struct solver_scratch *sc)
 {
     int ret;
 
     debug(("solve_state, difficulty %s", magnets_diffnames[diff]));
 
     solve_clearflags(state);
-    if (solve_startflags(state) < 0) return -1;
-
-    while (1) {
-        ret = solve_force(state);
-        if (ret > 0) continue;
-        if (ret < 0) return -1;
-
-        ret = solve_neither(state);
-        if (ret > 0) continue;
-        if (ret < 0) return -1;
+    solver_scratch_reset(sc, state);
+    ret = solve_startflags(state, sc);
+    if (ret < 0) goto done;
 
-        SOLVE_FOR_ROWCOLS(solve_checkfull);
-        SOLVE_FOR_ROWCOLS(solve_oddlength);
+    ret = propagate_run(sc->prop,
+                        diff < DIFF_TRICKY ? RULE_ADVANCEDFULL : NRULES, sc);
+    if (ret < 0) goto done;
+    ret = check_completion(state);
 
-        if (diff < DIFF_TRICKY) break;
-
-        SOLVE_FOR_ROWCOLS(solve_advancedfull);
-        SOLVE_FOR_ROWCOLS(solve_nonneutral);
-        SOLVE_FOR_ROWCOLS(solve_countdominoes_neutral);
-        SOLVE_FOR_ROWCOLS(solve_countdominoes_nonneutral);
+done:
+#ifdef STANDALONE_SOLVER
+    if (verbose) {
+        int r;
+        for (r = 0; r < NRULES; r++) {
+            const struct propagate_stats *st =
+                propagate_get_stats(sc->prop, r);
+            printf("Rule '%s': %lu calls, %lu fired, %lu deductions\n",
+                   st->name, st->calls, st->fired, st->deductions);
+        }
+    }
+#endif
+    return ret < 0 ? -1 : ret;
+}
 
-        /* more ... */
+static int solve_state(game_state *state, int diff)
+{
+    struct solver_scratch *sc = solver_scratch_new(state);
+    int ret = solve_state_with(state, diff, sc);
 
-        break;
-    }
-    return check_completion(state);
+    solver_scratch_free(sc);
+    return ret;
 }
 
 
@@ -1501,20 +1634,12 @@ solved:
     return move;
 }
 
-static int solve_unnumbered(game_state *state)
+static int solve_unnumbered(game_state *state, struct solver_scratch *sc)
 {
-    int i, ret;
-    while (1) {
-        ret = solve_force(state);
-        if (ret > 0) continue;
-        if (ret < 0) return -1;
-
-        ret = solve_neither(state);
-        if (ret > 0) continue;
-        if (ret < 0) return -1;
+    int i;
 
-        break;
-    }
+    /* Just the square deductions: nothing is numbered yet. */
+    if (propagate_run(sc->prop, RULE_CHECKFULL, sc) < 0) return -1;
     for (i = 0; i < state->wh; i++) {
         if (!(state->flags[i] & GS_SET)) return 0;
     }
@@ -1523,6 +1648,7 @@ static int solve_unnumbered(game_state *state)
 
 static int lay_dominoes(game_state *state, random_state *rs, int *scratch)
 {
+    struct solver_scratch *sc;
     int n, i, ret = 0, nlaid = 0, n_initial_neutral;
 
     for (i = 0; i < state->wh; i++) {
@@ -1531,6 +1657,7 @@ static int lay_dominoes(game_state *state, random_state *rs, int *scratch)
         state->flags[i] = (state->common->dominoes[i] == i) ? GS_SET : 0;
     }
     shuffle(scratch, state->wh, sizeof(int), rs);
+    sc = solver_scratch_new(state);
 
     n_initial_neutral = (state->wh > 100) ? 5 : (state->wh / 10);
 
@@ -1564,15 +1691,15 @@ static int lay_dominoes(game_state *state, random_state *rs, int *scratch)
 
         if (n < n_initial_neutral) {
             debug(("  ...laying neutral\n"));
-            ret = solve_set(state, i, NEUTRAL, "layout initial neutral", NULL);
+            ret = solve_set(state, i, NEUTRAL, "layout initial neutral", NULL, sc);
         } else {
             debug(("  ... preferring magnet\n"));
             if (!(state->flags[i] & GS_NOTPOSITIVE))
-                ret = solve_set(state, i, POSITIVE, "layout", NULL);
+                ret = solve_set(state, i, POSITIVE, "layout", NULL, sc);
             else if (!(state->flags[i] & GS_NOTNEGATIVE))
-                ret = solve_set(state, i, NEGATIVE, "layout", NULL);
+                ret = solve_set(state, i, NEGATIVE, "layout", NULL, sc);
             else
-                ret = solve_set(state, i, NEUTRAL, "layout", NULL);
+                ret = solve_set(state, i, NEUTRAL, "layout", NULL, sc);
         }
         if (!ret) {
             debug(("Unable to lay anything at (%d,%d), giving up.",
@@ -1582,20 +1709,23 @@ static int lay_dominoes(game_state *state, random_state *rs, int *scratch)
         }
 
         nlaid++;
-        ret = solve_unnumbered(state);
+        ret = solve_unnumbered(state, sc);
         if (ret == -1)
             debug(("solve_unnumbered decided impossible.\n"));
         if (ret != 0)
             break;
     }
 
+    solver_scratch_free(sc);
+
     debug(("Laid %d dominoes, total %d dominoes.\n", nlaid, state->wh/2));
     (void)nlaid;
     game_debug(state, "Final layout");
     return ret;
 }
 
-static void gen_game(game_state *new, random_state *rs)
+static void gen_game(game_state *new, domino_layout_ctx *layout,
+                     random_state *rs)
 {
     int ret, x, y, val;
     int *scratch = snewn(new->wh, int);
@@ -1605,8 +1735,8 @@ static void gen_game(game_state *new, random_state *rs)
 #endif
 
     clear_state(new);
-    sfree(new->common->dominoes); /* bit grotty. */
-    new->common->dominoes = domino_layout(new->w, new->h, rs);
+    memcpy(new->common->dominoes, domino_layout_next(layout, rs),
+           new->wh*sizeof(int));
 
     do {
         ret = lay_dominoes(new, rs, scratch);
@@ -1638,22 +1768,26 @@ static void generate_aux(game_state *new, char *aux)
 static int check_difficulty(const game_params *params, game_state *new,
                             random_state *rs)
 {
-    int *scratch, *grid_correct, slen, i;
+    int *scratch, *grid_correct, slen, i, ret = 0;
+    struct solver_scratch *sc;
 
     memset(new->grid, EMPTY, new->wh*sizeof(int));
+    sc = solver_scratch_new(new);
 
     if (params->diff > DIFF_EASY) {
         /* If this is too easy, return. */
-        if (solve_state(new, params->diff-1) > 0) {
+        if (solve_state_with(new, params->diff-1, sc) > 0) {
             debug(("Puzzle is too easy."));
-            return -1;
+            ret = -1;
+            goto done;
         }
     }
-    if (solve_state(new, params->diff) <= 0) {
+    if (solve_state_with(new, params->diff, sc) <= 0) {
         debug(("Puzzle is not soluble at requested difficulty."));
-        return -1;
+        ret = -1;
+        goto done;
     }
-    if (!params->stripclues) return 0;
+    if (!params->stripclues) goto done;
 
     /* Copy the correct grid away. */
     grid_correct = snewn(new->wh, int);
@@ -1668,7 +1802,7 @@ static int check_difficulty(const game_params *params, game_state *new,
     /* For each clue, check whether removing it makes the puzzle unsoluble;
      * put it back if so. */
     for (i = 0; i < slen; i++) {
-        int num = scratch[i], which, roworcol, target, targetn, ret;
+        int num = scratch[i], which, roworcol, target, targetn, sret;
         rowcol rc;
 
         /* work out which clue we meant. */
@@ -1690,10 +1824,10 @@ static int check_difficulty(const game_params *params, game_state *new,
         /* ...and see if we can still solve it. */
         game_debug(new, "removed clue, new board:");
         memset(new->grid, EMPTY, new->wh * sizeof(int));
-        ret = solve_state(new, params->diff);
-        assert(ret != -1);
+        sret = solve_state_with(new, params->diff, sc);
+        assert(sret != -1);
 
-        if (ret == 0 ||
+        if (sret == 0 ||
             memcmp(new->grid, grid_correct, new->wh*sizeof(int)) != 0) {
             /* We made it ambiguous: put clue back. */
             debug(("...now impossible/different, put clue back."));
@@ -1704,7 +1838,9 @@ static int check_difficulty(const game_params *params, game_state *new,
     sfree(scratch);
     sfree(grid_correct);
 
-    return 0;
+done:
+    solver_scratch_free(sc);
+    return ret;
 }
 
 static char *new_game_desc(const game_params *params, random_state *rs,
@@ -1712,9 +1848,10 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 {
     game_state *new = new_state(params->w, params->h);
     char *desc, *aux = snewn(new->wh+1, char);
+    domino_layout_ctx *layout = domino_layout_new_ctx(params->w, params->h);
 
     do {
-        gen_game(new, rs);
+        gen_game(new, layout, rs);
         generate_aux(new, aux);
     } while (check_difficulty(params, new, rs) < 0);
 
@@ -1723,6 +1860,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     desc = generate_desc(new);
 
     free_game(new);
+    domino_layout_free_ctx(layout);
 
     *aux_r = aux;
     return desc;
@@ -2462,7 +2600,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
@@ -2518,6 +2660,7 @@ static void start_soak(game_params *p, random_state *rs)
     time_t tt_start, tt_now, tt_last;
     char *aux;
     game_state *s, *s2;
+    domino_layout_ctx *layout;
     int n = 0, nsolved = 0, nimpossible = 0, ntricky = 0, ret, i;
     long nn, nn_total = 0, nn_solved = 0, nn_tricky = 0;
 
@@ -2531,9 +2674,10 @@ static void start_soak(game_params *p, random_state *rs)
 
     s = new_state(p->w, p->h);
     aux = snewn(s->wh+1, char);
+    layout = domino_layout_new_ctx(p->w, p->h);
 
     while (1) {
-        gen_game(s, rs);
+        gen_game(s, layout, rs);
 
         nn = 0;
         for (i = 0; i < s->wh; i++) {
@@ -2593,6 +2737,7 @@ static void start_soak(game_params *p, random_state *rs)
     }
     free_game(s);
     sfree(aux);
+    domino_layout_free_ctx(layout);
 }
 
 int main(int argc, char *argv[])
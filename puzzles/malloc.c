@@ -1,14 +1,74 @@
 /*
- * malloc.c: safe wrappers around malloc, realloc, free, strdup
+ * malloc.c: safe wrappers around malloc, realloc, free, strdup, and
+ * scratch arenas
  */
 
 #ifndef NO_STDINT_H
 #include <stdint.h>
 #endif
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include "puzzles.h"
 
+/*
+ * Memory statistics. With MEMORY_STATS defined, each allocation is
+ * preceded by a header giving its size, so that sfree and srealloc
+ * can keep the count of live bytes. (So everything allocated here
+ * must be freed here, and vice versa.) The counts aren't protected
+ * against parallel_run's threads, so are only exact without them.
+ */
+#ifdef MEMORY_STATS
+union memory_header {
+    size_t size;
+    long l;
+    double d;
+    void *p;
+};
+#define MEMORY_HEADER (sizeof(union memory_header))
+
+static memory_stats stats;
+
+static void *memory_stats_alloc(void *p, size_t size)
+{
+    union memory_header *h = (union memory_header *)p;
+    h->size = size;
+    stats.live += size;
+    if (stats.live > stats.peak)
+        stats.peak = stats.live;
+    return h + 1;
+}
+#else
+#define MEMORY_HEADER 0
+#endif
+
+bool memory_stats_enabled(void)
+{
+#ifdef MEMORY_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void memory_stats_get(memory_stats *out)
+{
+#ifdef MEMORY_STATS
+    *out = stats;
+#else
+    out->live = out->peak = 0;
+    out->allocs = 0;
+#endif
+}
+
+void memory_stats_reset(void)
+{
+#ifdef MEMORY_STATS
+    stats.peak = stats.live;
+    stats.allocs = 0;
+#endif
+}
+
 /*
  * smalloc should guarantee to return a useful pointer - we
  * can do nothing except die when it's out of memory anyway.
@@ -16,12 +76,16 @@
 void *smalloc(size_t size) {
     void *p;
 #ifdef PTRDIFF_MAX
-    if (size > PTRDIFF_MAX)
+    if (size > PTRDIFF_MAX - MEMORY_HEADER)
 	fatal("allocation too large");
 #endif
-    p = malloc(size);
+    p = malloc(size + MEMORY_HEADER);
     if (!p)
 	fatal("out of memory");
+#ifdef MEMORY_STATS
+    stats.allocs++;
+    p = memory_stats_alloc(p, size);
+#endif
     return p;
 }
 
@@ -30,6 +94,11 @@ void *smalloc(size_t size) {
  */
 void sfree(void *p) {
     if (p) {
+#ifdef MEMORY_STATS
+	union memory_header *h = (union memory_header *)p - 1;
+	stats.live -= h->size;
+	p = h;
+#endif
 	free(p);
     }
 }
@@ -40,16 +109,27 @@ void sfree(void *p) {
 void *srealloc(void *p, size_t size) {
     void *q;
 #ifdef PTRDIFF_MAX
-    if (size > PTRDIFF_MAX)
+    if (size > PTRDIFF_MAX - MEMORY_HEADER)
 	fatal("allocation too large");
 #endif
     if (p) {
-	q = realloc(p, size);
+#ifdef MEMORY_STATS
+	union memory_header *h = (union memory_header *)p - 1;
+	stats.live -= h->size;
+	p = h;
+#endif
+	q = realloc(p, size + MEMORY_HEADER);
     } else {
-	q = malloc(size);
+#ifdef MEMORY_STATS
+	stats.allocs++;
+#endif
+	q = malloc(size + MEMORY_HEADER);
     }
     if (!q)
 	fatal("out of memory");
+#ifdef MEMORY_STATS
+    q = memory_stats_alloc(q, size);
+#endif
     return q;
 }
 
@@ -62,3 +142,104 @@ char *dupstr(const char *s) {
     strcpy(r,s);
     return r;
 }
+
+/*
+ * Arenas. An arena is a chain of blocks, filled in order; 'cur' is
+ * the block currently being allocated from, or NULL if nothing has
+ * been allocated since the last reset, and 'used' is how much of it
+ * is taken. Restoring a mark just winds those two back, leaving any
+ * later blocks in the chain to be refilled.
+ */
+#define ARENA_BLOCK_SIZE 16384
+
+/* Alignment good enough for anything we allocate. */
+union arena_align {
+    long l;
+    double d;
+    void *p;
+};
+#define ARENA_ALIGN (sizeof(union arena_align))
+
+struct arena_block {
+    struct arena_block *next;
+    size_t size;
+    union arena_align data[1];         /* really 'size' bytes */
+};
+
+struct arena {
+    struct arena_block *first, *cur;
+    size_t used;
+};
+
+arena *arena_new(void)
+{
+    arena *a = snew(arena);
+    a->first = a->cur = NULL;
+    a->used = 0;
+    return a;
+}
+
+void arena_free(arena *a)
+{
+    struct arena_block *b, *next;
+
+    if (!a)
+        return;
+    for (b = a->first; b; b = next) {
+        next = b->next;
+        sfree(b);
+    }
+    sfree(a);
+}
+
+void *arena_alloc(arena *a, size_t size)
+{
+    struct arena_block **link;
+    void *ret;
+
+    size = (size + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+    if (!size)
+        size = ARENA_ALIGN;
+
+    if (!a->cur || a->cur->size - a->used < size) {
+        /*
+         * Move on to the next block in the chain, if there is one
+         * and this fits in it, or else put a new block there.
+         */
+        link = a->cur ? &a->cur->next : &a->first;
+        if (!*link || (*link)->size < size) {
+            size_t bsize = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+            struct arena_block *b = smalloc(
+                offsetof(struct arena_block, data) + bsize);
+            b->size = bsize;
+            b->next = *link;
+            *link = b;
+        }
+        a->cur = *link;
+        a->used = 0;
+    }
+
+    ret = (char *)a->cur->data + a->used;
+    a->used += size;
+    return ret;
+}
+
+arena_mark arena_save(const arena *a)
+{
+    arena_mark mark;
+    mark.block = a->cur;
+    mark.used = a->used;
+    return mark;
+}
+
+void arena_restore(arena *a, arena_mark mark)
+{
+    a->cur = mark.block;
+    a->used = mark.used;
+}
+
+void arena_reset(arena *a)
+{
+    a->cur = NULL;
+    a->used = 0;
+}
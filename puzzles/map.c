@@ -446,28 +446,27 @@ static int extend_options(int w, int h, int n, int *map,
         }
 
     /*
-     * Iterate over each colour that might be feasible.
-     * 
-     * FIXME: this routine currently has O(n) running time. We
-     * could turn it into O(FOUR) by only bothering to iterate over
-     * the colours mentioned in the four neighbouring squares.
+     * Iterate over each colour that might be feasible. Only the
+     * colours of the orthogonal neighbours (the even indices of col)
+     * can be: this square is not adjacent to any other region, and
+     * so obviously cannot become an extension of it at this time.
+     * We take them in ascending order, so that each index maps to
+     * the same colour as it would if we tried every colour in turn.
      */
+    for (c = -1;;) {
+        int count, neighbours, runs, next = n;
 
-    for (c = 0; c < n; c++) {
-        int count, neighbours, runs;
+        for (i = 0; i < 8; i += 2)
+            if (col[i] > c && col[i] < next)
+                next = col[i];
+        if (next == n)
+            break;
+        c = next;
 
-        /*
-         * One of the even indices of col (representing the
-         * orthogonal neighbours of this square) must be equal to
-         * c, or else this square is not adjacent to region c and
-         * obviously cannot become an extension of it at this time.
-         */
         neighbours = 0;
         for (i = 0; i < 8; i += 2)
             if (col[i] == c)
                 neighbours++;
-        if (!neighbours)
-            continue;
 
         /*
          * Now we know this square is adjacent to region c. The
@@ -827,6 +826,16 @@ struct solver_scratch {
     int n;
     int ngraph;
 
+    /*
+     * The graph again, in forms quicker to query than the sorted
+     * edge list: where each region's edges start in it (with
+     * start[n] == ngraph), and an n-by-n adjacency bitmatrix, with
+     * adjwords words per row.
+     */
+    int *start;
+    unsigned *adjacent;
+    int adjwords;
+
     int *bfsqueue;
     int *bfscolour;
 #ifdef SOLVER_DIAGNOSTICS
@@ -834,18 +843,48 @@ struct solver_scratch {
 #endif
 
     int depth;
+
+    /*
+     * How to search when deduction runs out (see map_search). If
+     * this is false, we recurse into map_solver itself instead,
+     * which is slower but makes every deduction it can at every
+     * guess; the two always find the same number of solutions.
+     */
+    bool backjump;
+    struct search_scratch *search;     /* allocated on first use */
 };
 
+#define ADJ_WORD_BITS (8 * (int)sizeof(unsigned))
+
+#define scratch_adjacent(sc, i, j) \
+    ((sc)->adjacent[(i) * (sc)->adjwords + (j) / ADJ_WORD_BITS] & \
+     (1U << ((j) % ADJ_WORD_BITS)))
+
 static struct solver_scratch *new_scratch(int *graph, int n, int ngraph)
 {
     struct solver_scratch *sc;
+    int i, j;
 
     sc = snew(struct solver_scratch);
     sc->graph = graph;
     sc->n = n;
     sc->ngraph = ngraph;
+    sc->start = snewn(n+1, int);
+    sc->adjwords = (n + ADJ_WORD_BITS - 1) / ADJ_WORD_BITS;
+    sc->adjacent = snewn(n * sc->adjwords, unsigned);
+    memset(sc->adjacent, 0, n * sc->adjwords * sizeof(unsigned));
+    for (i = j = 0; i <= n; i++) {
+        sc->start[i] = j;
+        for (; j < ngraph && graph[j] < n*(i+1); j++) {
+            int k = graph[j] - i*n;
+            sc->adjacent[i * sc->adjwords + k / ADJ_WORD_BITS] |=
+                1U << (k % ADJ_WORD_BITS);
+        }
+    }
     sc->possible = snewn(n, unsigned char);
     sc->depth = 0;
+    sc->backjump = true;
+    sc->search = NULL;
     sc->bfsqueue = snewn(n, int);
     sc->bfscolour = snewn(n, int);
 #ifdef SOLVER_DIAGNOSTICS
@@ -855,9 +894,15 @@ static struct solver_scratch *new_scratch(int *graph, int n, int ngraph)
     return sc;
 }
 
+static void free_search_scratch(struct search_scratch *ss);
+
 static void free_scratch(struct solver_scratch *sc)
 {
+    if (sc->search)
+        free_search_scratch(sc->search);
     sfree(sc->possible);
+    sfree(sc->start);
+    sfree(sc->adjacent);
     sfree(sc->bfsqueue);
     sfree(sc->bfscolour);
 #ifdef SOLVER_DIAGNOSTICS
@@ -888,7 +933,7 @@ static bool place_colour(struct solver_scratch *sc,
 #endif
                          )
 {
-    int *graph = sc->graph, n = sc->n, ngraph = sc->ngraph;
+    int *graph = sc->graph, n = sc->n;
     int j, k;
 
     if (!(sc->possible[index] & (1 << colour))) {
@@ -912,8 +957,7 @@ static bool place_colour(struct solver_scratch *sc,
     /*
      * Rule out this colour from all the region's neighbours.
      */
-    for (j = graph_vertex_start(graph, n, ngraph, index);
-	 j < ngraph && graph[j] < n*(index+1); j++) {
+    for (j = sc->start[index]; j < sc->start[index+1]; j++) {
 	k = graph[j] - index*n;
 #ifdef SOLVER_DIAGNOSTICS
         if (verbose && (sc->possible[k] & (1 << colour)))
@@ -943,6 +987,245 @@ static char *colourset(char *buf, int set)
 }
 #endif
 
+/*
+ * Search for solutions once deduction has run out, by forward
+ * checking with conflict-directed backjumping.
+ *
+ * Regions are coloured one per level of the search, choosing each
+ * time the one with fewest possible colours left, and of those the
+ * one with most neighbours (the DSATUR order). Colouring a region
+ * rules its colour out of its uncoloured neighbours, remembering
+ * which level did it, and if that leaves a neighbour with no colours
+ * at all we try the next colour instead.
+ *
+ * When a region runs out of colours to try, the levels to blame are
+ * those which ruled colours out of it, plus those blamed for the
+ * failures of the colours it did try. Changing any level in between
+ * can't help, so we jump straight back to the latest level to blame,
+ * and it inherits the rest of the blame. Having found a solution,
+ * though, every level is to blame for our not finding another one
+ * right away, so from then on we only ever go back one level at a
+ * time.
+ *
+ * All the sets of levels are bitmaps. 'prunedby' records which
+ * level ruled each colour out of each region, or is -1; the trail
+ * records each such ruling in the order they were made, so that a
+ * level can undo its own.
+ */
+struct search_scratch {
+    int n, words;                      /* words per set of levels */
+    int *degree;                       /* by region */
+    int *level, *region, *colour;      /* level of region, and back */
+    unsigned char *remaining;          /* colours still to try, by level */
+    int *trailstart;                   /* by level */
+    int *trail, ntrail;                /* of region*FOUR+colour */
+    int *prunedby;                     /* by region*FOUR+colour */
+    unsigned *conflicts;               /* by level */
+};
+
+#define SEARCH_WORD_BITS (8 * (int)sizeof(unsigned))
+
+static struct search_scratch *new_search_scratch(struct solver_scratch *sc)
+{
+    struct search_scratch *ss = snew(struct search_scratch);
+    int n = sc->n, i;
+
+    ss->n = n;
+    ss->words = (n + SEARCH_WORD_BITS - 1) / SEARCH_WORD_BITS;
+    ss->degree = snewn(n, int);
+    for (i = 0; i < n; i++)
+        ss->degree[i] = sc->start[i+1] - sc->start[i];
+    ss->level = snewn(n, int);
+    ss->region = snewn(n, int);
+    ss->colour = snewn(n, int);
+    ss->remaining = snewn(n, unsigned char);
+    ss->trailstart = snewn(n, int);
+    ss->trail = snewn(n * FOUR, int);
+    ss->prunedby = snewn(n * FOUR, int);
+    ss->conflicts = snewn(n * ss->words, unsigned);
+
+    return ss;
+}
+
+static void free_search_scratch(struct search_scratch *ss)
+{
+    sfree(ss->degree);
+    sfree(ss->level);
+    sfree(ss->region);
+    sfree(ss->colour);
+    sfree(ss->remaining);
+    sfree(ss->trailstart);
+    sfree(ss->trail);
+    sfree(ss->prunedby);
+    sfree(ss->conflicts);
+    sfree(ss);
+}
+
+/* Add the levels which ruled colours out of region r to a set. */
+static void search_blame(struct search_scratch *ss, unsigned *set, int r)
+{
+    int c, l;
+
+    for (c = 0; c < FOUR; c++) {
+        l = ss->prunedby[r*FOUR+c];
+        if (l >= 0)
+            set[l / SEARCH_WORD_BITS] |= 1U << (l % SEARCH_WORD_BITS);
+    }
+}
+
+/* Undo everything the colour currently tried at a level ruled out. */
+static void search_undo(struct search_scratch *ss, unsigned char *possible,
+                        int level)
+{
+    while (ss->ntrail > ss->trailstart[level]) {
+        int t = ss->trail[--ss->ntrail];
+        possible[t / FOUR] |= 1 << (t % FOUR);
+        ss->prunedby[t] = -1;
+    }
+}
+
+/*
+ * Returns 0, 1 or 2 as map_solver does, and fills in 'colouring'
+ * with the solution if there's exactly one.
+ */
+static int map_search(struct solver_scratch *sc, int *graph, int n,
+                      int ngraph, int *colouring)
+{
+    struct search_scratch *ss;
+    unsigned char *possible = sc->possible;
+    unsigned *cs;
+    int nfree, nsolutions, depth, nodes, i, j, k, r, c;
+
+    if (!sc->search)
+        sc->search = new_search_scratch(sc);
+    ss = sc->search;
+
+    nfree = 0;
+    for (i = 0; i < n; i++) {
+        ss->level[i] = (colouring[i] < 0 ? -1 : n);
+        if (colouring[i] < 0)
+            nfree++;
+    }
+    assert(nfree > 0);
+    for (i = 0; i < n * FOUR; i++)
+        ss->prunedby[i] = -1;
+    ss->ntrail = 0;
+    nsolutions = nodes = 0;
+    depth = 0;
+
+#ifdef SOLVER_DIAGNOSTICS
+    if (verbose)
+        printf("%*ssearching %d regions with backjumping\n",
+               2*sc->depth, "", nfree);
+#endif
+
+  choose:
+    if (depth == nfree) {
+        /*
+         * Every region is coloured. If this is the first solution,
+         * keep it, and blame every level for it from now on; if
+         * not, we know all we need to.
+         */
+        if (++nsolutions > 1)
+            goto done;
+        for (i = 0; i < nfree; i++)
+            colouring[ss->region[i]] = ss->colour[i];
+        depth--;
+        cs = ss->conflicts + depth * ss->words;
+        for (i = 0; i < depth; i++)
+            cs[i / SEARCH_WORD_BITS] |= 1U << (i % SEARCH_WORD_BITS);
+        goto next;
+    }
+
+    /* Every so often, give up if the front end has run out of patience. */
+    if (!(++nodes & 255) &&
+        solver_progress((float)(n - nfree + depth) / n))
+        goto done;
+
+    r = -1;
+    for (i = 0; i < n; i++)
+        if (ss->level[i] < 0 &&
+            (r < 0 || bitcount(possible[i]) < bitcount(possible[r]) ||
+             (bitcount(possible[i]) == bitcount(possible[r]) &&
+              ss->degree[i] > ss->degree[r])))
+            r = i;
+    assert(possible[r] != 0);          /* forward checking ensures this */
+    ss->level[r] = depth;
+    ss->region[depth] = r;
+    ss->remaining[depth] = possible[r];
+    ss->trailstart[depth] = ss->ntrail;
+    memset(ss->conflicts + depth * ss->words, 0,
+           ss->words * sizeof(unsigned));
+
+  next:
+    r = ss->region[depth];
+    cs = ss->conflicts + depth * ss->words;
+    search_undo(ss, possible, depth);
+    while (ss->remaining[depth]) {
+        bool wipeout = false;
+
+        for (c = 0; !(ss->remaining[depth] & (1 << c)); c++);
+        ss->remaining[depth] &= ~(1 << c);
+        ss->colour[depth] = c;
+
+        for (j = sc->start[r]; j < sc->start[r+1]; j++) {
+            k = graph[j] - r*n;
+            if (ss->level[k] >= 0 || !(possible[k] & (1 << c)))
+                continue;
+            possible[k] &= ~(1 << c);
+            ss->prunedby[k*FOUR+c] = depth;
+            ss->trail[ss->ntrail++] = k*FOUR+c;
+            if (!possible[k]) {
+                search_blame(ss, cs, k);
+                wipeout = true;
+                break;
+            }
+        }
+        if (!wipeout) {
+            depth++;
+            goto choose;
+        }
+        search_undo(ss, possible, depth);
+    }
+
+    /*
+     * We've run out of colours for region r. Find the latest level
+     * to blame, pass the rest of the blame on to it, and undo
+     * everything since.
+     */
+    search_blame(ss, cs, r);
+    cs[depth / SEARCH_WORD_BITS] &= ~(1U << (depth % SEARCH_WORD_BITS));
+    for (j = depth; j-- > 0 ;)
+        if (cs[j / SEARCH_WORD_BITS] & (1U << (j % SEARCH_WORD_BITS)))
+            break;
+    while (depth > j) {
+        ss->level[ss->region[depth]] = -1;
+        depth--;
+        if (depth >= 0)
+            search_undo(ss, possible, depth);
+    }
+    if (depth < 0)
+        goto done;
+    cs[depth / SEARCH_WORD_BITS] &= ~(1U << (depth % SEARCH_WORD_BITS));
+    for (i = 0; i < ss->words; i++)
+        ss->conflicts[depth * ss->words + i] |= cs[i];
+    goto next;
+
+  done:
+    /* Leave the possibilities as we found them. */
+    ss->trailstart[0] = 0;
+    search_undo(ss, possible, 0);
+
+#ifdef SOLVER_DIAGNOSTICS
+    if (verbose)
+        printf("%*s%s found\n", 2*sc->depth, "",
+               nsolutions == 0 ? "no solutions" :
+               nsolutions == 1 ? "one solution" : "multiple solutions");
+#endif
+
+    return nsolutions < 2 ? nsolutions : 2;
+}
+
 /*
  * Returns 0 for impossible, 1 for success, 2 for failure to
  * converge (i.e. puzzle is either ambiguous or just too
@@ -1084,10 +1367,9 @@ static int map_solver(struct solver_scratch *sc,
              * Go through the neighbours of j1 and see if any are
              * shared with j2.
              */
-            for (j = graph_vertex_start(graph, n, ngraph, j1);
-                 j < ngraph && graph[j] < n*(j1+1); j++) {
+            for (j = sc->start[j1]; j < sc->start[j1+1]; j++) {
                 k = graph[j] - j1*n;
-                if (graph_adjacent(graph, n, ngraph, k, j2) &&
+                if (scratch_adjacent(sc, k, j2) &&
                     (sc->possible[k] & v)) {
 #ifdef SOLVER_DIAGNOSTICS
                     if (verbose) {
@@ -1189,8 +1471,7 @@ static int map_solver(struct solver_scratch *sc,
                         /*
                          * Try neighbours of j.
                          */
-                        for (gi = graph_vertex_start(graph, n, ngraph, j);
-                             gi < ngraph && graph[gi] < n*(j+1); gi++) {
+                        for (gi = sc->start[j]; gi < sc->start[j+1]; gi++) {
                             k = graph[gi] - j*n;
 
                             /*
@@ -1222,7 +1503,7 @@ static int map_solver(struct solver_scratch *sc,
                              * the original colour we ruled out.
                              */
                             if (currc == origc &&
-                                graph_adjacent(graph, n, ngraph, k, i) &&
+                                scratch_adjacent(sc, k, i) &&
                                 (sc->possible[k] & currc)) {
 #ifdef SOLVER_DIAGNOSTICS
                                 if (verbose) {
@@ -1282,6 +1563,9 @@ static int map_solver(struct solver_scratch *sc,
         return 2;                      /* unable to complete */
     }
 
+    if (sc->backjump)
+        return map_search(sc, graph, n, ngraph, colouring);
+
     /*
      * Now we've got to do something recursive. So first hunt for a
      * currently-most-constrained region.
@@ -1408,7 +1692,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     int *map, *graph, ngraph, *colouring, *colouring2, *regions;
     int i, j, w, h, n, solveret, cfreq[FOUR];
     int wh;
-    int mindiff, tries;
+    int mindiff, tries, attempt;
 #ifdef GENERATION_DIAGNOSTICS
     int x, y;
 #endif
@@ -1440,7 +1724,9 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     mindiff = params->diff;
     tries = 50;
 
-    while (1) {
+    for (attempt = 0;; attempt++) {
+        generation_progress(generation_retry_progress(attempt, 0.0F));
+        generation_phase("grid");
 
         /*
          * Create the map.
@@ -1477,6 +1763,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
         /*
          * Colour the map.
          */
+        generation_phase("clues");
         fourcolour(graph, n, ngraph, colouring, rs);
 
 #ifdef GENERATION_DIAGNOSTICS
@@ -1538,10 +1825,14 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 
         shuffle(regions, n, sizeof(*regions), rs);
 
+        generation_phase("solve");
         if (sc) free_scratch(sc);
         sc = new_scratch(graph, n, ngraph);
 
         for (i = 0; i < n; i++) {
+            generation_progress(generation_retry_progress(
+                attempt, 0.25F + 0.75F * i / n));
+
             j = regions[i];
 
             if (cfreq[colouring[j]] == 1)
@@ -1580,6 +1871,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
          * latter - if a solver which _does nothing_ can solve it,
          * it's too easy!)
          */
+        generation_phase("grade");
         memcpy(colouring2, colouring, n*sizeof(int));
         if (map_solver(sc, graph, n, ngraph, colouring2,
                        mindiff - 1) == 1) {
@@ -3343,7 +3635,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     get_prefs, set_prefs,
     new_ui,
@@ -3372,6 +3668,89 @@ const struct game thegame = {
 
 #ifdef STANDALONE_SOLVER
 
+#include <time.h>
+
+/*
+ * Time one solve in each search mode, and check they agree.
+ */
+static void benchmark_solve(struct solver_scratch *sc, const game_state *s,
+                            int *colouring, double *times)
+{
+    int n = s->map->n, *sub = snewn(n, int), ret[2], mode;
+
+    for (mode = 0; mode < 2; mode++) {
+        clock_t start = clock();
+        memcpy(sub, colouring, n * sizeof(int));
+        sc->backjump = (mode == 1);
+        ret[mode] = map_solver(sc, s->map->graph, n, s->map->ngraph, sub,
+                               DIFF_RECURSE);
+        times[mode] += (double)(clock() - start) / CLOCKS_PER_SEC;
+    }
+    if (ret[0] != ret[1]) {
+        fprintf(stderr, "search modes disagree (%d, %d)\n", ret[0], ret[1]);
+        exit(1);
+    }
+    sfree(sub);
+}
+
+/*
+ * Compare the two ways map_solver can search, on the checks the
+ * generator makes: for 'count' puzzles generated from each preset,
+ * solve the puzzle and then each of the puzzles with one clue less.
+ */
+static void benchmark(int count)
+{
+    int i, j, k;
+    char *name;
+    game_params *p;
+
+    for (i = 0; game_fetch_preset(i, &name, &p); i++) {
+        double times[2] = { 0.0, 0.0 };
+        int nsolves = 0;
+
+        for (j = 0; j < count; j++) {
+            char seed[32], *desc, *aux;
+            random_state *rs;
+            game_state *s;
+            struct solver_scratch *sc;
+            int *colouring;
+
+            sprintf(seed, "%d", j);
+            rs = random_new(seed, strlen(seed));
+            desc = new_game_desc(p, rs, &aux, false);
+            s = new_game(NULL, p, desc);
+            sc = new_scratch(s->map->graph, s->map->n, s->map->ngraph);
+            colouring = snewn(s->map->n, int);
+
+            for (k = -1; k < s->map->n; k++) {
+                if (k >= 0 && s->colouring[k] < 0)
+                    continue;
+                memcpy(colouring, s->colouring, s->map->n * sizeof(int));
+                if (k >= 0)
+                    colouring[k] = -1;
+                benchmark_solve(sc, s, colouring, times);
+                nsolves++;
+            }
+
+            sfree(colouring);
+            free_scratch(sc);
+            free_game(s);
+            sfree(desc);
+            sfree(aux);
+            random_free(rs);
+        }
+
+        printf("%-32s %6d solves: recursive %8.1fms, backjumping %8.1fms",
+               name, nsolves, times[0] * 1000, times[1] * 1000);
+        if (times[1] > 0)
+            printf(" (%.1fx)", times[0] / times[1]);
+        printf("\n");
+        fflush(stdout);
+        sfree(name);
+        free_params(p);
+    }
+}
+
 int main(int argc, char **argv)
 {
     game_params *p;
@@ -3390,6 +3769,9 @@ int main(int argc, char **argv)
             really_verbose = true;
         } else if (!strcmp(p, "-g")) {
             grade = true;
+        } else if (!strcmp(p, "-b")) {
+            benchmark(argc > 1 ? atoi(*++argv) : 10);
+            return 0;
         } else if (*p == '-') {
             fprintf(stderr, "%s: unrecognised option `%s'\n", argv[0], p);
             return 1;
@@ -3399,7 +3781,8 @@ int main(int argc, char **argv)
     }
 
     if (!id) {
-        fprintf(stderr, "usage: %s [-g | -v] <game_id>\n", argv[0]);
+        fprintf(stderr, "usage: %s [-g | -v] <game_id>\n"
+                "       %s -b <count>\n", argv[0], argv[0]);
         return 1;
     }
 
@@ -74,39 +74,39 @@ size_t matching_scratch_size(int nl, int nr)
     return n * sizeof(int);
 }
 
-int matching_with_scratch(void *scratchv,
-                          int nl, int nr, int **adjlists, int *adjsizes,
-                          random_state *rs, int *outl, int *outr)
+/*
+ * Set up the various array pointers in the scratch space.
+ */
+static struct scratch *setup_scratch(void *scratchv, int nl, int nr)
 {
     struct scratch *s = (struct scratch *)scratchv;
-    int L, R, i, j;
+    int *p = scratchv;
+    int nmin = (nl < nr ? nl : nr);
 
-    /*
-     * Set up the various array pointers in the scratch space.
-     */
-    {
-        int *p = scratchv;
-        int nmin = (nl < nr ? nl : nr);
-
-        p += (sizeof(struct scratch) + sizeof(int)-1)/sizeof(int);
-        s->LtoR = p; p += nl;
-        s->RtoL = p; p += nr;
-        s->Llayer = p; p += nl;
-        s->Rlayer = p; p += nr;
-        s->Lqueue = p; p += nl;
-        s->Rqueue = p; p += nr;
-        s->augpath = p; p += 2*nmin;
-        s->dfsstate = p; p += nmin;
-        s->Lorder = p; p += nl;
-    }
+    p += (sizeof(struct scratch) + sizeof(int)-1)/sizeof(int);
+    s->LtoR = p; p += nl;
+    s->RtoL = p; p += nr;
+    s->Llayer = p; p += nl;
+    s->Rlayer = p; p += nr;
+    s->Lqueue = p; p += nl;
+    s->Rqueue = p; p += nr;
+    s->augpath = p; p += 2*nmin;
+    s->dfsstate = p; p += nmin;
+    s->Lorder = p; p += nl;
+
+    return s;
+}
 
-    /*
-     * Set up the initial matching, which is empty.
-     */
-    for (L = 0; L < nl; L++)
-        s->LtoR[L] = -1;
-    for (R = 0; R < nr; R++)
-        s->RtoL[R] = -1;
+/*
+ * The main Hopcroft-Karp loop: starting from whatever matching is
+ * currently in LtoR and RtoL, repeatedly find sets of augmenting
+ * paths until there are none left, then write out the results.
+ */
+static int augment(struct scratch *s,
+                   int nl, int nr, int **adjlists, int *adjsizes,
+                   random_state *rs, int *outl, int *outr)
+{
+    int L, R, i, j;
 
     while (1) {
         /*
@@ -299,6 +299,72 @@ int matching_with_scratch(void *scratchv,
     return j;
 }
 
+int matching_with_scratch(void *scratchv,
+                          int nl, int nr, int **adjlists, int *adjsizes,
+                          random_state *rs, int *outl, int *outr)
+{
+    struct scratch *s = setup_scratch(scratchv, nl, nr);
+    int L, R, j;
+
+    /*
+     * Set up the initial matching, which is empty.
+     */
+    for (L = 0; L < nl; L++)
+        s->LtoR[L] = -1;
+    for (R = 0; R < nr; R++)
+        s->RtoL[R] = -1;
+
+    /*
+     * If we're not randomising, get most of the way there cheaply
+     * by greedily matching each L vertex to its first free
+     * neighbour. That typically leaves only a few augmenting paths
+     * for the expensive phases to find. (We don't do this when
+     * randomising, because then the output matching depends on the
+     * random_state, and we don't want to change which matching a
+     * given random seed leads to.)
+     */
+    if (!rs) {
+        for (L = 0; L < nl; L++) {
+            for (j = 0; j < adjsizes[L]; j++) {
+                R = adjlists[L][j];
+                if (s->RtoL[R] == -1) {
+                    s->LtoR[L] = R;
+                    s->RtoL[R] = L;
+                    break;
+                }
+            }
+        }
+    }
+
+    return augment(s, nl, nr, adjlists, adjsizes, rs, outl, outr);
+}
+
+int matching_resume(void *scratchv,
+                    int nl, int nr, int **adjlists, int *adjsizes,
+                    random_state *rs, int *outl, int *outr)
+{
+    struct scratch *s = setup_scratch(scratchv, nl, nr);
+    int L, R, j;
+
+    /*
+     * Keep the matching left behind by the previous call, except for
+     * any edges of it that have since been removed from the graph.
+     */
+    for (L = 0; L < nl; L++) {
+        if ((R = s->LtoR[L]) == -1)
+            continue;
+        for (j = 0; j < adjsizes[L]; j++)
+            if (adjlists[L][j] == R)
+                break;
+        if (j == adjsizes[L]) {
+            s->LtoR[L] = -1;
+            s->RtoL[R] = -1;
+        }
+    }
+
+    return augment(s, nl, nr, adjlists, adjsizes, rs, outl, outr);
+}
+
 int matching(int nl, int nr, int **adjlists, int *adjsizes,
              random_state *rs, int *outl, int *outr)
 {
@@ -55,7 +55,32 @@ int matching_with_scratch(void *scratch,
                           random_state *rs, int *outl, int *outr);
 
 /*
- * The above function expects its 'scratch' parameter to have already
+ * Incremental version of matching_with_scratch, for callers that
+ * solve a sequence of graphs each differing only slightly from the
+ * last.
+ *
+ * 'scratch' must have been passed to matching_with_scratch (or to
+ * this function) on a previous call with the same 'nl' and 'nr', and
+ * not used for anything else since. The matching found by that call
+ * is kept, minus any of its edges that no longer appear in
+ * 'adjlists', and used as the starting point for finding a maximum
+ * matching of the new graph. If only a single edge has been added
+ * or removed since the previous call, this needs at most one
+ * augmenting path, which is much cheaper than starting again from
+ * an empty matching.
+ *
+ * Parameters and return value are otherwise as for
+ * matching_with_scratch, and matching_witness may be used on the
+ * scratch space afterwards in the same way. If 'rs' is not NULL,
+ * the new matching is randomised only to the extent that the
+ * augmentation needs to change the old one.
+ */
+int matching_resume(void *scratch,
+                    int nl, int nr, int **adjlists, int *adjsizes,
+                    random_state *rs, int *outl, int *outr);
+
+/*
+ * The above functions expect their 'scratch' parameter to have already
  * been set up. This function tells you how much space is needed for a
  * given size of graph, so that you can allocate a single instance of
  * scratch space and run the algorithm multiple times without the
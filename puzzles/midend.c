@@ -20,11 +20,36 @@ enum { NEWGAME, MOVE, SOLVE, RESTART };/* for midend_state_entry.movetype */
 #define special(type) ( (type) != MOVE )
 
 struct midend_state_entry {
-    game_state *state;
+    game_state *state;                 /* NULL if compacted */
     char *movestr;
     int movetype;
 };
 
+/*
+ * Long undo chains are compacted, so that a game left open for days
+ * doesn't keep a whole game_state per move. Only the states within
+ * MIDEND_HOT_STATES of the current position are kept in full, plus
+ * state 0 and a checkpoint every MIDEND_CHECKPOINT_INTERVAL moves;
+ * the rest keep just their move string, and are reconstructed by
+ * replaying moves forward from the previous checkpoint when undo or
+ * redo brings them back into range. This relies on execute_move being
+ * deterministic, which serialisation already does.
+ */
+#define MIDEND_HOT_STATES 16
+#define MIDEND_CHECKPOINT_INTERVAL 32
+
+/*
+ * Save files for games with encode_state and decode_state carry a
+ * checkpoint every MIDEND_SAVE_CHECKPOINT_INTERVAL states: the whole
+ * state, in a STATE record just before the move record that makes
+ * it. Loading then only has to replay the moves since the checkpoint
+ * before the current position, and leaves the rest to
+ * midend_replay_state. This is a multiple of
+ * MIDEND_CHECKPOINT_INTERVAL, so that the loaded checkpoints are
+ * never compacted away.
+ */
+#define MIDEND_SAVE_CHECKPOINT_INTERVAL (8 * MIDEND_CHECKPOINT_INTERVAL)
+
 struct midend_serialise_buf {
     char *buf;
     int len, size;
@@ -35,6 +60,27 @@ struct midend_serialise_buf_read_ctx {
     int len, pos;
 };
 
+/*
+ * The game superseded by midend_new_game, kept so that the New Game
+ * can be undone. Serialising the whole of it there and then would
+ * make every New Game cost as much as a save of the old game, so
+ * instead we serialise just the header (which is short), and take
+ * over the old states list, of which only the move strings are kept.
+ * The two are only joined into a save file in newgame_undo if the
+ * New Game actually is undone.
+ *
+ * A superseded game whose move strings come to more than
+ * MIDEND_NEWGAME_UNDO_BUDGET bytes isn't kept at all, so that New
+ * Game after a very long game can't be undone.
+ */
+struct midend_newgame_snapshot {
+    struct midend_serialise_buf header;
+    struct midend_state_entry *states; /* state fields are all NULL */
+    int nstates, statepos;
+};
+
+#define MIDEND_NEWGAME_UNDO_BUDGET (1024 * 1024)
+
 struct midend {
     frontend *frontend;
     random_state *random;
@@ -68,17 +114,36 @@ struct midend {
      */
     char *desc, *privdesc, *seedstr;
     char *aux_info;
-    enum { GOT_SEED, GOT_DESC, GOT_NOTHING } genmode;
+    /*
+     * For games with SOLVE_FROM_ORIG, the result of solve() worked
+     * out in advance by midend_precompute_solution, or NULL.
+     */
+    char *solution;
+    enum { GOT_SEED, GOT_DESC, GOT_PREGEN, GOT_NOTHING } genmode;
+
+    /*
+     * A game generated in advance (by midend_generate_game, possibly
+     * in some other midend), supplied by midend_supply_game for use
+     * by the next midend_new_game. Valid only in genmode GOT_PREGEN.
+     */
+    game_params *pregen_params;
+    char *pregen_seedstr, *pregen_desc, *pregen_aux_info;
 
     int nstates, statesize, statepos;
     struct midend_state_entry *states;
+    int hot_lo, hot_hi;         /* range in which compaction last ran */
+    int saved_nstates;          /* states unchanged since last saved by
+                                 * midend_serialise_changes, or 0 */
 
     struct midend_serialise_buf newgame_undo, newgame_redo;
+    struct midend_newgame_snapshot *newgame_snapshot;
     bool newgame_can_store_undo;
 
     game_params *params, *curparams;
     game_drawstate *drawstate;
     bool first_draw;
+    bool drawstate_stale;              /* see midend_size */
+    bool redraws_deferred, redraw_pending;  /* see midend_defer_redraws */
     game_ui *ui;
 
     game_state *oldstate;
@@ -105,7 +170,23 @@ struct midend {
     void (*game_params_change_notify_function)(void *);
     void *game_params_change_notify_ctx;
 
+    void (*generation_progress_notify_function)(void *, float);
+    void *generation_progress_notify_ctx;
+    float generation_progress;
+
+    bool (*solve_progress_notify_function)(void *, float);
+    void *solve_progress_notify_ctx;
+    bool solve_interrupted;
+
     bool one_key_shortcuts;
+
+#ifdef MIDEND_TRACING
+    double (*trace_clock)(void *);
+    void *trace_clock_ctx;
+    midend_trace_event trace[MIDEND_TRACE_EVENTS];
+    int trace_first, trace_len;        /* ring buffer of events */
+    int trace_depth;
+#endif
 };
 
 #define ensure(me) do { \
@@ -124,12 +205,19 @@ struct midend {
  */
 struct deserialise_data {
     char *seed, *parstr, *desc, *privdesc;
-    char *auxinfo, *uistr, *cparstr;
+    char *auxinfo, *uistr, *cparstr, *solution;
     float elapsed;
     game_params *params, *cparams;
     game_ui *ui;
     struct midend_state_entry *states;
     int nstates, statepos;
+    struct deserialise_checkpoint *checkpoints;
+    int ncheckpoints, checkpointsize;
+};
+
+struct deserialise_checkpoint {
+    int index;                         /* into deserialise_data.states */
+    char *encoding;
 };
 
 /*
@@ -146,6 +234,9 @@ static const char *midend_deserialise_prefs(
     midend *me, game_ui *ui,
     bool (*read)(void *ctx, void *buf, int len), void *rctx);
 static config_item *midend_get_prefs(midend *me, game_ui *ui);
+static void midend_snapshot_game(midend *me);
+static void midend_free_newgame_snapshot(midend *me);
+static void midend_flush_newgame_snapshot(midend *me);
 static void midend_set_prefs(midend *me, game_ui *ui, config_item *all_prefs);
 static void midend_apply_prefs(midend *me, game_ui *ui);
 
@@ -188,15 +279,30 @@ midend *midend_new(frontend *fe, const game *ourgame,
     me->ourgame = ourgame;
     me->random = random_new(randseed, randseedsize);
     me->nstates = me->statesize = me->statepos = 0;
+    me->saved_nstates = 0;
     me->states = NULL;
+    me->hot_lo = me->hot_hi = 0;
     me->newgame_undo.buf = NULL;
     me->newgame_undo.size = me->newgame_undo.len = 0;
     me->newgame_redo.buf = NULL;
     me->newgame_redo.size = me->newgame_redo.len = 0;
+    me->newgame_snapshot = NULL;
     me->newgame_can_store_undo = false;
+    me->redraws_deferred = me->redraw_pending = false;
     me->params = ourgame->default_params();
     me->game_id_change_notify_function = NULL;
     me->game_id_change_notify_ctx = NULL;
+    me->game_params_change_notify_function = NULL;
+    me->game_params_change_notify_ctx = NULL;
+    me->generation_progress_notify_function = NULL;
+    me->generation_progress_notify_ctx = NULL;
+    me->solve_progress_notify_function = NULL;
+    me->solve_progress_notify_ctx = NULL;
+#ifdef MIDEND_TRACING
+    me->trace_clock = NULL;
+    me->trace_clock_ctx = NULL;
+    me->trace_first = me->trace_len = me->trace_depth = 0;
+#endif
     me->encoded_presets = NULL;
     me->n_encoded_presets = 0;
 
@@ -220,9 +326,13 @@ midend *midend_new(frontend *fe, const game *ourgame,
     me->desc = me->privdesc = NULL;
     me->seedstr = NULL;
     me->aux_info = NULL;
+    me->solution = NULL;
     me->genmode = GOT_NOTHING;
+    me->pregen_params = NULL;
+    me->pregen_seedstr = me->pregen_desc = me->pregen_aux_info = NULL;
     me->drawstate = NULL;
     me->first_draw = true;
+    me->drawstate_stale = false;
     me->oldstate = NULL;
     me->preset_menu = NULL;
     me->anim_time = me->anim_pos = 0.0F;
@@ -259,25 +369,107 @@ const game *midend_which_game(midend *me)
 static void midend_purge_states(midend *me)
 {
     while (me->nstates > me->statepos) {
-        me->ourgame->free_game(me->states[--me->nstates].state);
+        if (me->states[--me->nstates].state)
+            me->ourgame->free_game(me->states[me->nstates].state);
         if (me->states[me->nstates].movestr)
             sfree(me->states[me->nstates].movestr);
     }
+    me->saved_nstates = min(me->saved_nstates, me->nstates);
     me->newgame_redo.len = 0;
 }
 
+/*
+ * Reconstruct states[i], if it was compacted, by replaying moves from
+ * the nearest earlier state we still have.
+ */
+static void midend_replay_state(midend *me, int i)
+{
+    int j;
+
+    if (me->states[i].state)
+        return;
+
+    for (j = i; !me->states[j].state; j--)
+        assert(j > 0);                 /* state 0 is never compacted */
+
+    for (j++; j <= i; j++) {
+        struct midend_state_entry *e = &me->states[j];
+
+        if (e->movetype == RESTART)
+            e->state = me->ourgame->new_game(me, me->params, e->movestr);
+        else
+            e->state = me->ourgame->execute_move(me->states[j-1].state,
+                                                 e->movestr);
+
+        /*
+         * Loading a save file with checkpoints only checks the moves
+         * leading up to the current position. If one of the others
+         * turns out to be invalid, the best we can do is to leave the
+         * state as it was.
+         */
+        if (!e->state)
+            e->state = me->ourgame->dup_game(me->states[j-1].state);
+    }
+}
+
+/*
+ * Call after every change to statepos, to make sure the states near
+ * it are all present and free the ones that have moved out of range.
+ */
+static void midend_compact_states(midend *me)
+{
+    int lo = max(me->statepos - 1 - MIDEND_HOT_STATES, 0);
+    int hi = min(me->statepos - 1 + MIDEND_HOT_STATES, me->nstates - 1);
+    int from, to, i;
+
+    for (i = lo; i <= hi; i++)
+        midend_replay_state(me, i);
+
+    /*
+     * Everything outside the last hot range is compacted already,
+     * except whatever replaying just filled in before lo.
+     */
+    from = min(me->hot_lo, lo - lo % MIDEND_CHECKPOINT_INTERVAL);
+    to = min(max(me->hot_hi, hi), me->nstates - 1);
+    for (i = max(from, 1); i <= to; i++) {
+        if ((i < lo || i > hi) && i % MIDEND_CHECKPOINT_INTERVAL != 0 &&
+            me->states[i].state) {
+            me->ourgame->free_game(me->states[i].state);
+            me->states[i].state = NULL;
+        }
+    }
+
+    me->hot_lo = lo;
+    me->hot_hi = hi;
+}
+
 static void midend_free_game(midend *me)
 {
     while (me->nstates > 0) {
         me->nstates--;
-	me->ourgame->free_game(me->states[me->nstates].state);
+        if (me->states[me->nstates].state)
+            me->ourgame->free_game(me->states[me->nstates].state);
 	sfree(me->states[me->nstates].movestr);
     }
+    me->saved_nstates = 0;
 
     if (me->drawstate)
         me->ourgame->free_drawstate(me->drawing, me->drawstate);
 }
 
+static void midend_free_pregen(midend *me)
+{
+    if (me->pregen_params)
+        me->ourgame->free_params(me->pregen_params);
+    me->pregen_params = NULL;
+    sfree(me->pregen_seedstr);
+    sfree(me->pregen_desc);
+    sfree(me->pregen_aux_info);
+    me->pregen_seedstr = me->pregen_desc = me->pregen_aux_info = NULL;
+    if (me->genmode == GOT_PREGEN)
+        me->genmode = GOT_NOTHING;
+}
+
 static void midend_free_preset_menu(midend *me, struct preset_menu *menu)
 {
     if (menu) {
@@ -298,6 +490,9 @@ void midend_free(midend *me)
     int i;
 
     midend_free_game(me);
+    midend_free_pregen(me);
+    if (me->oldstate)
+        me->ourgame->free_game(me->oldstate); /* freed mid-animation */
 
     for (i = 0; i < me->n_encoded_presets; i++)
         sfree(me->encoded_presets[i]);
@@ -305,6 +500,7 @@ void midend_free(midend *me)
     if (me->drawing)
 	drawing_free(me->drawing);
     random_free(me->random);
+    midend_free_newgame_snapshot(me);
     sfree(me->newgame_undo.buf);
     sfree(me->newgame_redo.buf);
     sfree(me->states);
@@ -312,6 +508,7 @@ void midend_free(midend *me)
     sfree(me->privdesc);
     sfree(me->seedstr);
     sfree(me->aux_info);
+    sfree(me->solution);
     sfree(me->be_prefs.buf);
     me->ourgame->free_params(me->params);
     midend_free_preset_menu(me, me->preset_menu);
@@ -335,6 +532,22 @@ static void midend_size_new_drawstate(midend *me)
 	me->ourgame->set_size(me->drawing, me->drawstate,
 			      me->params, me->tilesize);
     }
+    me->drawstate_stale = false;
+}
+
+/*
+ * Replace the drawstate, if midend_size has left it stale, before
+ * anything uses it.
+ */
+static void midend_refresh_drawstate(midend *me)
+{
+    if (me->drawstate_stale) {
+        me->ourgame->free_drawstate(me->drawing, me->drawstate);
+        me->drawstate = me->ourgame->new_drawstate(me->drawing,
+                                                   me->states[0].state);
+        me->first_draw = true;
+        midend_size_new_drawstate(me);
+    }
 }
 
 /*
@@ -378,23 +591,31 @@ static int convert_tilesize(midend *me, int old_tilesize,
     return min;
 }
 
+/* Whether the puzzle fits in x by y at tile size t. */
+static bool midend_tilesize_fits(midend *me, int t, int x, int y)
+{
+    int rx, ry;
+
+    me->ourgame->compute_size(me->params, t, me->ui, &rx, &ry);
+    return rx <= x && ry <= y;
+}
+
 void midend_size(midend *me, int *x, int *y, bool user_size,
                  double device_pixel_ratio)
 {
-    int min, max;
-    int rx, ry;
+    int min, max, guess;
 
     /*
      * We can't set the size on the same drawstate twice. So if
      * we've already sized one drawstate, we must throw it away and
-     * create a new one.
+     * create a new one. But front ends often call this several times
+     * before drawing anything (on each of a stream of window resize
+     * events, say), so rather than doing that now, mark the drawstate
+     * stale, for midend_refresh_drawstate to replace when it's next
+     * used.
      */
-    if (me->drawstate && me->tilesize > 0) {
-        me->ourgame->free_drawstate(me->drawing, me->drawstate);
-        me->drawstate = me->ourgame->new_drawstate(me->drawing,
-                                                   me->states[0].state);
-        me->first_draw = true;
-    }
+    if (me->drawstate && me->tilesize > 0)
+        me->drawstate_stale = true;
 
     /*
      * Find the tile size that best fits within the given space. If
@@ -404,32 +625,45 @@ void midend_size(midend *me, int *x, int *y, bool user_size,
      * preferred tile size, so that the game gets what it wants
      * provided that this doesn't break the constraint from the
      * front-end (which is likely to be a screen size or similar).
+     *
+     * Sizes fit for all tile sizes up to some limit, so the answer is
+     * the largest tile size below `max' that fits (or 1, if none do).
+     * When resizing, that's usually the tile size we already have,
+     * so check that first: it saves searching again.
      */
-    if (user_size) {
-	max = 1;
-	do {
-	    max *= 2;
-	    me->ourgame->compute_size(me->params, max, me->ui, &rx, &ry);
-	} while (rx <= *x && ry <= *y);
-    } else
+    if (user_size)
+        max = INT_MAX;
+    else
 	max = convert_tilesize(me, me->preferred_tilesize,
                                me->preferred_tilesize_dpr,
                                device_pixel_ratio) + 1;
-    min = 1;
+    guess = me->tilesize;
+    if (guess > 0 && guess < max &&
+        (guess == 1 || midend_tilesize_fits(me, guess, *x, *y)) &&
+        (guess + 1 == max || !midend_tilesize_fits(me, guess + 1, *x, *y))) {
+        min = guess;
+    } else {
+        if (user_size) {
+            max = 1;
+            do {
+                max *= 2;
+            } while (midend_tilesize_fits(me, max, *x, *y));
+        }
+        min = 1;
 
-    /*
-     * Now binary-search between min and max. We're looking for a
-     * boundary rather than a value: the point at which tile sizes
-     * stop fitting within the given dimensions. Thus, we stop when
-     * max and min differ by exactly 1.
-     */
-    while (max - min > 1) {
-	int mid = (max + min) / 2;
-	me->ourgame->compute_size(me->params, mid, me->ui, &rx, &ry);
-	if (rx <= *x && ry <= *y)
-	    min = mid;
-	else
-	    max = mid;
+        /*
+         * Now binary-search between min and max. We're looking for a
+         * boundary rather than a value: the point at which tile sizes
+         * stop fitting within the given dimensions. Thus, we stop
+         * when max and min differ by exactly 1.
+         */
+        while (max - min > 1) {
+            int mid = (max + min) / 2;
+            if (midend_tilesize_fits(me, mid, *x, *y))
+                min = mid;
+            else
+                max = mid;
+        }
     }
 
     /*
@@ -442,7 +676,11 @@ void midend_size(midend *me, int *x, int *y, bool user_size,
         me->preferred_tilesize = me->tilesize;
         me->preferred_tilesize_dpr = device_pixel_ratio;
     }
-    midend_size_new_drawstate(me);
+    if (me->drawstate_stale)
+	me->ourgame->compute_size(me->params, me->tilesize, me->ui,
+				  &me->winwidth, &me->winheight);
+    else
+        midend_size_new_drawstate(me);
     *x = me->winwidth;
     *y = me->winheight;
 }
@@ -453,6 +691,7 @@ void midend_set_params(midend *me, game_params *params)
 {
     me->ourgame->free_params(me->params);
     me->params = me->ourgame->dup_params(params);
+    midend_free_pregen(me);
     if (me->game_params_change_notify_function)
         me->game_params_change_notify_function(me->game_params_change_notify_ctx);
 }
@@ -565,14 +804,153 @@ static bool midend_serialise_buf_read(void *ctx, void *buf, int len)
     return true;
 }
 
+/*
+ * Generate a new random seed. 15 digits comes to about 48 bits, which
+ * should be more than enough.
+ *
+ * I'll avoid putting a leading zero on the number, just in case it
+ * confuses anybody who thinks it's processed as an integer rather
+ * than a string.
+ */
+static char *midend_new_seed(midend *me)
+{
+    char newseed[16];
+    int i;
+    newseed[15] = '\0';
+    newseed[0] = '1' + (char)random_upto(me->random, 9);
+    for (i = 1; i < 15; i++)
+        newseed[i] = '0' + (char)random_upto(me->random, 10);
+    return dupstr(newseed);
+}
+
+static void midend_generation_progress(void *ctx, float done)
+{
+    midend *me = (midend *)ctx;
+
+    /*
+     * Generators restart phases and retry, so don't let the reported
+     * progress go backwards.
+     */
+    if (done > me->generation_progress) {
+        me->generation_progress = done;
+        me->generation_progress_notify_function(
+            me->generation_progress_notify_ctx, done);
+    }
+}
+
+void midend_set_trace_clock(midend *me, double (*clock)(void *ctx),
+                            void *ctx)
+{
+#ifdef MIDEND_TRACING
+    me->trace_clock = clock;
+    me->trace_clock_ctx = ctx;
+    me->trace_first = me->trace_len = me->trace_depth = 0;
+#endif
+}
+
+int midend_take_trace_events(midend *me, midend_trace_event *events, int max)
+{
+    int n = 0;
+
+#ifdef MIDEND_TRACING
+    while (n < max && me->trace_len > 0) {
+        events[n++] = me->trace[me->trace_first];
+        me->trace_first = (me->trace_first + 1) % MIDEND_TRACE_EVENTS;
+        me->trace_len--;
+    }
+#endif
+    return n;
+}
+
+/*
+ * Bracket a traced call: t = midend_trace_begin(me); ...;
+ * midend_trace_end(me, "name", t). Both cost next to nothing while
+ * nobody's tracing, and without MIDEND_TRACING they vanish.
+ */
+#ifdef MIDEND_TRACING
+static double midend_trace_begin(midend *me)
+{
+    if (!me->trace_clock)
+        return 0.0;
+    me->trace_depth++;
+    return me->trace_clock(me->trace_clock_ctx);
+}
+
+static void midend_trace_end(midend *me, const char *name, double start)
+{
+    midend_trace_event *ev;
+
+    if (!me->trace_clock || me->trace_depth == 0)
+        return;
+    if (me->trace_len < MIDEND_TRACE_EVENTS) {
+        ev = &me->trace[(me->trace_first + me->trace_len++) %
+                        MIDEND_TRACE_EVENTS];
+    } else {
+        /* Full: overwrite the oldest. */
+        ev = &me->trace[me->trace_first];
+        me->trace_first = (me->trace_first + 1) % MIDEND_TRACE_EVENTS;
+    }
+    ev->name = name;
+    ev->start = start;
+    ev->end = me->trace_clock(me->trace_clock_ctx);
+    ev->depth = --me->trace_depth;
+}
+#else
+#define midend_trace_begin(me) 0.0
+#define midend_trace_end(me, name, start) ((void)(start))
+#endif
+
+void midend_trace_mark(midend *me, const char *name)
+{
+    midend_trace_end(me, name, midend_trace_begin(me));
+}
+
+/*
+ * Call the game's new_desc, passing on any progress reports it makes
+ * if the front end has asked for them.
+ */
+static char *midend_call_new_desc(midend *me, const game_params *params,
+                                  random_state *rs, char **aux_info)
+{
+    char *desc;
+    double t = midend_trace_begin(me);
+
+    /*
+     * If this midend has been instantiated without providing a
+     * drawing API, it is non-interactive. This means that it's
+     * being used for bulk game generation, and hence we should
+     * pass the non-interactive flag to new_desc.
+     */
+    if (!me->generation_progress_notify_function) {
+        desc = me->ourgame->new_desc(params, rs, aux_info,
+                                     (me->drawing != NULL));
+        midend_trace_end(me, "new_desc", t);
+        return desc;
+    }
+
+    me->generation_progress = 0.0F;
+    me->generation_progress_notify_function(
+        me->generation_progress_notify_ctx, 0.0F);
+    set_generation_progress_hook(midend_generation_progress, me);
+    desc = me->ourgame->new_desc(params, rs, aux_info,
+                                 (me->drawing != NULL));
+    set_generation_progress_hook(NULL, NULL);
+    me->generation_progress_notify_function(
+        me->generation_progress_notify_ctx, 1.0F);
+    midend_trace_end(me, "new_desc", t);
+    return desc;
+}
+
 void midend_new_game(midend *me)
 {
+    midend_stop_anim(me);
+
     me->newgame_undo.len = 0;
+    midend_free_newgame_snapshot(me);
     if (me->newgame_can_store_undo) {
         /*
-         * Serialise the whole of the game that we're about to
-         * supersede, so that the 'New Game' action can be undone
-         * later.
+         * Keep the game that we're about to supersede, so that the
+         * 'New Game' action can be undone later.
          *
          * We omit this in various situations, such as if there
          * _isn't_ a current game (not even a starting position)
@@ -584,38 +962,44 @@ void midend_new_game(midend *me)
          * worse, valid but wrong.
          */
         midend_purge_states(me);
-        midend_serialise(me, midend_serialise_buf_write, &me->newgame_undo);
+        midend_snapshot_game(me);
     }
 
-    midend_stop_anim(me);
     midend_free_game(me);
+    sfree(me->solution);
+    me->solution = NULL;
 
     assert(me->nstates == 0);
 
     if (me->genmode == GOT_DESC) {
 	me->genmode = GOT_NOTHING;
+    } else if (me->genmode == GOT_PREGEN) {
+        /*
+         * Install the supplied game as if we had just generated it
+         * from its seed ourselves.
+         */
+        if (me->curparams)
+            me->ourgame->free_params(me->curparams);
+        me->curparams = me->pregen_params;
+        sfree(me->seedstr);
+        me->seedstr = me->pregen_seedstr;
+        sfree(me->desc);
+        me->desc = me->pregen_desc;
+        sfree(me->privdesc);
+        me->privdesc = NULL;
+        sfree(me->aux_info);
+        me->aux_info = me->pregen_aux_info;
+        me->pregen_params = NULL;
+        me->pregen_seedstr = me->pregen_desc = me->pregen_aux_info = NULL;
+        me->genmode = GOT_NOTHING;
     } else {
         random_state *rs;
 
         if (me->genmode == GOT_SEED) {
             me->genmode = GOT_NOTHING;
         } else {
-            /*
-             * Generate a new random seed. 15 digits comes to about
-             * 48 bits, which should be more than enough.
-             * 
-             * I'll avoid putting a leading zero on the number,
-             * just in case it confuses anybody who thinks it's
-             * processed as an integer rather than a string.
-             */
-            char newseed[16];
-            int i;
-            newseed[15] = '\0';
-            newseed[0] = '1' + (char)random_upto(me->random, 9);
-            for (i = 1; i < 15; i++)
-                newseed[i] = '0' + (char)random_upto(me->random, 10);
             sfree(me->seedstr);
-            me->seedstr = dupstr(newseed);
+            me->seedstr = midend_new_seed(me);
 
 	    if (me->curparams)
 		me->ourgame->free_params(me->curparams);
@@ -628,14 +1012,8 @@ void midend_new_game(midend *me)
 	me->aux_info = NULL;
 
         rs = random_new(me->seedstr, strlen(me->seedstr));
-	/*
-	 * If this midend has been instantiated without providing a
-	 * drawing API, it is non-interactive. This means that it's
-	 * being used for bulk game generation, and hence we should
-	 * pass the non-interactive flag to new_desc.
-	 */
-        me->desc = me->ourgame->new_desc(me->curparams, rs,
-					 &me->aux_info, (me->drawing != NULL));
+        me->desc = midend_call_new_desc(me, me->curparams, rs,
+                                        &me->aux_info);
 	assert_printable_ascii(me->desc);
 	me->privdesc = NULL;
         random_free(rs);
@@ -684,6 +1062,7 @@ void midend_new_game(midend *me)
     me->states[me->nstates].movetype = NEWGAME;
     me->nstates++;
     me->statepos = 1;
+    me->hot_lo = me->hot_hi = 0;
     me->drawstate = me->ourgame->new_drawstate(me->drawing,
 					       me->states[0].state);
     me->first_draw = true;
@@ -704,6 +1083,82 @@ void midend_new_game(midend *me)
     me->newgame_can_store_undo = true;
 }
 
+/*
+ * Generate a new game from the current params, exactly as
+ * midend_new_game would from a fresh random seed, but without
+ * starting it or disturbing the game in progress. Returns the random
+ * seed (in the midend_get_random_seed format, including the full
+ * params), the game description and the aux_info (possibly NULL), all
+ * dynamically allocated.
+ *
+ * The results can be passed to midend_supply_game, in this midend or
+ * another one for the same puzzle, to start that game later without
+ * waiting for generation. (This allows a front end to generate games
+ * ahead of time.)
+ */
+void midend_generate_game(midend *me, char **seed, char **desc,
+                          char **aux_info)
+{
+    char *seedstr, *parstr;
+    random_state *rs;
+
+    seedstr = midend_new_seed(me);
+    rs = random_new(seedstr, strlen(seedstr));
+    *aux_info = NULL;
+    *desc = midend_call_new_desc(me, me->params, rs, aux_info);
+    assert_printable_ascii(*desc);
+    random_free(rs);
+
+    parstr = encode_params(me, me->params, true);
+    *seed = snewn(strlen(parstr) + strlen(seedstr) + 2, char);
+    sprintf(*seed, "%s#%s", parstr, seedstr);
+    sfree(parstr);
+    sfree(seedstr);
+}
+
+/*
+ * Arrange for the next midend_new_game to start the game previously
+ * generated by midend_generate_game, rather than generating a new
+ * one. Unlike midend_game_id, this leaves me->params unchanged, and
+ * the new game (once started) can be undone like any other.
+ *
+ * Returns an error, and changes nothing, if the seed or description
+ * is invalid.
+ */
+const char *midend_supply_game(midend *me, const char *seed,
+                               const char *desc, const char *aux_info)
+{
+    const char *hash = strchr(seed, '#'), *error;
+    game_params *params;
+    char *parstr;
+
+    if (!hash)
+        return "Pregenerated game has no random seed";
+
+    parstr = snewn(hash - seed + 1, char);
+    memcpy(parstr, seed, hash - seed);
+    parstr[hash - seed] = '\0';
+    params = me->ourgame->default_params();
+    me->ourgame->decode_params(params, parstr);
+    sfree(parstr);
+
+    error = me->ourgame->validate_params(params, true);
+    if (!error)
+        error = me->ourgame->validate_desc(params, desc);
+    if (error) {
+        me->ourgame->free_params(params);
+        return error;
+    }
+
+    midend_free_pregen(me);
+    me->pregen_params = params;
+    me->pregen_seedstr = dupstr(hash + 1);
+    me->pregen_desc = dupstr(desc);
+    me->pregen_aux_info = aux_info ? dupstr(aux_info) : NULL;
+    me->genmode = GOT_PREGEN;
+    return NULL;
+}
+
 const char *midend_load_prefs(
     midend *me, bool (*read)(void *ctx, void *buf, int len), void *rctx)
 {
@@ -720,7 +1175,8 @@ void midend_save_prefs(midend *me,
 
 bool midend_can_undo(midend *me)
 {
-    return (me->statepos > 1 || me->newgame_undo.len);
+    return (me->statepos > 1 || me->newgame_undo.len ||
+            me->newgame_snapshot);
 }
 
 bool midend_can_redo(midend *me)
@@ -801,13 +1257,16 @@ static bool midend_undo(midend *me)
                                        me->states[me->statepos-1].state,
                                        me->states[me->statepos-2].state);
 	me->statepos--;
+        midend_compact_states(me);
         me->dir = -1;
         return true;
-    } else if (me->newgame_undo.len) {
+    } else if (me->newgame_undo.len || me->newgame_snapshot) {
 	struct midend_serialise_buf_read_ctx rctx;
 	struct newgame_undo_deserialise_check_ctx cctx;
         struct midend_serialise_buf serbuf;
 
+        midend_flush_newgame_snapshot(me);
+
         /*
          * Serialise the current game so that you can later redo past
          * this undo. Once we're committed to the undo actually
@@ -875,6 +1334,7 @@ static bool midend_redo(midend *me)
                                        me->states[me->statepos-1].state,
                                        me->states[me->statepos].state);
 	me->statepos++;
+        midend_compact_states(me);
         me->dir = +1;
         return true;
     } else if (me->newgame_redo.len) {
@@ -929,6 +1389,7 @@ static bool midend_redo(midend *me)
              * the midend so that we can undo back into it later.
              */
             me->newgame_undo.len = 0;
+            midend_free_newgame_snapshot(me);
             midend_serialise_buf_write(&me->newgame_undo,
                                        serbuf.buf, serbuf.len);
 
@@ -1007,6 +1468,7 @@ void midend_restart_game(midend *me)
     me->states[me->nstates].movestr = dupstr(me->desc);
     me->states[me->nstates].movetype = RESTART;
     me->statepos = ++me->nstates;
+    midend_compact_states(me);
     if (me->ui)
         me->ourgame->changed_state(me->ui,
                                    me->states[me->statepos-2].state,
@@ -1019,6 +1481,7 @@ void midend_restart_game(midend *me)
 
 static int midend_really_process_key(midend *me, int x, int y, int button)
 {
+    double t = midend_trace_begin(me), t2;
     game_state *oldstate =
         me->ourgame->dup_game(me->states[me->statepos - 1].state);
     int type = MOVE;
@@ -1040,9 +1503,12 @@ static int midend_really_process_key(midend *me, int x, int y, int button)
     }
 
     if (!IS_UI_FAKE_KEY(button)) {
+        midend_refresh_drawstate(me);
+        t2 = midend_trace_begin(me);
         movestr = me->ourgame->interpret_move(
             me->states[me->statepos-1].state,
             me->ui, me->drawstate, x, y, button);
+        midend_trace_end(me, "interpret_move", t2);
     }
 
     if (movestr == NULL || movestr == MOVE_UNUSED) {
@@ -1090,8 +1556,10 @@ static int midend_really_process_key(midend *me, int x, int y, int button)
 	    s = me->states[me->statepos-1].state;
 	else {
 	    assert_printable_ascii(movestr);
+            t2 = midend_trace_begin(me);
 	    s = me->ourgame->execute_move(me->states[me->statepos-1].state,
 					  movestr);
+            midend_trace_end(me, "execute_move", t2);
 	    assert(s != NULL);
 	}
 
@@ -1113,11 +1581,15 @@ static int midend_really_process_key(midend *me, int x, int y, int button)
             me->states[me->nstates].movestr = movestr;
             me->states[me->nstates].movetype = MOVE;
             me->statepos = ++me->nstates;
+            midend_compact_states(me);
             me->dir = +1;
-	    if (me->ui)
+	    if (me->ui) {
+                t2 = midend_trace_begin(me);
 		me->ourgame->changed_state(me->ui,
 					   me->states[me->statepos-2].state,
 					   me->states[me->statepos-1].state);
+                midend_trace_end(me, "changed_state", t2);
+            }
         } else {
             goto done;
         }
@@ -1153,6 +1625,7 @@ static int midend_really_process_key(midend *me, int x, int y, int button)
 
     done:
     if (oldstate) me->ourgame->free_game(oldstate);
+    midend_trace_end(me, "process_key", t);
     return ret;
 }
 
@@ -1361,8 +1834,16 @@ void midend_redraw(midend *me)
 {
     assert(me->drawing);
 
+    if (me->redraws_deferred) {
+        me->redraw_pending = true;
+        return;
+    }
+
     if (me->statepos > 0 && me->drawstate) {
-        bool first_draw = me->first_draw;
+        bool first_draw;
+        midend_refresh_drawstate(me);
+        first_draw = me->first_draw;
+        double t;
         me->first_draw = false;
 
         start_draw(me->drawing);
@@ -1380,6 +1861,7 @@ void midend_redraw(midend *me)
             draw_rect(me->drawing, 0, 0, me->winwidth, me->winheight, 0);
         }
 
+        t = midend_trace_begin(me);
         if (me->oldstate && me->anim_time > 0 &&
             me->anim_pos < me->anim_time) {
             assert(me->dir != 0);
@@ -1391,6 +1873,7 @@ void midend_redraw(midend *me)
 				me->states[me->statepos-1].state, +1 /*shrug*/,
 				me->ui, 0.0, me->flash_pos);
         }
+        midend_trace_end(me, "redraw", t);
 
         if (first_draw) {
             /*
@@ -1404,6 +1887,23 @@ void midend_redraw(midend *me)
     }
 }
 
+/*
+ * For front ends feeding the midend a batch of input at once, and
+ * only interested in drawing the result. While redraws are deferred,
+ * midend_redraw just notes that one is wanted; turning deferral off
+ * again does that redraw, if any. (Since every game's redraw function
+ * draws whatever's changed since the last time, that single redraw
+ * catches up with everything skipped.)
+ */
+void midend_defer_redraws(midend *me, bool defer)
+{
+    me->redraws_deferred = defer;
+    if (!defer && me->redraw_pending) {
+        me->redraw_pending = false;
+        midend_redraw(me);
+    }
+}
+
 /*
  * Nasty hacky function used to implement the --redo option in
  * gtk.c. Only used for generating the puzzles' icons.
@@ -1418,6 +1918,12 @@ void midend_freeze_timer(midend *me, float tprop)
 void midend_timer(midend *me, float tplus)
 {
     bool need_redraw = (me->anim_time > 0 || me->flash_time > 0);
+    double t = 0.0;
+
+    /* Only animation frames are traced: ticks of the game clock alone
+     * would soon crowd everything else out of the trace. */
+    if (need_redraw)
+        t = midend_trace_begin(me);
 
     me->anim_pos += tplus;
     if (me->anim_pos >= me->anim_time ||
@@ -1431,8 +1937,10 @@ void midend_timer(midend *me, float tplus)
 	me->flash_pos = me->flash_time = 0;
     }
 
-    if (need_redraw)
+    if (need_redraw) {
         midend_redraw(me);
+        midend_trace_end(me, "timer", t);
+    }
 
     if (me->timing) {
 	float oldelapsed = me->elapsed;
@@ -1722,6 +2230,31 @@ void midend_request_params_changes(midend *me, void (*notify)(void *), void *ctx
     me->game_params_change_notify_ctx = ctx;
 }
 
+/*
+ * Ask for progress reports during game generation: notify is called
+ * with 0 before new_desc starts, with any intermediate estimates the
+ * game makes (never decreasing), and with 1 when it's finished.
+ */
+void midend_request_generation_progress(
+    midend *me, void (*notify)(void *ctx, float done), void *ctx)
+{
+    me->generation_progress_notify_function = notify;
+    me->generation_progress_notify_ctx = ctx;
+}
+
+/*
+ * Ask for progress reports from slow solvers during midend_solve (and
+ * midend_precompute_solution): notify is called with the solver's
+ * estimates, and can return true to make it give up, in which case
+ * midend_solve returns "Solver interrupted".
+ */
+void midend_request_solve_progress(
+    midend *me, bool (*notify)(void *ctx, float done), void *ctx)
+{
+    me->solve_progress_notify_function = notify;
+    me->solve_progress_notify_ctx = ctx;
+}
+
 bool midend_get_cursor_location(midend *me,
                                 int *x_out, int *y_out,
                                 int *w_out, int *h_out)
@@ -1730,12 +2263,14 @@ bool midend_get_cursor_location(midend *me,
     x = y = -1;
     w = h = 1;
 
-    if(me->ourgame->get_cursor_location)
+    if(me->ourgame->get_cursor_location) {
+        midend_refresh_drawstate(me);
         me->ourgame->get_cursor_location(me->ui,
                                          me->drawstate,
                                          me->states[me->statepos-1].state,
                                          me->params,
                                          &x, &y, &w, &h);
+    }
 
     if(x == -1 && y == -1)
         return false;
@@ -1760,6 +2295,44 @@ void midend_get_move_count(midend *me, int *current, int *total)
         *total = me->nstates - 1;
 }
 
+/*
+ * Jump straight to move number 'move' (counted as in
+ * midend_get_move_count) of the current undo chain, as if by that
+ * many undos or redos but without the intermediate positions: so
+ * changed_state only sees the start and end, and there is one redraw
+ * and no animation or flash. Doesn't cross into the game before or
+ * after a New Game, as undo and redo can. Returns true if the
+ * position changed.
+ */
+bool midend_goto_move(midend *me, int move)
+{
+    int pos = move + 1;
+
+    if (pos < 1 || pos > me->nstates || pos == me->statepos)
+        return false;
+
+    midend_stop_anim(me);
+
+    /*
+     * Rebuild the target state before moving, so that changed_state
+     * can compare the two. Compaction then tidies up around the new
+     * position, as it would after the last of a run of undos.
+     */
+    midend_replay_state(me, pos - 1);
+    if (me->ui)
+        me->ourgame->changed_state(me->ui,
+                                   me->states[me->statepos-1].state,
+                                   me->states[pos-1].state);
+    me->statepos = pos;
+    midend_compact_states(me);
+
+    me->dir = 0;
+    me->anim_pos = me->anim_time = 0;
+    midend_redraw(me);
+    midend_set_timer(me);
+    return true;
+}
+
 void midend_supersede_game_desc(midend *me, const char *desc,
                                 const char *privdesc)
 {
@@ -1771,6 +2344,8 @@ void midend_supersede_game_desc(midend *me, const char *desc,
     sfree(me->privdesc);
     me->desc = dupstr(desc);
     me->privdesc = privdesc ? dupstr(privdesc) : NULL;
+    sfree(me->solution);
+    me->solution = NULL;
     if (me->game_id_change_notify_function)
         me->game_id_change_notify_function(me->game_id_change_notify_ctx);
 }
@@ -2015,6 +2590,7 @@ static const char *midend_game_id_int(midend *me, const char *id, int defmode)
     me->desc = me->privdesc = NULL;
     sfree(me->seedstr);
     me->seedstr = NULL;
+    midend_free_pregen(me);
 
     if (desc) {
         me->desc = dupstr(desc);
@@ -2126,48 +2702,34 @@ char *midend_text_format(midend *me)
 	return NULL;
 }
 
-const char *midend_solve(midend *me)
+/*
+ * Enter a move string from the back end's solve() or solve_step() as
+ * the next move, after the current one.
+ */
+static void midend_enter_solver_move(midend *me, char *movestr, int movetype)
 {
     game_state *s;
-    const char *msg;
-    char *movestr;
-
-    if (!me->ourgame->can_solve)
-	return "This game does not support the Solve operation";
-
-    if (me->statepos < 1)
-	return "No game set up to solve";   /* _shouldn't_ happen! */
 
-    msg = NULL;
-    movestr = me->ourgame->solve(me->states[0].state,
-				 me->states[me->statepos-1].state,
-				 me->aux_info, &msg);
     assert(movestr != MOVE_UI_UPDATE);
-    if (!movestr) {
-	if (!msg)
-	    msg = "Solve operation failed";   /* _shouldn't_ happen, but can */
-	return msg;
-    }
     assert_printable_ascii(movestr);
     s = me->ourgame->execute_move(me->states[me->statepos-1].state, movestr);
     assert(s);
 
-    /*
-     * Now enter the solved state as the next move.
-     */
     midend_stop_anim(me);
     midend_purge_states(me);
     ensure(me);
     me->states[me->nstates].state = s;
     me->states[me->nstates].movestr = movestr;
-    me->states[me->nstates].movetype = SOLVE;
+    me->states[me->nstates].movetype = movetype;
     me->statepos = ++me->nstates;
+    midend_compact_states(me);
     if (me->ui)
         me->ourgame->changed_state(me->ui,
                                    me->states[me->statepos-2].state,
                                    me->states[me->statepos-1].state);
     me->dir = +1;
-    if (me->ourgame->flags & SOLVE_ANIMATES) {
+    /* A hint is an ordinary move, so animates like one. */
+    if (movetype != SOLVE || (me->ourgame->flags & SOLVE_ANIMATES)) {
 	me->oldstate = me->ourgame->dup_game(me->states[me->statepos-2].state);
         me->anim_time =
 	    me->ourgame->anim_length(me->states[me->statepos-2].state,
@@ -2181,19 +2743,164 @@ const char *midend_solve(midend *me)
     if (me->drawing)
         midend_redraw(me);
     midend_set_timer(me);
-    return NULL;
 }
 
-int midend_status(midend *me)
+static bool midend_solve_progress(void *ctx, float done)
 {
-    /*
-     * We should probably never be called when the state stack has no
-     * states on it at all - ideally, midends should never be left in
-     * that state for long enough to get put down and forgotten about.
-     * But if we are, I think we return _true_ - pedantically speaking
-     * a midend in that state is 'vacuously solved', and more
-     * practically, a user whose midend has been left in that state
-     * probably _does_ want the 'new game' option to be prominent.
+    midend *me = (midend *)ctx;
+
+    /* Once the front end has said stop, keep saying it, so that a
+     * recursive solver unwinds all the way out. */
+    if (!me->solve_interrupted &&
+        me->solve_progress_notify_function(
+            me->solve_progress_notify_ctx, done))
+        me->solve_interrupted = true;
+    return me->solve_interrupted;
+}
+
+/*
+ * Call the game's solve, passing on any progress reports it makes
+ * (and giving the front end the chance to stop it) if the front end
+ * has asked for them. An interrupted solve can still succeed, if the
+ * solver had found a solution and was only checking it was unique.
+ */
+static char *midend_call_solve(midend *me, const game_state *orig,
+                               const game_state *curr, const char *aux,
+                               const char **error)
+{
+    char *movestr;
+
+    me->solve_interrupted = false;
+    if (!me->solve_progress_notify_function)
+        return me->ourgame->solve(orig, curr, aux, error);
+
+    set_solver_progress_hook(midend_solve_progress, me);
+    movestr = me->ourgame->solve(orig, curr, aux, error);
+    set_solver_progress_hook(NULL, NULL);
+    if (!movestr && me->solve_interrupted)
+        *error = "Solver interrupted";
+    return movestr;
+}
+
+const char *midend_solve(midend *me)
+{
+    const char *msg;
+    char *movestr;
+    double t;
+
+    if (!me->ourgame->can_solve)
+	return "This game does not support the Solve operation";
+
+    if (me->statepos < 1)
+	return "No game set up to solve";   /* _shouldn't_ happen! */
+
+    if (me->solution) {
+        /* Worked out earlier by midend_precompute_solution. */
+        midend_enter_solver_move(me, dupstr(me->solution), SOLVE);
+        return NULL;
+    }
+
+    msg = NULL;
+    t = midend_trace_begin(me);
+    movestr = midend_call_solve(me, me->states[0].state,
+                                me->states[me->statepos-1].state,
+                                me->aux_info, &msg);
+    midend_trace_end(me, "solve", t);
+    if (!movestr) {
+	if (!msg)
+	    msg = "Solve operation failed";   /* _shouldn't_ happen, but can */
+	return msg;
+    }
+
+    /*
+     * Now enter the solved state as the next move.
+     */
+    midend_enter_solver_move(me, movestr, SOLVE);
+    return NULL;
+}
+
+void midend_precompute_solution(midend *me)
+{
+    const char *msg = NULL;
+    char *movestr;
+    double t;
+
+    /*
+     * Only worth doing for a game whose solve() doesn't look at the
+     * current state, and which doesn't already have aux_info to make
+     * solve() quick.
+     */
+    if (!me->ourgame->can_solve || !(me->ourgame->flags & SOLVE_FROM_ORIG) ||
+        me->statepos < 1 || me->solution || me->aux_info)
+        return;
+
+    t = midend_trace_begin(me);
+    movestr = midend_call_solve(me, me->states[0].state,
+                                me->states[0].state, NULL, &msg);
+    midend_trace_end(me, "precompute_solution", t);
+
+    /* On failure, leave midend_solve to report the error in due course. */
+    if (movestr) {
+        assert(movestr != MOVE_UI_UPDATE);
+        me->solution = movestr;
+    }
+}
+
+bool midend_speculate(midend *me)
+{
+    bool more;
+    double t;
+
+    if (!me->ourgame->speculate || me->statepos < 1)
+        return false;
+
+    t = midend_trace_begin(me);
+    more = me->ourgame->speculate(me->states[me->statepos-1].state);
+    midend_trace_end(me, "speculate", t);
+    return more;
+}
+
+const char *midend_hint(midend *me)
+{
+    const char *msg;
+    char *movestr;
+    double t;
+
+    if (!me->ourgame->solve_step)
+	return "This game does not support hints";
+
+    if (me->statepos < 1)
+	return "No game set up to give a hint for";
+
+    if (me->ourgame->status(me->states[me->statepos-1].state) > 0)
+	return "Puzzle is already solved";
+
+    msg = NULL;
+    t = midend_trace_begin(me);
+    movestr = me->ourgame->solve_step(me->states[0].state,
+				      me->states[me->statepos-1].state,
+				      me->aux_info, &msg);
+    midend_trace_end(me, "hint", t);
+    if (!movestr) {
+	if (!msg)
+	    msg = "No hint available";
+	return msg;
+    }
+
+    midend_enter_solver_move(me, movestr, MOVE);
+    return NULL;
+}
+
+int midend_status(midend *me)
+{
+    /*
+     * We should probably never be called when the state stack has no
+     * states on it at all - ideally, midends should never be left in
+     * that state for long enough to get put down and forgotten about.
+     * But if we are, I think we return _true_ - pedantically speaking
+     * a midend in that state is 'vacuously solved', and more
+     * practically, a user whose midend has been left in that state
+     * probably _does_ want the 'new game' option to be prominent.
      */
     if (me->statepos == 0)
         return +1;
@@ -2234,14 +2941,8 @@ char *midend_rewrite_statusbar(midend *me, const char *text)
 #define SERIALISE_MAGIC "Simon Tatham's Portable Puzzle Collection"
 #define SERIALISE_VERSION "1"
 
-void midend_serialise(midend *me,
-                      void (*write)(void *ctx, const void *buf, int len),
-                      void *wctx)
-{
-    int i;
-
-    /*
-     * Each line of the save file contains three components. First
+/*
+ * Each line of the save file contains three components. First
      * exactly 8 characters of header word indicating what type of
      * data is contained on the line; then a colon followed by a
      * decimal integer giving the length of the main string on the
@@ -2249,6 +2950,43 @@ void midend_serialise(midend *me,
      * many bytes as previously specified, no matter what they
      * contain). Then a newline (of reasonably flexible form).
      */
+/*
+ * Save files obfuscate anything that would give away the answer to the
+ * puzzle (people are likely to run `head' or similar on a saved game
+ * file simply to find out what it is, and don't necessarily want to
+ * be told the answer!). hide_spoiler() returns the hex-encoded
+ * obfuscated form of a string, and unhide_spoiler() reverses it.
+ */
+static char *hide_spoiler(const char *str)
+{
+    unsigned char *s1;
+    char *s2;
+    int len;
+
+    len = strlen(str);
+    s1 = snewn(len, unsigned char);
+    memcpy(s1, str, len);
+    obfuscate_bitmap(s1, len*8, false);
+    s2 = bin2hex(s1, len);
+    sfree(s1);
+    return s2;
+}
+
+static char *unhide_spoiler(const char *hex)
+{
+    unsigned char *tmp;
+    char *str;
+    int len = strlen(hex) / 2;   /* length in bytes */
+
+    tmp = hex2bin(hex, len);
+    obfuscate_bitmap(tmp, len*8, true);
+    str = snewn(len + 1, char);
+    memcpy(str, tmp, len);
+    str[len] = '\0';
+    sfree(tmp);
+    return str;
+}
+
 #define wr(h,s) do { \
     char hbuf[80]; \
     const char *str = (s); \
@@ -2262,13 +3000,14 @@ void midend_serialise(midend *me,
     write(wctx, "\n", 1); \
 } while (0)
 
-    /*
-     * Magic string identifying the file, and version number of the
-     * file format.
-     */
-    wr("SAVEFILE", SERIALISE_MAGIC);
-    wr("VERSION", SERIALISE_VERSION);
-
+/*
+ * Write everything about the game apart from its states list. None of
+ * it depends on how long the game has been going on.
+ */
+static void midend_serialise_header(
+    midend *me, void (*write)(void *ctx, const void *buf, int len),
+    void *wctx)
+{
     /*
      * The game name. (Copied locally to avoid const annoyance.)
      */
@@ -2326,26 +3065,18 @@ void midend_serialise(midend *me,
         wr("PRIVDESC", me->privdesc);
 
     /*
-     * The game's aux_info. We obfuscate this to prevent spoilers
-     * (people are likely to run `head' or similar on a saved game
-     * file simply to find out what it is, and don't necessarily
-     * want to be told the answer to the puzzle!)
+     * The game's aux_info, and any precomputed solution, obfuscated
+     * to prevent spoilers.
      */
     if (me->aux_info) {
-        unsigned char *s1;
-        char *s2;
-        int len;
-
-        len = strlen(me->aux_info);
-        s1 = snewn(len, unsigned char);
-        memcpy(s1, me->aux_info, len);
-        obfuscate_bitmap(s1, len*8, false);
-        s2 = bin2hex(s1, len);
-
-        wr("AUXINFO", s2);
-
-        sfree(s2);
-        sfree(s1);
+        char *hidden = hide_spoiler(me->aux_info);
+        wr("AUXINFO", hidden);
+        sfree(hidden);
+    }
+    if (me->solution) {
+        char *hidden = hide_spoiler(me->solution);
+        wr("SOLUTION", hidden);
+        sfree(hidden);
     }
 
     /*
@@ -2367,16 +3098,30 @@ void midend_serialise(midend *me,
         sprintf(buf, "%g", me->elapsed);
         wr("TIME", buf);
     }
+}
+
+/*
+ * Write the length of and position in a states list, followed by
+ * states [from,nstates). Apart from the checkpoints, only the move
+ * strings are used, so this works for midend_newgame_snapshot's
+ * states list too.
+ */
+static void midend_serialise_state_list(
+    const game *ourgame, const struct midend_state_entry *states,
+    int nstates, int statepos, int from,
+    void (*write)(void *ctx, const void *buf, int len), void *wctx)
+{
+    int i;
 
     /*
      * The length of, and position in, the states list.
      */
     {
         char buf[80];
-        sprintf(buf, "%d", me->nstates);
+        sprintf(buf, "%d", nstates);
         wr("NSTATES", buf);
-        assert(me->statepos >= 1 && me->statepos <= me->nstates);
-        sprintf(buf, "%d", me->statepos);
+        assert(statepos >= 1 && statepos <= nstates);
+        sprintf(buf, "%d", statepos);
         wr("STATEPOS", buf);
     }
 
@@ -2386,22 +3131,574 @@ void midend_serialise(midend *me,
      * information for execute_move() to reconstruct it from the
      * previous one.
      */
-    for (i = 1; i < me->nstates; i++) {
-        assert(me->states[i].movetype != NEWGAME);   /* only state 0 */
-        switch (me->states[i].movetype) {
+    for (i = max(from, 1); i < nstates; i++) {
+        assert(states[i].movetype != NEWGAME);   /* only state 0 */
+        if (i % MIDEND_SAVE_CHECKPOINT_INTERVAL == 0 && states[i].state &&
+            ourgame->encode_state) {
+            char *s = ourgame->encode_state(states[i].state);
+            wr("STATE", s);
+            sfree(s);
+        }
+        switch (states[i].movetype) {
           case MOVE:
-            wr("MOVE", me->states[i].movestr);
+            wr("MOVE", states[i].movestr);
             break;
           case SOLVE:
-            wr("SOLVE", me->states[i].movestr);
+            wr("SOLVE", states[i].movestr);
             break;
           case RESTART:
-            wr("RESTART", me->states[i].movestr);
+            wr("RESTART", states[i].movestr);
             break;
         }
     }
+}
+
+static void midend_serialise_states(
+    midend *me, int from, void (*write)(void *ctx, const void *buf, int len),
+    void *wctx)
+{
+    midend_serialise_state_list(me->ourgame, me->states, me->nstates,
+                                me->statepos, from, write, wctx);
+}
+
+void midend_serialise(midend *me,
+                      void (*write)(void *ctx, const void *buf, int len),
+                      void *wctx)
+{
+    double t = midend_trace_begin(me);
+
+    /*
+     * Magic string identifying the file, and version number of the
+     * file format.
+     */
+    wr("SAVEFILE", SERIALISE_MAGIC);
+    wr("VERSION", SERIALISE_VERSION);
+
+    midend_serialise_header(me, write, wctx);
+    midend_serialise_states(me, 1, write, wctx);
+
+    midend_trace_end(me, "serialise", t);
+}
+
+/*
+ * Incremental saving, for front ends which save the game after every
+ * move. This writes either a complete save file, exactly as
+ * midend_serialise would, or a change record to be appended to what
+ * it wrote last time. A change record repeats the header (which is
+ * short), but only lists the states added since last time, after a
+ * count of how many of the earlier states are still current. So the
+ * cost of each save is independent of the length of the undo chain.
+ *
+ * A save file followed by any number of change records is loaded by
+ * midend_deserialise just as a complete save would be.
+ *
+ * A complete save is written the first time, if the states have been
+ * replaced since last time (by a new game or a load), or if the
+ * caller asks for one with 'full', which it should do every so often
+ * to stop the records piling up. Returns true if it wrote a complete
+ * save, false if a change record.
+ */
+bool midend_serialise_changes(
+    midend *me, bool full, void (*write)(void *ctx, const void *buf, int len),
+    void *wctx)
+{
+    double t = midend_trace_begin(me);
+    int keep = me->saved_nstates;
+
+    if (full || keep < 1) {
+        wr("SAVEFILE", SERIALISE_MAGIC);
+        wr("VERSION", SERIALISE_VERSION);
+        keep = 1;
+        full = true;
+    } else {
+        char buf[80];
+        sprintf(buf, "%d", keep);
+        wr("CHANGES", buf);
+    }
+    midend_serialise_header(me, write, wctx);
+    midend_serialise_states(me, keep, write, wctx);
+    me->saved_nstates = me->nstates;
+
+    midend_trace_end(me, "serialise", t);
+    return full;
+}
+
+/*
+ * Take the game in progress (with its redo states already purged)
+ * into me->newgame_snapshot, leaving the midend with no states.
+ */
+static void midend_snapshot_game(midend *me)
+{
+    struct midend_newgame_snapshot *snap;
+    size_t size;
+    int i;
+
+    assert(!me->newgame_snapshot);
+    if (me->nstates < 1)
+        return;
+
+    snap = snew(struct midend_newgame_snapshot);
+    snap->header.buf = NULL;
+    snap->header.len = snap->header.size = 0;
+    midend_serialise_header(me, midend_serialise_buf_write, &snap->header);
+
+    size = snap->header.len;
+    for (i = 0; i < me->nstates; i++) {
+        if (me->states[i].state)
+            me->ourgame->free_game(me->states[i].state);
+        me->states[i].state = NULL;
+        if (me->states[i].movestr)
+            size += strlen(me->states[i].movestr);
+    }
+    snap->states = me->states;
+    snap->nstates = me->nstates;
+    snap->statepos = me->statepos;
+    me->states = NULL;
+    me->nstates = me->statesize = me->statepos = 0;
+    me->saved_nstates = 0;
+    me->newgame_snapshot = snap;
+
+    if (size > MIDEND_NEWGAME_UNDO_BUDGET)
+        midend_free_newgame_snapshot(me);
+}
+
+static void midend_free_newgame_snapshot(midend *me)
+{
+    struct midend_newgame_snapshot *snap = me->newgame_snapshot;
+    int i;
+
+    if (!snap)
+        return;
+    for (i = 0; i < snap->nstates; i++)
+        sfree(snap->states[i].movestr);
+    sfree(snap->states);
+    sfree(snap->header.buf);
+    sfree(snap);
+    me->newgame_snapshot = NULL;
+}
+
+/*
+ * Turn me->newgame_snapshot, if there is one, into the save file in
+ * me->newgame_undo that midend_serialise would have written.
+ */
+static void midend_flush_newgame_snapshot(midend *me)
+{
+    struct midend_newgame_snapshot *snap = me->newgame_snapshot;
+    void (*write)(void *ctx, const void *buf, int len) =
+        midend_serialise_buf_write;
+    void *wctx = &me->newgame_undo;
+
+    if (!snap)
+        return;
+    me->newgame_undo.len = 0;
+    wr("SAVEFILE", SERIALISE_MAGIC);
+    wr("VERSION", SERIALISE_VERSION);
+    write(wctx, snap->header.buf, snap->header.len);
+    midend_serialise_state_list(me->ourgame, snap->states, snap->nstates,
+                                snap->statepos, 1, write, wctx);
+    midend_free_newgame_snapshot(me);
+}
 
 #undef wr
+
+/*
+ * The compact binary save format. This is a different encoding of the
+ * same sequence of records as the text format above, so it's made by
+ * transcoding what midend_serialise writes, and read by transcoding
+ * back to text for midend_deserialise_internal, a record at a time.
+ *
+ * A binary stream starts with BINSAVE_MAGIC, which includes a version
+ * byte, and then has one record after another, each of which is:
+ *
+ *  - a byte giving the record's key, as 1 + its index in
+ *    binsave_keys[], or 0 followed by the key's 8 bytes as in the text
+ *    format if it isn't in there;
+ *
+ *  - then, for SAVEFILE, nothing, as the value is always
+ *    SERIALISE_MAGIC;
+ *
+ *  - for MOVE, a byte whose top four bits index a ring of the last
+ *    BINSAVE_DICT moves, and bottom four the length of the prefix
+ *    this move shares with that one (0 if none), followed by the
+ *    length of the rest of the move as a varint, and then the rest of
+ *    the move;
+ *
+ *  - for anything else, the value's length as a varint, followed by
+ *    the value.
+ *
+ * Varints are little-endian base 128, with the top bit of each byte
+ * set if another follows. The magic may be repeated at the start of
+ * any record, which resets the ring, so that change records from
+ * midend_serialise_changes can be appended as in the text format.
+ *
+ * Keys may only be added to the end of binsave_keys[], and the
+ * version byte must change if anything else does.
+ */
+#define BINSAVE_MAGIC "\x80SGT\x01"
+#define BINSAVE_MAGIC_LEN 5
+#define BINSAVE_DICT 16
+
+static const char *const binsave_keys[] = {
+    "SAVEFILE", "VERSION", "GAME", "PARAMS", "CPARAMS", "SEED", "HEXSEED",
+    "DESC", "PRIVDESC", "AUXINFO", "SOLUTION", "UI", "TIME", "NSTATES",
+    "STATEPOS", "MOVE", "SOLVE", "RESTART", "STATE", "CHANGES",
+};
+#define BINSAVE_KEY_SAVEFILE 1
+#define BINSAVE_KEY_MOVE 16
+
+struct binsave_dict {
+    char *moves[BINSAVE_DICT];
+    int next;
+};
+
+static void binsave_dict_add(struct binsave_dict *dict, const char *move,
+                             int len)
+{
+    sfree(dict->moves[dict->next]);
+    dict->moves[dict->next] = snewn(len + 1, char);
+    memcpy(dict->moves[dict->next], move, len);
+    dict->moves[dict->next][len] = '\0';
+    dict->next = (dict->next + 1) % BINSAVE_DICT;
+}
+
+static void binsave_dict_free(struct binsave_dict *dict)
+{
+    int i;
+
+    for (i = 0; i < BINSAVE_DICT; i++) {
+        sfree(dict->moves[i]);
+        dict->moves[i] = NULL;
+    }
+    dict->next = 0;
+}
+
+struct binsave_writer {
+    void (*write)(void *ctx, const void *buf, int len);
+    void *wctx;
+    bool started;
+    /* The text record we're part way through. */
+    char key[9];
+    int keylen, len;
+    bool inval;
+    struct midend_serialise_buf val;
+    struct binsave_dict dict;
+};
+
+binsave_writer *binsave_writer_new(
+    void (*write)(void *ctx, const void *buf, int len), void *wctx)
+{
+    binsave_writer *bw = snew(binsave_writer);
+
+    bw->write = write;
+    bw->wctx = wctx;
+    bw->started = false;
+    bw->keylen = bw->len = 0;
+    bw->inval = false;
+    bw->val.buf = NULL;
+    bw->val.len = bw->val.size = 0;
+    memset(&bw->dict, 0, sizeof(bw->dict));
+    return bw;
+}
+
+void binsave_writer_free(binsave_writer *bw)
+{
+    assert(bw->keylen == 0);           /* no record left half-written */
+    binsave_dict_free(&bw->dict);
+    sfree(bw->val.buf);
+    sfree(bw);
+}
+
+static void binsave_put_varint(binsave_writer *bw, unsigned val)
+{
+    unsigned char buf[5];
+    int len = 0;
+
+    while (val >= 0x80) {
+        buf[len++] = 0x80 | (val & 0x7F);
+        val >>= 7;
+    }
+    buf[len++] = val;
+    bw->write(bw->wctx, buf, len);
+}
+
+static void binsave_put_record(binsave_writer *bw)
+{
+    const char *val = bw->val.buf;
+    unsigned char code = 0;
+    int i;
+
+    if (!bw->started) {
+        bw->write(bw->wctx, BINSAVE_MAGIC, BINSAVE_MAGIC_LEN);
+        bw->started = true;
+    }
+
+    for (i = 0; i < lenof(binsave_keys); i++)
+        if (!strcmp(bw->key, binsave_keys[i]))
+            code = i + 1;
+    bw->write(bw->wctx, &code, 1);
+    if (!code) {
+        char lbuf[9];
+        copy_left_justified(lbuf, sizeof(lbuf), bw->key);
+        bw->write(bw->wctx, lbuf, 8);
+    }
+
+    if (code == BINSAVE_KEY_SAVEFILE) {
+        assert(bw->len == strlen(SERIALISE_MAGIC) &&
+               !memcmp(val, SERIALISE_MAGIC, bw->len));
+    } else if (code == BINSAVE_KEY_MOVE) {
+        int best = 0, bestlen = 0;
+        unsigned char b;
+
+        for (i = 0; i < BINSAVE_DICT; i++) {
+            const char *m = bw->dict.moves[i];
+            int l;
+
+            if (!m)
+                continue;
+            for (l = 0; l < 15 && l < bw->len && m[l] == val[l]; l++);
+            if (l > bestlen) {
+                best = i;
+                bestlen = l;
+            }
+        }
+        b = bestlen ? (best << 4) | bestlen : 0;
+        bw->write(bw->wctx, &b, 1);
+        binsave_put_varint(bw, bw->len - bestlen);
+        bw->write(bw->wctx, val + bestlen, bw->len - bestlen);
+        binsave_dict_add(&bw->dict, val, bw->len);
+    } else {
+        binsave_put_varint(bw, bw->len);
+        bw->write(bw->wctx, val, bw->len);
+    }
+}
+
+/*
+ * The write function to pass to midend_serialise. This parses the
+ * text records as they go past, trusting them to be well formed,
+ * since it's the midend that's writing them.
+ */
+void binsave_write(void *ctx, const void *buf, int len)
+{
+    binsave_writer *bw = (binsave_writer *)ctx;
+    const char *p = (const char *)buf;
+
+    while (len > 0) {
+        if (bw->inval) {
+            int n = min(len, bw->len - bw->val.len);
+
+            midend_serialise_buf_write(&bw->val, p, n);
+            p += n;
+            len -= n;
+        } else if (bw->keylen < 9) {
+            if (bw->keylen > 0 || (*p != '\r' && *p != '\n'))
+                bw->key[bw->keylen++] = *p;
+            p++;
+            len--;
+            if (bw->keylen == 9) {
+                assert(bw->key[8] == ':');
+                bw->key[strcspn(bw->key, ": ")] = '\0';
+                bw->len = 0;
+            }
+            continue;
+        } else {
+            if (*p == ':') {
+                bw->inval = true;
+                bw->val.len = 0;
+            } else {
+                assert(*p >= '0' && *p <= '9');
+                bw->len = bw->len * 10 + (*p - '0');
+            }
+            p++;
+            len--;
+        }
+
+        if (bw->inval && bw->val.len == bw->len) {
+            /* Terminate the value, so that even an empty one is there. */
+            midend_serialise_buf_write(&bw->val, "", 1);
+            binsave_put_record(bw);
+            bw->keylen = 0;
+            bw->inval = false;
+        }
+    }
+}
+
+/*
+ * Read either format for midend_deserialise and identify_game,
+ * handing on the text format as it is and the binary format
+ * transcoded back to text.
+ */
+struct save_reader {
+    bool (*read)(void *ctx, void *buf, int len);
+    void *rctx;
+    int first;                  /* byte read to check the format, or -1 */
+    bool binary, failed;
+    struct midend_serialise_buf text;    /* current record, as text */
+    int textpos;
+    struct binsave_dict dict;
+};
+
+/* Check the rest of the magic, once its first byte has been read. */
+static bool save_reader_magic(struct save_reader *sr)
+{
+    char magic[BINSAVE_MAGIC_LEN - 1];
+
+    return sr->read(sr->rctx, magic, BINSAVE_MAGIC_LEN - 1) &&
+        !memcmp(magic, BINSAVE_MAGIC + 1, BINSAVE_MAGIC_LEN - 1);
+}
+
+static void save_reader_init(struct save_reader *sr,
+                             bool (*read)(void *ctx, void *buf, int len),
+                             void *rctx)
+{
+    unsigned char c;
+
+    sr->read = read;
+    sr->rctx = rctx;
+    sr->first = -1;
+    sr->binary = sr->failed = false;
+    sr->text.buf = NULL;
+    sr->text.len = sr->text.size = sr->textpos = 0;
+    memset(&sr->dict, 0, sizeof(sr->dict));
+
+    if (!read(rctx, &c, 1))
+        sr->failed = true;
+    else if (c != (unsigned char)BINSAVE_MAGIC[0])
+        sr->first = c;
+    else if (save_reader_magic(sr))
+        sr->binary = true;
+    else
+        sr->failed = true;
+}
+
+static void save_reader_free(struct save_reader *sr)
+{
+    binsave_dict_free(&sr->dict);
+    sfree(sr->text.buf);
+}
+
+static bool save_reader_get_varint(struct save_reader *sr, int *val)
+{
+    unsigned char b;
+    unsigned v = 0;
+    int shift;
+
+    for (shift = 0; shift < 35; shift += 7) {
+        if (!sr->read(sr->rctx, &b, 1))
+            return false;
+        v |= (unsigned)(b & 0x7F) << shift;
+        if (!(b & 0x80))
+            break;
+    }
+    if (shift >= 35 || v > INT_MAX / 2)
+        return false;
+    *val = v;
+    return true;
+}
+
+/*
+ * Read the next binary record into sr->text. Returns false at the end
+ * of the data, or if it's corrupt.
+ */
+static bool save_reader_get_record(struct save_reader *sr)
+{
+    unsigned char code;
+    char key[9], hbuf[40];
+    int len, start, prefix = 0;
+
+    while (1) {
+        if (!sr->read(sr->rctx, &code, 1))
+            return false;
+        if (code != (unsigned char)BINSAVE_MAGIC[0])
+            break;
+        if (!save_reader_magic(sr))
+            return false;
+        binsave_dict_free(&sr->dict);
+    }
+
+    if (code == 0) {
+        if (!sr->read(sr->rctx, key, 8))
+            return false;
+        key[8] = '\0';
+    } else if (code <= lenof(binsave_keys)) {
+        copy_left_justified(key, sizeof(key), binsave_keys[code - 1]);
+    } else {
+        return false;
+    }
+
+    sr->text.len = sr->textpos = 0;
+    if (code == BINSAVE_KEY_SAVEFILE) {
+        len = strlen(SERIALISE_MAGIC);
+        sprintf(hbuf, "%s:%d:", key, len);
+        midend_serialise_buf_write(&sr->text, hbuf, strlen(hbuf));
+        midend_serialise_buf_write(&sr->text, SERIALISE_MAGIC, len);
+    } else {
+        const char *from = NULL;
+
+        if (code == BINSAVE_KEY_MOVE) {
+            unsigned char b;
+
+            if (!sr->read(sr->rctx, &b, 1))
+                return false;
+            prefix = b & 15;
+            from = sr->dict.moves[b >> 4];
+            if (prefix && (!from || strlen(from) < prefix))
+                return false;
+        }
+        if (!save_reader_get_varint(sr, &len))
+            return false;
+        sprintf(hbuf, "%s:%d:", key, prefix + len);
+        midend_serialise_buf_write(&sr->text, hbuf, strlen(hbuf));
+        start = sr->text.len;
+        if (prefix)
+            midend_serialise_buf_write(&sr->text, from, prefix);
+
+        /* Make room for the value, and read it straight in. */
+        if (len > sr->text.size - sr->text.len) {
+            sr->text.size = sr->text.len + len + 1024;
+            sr->text.buf = sresize(sr->text.buf, sr->text.size, char);
+        }
+        if (!sr->read(sr->rctx, sr->text.buf + sr->text.len, len))
+            return false;
+        sr->text.len += len;
+
+        if (code == BINSAVE_KEY_MOVE)
+            binsave_dict_add(&sr->dict, sr->text.buf + start, prefix + len);
+    }
+    midend_serialise_buf_write(&sr->text, "\n", 1);
+    return true;
+}
+
+static bool save_reader_read(void *ctx, void *buf, int len)
+{
+    struct save_reader *sr = (struct save_reader *)ctx;
+    unsigned char *p = (unsigned char *)buf;
+
+    if (sr->failed)
+        return false;
+
+    if (!sr->binary) {
+        if (sr->first >= 0 && len > 0) {
+            *p++ = sr->first;
+            len--;
+            sr->first = -1;
+        }
+        return len == 0 || sr->read(sr->rctx, p, len);
+    }
+
+    while (len > 0) {
+        int n;
+
+        if (sr->textpos == sr->text.len && !save_reader_get_record(sr)) {
+            sr->failed = true;
+            return false;
+        }
+        n = min(len, sr->text.len - sr->textpos);
+        memcpy(p, sr->text.buf + sr->textpos, n);
+        sr->textpos += n;
+        p += n;
+        len -= n;
+    }
+    return true;
 }
 
 /*
@@ -2419,44 +3716,61 @@ static const char *midend_deserialise_internal(
 {
     struct deserialise_data data;
     int gotstates = 0;
-    bool started = false;
-    int i;
+    bool started = false, changing = false, restored = false;
+    int i, from, to;
 
-    char *val = NULL;
+    char *val = NULL, *checkpoint = NULL;
     /* Initially all errors give the same report */
     const char *ret = "Data does not appear to be a saved game file";
 
     data.seed = data.parstr = data.desc = data.privdesc = NULL;
     data.auxinfo = data.uistr = data.cparstr = NULL;
+    data.solution = NULL;
     data.elapsed = 0.0F;
     data.params = data.cparams = NULL;
     data.ui = NULL;
     data.states = NULL;
     data.nstates = 0;
     data.statepos = -1;
+    data.checkpoints = NULL;
+    data.ncheckpoints = data.checkpointsize = 0;
 
     /*
      * Loop round and round reading one key/value pair at a time
      * from the serialised stream, until we have enough game states
-     * to finish.
+     * to finish, and then any change records (see
+     * midend_serialise_changes) after that.
      */
-    while (data.nstates <= 0 || data.statepos < 0 ||
-           gotstates < data.nstates-1) {
+    while (1) {
+        bool complete = data.nstates > 0 && data.statepos >= 0 &&
+            gotstates >= data.nstates-1;
         char key[9], c;
         int len;
 
         do {
             if (!read(rctx, key, 1)) {
+                if (complete)
+                    goto finished;
                 /* unexpected EOF */
                 goto cleanup;
             }
         } while (key[0] == '\r' || key[0] == '\n');
 
         if (!read(rctx, key+1, 8)) {
+            if (complete)
+                goto finished;
             /* unexpected EOF */
             goto cleanup;
         }
 
+        /*
+         * Once we have all the states, the only thing we read any
+         * further is a change record. (Anything else is ignored, as
+         * it was before there were any.)
+         */
+        if (complete && memcmp(key, "CHANGES :", 9))
+            goto finished;
+
         if (key[8] != ':') {
             if (started)
                 ret = "Data was incorrectly formatted for a saved game file";
@@ -2549,40 +3863,87 @@ static const char *midend_deserialise_internal(
                 data.privdesc = val;
                 val = NULL;
             } else if (!strcmp(key, "AUXINFO")) {
-                unsigned char *tmp;
-                int len = strlen(val) / 2;   /* length in bytes */
-                tmp = hex2bin(val, len);
-                obfuscate_bitmap(tmp, len*8, true);
-
                 sfree(data.auxinfo);
-                data.auxinfo = snewn(len + 1, char);
-                memcpy(data.auxinfo, tmp, len);
-                data.auxinfo[len] = '\0';
-                sfree(tmp);
+                data.auxinfo = unhide_spoiler(val);
+            } else if (!strcmp(key, "SOLUTION")) {
+                sfree(data.solution);
+                data.solution = unhide_spoiler(val);
             } else if (!strcmp(key, "UI")) {
                 sfree(data.uistr);
                 data.uistr = val;
                 val = NULL;
             } else if (!strcmp(key, "TIME")) {
                 data.elapsed = (float)atof(val);
+            } else if (!strcmp(key, "CHANGES")) {
+                /*
+                 * Keep as many of the states we've read as it says,
+                 * and forget everything else, which it repeats.
+                 */
+                int keep = atoi(val);
+                if (keep < 1 || keep > gotstates + 1) {
+                    ret = "Change record in save file doesn't fit the"
+                        " game before it";
+                    goto cleanup;
+                }
+                for (i = keep; i < data.nstates; i++) {
+                    sfree(data.states[i].movestr);
+                    data.states[i].movestr = NULL;
+                    data.states[i].movetype = NEWGAME;
+                }
+                while (data.ncheckpoints > 0 &&
+                       data.checkpoints[data.ncheckpoints-1].index >= keep)
+                    sfree(data.checkpoints[--data.ncheckpoints].encoding);
+                sfree(checkpoint);
+                checkpoint = NULL;
+                gotstates = keep - 1;
+                data.statepos = -1;
+                changing = true;
+
+                sfree(data.seed);
+                sfree(data.parstr);
+                sfree(data.cparstr);
+                sfree(data.desc);
+                sfree(data.privdesc);
+                sfree(data.auxinfo);
+                sfree(data.uistr);
+                sfree(data.solution);
+                data.seed = data.parstr = data.desc = data.privdesc = NULL;
+                data.auxinfo = data.uistr = data.cparstr = NULL;
+                data.solution = NULL;
+                data.elapsed = 0.0F;
             } else if (!strcmp(key, "NSTATES")) {
-                if (data.states) {
+                int n = atoi(val), from = data.states ? data.nstates : 0;
+                if (data.states && !changing) {
                     ret = "Two state counts provided in save file";
                     goto cleanup;
                 }
-                data.nstates = atoi(val);
-                if (data.nstates <= 0) {
+                if (n <= 0) {
                     ret = "Number of states in save file was negative";
                     goto cleanup;
                 }
-                data.states = snewn(data.nstates, struct midend_state_entry);
-                for (i = 0; i < data.nstates; i++) {
+                if (n <= gotstates) {
+                    ret = "Change record in save file doesn't fit the"
+                        " game before it";
+                    goto cleanup;
+                }
+                for (i = n; i < data.nstates; i++)
+                    sfree(data.states[i].movestr);
+                data.states = sresize(data.states, n,
+                                      struct midend_state_entry);
+                for (i = from; i < n; i++) {
                     data.states[i].state = NULL;
                     data.states[i].movestr = NULL;
                     data.states[i].movetype = NEWGAME;
                 }
+                data.nstates = n;
+                changing = false;
             } else if (!strcmp(key, "STATEPOS")) {
                 data.statepos = atoi(val);
+            } else if (!strcmp(key, "STATE")) {
+                /* A checkpoint of the state made by the next move. */
+                sfree(checkpoint);
+                checkpoint = val;
+                val = NULL;
             } else if (!strcmp(key, "MOVE") ||
                        !strcmp(key, "SOLVE") ||
                        !strcmp(key, "RESTART")) {
@@ -2604,12 +3965,27 @@ static const char *midend_deserialise_internal(
                     data.states[gotstates].movetype = RESTART;
                 data.states[gotstates].movestr = val;
                 val = NULL;
+                if (checkpoint) {
+                    struct deserialise_checkpoint *c;
+
+                    if (data.ncheckpoints >= data.checkpointsize) {
+                        data.checkpointsize = data.ncheckpoints * 5 / 4 + 16;
+                        data.checkpoints = sresize(
+                            data.checkpoints, data.checkpointsize,
+                            struct deserialise_checkpoint);
+                    }
+                    c = &data.checkpoints[data.ncheckpoints++];
+                    c->index = gotstates;
+                    c->encoding = checkpoint;
+                    checkpoint = NULL;
+                }
             }
         }
 
         sfree(val);
         val = NULL;
     }
+    finished:
 
     data.params = me->ourgame->default_params();
     if (!data.parstr) {
@@ -2672,6 +4048,47 @@ static const char *midend_deserialise_internal(
 
     for (i = 1; i < data.nstates; i++) {
         assert(data.states[i].movetype != NEWGAME);
+        if (data.states[i].movetype == RESTART &&
+            me->ourgame->validate_desc(data.cparams,
+                                       data.states[i].movestr)) {
+            ret = "Save file contained an invalid restart move";
+            goto cleanup;
+        }
+    }
+
+    /*
+     * Restore any checkpoints. A bad one is just forgotten, like a
+     * bad solution below, since replaying the moves will still get
+     * us there.
+     */
+    if (me->ourgame->decode_state) {
+        for (i = 0; i < data.ncheckpoints; i++) {
+            struct deserialise_checkpoint *c = &data.checkpoints[i];
+
+            if (!data.states[c->index].state) {
+                data.states[c->index].state = me->ourgame->decode_state(
+                    data.states[0].state, c->encoding);
+                if (data.states[c->index].state)
+                    restored = true;
+            }
+        }
+    }
+
+    /*
+     * If there were any, we only need to replay the moves from the
+     * last one before the current position, and midend_replay_state
+     * can fill in the rest as and when they're wanted. Otherwise,
+     * replay the lot.
+     */
+    if (restored) {
+        to = data.statepos - 1;
+        for (from = to; !data.states[from].state; from--);
+        from++;
+    } else {
+        from = 1;
+        to = data.nstates - 1;
+    }
+    for (i = from; i <= to; i++) {
         switch (data.states[i].movetype) {
           case MOVE:
           case SOLVE:
@@ -2683,17 +4100,29 @@ static const char *midend_deserialise_internal(
             }
             break;
           case RESTART:
-            if (me->ourgame->validate_desc(
-                    data.cparams, data.states[i].movestr)) {
-                ret = "Save file contained an invalid restart move";
-                goto cleanup;
-            }
             data.states[i].state = me->ourgame->new_game(
                 me, data.cparams, data.states[i].movestr);
             break;
         }
     }
 
+    /*
+     * A precomputed solution is only a cache, so rather than reject
+     * the save file over a bad one, just forget it.
+     */
+    if (data.solution) {
+        game_state *s = NULL;
+        if (me->ourgame->flags & SOLVE_FROM_ORIG)
+            s = me->ourgame->execute_move(data.states[0].state,
+                                          data.solution);
+        if (s)
+            me->ourgame->free_game(s);
+        else {
+            sfree(data.solution);
+            data.solution = NULL;
+        }
+    }
+
     data.ui = me->ourgame->new_ui(data.states[0].state);
     midend_apply_prefs(me, data.ui);
     if (data.uistr && me->ourgame->decode_ui)
@@ -2732,8 +4161,13 @@ static const char *midend_deserialise_internal(
         tmp = me->aux_info;
         me->aux_info = data.auxinfo;
         data.auxinfo = tmp;
+
+        tmp = me->solution;
+        me->solution = data.solution;
+        data.solution = tmp;
     }
 
+    midend_free_pregen(me);
     me->genmode = GOT_NOTHING;
 
     me->statesize = data.nstates;
@@ -2746,6 +4180,10 @@ static const char *midend_deserialise_internal(
         data.states = tmp;
     }
     me->statepos = data.statepos;
+    me->saved_nstates = 0;
+    me->hot_lo = 0;                    /* any state may be present */
+    me->hot_hi = me->nstates - 1;
+    midend_compact_states(me);
 
     /*
      * Don't save the "new game undo/redo" state.  So "new game" twice or
@@ -2756,6 +4194,7 @@ static const char *midend_deserialise_internal(
      */
     me->newgame_undo.len = 0;
     me->newgame_redo.len = 0;
+    midend_free_newgame_snapshot(me);
 
     {
         game_params *tmp;
@@ -2802,6 +4241,7 @@ static const char *midend_deserialise_internal(
 
     cleanup:
     sfree(val);
+    sfree(checkpoint);
     sfree(data.seed);
     sfree(data.parstr);
     sfree(data.cparstr);
@@ -2809,6 +4249,7 @@ static const char *midend_deserialise_internal(
     sfree(data.privdesc);
     sfree(data.auxinfo);
     sfree(data.uistr);
+    sfree(data.solution);
     if (data.params)
         me->ourgame->free_params(data.params);
     if (data.cparams)
@@ -2825,6 +4266,9 @@ static const char *midend_deserialise_internal(
         }
         sfree(data.states);
     }
+    for (i = 0; i < data.ncheckpoints; i++)
+        sfree(data.checkpoints[i].encoding);
+    sfree(data.checkpoints);
 
     return ret;
 }
@@ -2832,7 +4276,13 @@ static const char *midend_deserialise_internal(
 const char *midend_deserialise(
     midend *me, bool (*read)(void *ctx, void *buf, int len), void *rctx)
 {
-    return midend_deserialise_internal(me, read, rctx, NULL, NULL);
+    struct save_reader sr;
+    const char *ret;
+
+    save_reader_init(&sr, read, rctx);
+    ret = midend_deserialise_internal(me, save_reader_read, &sr, NULL, NULL);
+    save_reader_free(&sr);
+    return ret;
 }
 
 /*
@@ -2842,9 +4292,8 @@ const char *midend_deserialise(
  * allocated and should be caller-freed), or an error message on
  * failure.
  */
-const char *identify_game(char **name,
-                          bool (*read)(void *ctx, void *buf, int len),
-                          void *rctx)
+static const char *identify_game_internal(
+    char **name, bool (*read)(void *ctx, void *buf, int len), void *rctx)
 {
     int nstates = 0, statepos = -1, gotstates = 0;
     bool started = false;
@@ -2941,6 +4390,19 @@ const char *identify_game(char **name,
     return ret;
 }
 
+const char *identify_game(char **name,
+                          bool (*read)(void *ctx, void *buf, int len),
+                          void *rctx)
+{
+    struct save_reader sr;
+    const char *ret;
+
+    save_reader_init(&sr, read, rctx);
+    ret = identify_game_internal(name, save_reader_read, &sr);
+    save_reader_free(&sr);
+    return ret;
+}
+
 const char *midend_print_puzzle(midend *me, document *doc, bool with_soln)
 {
     game_state *soln = NULL;
@@ -2956,9 +4418,12 @@ const char *midend_print_puzzle(midend *me, document *doc, bool with_soln)
 	    return "This game does not support the Solve operation";
 
 	msg = "Solve operation failed";/* game _should_ overwrite on error */
-	movestr = me->ourgame->solve(me->states[0].state,
-				     me->states[me->statepos-1].state,
-				     me->aux_info, &msg);
+        if (me->solution)
+            movestr = dupstr(me->solution);
+        else
+            movestr = me->ourgame->solve(me->states[0].state,
+                                         me->states[me->statepos-1].state,
+                                         me->aux_info, &msg);
 	if (!movestr)
 	    return msg;
 	soln = me->ourgame->execute_move(me->states[me->statepos-1].state,
@@ -59,6 +59,8 @@ struct game_params {
     int first_click_x, first_click_y;
 };
 
+#define NSPEC 5
+
 struct mine_layout {
     /*
      * This structure is shared between all the game_states for a
@@ -74,6 +76,16 @@ struct mine_layout {
     bool unique;
     random_state *rs;
     midend *me;		       /* to give back the new game desc */
+    /*
+     * Layouts generated in idle time (by game_speculate) for the
+     * first clicks we expect, so that if the real first click is one
+     * of them, it needn't wait for the generator.
+     */
+    int nspec;
+    struct {
+        int x, y;
+        bool *mines;
+    } spec[NSPEC];
     /*
      * After we generate a layout on the first click, we want to
      * remember what the location of that click was, so that we can
@@ -351,11 +363,19 @@ static int bitcount16(int inword)
  * We use a tree234 to store a large number of small localised
  * sets, each with a mine count. We also keep some of those sets
  * linked together into a to-do list.
+ *
+ * ss_overlap is the solver's commonest query, and wants every set
+ * with its top left corner in a 6x6 area around a given square. So
+ * as well as the tree, we index the sets by that corner: cells[y*w+x]
+ * lists the sets whose top left is (x,y), in the same order (of
+ * increasing mask) as the tree holds them, chained through
+ * 'cellnext'.
  */
 struct set {
     short x, y, mask, mines;
     bool todo;
     struct set *prev, *next;
+    struct set *cellnext;
 };
 
 static int setcmp(void *av, void *bv)
@@ -382,13 +402,22 @@ static int setcmp(void *av, void *bv)
 struct setstore {
     tree234 *sets;
     struct set *todo_head, *todo_tail;
+    int w, h;
+    struct set **cells;
 };
 
-static struct setstore *ss_new(void)
+static struct setstore *ss_new(int w, int h)
 {
     struct setstore *ss = snew(struct setstore);
+    int i;
+
     ss->sets = newtree234(setcmp);
     ss->todo_head = ss->todo_tail = NULL;
+    ss->w = w;
+    ss->h = h;
+    ss->cells = snewn(w*h, struct set *);
+    for (i = 0; i < w*h; i++)
+        ss->cells[i] = NULL;
     return ss;
 }
 
@@ -464,7 +493,7 @@ static void ss_add_todo(struct setstore *ss, struct set *s)
 
 static void ss_add(struct setstore *ss, int x, int y, int mask, int mines)
 {
-    struct set *s;
+    struct set *s, **link;
 
     assert(mask != 0);
 
@@ -496,6 +525,16 @@ static void ss_add(struct setstore *ss, int x, int y, int mask, int mines)
 	return;
     }
 
+    /*
+     * Every set is made of squares within the grid, so its top
+     * left corner is too.
+     */
+    assert(0 <= x && x < ss->w && 0 <= y && y < ss->h);
+    for (link = &ss->cells[y*ss->w+x]; *link && (*link)->mask < mask;
+         link = &(*link)->cellnext);
+    s->cellnext = *link;
+    *link = s;
+
     /*
      * We've added a new set to the tree, so put it on the todo
      * list.
@@ -505,7 +544,7 @@ static void ss_add(struct setstore *ss, int x, int y, int mask, int mines)
 
 static void ss_remove(struct setstore *ss, struct set *s)
 {
-    struct set *next = s->next, *prev = s->prev;
+    struct set *next = s->next, *prev = s->prev, **link;
 
 #ifdef SOLVER_DIAGNOSTICS
     printf("removing set %d,%d %03x\n", s->x, s->y, s->mask);
@@ -526,9 +565,12 @@ static void ss_remove(struct setstore *ss, struct set *s)
     s->todo = false;
 
     /*
-     * Remove s from the tree.
+     * Remove s from the tree and from its cell's list.
      */
     del234(ss->sets, s);
+    for (link = &ss->cells[s->y*ss->w+s->x]; *link != s;
+         link = &(*link)->cellnext);
+    *link = s->cellnext;
 
     /*
      * Destroy the actual set structure.
@@ -548,39 +590,29 @@ static struct set **ss_overlap(struct setstore *ss, int x, int y, int mask)
 
     for (xx = x-3; xx < x+3; xx++)
 	for (yy = y-3; yy < y+3; yy++) {
-	    struct set stmp, *s;
-	    int pos;
+	    struct set *s;
+
+	    if (xx < 0 || xx >= ss->w || yy < 0 || yy >= ss->h)
+		continue;
 
 	    /*
-	     * Find the first set with these top left coordinates.
+	     * Go through the sets with these top left coordinates.
 	     */
-            assert(SHRT_MIN <= xx && xx <= SHRT_MAX);
-	    stmp.x = xx;
-            assert(SHRT_MIN <= yy && yy <= SHRT_MAX);
-	    stmp.y = yy;
-	    stmp.mask = 0;
-
-	    if (findrelpos234(ss->sets, &stmp, NULL, REL234_GE, &pos)) {
-		while ((s = index234(ss->sets, pos)) != NULL &&
-		       s->x == xx && s->y == yy) {
+	    for (s = ss->cells[yy*ss->w+xx]; s; s = s->cellnext) {
+		/*
+		 * This set potentially overlaps the input one.
+		 * Compute the intersection to see if they really
+		 * overlap, and add it to the list if so.
+		 */
+		if (setmunge(x, y, mask, s->x, s->y, s->mask, false)) {
 		    /*
-		     * This set potentially overlaps the input one.
-		     * Compute the intersection to see if they
-		     * really overlap, and add it to the list if
-		     * so.
+		     * There's an overlap.
 		     */
-		    if (setmunge(x, y, mask, s->x, s->y, s->mask, false)) {
-			/*
-			 * There's an overlap.
-			 */
-			if (nret >= retsize) {
-			    retsize = nret + 32;
-			    ret = sresize(ret, retsize, struct set *);
-			}
-			ret[nret++] = s;
+		    if (nret >= retsize) {
+			retsize = nret + 32;
+			ret = sresize(ret, retsize, struct set *);
 		    }
-
-		    pos++;
+		    ret[nret++] = s;
 		}
 	    }
 	}
@@ -704,7 +736,7 @@ static int minesolve(int w, int h, int n, signed char *grid,
                      perturb_cb perturb,
 		     void *ctx, random_state *rs)
 {
-    struct setstore *ss = ss_new();
+    struct setstore *ss = ss_new(w, h);
     struct set **list;
     struct squaretodo astd, *std = &astd;
     int x, y, i, j;
@@ -1350,6 +1382,7 @@ static int minesolve(int w, int h, int n, signed char *grid,
 	while ((s = delpos234(ss->sets, 0)) != NULL)
 	    sfree(s);
 	freetree234(ss->sets);
+	sfree(ss->cells);
 	sfree(ss);
 	sfree(std->next);
     }
@@ -2144,10 +2177,25 @@ static int open_square(game_state *state, int x, int y)
 	 * initial click location.
 	 */
 	char *desc, *privdesc;
-	state->layout->mines = new_mine_layout(w, h, state->layout->n,
-					       x, y, state->layout->unique,
-					       state->layout->rs,
-					       &desc);
+	int i;
+
+	for (i = 0; i < state->layout->nspec; i++)
+	    if (state->layout->spec[i].x == x &&
+                state->layout->spec[i].y == y)
+		break;
+	if (i < state->layout->nspec) {
+	    state->layout->mines = state->layout->spec[i].mines;
+	    state->layout->spec[i].mines = NULL;
+	    desc = describe_layout(state->layout->mines, w * h, x, y, true);
+	} else {
+	    state->layout->mines = new_mine_layout(w, h, state->layout->n,
+						   x, y, state->layout->unique,
+						   state->layout->rs,
+						   &desc);
+	}
+	for (i = 0; i < state->layout->nspec; i++)
+	    sfree(state->layout->spec[i].mines);
+	state->layout->nspec = 0;
 
         /* Record the first-click location, so that if the user
          * undoes this move they can still remember where it was. */
@@ -2408,6 +2456,10 @@ static game_state *dup_game(const game_state *state)
 static void free_game(game_state *state)
 {
     if (--state->layout->refcount <= 0) {
+	int i;
+
+	for (i = 0; i < state->layout->nspec; i++)
+	    sfree(state->layout->spec[i].mines);
 	sfree(state->layout->mines);
 	if (state->layout->rs)
 	    random_free(state->layout->rs);
@@ -2417,6 +2469,77 @@ static void free_game(game_state *state)
     sfree(state);
 }
 
+/*
+ * Checkpoints for save files: the flags, and then one character per
+ * square of the grid, which is all that moves change (the mine
+ * layout is shared with the initial state).
+ */
+static const char mines_negchars[] = "?-F";   /* -3 to -1 */
+static const char mines_bigchars[] = "MXx";   /* 64 to 66 */
+
+static char *encode_state(const game_state *state)
+{
+    int wh = state->w * state->h, i;
+    char *ret = snewn(wh + 5, char), *p = ret;
+
+    if (state->dead) *p++ = 'D';
+    if (state->won) *p++ = 'W';
+    if (state->used_solve) *p++ = 'S';
+    *p++ = ';';
+    for (i = 0; i < wh; i++) {
+        int v = state->grid[i];
+
+        if (v >= 0 && v <= 8)
+            *p++ = '0' + v;
+        else if (v >= -3 && v < 0)
+            *p++ = mines_negchars[v + 3];
+        else {
+            assert(v >= 64 && v <= 66);
+            *p++ = mines_bigchars[v - 64];
+        }
+    }
+    *p = '\0';
+
+    return ret;
+}
+
+static game_state *decode_state(const game_state *orig, const char *encoding)
+{
+    int wh = orig->w * orig->h, i;
+    game_state *ret = dup_game(orig);
+    const char *p = encoding, *q;
+
+    ret->dead = ret->won = ret->used_solve = false;
+    for (; *p && *p != ';'; p++) {
+        if (*p == 'D')
+            ret->dead = true;
+        else if (*p == 'W')
+            ret->won = true;
+        else if (*p == 'S')
+            ret->used_solve = true;
+        else
+            goto fail;
+    }
+    if (*p++ != ';' || strlen(p) != wh)
+        goto fail;
+    for (i = 0; i < wh; i++) {
+        if (p[i] >= '0' && p[i] <= '8')
+            ret->grid[i] = p[i] - '0';
+        else if ((q = strchr(mines_negchars, p[i])) != NULL)
+            ret->grid[i] = (q - mines_negchars) - 3;
+        else if ((q = strchr(mines_bigchars, p[i])) != NULL)
+            ret->grid[i] = (q - mines_bigchars) + 64;
+        else
+            goto fail;
+    }
+
+    return ret;
+
+  fail:
+    free_game(ret);
+    return NULL;
+}
+
 static char *solve_game(const game_state *state, const game_state *currstate,
                         const char *aux, const char **error)
 {
@@ -2433,6 +2556,52 @@ static bool game_can_format_as_text_now(const game_params *params)
     return true;
 }
 
+/*
+ * Until the first click, generate in advance the layouts for the
+ * clicks a player is likeliest to start with: the middle of the
+ * grid, and then its corners. Each is generated from a copy of the
+ * random state which the real first click will use, so it's exactly
+ * the layout that click would get anyway.
+ */
+static bool game_speculate(const game_state *state)
+{
+    struct mine_layout *layout = state->layout;
+    int w = state->w, h = state->h;
+    int i, x, y;
+    random_state *rs;
+
+    for (;;) {
+        if (layout->mines || layout->nspec == NSPEC)
+            return false;
+
+        switch (layout->nspec) {
+          case 0: x = w / 2; y = h / 2; break;
+          case 1: x = 0; y = 0; break;
+          case 2: x = w - 1; y = 0; break;
+          case 3: x = 0; y = h - 1; break;
+          default: x = w - 1; y = h - 1; break;
+        }
+        layout->spec[layout->nspec].x = x;
+        layout->spec[layout->nspec].y = y;
+        layout->spec[layout->nspec].mines = NULL;
+
+        /* On a tiny grid, some of these may be the same square. */
+        for (i = 0; i < layout->nspec; i++)
+            if (layout->spec[i].x == x && layout->spec[i].y == y)
+                break;
+        if (i == layout->nspec)
+            break;
+        layout->nspec++;
+    }
+
+    rs = random_copy(layout->rs);
+    layout->spec[layout->nspec].mines = minegen(w, h, layout->n, x, y,
+                                                layout->unique, rs);
+    random_free(rs);
+    layout->nspec++;
+    return layout->nspec < NSPEC;
+}
+
 static char *game_text_format(const game_state *state)
 {
     char *ret;
@@ -3356,7 +3525,11 @@ const struct game thegame = {
     set_public_desc,
     dup_game,
     free_game,
+    encode_state, decode_state,
     true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    game_speculate,
     true, game_can_format_as_text_now, game_text_format,
     NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
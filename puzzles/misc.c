@@ -54,6 +54,8 @@ void free_keys(key_label *keys, int nkeys)
  * keyless, reversible, but visually completely obfuscatory masking
  * function to the mine bitmap.
  */
+#define OBFUSCATE_BATCH 32                /* SHA-1 digests per batch */
+
 void obfuscate_bitmap(unsigned char *bmp, int bits, bool decode)
 {
     int bytes, firsthalf, secondhalf;
@@ -100,6 +102,10 @@ void obfuscate_bitmap(unsigned char *bmp, int bits, bool decode)
      * bytes, the output mask consists of concatenating the SHA-1
      * hashes of the seed string and successive decimal integers,
      * starting from 0.
+     *
+     * (The seed is hashed only once, and the hashes of it with each
+     * integer appended are finished off in batches, several at a
+     * time, by SHA_Final_Counters.)
      */
 
     bytes = (bits + 7) / 8;
@@ -117,23 +123,23 @@ void obfuscate_bitmap(unsigned char *bmp, int bits, bool decode)
     steps[decode ? 0 : 1].targetlen = secondhalf;
 
     for (i = 0; i < 2; i++) {
-	SHA_State base, final;
-	unsigned char digest[20];
-	char numberbuf[80];
-	int digestpos = 20, counter = 0;
+	SHA_State base;
+	unsigned char mask[20 * OBFUSCATE_BATCH];
+	int maskpos = 20 * OBFUSCATE_BATCH, counter = 0;
 
 	SHA_Init(&base);
 	SHA_Bytes(&base, steps[i].seedstart, steps[i].seedlen);
 
 	for (j = 0; j < steps[i].targetlen; j++) {
-	    if (digestpos >= 20) {
-		sprintf(numberbuf, "%d", counter++);
-		final = base;
-		SHA_Bytes(&final, numberbuf, strlen(numberbuf));
-		SHA_Final(&final, digest);
-		digestpos = 0;
+	    if (maskpos >= 20 * OBFUSCATE_BATCH) {
+		int n = (steps[i].targetlen - j + 19) / 20;
+		if (n > OBFUSCATE_BATCH)
+		    n = OBFUSCATE_BATCH;
+		SHA_Final_Counters(&base, counter, n, mask);
+		counter += n;
+		maskpos = 0;
 	    }
-	    steps[i].targetstart[j] ^= digest[digestpos++];
+	    steps[i].targetstart[j] ^= mask[maskpos++];
 	}
 
 	/*
@@ -362,6 +368,79 @@ int compare_integers(const void *av, const void *bv) {
 	return 0;
 }
 
+/*
+ * The states seen by shortest_first_move are kept one after another
+ * in a single array, which doubles as the search queue. Each is
+ * stored as the number of the first move on the way to it, its
+ * length, and then the state itself, so that the hash set can find
+ * the length without any context.
+ */
+static unsigned long shortest_hash(const void *v)
+{
+    const unsigned char *node = (const unsigned char *)v;
+    unsigned long hash = 0;
+    int i;
+
+    for (i = 0; i < node[1]; i++)
+        hash = hash * 31 + node[2 + i];
+    return hash;
+}
+
+static bool shortest_eq(const void *av, const void *bv)
+{
+    const unsigned char *a = (const unsigned char *)av;
+    const unsigned char *b = (const unsigned char *)bv;
+
+    return !memcmp(a + 1, b + 1, a[1] + 1);
+}
+
+int shortest_first_move(const unsigned char *start, int len, int nmoves,
+                        shortest_apply_fn_t apply, shortest_goal_fn_t goal,
+                        void *ctx, int maxstates)
+{
+    int stride = len + 2, head, nnodes, m, ret = -1;
+    unsigned char *nodes, *node, *next;
+    hashset *seen;
+
+    assert(0 < len && len <= 255);
+    assert(0 < nmoves && nmoves <= 255);
+    assert(maxstates >= 1);
+
+    if (goal(ctx, start))
+        return -1;
+
+    nodes = snewn((size_t)maxstates * stride, unsigned char);
+    seen = hashset_new(shortest_hash, shortest_eq);
+    nodes[0] = 0;
+    nodes[1] = len;
+    memcpy(nodes + 2, start, len);
+    hashset_add(seen, nodes);
+    nnodes = 1;
+
+    for (head = 0; head < nnodes && nnodes < maxstates && ret < 0; head++) {
+        node = nodes + (size_t)head * stride;
+        for (m = 0; m < nmoves && nnodes < maxstates; m++) {
+            /* Build the successor in the next free slot, and only
+             * keep it there if it's new. */
+            next = nodes + (size_t)nnodes * stride;
+            memcpy(next + 1, node + 1, len + 1);
+            apply(ctx, m, next + 2);
+            next[0] = (head == 0 ? m : node[0]);
+            if (hashset_add(seen, next) != next)
+                continue;
+            nnodes++;
+            if (goal(ctx, next + 2)) {
+                ret = next[0];
+                break;
+            }
+        }
+    }
+
+    hashset_free(seen);
+    sfree(nodes);
+    return ret;
+}
+
 char *move_cursor(int button, int *x, int *y, int maxw, int maxh, bool wrap,
     bool *visible)
 {
@@ -680,3 +759,200 @@ int n_times_root_k(int n_signed, int k)
 }
 
 /* vim: set shiftwidth=4 tabstop=8: */
+
+/*
+ * Progress reporting from within a game's new_desc function, for
+ * front ends that want to show something while a slow generator
+ * runs. There's only one hook, so this is not thread-safe; the midend
+ * installs it only around its own new_desc calls, and only if the
+ * front end asked for progress reports (which a multi-threaded
+ * front end had therefore better not do).
+ */
+static void (*generation_progress_fn)(void *ctx, float done);
+static void *generation_progress_ctx;
+
+void set_generation_progress_hook(void (*fn)(void *ctx, float done),
+                                  void *ctx)
+{
+    generation_progress_fn = fn;
+    generation_progress_ctx = ctx;
+}
+
+void generation_progress(float done)
+{
+    if (generation_progress_fn)
+        generation_progress_fn(generation_progress_ctx, done);
+}
+
+/*
+ * Most slow generators are retry loops, with no way to know in
+ * advance how many attempts they'll need. Pretend that each attempt
+ * has an even chance of succeeding, so that each one covers half the
+ * remaining distance: 'within' is the fraction of the current attempt
+ * completed. The result increases steadily and never reaches 1.
+ */
+float generation_retry_progress(int attempt, float within)
+{
+    return 1.0F - (float)pow(2.0, -(attempt + within));
+}
+
+/*
+ * Phase markers from within new_desc, for benchmarking: each call
+ * says that generation has moved on to the named phase (conventionally
+ * "grid", "clues", "solve" or "grade"), until the next call or until
+ * new_desc returns. Retry loops will revisit phases. Like the progress
+ * hook, this is global and not thread-safe.
+ */
+static void (*generation_phase_fn)(void *ctx, const char *phase);
+static void *generation_phase_ctx;
+
+void set_generation_phase_hook(void (*fn)(void *ctx, const char *phase),
+                               void *ctx)
+{
+    generation_phase_fn = fn;
+    generation_phase_ctx = ctx;
+}
+
+void generation_phase(const char *phase)
+{
+    if (generation_phase_fn)
+        generation_phase_fn(generation_phase_ctx, phase);
+}
+
+/*
+ * Progress reports from within a game's solve function, from the
+ * solvers that can take a long time (the ones which guess and
+ * backtrack). Unlike the generation hook, this one can answer back:
+ * if it returns true, the solver should give up as soon as it can.
+ * Also global and not thread-safe; the midend installs it only
+ * around its own solve calls.
+ */
+static bool (*solver_progress_fn)(void *ctx, float done);
+static void *solver_progress_ctx;
+
+void set_solver_progress_hook(bool (*fn)(void *ctx, float done), void *ctx)
+{
+    solver_progress_fn = fn;
+    solver_progress_ctx = ctx;
+}
+
+bool solver_progress(float done)
+{
+    return solver_progress_fn &&
+        solver_progress_fn(solver_progress_ctx, done);
+}
+
+/*
+ * Parallel work. Without a hook, parallel_run just runs the tasks in
+ * order on the calling thread.
+ */
+static parallel_hook_fn parallel_hook;
+static void *parallel_hook_ctx;
+static int parallel_hook_nthreads = 1;
+
+void set_parallel_hook(parallel_hook_fn fn, void *ctx, int nthreads)
+{
+    parallel_hook = fn;
+    parallel_hook_ctx = ctx;
+    parallel_hook_nthreads = fn ? nthreads : 1;
+}
+
+int parallel_nthreads(void)
+{
+    return parallel_hook_nthreads;
+}
+
+void parallel_run(parallel_task_fn fn, void *ctx, int n)
+{
+    int i;
+
+    if (parallel_hook && n > 1) {
+        parallel_hook(parallel_hook_ctx, fn, ctx, n);
+    } else {
+        for (i = 0; i < n; i++)
+            fn(ctx, i);
+    }
+}
+
+/*
+ * The cache lock. Without a hook, there's only one thread to worry
+ * about.
+ */
+static void (*cache_lock_fn)(void *ctx, bool lock);
+static void *cache_lock_ctx;
+
+void set_cache_lock_hook(void (*fn)(void *ctx, bool lock), void *ctx)
+{
+    cache_lock_fn = fn;
+    cache_lock_ctx = ctx;
+}
+
+void cache_lock(void)
+{
+    if (cache_lock_fn)
+        cache_lock_fn(cache_lock_ctx, true);
+}
+
+void cache_unlock(void)
+{
+    if (cache_lock_fn)
+        cache_lock_fn(cache_lock_ctx, false);
+}
+
+/*
+ * Clue pruning. With one worker, prune_clues is the obvious loop.
+ * With more, each round checks the next few candidates at once, one
+ * per worker, all against the same committed state, and commits the
+ * first that passed. Every candidate before that one failed against
+ * exactly the state the serial loop would have checked it against,
+ * so the outcome doesn't depend on the number of workers; the checks
+ * after it are wasted, and redone in the next round.
+ */
+struct prune_round {
+    const struct prune_ops *ops;
+    void *const *workers;
+    const int *cands;
+    bool *ok;
+};
+
+static void prune_task(void *vctx, int k)
+{
+    struct prune_round *r = (struct prune_round *)vctx;
+    r->ok[k] = r->ops->check(r->workers[k], r->cands[k]);
+}
+
+int prune_nworkers(void)
+{
+    return parallel_nthreads();
+}
+
+void prune_clues(const struct prune_ops *ops, void *const *workers,
+                 int nworkers, const int *cands, int ncands)
+{
+    struct prune_round r;
+    bool *ok;
+    int i, k, n, w;
+
+    assert(nworkers >= 1);
+
+    ok = snewn(nworkers, bool);
+    r.ops = ops;
+    r.workers = workers;
+    r.ok = ok;
+    for (i = 0; i < ncands; i += n) {
+        n = min(ncands - i, nworkers);
+
+        r.cands = cands + i;
+        parallel_run(prune_task, &r, n);
+
+        for (k = 0; k < n; k++)
+            if (ok[k])
+                break;
+        if (k < n) {
+            for (w = 0; w < nworkers; w++)
+                ops->commit(workers[w], cands[i+k]);
+            n = k + 1;
+        }
+    }
+    sfree(ok);
+}
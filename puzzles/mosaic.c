@@ -338,31 +338,6 @@ static void populate_cell(const game_params *params, const bool *image,
     desc->clue = clue;
 }
 
-static void count_around(const game_params *params,
-                         struct solution_cell *sol, int x, int y,
-                         int *marked, int *blank, int *total)
-{
-    int i, j;
-    struct solution_cell *curr = NULL;
-    (*total) = 0;
-    (*blank) = 0;
-    (*marked) = 0;
-
-    for (i = -1; i < 2; i++) {
-        for (j = -1; j < 2; j++) {
-            curr = get_coords(params, sol, x + i, y + j);
-            if (curr) {
-                (*total)++;
-                if ((curr->cell & STATE_BLANK) != 0) {
-                    (*blank)++;
-                } else if ((curr->cell & STATE_MARKED) != 0) {
-                    (*marked)++;
-                }
-            }
-        }
-    }
-}
-
 static void count_around_state(const game_state *state, int x, int y,
                                int *marked, int *blank, int *total)
 {
@@ -409,87 +384,133 @@ static void count_clues_around(const game_params *params,
     }
 }
 
-static void mark_around(const game_params *params,
-                        struct solution_cell *sol, int x, int y, int mark)
+/*
+ * Solver scratch space. Each cell's neighbourhood (the up to nine
+ * cells around and including it) is worked out once, and the number
+ * of marked and blank cells in it is kept up to date as the solver
+ * marks cells, so that checking a clue doesn't mean counting them
+ * all again.
+ */
+struct solver_scratch {
+    int width, height;
+    struct solution_cell *sol;
+    int *nbrs;                  /* nine slots per cell */
+    signed char *total, *marked, *blank;
+};
+
+static void solver_init(struct solver_scratch *sc, const game_params *params)
+{
+    int w = params->width, h = params->height, x, y, i, j;
+
+    sc->width = w;
+    sc->height = h;
+    sc->sol = snewn(w * h, struct solution_cell);
+    memset(sc->sol, 0, w * h * sizeof(*sc->sol));
+    sc->nbrs = snewn(9 * w * h, int);
+    sc->total = snewn(w * h, signed char);
+    sc->marked = snewn(w * h, signed char);
+    sc->blank = snewn(w * h, signed char);
+    memset(sc->marked, 0, w * h);
+    memset(sc->blank, 0, w * h);
+
+    for (y = 0; y < h; y++) {
+        for (x = 0; x < w; x++) {
+            int c = y * w + x, n = 0;
+            for (i = -1; i < 2; i++)
+                for (j = -1; j < 2; j++)
+                    if (x + i >= 0 && x + i < w && y + j >= 0 && y + j < h)
+                        sc->nbrs[9 * c + n++] = (y + j) * w + x + i;
+            sc->total[c] = n;
+        }
+    }
+}
+
+/* Frees everything but sc->sol, which the caller may want to keep. */
+static void solver_free(struct solver_scratch *sc)
+{
+    sfree(sc->nbrs);
+    sfree(sc->total);
+    sfree(sc->marked);
+    sfree(sc->blank);
+}
+
+static void mark_around(struct solver_scratch *sc, int c, int mark)
 {
+    signed char *count = (mark == STATE_BLANK ? sc->blank : sc->marked);
     int i, j;
-    struct solution_cell *curr;
 
-    for (i = -1; i < 2; i++) {
-        for (j = -1; j < 2; j++) {
-            curr = get_coords(params, sol, x + i, y + j);
-            if (curr) {
-                if (curr->cell == STATE_UNMARKED) {
-                    curr->cell = mark;
-                }
-            }
+    for (i = 0; i < sc->total[c]; i++) {
+        int d = sc->nbrs[9 * c + i];
+        if (sc->sol[d].cell == STATE_UNMARKED) {
+            sc->sol[d].cell = mark;
+            for (j = 0; j < sc->total[d]; j++)
+                count[sc->nbrs[9 * d + j]]++;
         }
     }
 }
 
-static char solve_cell(const game_params *params, struct desc_cell *desc,
-                       struct board_cell *board, struct solution_cell *sol,
-                       int x, int y)
+static char solve_cell(struct solver_scratch *sc, struct desc_cell *desc,
+                       struct board_cell *board, int c)
 {
+    struct solution_cell *sol = &sc->sol[c];
     struct desc_cell curr;
+    int marked, total, blank;
 
     if (desc) {
-        curr.shown = desc[(y * params->width) + x].shown;
-        curr.clue = desc[(y * params->width) + x].clue;
-        curr.full = desc[(y * params->width) + x].full;
-        curr.empty = desc[(y * params->width) + x].empty;
+        curr.shown = desc[c].shown;
+        curr.clue = desc[c].clue;
+        curr.full = desc[c].full;
+        curr.empty = desc[c].empty;
     } else {
-        curr.shown = board[(y * params->width) + x].shown;
-        curr.clue = board[(y * params->width) + x].clue;
+        curr.shown = board[c].shown;
+        curr.clue = board[c].clue;
         curr.full = false;
         curr.empty = false;
     }
-    int marked = 0, total = 0, blank = 0;
 
-    if (sol[(y * params->width) + x].solved) {
+    if (sol->solved) {
         return 0;
     }
-    count_around(params, sol, x, y, &marked, &blank, &total);
+    marked = sc->marked[c];
+    blank = sc->blank[c];
+    total = sc->total[c];
     if (curr.full && curr.shown) {
-        sol[(y * params->width) + x].solved = true;
+        sol->solved = true;
         if (marked + blank < total) {
-            sol[(y * params->width) + x].needed = true;
+            sol->needed = true;
         }
-        mark_around(params, sol, x, y, STATE_MARKED);
+        mark_around(sc, c, STATE_MARKED);
         return 1;
     }
     if (curr.empty && curr.shown) {
-        sol[(y * params->width) + x].solved = true;
+        sol->solved = true;
         if (marked + blank < total) {
-            sol[(y * params->width) + x].needed = true;
+            sol->needed = true;
         }
-        mark_around(params, sol, x, y, STATE_BLANK);
+        mark_around(sc, c, STATE_BLANK);
         return 1;
     }
     if (curr.shown) {
-        if (!sol[(y * params->width) + x].solved) {
-            if (marked == curr.clue) {
-                sol[(y * params->width) + x].solved = true;
-                if (total != marked + blank) {
-                    sol[(y * params->width) + x].needed = true;
-                }
-                mark_around(params, sol, x, y, STATE_BLANK);
-            } else if (curr.clue == (total - blank)) {
-                sol[(y * params->width) + x].solved = true;
-                if (total != marked + blank) {
-                    sol[(y * params->width) + x].needed = true;
-                }
-                mark_around(params, sol, x, y, STATE_MARKED);
-            } else if (total == marked + blank) {
-                return -1;
-            } else {
-                return 0;
+        if (marked == curr.clue) {
+            sol->solved = true;
+            if (total != marked + blank) {
+                sol->needed = true;
+            }
+            mark_around(sc, c, STATE_BLANK);
+        } else if (curr.clue == (total - blank)) {
+            sol->solved = true;
+            if (total != marked + blank) {
+                sol->needed = true;
             }
-            return 1;
+            mark_around(sc, c, STATE_MARKED);
+        } else if (total == marked + blank) {
+            return -1;
+        } else {
+            return 0;
         }
-        return 0;
+        return 1;
     } else if (total == marked + blank) {
-        sol[(y * params->width) + x].solved = true;
+        sol->solved = true;
         return 1;
     } else {
         return 0;
@@ -499,37 +520,21 @@ static char solve_cell(const game_params *params, struct desc_cell *desc,
 static bool solve_check(const game_params *params, struct desc_cell *desc,
                         random_state *rs, struct solution_cell **sol_return)
 {
-    int x, y, i;
+    int i;
     int board_size = params->height * params->width;
-    struct solution_cell *sol = snewn(board_size, struct solution_cell),
-        *curr_sol;
+    struct solver_scratch sc;
     bool made_progress = true, error = false;
     int solved = 0, curr = 0, shown = 0;
-    needed_list_item *head = NULL, *curr_needed, **needed_array;
-    struct desc_cell *curr_desc;
-
-    memset(sol, 0, board_size * sizeof(*sol));
-    for (y = 0; y < params->height; y++) {
-        for (x = 0; x < params->width; x++) {
-            curr_desc = get_coords(params, desc, x, y);
-            if (curr_desc->shown) {
-                curr_needed = snew(needed_list_item);
-                curr_needed->next = head;
-                head = curr_needed;
-                curr_needed->x = x;
-                curr_needed->y = y;
-                shown++;
-            }
+    int *needed_array;
+
+    solver_init(&sc, params);
+    /* (In reverse order, as this used to be built as a linked list.) */
+    needed_array = snewn(board_size, int);
+    for (i = board_size; i-- > 0 ;) {
+        if (desc[i].shown) {
+            needed_array[shown++] = i;
         }
     }
-    needed_array = snewn(shown, needed_list_item *);
-    curr_needed = head;
-    i = 0;
-    while (curr_needed) {
-        needed_array[i] = curr_needed;
-        curr_needed = curr_needed->next;
-        i++;
-    }
     if (rs) {
         shuffle(needed_array, shown, sizeof(*needed_array), rs);
     }
@@ -537,13 +542,13 @@ static bool solve_check(const game_params *params, struct desc_cell *desc,
     while (solved < shown && made_progress && !error) {
         made_progress = false;
         for (i = 0; i < shown; i++) {
-            curr = solve_cell(params, desc, NULL, sol, needed_array[i]->x,
-                              needed_array[i]->y);
+            curr = solve_cell(&sc, desc, NULL, needed_array[i]);
             if (curr < 0) {
                 error = true;
 #ifdef DEBUG_PRINTS
-                printf("error in cell x=%d, y=%d\n", needed_array[i]->x,
-                       needed_array[i]->y);
+                printf("error in cell x=%d, y=%d\n",
+                       needed_array[i] % params->width,
+                       needed_array[i] / params->width);
 #endif
                 break;
             }
@@ -553,28 +558,21 @@ static bool solve_check(const game_params *params, struct desc_cell *desc,
             }
         }
     }
-    while (head) {
-        curr_needed = head;
-        head = curr_needed->next;
-        sfree(curr_needed);
-    }
     sfree(needed_array);
+    solver_free(&sc);
     solved = 0;
     /* verifying all the board is solved */
     if (made_progress) {
-        for (y = 0; y < params->height; y++) {
-            for (x = 0; x < params->width; x++) {
-                curr_sol = get_coords(params, sol, x, y);
-                if ((curr_sol->cell & (STATE_MARKED | STATE_BLANK)) > 0) {
-                    solved++;
-                }
+        for (i = 0; i < board_size; i++) {
+            if ((sc.sol[i].cell & (STATE_MARKED | STATE_BLANK)) > 0) {
+                solved++;
             }
         }
     }
     if (sol_return) {
-        *sol_return = sol;
+        *sol_return = sc.sol;
     } else {
-        sfree(sol);
+        sfree(sc.sol);
     }
     return solved == board_size;
 }
@@ -583,40 +581,39 @@ static bool solve_game_actual(const game_params *params,
                               struct board_cell *desc,
                               struct solution_cell **sol_return)
 {
-    int x, y;
+    int i;
     int board_size = params->height * params->width;
-    struct solution_cell *sol = snewn(board_size, struct solution_cell);
+    struct solver_scratch sc;
     bool made_progress = true, error = false;
     int solved = 0, curr = 0;
 
-    memset(sol, 0, params->height * params->width * sizeof(*sol));
+    solver_init(&sc, params);
     solved = 0;
-    while (solved < params->height * params->width && made_progress
-           && !error) {
+    while (solved < board_size && made_progress && !error) {
         made_progress = false;
-        for (y = 0; y < params->height; y++) {
-            for (x = 0; x < params->width; x++) {
-                curr = solve_cell(params, NULL, desc, sol, x, y);
-                if (curr < 0) {
-                    error = true;
+        for (i = 0; i < board_size; i++) {
+            curr = solve_cell(&sc, NULL, desc, i);
+            if (curr < 0) {
+                error = true;
 #ifdef DEBUG_PRINTS
-                    printf("error in cell x=%d, y=%d\n", x, y);
+                printf("error in cell x=%d, y=%d\n",
+                       i % params->width, i / params->width);
 #endif
-                    break;
-                }
-                if (curr > 0) {
-                    made_progress = true;
-                }
-                solved += curr;
+                break;
             }
+            if (curr > 0) {
+                made_progress = true;
+            }
+            solved += curr;
         }
     }
+    solver_free(&sc);
     if (sol_return) {
-        *sol_return = sol;
+        *sol_return = sc.sol;
     } else {
-        sfree(sol);
+        sfree(sc.sol);
     }
-    return solved == params->height * params->width;
+    return solved == board_size;
 }
 
 static void hide_clues(const game_params *params, struct desc_cell *desc,
@@ -1609,7 +1606,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
@@ -1633,5 +1634,5 @@ const struct game thegame = {
     false, false, NULL, NULL,          /* print_size, print */
     true,			       /* wants_statusbar */
     false, NULL,                       /* timing_state */
-    0,				       /* flags */
+    SOLVE_FROM_ORIG,				       /* flags */
 };
@@ -112,7 +112,7 @@ struct game_state {
     bool wrapping, completed;
     int last_rotate_x, last_rotate_y, last_rotate_dir;
     bool used_solve;
-    unsigned char *tiles;
+    cow_array *tiles;                  /* of unsigned char */
     struct game_immutable_state *imm;
 };
 
@@ -124,7 +124,10 @@ struct game_state {
 	OFFSETWH(x2,y2,x1,y1,dir,(state)->width,(state)->height)
 
 #define index(state, a, x, y) ( a[(y) * (state)->width + (x)] )
-#define tile(state, x, y)     index(state, (state)->tiles, x, y)
+#define tile(state, x, y) \
+    COW_GET(unsigned char, (state)->tiles, (y) * (state)->width + (x))
+#define tile_put(state, x, y) \
+    COW_PUT(unsigned char, (state)->tiles, (y) * (state)->width + (x))
 #define barrier(state, x, y)  index(state, (state)->imm->barriers, x, y)
 
 struct xyd {
@@ -472,6 +475,7 @@ static int net_solver(int w, int h, unsigned char *tiles,
     unsigned char *edgestate;
     int *deadends;
     DSF *equivalence;
+    int *unchanged;
     struct todo *todo;
     int i, j, x, y;
     int area;
@@ -605,6 +609,31 @@ static int net_solver(int w, int h, unsigned char *tiles,
      */
     todo = todo_new(w * h);
 
+    /*
+     * Most of the tiles we look at in those rescans have nothing
+     * new to contribute, and we can often know that without doing
+     * the work. Processing a tile depends only on its own
+     * orientations, edges and dead-end markers, plus, through any
+     * edges still unknown, the equivalence classes of its
+     * neighbours - and of those, only which of them are the same.
+     * Merging classes can only make more of them the same. So if
+     * looking at a tile changed nothing, then until another tile
+     * changes one of its edges or markers, looking again can only
+     * find something if the number of distinct classes around it
+     * has gone down.
+     *
+     * unchanged[i] records that number when tile i was last looked
+     * at to no effect, or is -1 if it might have something else to
+     * offer. Skipping the rest leaves every deduction made in just
+     * the same order as it would be otherwise, so the result is
+     * exactly the same, only sooner: the uniqueness checks during
+     * generation, which call this repeatedly, spend most of their
+     * time here.
+     */
+    unchanged = snewn(w * h, int);
+    for (i = 0; i < w*h; i++)
+        unchanged[i] = -1;
+
     /*
      * Main deductive loop.
      */
@@ -640,7 +669,32 @@ static int net_solver(int w, int h, unsigned char *tiles,
 	x = index % w;
 	{
 	    int d, ourclass = dsf_canonify(equivalence, y*w+x);
-	    int deadendmax[9];
+	    int deadendmax[9], nbrclass[9], nclasses;
+	    bool changed = false;
+
+	    /*
+	     * Find the classes of the neighbours we might link to,
+	     * and see whether there's any point going on.
+	     */
+	    {
+		int classes[5], k, x2, y2;
+
+		classes[0] = ourclass;
+		nclasses = 1;
+		for (d = 1; d <= 8; d += d) {
+		    if (edgestate[(y*w+x) * 5 + d] != 0)
+			continue;
+		    OFFSETWH(x2, y2, x, y, d, w, h);
+		    nbrclass[d] = dsf_canonify(equivalence, y2*w+x2);
+		    for (k = 0; k < nclasses; k++)
+			if (classes[k] == nbrclass[d])
+			    break;
+		    if (k == nclasses)
+			classes[nclasses++] = nbrclass[d];
+		}
+	    }
+	    if (unchanged[index] == nclasses)
+		continue;
 
 	    deadendmax[1] = deadendmax[2] = deadendmax[4] = deadendmax[8] = 0;
 
@@ -679,15 +733,13 @@ static int net_solver(int w, int h, unsigned char *tiles,
 			 * open, which create a loop.
 			 */
 			if (edgestate[(y*w+x) * 5 + d] == 0) {
-			    int c, k, x2, y2;
-			    
-			    OFFSETWH(x2, y2, x, y, d, w, h);
-			    c = dsf_canonify(equivalence, y2*w+x2);
+			    int k;
+
 			    for (k = 0; k < nequiv; k++)
-				if (c == equiv[k])
+				if (nbrclass[d] == equiv[k])
 				    break;
 			    if (k == nequiv)
-				equiv[nequiv++] = c;
+				equiv[nequiv++] = nbrclass[d];
 			    else
 				valid = false;
 			}
@@ -746,7 +798,7 @@ static int net_solver(int w, int h, unsigned char *tiles,
             }
 
 	    if (j < i) {
-		done_something = true;
+		done_something = changed = true;
 
 		/*
 		 * We have ruled out at least one tile orientation.
@@ -781,7 +833,8 @@ static int net_solver(int w, int h, unsigned char *tiles,
 			    edgestate[(y*w+x) * 5 + d] = 1;
 			    edgestate[(y2*w+x2) * 5 + d2] = 1;
 			    dsf_merge(equivalence, y*w+x, y2*w+x2);
-			    done_something = true;
+			    done_something = changed = true;
+			    unchanged[y2*w+x2] = -1;
 			    todo_add(todo, y2*w+x2);
 			} else if (!(o & d)) {
 			    /* This edge is closed in all orientations. */
@@ -790,7 +843,8 @@ static int net_solver(int w, int h, unsigned char *tiles,
 #endif
 			    edgestate[(y*w+x) * 5 + d] = 2;
 			    edgestate[(y2*w+x2) * 5 + d2] = 2;
-			    done_something = true;
+			    done_something = changed = true;
+			    unchanged[y2*w+x2] = -1;
 			    todo_add(todo, y2*w+x2);
 			}
 		    }
@@ -812,11 +866,13 @@ static int net_solver(int w, int h, unsigned char *tiles,
 			   x2, y2, d2, deadendmax[d]);
 #endif
 		    deadends[(y2*w+x2) * 5 + d2] = deadendmax[d];
-		    done_something = true;
+		    done_something = changed = true;
+		    unchanged[y2*w+x2] = -1;
 		    todo_add(todo, y2*w+x2);
 		}
 	    }
 
+	    unchanged[index] = (changed ? -1 : nclasses);
 	}
     }
 
@@ -841,6 +897,7 @@ static int net_solver(int w, int h, unsigned char *tiles,
     sfree(tilestate);
     sfree(edgestate);
     sfree(deadends);
+    sfree(unchanged);
     dsf_free(equivalence);
 
     return j;
@@ -1660,8 +1717,7 @@ static game_state *new_game(midend *me, const game_params *params,
     state->imm->refcount = 1;
     state->last_rotate_dir = state->last_rotate_x = state->last_rotate_y = 0;
     state->completed = state->used_solve = false;
-    state->tiles = snewn(state->width * state->height, unsigned char);
-    memset(state->tiles, 0, state->width * state->height);
+    state->tiles = cow_new(state->width * state->height, 1);
     state->imm->barriers = snewn(state->width * state->height, unsigned char);
     memset(state->imm->barriers, 0, state->width * state->height);
 
@@ -1671,11 +1727,11 @@ static game_state *new_game(midend *me, const game_params *params,
     for (y = 0; y < h; y++) {
         for (x = 0; x < w; x++) {
             if (*desc >= '0' && *desc <= '9')
-                tile(state, x, y) = *desc - '0';
+                tile_put(state, x, y) = *desc - '0';
             else if (*desc >= 'a' && *desc <= 'f')
-                tile(state, x, y) = *desc - 'a' + 10;
+                tile_put(state, x, y) = *desc - 'a' + 10;
             else if (*desc >= 'A' && *desc <= 'F')
-                tile(state, x, y) = *desc - 'A' + 10;
+                tile_put(state, x, y) = *desc - 'A' + 10;
             if (*desc)
                 desc++;
             while (*desc == 'h' || *desc == 'v') {
@@ -1744,8 +1800,7 @@ static game_state *dup_game(const game_state *state)
     ret->last_rotate_dir = state->last_rotate_dir;
     ret->last_rotate_x = state->last_rotate_x;
     ret->last_rotate_y = state->last_rotate_y;
-    ret->tiles = snewn(state->width * state->height, unsigned char);
-    memcpy(ret->tiles, state->tiles, state->width * state->height);
+    ret->tiles = cow_dup(state->tiles);
 
     return ret;
 }
@@ -1756,7 +1811,7 @@ static void free_game(game_state *state)
         sfree(state->imm->barriers);
         sfree(state->imm);
     }
-    sfree(state->tiles);
+    cow_free(state->tiles);
     sfree(state);
 }
 
@@ -1777,7 +1832,7 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 	 */
         int solver_result;
 
-	memcpy(tiles, state->tiles, state->width * state->height);
+	cow_read_all(state->tiles, tiles);
 	solver_result = net_solver(state->width, state->height, tiles,
                                    state->imm->barriers, state->wrapping);
 
@@ -1811,7 +1866,7 @@ static char *solve_game(const game_state *state, const game_state *currstate,
     ret[retlen++] = 'S';
 
     for (i = 0; i < state->width * state->height; i++) {
-	int from = currstate->tiles[i], to = tiles[i];
+	int from = COW_GET(unsigned char, currstate->tiles, i), to = tiles[i];
 	int ft = from & (R|L|U|D), tt = to & (R|L|U|D);
 	int x = i % state->width, y = i / state->width;
 	int chr = '\0';
@@ -2015,9 +2070,15 @@ static int *compute_loops_inner(int w, int h, bool wrapping,
 static int *compute_loops(const game_state *state,
                           bool include_unlocked_squares)
 {
-    return compute_loops_inner(state->width, state->height, state->wrapping,
-                               state->tiles, state->imm->barriers,
-                               include_unlocked_squares);
+    unsigned char *tiles = snewn(state->width * state->height, unsigned char);
+    int *loops;
+
+    cow_read_all(state->tiles, tiles);
+    loops = compute_loops_inner(state->width, state->height, state->wrapping,
+                                tiles, state->imm->barriers,
+                                include_unlocked_squares);
+    sfree(tiles);
+    return loops;
 }
 
 struct game_ui {
@@ -2137,10 +2198,15 @@ static const char *current_key_label(const game_ui *ui,
     return "";
 }
 
+#define NSPRITES 0x400                 /* see TILE_SPRITE_KEY */
+
 struct game_drawstate {
     int width, height;
     int tilesize;
     unsigned long *visible, *to_draw;
+    /* Rotating tile contents, indexed by TILE_SPRITE_KEY; see draw_tile */
+    sprite **sprites;
+    int sprite_tilesize;               /* tilesize they were drawn at */
 };
 
 /* ----------------------------------------------------------------------
@@ -2453,20 +2519,20 @@ static game_state *execute_move(const game_state *from, const char *move)
 	    tx >= 0 && tx < from->width && ty >= 0 && ty < from->height) {
 	    orig = tile(ret, tx, ty);
 	    if (move[0] == 'A') {
-		tile(ret, tx, ty) = A(orig);
+		tile_put(ret, tx, ty) = A(orig);
 		if (!noanim)
 		    ret->last_rotate_dir = +1;
 	    } else if (move[0] == 'F') {
-		tile(ret, tx, ty) = F(orig);
+		tile_put(ret, tx, ty) = F(orig);
 		if (!noanim)
                     ret->last_rotate_dir = +2; /* + for sake of argument */
 	    } else if (move[0] == 'C') {
-		tile(ret, tx, ty) = C(orig);
+		tile_put(ret, tx, ty) = C(orig);
 		if (!noanim)
 		    ret->last_rotate_dir = -1;
 	    } else {
 		assert(move[0] == 'L');
-		tile(ret, tx, ty) ^= LOCKED;
+		tile_put(ret, tx, ty) ^= LOCKED;
 	    }
 
 	    move += 1 + n;
@@ -2496,14 +2562,15 @@ static game_state *execute_move(const game_state *from, const char *move)
         bool complete = true;
 
 	for (pos = 0; pos < ret->width * ret->height; pos++)
-            if (ret->tiles[pos] & 0xF)
+            if (COW_GET(unsigned char, ret->tiles, pos) & 0xF)
                 break;
 
         if (pos < ret->width * ret->height) {
             active = compute_active(ret, pos % ret->width, pos / ret->width);
 
             for (pos = 0; pos < ret->width * ret->height; pos++)
-                if ((ret->tiles[pos] & 0xF) && !active[pos]) {
+                if ((COW_GET(unsigned char, ret->tiles, pos) & 0xF) &&
+                    !active[pos]) {
 		    complete = false;
                     break;
                 }
@@ -2536,16 +2603,34 @@ static game_drawstate *game_new_drawstate(drawing *dr, const game_state *state)
     ds->tilesize = 0;                  /* undecided yet */
     for (i = 0; i < ncells; i++)
         ds->visible[i] = -1;
+    ds->sprites = snewn(NSPRITES, sprite *);
+    ds->sprite_tilesize = 0;
+    for (i = 0; i < NSPRITES; i++)
+        ds->sprites[i] = NULL;
 
     return ds;
 }
 
+static void free_sprites(drawing *dr, game_drawstate *ds)
+{
+    int i;
+
+    for (i = 0; i < NSPRITES; i++) {
+        if (ds->sprites[i]) {
+            sprite_free(dr, ds->sprites[i]);
+            ds->sprites[i] = NULL;
+        }
+    }
+}
+
 #define dsindex(ds, field, x, y) ((ds)->field[((y)+1)*((ds)->width+2)+((x)+1)])
 #define visible(ds, x, y) dsindex(ds, visible, x, y)
 #define todraw(ds, x, y) dsindex(ds, to_draw, x, y)
 
 static void game_free_drawstate(drawing *dr, game_drawstate *ds)
 {
+    free_sprites(dr, ds);
+    sfree(ds->sprites);
     sfree(ds->visible);
     sfree(ds->to_draw);
     sfree(ds);
@@ -2654,6 +2739,12 @@ static void rotated_coords(float *ox, float *oy, const float matrix[4],
 #define TILE_ROTATING          (1UL<<27) /* 1 bit if tile is rotating */
 #define TILE_LOCKED            (1UL<<28) /* 1 bit if tile is locked */
 
+/*
+ * A rotating tile's wires and central box depend only on its
+ * TILE_WIRE and TILE_ENDPOINT bits (which are adjacent).
+ */
+#define TILE_SPRITE_KEY(tile) (((tile) >> TILE_WIRE_SHIFT) & (NSPRITES-1))
+
 static void draw_wires(drawing *dr, int cx, int cy, int radius,
                        unsigned long tile, int bitmap,
                        int colour, int halfwidth, const float matrix[4])
@@ -2696,6 +2787,56 @@ static void draw_wires(drawing *dr, int cx, int cy, int radius,
     draw_polygon(dr, points, npoints, colour, colour);
 }
 
+/*
+ * Draw the part of a tile which rotates: its wires and central box,
+ * centred on (cx, cy).
+ */
+static void draw_tile_contents(drawing *dr, game_drawstate *ds,
+                               int cx, int cy, int radius,
+                               unsigned long tile, const float matrix[4])
+{
+    int pass;
+
+    /*
+     * Draw the wires.
+     */
+    draw_wires(dr, cx, cy, radius, tile,
+               0xE, COL_WIRE, 2*LINE_THICK-1, matrix);
+    draw_wires(dr, cx, cy, radius, tile,
+               0x4, COL_POWERED, LINE_THICK-1, matrix);
+    draw_wires(dr, cx, cy, radius, tile,
+               0x8, COL_ERR, LINE_THICK-1, matrix);
+
+    /*
+     * Draw the central box.
+     */
+    for (pass = 0; pass < 2; pass++) {
+        int endtype = (tile >> TILE_ENDPOINT_SHIFT) & 3;
+        if (endtype) {
+            int i, points[8], col;
+            float boxr = TILE_SIZE * 0.24F + (pass == 0 ? LINE_THICK-1 : 0);
+
+            col = (pass == 0 || endtype == 3 ? COL_WIRE :
+                   endtype == 2 ? COL_POWERED : COL_ENDPOINT);
+
+            points[0] = +1; points[1] = +1;
+            points[2] = +1; points[3] = -1;
+            points[4] = -1; points[5] = -1;
+            points[6] = -1; points[7] = +1;
+
+            for (i = 0; i < 8; i += 2) {
+                float x, y;
+                rotated_coords(&x, &y, matrix, cx, cy,
+                               boxr * points[i], boxr * points[i+1]);
+                points[i] = x + 0.5F;
+                points[i+1] = y + 0.5F;
+            }
+
+            draw_polygon(dr, points, 4, col, COL_WIRE);
+        }
+    }
+}
+
 static void draw_tile(drawing *dr, game_drawstate *ds, int x, int y,
                       unsigned long tile, float angle)
 {
@@ -2706,6 +2847,7 @@ static void draw_tile(drawing *dr, game_drawstate *ds, int x, int y,
     int bg, d, dsh, pass;
     int cx, cy, radius;
     float matrix[4];
+    sprite *sp;
 
     tx = WINDOW_OFFSET + TILE_SIZE * x + border_br;
     ty = WINDOW_OFFSET + TILE_SIZE * y + border_br;
@@ -2840,43 +2982,30 @@ static void draw_tile(drawing *dr, game_drawstate *ds, int x, int y,
     matrix[1] = -matrix[2];
 
     /*
-     * Draw the wires.
+     * Draw the wires and the central box. While the tile is
+     * rotating, these are redrawn on every frame of the animation,
+     * so if the front end supports sprites we draw them once into a
+     * sprite and then just draw that rotated.
      */
-    draw_wires(dr, cx, cy, radius, tile,
-               0xE, COL_WIRE, 2*LINE_THICK-1, matrix);
-    draw_wires(dr, cx, cy, radius, tile,
-               0x4, COL_POWERED, LINE_THICK-1, matrix);
-    draw_wires(dr, cx, cy, radius, tile,
-               0x8, COL_ERR, LINE_THICK-1, matrix);
-
-    /*
-     * Draw the central box.
-     */
-    for (pass = 0; pass < 2; pass++) {
-        int endtype = (tile >> TILE_ENDPOINT_SHIFT) & 3;
-        if (endtype) {
-            int i, points[8], col;
-            float boxr = TILE_SIZE * 0.24F + (pass == 0 ? LINE_THICK-1 : 0);
-
-            col = (pass == 0 || endtype == 3 ? COL_WIRE :
-                   endtype == 2 ? COL_POWERED : COL_ENDPOINT);
-
-            points[0] = +1; points[1] = +1;
-            points[2] = +1; points[3] = -1;
-            points[4] = -1; points[5] = -1;
-            points[6] = -1; points[7] = +1;
-
-            for (i = 0; i < 8; i += 2) {
-                float x, y;
-                rotated_coords(&x, &y, matrix, cx, cy,
-                               boxr * points[i], boxr * points[i+1]);
-                points[i] = x + 0.5F;
-                points[i+1] = y + 0.5F;
-            }
-
-            draw_polygon(dr, points, 4, col, COL_WIRE);
+    sp = NULL;
+    if (tile & TILE_ROTATING) {
+        sprite **spp = &ds->sprites[TILE_SPRITE_KEY(tile)];
+        if (ds->sprite_tilesize != TILE_SIZE) {
+            free_sprites(dr, ds);
+            ds->sprite_tilesize = TILE_SIZE;
+        }
+        if (!*spp && (*spp = sprite_new(dr, 2*radius+1, 2*radius+1))) {
+            const float identity[4] = { 1.0F, 0.0F, 0.0F, 1.0F };
+            sprite_begin(dr, *spp);
+            draw_tile_contents(dr, ds, radius, radius, radius, tile, identity);
+            sprite_end(dr, *spp);
         }
+        sp = *spp;
     }
+    if (sp)
+        sprite_draw(dr, sp, cx - radius, cy - radius, angle);
+    else
+        draw_tile_contents(dr, ds, cx, cy, radius, tile, matrix);
 
     /*
      * Draw barriers along grid edges.
@@ -3101,7 +3230,7 @@ static void game_redraw(drawing *dr, game_drawstate *ds,
             for (i = a = n2 = 0; i < n; i++) {
                 if (active[i])
                     a++;
-                if (state->tiles[i] & 0xF)
+                if (COW_GET(unsigned char, state->tiles, i) & 0xF)
                     n2++;
             }
 
@@ -3333,7 +3462,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     get_prefs, set_prefs,
     new_ui,
@@ -969,6 +969,91 @@ static unsigned char *compute_active(const game_state *state,
     return active;
 }
 
+/* The game is complete when every square is connected to the centre. */
+static bool grid_complete(const game_state *state)
+{
+    unsigned char *active = compute_active(state, -1, -1);
+    bool complete = true;
+    int i;
+
+    for (i = 0; i < state->width * state->height; i++)
+        if (!active[i]) {
+            complete = false;
+            break;
+        }
+    sfree(active);
+    return complete;
+}
+
+/*
+ * Hints come from a breadth-first search for the first move of a
+ * shortest solution. That covers every position on grids of up to
+ * nine squares (at most 9! arrangements); on bigger grids it only
+ * finds one from positions a few moves from solved.
+ *
+ * Moves are numbered two per row, then two per column: odd numbers
+ * slide by +1 and even numbers by -1, as in the move strings.
+ */
+#define HINT_MAXSTATES 400000
+
+struct hint_ctx {
+    game_state scratch;                /* tiles point into our buffer */
+};
+
+static void hint_apply(void *vctx, int move, unsigned char *cells)
+{
+    struct hint_ctx *ctx = (struct hint_ctx *)vctx;
+    int w = ctx->scratch.width, h = ctx->scratch.height;
+    int dir = (move & 1 ? +1 : -1);
+
+    if (move < 2*h)
+        slide_row_int(w, h, cells, dir, move/2);
+    else
+        slide_col_int(w, h, cells, dir, move/2 - h);
+}
+
+static bool hint_goal(void *vctx, const unsigned char *cells)
+{
+    struct hint_ctx *ctx = (struct hint_ctx *)vctx;
+
+    memcpy(ctx->scratch.tiles, cells,
+           ctx->scratch.width * ctx->scratch.height);
+    return grid_complete(&ctx->scratch);
+}
+
+static char *solve_step(const game_state *state, const game_state *currstate,
+                        const char *aux, const char **error)
+{
+    int w = currstate->width, h = currstate->height, move;
+    struct hint_ctx ctx;
+    char buf[80];
+
+    if (grid_complete(currstate)) {
+        *error = "Puzzle is already solved";
+        return NULL;
+    }
+    if (w*h > 255 || 2 * (w+h) > 255) {
+        *error = "Puzzle is too large for hints";
+        return NULL;
+    }
+
+    ctx.scratch = *currstate;          /* structure copy */
+    ctx.scratch.tiles = snewn(w*h, unsigned char);
+    move = shortest_first_move(currstate->tiles, w*h, 2 * (w+h),
+                               hint_apply, hint_goal, &ctx, HINT_MAXSTATES);
+    sfree(ctx.scratch.tiles);
+
+    if (move < 0) {
+        *error = "Too far from the solution for a hint";
+        return NULL;
+    }
+    if (move < 2*h)
+        sprintf(buf, "R%d,%d", move/2, (move & 1 ? +1 : -1));
+    else
+        sprintf(buf, "C%d,%d", move/2 - h, (move & 1 ? +1 : -1));
+    return dupstr(buf);
+}
+
 struct game_ui {
     int cur_x, cur_y;
     bool cur_visible;
@@ -1040,12 +1125,20 @@ static void game_changed_state(game_ui *ui, const game_state *oldstate,
 {
 }
 
+/*
+ * Sliding tiles are drawn from sprites, keyed by their tile bits
+ * (directions, FLASHING and ACTIVE) and whether they're the centre.
+ */
+#define SPRITE_CENTRE 0x40
+#define NSPRITES 0x80
+
 struct game_drawstate {
     bool started;
     int width, height;
     int tilesize;
     unsigned char *visible;
     int cur_x, cur_y;
+    sprite *sprites[NSPRITES];
 };
 
 static const char *current_key_label(const game_ui *ui,
@@ -1181,24 +1274,8 @@ static game_state *execute_move(const game_state *from, const char *move)
     /*
      * See if the game has been completed.
      */
-    if (!ret->completed) {
-	unsigned char *active = compute_active(ret, -1, -1);
-	int x1, y1;
-        bool complete = true;
-
-	for (x1 = 0; x1 < ret->width; x1++)
-	    for (y1 = 0; y1 < ret->height; y1++)
-		if (!index(ret, active, x1, y1)) {
-		    complete = false;
-		    goto break_label;  /* break out of two loops at once */
-		}
-	break_label:
-
-	sfree(active);
-
-	if (complete)
-	    ret->completed = ret->move_count;
-    }
+    if (!ret->completed && grid_complete(ret))
+        ret->completed = ret->move_count;
 
     return ret;
 }
@@ -1210,6 +1287,7 @@ static game_state *execute_move(const game_state *from, const char *move)
 static game_drawstate *game_new_drawstate(drawing *dr, const game_state *state)
 {
     game_drawstate *ds = snew(game_drawstate);
+    int i;
 
     ds->started = false;
     ds->width = state->width;
@@ -1218,12 +1296,27 @@ static game_drawstate *game_new_drawstate(drawing *dr, const game_state *state)
     ds->tilesize = 0;                  /* not decided yet */
     memset(ds->visible, 0xFF, state->width * state->height);
     ds->cur_x = ds->cur_y = -1;
+    for (i = 0; i < NSPRITES; i++)
+        ds->sprites[i] = NULL;
 
     return ds;
 }
 
+static void free_sprites(drawing *dr, game_drawstate *ds)
+{
+    int i;
+
+    for (i = 0; i < NSPRITES; i++) {
+        if (ds->sprites[i]) {
+            sprite_free(dr, ds->sprites[i]);
+            ds->sprites[i] = NULL;
+        }
+    }
+}
+
 static void game_free_drawstate(drawing *dr, game_drawstate *ds)
 {
+    free_sprites(dr, ds);
     sfree(ds->visible);
     sfree(ds);
 }
@@ -1242,6 +1335,7 @@ static void game_compute_size(const game_params *params, int tilesize,
 static void game_set_size(drawing *dr, game_drawstate *ds,
                           const game_params *params, int tilesize)
 {
+    free_sprites(dr, ds);
     ds->tilesize = tilesize;
 }
 
@@ -1379,30 +1473,17 @@ static void draw_barrier(drawing *dr, game_drawstate *ds,
     }
 }
 
-static void draw_tile(drawing *dr, game_drawstate *ds, const game_state *state,
-                      int x, int y, int tile, float xshift, float yshift)
+/*
+ * Draw everything in a tile apart from the connections on its
+ * borders, which depend on its neighbours: the background, the wires
+ * and the box in the middle. centre is true for the centrepiece.
+ */
+static void draw_tile_body(drawing *dr, game_drawstate *ds, int bx, int by,
+                           int tile, bool centre)
 {
-    int bx = BORDER + WINDOW_OFFSET + TILE_SIZE * x + (int)(xshift * TILE_SIZE);
-    int by = BORDER + WINDOW_OFFSET + TILE_SIZE * y + (int)(yshift * TILE_SIZE);
     float cx, cy, ex, ey;
     int dir, col;
 
-    /*
-     * When we draw a single tile, we must draw everything up to
-     * and including the borders around the tile. This means that
-     * if the neighbouring tiles have connections to those borders,
-     * we must draw those connections on the borders themselves.
-     *
-     * This would be terribly fiddly if we ever had to draw a tile
-     * while its neighbour was in mid-rotate, because we'd have to
-     * arrange to _know_ that the neighbour was being rotated and
-     * hence had an anomalous effect on the redraw of this tile.
-     * Fortunately, the drawing algorithm avoids ever calling us in
-     * this circumstance: we're either drawing lots of straight
-     * tiles at game start or after a move is complete, or we're
-     * repeatedly drawing only the rotating tile. So no problem.
-     */
-
     /*
      * So. First blank the tile out completely: draw a big
      * rectangle in border colour, and a smaller rectangle in
@@ -1444,7 +1525,7 @@ static void draw_tile(drawing *dr, game_drawstate *ds, const game_state *state,
      * otherwise not at all.
      */
     col = -1;
-    if (x == state->cx && y == state->cy)
+    if (centre)
         col = COL_WIRE;
     else if (COUNT(tile) == 1) {
         col = (tile & ACTIVE ? COL_POWERED : COL_ENDPOINT);
@@ -1466,11 +1547,64 @@ static void draw_tile(drawing *dr, game_drawstate *ds, const game_state *state,
 
         draw_polygon(dr, points, 4, col, COL_WIRE);
     }
+}
+
+static void draw_tile(drawing *dr, game_drawstate *ds, const game_state *state,
+                      int x, int y, int tile, float xshift, float yshift)
+{
+    int bx = BORDER + WINDOW_OFFSET + TILE_SIZE * x + (int)(xshift * TILE_SIZE);
+    int by = BORDER + WINDOW_OFFSET + TILE_SIZE * y + (int)(yshift * TILE_SIZE);
+    float cx, cy;
+    int dir;
+    bool centre;
+    sprite *sp;
+
+    /*
+     * When we draw a single tile, we must draw everything up to
+     * and including the borders around the tile. This means that
+     * if the neighbouring tiles have connections to those borders,
+     * we must draw those connections on the borders themselves.
+     *
+     * This would be terribly fiddly if we ever had to draw a tile
+     * while its neighbour was in mid-rotate, because we'd have to
+     * arrange to _know_ that the neighbour was being rotated and
+     * hence had an anomalous effect on the redraw of this tile.
+     * Fortunately, the drawing algorithm avoids ever calling us in
+     * this circumstance: we're either drawing lots of straight
+     * tiles at game start or after a move is complete, or we're
+     * repeatedly drawing only the rotating tile. So no problem.
+     */
+
+    /*
+     * While a row or column is sliding, its tiles are redrawn on
+     * every frame of the animation, so if the front end supports
+     * sprites we draw each kind of tile once into a sprite and then
+     * just draw that.
+     */
+    centre = (x == state->cx && y == state->cy);
+    sp = NULL;
+    if (xshift != 0.0F || yshift != 0.0F) {
+        int key = (tile & (0x0F | FLASHING | ACTIVE)) |
+            (centre ? SPRITE_CENTRE : 0);
+        if (!ds->sprites[key] &&
+            (ds->sprites[key] = sprite_new(dr, TILE_SIZE+TILE_BORDER,
+                                           TILE_SIZE+TILE_BORDER))) {
+            sprite_begin(dr, ds->sprites[key]);
+            draw_tile_body(dr, ds, 0, 0, tile, centre);
+            sprite_end(dr, ds->sprites[key]);
+        }
+        sp = ds->sprites[key];
+    }
+    if (sp)
+        sprite_draw(dr, sp, bx, by, 0.0F);
+    else
+        draw_tile_body(dr, ds, bx, by, tile, centre);
 
     /*
      * Draw the points on the border if other tiles are connected
      * to us.
      */
+    cx = cy = TILE_BORDER + (TILE_SIZE-TILE_BORDER) / 2.0F - 0.5F;
     for (dir = 1; dir < 0x10; dir <<= 1) {
         int dx, dy, px, py, lx, ly, vx, vy, ox, oy;
 
@@ -1863,7 +1997,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    solve_step,
+    NULL, /* grade */
+    NULL, /* speculate */
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
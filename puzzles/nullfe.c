@@ -40,6 +40,11 @@ blitter *blitter_new(drawing *dr, int w, int h) { return snew(blitter); }
 void blitter_free(drawing *dr, blitter *bl) { sfree(bl); }
 void blitter_save(drawing *dr, blitter *bl, int x, int y) {}
 void blitter_load(drawing *dr, blitter *bl, int x, int y) {}
+sprite *sprite_new(drawing *dr, int w, int h) { return NULL; }
+void sprite_free(drawing *dr, sprite *sp) {}
+void sprite_begin(drawing *dr, sprite *sp) {}
+void sprite_end(drawing *dr, sprite *sp) {}
+void sprite_draw(drawing *dr, sprite *sp, int x, int y, float angle) {}
 int print_mono_colour(drawing *dr, int grey) { return 0; }
 int print_grey_colour(drawing *dr, float grey) { return 0; }
 int print_hatched_colour(drawing *dr, int hatch) { return 0; }
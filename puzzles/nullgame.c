@@ -236,7 +236,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     false, NULL, /* solve */
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
     false, NULL, NULL, /* can_format_as_text_now, text_format */
     NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
@@ -193,6 +193,15 @@ typedef struct solver_ctx {
     clue *clues;                /* also in shared_state */
     borderflag *borders;        /* also in game_state */
     DSF *dsf;                   /* particular to the solver */
+
+    /* Copy of the dsf's roots and class sizes, valid until the next
+     * connect(); see solver_snapshot(). */
+    int *roots, *sizes;
+    bool snapshot;
+
+    /* Squares with none of their four edges still undecided; see
+     * settled(). */
+    bool *settled;
 } solver_ctx;
 
 /* Deductions:
@@ -271,17 +280,43 @@ static const int bitcount[16] = {0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4};
 
 #define COMPUTE_J (-1)
 
+/*
+ * Most deductions spend their time asking whether two squares are
+ * connected, and can go a whole pass without connecting anything; so
+ * each pass starts by reading the whole dsf into arrays in one sweep
+ * (if it has changed since last time), and queries are answered from
+ * there until the next connect().
+ */
+static void solver_snapshot(solver_ctx *ctx)
+{
+    if (ctx->snapshot)
+        return;                        /* nothing's changed */
+    dsf_canonify_all(ctx->dsf, ctx->roots);
+    dsf_size_all(ctx->dsf, ctx->sizes);
+    ctx->snapshot = true;
+}
+
 static void connect(solver_ctx *ctx, int i, int j)
 {
     dsf_merge(ctx->dsf, i, j);
+    ctx->snapshot = false;
 }
 
 static bool connected(solver_ctx *ctx, int i, int j, int dir)
 {
     if (j == COMPUTE_J) j = i + dx[dir] + ctx->params->w*dy[dir];
+    if (ctx->snapshot)
+        return ctx->roots[i] == ctx->roots[j];
     return dsf_equivalent(ctx->dsf, i, j);
 }
 
+static int region_size(solver_ctx *ctx, int i)
+{
+    if (ctx->snapshot)
+        return ctx->sizes[i];
+    return dsf_size(ctx->dsf, i);
+}
+
 static void disconnect(solver_ctx *ctx, int i, int j, int dir)
 {
     if (j == COMPUTE_J) j = i + dx[dir] + ctx->params->w*dy[dir];
@@ -303,6 +338,25 @@ static bool maybe(solver_ctx *ctx, int i, int j, int dir)
      * squares (i.e. out of bounds), connected doesn't. */
 }
 
+/*
+ * Whether all four edges of square i are decided. Edges only ever go
+ * from undecided to decided, so once a square is settled it stays
+ * settled, and the deductions below, which only act on undecided
+ * edges, can skip it on every later pass without asking again.
+ */
+static bool settled(solver_ctx *ctx, int i)
+{
+    int dir;
+
+    if (ctx->settled[i])
+        return true;
+    for (dir = 0; dir < 4; ++dir)
+        if (maybe(ctx, i, COMPUTE_J, dir))
+            return false;
+    ctx->settled[i] = true;
+    return true;
+}
+
 static void solver_connected_clues_versus_region_size(solver_ctx *ctx)
 {
     int w = ctx->params->w, h = ctx->params->h, wh = w*h, i, dir;
@@ -336,6 +390,7 @@ static bool solver_number_exhausted(solver_ctx *ctx)
 
     for (i = 0; i < wh; ++i) {
         if (ctx->clues[i] == EMPTY) continue;
+        if (settled(ctx, i)) continue;
 
         if (bitcount[(ctx->borders[i] & BORDER_MASK)] == ctx->clues[i]) {
             for (dir = 0; dir < 4; ++dir) {
@@ -371,11 +426,13 @@ static bool solver_not_too_big(solver_ctx *ctx)
     bool changed = false;
 
     for (i = 0; i < wh; ++i) {
-        int size = dsf_size(ctx->dsf, i);
+        int size;
+        if (settled(ctx, i)) continue;
+        size = region_size(ctx, i);
         for (dir = 0; dir < 4; ++dir) {
             int j = i + dx[dir] + w*dy[dir];
             if (!maybe(ctx, i, j, dir)) continue;
-            if (size + dsf_size(ctx->dsf, j) <= ctx->params->k) continue;
+            if (size + region_size(ctx, j) <= ctx->params->k) continue;
             disconnect(ctx, i, j, dir);
             changed = true;
         }
@@ -393,14 +450,17 @@ static bool solver_not_too_small(solver_ctx *ctx)
     snewa(outs, wh);
     setmem(outs, -1, wh);
 
+    /* Nothing is connected in this loop, so the snapshot stays good */
+    assert(ctx->snapshot);
     for (i = 0; i < wh; ++i) {
-        ci = dsf_canonify(ctx->dsf, i);
-        if (dsf_size(ctx->dsf, ci) == k) continue;
+        ci = ctx->roots[i];
+        if (ctx->sizes[i] == k) continue;
+        if (settled(ctx, i)) continue;
         for (dir = 0; dir < 4; ++dir) {
             int j = i + dx[dir] + w*dy[dir];
             if (!maybe(ctx, i, j, dir)) continue;
-            if (outs[ci] == -1) outs[ci] = dsf_canonify(ctx->dsf, j);
-            else if (outs[ci] != dsf_canonify(ctx->dsf, j)) outs[ci] = -2;
+            if (outs[ci] == -1) outs[ci] = ctx->roots[j];
+            else if (outs[ci] != ctx->roots[j]) outs[ci] = -2;
         }
     }
 
@@ -431,6 +491,12 @@ static bool solver_no_dangling_edges(solver_ctx *ctx)
             squares[1] = squares[2] = j;
             squares[0] = squares[3] = i;
 
+            /* If all four edges are decided, there's nothing to do.
+             * (Either case below would then be marking an edge
+             * that's already decided, and so would do the same on
+             * every pass for ever.) */
+            if (settled(ctx, i) && settled(ctx, j)) continue;
+
             /* for each edge adjacent to the vertex */
             for (dir = 0; dir < 4; ++dir)
                 if (!connected(ctx, squares[dir], COMPUTE_J, dir)) {
@@ -478,6 +544,7 @@ static bool solver_equivalent_edges(solver_ctx *ctx)
     for (i = 0; i < wh; ++i) {
         int n_on = 0, n_off = 0;
         if (ctx->clues[i] < 1 || ctx->clues[i] > 3) continue;
+        if (settled(ctx, i)) continue;
 
         if (ctx->clues[i] == 2 /* don't need it otherwise */)
             for (dirj = 0; dirj < 4; ++dirj) {
@@ -589,17 +656,30 @@ static bool solver(const game_params *params, clue *clues, borderflag *borders)
     ctx.clues = clues;
     ctx.borders = borders;
     ctx.dsf = dsf_new(wh);
+    ctx.roots = snewn(wh, int);
+    ctx.sizes = snewn(wh, int);
+    ctx.snapshot = false;
+    ctx.settled = snewn(wh, bool);
+    setmem(ctx.settled, false, wh);
 
     solver_connected_clues_versus_region_size(&ctx); /* idempotent */
     do {
         changed  = false;
+        solver_snapshot(&ctx);
         changed |= solver_number_exhausted(&ctx);
+        solver_snapshot(&ctx);
         changed |= solver_not_too_big(&ctx);
+        solver_snapshot(&ctx);
         changed |= solver_not_too_small(&ctx);
+        solver_snapshot(&ctx);
         changed |= solver_no_dangling_edges(&ctx);
+        solver_snapshot(&ctx);
         changed |= solver_equivalent_edges(&ctx);
     } while (changed);
 
+    sfree(ctx.settled);
+    sfree(ctx.sizes);
+    sfree(ctx.roots);
     dsf_free(ctx.dsf);
 
     return is_solved(params, clues, borders);
@@ -720,17 +800,11 @@ static const char *validate_desc(const game_params *params, const char *desc)
         if (islower((unsigned char)*desc)) {
             squares += *desc - 'a' + 1;
         } else if (isdigit((unsigned char)*desc)) {
-            if (*desc > '4') {
-                static char buf[] = "Invalid (too large) number: '5'";
-                assert (isdigit((unsigned char)buf[lenof(buf) - 3]));
-                buf[lenof(buf) - 3] = *desc; /* ... or 6, 7, 8, 9 :-) */
-                return buf;
-            }
+            if (*desc > '4')
+                return "Invalid (too large) number in data";
             ++squares;
         } else if (isprint((unsigned char)*desc)) {
-            static char buf[] = "Invalid character in data: '?'";
-            buf[lenof(buf) - 3] = *desc;
-            return buf;
+            return "Invalid character in data";
         } else return "Invalid (unprintable) character in data";
     }
 
@@ -1560,7 +1634,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     get_prefs, set_prefs, /* get_prefs, set_prefs */
     new_ui,
@@ -1584,5 +1662,5 @@ const struct game thegame = {
     true, false, game_print_size, game_print,
     true,                                     /* wants_statusbar */
     false, NULL,                       /* timing_state */
-    REQUIRE_RBUTTON | STYLUS_SUPPORT,          /* flags */
+    REQUIRE_RBUTTON | STYLUS_SUPPORT | SOLVE_FROM_ORIG,          /* flags */
 };
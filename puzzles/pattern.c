@@ -377,74 +377,150 @@ static int compute_rowdata(int *ret, unsigned char *start, int len, int step)
 static bool verbose = false;
 #endif
 
-static bool do_recurse(unsigned char *known, unsigned char *deduced,
-                       unsigned char *row,
-		       unsigned char *minpos_done, unsigned char *maxpos_done,
-		       unsigned char *minpos_ok, unsigned char *maxpos_ok,
-		       int *data, int len,
-                       int freespace, int ndone, int lowest)
+/*
+ * Scratch space for the line solver, big enough for any row or
+ * column of the grid.
+ *
+ * The line solver finds every square that has the same contents in
+ * all the ways of laying the clue's runs out over the line that are
+ * consistent with what's already known. It does that with a pair of
+ * dynamic programs over (number of runs, position): fwd(j,i) says
+ * whether the first j runs can be laid out within the first i
+ * squares, and bwd(j,i) whether runs j onwards can be laid out in the
+ * squares from i to the end. A square can be empty if some j has
+ * fwd(j,c) and bwd(j,c+1); it can be full if some run j has a
+ * start position consistent with fwd on its left and bwd on its
+ * right. That's O(len * runs) per line, where the obvious search
+ * through all the layouts can be exponential.
+ */
+struct line_scratch {
+    unsigned char *known, *deduced;
+    unsigned char *fwd, *bwd;
+    int *run;                   /* run[i] = non-DOT squares from i on */
+    int *pre;
+};
+
+static struct line_scratch *new_line_scratch(int maxlen)
 {
-    int i, j, k;
+    struct line_scratch *ls = snew(struct line_scratch);
+    int maxruns = (maxlen + 1) / 2;
+
+    ls->known = snewn(maxlen, unsigned char);
+    ls->deduced = snewn(maxlen, unsigned char);
+    ls->fwd = snewn((maxruns + 1) * (maxlen + 1), unsigned char);
+    ls->bwd = snewn((maxruns + 1) * (maxlen + 1), unsigned char);
+    ls->run = snewn(maxlen + 1, int);
+    ls->pre = snewn(maxruns + 1, int);
+    return ls;
+}
 
+static void free_line_scratch(struct line_scratch *ls)
+{
+    sfree(ls->known);
+    sfree(ls->deduced);
+    sfree(ls->fwd);
+    sfree(ls->bwd);
+    sfree(ls->run);
+    sfree(ls->pre);
+    sfree(ls);
+}
 
-    /* This algorithm basically tries all possible ways the given rows of
-     * black blocks can be laid out in the row/column being examined.
-     * Special care is taken to avoid checking the tail of a row/column
-     * if the same conditions have already been checked during this recursion
-     * The algorithm also takes care to cut its losses as soon as an
-     * invalid (partial) solution is detected.
+static void do_line(struct line_scratch *ls, const int *data, int nruns,
+                    int len)
+{
+    const unsigned char *known = ls->known;
+    unsigned char *deduced = ls->deduced;
+    unsigned char *fwd = ls->fwd, *bwd = ls->bwd;
+    int *run = ls->run, *pre = ls->pre;
+    int i, j, l, e, lo, hi, last;
+    bool ok;
+
+#define FWD(j, i) fwd[(j) * (len + 1) + (i)]
+#define BWD(j, i) bwd[(j) * (len + 1) + (i)]
+
+    /*
+     * pre[j] is the shortest space runs [0,j) fit in, and SUF(j) the
+     * shortest that runs [j,nruns) fit in. fwd(j,i) can only be true
+     * for i >= pre[j], and bwd(j,i) for i <= len-SUF(j), so we only
+     * fill in each table between those limits, and clear the rest.
+     * On a nearly full line that's much less than len per run.
      */
-    if (data[ndone]) {
-	if (lowest >= minpos_done[ndone] && lowest <= maxpos_done[ndone]) {
-	    if (lowest >= minpos_ok[ndone] && lowest <= maxpos_ok[ndone]) {
-		for (i=0; i<lowest; i++)
-		    deduced[i] |= row[i];
-	    }
-	    return lowest >= minpos_ok[ndone] && lowest <= maxpos_ok[ndone];
-	} else {
-	    if (lowest < minpos_done[ndone]) minpos_done[ndone] = lowest;
-	    if (lowest > maxpos_done[ndone]) maxpos_done[ndone] = lowest;
-	}
-	for (i=0; i<=freespace; i++) {
-	    j = lowest;
-	    for (k=0; k<i; k++) {
-		if (known[j] == BLOCK) goto next_iter;
-	        row[j++] = DOT;
-	    }
-	    for (k=0; k<data[ndone]; k++) {
-		if (known[j] == DOT) goto next_iter;
-	        row[j++] = BLOCK;
-	    }
-	    if (j < len) {
-		if (known[j] == BLOCK) goto next_iter;
-	        row[j++] = DOT;
-	    }
-	    if (do_recurse(known, deduced, row, minpos_done, maxpos_done,
-	                   minpos_ok, maxpos_ok, data, len, freespace-i, ndone+1, j)) {
-	        if (lowest < minpos_ok[ndone]) minpos_ok[ndone] = lowest;
-	        if (lowest + i > maxpos_ok[ndone]) maxpos_ok[ndone] = lowest + i;
-	        if (lowest + i > maxpos_done[ndone]) maxpos_done[ndone] = lowest + i;
-	    }
-	    next_iter:
-	    j++;
-	}
-	return lowest >= minpos_ok[ndone] && lowest <= maxpos_ok[ndone];
-    } else {
-	for (i=lowest; i<len; i++) {
-	    if (known[i] == BLOCK) return false;
-	    row[i] = DOT;
-	    }
-	for (i=0; i<len; i++)
-	    deduced[i] |= row[i];
-	return true;
+    pre[0] = 0;
+    for (j = 1; j <= nruns; j++)
+        pre[j] = pre[j-1] + data[j-1] + (j > 1);
+#define SUF(j) ((j) == 0 ? pre[nruns] : (j) == nruns ? 0 : \
+                pre[nruns] - pre[j] - 1)
+
+    memset(fwd, 0, (nruns + 1) * (len + 1));
+    memset(bwd, 0, (nruns + 1) * (len + 1));
+
+    run[len] = 0;
+    for (i = len - 1; i >= 0; i--)
+        run[i] = (known[i] == DOT ? 0 : run[i+1] + 1);
+
+    /* fwd(j,i): squares [0,i) can hold exactly runs [0,j). */
+    FWD(0, 0) = true;
+    for (i = 1; i <= len - SUF(0); i++)
+        FWD(0, i) = FWD(0, i-1) && known[i-1] != BLOCK;
+    for (j = 1; j <= nruns; j++) {
+        l = data[j-1];
+        for (i = pre[j], hi = len - SUF(j); i <= hi; i++) {
+            ok = known[i-1] != BLOCK && FWD(j, i-1);
+            if (!ok && run[i-l] >= l)
+                ok = (i == l ? j == 1 :
+                      known[i-l-1] != BLOCK && FWD(j-1, i-l-1));
+            FWD(j, i) = ok;
+        }
     }
-}
 
+    if (!FWD(nruns, len))
+        return;                        /* no layout at all */
+
+    /* bwd(j,i): squares [i,len) can hold exactly runs [j,nruns). */
+    BWD(nruns, len) = true;
+    for (i = len - 1; i >= pre[nruns]; i--)
+        BWD(nruns, i) = BWD(nruns, i+1) && known[i] != BLOCK;
+    for (j = nruns - 1; j >= 0; j--) {
+        l = data[j];
+        for (i = len - SUF(j), lo = pre[j]; i >= lo; i--) {
+            ok = known[i] != BLOCK && BWD(j, i+1);
+            if (!ok && run[i] >= l)
+                ok = (i + l == len ? j == nruns - 1 :
+                      known[i+l] != BLOCK && BWD(j+1, i+l+1));
+            BWD(j, i) = ok;
+        }
+    }
+
+    /* A square can be empty if it can come between runs j-1 and j. */
+    for (j = 0; j <= nruns; j++)
+        for (i = pre[j], hi = len - SUF(j); i < hi; i++)
+            if (known[i] != BLOCK && FWD(j, i) && BWD(j, i+1))
+                deduced[i] |= DOT;
+
+    /* A square can be full if some layout of a run covers it. */
+    for (j = 0; j < nruns; j++) {
+        l = data[j];
+        lo = pre[j] + (j > 0);
+        hi = len - SUF(j);             /* range of start positions */
+        last = -1;                     /* latest possible start so far */
+        for (i = lo; i < hi + l; i++) {
+            e = i + l;
+            if (i <= hi && run[i] >= l &&
+                (i == 0 ? j == 0 : known[i-1] != BLOCK && FWD(j, i-1)) &&
+                (e == len ? j == nruns - 1 :
+                 known[e] != BLOCK && BWD(j+1, e+1)))
+                last = i;
+            if (last >= 0 && last > i - l)
+                deduced[i] |= BLOCK;
+        }
+    }
+
+#undef FWD
+#undef BWD
+#undef SUF
+}
 
-static bool do_row(unsigned char *known, unsigned char *deduced,
-                   unsigned char *row,
-                   unsigned char *minpos_done, unsigned char *maxpos_done,
-                   unsigned char *minpos_ok, unsigned char *maxpos_ok,
+static bool do_row(struct line_scratch *ls,
                    unsigned char *start, int len, int step, int *data,
                    unsigned int *changed
 #ifdef STANDALONE_SOLVER
@@ -452,32 +528,25 @@ static bool do_row(unsigned char *known, unsigned char *deduced,
 #endif
                    )
 {
-    int rowlen, i, freespace;
+    unsigned char *known = ls->known, *deduced = ls->deduced;
+    int rowlen, i;
     bool done_any;
 
     assert(len >= 0);   /* avoid compile warnings about the memsets below */
 
-    freespace = len+1;
-    for (rowlen = 0; data[rowlen]; rowlen++) {
-	minpos_done[rowlen] = minpos_ok[rowlen] = len - 1;
-	maxpos_done[rowlen] = maxpos_ok[rowlen] = 0;
-	freespace -= data[rowlen]+1;
-    }
+    for (rowlen = 0; data[rowlen]; rowlen++);
 
     for (i = 0; i < len; i++) {
 	known[i] = start[i*step];
 	deduced[i] = 0;
     }
-    for (i = len - 1; i >= 0 && known[i] == DOT; i--)
-        freespace--;
 
     if (rowlen == 0) {
         memset(deduced, DOT, len);
     } else if (rowlen == 1 && data[0] == len) {
         memset(deduced, BLOCK, len);
     } else {
-        do_recurse(known, deduced, row, minpos_done, maxpos_done, minpos_ok,
-                   maxpos_ok, data, len, freespace, 0, 0);
+        do_line(ls, data, rowlen, len);
     }
 
     done_any = false;
@@ -513,7 +582,7 @@ static bool do_row(unsigned char *known, unsigned char *deduced,
 
 static bool solve_puzzle(const game_state *state, unsigned char *grid,
                          int w, int h,
-                         unsigned char *matrix, unsigned char *workspace,
+                         unsigned char *matrix, struct line_scratch *ls,
                          unsigned int *changed_h, unsigned int *changed_w,
                          int *rowdata
 #ifdef STANDALONE_SOLVER
@@ -615,10 +684,7 @@ static bool solve_puzzle(const game_state *state, unsigned char *grid,
 		    } else {
 			rowdata[compute_rowdata(rowdata, grid+i*w, w, 1)] = 0;
 		    }
-		    do_row(workspace, workspace+max, workspace+2*max,
-			   workspace+3*max, workspace+4*max,
-			   workspace+5*max, workspace+6*max,
-			   matrix+i*w, w, 1, rowdata, changed_w
+		    do_row(ls, matrix+i*w, w, 1, rowdata, changed_w
 #ifdef STANDALONE_SOLVER
 			   , "row", i+1, cluewid
 #endif
@@ -639,10 +705,7 @@ static bool solve_puzzle(const game_state *state, unsigned char *grid,
 		    } else {
 			rowdata[compute_rowdata(rowdata, grid+i, h, w)] = 0;
 		    }
-		    do_row(workspace, workspace+max, workspace+2*max,
-			   workspace+3*max, workspace+4*max,
-			   workspace+5*max, workspace+6*max,
-			   matrix+i, h, w, rowdata, changed_h
+		    do_row(ls, matrix+i, h, w, rowdata, changed_h
 #ifdef STANDALONE_SOLVER
 			   , "col", i+1, cluewid
 #endif
@@ -672,7 +735,8 @@ static unsigned char *generate_soluble(random_state *rs, int w, int h)
 {
     int i, j, max;
     bool ok;
-    unsigned char *grid, *matrix, *workspace;
+    unsigned char *grid, *matrix;
+    struct line_scratch *ls;
     unsigned int *changed_h, *changed_w;
     int *rowdata;
 
@@ -681,7 +745,7 @@ static unsigned char *generate_soluble(random_state *rs, int w, int h)
     grid = snewn(w*h, unsigned char);
     /* Allocate this here, to avoid having to reallocate it again for every geneerated grid */
     matrix = snewn(w*h, unsigned char);
-    workspace = snewn(max*7, unsigned char);
+    ls = new_line_scratch(max);
     changed_h = snewn(max+1, unsigned int);
     changed_w = snewn(max+1, unsigned int);
     rowdata = snewn(max+1, int);
@@ -717,12 +781,12 @@ static unsigned char *generate_soluble(random_state *rs, int w, int h)
         if (!ok)
             continue;
 
-	ok = solve_puzzle(NULL, grid, w, h, matrix, workspace,
+	ok = solve_puzzle(NULL, grid, w, h, matrix, ls,
 			  changed_h, changed_w, rowdata, 0);
     } while (!ok);
 
     sfree(matrix);
-    sfree(workspace);
+    free_line_scratch(ls);
     sfree(changed_h);
     sfree(changed_w);
     sfree(rowdata);
@@ -773,18 +837,18 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 
     {
         unsigned char *matrix = snewn(params->w*params->h, unsigned char);
-        unsigned char *workspace = snewn(max*7, unsigned char);
+        struct line_scratch *ls = new_line_scratch(max);
         unsigned int *changed_h = snewn(max+1, unsigned int);
         unsigned int *changed_w = snewn(max+1, unsigned int);
         int *rowdata = snewn(max+1, int);
         for (i = 0; i < params->w * params->h; i++) {
             state->common->immutable[index[i]] = false;
             if (!solve_puzzle(state, grid, params->w, params->h,
-                              matrix, workspace, changed_h, changed_w,
+                              matrix, ls, changed_h, changed_w,
                               rowdata, 0))
                 state->common->immutable[index[i]] = true;
         }
-        sfree(workspace);
+        free_line_scratch(ls);
         sfree(changed_h);
         sfree(changed_w);
         sfree(rowdata);
@@ -1098,7 +1162,7 @@ static char *solve_game(const game_state *state, const game_state *currstate,
     char *ret;
     int max;
     bool ok;
-    unsigned char *workspace;
+    struct line_scratch *ls;
     unsigned int *changed_h, *changed_w;
     int *rowdata;
 
@@ -1110,15 +1174,15 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 
     max = max(w, h);
     matrix = snewn(w*h, unsigned char);
-    workspace = snewn(max*7, unsigned char);
+    ls = new_line_scratch(max);
     changed_h = snewn(max+1, unsigned int);
     changed_w = snewn(max+1, unsigned int);
     rowdata = snewn(max+1, int);
 
-    ok = solve_puzzle(state, NULL, w, h, matrix, workspace,
+    ok = solve_puzzle(state, NULL, w, h, matrix, ls,
 		      changed_h, changed_w, rowdata, 0);
 
-    sfree(workspace);
+    free_line_scratch(ls);
     sfree(changed_h);
     sfree(changed_w);
     sfree(rowdata);
@@ -2103,7 +2167,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
@@ -2127,7 +2195,7 @@ const struct game thegame = {
     true, false, game_print_size, game_print,
     false,			       /* wants_statusbar */
     false, NULL,                       /* timing_state */
-    REQUIRE_RBUTTON | STYLUS_SUPPORT,  /* flags */
+    REQUIRE_RBUTTON | STYLUS_SUPPORT | SOLVE_FROM_ORIG,  /* flags */
 };
 
 #ifdef STANDALONE_SOLVER
@@ -2176,13 +2244,14 @@ int main(int argc, char **argv)
 
     {
 	int w = p->w, h = p->h, i, j, max, cluewid = 0;
-	unsigned char *matrix, *workspace;
+	unsigned char *matrix;
+	struct line_scratch *ls;
 	unsigned int *changed_h, *changed_w;
 	int *rowdata;
 
 	matrix = snewn(w*h, unsigned char);
 	max = max(w, h);
-	workspace = snewn(max*7, unsigned char);
+	ls = new_line_scratch(max);
 	changed_h = snewn(max+1, unsigned int);
 	changed_w = snewn(max+1, unsigned int);
 	rowdata = snewn(max+1, int);
@@ -2205,7 +2274,7 @@ int main(int argc, char **argv)
 	    }
 	}
 
-	solve_puzzle(s, NULL, w, h, matrix, workspace,
+	solve_puzzle(s, NULL, w, h, matrix, ls,
 		     changed_h, changed_w, rowdata, cluewid);
 
 	for (i = 0; i < h; i++) {
@@ -301,14 +301,29 @@ static const char *validate_params(const game_params *params, bool full)
  * Solver.
  */
 
+/*
+ * Masks of the square states which do, and don't, connect in
+ * direction d, indexed by d. Bit b is set in pearl_states_with[d] for
+ * each square state b (0 to 0xC) with b & d.
+ */
+static const short pearl_states_with[9] = {
+    0, 0x0AAA /* R */, 0x0CCC /* U */, 0, 0x10F0 /* L */, 0, 0, 0,
+    0x1F00 /* D */,
+};
+static const short pearl_states_without[9] = {
+    0, 0x1555 /* R */, 0x1333 /* U */, 0, 0x0F0F /* L */, 0, 0, 0,
+    0x00FF /* D */,
+};
+
 static int pearl_solve(int w, int h, char *clues, char *result,
                        int difficulty, bool partial)
 {
     int W = 2*w+1, H = 2*h+1;
     short *workspace;
     DSF *dsf;
-    int *dsfsize;
+    tdq *todo;
     int x, y, b, d;
+    int nloops = 0, loopsquare = -1;
     int ret = -1;
 
     /*
@@ -357,17 +372,28 @@ static int pearl_solve(int w, int h, char *clues, char *result,
 	    workspace[(2*y+1)*W+(2*x)] = (x==0 || x==w ? 2 : 3);
 
     /*
-     * We maintain a dsf of connected squares, together with a
-     * count of the size of each equivalence class.
+     * We maintain a dsf of the squares joined by connected edges,
+     * merging as each edge is connected, and count the edges which
+     * closed a loop when they were (remembering a square on the
+     * loop).
+     *
+     * The local deductions - between a square's possible states
+     * and the edges around it - only need redoing for a square
+     * when one of those changes. So the squares waiting to be
+     * looked at are kept in a tdq, and everything below which
+     * changes a square or an edge adds the squares concerned to
+     * it.
      */
     dsf = dsf_new(w*h);
-    dsfsize = snewn(w*h, int);
+    todo = tdq_new(w*h);
+    tdq_fill(todo);
 
     /*
      * Now repeatedly try to find something we can do.
      */
     while (1) {
 	bool done_something = false;
+	int c;
 
 #ifdef SOLVER_DIAGNOSTICS
         if (solver_show_working) {
@@ -379,112 +405,86 @@ static int pearl_solve(int w, int h, char *clues, char *result,
         }
 #endif
 
-	/*
-	 * Go through the square state words, and discard any
-	 * square state which is inconsistent with known facts
-	 * about the edges around the square.
-	 */
-	for (y = 0; y < h; y++)
-	    for (x = 0; x < w; x++) {
-		for (b = 0; b < 0xD; b++)
-		    if (workspace[(2*y+1)*W+(2*x+1)] & (1<<b)) {
-			/*
-			 * If any edge of this square is known to
-			 * be connected when state b would require
-			 * it disconnected, or vice versa, discard
-			 * the state.
-			 */
-			for (d = 1; d <= 8; d += d) {
-			    int ex = 2*x+1 + DX(d), ey = 2*y+1 + DY(d);
-			    if (workspace[ey*W+ex] ==
-				((b & d) ? 2 : 1)) {
-				workspace[(2*y+1)*W+(2*x+1)] &= ~(1<<b);
+	while ((c = tdq_remove(todo)) >= 0) {
+	    int sx = 2*(c%w)+1, sy = 2*(c/w)+1;
+	    short *square = &workspace[sy*W+sx], allowed = ~0;
+
+	    x = c % w;
+	    y = c / w;
+
+	    /*
+	     * Discard any square state which is inconsistent with
+	     * known facts about the edges around the square: any
+	     * state requiring an edge to be connected which is known
+	     * to be disconnected, or vice versa.
+	     */
+	    for (d = 1; d <= 8; d += d) {
+		int e = workspace[(sy+DY(d))*W+(sx+DX(d))];
+		if (e == 1)
+		    allowed &= pearl_states_with[d];
+		else if (e == 2)
+		    allowed &= pearl_states_without[d];
+	    }
+	    if (*square & ~allowed) {
 #ifdef SOLVER_DIAGNOSTICS
-                                if (solver_show_working)
-                                    printf("edge (%d,%d)-(%d,%d) rules out "
-                                           "state %d for square (%d,%d)\n",
-                                           ex/2, ey/2, (ex+1)/2, (ey+1)/2,
-                                           b, x, y);
+                if (solver_show_working)
+                    printf("edges around square (%d,%d) rule out states "
+                           "%#x\n", x, y, *square & ~allowed);
 #endif
-				done_something = true;
-				break;
-			    }
-			}
-		    }
+		*square &= allowed;
+	    }
 
-		/*
-		 * Consistency check: each square must have at
-		 * least one state left!
-		 */
-		if (!workspace[(2*y+1)*W+(2*x+1)]) {
+	    /*
+	     * Consistency check: each square must have at least one
+	     * state left!
+	     */
+	    if (!*square) {
 #ifdef SOLVER_DIAGNOSTICS
-                    if (solver_show_working)
-                        printf("edge check at (%d,%d): inconsistency\n", x, y);
+                if (solver_show_working)
+                    printf("edge check at (%d,%d): inconsistency\n", x, y);
 #endif
-		    ret = 0;
-		    goto cleanup;
-		}
+		ret = 0;
+		goto cleanup;
 	    }
 
-	/*
-	 * Now go through the states array again, and nail down any
-	 * unknown edge if one of its neighbouring squares makes it
-	 * known.
-	 */
-	for (y = 0; y < h; y++)
-	    for (x = 0; x < w; x++) {
-		int edgeor = 0, edgeand = 15;
-
-		for (b = 0; b < 0xD; b++)
-		    if (workspace[(2*y+1)*W+(2*x+1)] & (1<<b)) {
-			edgeor |= b;
-			edgeand &= b;
-		    }
-
-		/*
-		 * Now any bit clear in edgeor marks a disconnected
-		 * edge, and any bit set in edgeand marks a
-		 * connected edge.
-		 */
-
-		/* First check consistency: neither bit is both! */
-		if (edgeand & ~edgeor) {
+	    /*
+	     * Nail down any unknown edge of the square which all its
+	     * remaining states agree on.
+	     */
+	    for (d = 1; d <= 8; d += d) {
+		int ex = sx + DX(d), ey = sy + DY(d);
+
+		if (workspace[ey*W+ex] != 3)
+		    continue;
+		if (!(*square & pearl_states_with[d])) {
+		    workspace[ey*W+ex] = 2;
+		    tdq_add(todo, (y + DY(d))*w + (x + DX(d)));
 #ifdef SOLVER_DIAGNOSTICS
                     if (solver_show_working)
-                        printf("square check at (%d,%d): inconsistency\n",
-                               x, y);
+                        printf("possible states of square (%d,%d) force "
+                               "edge (%d,%d)-(%d,%d) to be disconnected\n",
+                               x, y, ex/2, ey/2, (ex+1)/2, (ey+1)/2);
 #endif
-		    ret = 0;
-		    goto cleanup;
-		}
+		} else if (!(*square & pearl_states_without[d])) {
+		    int ac = c, bc = (y + DY(d))*w + (x + DX(d));
 
-		for (d = 1; d <= 8; d += d) {
-		    int ex = 2*x+1 + DX(d), ey = 2*y+1 + DY(d);
-
-		    if (!(edgeor & d) && workspace[ey*W+ex] == 3) {
-			workspace[ey*W+ex] = 2;
-			done_something = true;
-#ifdef SOLVER_DIAGNOSTICS
-                        if (solver_show_working)
-                            printf("possible states of square (%d,%d) force "
-                                   "edge (%d,%d)-(%d,%d) to be disconnected\n",
-                                   x, y, ex/2, ey/2, (ex+1)/2, (ey+1)/2);
-#endif
-		    } else if ((edgeand & d) && workspace[ey*W+ex] == 3) {
-			workspace[ey*W+ex] = 1;
-			done_something = true;
+		    workspace[ey*W+ex] = 1;
+		    tdq_add(todo, bc);
 #ifdef SOLVER_DIAGNOSTICS
-                        if (solver_show_working)
-                            printf("possible states of square (%d,%d) force "
-                                   "edge (%d,%d)-(%d,%d) to be connected\n",
-                                   x, y, ex/2, ey/2, (ex+1)/2, (ey+1)/2);
+                    if (solver_show_working)
+                        printf("possible states of square (%d,%d) force "
+                               "edge (%d,%d)-(%d,%d) to be connected\n",
+                               x, y, ex/2, ey/2, (ex+1)/2, (ey+1)/2);
 #endif
+		    if (dsf_equivalent(dsf, ac, bc)) {
+			nloops++;
+			loopsquare = ac;
+		    } else {
+			dsf_merge(dsf, ac, bc);
 		    }
 		}
 	    }
-
-	if (done_something)
-	    continue;
+	}
 
 	/*
 	 * Now for longer-range clue-based deductions (using the
@@ -511,6 +511,7 @@ static int pearl_solve(int w, int h, char *clues, char *result,
 			     */
 			    if (workspace[fy*W+fx] != (1<<type)) {
 				workspace[fy*W+fx] = (1<<type);
+				tdq_add(todo, (fy/2)*w + fx/2);
 				done_something = true;
 #ifdef SOLVER_DIAGNOSTICS
                                 if (solver_show_working)
@@ -530,6 +531,8 @@ static int pearl_solve(int w, int h, char *clues, char *result,
 			     */
 			    if (!(workspace[fy*W+fx] & (1<<type))) {
 				workspace[ey*W+ex] = 2;
+				tdq_add(todo, y*w+x);
+				tdq_add(todo, (fy/2)*w + fx/2);
 				done_something = true;
 #ifdef SOLVER_DIAGNOSTICS
                                 if (solver_show_working)
@@ -565,6 +568,7 @@ static int pearl_solve(int w, int h, char *clues, char *result,
 			    !(workspace[gy*W+gx] & ((1<<(  d |A(d))) |
 						    (1<<(  d |C(d)))))) {
 			    workspace[(2*y+1)*W+(2*x+1)] &= ~(1<<type);
+			    tdq_add(todo, y*w+x);
 			    done_something = true;
 #ifdef SOLVER_DIAGNOSTICS
                             if (solver_show_working)
@@ -593,6 +597,7 @@ static int pearl_solve(int w, int h, char *clues, char *result,
 			if (!(workspace[fy*W+fx] &~ (bLR|bUD)) &&
 			    (workspace[gy*W+gx] &~ (bLU|bLD|bRU|bRD))) {
 			    workspace[gy*W+gx] &= (bLU|bLD|bRU|bRD);
+			    tdq_add(todo, (gy/2)*w + gx/2);
 			    done_something = true;
 #ifdef SOLVER_DIAGNOSTICS
                             if (solver_show_working)
@@ -617,85 +622,24 @@ static int pearl_solve(int w, int h, char *clues, char *result,
 	{
 	    int nonblanks, loopclass;
 
-	    dsf_reinit(dsf);
-	    for (x = 0; x < w*h; x++)
-		dsfsize[x] = 1;
-
 	    /*
-	     * First go through the edge entries and update the dsf
-	     * of which squares are connected to which others. We
-	     * also track the number of squares in each equivalence
-	     * class, and count the overall number of
-	     * known-non-blank squares.
-	     *
-	     * In the process of doing this, we must notice if a
-	     * loop has already been formed. If it has, we blank
-	     * out any square which isn't part of that loop
-	     * (failing a consistency check if any such square does
-	     * not have BLANK as one of its remaining options) and
-	     * exit the deduction loop with success.
+	     * If two loops have already been formed, that's doom.
+	     * Otherwise count the known-non-blank squares.
 	     */
-	    nonblanks = 0;
-	    loopclass = -1;
-	    for (y = 1; y < H-1; y++)
-		for (x = 1; x < W-1; x++)
-		    if ((y ^ x) & 1) {
-			/*
-			 * (x,y) are the workspace coordinates of
-			 * an edge field. Compute the normal-space
-			 * coordinates of the squares it connects.
-			 */
-			int ax = (x-1)/2, ay = (y-1)/2, ac = ay*w+ax;
-			int bx = x/2, by = y/2, bc = by*w+bx;
-
-			/*
-			 * If the edge is connected, do the dsf
-			 * thing.
-			 */
-			if (workspace[y*W+x] == 1) {
-			    int ae, be;
-
-			    ae = dsf_canonify(dsf, ac);
-			    be = dsf_canonify(dsf, bc);
-
-			    if (ae == be) {
-				/*
-				 * We have a loop!
-				 */
-				if (loopclass != -1) {
-				    /*
-				     * In fact, we have two
-				     * separate loops, which is
-				     * doom.
-				     */
+	    if (nloops > 1) {
 #ifdef SOLVER_DIAGNOSTICS
-                                    if (solver_show_working)
-                                        printf("two loops found in grid!\n");
+                if (solver_show_working)
+                    printf("two loops found in grid!\n");
 #endif
-				    ret = 0;
-				    goto cleanup;
-				}
-				loopclass = ae;
-			    } else {
-				/*
-				 * Merge the two equivalence
-				 * classes.
-				 */
-				int size = dsfsize[ae] + dsfsize[be];
-				dsf_merge(dsf, ac, bc);
-				ae = dsf_canonify(dsf, ac);
-				dsfsize[ae] = size;
-			    }
-			}
-		    } else if ((y & x) & 1) {
-			/*
-			 * (x,y) are the workspace coordinates of a
-			 * square field. If the square is
-			 * definitely not blank, count it.
-			 */
-			if (!(workspace[y*W+x] & bBLANK))
-			    nonblanks++;
-		    }
+		ret = 0;
+		goto cleanup;
+	    }
+	    loopclass = (nloops ? dsf_canonify(dsf, loopsquare) : -1);
+	    nonblanks = 0;
+	    for (y = 0; y < h; y++)
+		for (x = 0; x < w; x++)
+		    if (!(workspace[(2*y+1)*W+(2*x+1)] & bBLANK))
+			nonblanks++;
 
 	    /*
 	     * If we discovered an existing loop above, we must now
@@ -775,11 +719,13 @@ static int pearl_solve(int w, int h, char *clues, char *result,
 				/*
 				 * We have a loop. Is it a shortcut?
 				 */
-				if (dsfsize[ae] < nonblanks) {
+				if (dsf_size(dsf, ae) < nonblanks) {
 				    /*
 				     * Yes! Mark this edge disconnected.
 				     */
 				    workspace[y*W+x] = 2;
+				    tdq_add(todo, ac);
+				    tdq_add(todo, bc);
 				    done_something = true;
 #ifdef SOLVER_DIAGNOSTICS
                                     if (solver_show_working)
@@ -836,7 +782,7 @@ static int pearl_solve(int w, int h, char *clues, char *result,
 				     * loop, and see if it's a
 				     * shortcut.
 				     */
-				    int loopsize = dsfsize[e];
+				    int loopsize = dsf_size(dsf, e);
 				    if (e != ae)
 					loopsize++;/* add the square itself */
 				    if (loopsize < nonblanks) {
@@ -845,6 +791,7 @@ static int pearl_solve(int w, int h, char *clues, char *result,
 					 * state invalid.
 					 */
 					workspace[y*W+x] &= ~(1<<b);
+					tdq_add(todo, (y/2)*w + x/2);
 					done_something = true;
 #ifdef SOLVER_DIAGNOSTICS
                                         if (solver_show_working)
@@ -923,7 +870,7 @@ cleanup:
         }
     }
 
-    sfree(dsfsize);
+    tdq_free(todo);
     dsf_free(dsf);
     sfree(workspace);
     assert(ret >= 0);
@@ -1236,8 +1183,12 @@ static int new_clues(const game_params *params, random_state *rs,
         diff = DIFF_EASY;
 
     while (1) {
+        generation_progress(generation_retry_progress(ngen, 0.0F));
         ngen++;
+        generation_phase("grid");
 	pearl_loopgen(w, h, grid_out, rs, g);
+        generation_progress(generation_retry_progress(ngen-1, 0.25F));
+        generation_phase("clues");
 
 #ifdef GENERATION_DIAGNOSTICS
 	printf("grid array:\n");
@@ -1316,6 +1267,7 @@ static int new_clues(const game_params *params, random_state *rs,
             /*
              * See if we can solve the puzzle just like this.
              */
+            generation_phase("solve");
             ret = pearl_solve(w, h, clues, grid_out, diff, false);
             assert(ret > 0);	       /* shouldn't be inconsistent! */
             if (ret != 1)
@@ -1368,6 +1320,10 @@ static int new_clues(const game_params *params, random_state *rs,
                 int cluepos;
                 int clue;
 
+                generation_progress(generation_retry_progress(
+                    ngen-1, 1.0F - 0.5F * (nstraightpos + ncornerpos) /
+                    (nstraights + ncorners)));
+
                 /*
                  * Decide which clue to try to remove next. If both
                  * types are available, we choose whichever kind is
@@ -2813,7 +2769,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     get_prefs, set_prefs,
     new_ui,
@@ -2848,7 +2808,7 @@ const struct game thegame = {
 static const char *quis = NULL;
 
 static void usage(FILE *out) {
-    fprintf(out, "usage: %s <params>\n", quis);
+    fprintf(out, "usage: %s [-l | -s] [-e seed] <params>\n", quis);
 }
 
 static void pnum(int n, int ntot, const char *desc)
@@ -2904,6 +2864,98 @@ static void start_soak(game_params *p, random_state *rs, int nsecs)
     sfree(clues);
 }
 
+/*
+ * Throughput of the loop generator alone (which new_clues runs at
+ * least once per puzzle), for measuring changes to loopgen.c and the
+ * bias function.
+ */
+static void start_loopgen_soak(game_params *p, random_state *rs, int nsecs)
+{
+    time_t tt_start, tt_now, tt_last;
+    int n = 0;
+    char *lines;
+    grid *g;
+
+    tt_start = tt_last = time(NULL);
+
+    printf("Generating loops on a %dx%d grid", p->w, p->h);
+    if (nsecs > 0) printf(" for %d seconds", nsecs);
+    printf(".\n");
+
+    lines = snewn(p->w*p->h, char);
+    g = grid_new(GRID_SQUARE, p->w-1, p->h-1, NULL);
+
+    while (1) {
+        pearl_loopgen(p->w, p->h, lines, rs, g);
+        n++;
+
+        tt_now = time(NULL);
+        if (tt_now > tt_last) {
+            tt_last = tt_now;
+            printf("%d loops, %3.1f/s\n",
+                   n, (double)n / ((double)tt_now - tt_start));
+        }
+        if (nsecs > 0 && (tt_now - tt_start) > nsecs) {
+            printf("\n");
+            break;
+        }
+    }
+
+    grid_free(g);
+    sfree(lines);
+}
+
+/*
+ * Throughput of the solver alone, on the fully clued grids which
+ * new_clues first tries to solve (most of which it then discards as
+ * ambiguous), at the params' difficulty.
+ */
+#define SOLVER_SOAK_GRIDS 50
+static void start_solver_soak(game_params *p, random_state *rs, int nsecs)
+{
+    time_t tt_start, tt_now, tt_last;
+    int n = 0, nsolved = 0, i, ret;
+    char *grid, *clues;
+
+    printf("Solving %dx%d grids at %s", p->w, p->h,
+           pearl_diffnames[p->difficulty]);
+    if (nsecs > 0) printf(" for %d seconds", nsecs);
+    printf(".\n");
+
+    p->nosolve = true;
+
+    grid = snewn(p->w*p->h, char);
+    clues = snewn(SOLVER_SOAK_GRIDS * p->w*p->h, char);
+    for (i = 0; i < SOLVER_SOAK_GRIDS; i++)
+        new_clues(p, rs, clues + i * p->w*p->h, grid);
+
+    tt_start = tt_last = time(NULL);
+
+    while (1) {
+        ret = pearl_solve(p->w, p->h, clues + (n % SOLVER_SOAK_GRIDS) *
+                          p->w*p->h, grid, p->difficulty, false);
+        n++;
+        if (ret == 1) nsolved++;
+
+        tt_now = time(NULL);
+        if (tt_now > tt_last) {
+            tt_last = tt_now;
+            printf("%d solves, %3.1f/s, %.1fus each, ",
+                   n, (double)n / ((double)tt_now - tt_start),
+                   1e6 * ((double)tt_now - tt_start) / (double)n);
+            pnum(nsolved, n, "solved");
+            printf("\n");
+        }
+        if (nsecs > 0 && (tt_now - tt_start) > nsecs) {
+            printf("\n");
+            break;
+        }
+    }
+
+    sfree(grid);
+    sfree(clues);
+}
+
 int main(int argc, char *argv[])
 {
     game_params *p = NULL;
@@ -2911,6 +2963,7 @@ int main(int argc, char *argv[])
     time_t seed = time(NULL);
     char *id = NULL;
     const char *err;
+    bool loopgen_only = false, solver_only = false;
 
     setvbuf(stdout, NULL, _IONBF, 0);
 
@@ -2921,6 +2974,10 @@ int main(int argc, char *argv[])
         if (!strcmp(p, "-e") || !strcmp(p, "--seed")) {
             seed = atoi(*++argv);
             argc--;
+        } else if (!strcmp(p, "-l") || !strcmp(p, "--loopgen")) {
+            loopgen_only = true;
+        } else if (!strcmp(p, "-s") || !strcmp(p, "--solver")) {
+            solver_only = true;
         } else if (*p == '-') {
             fprintf(stderr, "%s: unrecognised option `%s'\n", argv[0], p);
             usage(stderr);
@@ -2946,13 +3003,23 @@ int main(int argc, char *argv[])
             goto done;
         }
 
-        start_soak(p, rs, 0); /* run forever */
+        if (loopgen_only)
+            start_loopgen_soak(p, rs, 0);
+        else if (solver_only)
+            start_solver_soak(p, rs, 0);
+        else
+            start_soak(p, rs, 0); /* run forever */
     } else {
         int i;
 
         for (i = 5; i <= 12; i++) {
             p->w = p->h = i;
-            start_soak(p, rs, 5);
+            if (loopgen_only)
+                start_loopgen_soak(p, rs, 5);
+            else if (solver_only)
+                start_solver_soak(p, rs, 5);
+            else
+                start_soak(p, rs, 5);
         }
     }
 
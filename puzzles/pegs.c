@@ -15,7 +15,6 @@
 #endif
 
 #include "puzzles.h"
-#include "tree234.h"
 
 #define GRID_HOLE 0
 #define GRID_PEG  1
@@ -259,180 +258,195 @@ struct move {
      * ends at (5,5), and vice versa during normal play.
      */
     int x, y, dx, dy;
-    /*
-     * cost is 0, 1 or 2, depending on how many GRID_OBSTs we must
-     * turn into GRID_HOLEs to play this move.
-     */
-    int cost;
 };
 
-static int movecmp(void *av, void *bv)
+/*
+ * The generator keeps the board as bitboards: for each row, a bitmap
+ * of its pegs and one of its obstacles (so holes are in neither).
+ * The moves it could make next are kept the same way, in a bitboard
+ * for each direction and cost, with a bit at each move's start
+ * point. (A move's cost is 0, 1 or 2, depending on how many
+ * GRID_OBSTs we must turn into GRID_HOLEs to play it.) A move only
+ * depends on the three squares it covers, so playing one only
+ * changes the moves which start within two rows of it, and we
+ * regenerate those a row at a time, by shifting whole rows of the
+ * board against each other.
+ *
+ * We choose among the moves in the order of their start points, by
+ * row and then column, and then of their directions in the order
+ * below.
+ */
+#define BB_BITS (8 * (int)sizeof(unsigned))
+
+static const int bb_dx[4] = { 0, -1, +1, 0 };
+static const int bb_dy[4] = { -1, 0, 0, +1 };
+
+struct pegboard {
+    int w, h, words;                   /* words per row */
+    unsigned *peg, *obst;              /* by row */
+    unsigned *endok[4];                /* one row each, by direction */
+    unsigned *moves[4][3];             /* by direction and cost */
+    unsigned *tmp[4];                  /* one row each */
+    int *rowmoves[3];                  /* moves of each cost, by row */
+    int nmoves[3];
+};
+
+static int bb_count(unsigned word)
 {
-    struct move *a = (struct move *)av;
-    struct move *b = (struct move *)bv;
-
-    if (a->y < b->y)
-	return -1;
-    else if (a->y > b->y)
-	return +1;
-
-    if (a->x < b->x)
-	return -1;
-    else if (a->x > b->x)
-	return +1;
-
-    if (a->dy < b->dy)
-	return -1;
-    else if (a->dy > b->dy)
-	return +1;
-
-    if (a->dx < b->dx)
-	return -1;
-    else if (a->dx > b->dx)
-	return +1;
-
-    return 0;
+    int n = 0;
+
+    while (word) {
+        word &= word - 1;
+        n++;
+    }
+    return n;
 }
 
-static int movecmpcost(void *av, void *bv)
+/* Set bit x of dst to bit x+shift of src (where 0 < |shift| < 3). */
+static void bb_shift(const unsigned *src, unsigned *dst, int words,
+                     int shift)
 {
-    struct move *a = (struct move *)av;
-    struct move *b = (struct move *)bv;
-
-    if (a->cost < b->cost)
-	return -1;
-    else if (a->cost > b->cost)
-	return +1;
+    int i;
 
-    return movecmp(av, bv);
+    for (i = 0; i < words; i++) {
+        if (shift > 0)
+            dst[i] = (src[i] >> shift) |
+                (i+1 < words ? src[i+1] << (BB_BITS - shift) : 0);
+        else
+            dst[i] = (src[i] << -shift) |
+                (i > 0 ? src[i-1] >> (BB_BITS + shift) : 0);
+    }
 }
 
-struct movetrees {
-    tree234 *bymove, *bycost;
-};
+static void bb_set(struct pegboard *bd, int x, int y, int v)
+{
+    unsigned bit = 1U << (x % BB_BITS);
+    int i = y * bd->words + x / BB_BITS;
+
+    bd->peg[i] &= ~bit;
+    bd->obst[i] &= ~bit;
+    if (v == GRID_PEG)
+        bd->peg[i] |= bit;
+    else if (v == GRID_OBST)
+        bd->obst[i] |= bit;
+}
 
-static void update_moves(unsigned char *grid, int w, int h, int x, int y,
-			 struct movetrees *trees)
+/*
+ * Regenerate the moves starting in row y.
+ */
+static void bb_update_row(struct pegboard *bd, int y)
 {
-    struct move move;
-    int dir, pos;
+    int words = bd->words, dir, cost, i;
+    unsigned *peg = bd->peg + y * words;
+    unsigned *p1 = bd->tmp[0], *p2 = bd->tmp[1];
+    unsigned *o1 = bd->tmp[2], *o2 = bd->tmp[3];
+
+    for (cost = 0; cost < 3; cost++)
+        bd->nmoves[cost] -= bd->rowmoves[cost][y];
 
-    /*
-     * There are twelve moves that can include (x,y): three in each
-     * of four directions. Check each one to see if it's possible.
-     */
     for (dir = 0; dir < 4; dir++) {
-	int dx, dy;
-
-	if (dir & 1)
-	    dx = 0, dy = dir - 2;
-	else
-	    dy = 0, dx = dir - 1;
-
-	assert(abs(dx) + abs(dy) == 1);
-
-	for (pos = 0; pos < 3; pos++) {
-	    int v1, v2, v3;
-
-	    move.dx = dx;
-	    move.dy = dy;
-	    move.x = x - pos*dx;
-	    move.y = y - pos*dy;
-
-	    if (move.x < 0 || move.x >= w || move.y < 0 || move.y >= h)
-		continue;	       /* completely invalid move */
-	    if (move.x+2*move.dx < 0 || move.x+2*move.dx >= w ||
-		move.y+2*move.dy < 0 || move.y+2*move.dy >= h)
-		continue;	       /* completely invalid move */
-
-	    v1 = grid[move.y * w + move.x];
-	    v2 = grid[(move.y+move.dy) * w + (move.x+move.dx)];
-	    v3 = grid[(move.y+2*move.dy)*w + (move.x+2*move.dx)];
-	    if (v1 == GRID_PEG && v2 != GRID_PEG && v3 != GRID_PEG) {
-		struct move *m;
-
-		move.cost = (v2 == GRID_OBST) + (v3 == GRID_OBST);
-
-		/*
-		 * This move is possible. See if it's already in
-		 * the tree.
-		 */
-		m = find234(trees->bymove, &move, NULL);
-		if (m && m->cost != move.cost) {
-		    /*
-		     * It's in the tree but listed with the wrong
-		     * cost. Remove the old version.
-		     */
-#ifdef GENERATION_DIAGNOSTICS
-		    printf("correcting %d%+d,%d%+d at cost %d\n",
-			   m->x, m->dx, m->y, m->dy, m->cost);
-#endif
-		    del234(trees->bymove, m);
-		    del234(trees->bycost, m);
-		    sfree(m);
-		    m = NULL;
-		}
-		if (!m) {
-		    struct move *m, *m2;
-		    m = snew(struct move);
-		    *m = move;
-		    m2 = add234(trees->bymove, m);
-		    m2 = add234(trees->bycost, m);
-		    assert(m2 == m);
-#ifdef GENERATION_DIAGNOSTICS
-		    printf("adding %d%+d,%d%+d at cost %d\n",
-			   move.x, move.dx, move.y, move.dy, move.cost);
-#endif
-		} else {
-#ifdef GENERATION_DIAGNOSTICS
-		    printf("not adding %d%+d,%d%+d at cost %d\n",
-			   move.x, move.dx, move.y, move.dy, move.cost);
-#endif
-		}
-	    } else {
-		/*
-		 * This move is impossible. If it is already in the
-		 * tree, delete it.
-		 * 
-		 * (We make use here of the fact that del234
-		 * doesn't have to be passed a pointer to the
-		 * _actual_ element it's deleting: it merely needs
-		 * one that compares equal to it, and it will
-		 * return the one it deletes.)
-		 */
-		struct move *m = del234(trees->bymove, &move);
-#ifdef GENERATION_DIAGNOSTICS
-		printf("%sdeleting %d%+d,%d%+d\n", m ? "" : "not ",
-		       move.x, move.dx, move.y, move.dy);
-#endif
-		if (m) {
-		    del234(trees->bycost, m);
-		    sfree(m);
-		}
-	    }
-	}
+        int dx = bb_dx[dir], dy = bb_dy[dir];
+        unsigned *m[3];
+
+        for (cost = 0; cost < 3; cost++)
+            m[cost] = bd->moves[dir][cost] + y * words;
+
+        if (dy && (y+2*dy < 0 || y+2*dy >= bd->h)) {
+            for (cost = 0; cost < 3; cost++)
+                memset(m[cost], 0, words * sizeof(unsigned));
+            continue;
+        }
+
+        /*
+         * Line up the middle and end squares of each move with its
+         * start.
+         */
+        if (dy) {
+            memcpy(p1, bd->peg + (y+dy) * words, words * sizeof(unsigned));
+            memcpy(p2, bd->peg + (y+2*dy) * words, words * sizeof(unsigned));
+            memcpy(o1, bd->obst + (y+dy) * words, words * sizeof(unsigned));
+            memcpy(o2, bd->obst + (y+2*dy) * words, words * sizeof(unsigned));
+        } else {
+            bb_shift(peg, p1, words, dx);
+            bb_shift(peg, p2, words, 2*dx);
+            bb_shift(bd->obst + y * words, o1, words, dx);
+            bb_shift(bd->obst + y * words, o2, words, 2*dx);
+        }
+
+        for (i = 0; i < words; i++) {
+            unsigned start = peg[i] & ~p1[i] & ~p2[i];
+
+            if (dx)
+                start &= bd->endok[dir][i];
+            m[0][i] = start & ~o1[i] & ~o2[i];
+            m[1][i] = start & (o1[i] ^ o2[i]);
+            m[2][i] = start & o1[i] & o2[i];
+        }
+    }
+
+    for (cost = 0; cost < 3; cost++) {
+        int n = 0;
+
+        for (dir = 0; dir < 4; dir++)
+            for (i = 0; i < words; i++)
+                n += bb_count(bd->moves[dir][cost][y * words + i]);
+        bd->rowmoves[cost][y] = n;
+        bd->nmoves[cost] += n;
     }
 }
 
 static void pegs_genmoves(unsigned char *grid, int w, int h, random_state *rs)
 {
-    struct movetrees atrees, *trees = &atrees;
-    struct move *m;
-    int x, y, i, nmoves;
-
-    trees->bymove = newtree234(movecmp);
-    trees->bycost = newtree234(movecmpcost);
+    struct pegboard abd, *bd = &abd;
+    int words = (w + BB_BITS - 1) / BB_BITS;
+    int x, y, i, dir, cost, nmoves;
+    unsigned *onboard;
+
+    bd->w = w;
+    bd->h = h;
+    bd->words = words;
+    bd->peg = snewn(h * words, unsigned);
+    bd->obst = snewn(h * words, unsigned);
+    memset(bd->peg, 0, h * words * sizeof(unsigned));
+    memset(bd->obst, 0, h * words * sizeof(unsigned));
+    for (y = 0; y < h; y++)
+        for (x = 0; x < w; x++)
+            bb_set(bd, x, y, grid[y*w+x]);
 
+    /*
+     * A horizontal move also needs its end square to be on the
+     * board. (Squares off the end of a row are neither pegs nor
+     * obstacles, so they'd otherwise look like holes.)
+     */
+    onboard = snewn(words, unsigned);
+    for (i = 0; i < words; i++)
+        onboard[i] = (w - i * BB_BITS >= BB_BITS ? ~0U :
+                      (1U << (w - i * BB_BITS)) - 1);
+    for (dir = 0; dir < 4; dir++) {
+        bd->endok[dir] = snewn(words, unsigned);
+        if (bb_dx[dir])
+            bb_shift(onboard, bd->endok[dir], words, 2 * bb_dx[dir]);
+        else
+            memcpy(bd->endok[dir], onboard, words * sizeof(unsigned));
+        bd->tmp[dir] = snewn(words, unsigned);
+        for (cost = 0; cost < 3; cost++)
+            bd->moves[dir][cost] = snewn(h * words, unsigned);
+    }
+    sfree(onboard);
+    for (cost = 0; cost < 3; cost++) {
+        bd->rowmoves[cost] = snewn(h, int);
+        for (y = 0; y < h; y++)
+            bd->rowmoves[cost][y] = 0;
+        bd->nmoves[cost] = 0;
+    }
     for (y = 0; y < h; y++)
-	for (x = 0; x < w; x++)
-	    if (grid[y*w+x] == GRID_PEG)
-		update_moves(grid, w, h, x, y, trees);
+        bb_update_row(bd, y);
 
     nmoves = 0;
 
     while (1) {
-	int limit, maxcost, index;
-	struct move mtmp, move, *m;
+	int maxcost, index, y0, y1;
+	struct move move;
 
 	/*
 	 * See how many moves we can make at zero cost. Make one,
@@ -443,48 +457,80 @@ static void pegs_genmoves(unsigned char *grid, int w, int h, random_state *rs)
 	 * accept cost-2 moves: if that's our only option, we give
 	 * up and finish.
 	 */
-	mtmp.y = h+1;
 	maxcost = (nmoves < w*h/2 ? 2 : 1);
-	m = NULL;		       /* placate optimiser */
-	for (mtmp.cost = 0; mtmp.cost <= maxcost; mtmp.cost++) {
-	    limit = -1;
-	    m = findrelpos234(trees->bycost, &mtmp, NULL, REL234_LT, &limit);
+	for (cost = 0; cost <= maxcost; cost++) {
 #ifdef GENERATION_DIAGNOSTICS
-	    printf("%d moves available with cost %d\n", limit+1, mtmp.cost);
+	    printf("%d moves available with cost %d\n",
+                   bd->nmoves[cost], cost);
 #endif
-	    if (m)
+	    if (bd->nmoves[cost])
 		break;
 	}
-	if (!m)
+	if (cost > maxcost)
 	    break;
 
-	index = random_upto(rs, limit+1);
-	move = *(struct move *)index234(trees->bycost, index);
+	/*
+	 * Find the move we've picked: first its row, then the word
+	 * of the row it starts in, then the square and direction.
+	 */
+	index = random_upto(rs, bd->nmoves[cost]);
+	for (y = 0; index >= bd->rowmoves[cost][y]; y++)
+	    index -= bd->rowmoves[cost][y];
+	for (i = 0;; i++) {
+	    int n = 0;
+
+	    for (dir = 0; dir < 4; dir++)
+		n += bb_count(bd->moves[dir][cost][y * words + i]);
+	    if (index < n)
+		break;
+	    index -= n;
+	}
+	for (x = i * BB_BITS;; x++) {
+	    for (dir = 0; dir < 4; dir++)
+		if ((bd->moves[dir][cost][y * words + i] >>
+                     (x % BB_BITS)) & 1)
+		    if (index-- == 0)
+			break;
+	    if (dir < 4)
+		break;
+	}
+	move.x = x;
+	move.y = y;
+	move.dx = bb_dx[dir];
+	move.dy = bb_dy[dir];
 
 #ifdef GENERATION_DIAGNOSTICS
 	printf("selecting move %d%+d,%d%+d at cost %d\n",
-	       move.x, move.dx, move.y, move.dy, move.cost);
+	       move.x, move.dx, move.y, move.dy, cost);
 #endif
 
 	grid[move.y * w + move.x] = GRID_HOLE;
 	grid[(move.y+move.dy) * w + (move.x+move.dx)] = GRID_PEG;
 	grid[(move.y+2*move.dy)*w + (move.x+2*move.dx)] = GRID_PEG;
-
 	for (i = 0; i <= 2; i++) {
 	    int tx = move.x + i*move.dx;
 	    int ty = move.y + i*move.dy;
-	    update_moves(grid, w, h, tx, ty, trees);
+	    bb_set(bd, tx, ty, grid[ty*w+tx]);
 	}
 
+	y0 = max(min(move.y, move.y + 2*move.dy) - 2, 0);
+	y1 = min(max(move.y, move.y + 2*move.dy) + 2, h-1);
+	for (y = y0; y <= y1; y++)
+	    bb_update_row(bd, y);
+
 	nmoves++;
     }
 
-    while ((m = delpos234(trees->bymove, 0)) != NULL) {
-	del234(trees->bycost, m);
-	sfree(m);
+    sfree(bd->peg);
+    sfree(bd->obst);
+    for (dir = 0; dir < 4; dir++) {
+        sfree(bd->endok[dir]);
+        sfree(bd->tmp[dir]);
+        for (cost = 0; cost < 3; cost++)
+            sfree(bd->moves[dir][cost]);
     }
-    freetree234(trees->bymove);
-    freetree234(trees->bycost);
+    for (cost = 0; cost < 3; cost++)
+        sfree(bd->rowmoves[cost]);
 }
 
 static void pegs_generate(unsigned char *grid, int w, int h, random_state *rs)
@@ -1371,7 +1417,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     false, NULL, /* solve */
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
@@ -20,7 +20,6 @@
 #include "puzzles.h"
 #include "penrose.h"
 #include "penrose-internal.h"
-#include "tree234.h"
 
 bool penrose_valid_letter(char c, int which)
 {
@@ -666,24 +665,31 @@ PenroseTriangle *penrose_adjacent(PenroseContext *ctx,
     return dst_tri;
 }
 
-static int penrose_cmp(void *av, void *bv)
+/* We should only ever need to compare the first two vertices of any
+ * triangle, because those force the rest */
+static unsigned long penrose_hash(const void *av)
 {
-    PenroseTriangle *a = (PenroseTriangle *)av, *b = (PenroseTriangle *)bv;
+    const PenroseTriangle *a = (const PenroseTriangle *)av;
+    int coeffs[8];
     size_t i, j;
 
-    /* We should only ever need to compare the first two vertices of
-     * any triangle, because those force the rest */
-    for (i = 0; i < 2; i++) {
-        for (j = 0; j < 4; j++) {
-            int ac = a->vertices[i].coeffs[j], bc = b->vertices[i].coeffs[j];
-            if (ac < bc)
-                return -1;
-            if (ac > bc)
-                return +1;
-        }
-    }
+    for (i = 0; i < 2; i++)
+        for (j = 0; j < 4; j++)
+            coeffs[4*i+j] = a->vertices[i].coeffs[j];
+    return hash_ints(coeffs, 8);
+}
 
-    return 0;
+static bool penrose_eq(const void *av, const void *bv)
+{
+    const PenroseTriangle *a = (const PenroseTriangle *)av;
+    const PenroseTriangle *b = (const PenroseTriangle *)bv;
+    size_t i, j;
+
+    for (i = 0; i < 2; i++)
+        for (j = 0; j < 4; j++)
+            if (a->vertices[i].coeffs[j] != b->vertices[i].coeffs[j])
+                return false;
+    return true;
 }
 
 static unsigned penrose_sibling_edge_index(char c)
@@ -701,13 +707,13 @@ void penrosectx_generate(
                      const PenroseTriangle *tri), void *inboundsctx,
     void (*tile)(void *tilectx, const Point *vertices), void *tilectx)
 {
-    tree234 *placed = newtree234(penrose_cmp);
+    hashset *placed = hashset_new(penrose_hash, penrose_eq);
     PenroseTriangle *qhead = NULL, *qtail = NULL;
 
     {
         PenroseTriangle *tri = penrose_initial(ctx);
 
-        add234(placed, tri);
+        hashset_add(placed, tri);
 
         tri->next = NULL;
         tri->reported = false;
@@ -731,7 +737,7 @@ void penrosectx_generate(
                 continue;
             }
 
-            found_tri = find234(placed, new_tri, NULL);
+            found_tri = hashset_find(placed, new_tri);
             if (found_tri) {
                 if (edge == sibling_edge && !tri->reported &&
                     !found_tri->reported) {
@@ -758,7 +764,7 @@ void penrosectx_generate(
                 continue;
             }
 
-            add234(placed, new_tri);
+            hashset_add(placed, new_tri);
             qtail->next = new_tri;
             qtail = new_tri;
             new_tri->next = NULL;
@@ -770,9 +776,10 @@ void penrosectx_generate(
 
     {
         PenroseTriangle *tri;
-        while ((tri = delpos234(placed, 0)) != NULL)
+        size_t pos = 0;
+        while ((tri = hashset_next(placed, &pos)) != NULL)
             penrose_free(tri);
-        freetree234(placed);
+        hashset_free(placed);
     }
 }
 
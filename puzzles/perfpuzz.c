@@ -0,0 +1,351 @@
+/*
+ * perfpuzz.c: performance regression harness for all puzzles.
+ *
+ * This is fuzzpuzz's sibling: it loads save files for any back-end
+ * and puts them through the same stages as fuzzpuzz does (load the
+ * save file, set up a game from its description, redraw it through
+ * a null drawing API, and save it again), but rather than looking
+ * for crashes, it times each stage. The idea is to run it over a
+ * fixed corpus of save files, such as icons/''*.sav and
+ * unreleased/savefiles/''*.sav (see the perfpuzz-corpus target), and
+ * compare the results with those of an earlier build.
+ *
+ * Usage: perfpuzz [--iterations N] [--save FILE] [--baseline FILE]
+ *                 [--threshold PERCENT] [--min-time US] SAVEFILE...
+ *
+ * Each save file is put through every stage N times (default 100).
+ * The output is a table, one line per save file, giving the mean CPU
+ * time per iteration of each stage, in microseconds:
+ *
+ *   deserialise  midend_deserialise() into a new midend
+ *   new_game     midend_game_id() and midend_new_game() with the
+ *                loaded game's ID, in another new midend
+ *   redraw       midend_force_redraw() of the loaded game
+ *   serialise    midend_serialise() of the loaded game
+ *
+ * --save writes the results to FILE, one "SAVEFILE STAGE TIME" line
+ * per stage, for use as a later --baseline. Given --baseline, each
+ * stage is compared with the baseline's time for the same save file
+ * (matched by file name, not directory), and any stage that is more
+ * than PERCENT (default 25) slower, and more than US (default 5)
+ * microseconds slower, is reported as a regression, and perfpuzz
+ * exits with status 1.
+ *
+ * CPU times only compare on the same machine, so for CI the thing to
+ * do is build both the base and the candidate revisions, and run
+ * the base with --save and then the candidate with --baseline.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "puzzles.h"
+
+enum { DESERIALISE, NEW_GAME, REDRAW, SERIALISE, NSTAGES };
+static const char *const stage_names[NSTAGES] = {
+    "deserialise", "new_game", "redraw", "serialise",
+};
+
+struct result {
+    const char *name;                  /* file name, without directory */
+    const char *game;
+    double us[NSTAGES];                /* mean time per iteration */
+};
+
+struct memread {
+    const unsigned char *buf;
+    size_t pos;
+    size_t len;
+};
+
+static bool mem_read(void *wctx, void *buf, int len)
+{
+    struct memread *ctx = wctx;
+
+    if (ctx->pos + len > ctx->len) return false;
+    memcpy(buf, ctx->buf + ctx->pos, len);
+    ctx->pos += len;
+    return true;
+}
+
+static void null_write(void *wctx, const void *buf, int len)
+{
+}
+
+static unsigned char *read_file(const char *filename, size_t *len)
+{
+    FILE *fp = fopen(filename, "rb");
+    unsigned char *buf = NULL;
+    size_t size = 0, got;
+
+    if (!fp)
+        return NULL;
+    *len = 0;
+    do {
+        if (*len == size) {
+            size = size * 2 + 4096;
+            buf = sresize(buf, size, unsigned char);
+        }
+        got = fread(buf + *len, 1, size - *len, fp);
+        *len += got;
+    } while (got > 0);
+    fclose(fp);
+    return buf;
+}
+
+static double elapsed_since(clock_t *last)
+{
+    clock_t now = clock();
+    double ret = (double)(now - *last) / CLOCKS_PER_SEC;
+    *last = now;
+    return ret;
+}
+
+/*
+ * Time each stage for one save file. Returns an error message, or
+ * NULL on success.
+ */
+static const char *perf_one(const unsigned char *data, size_t size,
+                            int iterations, struct result *res)
+{
+    static const drawing_api drapi = { 1, NULL };
+    struct memread ctx;
+    const char *err;
+    char *gamename, *id;
+    const game *ourgame = NULL;
+    double total[NSTAGES];
+    int i, s, w, h;
+
+    ctx.buf = data;
+    ctx.len = size;
+    ctx.pos = 0;
+    err = identify_game(&gamename, mem_read, &ctx);
+    if (err != NULL) return err;
+
+    for (i = 0; i < gamecount; i++)
+        if (strcmp(gamename, gamelist[i]->name) == 0)
+            ourgame = gamelist[i];
+    sfree(gamename);
+    if (ourgame == NULL)
+        return "Game not recognised";
+    res->game = ourgame->htmlhelp_topic;
+
+    for (s = 0; s < NSTAGES; s++)
+        total[s] = 0.0;
+    id = NULL;
+
+    for (i = 0; i < iterations; i++) {
+        midend *me, *me2;
+        clock_t last;
+
+        /* Freeing the midends isn't timed. */
+        last = clock();
+        me = midend_new(NULL, ourgame, &drapi, NULL);
+        ctx.pos = 0;
+        err = midend_deserialise(me, mem_read, &ctx);
+        total[DESERIALISE] += elapsed_since(&last);
+        if (err != NULL) {
+            midend_free(me);
+            sfree(id);
+            return err;
+        }
+
+        if (!id)
+            id = midend_get_game_id(me);
+        last = clock();
+        me2 = midend_new(NULL, ourgame, &drapi, NULL);
+        err = midend_game_id(me2, id);
+        if (err == NULL)
+            midend_new_game(me2);
+        total[NEW_GAME] += elapsed_since(&last);
+        midend_free(me2);
+        if (err != NULL) {
+            midend_free(me);
+            sfree(id);
+            return err;
+        }
+
+        w = h = INT_MAX;
+        midend_size(me, &w, &h, false, 1);
+        last = clock();
+        midend_force_redraw(me);
+        total[REDRAW] += elapsed_since(&last);
+
+        midend_serialise(me, null_write, NULL);
+        total[SERIALISE] += elapsed_since(&last);
+
+        midend_free(me);
+    }
+
+    for (s = 0; s < NSTAGES; s++)
+        res->us[s] = total[s] / iterations * 1e6;
+    sfree(id);
+    return NULL;
+}
+
+/* One "NAME STAGE TIME" line of a file written by --save. */
+struct baseline {
+    char name[256], stage[32];
+    double us;
+};
+
+static struct baseline *read_baseline(const char *filename, int *n)
+{
+    FILE *fp = fopen(filename, "r");
+    struct baseline *bl = NULL, b;
+    int size = 0;
+
+    *n = 0;
+    if (!fp)
+        return NULL;
+    while (fscanf(fp, "%255s %31s %lf", b.name, b.stage, &b.us) == 3) {
+        if (*n == size) {
+            size = size * 2 + 64;
+            bl = sresize(bl, size, struct baseline);
+        }
+        bl[(*n)++] = b;
+    }
+    fclose(fp);
+    return bl;
+}
+
+/* Look up a baseline time. Returns a negative time if there is none. */
+static double baseline_time(const struct baseline *bl, int n,
+                            const char *name, const char *stage)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+        if (!strcmp(bl[i].name, name) && !strcmp(bl[i].stage, stage))
+            return bl[i].us;
+    return -1.0;
+}
+
+static void usage(FILE *fp)
+{
+    fprintf(fp, "usage: perfpuzz [--iterations N] [--save FILE] "
+            "[--baseline FILE]\n"
+            "                [--threshold PERCENT] [--min-time US] "
+            "SAVEFILE...\n");
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = 100;
+    const char *savefile = NULL, *baselinefile = NULL;
+    double threshold = 25.0, min_time = 5.0;
+    struct baseline *bl = NULL;
+    int nbl = 0;
+    struct result *results;
+    int nresults = 0, regressions = 0, errors = 0;
+    bool doing_opts = true;
+    int i, s;
+
+    results = snewn(argc, struct result);
+
+    for (i = 1; i < argc; i++) {
+        const char *p = argv[i];
+
+        if (doing_opts && !strcmp(p, "--iterations") && i+1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (doing_opts && !strcmp(p, "--save") && i+1 < argc) {
+            savefile = argv[++i];
+        } else if (doing_opts && !strcmp(p, "--baseline") && i+1 < argc) {
+            baselinefile = argv[++i];
+        } else if (doing_opts && !strcmp(p, "--threshold") && i+1 < argc) {
+            threshold = atof(argv[++i]);
+        } else if (doing_opts && !strcmp(p, "--min-time") && i+1 < argc) {
+            min_time = atof(argv[++i]);
+        } else if (doing_opts && !strcmp(p, "--")) {
+            doing_opts = false;
+        } else if (doing_opts && p[0] == '-') {
+            fprintf(stderr, "perfpuzz: unrecognised option '%s'\n", p);
+            usage(stderr);
+            return 1;
+        } else {
+            unsigned char *data;
+            size_t len;
+            const char *err, *slash = strrchr(p, '/');
+            struct result *res = &results[nresults];
+
+            res->name = slash ? slash + 1 : p;
+            data = read_file(p, &len);
+            if (!data) {
+                fprintf(stderr, "perfpuzz: %s: unable to read file\n", p);
+                errors++;
+                continue;
+            }
+            err = perf_one(data, len, iterations > 0 ? iterations : 1, res);
+            sfree(data);
+            if (err) {
+                fprintf(stderr, "perfpuzz: %s: %s\n", p, err);
+                errors++;
+                continue;
+            }
+            nresults++;
+        }
+    }
+    if (nresults == 0 && errors == 0) {
+        usage(stderr);
+        return 1;
+    }
+
+    if (baselinefile) {
+        bl = read_baseline(baselinefile, &nbl);
+        if (!bl) {
+            fprintf(stderr, "perfpuzz: %s: unable to read baseline\n",
+                    baselinefile);
+            return 1;
+        }
+    }
+
+    printf("%-24s %-12s", "file", "game");
+    for (s = 0; s < NSTAGES; s++)
+        printf(" %12s", stage_names[s]);
+    printf("\n");
+    for (i = 0; i < nresults; i++) {
+        printf("%-24s %-12s", results[i].name, results[i].game);
+        for (s = 0; s < NSTAGES; s++)
+            printf(" %12.1f", results[i].us[s]);
+        printf("\n");
+    }
+
+    for (i = 0; i < nresults; i++) {
+        for (s = 0; s < NSTAGES; s++) {
+            double base, now = results[i].us[s];
+
+            if (!bl)
+                break;
+            base = baseline_time(bl, nbl, results[i].name, stage_names[s]);
+            if (base < 0)
+                continue;
+            if (now > base * (1.0 + threshold / 100.0) &&
+                now - base > min_time) {
+                printf("REGRESSION: %s %s: %.1fus -> %.1fus (%+.0f%%)\n",
+                       results[i].name, stage_names[s], base, now,
+                       (now - base) / base * 100.0);
+                regressions++;
+            }
+        }
+    }
+
+    if (savefile) {
+        FILE *fp = fopen(savefile, "w");
+        if (!fp) {
+            fprintf(stderr, "perfpuzz: %s: unable to write\n", savefile);
+            return 1;
+        }
+        for (i = 0; i < nresults; i++)
+            for (s = 0; s < NSTAGES; s++)
+                fprintf(fp, "%s %s %.3f\n", results[i].name, stage_names[s],
+                        results[i].us[s]);
+        fclose(fp);
+    }
+
+    sfree(bl);
+    sfree(results);
+    return (regressions || errors) ? 1 : 0;
+}
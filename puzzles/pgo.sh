@@ -0,0 +1,39 @@
+#!/bin/sh
+
+# Build the puzzles with profile-guided optimisation (see PGO in
+# cmake/setup.cmake).
+#
+# Usage: pgo.sh SOURCE-DIR BUILD-DIR [CMAKE-ARGS...]
+#
+# Configures BUILD-DIR to build instrumented binaries, builds them,
+# and trains them on the same workload as the benchmarks: every
+# preset of every puzzle generated and test-solved by benchmark.sh,
+# and benchsolve's solver corpus. Then reconfigures it to use the
+# profile, and builds again. CMAKE-ARGS are passed to the first
+# configuration (e.g. -DCMAKE_C_COMPILER=clang).
+#
+# Set PGO_COUNT to change how many games per preset benchmark.sh
+# generates for training (default 10): the profile only needs to be
+# representative, not precise.
+
+set -e
+
+if test $# -lt 2; then
+    echo "usage: pgo.sh SOURCE-DIR BUILD-DIR [CMAKE-ARGS...]" >&2
+    exit 1
+fi
+src=$(cd "$1" && pwd)
+build=$2
+shift 2
+
+cmake -S "$src" -B "$build" -DCMAKE_BUILD_TYPE=Release -DPGO=generate "$@"
+cmake --build "$build"
+
+(
+    cd "$build"
+    BENCHMARK_COUNT=${PGO_COUNT:-10} sh "$src/benchmark.sh" > /dev/null
+    ./benchsolve --count 5 --repeat 1 > /dev/null
+)
+
+cmake -S "$src" -B "$build" -DPGO=use
+cmake --build "$build"
@@ -23,8 +23,20 @@ struct document {
     bool got_solns;
     float *colwid, *rowht;
     float userscale;
+
+    /*
+     * In streaming mode (see document_stream_begin), stream_dr is
+     * the drawing we're emitting pages to as they fill up. nprinted
+     * is the number of puzzles at the front of the puzzles array
+     * that have already been printed, and pages_done is the number
+     * of pages emitted so far.
+     */
+    drawing *stream_dr;
+    int nprinted, pages_done;
 };
 
+static void stream_page(document *doc);
+
 /*
  * Create a new print document. pw and ph are the layout
  * parameters: they state how many puzzles will be printed across
@@ -45,23 +57,31 @@ document *document_new(int pw, int ph, float userscale)
 
     doc->userscale = userscale;
 
+    doc->stream_dr = NULL;
+    doc->nprinted = doc->pages_done = 0;
+
     return doc;
 }
 
+static void free_puzzles(struct puzzle *puzzles, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+	puzzles[i].game->free_params(puzzles[i].par);
+	puzzles[i].game->free_ui(puzzles[i].ui);
+	puzzles[i].game->free_game(puzzles[i].st);
+	if (puzzles[i].st2)
+	    puzzles[i].game->free_game(puzzles[i].st2);
+    }
+}
+
 /*
  * Free a document structure, whether it's been printed or not.
  */
 void document_free(document *doc)
 {
-    int i;
-
-    for (i = 0; i < doc->npuzzles; i++) {
-	doc->puzzles[i].game->free_params(doc->puzzles[i].par);
-	doc->puzzles[i].game->free_ui(doc->puzzles[i].ui);
-	doc->puzzles[i].game->free_game(doc->puzzles[i].st);
-	if (doc->puzzles[i].st2)
-	    doc->puzzles[i].game->free_game(doc->puzzles[i].st2);
-    }
+    free_puzzles(doc->puzzles, doc->npuzzles);
 
     sfree(doc->colwid);
     sfree(doc->rowht);
@@ -91,6 +111,27 @@ void document_add_puzzle(document *doc, const game *game, game_params *par,
     doc->npuzzles++;
     if (st2)
 	doc->got_solns = true;
+
+    if (doc->stream_dr &&
+        doc->npuzzles - doc->nprinted == doc->pw * doc->ph)
+        stream_page(doc);
+}
+
+/*
+ * Move all the puzzles from one document into another, in order,
+ * leaving the source document empty. (Useful for building up a
+ * document's contents in other threads.)
+ */
+void document_transfer(document *doc, document *src)
+{
+    int i;
+
+    for (i = 0; i < src->npuzzles; i++) {
+        struct puzzle *pz = &src->puzzles[i];
+        document_add_puzzle(doc, pz->game, pz->par, pz->ui, pz->st, pz->st2);
+    }
+    src->npuzzles = 0;
+    src->got_solns = false;
 }
 
 static void get_puzzle_size(const document *doc, struct puzzle *pz,
@@ -155,35 +196,16 @@ void document_end(const document *doc, drawing *dr)
 }
 
 /*
- * Print a single page of a document.
+ * Print a page containing the n puzzles starting at the given
+ * offset, showing either the puzzles themselves (pass 0) or their
+ * solutions (pass 1).
  */
-void document_print_page(const document *doc, drawing *dr, int page_nr)
+static void print_page(const document *doc, drawing *dr,
+                       int offset, int n, int pass, int pageno)
 {
-    int ppp;			       /* puzzles per page */
-    int pages;
-    int page, pass;
-    int pageno;
-    int i, n, offset;
+    int i;
     float colsum, rowsum;
 
-    ppp = doc->pw * doc->ph;
-    pages = (doc->npuzzles + ppp - 1) / ppp;
-
-    /* Get the current page, pass, and pageno based on page_nr. */
-    if (page_nr < pages) {
-        page = page_nr;
-        pass = 0;
-    }
-    else {
-        assert(doc->got_solns);
-        page = page_nr - pages;
-        pass = 1;
-    }
-    pageno = page_nr + 1;
-
-    offset = page * ppp;
-    n = min(ppp, doc->npuzzles - offset);
-
     print_begin_page(dr, pageno);
 
     for (i = 0; i < doc->pw; i++)
@@ -286,6 +308,87 @@ void document_print_page(const document *doc, drawing *dr, int page_nr)
     print_end_page(dr, pageno);
 }
 
+/*
+ * Print a single page of a document.
+ */
+void document_print_page(const document *doc, drawing *dr, int page_nr)
+{
+    int ppp;			       /* puzzles per page */
+    int pages;
+    int page, pass;
+    int offset;
+
+    ppp = doc->pw * doc->ph;
+    pages = (doc->npuzzles + ppp - 1) / ppp;
+
+    /* Get the current page and pass based on page_nr. */
+    if (page_nr < pages) {
+        page = page_nr;
+        pass = 0;
+    }
+    else {
+        assert(doc->got_solns);
+        page = page_nr - pages;
+        pass = 1;
+    }
+
+    offset = page * ppp;
+    print_page(doc, dr, offset, min(ppp, doc->npuzzles - offset),
+               pass, page_nr + 1);
+}
+
+/*
+ * Streaming mode. Rather than accumulating every puzzle in memory
+ * and printing them all at the end, each page is printed as soon as
+ * it has been filled, and the puzzles on it are freed. The page
+ * count isn't known in advance, so begin_doc is passed 0.
+ *
+ * The exception is solutions: they are still printed after all the
+ * puzzles, so if any puzzle has one, everything must be kept until
+ * document_stream_end.
+ */
+void document_stream_begin(document *doc, drawing *dr)
+{
+    assert(!doc->stream_dr);
+    assert(doc->npuzzles == 0);
+    doc->stream_dr = dr;
+    doc->nprinted = doc->pages_done = 0;
+    print_begin_doc(dr, 0);
+}
+
+static void stream_page(document *doc)
+{
+    int n = doc->npuzzles - doc->nprinted;
+
+    print_page(doc, doc->stream_dr, doc->nprinted, n, 0, ++doc->pages_done);
+    doc->nprinted += n;
+
+    if (!doc->got_solns) {
+        free_puzzles(doc->puzzles, doc->npuzzles);
+        doc->npuzzles = doc->nprinted = 0;
+    }
+}
+
+void document_stream_end(document *doc)
+{
+    int ppp = doc->pw * doc->ph;
+    int offset;
+
+    assert(doc->stream_dr);
+
+    if (doc->npuzzles > doc->nprinted)
+        stream_page(doc);
+
+    if (doc->got_solns)
+        for (offset = 0; offset < doc->npuzzles; offset += ppp)
+            print_page(doc, doc->stream_dr, offset,
+                       min(ppp, doc->npuzzles - offset), 1,
+                       ++doc->pages_done);
+
+    print_end_doc(doc->stream_dr);
+    doc->stream_dr = NULL;
+}
+
 /*
  * Having accumulated a load of puzzles, actually do the printing.
  */
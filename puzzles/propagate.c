@@ -0,0 +1,278 @@
+/*
+ * propagate.c: a worklist engine for solvers which repeatedly apply
+ * a set of deduction rules until none of them finds anything new.
+ */
+
+#include <assert.h>
+
+#include "puzzles.h"
+
+/*
+ * Implementation: each rule has a to-do queue of the items it still
+ * has to look at, which works just like a tdq (see tdq.c), but is
+ * kept here so that the test-and-add in propagate_changed (by far the
+ * most frequent operation, since one changed cell can queue items for
+ * many rules) is inline, and so that propagate_run can see which
+ * queues are empty without asking.
+ *
+ * The watches are collected as (cell, item type, item) triples, and
+ * sorted into a per-cell index (by a counting sort) the first time a
+ * cell is reported changed, so that propagate_changed is just a walk
+ * along that cell's watches, queueing each item for every rule of its
+ * type.
+ */
+
+struct propagate_rule {
+    /* Circular buffer of count queued items from head, and a flag
+     * for each item saying whether it's in there. */
+    int *queue, nitems, head, count;
+    bool *queued;
+    propagate_fn_t fn;
+    struct propagate_stats stats;
+};
+
+struct propagate_watch {
+    int cell, type, item;
+};
+
+struct propagate_type {
+    int nitems;
+    int *rules, nrules;                /* the rules on these items */
+};
+
+struct propagator {
+    int ncells;
+    struct propagate_rule *rules;
+    int nrules, rulesize;
+    struct propagate_type *types;
+    int ntypes, typesize;
+
+    /* Watches: in the order they were made until indexed, and then
+     * sorted by cell, with the watches of cell c from first[c] to
+     * first[c+1]. */
+    struct propagate_watch *watches;
+    int nwatches, watchsize;
+    int *first;                        /* NULL until indexed */
+};
+
+propagator *propagate_new(int ncells)
+{
+    propagator *p = snew(propagator);
+
+    p->ncells = ncells;
+    p->rules = NULL;
+    p->nrules = p->rulesize = 0;
+    p->types = NULL;
+    p->ntypes = p->typesize = 0;
+    p->watches = NULL;
+    p->nwatches = p->watchsize = 0;
+    p->first = NULL;
+    return p;
+}
+
+void propagate_free(propagator *p)
+{
+    int i;
+
+    for (i = 0; i < p->nrules; i++) {
+        sfree(p->rules[i].queue);
+        sfree(p->rules[i].queued);
+    }
+    for (i = 0; i < p->ntypes; i++)
+        sfree(p->types[i].rules);
+    sfree(p->rules);
+    sfree(p->types);
+    sfree(p->watches);
+    sfree(p->first);
+    sfree(p);
+}
+
+static void queue_fill(struct propagate_rule *rule)
+{
+    int i;
+
+    for (i = 0; i < rule->nitems; i++) {
+        rule->queue[i] = i;
+        rule->queued[i] = true;
+    }
+    rule->head = 0;
+    rule->count = rule->nitems;
+}
+
+static inline void queue_add(struct propagate_rule *rule, int item)
+{
+    if (!rule->queued[item]) {
+        int tail = rule->head + rule->count++;
+        if (tail >= rule->nitems)
+            tail -= rule->nitems;
+        rule->queue[tail] = item;
+        rule->queued[item] = true;
+    }
+}
+
+static int queue_remove(struct propagate_rule *rule)
+{
+    int item = rule->queue[rule->head];
+
+    assert(rule->count > 0);
+    rule->queued[item] = false;
+    rule->count--;
+    if (++rule->head == rule->nitems)
+        rule->head = 0;
+    return item;
+}
+
+int propagate_add_type(propagator *p, int nitems)
+{
+    struct propagate_type *type;
+
+    assert(!p->first);
+    if (p->ntypes >= p->typesize) {
+        p->typesize = p->ntypes * 2 + 4;
+        p->types = sresize(p->types, p->typesize, struct propagate_type);
+    }
+    type = &p->types[p->ntypes];
+    type->nitems = nitems;
+    type->rules = NULL;
+    type->nrules = 0;
+    return p->ntypes++;
+}
+
+int propagate_add_rule(propagator *p, const char *name, int type,
+                       propagate_fn_t fn)
+{
+    struct propagate_rule *rule;
+    struct propagate_type *t;
+
+    assert(!p->first);
+    assert(0 <= type && type < p->ntypes);
+    t = &p->types[type];
+    if (p->nrules >= p->rulesize) {
+        p->rulesize = p->nrules * 2 + 4;
+        p->rules = sresize(p->rules, p->rulesize, struct propagate_rule);
+    }
+    rule = &p->rules[p->nrules];
+    rule->nitems = t->nitems;
+    rule->queue = snewn(t->nitems > 0 ? t->nitems : 1, int);
+    rule->queued = snewn(t->nitems > 0 ? t->nitems : 1, bool);
+    queue_fill(rule);                  /* everything needs looking at */
+    rule->fn = fn;
+    rule->stats.name = name;
+    rule->stats.calls = rule->stats.fired = rule->stats.deductions = 0;
+
+    t->rules = sresize(t->rules, t->nrules + 1, int);
+    t->rules[t->nrules++] = p->nrules;
+    return p->nrules++;
+}
+
+void propagate_watch(propagator *p, int type, int cell, int item)
+{
+    assert(!p->first);
+    assert(0 <= type && type < p->ntypes);
+    assert(0 <= cell && cell < p->ncells);
+    assert(0 <= item && item < p->types[type].nitems);
+    if (p->nwatches >= p->watchsize) {
+        p->watchsize = p->nwatches * 2 + 4 * p->ncells;
+        p->watches = sresize(p->watches, p->watchsize,
+                             struct propagate_watch);
+    }
+    p->watches[p->nwatches].cell = cell;
+    p->watches[p->nwatches].type = type;
+    p->watches[p->nwatches].item = item;
+    p->nwatches++;
+}
+
+static void propagate_index(propagator *p)
+{
+    int n = p->nwatches, c, i;
+    struct propagate_watch *sorted;
+
+    p->first = snewn(p->ncells + 2, int);
+    for (c = 0; c < p->ncells + 2; c++)
+        p->first[c] = 0;
+    for (i = 0; i < n; i++)
+        p->first[p->watches[i].cell + 2]++;
+    for (c = 2; c < p->ncells + 2; c++)
+        p->first[c] += p->first[c - 1];
+
+    /* Stable, so each cell's watches stay in the order they were
+     * made, which is the order their items are queued in. (first[c+1]
+     * is used as the insertion point for cell c, and ends up where it
+     * should be.) */
+    sorted = snewn(n > 0 ? n : 1, struct propagate_watch);
+    for (i = 0; i < n; i++)
+        sorted[p->first[p->watches[i].cell + 1]++] = p->watches[i];
+    sfree(p->watches);
+    p->watches = sorted;
+}
+
+void propagate_changed(propagator *p, int cell)
+{
+    int k, j;
+
+    assert(0 <= cell && cell < p->ncells);
+    if (!p->first)
+        propagate_index(p);
+    for (k = p->first[cell]; k < p->first[cell + 1]; k++) {
+        const struct propagate_watch *w = &p->watches[k];
+        const struct propagate_type *t = &p->types[w->type];
+        for (j = 0; j < t->nrules; j++)
+            queue_add(&p->rules[t->rules[j]], w->item);
+    }
+}
+
+void propagate_touch(propagator *p, int rule, int item)
+{
+    assert(0 <= rule && rule < p->nrules);
+    assert(0 <= item && item < p->rules[rule].nitems);
+    queue_add(&p->rules[rule], item);
+}
+
+void propagate_reset(propagator *p)
+{
+    int r;
+
+    for (r = 0; r < p->nrules; r++)
+        queue_fill(&p->rules[r]);
+}
+
+int propagate_run(propagator *p, int nrules, void *ctx)
+{
+    int total = 0;
+
+    assert(0 <= nrules && nrules <= p->nrules);
+    if (!p->first)
+        propagate_index(p);
+
+    while (true) {
+        struct propagate_rule *rule;
+        int r, ret;
+
+        /* Always go back to the first rule with anything to do, so
+         * that the expensive rules only run once the cheap ones have
+         * nothing left to say. */
+        for (r = 0; r < nrules; r++)
+            if (p->rules[r].count > 0)
+                break;
+        if (r == nrules)
+            return total;
+
+        rule = &p->rules[r];
+        rule->stats.calls++;
+        ret = rule->fn(ctx, r, queue_remove(rule));
+        if (ret < 0)
+            return -1;
+        if (ret > 0) {
+            rule->stats.fired++;
+            rule->stats.deductions += ret;
+            total += ret;
+        }
+    }
+}
+
+const struct propagate_stats *propagate_get_stats(const propagator *p,
+                                                  int rule)
+{
+    assert(0 <= rule && rule < p->nrules);
+    return &p->rules[rule].stats;
+}
@@ -16,6 +16,7 @@ struct psdata {
     bool clipped;
     float hatchthick, hatchspace;
     int gamewidth, gameheight;
+    int pages;                         /* if begin_doc didn't know */
     drawing *drawing;
 };
 
@@ -292,7 +293,16 @@ static void ps_begin_doc(drawing *dr, int pages)
     fputs("%%Creator: Simon Tatham's Portable Puzzle Collection\n", ps->fp);
     fputs("%%DocumentData: Clean7Bit\n", ps->fp);
     fputs("%%LanguageLevel: 1\n", ps->fp);
-    fprintf(ps->fp, "%%%%Pages: %d\n", pages);
+    /*
+     * If we weren't told the page count in advance, DSC lets us
+     * defer it to the trailer, in which case we count the pages as
+     * they go past.
+     */
+    if (pages > 0)
+        fprintf(ps->fp, "%%%%Pages: %d\n", pages);
+    else
+        fputs("%%Pages: (atend)\n", ps->fp);
+    ps->pages = (pages > 0 ? -1 : 0);
     fputs("%%DocumentNeededResources:\n", ps->fp);
     fputs("%%+ font Helvetica\n", ps->fp);
     fputs("%%+ font Courier\n", ps->fp);
@@ -337,6 +347,8 @@ static void ps_begin_page(drawing *dr, int number)
 
     fprintf(ps->fp, "%%%%Page: %d %d\ngsave save\n%g dup scale\n",
 	    number, number, 72.0 / 25.4);
+    if (ps->pages >= 0)
+        ps->pages++;
 }
 
 static void ps_begin_puzzle(drawing *dr, float xm, float xc,
@@ -376,6 +388,8 @@ static void ps_end_doc(drawing *dr)
 {
     psdata *ps = GET_HANDLE_AS_TYPE(dr, psdata);
 
+    if (ps->pages >= 0)
+        fprintf(ps->fp, "%%%%Trailer\n%%%%Pages: %d\n", ps->pages);
     fputs("%%EOF\n", ps->fp);
 }
 
@@ -416,6 +430,7 @@ psdata *ps_init(FILE *outfile, bool colour)
     ps->ytop = 0;
     ps->clipped = false;
     ps->hatchthick = ps->hatchspace = ps->gamewidth = ps->gameheight = 0;
+    ps->pages = -1;
     ps->drawing = drawing_new(&ps_drawing, NULL, ps);
 
     return ps;
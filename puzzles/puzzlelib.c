@@ -0,0 +1,286 @@
+/*
+ * puzzlelib.c: the headless API in puzzlelib.h.
+ *
+ * Each call works directly on the game's backend functions, with
+ * structures of its own, in the same way as batchsolve.c: there's no
+ * midend, so nothing is shared between calls except the game
+ * vtables, which are constant. What little process-wide state the
+ * games keep is dealt with on the first call: grid.c's cache of
+ * recently built grids (whose grids are shared, with reference counts
+ * that aren't thread-safe) is turned off, and the caches of tables
+ * which Keen, Solo and Fifteen keep get threadpool.c's cache lock.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "puzzles.h"
+#include "grid.h"
+#include "puzzlelib.h"
+
+#define GAME(x) { #x, &x },
+static const struct {
+    const char *name;
+    const game *game;
+} games[] = {
+#include "generated-games.h"
+};
+#undef GAME
+
+static pthread_once_t puzzlelib_once = PTHREAD_ONCE_INIT;
+
+static void puzzlelib_setup(void)
+{
+    grid_cache_disable();
+    threadpool_lock_caches();
+}
+
+static const game *puzzlelib_find(const char *name)
+{
+    int i;
+
+    pthread_once(&puzzlelib_once, puzzlelib_setup);
+    for (i = 0; i < lenof(games); i++)
+        if (!strcmp(name, games[i].name))
+            return games[i].game;
+    return NULL;
+}
+
+const char *puzzlelib_game_name(int i)
+{
+    return i >= 0 && i < lenof(games) ? games[i].name : NULL;
+}
+
+char *puzzlelib_default_params(const char *name)
+{
+    const game *thegame = puzzlelib_find(name);
+    game_params *params;
+    char *pstr;
+
+    if (!thegame)
+        return NULL;
+    params = thegame->default_params();
+    pstr = thegame->encode_params(params, true);
+    thegame->free_params(params);
+    return pstr;
+}
+
+/*
+ * Decode a parameter string over the top of the defaults, as the
+ * midend does for "PARAMS#SEED" or "PARAMS:DESC". Returns NULL, with
+ * *error set, if they're invalid.
+ */
+static game_params *puzzlelib_params(const game *thegame, const char *pstr,
+                                     bool full, const char **error)
+{
+    game_params *params = thegame->default_params();
+
+    thegame->decode_params(params, pstr);
+    *error = thegame->validate_params(params, full);
+    if (*error) {
+        thegame->free_params(params);
+        return NULL;
+    }
+    return params;
+}
+
+/*
+ * Split a game ID and check it. Returns its game_state, and its
+ * params in *params, or NULL with *error set.
+ */
+static game_state *puzzlelib_new_game(const game *thegame, const char *id,
+                                      game_params **params,
+                                      const char **error)
+{
+    const char *desc = strchr(id, ':');
+    char *pstr;
+    game_state *state;
+
+    if (!desc) {
+        *error = strchr(id, '#') ? "Random seeds are not game IDs" :
+            "Game ID has no ':'";
+        return NULL;
+    }
+    pstr = snewn(desc - id + 1, char);
+    memcpy(pstr, id, desc - id);
+    pstr[desc - id] = '\0';
+    desc++;
+
+    *params = puzzlelib_params(thegame, pstr, false, error);
+    sfree(pstr);
+    if (!*params)
+        return NULL;
+    *error = thegame->validate_desc(*params, desc);
+    if (*error) {
+        thegame->free_params(*params);
+        return NULL;
+    }
+    state = thegame->new_game(NULL, *params, desc);
+    return state;
+}
+
+char *puzzlelib_generate(const char *name, const char *pstr,
+                         const char *seed, const char **error)
+{
+    const game *thegame = puzzlelib_find(name);
+    game_params *params;
+    random_state *rs;
+    char *desc, *aux = NULL, *encoded, *id;
+
+    if (!thegame) {
+        *error = "Unknown game";
+        return NULL;
+    }
+    params = puzzlelib_params(thegame, pstr, true, error);
+    if (!params)
+        return NULL;
+
+    /* Non-interactively, as for a midend without a drawing API. */
+    rs = random_new(seed, strlen(seed));
+    desc = thegame->new_desc(params, rs, &aux, false);
+    random_free(rs);
+    sfree(aux);
+
+    encoded = thegame->encode_params(params, false);
+    id = snewn(strlen(encoded) + strlen(desc) + 2, char);
+    sprintf(id, "%s:%s", encoded, desc);
+    sfree(encoded);
+    sfree(desc);
+    thegame->free_params(params);
+    return id;
+}
+
+const char *puzzlelib_validate(const char *name, const char *id)
+{
+    const game *thegame = puzzlelib_find(name);
+    game_params *params;
+    game_state *state;
+    const char *err;
+
+    if (!thegame)
+        return "Unknown game";
+    state = puzzlelib_new_game(thegame, id, &params, &err);
+    if (!state)
+        return err;
+    thegame->free_game(state);
+    thegame->free_params(params);
+    return NULL;
+}
+
+char *puzzlelib_solve(const char *name, const char *id, const char **error)
+{
+    const game *thegame = puzzlelib_find(name);
+    game_params *params;
+    game_state *state;
+    char *move;
+
+    if (!thegame) {
+        *error = "Unknown game";
+        return NULL;
+    }
+    if (!thegame->can_solve) {
+        *error = "This game has no solver";
+        return NULL;
+    }
+    state = puzzlelib_new_game(thegame, id, &params, error);
+    if (!state)
+        return NULL;
+    *error = NULL;
+    move = thegame->solve(state, state, NULL, error);
+    if (!move && !*error)
+        *error = "Solver returned no move";
+    thegame->free_game(state);
+    thegame->free_params(params);
+    return move;
+}
+
+char *puzzlelib_grade(const char *name, const char *id, const char **error)
+{
+    const game *thegame = puzzlelib_find(name);
+    game_params *params;
+    game_state *state;
+    char *grade;
+
+    if (!thegame) {
+        *error = "Unknown game";
+        return NULL;
+    }
+    if (!thegame->grade) {
+        *error = "This game has no graded solver";
+        return NULL;
+    }
+    state = puzzlelib_new_game(thegame, id, &params, error);
+    if (!state)
+        return NULL;
+    *error = NULL;
+    grade = thegame->grade(state, error);
+    if (!grade && !*error)
+        *error = "Solver returned no grade";
+    thegame->free_game(state);
+    thegame->free_params(params);
+    return grade;
+}
+
+void puzzlelib_free(char *str)
+{
+    sfree(str);
+}
+
+/*
+ * Front end functions needed by the rest of the code, none of which
+ * a headless caller ever reaches except fatal().
+ */
+
+void frontend_default_colour(frontend *fe, float *output)
+{
+    output[0] = output[1] = output[2] = 0.8F;
+}
+
+void get_random_seed(void **randseed, int *randseedsize)
+{
+    char *c = snewn(1, char);
+    *c = 0;
+    *randseed = c;
+    *randseedsize = 1;
+}
+
+void activate_timer(frontend *fe)
+{
+}
+
+void deactivate_timer(frontend *fe)
+{
+}
+
+void document_add_puzzle(document *doc, const game *game, game_params *par,
+                         game_ui *ui, game_state *st, game_state *st2)
+{
+}
+
+void fatal(const char *fmt, ...)
+{
+    va_list ap;
+
+    fprintf(stderr, "fatal error: ");
+
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
+#ifdef DEBUGGING
+void debug_printf(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+}
+#endif
@@ -0,0 +1,71 @@
+/*
+ * puzzlelib.h: a headless C API to every puzzle, for programs which
+ * generate, check and solve puzzles in bulk - such as a server making
+ * the day's puzzles - without running each game's own executable.
+ *
+ * It's built as libpuzzles, which contains all the puzzles (and is
+ * its own front end, so don't link it with another one).
+ *
+ * Puzzles are named by their source file names, as in
+ * generated-games.h ("tracks", "solo", ...). Game IDs are the usual
+ * "PARAMS:DESC" strings, as the games themselves print and accept.
+ *
+ * Every function here may be called from any number of threads at
+ * once. Strings returned are dynamically allocated, and must be freed
+ * with puzzlelib_free. Error messages are static strings, which must
+ * not be freed. The calling program mustn't start the puzzles' own
+ * thread pool (threadpool_start), which isn't reentrant, and which
+ * one thread per puzzle makes unnecessary anyway.
+ */
+
+#ifndef PUZZLES_PUZZLELIB_H
+#define PUZZLES_PUZZLELIB_H
+
+/*
+ * The name of the i-th puzzle, counting from 0, or NULL if there
+ * aren't that many.
+ */
+const char *puzzlelib_game_name(int i);
+
+/*
+ * The game's default parameters, in full, or NULL if there's no such
+ * game.
+ */
+char *puzzlelib_default_params(const char *name);
+
+/*
+ * Generate a puzzle from a parameter string and a random seed,
+ * exactly as the game would given the ID "PARAMS#SEED" on the
+ * command line (e.g. with --generate). Returns its game ID, or NULL
+ * with *error set if the game or the parameters are invalid.
+ */
+char *puzzlelib_generate(const char *name, const char *params,
+                         const char *seed, const char **error);
+
+/*
+ * Check a game ID. Returns NULL if it's valid, or an error message.
+ */
+const char *puzzlelib_validate(const char *name, const char *id);
+
+/*
+ * Solve a game ID with the game's own solver, as pressing Solve in
+ * the game would. Returns the move which solves it, in the game's
+ * own move format, or NULL with *error set if the ID is invalid or
+ * the solver failed.
+ */
+char *puzzlelib_solve(const char *name, const char *id,
+                      const char **error);
+
+/*
+ * Grade a game ID: run the game's solver once, at its highest
+ * difficulty level, and return the name of the hardest level of
+ * deduction it needed (e.g. "Tricky"), as the game's difficulty
+ * setting names it. Returns NULL with *error set if the ID is
+ * invalid, the solver failed, or the game has no graded solver.
+ */
+char *puzzlelib_grade(const char *name, const char *id,
+                      const char **error);
+
+void puzzlelib_free(char *str);
+
+#endif /* PUZZLES_PUZZLELIB_H */
@@ -0,0 +1,235 @@
+/*
+ * puzzlemeta.c: write out the static attributes of every puzzle as
+ * JSON, for front ends that want to describe the puzzles without
+ * loading them (the web app's home screen and menus, for instance).
+ *
+ * Usage: puzzlemeta > puzzle-metadata.json
+ *
+ * The output is one object, keyed by puzzle id (the source file name,
+ * as in generated-games.h), each of whose values holds:
+ *
+ *   name, the game struct's booleans (canConfigure, canSolve,
+ *   canFormatAsTextEver, canPrint, canPrintInColour, wantsStatusbar,
+ *   isTimed), canHint (whether it has a solve_step), needsRightButton
+ *   (from flags), flags itself, and preferredTilesize
+ *   defaultParams: the encoded default params
+ *   presets: the preset menu, as [{title, params, submenu?}...]
+ *   customParamsConfig, preferencesConfig: the CFG_SETTINGS and
+ *   CFG_PREFS config items, as {title, items: {id: {name, type,
+ *   choicenames?}}}
+ *
+ * The last two match what the web app's Frontend returns from
+ * getPresets(), getCustomParamsConfig() and getPreferencesConfig(),
+ * including its choice of config item ids (the keyword for
+ * preferences, and a slug of the name for everything else).
+ */
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "puzzles.h"
+
+#define GAME(x) { #x, &x },
+static const struct {
+    const char *id;
+    const game *game;
+} games[] = {
+#include "generated-games.h"
+};
+#undef GAME
+
+static void json_string(const char *s)
+{
+    putchar('"');
+    for (; *s; s++) {
+        unsigned char c = *s;
+        if (c == '"' || c == '\\')
+            printf("\\%c", c);
+        else if (c < 0x20)
+            printf("\\u%04x", c);
+        else
+            putchar(c);
+    }
+    putchar('"');
+}
+
+static void json_bool(const char *key, bool value)
+{
+    printf(",\"%s\":%s", key, value ? "true" : "false");
+}
+
+/* Config item ids, as slugify() in webapp.cpp ("Size (s*s)" is "size"). */
+static char *slugify(const char *name)
+{
+    char *slug = snewn(2 * strlen(name) + 8, char), *p = slug;
+    bool last_was_delimiter = false;
+
+    for (; *name; name++) {
+        unsigned char c = *name;
+        if (c > 127)
+            fatal("slugify: non-ASCII character: 0x%02X", c);
+        if (c == '(' && p > slug)
+            break;
+        if (isalnum(c) || c == '%') {
+            if (last_was_delimiter && p > slug)
+                *p++ = '-';
+            if (c == '%') {
+                strcpy(p, "percent");
+                p += strlen(p);
+            } else {
+                *p++ = tolower(c);
+            }
+            last_was_delimiter = false;
+        } else {
+            last_was_delimiter = true;
+        }
+    }
+    *p = '\0';
+    return slug;
+}
+
+static void write_config(midend *me, int which)
+{
+    char *title;
+    config_item *cfg = midend_get_config(me, which, &title), *i;
+    bool first = true;
+
+    printf("{\"title\":");
+    json_string(title);
+    printf(",\"items\":{");
+    for (i = cfg; i->type != C_END; i++) {
+        if (!first)
+            putchar(',');
+        first = false;
+        if (which == CFG_PREFS) {
+            json_string(i->kw);
+        } else {
+            char *slug = slugify(i->name);
+            json_string(slug);
+            sfree(slug);
+        }
+        printf(":{\"name\":");
+        json_string(i->name);
+        switch (i->type) {
+          case C_STRING:
+            printf(",\"type\":\"string\"");
+            break;
+          case C_BOOLEAN:
+            printf(",\"type\":\"boolean\"");
+            break;
+          case C_CHOICES: {
+            /* Split the choice names on their first character. */
+            const char *names = i->u.choices.choicenames;
+            char delimiter = names[0];
+            const char *p = names + 1, *end;
+            printf(",\"type\":\"choices\",\"choicenames\":[");
+            while (*p) {
+                char *choice;
+                end = strchr(p, delimiter);
+                if (!end)
+                    end = p + strlen(p);
+                choice = snewn(end - p + 1, char);
+                memcpy(choice, p, end - p);
+                choice[end - p] = '\0';
+                if (p != names + 1)
+                    putchar(',');
+                json_string(choice);
+                sfree(choice);
+                p = *end ? end + 1 : end;
+            }
+            putchar(']');
+            break;
+          }
+          default:
+            printf(",\"type\":\"unknown\",\"raw_type\":%d", i->type);
+            break;
+        }
+        putchar('}');
+    }
+    printf("}}");
+    free_cfg(cfg);
+    sfree(title);
+}
+
+static void write_presets(midend *me, const struct preset_menu *menu)
+{
+    const char *params;
+    int i;
+
+    putchar('[');
+    for (i = 0; i < menu->n_entries; i++) {
+        const struct preset_menu_entry *entry = &menu->entries[i];
+        if (i > 0)
+            putchar(',');
+        printf("{\"title\":");
+        json_string(entry->title);
+        printf(",\"params\":");
+        /* (Submenus have no params of their own.) */
+        params = midend_get_encoded_params_for_preset(me, entry->id);
+        json_string(params ? params : "");
+        if (entry->submenu) {
+            printf(",\"submenu\":");
+            write_presets(me, entry->submenu);
+        }
+        putchar('}');
+    }
+    putchar(']');
+}
+
+static void write_game(const char *id, const game *g)
+{
+    static const drawing_api drapi = { 1, NULL };
+    midend *me = midend_new(NULL, g, &drapi, NULL);
+    char *params;
+
+    json_string(id);
+    printf(":{\"name\":");
+    json_string(g->name);
+    json_bool("canConfigure", g->can_configure);
+    json_bool("canSolve", g->can_solve);
+    json_bool("canHint", g->solve_step != NULL);
+    json_bool("canFormatAsTextEver", g->can_format_as_text_ever);
+    json_bool("canPrint", g->can_print);
+    json_bool("canPrintInColour", g->can_print_in_colour);
+    json_bool("wantsStatusbar", g->wants_statusbar);
+    json_bool("isTimed", g->is_timed);
+    json_bool("needsRightButton", g->flags & REQUIRE_RBUTTON);
+    printf(",\"flags\":%d", g->flags);
+    printf(",\"preferredTilesize\":%d", g->preferred_tilesize);
+
+    params = midend_get_encoded_params(me);
+    printf(",\"defaultParams\":");
+    json_string(params);
+    sfree(params);
+
+    printf(",\"presets\":");
+    write_presets(me, midend_get_presets(me, NULL));
+    printf(",\"customParamsConfig\":");
+    write_config(me, CFG_SETTINGS);
+    printf(",\"preferencesConfig\":");
+    write_config(me, CFG_PREFS);
+    putchar('}');
+
+    midend_free(me);
+}
+
+int main(int argc, char **argv)
+{
+    int i;
+
+    if (argc > 1) {
+        fprintf(stderr, "usage: puzzlemeta > puzzle-metadata.json\n");
+        return 1;
+    }
+
+    printf("{");
+    for (i = 0; i < lenof(games); i++) {
+        printf(i > 0 ? ",\n" : "\n");
+        write_game(games[i].id, games[i].game);
+    }
+    printf("\n}\n");
+    return 0;
+}
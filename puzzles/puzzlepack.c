@@ -0,0 +1,243 @@
+/*
+ * puzzlepack.c: generate games ahead of time, for a front end to ship
+ * alongside a puzzle, so that it can start a new game at a slow
+ * preset (Solo's Unreasonable, say) without waiting for the generator.
+ *
+ * Usage: puzzlepack [--count N] OUTPUT PUZZLE [PARAMS ...]
+ *
+ * Generates N games (default 20) for each PARAMS, or if there are
+ * none, for each of PUZZLE's presets, and writes them to OUTPUT as a
+ * pack. PUZZLE is the puzzle's id, as in generated-games.h. Each game
+ * is generated exactly as midend_generate_game would (from a fixed
+ * random seed, so the same source makes the same pack), and can be
+ * started by midend_supply_game.
+ *
+ * A pack is, with all numbers 32-bit little-endian and all offsets
+ * from the start of the file:
+ *
+ *   "PZPK", version (1), number of parameter sets
+ *   for each parameter set: offset and length of its params, offset
+ *     and length of its block
+ *   the params, encoded in full (as midend_get_encoded_params), with
+ *     no terminators
+ *   the blocks
+ *
+ * Each block is zlib-compressed text, with a line for each game:
+ * "SEED\tDESC\tAUX\n", where SEED is the random seed without the
+ * params (the full seed is "PARAMS#SEED") and AUX is the game's
+ * aux_info, which may be empty. (aux_info is free-form, so if a game's
+ * contains a tab or newline, that game is written without one.) A
+ * front end need only decompress the block for the params it wants.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include "puzzles.h"
+
+#define GAME(x) { #x, &x },
+static const struct {
+    const char *id;
+    const game *game;
+} games[] = {
+#include "generated-games.h"
+};
+#undef GAME
+
+#define PACK_VERSION 1
+
+struct buffer {
+    unsigned char *data;
+    size_t len, size;
+};
+
+static void buffer_append(struct buffer *buf, const void *data, size_t len)
+{
+    if (buf->len + len > buf->size) {
+        buf->size = (buf->len + len) * 5 / 4 + 256;
+        buf->data = sresize(buf->data, buf->size, unsigned char);
+    }
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+}
+
+static void buffer_append_str(struct buffer *buf, const char *str)
+{
+    buffer_append(buf, str, strlen(str));
+}
+
+static void buffer_append_u32(struct buffer *buf, unsigned long value)
+{
+    unsigned char bytes[4];
+
+    bytes[0] = value & 0xFF;
+    bytes[1] = (value >> 8) & 0xFF;
+    bytes[2] = (value >> 16) & 0xFF;
+    bytes[3] = (value >> 24) & 0xFF;
+    buffer_append(buf, bytes, 4);
+}
+
+/* Collect the params of every preset in a menu, once each. */
+static void add_presets(midend *me, const struct preset_menu *menu,
+                        char ***params, int *nparams)
+{
+    int i, j;
+
+    for (i = 0; i < menu->n_entries; i++) {
+        const struct preset_menu_entry *entry = &menu->entries[i];
+        const char *p;
+
+        if (entry->submenu) {
+            add_presets(me, entry->submenu, params, nparams);
+            continue;
+        }
+        p = midend_get_encoded_params_for_preset(me, entry->id);
+        if (!p)
+            continue;
+        for (j = 0; j < *nparams; j++)
+            if (!strcmp((*params)[j], p))
+                break;
+        if (j < *nparams)
+            continue;
+        *params = sresize(*params, *nparams + 1, char *);
+        (*params)[(*nparams)++] = dupstr(p);
+    }
+}
+
+/* Generate the compressed block for one set of params. */
+static void make_block(midend *me, const char *pstr, int count,
+                       struct buffer *out)
+{
+    struct buffer text = { NULL, 0, 0 };
+    const char *err;
+    unsigned char *compressed;
+    uLongf clen;
+    int i;
+
+    err = midend_set_encoded_params(me, pstr);
+    if (err)
+        fatal("invalid params '%s': %s", pstr, err);
+
+    for (i = 0; i < count; i++) {
+        char *seed, *desc, *aux;
+        const char *hash;
+
+        midend_generate_game(me, &seed, &desc, &aux);
+        hash = strchr(seed, '#');
+        buffer_append_str(&text, hash + 1);
+        buffer_append_str(&text, "\t");
+        buffer_append_str(&text, desc);
+        buffer_append_str(&text, "\t");
+        if (aux && !strpbrk(aux, "\t\n"))
+            buffer_append_str(&text, aux);
+        buffer_append_str(&text, "\n");
+        sfree(seed);
+        sfree(desc);
+        sfree(aux);
+    }
+
+    clen = compressBound(text.len);
+    compressed = snewn(clen, unsigned char);
+    if (compress2(compressed, &clen, text.data, text.len,
+                  Z_BEST_COMPRESSION) != Z_OK)
+        fatal("compression failed");
+    buffer_append(out, compressed, clen);
+    fprintf(stderr, "%s: %d games, %lu bytes (%lu compressed)\n",
+            pstr, count, (unsigned long)text.len, (unsigned long)clen);
+    sfree(compressed);
+    sfree(text.data);
+}
+
+int main(int argc, char **argv)
+{
+    const char *outfile = NULL, *id = NULL;
+    const game *thegame = NULL;
+    static const drawing_api drapi = { 1, NULL };
+    midend *me;
+    char **params = NULL;
+    int nparams = 0, count = 20, i;
+    struct buffer header = { NULL, 0, 0 }, blocks = { NULL, 0, 0 };
+    size_t paramslen, blockstart;
+    unsigned long *blockends;
+    FILE *fp;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--count") && i+1 < argc) {
+            count = atoi(argv[++i]);
+        } else if (argv[i][0] == '-') {
+            break;
+        } else if (!outfile) {
+            outfile = argv[i];
+        } else if (!id) {
+            id = argv[i];
+        } else {
+            params = sresize(params, nparams + 1, char *);
+            params[nparams++] = dupstr(argv[i]);
+        }
+    }
+    if (i < argc || !id || count < 1) {
+        fprintf(stderr, "usage: puzzlepack [--count N] OUTPUT PUZZLE "
+                "[PARAMS ...]\n");
+        return 1;
+    }
+    for (i = 0; i < lenof(games); i++)
+        if (!strcmp(id, games[i].id))
+            thegame = games[i].game;
+    if (!thegame) {
+        fprintf(stderr, "puzzlepack: unknown puzzle '%s'\n", id);
+        return 1;
+    }
+
+    me = midend_new(NULL, thegame, &drapi, NULL);
+    if (!nparams)
+        add_presets(me, midend_get_presets(me, NULL), &params, &nparams);
+
+    blockends = snewn(nparams, unsigned long);
+    for (i = 0; i < nparams; i++) {
+        make_block(me, params[i], count, &blocks);
+        blockends[i] = blocks.len;
+    }
+
+    paramslen = 0;
+    for (i = 0; i < nparams; i++)
+        paramslen += strlen(params[i]);
+    blockstart = 12 + 16 * nparams + paramslen;
+
+    buffer_append(&header, "PZPK", 4);
+    buffer_append_u32(&header, PACK_VERSION);
+    buffer_append_u32(&header, nparams);
+    paramslen = 0;
+    for (i = 0; i < nparams; i++) {
+        unsigned long start = i > 0 ? blockends[i-1] : 0;
+
+        buffer_append_u32(&header, 12 + 16 * nparams + paramslen);
+        buffer_append_u32(&header, strlen(params[i]));
+        buffer_append_u32(&header, blockstart + start);
+        buffer_append_u32(&header, blockends[i] - start);
+        paramslen += strlen(params[i]);
+    }
+    for (i = 0; i < nparams; i++)
+        buffer_append_str(&header, params[i]);
+    assert(header.len == blockstart);
+
+    fp = fopen(outfile, "wb");
+    if (!fp || fwrite(header.data, 1, header.len, fp) != header.len ||
+        fwrite(blocks.data, 1, blocks.len, fp) != blocks.len ||
+        fclose(fp)) {
+        fprintf(stderr, "puzzlepack: unable to write '%s'\n", outfile);
+        return 1;
+    }
+
+    for (i = 0; i < nparams; i++)
+        sfree(params[i]);
+    sfree(params);
+    sfree(blockends);
+    sfree(header.data);
+    sfree(blocks.data);
+    midend_free(me);
+    return 0;
+}
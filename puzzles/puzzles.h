@@ -29,6 +29,20 @@
 #define min(x,y) ( (x)<(y) ? (x) : (y) )
 #endif /* min */
 
+/* Bitmaps kept in arrays of unsigned long, for code which wants to
+ * work on them a word at a time. BITMAP_WORDS(n) is the number of
+ * words needed to hold n bits. */
+#define BITMAP_WORD_BITS (CHAR_BIT * sizeof(unsigned long))
+#define BITMAP_WORDS(n) ( ((n) + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS )
+#define BITMAP_GET(bits, i) ( ((bits)[(i) / BITMAP_WORD_BITS] >> \
+                               ((i) % BITMAP_WORD_BITS)) & 1 )
+#define BITMAP_SET(bits, i) ( (bits)[(i) / BITMAP_WORD_BITS] |= \
+                              1UL << ((i) % BITMAP_WORD_BITS) )
+#define BITMAP_CLEAR(bits, i) ( (bits)[(i) / BITMAP_WORD_BITS] &= \
+                                ~(1UL << ((i) % BITMAP_WORD_BITS)) )
+#define BITMAP_FLIP(bits, i) ( (bits)[(i) / BITMAP_WORD_BITS] ^= \
+                               1UL << ((i) % BITMAP_WORD_BITS) )
+
 enum {
     LEFT_BUTTON = 0x0200,
     MIDDLE_BUTTON,
@@ -88,6 +102,8 @@ enum {
 #define REQUIRE_NUMPAD ( 1 << 11 )
 /* Game handles stylus and mouse input differently */
 #define STYLUS_SUPPORT ( 1 << 12 )
+/* solve() depends only on the original state, so can be done in advance */
+#define SOLVE_FROM_ORIG ( 1 << 13 )
 /* end of `flags' word definitions */
 
 #define IGNOREARG(x) ( (x) = (x) )
@@ -102,10 +118,12 @@ typedef struct game_ui game_ui;
 typedef struct game_drawstate game_drawstate;
 typedef struct game game;
 typedef struct blitter blitter;
+typedef struct sprite sprite;
 typedef struct document document;
 typedef struct drawing_api drawing_api;
 typedef struct drawing drawing;
 typedef struct psdata psdata;
+typedef struct binsave_writer binsave_writer;
 
 #define ALIGN_VNORMAL 0x000
 #define ALIGN_VCENTRE 0x100
@@ -286,6 +304,11 @@ blitter *blitter_new(drawing *dr, int w, int h);
 void blitter_free(drawing *dr, blitter *bl);
 void blitter_save(drawing *dr, blitter *bl, int x, int y);
 void blitter_load(drawing *dr, blitter *bl, int x, int y);
+sprite *sprite_new(drawing *dr, int w, int h);
+void sprite_free(drawing *dr, sprite *sp);
+void sprite_begin(drawing *dr, sprite *sp);
+void sprite_end(drawing *dr, sprite *sp);
+void sprite_draw(drawing *dr, sprite *sp, int x, int y, float angle);
 void print_begin_doc(drawing *dr, int pages);
 void print_begin_page(drawing *dr, int number);
 void print_begin_puzzle(drawing *dr, float xm, float xc,
@@ -322,6 +345,10 @@ void midend_size(midend *me, int *x, int *y, bool user_size,
                  double device_pixel_ratio);
 void midend_reset_tilesize(midend *me);
 void midend_new_game(midend *me);
+void midend_generate_game(midend *me, char **seed, char **desc,
+                          char **aux_info);
+const char *midend_supply_game(midend *me, const char *seed,
+                               const char *desc, const char *aux_info);
 void midend_restart_game(midend *me);
 void midend_stop_anim(midend *me);
 enum { PKR_QUIT = 0, PKR_SOME_EFFECT, PKR_NO_EFFECT, PKR_UNUSED };
@@ -330,6 +357,7 @@ key_label *midend_request_keys(midend *me, int *nkeys);
 const char *midend_current_key_label(midend *me, int button);
 void midend_force_redraw(midend *me);
 void midend_redraw(midend *me);
+void midend_defer_redraws(midend *me, bool defer);
 float *midend_colours(midend *me, int *ncolours);
 void midend_freeze_timer(midend *me, float tprop);
 void midend_timer(midend *me, float tplus);
@@ -345,6 +373,9 @@ char *midend_get_random_seed(midend *me);
 bool midend_can_format_as_text_now(midend *me);
 char *midend_text_format(midend *me);
 const char *midend_solve(midend *me);
+void midend_precompute_solution(midend *me);
+bool midend_speculate(midend *me);
+const char *midend_hint(midend *me);
 int midend_status(midend *me);
 bool midend_can_undo(midend *me);
 bool midend_can_redo(midend *me);
@@ -354,9 +385,22 @@ char *midend_rewrite_statusbar(midend *me, const char *text);
 void midend_serialise(midend *me,
                       void (*write)(void *ctx, const void *buf, int len),
                       void *wctx);
+bool midend_serialise_changes(
+    midend *me, bool full, void (*write)(void *ctx, const void *buf, int len),
+    void *wctx);
 const char *midend_deserialise(midend *me,
                                bool (*read)(void *ctx, void *buf, int len),
                                void *rctx);
+/*
+ * To have midend_serialise or midend_serialise_changes write the
+ * compact binary save format instead, pass binsave_write as its write
+ * function, with a binsave_writer wrapping the real one as its
+ * context. midend_deserialise and identify_game accept either format.
+ */
+binsave_writer *binsave_writer_new(
+    void (*write)(void *ctx, const void *buf, int len), void *wctx);
+void binsave_write(void *ctx, const void *buf, int len);
+void binsave_writer_free(binsave_writer *bw);
 const char *midend_load_prefs(
     midend *me, bool (*read)(void *ctx, void *buf, int len), void *rctx);
 void midend_save_prefs(midend *me,
@@ -367,8 +411,35 @@ const char *identify_game(char **name,
                           void *rctx);
 void midend_request_id_changes(midend *me, void (*notify)(void *), void *ctx);
 void midend_request_params_changes(midend *me, void (*notify)(void *), void *ctx);
+void midend_request_generation_progress(
+    midend *me, void (*notify)(void *ctx, float done), void *ctx);
+void midend_request_solve_progress(
+    midend *me, bool (*notify)(void *ctx, float done), void *ctx);
 bool midend_get_cursor_location(midend *me, int *x, int *y, int *w, int *h);
 void midend_get_move_count(midend *me, int *current, int *total);
+bool midend_goto_move(midend *me, int move);
+/*
+ * Tracing of the midend's hot paths (processing a key, and within
+ * that interpret_move, execute_move, changed_state and redraw; an
+ * animation frame of midend_timer; also new_desc, solve and
+ * serialise), compiled in only if MIDEND_TRACING is defined. Once the
+ * front end has supplied a clock in milliseconds, each of those calls
+ * is recorded, and the most recent MIDEND_TRACE_EVENTS of them are
+ * kept until midend_take_trace_events copies them out (oldest first)
+ * and forgets them. Without MIDEND_TRACING, there are never any
+ * events. midend_trace_mark adds a zero-length event of the front
+ * end's own, such as a frame it dropped.
+ */
+#define MIDEND_TRACE_EVENTS 256
+typedef struct midend_trace_event {
+    const char *name;                  /* a string constant */
+    double start, end;
+    int depth;                         /* number of enclosing events */
+} midend_trace_event;
+void midend_set_trace_clock(midend *me, double (*clock)(void *ctx),
+                            void *ctx);
+int midend_take_trace_events(midend *me, midend_trace_event *events, int max);
+void midend_trace_mark(midend *me, const char *name);
 
 /* Printing functions supplied by the mid-end */
 const char *midend_print_puzzle(midend *me, document *doc, bool with_soln);
@@ -381,6 +452,23 @@ void *smalloc(size_t size);
 void *srealloc(void *p, size_t size);
 void sfree(void *p);
 char *dupstr(const char *s);
+/*
+ * Memory statistics, kept by the functions above only in builds with
+ * MEMORY_STATS defined (see the MEMORY_STATS CMake option); otherwise
+ * they're always zero. live is the number of bytes currently
+ * allocated; peak is the most there have been, and allocs the number
+ * of allocations (smalloc, or srealloc of NULL), since the last
+ * memory_stats_reset. So to measure a piece of code, reset the stats
+ * before it and get them after: peak minus the live bytes at the
+ * start is the most it had allocated at once.
+ */
+typedef struct memory_stats {
+    size_t live, peak;
+    unsigned long allocs;
+} memory_stats;
+bool memory_stats_enabled(void);
+void memory_stats_get(memory_stats *stats);
+void memory_stats_reset(void);
 #define snew(type) \
     ( (type *) smalloc (sizeof (type)) )
 #define snewn(number, type) \
@@ -388,6 +476,32 @@ char *dupstr(const char *s);
 #define sresize(array, number, type) \
     ( (type *) srealloc ((array), (number) * sizeof (type)) )
 
+/*
+ * Arenas: bump-pointer allocation for scratch space, such as a
+ * solver's working arrays, which can all be discarded together.
+ * Nothing allocated from an arena is freed individually; instead,
+ * arena_save records how much has been allocated so far, and
+ * arena_restore discards everything allocated since (in constant
+ * time), while arena_reset discards everything. The memory itself is
+ * kept for reuse until arena_free, so a generator that reuses one
+ * arena for every attempt stops calling malloc after the first.
+ */
+typedef struct arena arena;
+typedef struct arena_mark {
+    struct arena_block *block;
+    size_t used;
+} arena_mark;
+arena *arena_new(void);
+void arena_free(arena *a);
+void *arena_alloc(arena *a, size_t size);
+arena_mark arena_save(const arena *a);
+void arena_restore(arena *a, arena_mark mark);
+void arena_reset(arena *a);
+#define anew(a, type) \
+    ( (type *) arena_alloc ((a), sizeof (type)) )
+#define anewn(a, number, type) \
+    ( (type *) arena_alloc ((a), (number) * sizeof (type)) )
+
 /*
  * misc.c
  */
@@ -399,6 +513,65 @@ char *make_prefs_path(const char *dir, const char *sep,
                       const game *game, const char *suffix);
 int n_times_root_k(int n, int k);
 
+/* Progress reports from new_desc: done is between 0 and 1. No-ops
+ * unless the midend has installed a hook, on behalf of a front end
+ * which called midend_request_generation_progress. */
+void generation_progress(float done);
+float generation_retry_progress(int attempt, float within);
+void set_generation_progress_hook(void (*fn)(void *ctx, float done),
+                                  void *ctx);
+/* Progress reports from slow (backtracking) solvers, at each guess:
+ * done is between 0 and 1, typically the fraction of the grid filled
+ * in at that point. Returns true if the solver should give up, because
+ * the front end has run out of patience; until then, and unless the
+ * midend has installed a hook (on behalf of a front end which called
+ * midend_request_solve_progress), returns false. */
+bool solver_progress(float done);
+void set_solver_progress_hook(bool (*fn)(void *ctx, float done), void *ctx);
+/* Phase markers from new_desc (e.g. "grid", "clues", "solve"): no-op
+ * unless a benchmark has installed a hook. */
+void generation_phase(const char *phase);
+void set_generation_phase_hook(void (*fn)(void *ctx, const char *phase),
+                               void *ctx);
+
+/* Parallel work: parallel_run calls fn(ctx, i) for each 0 <= i < n,
+ * and returns when they have all finished. If a front end has
+ * installed a hook, the calls may be made on up to
+ * parallel_nthreads() threads at once, in any order, so each must
+ * only touch state of its own. Without one they run in order on
+ * the calling thread. */
+typedef void (*parallel_task_fn)(void *ctx, int i);
+typedef void (*parallel_hook_fn)(void *hookctx, parallel_task_fn fn,
+                                 void *ctx, int n);
+void parallel_run(parallel_task_fn fn, void *ctx, int n);
+int parallel_nthreads(void);
+void set_parallel_hook(parallel_hook_fn fn, void *hookctx, int nthreads);
+
+/* A lock around the few caches which games keep between calls, for
+ * programs which generate or solve on several threads at once: games
+ * must only look in or add to such a cache between cache_lock() and
+ * cache_unlock(). No-ops unless a lock has been installed (e.g. by
+ * threadpool_lock_caches). */
+void cache_lock(void);
+void cache_unlock(void);
+void set_cache_lock_hook(void (*fn)(void *ctx, bool lock), void *ctx);
+
+/* Clue pruning, the loop most generators finish with: go through
+ * cands in order, removing each clue if the puzzle stays good without
+ * it. check(worker, c) says whether it would, given the clues already
+ * removed from that worker's copy of the puzzle, and must leave the
+ * copy unchanged; commit(worker, c) removes c for good. Each worker
+ * must be a separate copy, with its own solver scratch space, because
+ * the workers are checked in parallel_run(). The result is the same
+ * regardless. Generators should make prune_nworkers() of them. */
+struct prune_ops {
+    bool (*check)(void *worker, int cand);
+    void (*commit)(void *worker, int cand);
+};
+int prune_nworkers(void);
+void prune_clues(const struct prune_ops *ops, void *const *workers,
+                 int nworkers, const int *cands, int ncands);
+
 /* allocates output each time. len is always in bytes of binary data.
  * May assert (or just go wrong) if lengths are unchecked. */
 char *bin2hex(const unsigned char *in, int inlen);
@@ -462,6 +635,19 @@ void swap_regions(void *av, void *bv, size_t size);
 /* comparator for sorting ints with qsort() */
 int compare_integers(const void *av, const void *bv);
 
+/* Breadth-first search for the first move of a shortest sequence of
+ * moves taking the len-byte state start to one which goal() accepts.
+ * Every state has the same nmoves possible moves (at most 255), and
+ * apply() makes move number m to a state in place. Returns the number
+ * of the first move, or -1 if start is already a goal or no goal turns
+ * up among the first maxstates distinct states. */
+typedef void (*shortest_apply_fn_t)(void *ctx, int move,
+                                    unsigned char *state);
+typedef bool (*shortest_goal_fn_t)(void *ctx, const unsigned char *state);
+int shortest_first_move(const unsigned char *start, int len, int nmoves,
+                        shortest_apply_fn_t apply, shortest_goal_fn_t goal,
+                        void *ctx, int maxstates);
+
 /*
  * dsf.c
  */
@@ -481,6 +667,18 @@ int dsf_size(DSF *dsf, int n);
 /* Merge two elements and their classes. Not legal on a flip dsf. */
 void dsf_merge(DSF *dsf, int n1, int n2);
 
+/* Bulk versions of the above, for sweeping over a whole dsf at once.
+ * None is legal on a flip dsf. dsf_merge_pairs merges pairs[2*i] with
+ * pairs[2*i+1] for each i < npairs, in order. dsf_canonify_all and
+ * dsf_size_all fill in roots[n] or sizes[n] for every element n.
+ * dsf_label numbers the classes from 0 in order of their smallest
+ * elements, fills in labels[n] with the number of n's class, and
+ * returns the number of classes. */
+void dsf_merge_pairs(DSF *dsf, const int *pairs, int npairs);
+void dsf_canonify_all(DSF *dsf, int *roots);
+void dsf_size_all(DSF *dsf, int *sizes);
+int dsf_label(DSF *dsf, int *labels);
+
 /* Special dsf that tracks the minimal element of every equivalence
  * class, and a function to query it. */
 DSF *dsf_new_min(int size);
@@ -535,12 +733,199 @@ void tdq_add(tdq *tdq, int k);
 int tdq_remove(tdq *tdq);        /* returns -1 if nothing available */
 void tdq_fill(tdq *tdq);         /* add everything to the tdq at once */
 
+/*
+ * unitcheck.c
+ */
+
+/*
+ * Incremental error checking, for games whose rules are a set of
+ * separate constraints ('units': rows, columns, regions, clues...)
+ * that each depend on only a few cells. A unitcheck, kept in the
+ * game_state, remembers whether each unit was last found OK, not yet
+ * complete, or in error. execute_move calls unitcheck_touch for each
+ * unit its move could have affected, and then unitcheck_run calls
+ * the game's check function on just those units, so checking a move
+ * costs time in proportion to what it touched rather than to the
+ * size of the board. unitcheck_touch_all falls back to checking
+ * everything, for moves (such as Solve) that change too much to be
+ * worth keeping track of; a new unitcheck starts that way.
+ *
+ * unitcheck_count takes constant time, so a game is complete when
+ * unitcheck_count(uc, UNIT_OK) equals the number of units.
+ */
+enum { UNIT_OK, UNIT_INCOMPLETE, UNIT_ERROR, UNIT_NSTATUS };
+typedef struct unitcheck unitcheck;
+typedef int (*unitcheck_fn_t)(void *ctx, int unit); /* returns UNIT_* */
+unitcheck *unitcheck_new(int n);
+unitcheck *unitcheck_dup(const unitcheck *uc);
+void unitcheck_free(unitcheck *uc);
+void unitcheck_touch(unitcheck *uc, int unit);
+void unitcheck_touch_all(unitcheck *uc);
+void unitcheck_run(unitcheck *uc, unitcheck_fn_t check, void *ctx);
+int unitcheck_status(const unitcheck *uc, int unit);
+int unitcheck_count(const unitcheck *uc, int status);
+
+/*
+ * propagate.c
+ */
+
+/*
+ * A worklist engine for constraint-propagation solvers: the common
+ * 'apply every rule until none of them does anything' loop, but only
+ * re-applying each rule where something has changed, using a
+ * de-duplicating to-do queue (like a tdq) for each rule.
+ *
+ * Each rule looks at one 'item' at a time and returns how many
+ * deductions it made there, or -1 for a contradiction. Items come in
+ * types (squares, rows and columns, regions...), each numbered from
+ * 0, and several rules can share a type. Solvers say which items
+ * depend on each cell with propagate_watch, and report every cell
+ * they change with propagate_changed, which queues each item watching
+ * it for every rule on that type of item.
+ *
+ * propagate_run(p, n, ctx) applies the first n rules (so a solver can
+ * register its rules in increasing difficulty, and leave out the hard
+ * ones) until none has anything queued, always preferring the
+ * earliest rule with work to do. It returns the total number of
+ * deductions, or -1. Every item of every rule starts off queued.
+ *
+ * propagate_reset queues everything again, so that a solver can use
+ * the same propagator (and watches) for another attempt on the same
+ * grid, rather than setting up a new one.
+ *
+ * All the types, rules and watches must be set up before the first
+ * call to propagate_changed or propagate_run. Each rule counts its
+ * calls, the calls which made deductions, and the deductions (over
+ * all runs since it was made), for profiling.
+ */
+typedef struct propagator propagator;
+typedef int (*propagate_fn_t)(void *ctx, int rule, int item);
+struct propagate_stats {
+    const char *name;
+    unsigned long calls, fired, deductions;
+};
+propagator *propagate_new(int ncells);
+void propagate_free(propagator *p);
+int propagate_add_type(propagator *p, int nitems);  /* returns the type */
+int propagate_add_rule(propagator *p, const char *name, int type,
+                       propagate_fn_t fn);  /* returns the rule number */
+void propagate_watch(propagator *p, int type, int cell, int item);
+void propagate_changed(propagator *p, int cell);
+void propagate_touch(propagator *p, int rule, int item);
+void propagate_reset(propagator *p);
+int propagate_run(propagator *p, int nrules, void *ctx);
+const struct propagate_stats *propagate_get_stats(const propagator *p,
+                                                  int rule);
+
+/*
+ * hashset.c
+ */
+
+/*
+ * An unordered set of non-NULL pointers, looked up by the hash and
+ * equality functions it was created with. It's for the cases where
+ * a tree234 would only ever be used to find things and to weed out
+ * duplicates: lookups take constant time rather than logarithmic,
+ * and don't wander around the heap.
+ *
+ * hashset_add and hashset_find behave like add234 and find234:
+ * hashset_add returns either the element it was given, or an equal
+ * one already in the set (in which case the set is unchanged).
+ * hashset_del returns the element it removed, or NULL. None of them
+ * frees the elements themselves; to do that, iterate over the set
+ * with hashset_next, starting from *pos == 0, until it returns NULL.
+ * (The set mustn't change during the iteration, and the order is
+ * arbitrary.)
+ *
+ * hash_ints is a convenient hash function for elements identified
+ * by a few ints.
+ */
+typedef struct hashset hashset;
+typedef unsigned long (*hashset_hashfn_t)(const void *elem);
+typedef bool (*hashset_eqfn_t)(const void *a, const void *b);
+hashset *hashset_new(hashset_hashfn_t hash, hashset_eqfn_t eq);
+void hashset_free(hashset *hs);
+size_t hashset_count(const hashset *hs);
+void *hashset_add(hashset *hs, void *elem);
+void *hashset_find(const hashset *hs, const void *elem);
+void *hashset_del(hashset *hs, const void *elem);
+void *hashset_next(const hashset *hs, size_t *pos);
+unsigned long hash_ints(const int *ints, size_t n);
+
+/*
+ * cowarray.c
+ */
+
+/*
+ * Chunked copy-on-write arrays of n elements of eltsize bytes each,
+ * for big per-cell arrays in a game_state. cow_dup shares all the
+ * storage with the original, and costs time proportional to n/64;
+ * writing an element (through the pointer returned by cow_put) first
+ * copies the 64-element chunk containing it, if that is still shared.
+ * So the undo chain stores only the chunks each move changed.
+ *
+ * cow_get pointers are invalidated by writes to the same array.
+ * cow_read_all and cow_write_all copy the whole array to or from a
+ * plain buffer, for code (such as solvers) that needs one; writing
+ * back only unshares the chunks that differ.
+ *
+ * The structures are visible here only so that cow_get and cow_put,
+ * which solvers call in their inner loops, can be inlined.
+ */
+#define COW_CHUNK_SHIFT 6
+#define COW_CHUNK (1 << COW_CHUNK_SHIFT)
+/* Each chunk's data is immediately preceded by its reference count. */
+union cow_chunk_header {
+    int refcount;
+    double align_d;
+    void *align_p;
+};
+#define COW_CHUNK_REFCOUNT(data) (((union cow_chunk_header *)(data))[-1].refcount)
+typedef struct cow_array {
+    int n, eltsize, nchunks;
+    unsigned char **chunks;
+} cow_array;
+cow_array *cow_new(int n, int eltsize);    /* zero-filled */
+cow_array *cow_dup(const cow_array *a);
+void cow_free(cow_array *a);
+int cow_len(const cow_array *a);
+unsigned char *cow_unshare(cow_array *a, int c);
+void cow_read_all(const cow_array *a, void *out);
+void cow_write_all(cow_array *a, const void *in);
+/* eltsize must be the array's; passing it lets the compiler fold it */
+static inline const void *cow_get_sized(const cow_array *a, int i,
+                                        int eltsize)
+{
+    return a->chunks[i >> COW_CHUNK_SHIFT] + (i & (COW_CHUNK - 1)) * eltsize;
+}
+static inline void *cow_put_sized(cow_array *a, int i, int eltsize)
+{
+    unsigned char *chunk = a->chunks[i >> COW_CHUNK_SHIFT];
+    if (COW_CHUNK_REFCOUNT(chunk) > 1)
+        chunk = cow_unshare(a, i >> COW_CHUNK_SHIFT);
+    return chunk + (i & (COW_CHUNK - 1)) * eltsize;
+}
+#define cow_get(a, i) cow_get_sized(a, i, (a)->eltsize)
+#define cow_put(a, i) cow_put_sized(a, i, (a)->eltsize)
+#define COW_GET(type, a, i) \
+    (*(const type *)cow_get_sized(a, i, (int)sizeof(type)))
+#define COW_PUT(type, a, i) \
+    (*(type *)cow_put_sized(a, i, (int)sizeof(type)))
+
 /*
  * laydomino.c
  */
 int *domino_layout(int w, int h, random_state *rs);
 void domino_layout_prealloc(int w, int h, random_state *rs,
                             int *grid, int *grid2, int *list);
+/* For generators which retry with a new layout of the same size. The
+ * layouts returned live in the ctx, until the next call. */
+typedef struct domino_layout_ctx domino_layout_ctx;
+domino_layout_ctx *domino_layout_new_ctx(int w, int h);
+void domino_layout_free_ctx(domino_layout_ctx *ctx);
+const int *domino_layout_next(domino_layout_ctx *ctx, random_state *rs);
+const int *domino_layout_rearrange(domino_layout_ctx *ctx, random_state *rs,
+                                   int sweeps);
 /*
  * version.c
  */
@@ -575,6 +960,8 @@ void SHA_Init(SHA_State *s);
 void SHA_Bytes(SHA_State *s, const void *p, int len);
 void SHA_Final(SHA_State *s, unsigned char *output);
 void SHA_Simple(const void *p, int len, unsigned char *output);
+void SHA_Final_Counters(const SHA_State *s, int first, int n,
+                        unsigned char *output);
 
 /*
  * printing.c
@@ -588,6 +975,9 @@ void document_begin(const document *doc, drawing *dr);
 void document_end(const document *doc, drawing *dr);
 void document_print_page(const document *doc, drawing *dr, int page_nr);
 void document_print(const document *doc, drawing *dr);
+void document_transfer(document *doc, document *src);
+void document_stream_begin(document *doc, drawing *dr);
+void document_stream_end(document *doc);
 
 /*
  * ps.c
@@ -596,6 +986,36 @@ psdata *ps_init(FILE *outfile, bool colour);
 void ps_free(psdata *ps);
 drawing *ps_drawing_api(psdata *ps);
 
+/*
+ * batchgen.c: generate n game IDs for each of npstrs parameter
+ * strings, spread over a pool of threads. Output is the same as the
+ * serial --generate loop's, in the same order. Returns nonzero if any
+ * generation failed (after reporting it on stderr).
+ *
+ * If 'doc' is non-NULL, the puzzles are added to it in order instead
+ * of their IDs being written to 'out'. That's most useful if 'doc'
+ * is in streaming mode, so that each page is printed while later
+ * puzzles are still being generated.
+ */
+struct batchgen_options {
+    int nthreads;
+    bool time_generation, test_solve;
+    document *doc;
+    bool with_soln;
+};
+int batch_generate(const game *thegame, const char *const *pstrs, int npstrs,
+                   int n, const struct batchgen_options *opts, FILE *out);
+
+/*
+ * threadpool.c: start a pool of threads and install it as the
+ * parallel_run hook, on platforms that have threads. Does nothing if
+ * nthreads <= 1.
+ */
+void threadpool_start(int nthreads);
+/* Install a mutex as the cache lock (see cache_lock). threadpool_start
+ * does so itself, for more than one thread. */
+void threadpool_lock_caches(void);
+
 /*
  * combi.c: provides a structure and functions for iterating over
  * combinations (i.e. choosing r things out of n).
@@ -610,6 +1030,36 @@ void reset_combi(combi_ctx *combi);
 combi_ctx *next_combi(combi_ctx *combi); /* returns NULL for end */
 void free_combi(combi_ctx *combi);
 
+/*
+ * For n up to COMBI_MASK_BITS, the same combinations can be had as
+ * bitmasks instead (bit i set if element i is chosen), with no
+ * allocation, by Gosper's hack. r must be at least 1. The masks come
+ * in increasing numeric order, which is not the order of next_combi.
+ *
+ *     combi_mask set;
+ *     for (set = first_combi_mask(r); set; set = next_combi_mask(set, n))
+ *         ...
+ *
+ * foreach_combi_mask does the same loop, calling fn on each mask
+ * until it returns false; it returns false if fn ever did.
+ */
+typedef unsigned long long combi_mask;
+#define COMBI_MASK_BITS 64
+static inline combi_mask first_combi_mask(int r)
+{
+    return r >= COMBI_MASK_BITS ? ~(combi_mask)0 : ((combi_mask)1 << r) - 1;
+}
+static inline combi_mask next_combi_mask(combi_mask set, int n)
+{
+    combi_mask lowest = set & -set, ripple = set + lowest, next;
+    if (!ripple)                       /* overflowed: that was the last */
+        return 0;
+    next = ripple | (((ripple ^ set) >> 2) / lowest);
+    return n < COMBI_MASK_BITS && (next >> n) ? 0 : next;
+}
+bool foreach_combi_mask(int r, int n, bool (*fn)(void *ctx, combi_mask set),
+                        void *ctx);
+
 /*
  * divvy.c
  */
@@ -641,6 +1091,18 @@ typedef int (*neighbour_fn_t)(int vertex, void *ctx);
  */
 bool findloop_run(struct findloopstate *state, int nvertices,
                   neighbour_fn_t neighbour, void *ctx);
+/*
+ * Update the output of a previous findloop_run (or findloop_rerun) on
+ * the same state after some edges of the graph have been added or
+ * removed, by searching again only the components containing the
+ * vertices listed in 'changed', which must include both endpoints of
+ * every changed edge. The result, and the return value, are exactly
+ * as findloop_run would give on the new graph; the saving is that
+ * components of the graph that didn't change aren't searched.
+ */
+bool findloop_rerun(struct findloopstate *state, int nvertices,
+                    const int *changed, int nchanged,
+                    neighbour_fn_t neighbour, void *ctx);
 /*
  * Query whether an edge is part of a loop, in the output of
  * find_loops.
@@ -679,6 +1141,16 @@ void arraysort_fn(void *array, size_t nmemb, size_t size,
 #define arraysort(array, nmemb, cmp, ctx) \
     arraysort_fn(array, nmemb, sizeof(*(array)), cmp, ctx)
 
+/*
+ * Faster special cases for integers, which need no comparator at
+ * all. sort_integers() sorts an array of ints into increasing order.
+ * sort_by_int_key() sorts an array of indices into increasing order
+ * of keys[index], keeping indices with equal keys in their original
+ * relative order.
+ */
+void sort_integers(int *array, size_t nmemb);
+void sort_by_int_key(int *array, size_t nmemb, const int *keys);
+
 /*
  * Data structure containing the function calls and data specific
  * to a particular game. This is enclosed in a data structure so
@@ -708,9 +1180,16 @@ struct game {
     void (*set_public_desc)(game_state *state, const char *pubdesc);
     game_state *(*dup_game)(const game_state *state);
     void (*free_game)(game_state *state);
+    char *(*encode_state)(const game_state *state);
+    game_state *(*decode_state)(const game_state *orig,
+                                const char *encoding);
     bool can_solve;
     char *(*solve)(const game_state *orig, const game_state *curr,
                    const char *aux, const char **error);
+    char *(*solve_step)(const game_state *orig, const game_state *curr,
+                        const char *aux, const char **error);
+    char *(*grade)(const game_state *state, const char **error);
+    bool (*speculate)(const game_state *state);
     bool can_format_as_text_ever;
     bool (*can_format_as_text_now)(const game_params *params);
     char *(*text_format)(const game_state *state);
@@ -783,11 +1262,14 @@ struct drawing_api {
      * version number changes. Naturally, this should be done
      * sparingly.
      *
-     * If a function is ever added to this API, please move this field
-     * to the _end_ of the structure, so that changes thereafter will
-     * shift the position of the version and lead to a compilation
-     * error if old implementations are not updated. Then remove this
-     * comment.
+     * Optional functions may be added at the end of the structure
+     * without a version change: an implementation which predates
+     * them leaves them zero-initialised, and the central code treats
+     * NULL as 'not supported'. If a function is ever added which
+     * every front end must implement, please move this field to the
+     * _end_ of the structure, so that changes thereafter will shift
+     * the position of the version and lead to a compilation error if
+     * old implementations are not updated.
      *
      * The latest version number is 1.
      *
@@ -833,6 +1315,12 @@ struct drawing_api {
     void (*draw_thick_line)(drawing *dr, float thickness,
 			    float x1, float y1, float x2, float y2,
 			    int colour);
+    /* Optional; may all be NULL. See sprite_new() in drawing.c. */
+    sprite *(*sprite_new)(drawing *dr, int w, int h);
+    void (*sprite_free)(drawing *dr, sprite *sp);
+    void (*sprite_begin)(drawing *dr, sprite *sp);
+    void (*sprite_end)(drawing *dr, sprite *sp);
+    void (*sprite_draw)(drawing *dr, sprite *sp, int x, int y, float angle);
 };
 
 /*
@@ -372,16 +372,26 @@ static move *do_solve(game_state *state,
                       move *move_buffer,
                       int difficulty)
 {
-    struct move *buf = move_buffer, *oldbuf;
+    struct move *buf = move_buffer, *oldbuf, *connected = NULL, *it;
     int i;
 
     do {
         oldbuf = buf;
         for (i = 0; i < lenof(reasonings) && i <= difficulty; ++i) {
-            /* only recurse if all else fails */
-            if (i == DIFF_RECURSION && buf > oldbuf) continue;
+            /* only look at the whole grid (or recurse) if the local
+             * reasonings have stalled */
+            if (i >= DIFF_CONNECTEDNESS && buf > oldbuf) continue;
+            if (i == DIFF_CONNECTEDNESS && connected != NULL) {
+                /* The cut vertices of the non-black squares can only
+                 * change when a square turns black, and all of them
+                 * were made white last time round. */
+                for (it = connected; it < buf; ++it)
+                    if (it->colour == M_BLACK) break;
+                if (it == buf) continue;
+            }
             buf = (*reasonings[i])(state, nclues, clues, buf);
             if (buf == NULL) return NULL;
+            if (i == DIFF_CONNECTEDNESS) connected = buf;
         }
     } while (buf > oldbuf);
 
@@ -610,17 +620,19 @@ static move *solver_reasoning_recursion(game_state *state,
     int const w = state->params.w, n = w * state->params.h;
     int cell, colour;
 
+    /* one scratch copy of the grid does for every hypothesis */
+    game_state *const newstate = dup_game(state);
+
     for (cell = 0; cell < n; ++cell) {
         int const r = cell / w, c = cell % w;
         int i;
-        game_state *newstate;
         move *recursive_result;
 
         if (state->grid[cell] != EMPTY) continue;
 
         /* FIXME: add enum alias for smallest and largest (or N) */
         for (colour = M_BLACK; colour <= M_WHITE; ++colour) {
-            newstate = dup_game(state);
+            memcpy(newstate->grid, state->grid, n * sizeof (puzzle_size));
             newstate->grid[cell] = colour == M_BLACK ? BLACK : WHITE;
             recursive_result = do_solve(newstate, nclues, clues, buf,
                                         DIFF_RECURSION);
@@ -630,10 +642,13 @@ static move *solver_reasoning_recursion(game_state *state,
                 return buf;
             }
             for (i = 0; i < n && newstate->grid[i] != EMPTY; ++i);
-            free_game(newstate);
-            if (i == n) return buf;
+            if (i == n) {
+                free_game(newstate);
+                return buf;
+            }
         }
     }
+    free_game(newstate);
     return buf;
 }
 
@@ -715,11 +730,14 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     for (i = 0; i < n; ++i) shuffle_1toN[i] = i;
 
     while (true) {
+        generation_phase("grid");
         shuffle(shuffle_1toN, n, sizeof (int), rs);
         newdesc_choose_black_squares(&state, shuffle_1toN);
 
+        generation_phase("clues");
         newdesc_compute_clues(&state);
 
+        generation_phase("solve");
         shuffle(shuffle_1toN, n, sizeof (int), rs);
         clues_removed = newdesc_strip_clues(&state, shuffle_1toN);
 
@@ -1871,7 +1889,11 @@ struct game const thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     get_prefs, set_prefs,
     new_ui,
@@ -268,7 +268,7 @@ struct numberdata {
 
 static void remove_rect_placement(int w, int h,
                                   struct rectlist *rectpositions,
-                                  int *overlaps,
+                                  int *overlaps, int *ncands, int *candsum,
                                   int rectnum, int placement)
 {
     int x, y, xx, yy;
@@ -292,8 +292,11 @@ static void remove_rect_placement(int w, int h,
 
             assert(overlaps[(rectnum * h + y) * w + x] != 0);
 
-            if (overlaps[(rectnum * h + y) * w + x] > 0)
-                overlaps[(rectnum * h + y) * w + x]--;
+            if (overlaps[(rectnum * h + y) * w + x] > 0 &&
+                --overlaps[(rectnum * h + y) * w + x] == 0) {
+                ncands[y * w + x]--;
+                candsum[y * w + x] -= rectnum;
+            }
         }
     }
 
@@ -344,7 +347,8 @@ static int rect_solver(int w, int h, int nrects, struct numberdata *numbers,
 		       random_state *rs)
 {
     struct rectlist *rectpositions;
-    int *overlaps, *rectbyplace, *workspace;
+    int *overlaps, *rectbyplace, *workspace, *touched;
+    int *ncands, *candsum;
     int i, ret;
 
     /*
@@ -468,6 +472,27 @@ static int rect_solver(int w, int h, int nrects, struct numberdata *numbers,
         }
     }
 
+    /*
+     * And for each square, the number of rectangles with a positive
+     * entry in overlaps there, and the sum of their indices: so when
+     * there's only one, that's which it is. These are only kept up
+     * to date for squares not yet known, which is all that the
+     * square-focused deduction looks at.
+     */
+    ncands = snewn(w * h, int);
+    candsum = snewn(w * h, int);
+    for (i = 0; i < w*h; i++)
+        ncands[i] = candsum[i] = 0;
+    for (i = 0; i < nrects; i++) {
+        int j;
+
+        for (j = 0; j < w*h; j++)
+            if (overlaps[i * w * h + j] > 0) {
+                ncands[j]++;
+                candsum[j] += i;
+            }
+    }
+
     /*
      * Also we want an array covering the grid once, to make it
      * easy to figure out which squares are candidate number
@@ -497,7 +522,16 @@ static int rect_solver(int w, int h, int nrects, struct numberdata *numbers,
         }
     }
 
+    /*
+     * workspace[k] counts the candidate number placements for
+     * rectangle k inside a given rectangle placement; 'touched' lists
+     * the k it's counted, so that only those need looking at or
+     * clearing.
+     */
     workspace = snewn(nrects, int);
+    touched = snewn(nrects, int);
+    for (i = 0; i < nrects; i++)
+        workspace[i] = 0;
 
     /*
      * Now run the actual deduction loop.
@@ -615,12 +649,9 @@ static int rect_solver(int w, int h, int nrects, struct numberdata *numbers,
             int j;
 
             for (j = 0; j < rectpositions[i].n; j++) {
-                int xx, yy, k;
+                int xx, yy, k, t, ntouched = 0;
                 bool del = false;
 
-                for (k = 0; k < nrects; k++)
-                    workspace[k] = 0;
-
                 for (yy = 0; yy < rectpositions[i].rects[j].h; yy++) {
                     int y = yy + rectpositions[i].rects[j].y;
                     for (xx = 0; xx < rectpositions[i].rects[j].w; xx++) {
@@ -651,7 +682,9 @@ static int rect_solver(int w, int h, int nrects, struct numberdata *numbers,
                              * candidate number placements for some
                              * rectangle. Count it.
                              */
-                            workspace[rectbyplace[y * w + x]]++;
+                            k = rectbyplace[y * w + x];
+                            if (workspace[k]++ == 0)
+                                touched[ntouched++] = k;
                         }
                     }
                 }
@@ -663,8 +696,9 @@ static int rect_solver(int w, int h, int nrects, struct numberdata *numbers,
                      * candidate number placements for any
                      * rectangle. If so, we can rule it out.
                      */
-                    for (k = 0; k < nrects; k++)
-                        if (k != i && workspace[k] == numbers[k].npoints) {
+                    for (t = 0; t < ntouched; t++)
+                        if ((k = touched[t]) != i &&
+                            workspace[k] == numbers[k].npoints) {
 #ifdef SOLVER_DIAGNOSTICS
                             printf("rect %d placement at %d,%d w=%d h=%d "
                                    "contains all number points for rect %d\n",
@@ -700,8 +734,12 @@ static int rect_solver(int w, int h, int nrects, struct numberdata *numbers,
                     }
                 }
 
+                for (t = 0; t < ntouched; t++)
+                    workspace[touched[t]] = 0;
+
                 if (del) {
-                    remove_rect_placement(w, h, rectpositions, overlaps, i, j);
+                    remove_rect_placement(w, h, rectpositions, overlaps,
+                                          ncands, candsum, i, j);
 
                     j--;               /* don't skip over next placement */
 
@@ -723,11 +761,8 @@ static int rect_solver(int w, int h, int nrects, struct numberdata *numbers,
                 if (overlaps[y * w + x] < 0)
                     continue;          /* known already */
 
-                n = 0;
-                index = -1;
-                for (i = 0; i < nrects; i++)
-                    if (overlaps[(i * h + y) * w + x] > 0)
-                        n++, index = i;
+                n = ncands[y * w + x];
+                index = candsum[y * w + x];
 
                 if (n == 1) {
                     int j;
@@ -747,7 +782,7 @@ static int rect_solver(int w, int h, int nrects, struct numberdata *numbers,
                             y >= r->y && y < r->y + r->h)
                             continue;  /* this one is OK */
                         remove_rect_placement(w, h, rectpositions, overlaps,
-                                              index, j);
+                                              ncands, candsum, index, j);
                         j--;           /* don't skip over next placement */
                         done_something = true;
                     }
@@ -908,6 +943,9 @@ static int rect_solver(int w, int h, int nrects, struct numberdata *numbers,
      * Free up all allocated storage.
      */
     sfree(workspace);
+    sfree(touched);
+    sfree(ncands);
+    sfree(candsum);
     sfree(rectbyplace);
     sfree(overlaps);
     for (i = 0; i < nrects; i++)
@@ -2999,7 +3037,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
@@ -3023,7 +3065,7 @@ const struct game thegame = {
     true, false, game_print_size, game_print,
     true,			       /* wants_statusbar */
     false, NULL,                       /* timing_state */
-    0,				       /* flags */
+    SOLVE_FROM_ORIG,				       /* flags */
 };
 
 /* vim: set shiftwidth=4 tabstop=8: */
@@ -327,7 +327,8 @@ static void gen_grid(int w, int h, int nc, int *grid, random_state *rs)
 {
     int wh = w*h, tc = nc+1;
     int i, j, k, c, x, y, pos, n;
-    int *list, *grid2;
+    int *list, *grid2, *height, *height2;
+    int dlo, dhi;
     bool ok;
     int failures = 0;
 
@@ -345,6 +346,19 @@ static void gen_grid(int w, int h, int nc, int *grid, random_state *rs)
     list = snewn(wh + w, int);
     grid2 = snewn(wh, int);
 
+    /*
+     * Each attempted insertion changes only a few columns of the
+     * grid: the one it starts in, the one it extends into, and (if
+     * it inserts a new column) all those to the right. So rather
+     * than copying all of `grid' into `grid2' for each attempt and
+     * checking the whole of it afterwards, we keep `grid2' equal to
+     * `grid' outside columns dlo to dhi, and only copy back and
+     * check those. height[] and height2[] give the number of
+     * squares in each column of `grid' and `grid2' respectively.
+     */
+    height = snewn(w, int);
+    height2 = snewn(w, int);
+
     do {
         /*
          * Start with two or three squares - depending on parity of w*h
@@ -362,6 +376,13 @@ static void gen_grid(int w, int h, int nc, int *grid, random_state *rs)
 	    for (i = 0; i < j; i++)
 		grid[(h-1-i)*w] = c;
 	}
+        memcpy(grid2, grid, wh * sizeof(int));
+        for (i = 0; i < w; i++) {
+            for (j = h; j > 0 && grid[(j-1)*w+i] != 0; j--);
+            height[i] = h - j;
+        }
+        dlo = 0;
+        dhi = -1;
 
         /*
          * Now repeatedly insert a two-square blob in the grid, of
@@ -376,14 +397,14 @@ static void gen_grid(int w, int h, int nc, int *grid, random_state *rs)
              * encoded as h*w+x.
              */
 
-            if (grid[wh - 1] == 0) {
+            if (height[w-1] == 0) {
                 /*
                  * The final column is empty, so we can insert new
                  * columns.
                  */
                 for (i = 0; i < w; i++) {
                     list[n++] = wh + i;
-                    if (grid[(h-1)*w + i] == 0)
+                    if (height[i] == 0)
                         break;
                 }
             }
@@ -392,17 +413,14 @@ static void gen_grid(int w, int h, int nc, int *grid, random_state *rs)
              * Now look for places to insert within columns.
              */
             for (i = 0; i < w; i++) {
-                if (grid[(h-1)*w+i] == 0)
+                if (height[i] == 0)
                     break;		       /* no more columns */
 
-                if (grid[i] != 0)
+                if (height[i] == h)
                     continue;	       /* this column is full */
 
-                for (j = h; j-- > 0 ;) {
+                for (j = h; j-- > h-1 - height[i] ;)
                     list[n++] = j*w+i;
-                    if (grid[j*w+i] == 0)
-                        break;	       /* this column is exhausted */
-                }
             }
 
             if (n == 0)
@@ -439,7 +457,15 @@ static void gen_grid(int w, int h, int nc, int *grid, random_state *rs)
                 x = pos % w;
                 y = pos / w;
 
-                memcpy(grid2, grid, wh * sizeof(int));
+                /*
+                 * Undo whatever the last failed attempt did, and mark
+                 * the columns this one might change.
+                 */
+                for (i = dlo; i <= dhi; i++)
+                    for (j = 0; j < h; j++)
+                        grid2[j*w+i] = grid[j*w+i];
+                dlo = max(x-1, 0);
+                dhi = (y == h ? w-1 : min(x+1, w-1));
 
                 if (y == h) {
                     /*
@@ -626,15 +652,24 @@ static void gen_grid(int w, int h, int nc, int *grid, random_state *rs)
                  */
                 {
                     int nerrs = 0, nfix = 0;
+
+                    for (i = 0; i < w; i++) {
+                        if (i < dlo || i > dhi) {
+                            height2[i] = height[i];
+                        } else {
+                            for (j = h; j > 0 && grid2[(j-1)*w+i] != 0; j--);
+                            height2[i] = h - j;
+                        }
+                    }
+
                     k = 0;             /* current subarea size */
                     for (i = 0; i < w; i++) {
-                        if (grid2[(h-1)*w+i] == 0) {
+                        if (height2[i] == 0) {
                             if (h % 2)
                                 nfix++;
                             continue;
                         }
-                        for (j = 0; j < h && grid2[j*w+i] == 0; j++);
-                        assert(j < h);
+                        j = h - height2[i];
                         if (j == 0) {
                             /*
                              * End of previous subarea.
@@ -671,6 +706,10 @@ static void gen_grid(int w, int h, int nc, int *grid, random_state *rs)
                  * the tc squares in colour c by breadth-first
                  * search, which conveniently permits us to test
                  * that they're all connected.
+                 *
+                 * Columns outside dlo to dhi are the same in both
+                 * grids, so we only check from dlo onwards, and we
+                 * can stop after dhi.
                  */
                 {
                     int x1, x2, y1, y2;
@@ -702,7 +741,9 @@ static void gen_grid(int w, int h, int nc, int *grid, random_state *rs)
                     }
 #endif
 
-                    for (x1 = x2 = 0; x2 < w; x2++) {
+                    /* Columns present in `grid' are on the left. */
+                    for (x1 = 0; x1 < dlo && height[x1] > 0; x1++);
+                    for (x2 = dlo; x2 <= dhi; x2++) {
                         bool usedcol = false;
 
                         for (y1 = y2 = h-1; y2 >= 0; y2--) {
@@ -817,7 +858,12 @@ static void gen_grid(int w, int h, int nc, int *grid, random_state *rs)
                     assert(j == ntc);
                 }
 
-                memcpy(grid, grid2, wh * sizeof(int));
+                for (i = dlo; i <= dhi; i++) {
+                    for (j = 0; j < h; j++)
+                        grid[j*w+i] = grid2[j*w+i];
+                    height[i] = height2[i];
+                }
+                dhi = -1;	       /* grid2 is up to date */
 
                 break;		       /* done it! */
             }
@@ -885,6 +931,8 @@ static void gen_grid(int w, int h, int nc, int *grid, random_state *rs)
     }
 #endif
 
+    sfree(height2);
+    sfree(height);
     sfree(grid2);
     sfree(list);
 }
@@ -939,17 +987,15 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     else
 	gen_grid_random(params->w, params->h, params->ncols, tiles, rs);
 
-    ret = NULL;
     retlen = 0;
     for (i = 0; i < n; i++) {
 	char buf[80];
-	int k;
-
-	k = sprintf(buf, "%d,", tiles[i]);
-	ret = sresize(ret, retlen + k + 1, char);
-	strcpy(ret + retlen, buf);
-	retlen += k;
+	retlen += sprintf(buf, "%d,", tiles[i]);
     }
+    ret = snewn(retlen + 1, char);
+    retlen = 0;
+    for (i = 0; i < n; i++)
+	retlen += sprintf(ret + retlen, "%d,", tiles[i]);
     ret[retlen-1] = '\0'; /* delete last comma */
 
     sfree(tiles);
@@ -1662,7 +1708,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     false, NULL, /* solve */
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
@@ -620,6 +620,135 @@ static int cell_adj(game_state *state, int i, int *ai, int *ad)
     return n;
 }
 
+/*
+ * The random walk in new_game_fill nearly always gets stuck in the
+ * last few cells, and starting again from nothing costs far more, on
+ * large grids, than anything else in generation. So once there are
+ * only FILL_SEARCH_CELLS empty cells left, we finish the path from head
+ * to tail by exhaustive search instead, in a random order, keeping
+ * the unreached cells as a bitmap and giving up on any partial path
+ * that leaves some unreached cell isolated or out of reach. (If no
+ * path exists, or the search takes too long, we start again as for a
+ * stuck walk.)
+ *
+ * Cells are numbered 0 to ncells-1 in the search, and bit ncells
+ * stands for the tail; adj[i] is every cell (or the tail) in line with
+ * cell i, and adj[ncells] those in line with the head.
+ */
+#define FILL_SEARCH_CELLS 24
+#define FILL_SEARCH_NODES 20000
+
+struct fill_search {
+    int ncells, nodes;
+    int cells[FILL_SEARCH_CELLS];
+    unsigned long adj[FILL_SEARCH_CELLS+1];
+    int path[FILL_SEARCH_CELLS];
+    random_state *rs;
+};
+
+static int fill_search_count(unsigned long bits)
+{
+    int n = 0;
+    for (; bits; bits &= bits - 1) n++;
+    return n;
+}
+
+/* Can we visit every cell in 'left' from 'cur', and then the tail? */
+static bool fill_search_from(struct fill_search *fs, int cur,
+                             unsigned long left, int depth)
+{
+    unsigned long tail = 1UL << fs->ncells, here = 1UL << cur, bits, reach;
+    int order[FILL_SEARCH_CELLS], norder = 0, i, j, t;
+
+    if (!left)
+        return (fs->adj[cur] & tail) != 0;
+
+    /* Every unreached cell needs a way in, and a different way out. */
+    for (bits = left; bits; bits &= bits - 1) {
+        i = 0;
+        while (!((bits >> i) & 1)) i++;
+        if (fill_search_count(fs->adj[i] & (left | here | tail)) < 2)
+            return false;
+    }
+
+    /* And they, and the tail, must be reachable through each other. */
+    reach = fs->adj[cur] & (left | tail);
+    while (1) {
+        unsigned long more = reach;
+        for (bits = reach; bits; bits &= bits - 1) {
+            i = 0;
+            while (!((bits >> i) & 1)) i++;
+            if (i < fs->ncells)
+                more |= fs->adj[i] & (left | tail);
+        }
+        if (more == reach) break;
+        reach = more;
+    }
+    if (reach != (left | tail))
+        return false;
+
+    for (bits = fs->adj[cur] & left; bits; bits &= bits - 1) {
+        i = 0;
+        while (!((bits >> i) & 1)) i++;
+        order[norder++] = i;
+    }
+    for (i = norder; i > 1; i--) {
+        j = random_upto(fs->rs, i);
+        t = order[i-1]; order[i-1] = order[j]; order[j] = t;
+    }
+    for (i = 0; i < norder; i++) {
+        if (++fs->nodes > FILL_SEARCH_NODES)
+            return false;
+        fs->path[depth] = order[i];
+        if (fill_search_from(fs, order[i], left & ~(1UL << order[i]),
+                             depth+1))
+            return true;
+    }
+    return false;
+}
+
+/* Number (and point) the empty cells along a path from headi to taili,
+ * if there is one. */
+static bool new_game_fill_search(game_state *state, random_state *rs,
+                                 int headi, int taili)
+{
+    struct fill_search fs[1];
+    int i, j, prev;
+
+    fs->ncells = 0;
+    for (i = 0; i < state->n; i++)
+        if (state->nums[i] == 0) {
+            assert(fs->ncells < FILL_SEARCH_CELLS);
+            fs->cells[fs->ncells++] = i;
+        }
+    assert(state->nums[taili] - state->nums[headi] == fs->ncells + 1);
+
+    for (i = 0; i <= fs->ncells; i++) {
+        int ci = (i < fs->ncells) ? fs->cells[i] : headi;
+        fs->adj[i] = 0;
+        for (j = 0; j < fs->ncells; j++)
+            if (j != i && whichdiri(state, ci, fs->cells[j]) != -1)
+                fs->adj[i] |= 1UL << j;
+        if (whichdiri(state, ci, taili) != -1)
+            fs->adj[i] |= 1UL << fs->ncells;
+    }
+    fs->nodes = 0;
+    fs->rs = rs;
+
+    if (!fill_search_from(fs, fs->ncells, (1UL << fs->ncells) - 1, 0))
+        return false;
+
+    prev = headi;
+    for (i = 0; i < fs->ncells; i++) {
+        j = fs->cells[fs->path[i]];
+        state->nums[j] = state->nums[prev] + 1;
+        state->dirs[prev] = whichdiri(state, prev, j);
+        prev = j;
+    }
+    state->dirs[prev] = whichdiri(state, prev, taili);
+    return true;
+}
+
 static bool new_game_fill(game_state *state, random_state *rs,
                           int headi, int taili)
 {
@@ -641,7 +770,7 @@ static bool new_game_fill(game_state *state, random_state *rs,
     nfilled = 2;
     assert(state->n > 1);
 
-    while (nfilled < state->n) {
+    while (state->n - nfilled > FILL_SEARCH_CELLS) {
         /* Try and expand _from_ headi; keep going if there's only one
          * place to go to. */
         an = cell_adj(state, headi, aidx, adir);
@@ -653,9 +782,9 @@ static bool new_game_fill(game_state *state, random_state *rs,
             nfilled++;
             headi = aidx[j];
             an = cell_adj(state, headi, aidx, adir);
-        } while (an == 1);
+        } while (an == 1 && state->n - nfilled > FILL_SEARCH_CELLS);
 
-	if (nfilled == state->n) break;
+	if (state->n - nfilled <= FILL_SEARCH_CELLS) break;
 
         /* Try and expand _to_ taili; keep going if there's only one
          * place to go to. */
@@ -668,16 +797,13 @@ static bool new_game_fill(game_state *state, random_state *rs,
             nfilled++;
             taili = aidx[j];
             an = cell_adj(state, taili, aidx, adir);
-        } while (an == 1);
+        } while (an == 1 && state->n - nfilled > FILL_SEARCH_CELLS);
     }
-    /* If we get here we have headi and taili set but unconnected
-     * by direction: we need to set headi's direction so as to point
-     * at taili. */
-    state->dirs[headi] = whichdiri(state, headi, taili);
 
-    /* it could happen that our last two weren't in line; if that's the
-     * case, we have to start again. */
-    if (state->dirs[headi] != -1) ret = true;
+    /* Now join headi to taili through whatever's left (which also
+     * sets headi's direction to point at taili if there's nothing:
+     * or fails, so that we start again, if they aren't in line). */
+    ret = new_game_fill_search(state, rs, headi, taili);
 
 done:
     sfree(aidx);
@@ -1066,28 +1192,29 @@ static int compare_heads(const void *a, const void *b)
     return 0;
 }
 
-static int lowest_start(game_state *state, struct head_meta *heads, int nheads)
+/*
+ * Return the lowest colour no head is using, and mark it as used.
+ * Colours only ever become used (a duplicate head gives up its colour
+ * to another head which keeps it), so the search can carry on from
+ * where it last stopped.
+ */
+static int lowest_start(game_state *state, bool *used, int *next)
 {
-    int n, c;
-
-    /* NB start at 1: colour 0 is real numbers */
-    for (c = 1; c < state->n; c++) {
-        for (n = 0; n < nheads; n++) {
-            if (COLOUR(heads[n].start) == c)
-                goto used;
-        }
-        return c;
-used:
-        ;
+    while (*next < state->n && used[*next])
+        (*next)++;
+    if (*next == state->n) {
+        assert(!"No available colours!");
+        return 0;
     }
-    assert(!"No available colours!");
-    return 0;
+    used[*next] = true;
+    return *next;
 }
 
 static void update_numbers(game_state *state)
 {
-    int i, j, n, nnum, nheads;
+    int i, j, n, c, nnum, nheads, nextcolour;
     struct head_meta *heads = snewn(state->n, struct head_meta);
+    bool *used = snewn(state->n, bool);
 
     for (n = 0; n < state->n; n++)
         state->numsi[n] = -1;
@@ -1121,18 +1248,28 @@ static void update_numbers(game_state *state)
      */
     qsort(heads, nheads, sizeof(struct head_meta), compare_heads);
 
+    /* NB colour 0 is real numbers, so it's never available. */
+    for (c = 0; c < state->n; c++)
+        used[c] = (c == 0);
+    for (n = 0; n < nheads; n++) {
+        c = COLOUR(heads[n].start);
+        if (c > 0 && c < state->n)
+            used[c] = true;
+    }
+    nextcolour = 1;
+
     /* Remove duplicate-coloured regions. */
     for (n = nheads-1; n >= 0; n--) { /* order is important! */
         if ((n != 0) && (heads[n].start == heads[n-1].start)) {
             /* We have a duplicate-coloured region: since we're
              * sorted in size order and this is not the first
              * of its colour it's not the largest: recolour it. */
-            heads[n].start = START(lowest_start(state, heads, nheads));
+            heads[n].start = START(lowest_start(state, used, &nextcolour));
             heads[n].preference = -1; /* '-1' means 'was duplicate' */
         }
         else if (!heads[n].preference) {
             assert(heads[n].start == 0);
-            heads[n].start = START(lowest_start(state, heads, nheads));
+            heads[n].start = START(lowest_start(state, used, &nextcolour));
         }
     }
 
@@ -1159,12 +1296,13 @@ static void update_numbers(game_state *state)
         }
     }
     /*debug_numbers(state);*/
+    sfree(used);
     sfree(heads);
 }
 
 static bool check_completion(game_state *state, bool mark_errors)
 {
-    int n, j, k;
+    int n, j, k, *first;
     bool error = false, complete;
 
     /* NB This only marks errors that are possible to perpetrate with
@@ -1177,20 +1315,26 @@ static bool check_completion(game_state *state, bool mark_errors)
             state->flags[j] &= ~FLAG_ERROR;
     }
 
-    /* Search for repeated numbers. */
+    /* Search for repeated numbers, remembering where we first saw each
+     * one (so this is linear in the grid size, not quadratic). */
+    first = snewn(state->n+1, int);
+    for (n = 0; n <= state->n; n++)
+        first[n] = -1;
     for (j = 0; j < state->n; j++) {
-        if (state->nums[j] > 0 && state->nums[j] <= state->n) {
-            for (k = j+1; k < state->n; k++) {
-                if (state->nums[k] == state->nums[j]) {
-                    if (mark_errors) {
-                        state->flags[j] |= FLAG_ERROR;
-                        state->flags[k] |= FLAG_ERROR;
-                    }
-                    error = true;
+        if (ISREALNUM(state, state->nums[j])) {
+            k = first[state->nums[j]];
+            if (k == -1) {
+                first[state->nums[j]] = j;
+            } else {
+                if (mark_errors) {
+                    state->flags[j] |= FLAG_ERROR;
+                    state->flags[k] |= FLAG_ERROR;
                 }
+                error = true;
             }
         }
     }
+    sfree(first);
 
     /* Search and mark numbers n not pointing to n+1; if any numbers
      * are missing we know we've not completed. */
@@ -2326,7 +2470,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     get_prefs, set_prefs,
     new_ui,
@@ -623,7 +623,14 @@ struct solver_op {
 struct solver_state {
     struct solver_op *ops;
     int n_ops, n_alloc;
+    int w, n;
+    unsigned char *queued; /* bit (1 << op) set if op is in ops for a square */
     int *scratch;
+
+    /* For solve_findcuts: the depth-first search... */
+    int *order, *low, *parent, *dir;
+    /* ... and its result. */
+    bool *cut;
 };
 
 static struct solver_state *solver_state_new(game_state *state)
@@ -632,21 +639,49 @@ static struct solver_state *solver_state_new(game_state *state)
 
     ss->ops = NULL;
     ss->n_ops = ss->n_alloc = 0;
+    ss->w = state->w;
+    ss->n = state->n;
+    ss->queued = snewn(state->n, unsigned char);
+    memset(ss->queued, 0, state->n);
     ss->scratch = snewn(state->n, int);
+    ss->order = snewn(state->n, int);
+    ss->low = snewn(state->n, int);
+    ss->parent = snewn(state->n, int);
+    ss->dir = snewn(state->n, int);
+    ss->cut = snewn(state->n, bool);
 
     return ss;
 }
 
 static void solver_state_free(struct solver_state *ss)
 {
+    sfree(ss->queued);
     sfree(ss->scratch);
+    sfree(ss->order);
+    sfree(ss->low);
+    sfree(ss->parent);
+    sfree(ss->dir);
+    sfree(ss->cut);
     if (ss->ops) sfree(ss->ops);
     sfree(ss);
 }
 
+/* Throw away any ops not yet done. */
+static void solver_ops_clear(struct solver_state *ss)
+{
+    ss->n_ops = 0;
+    memset(ss->queued, 0, ss->n);
+}
+
 static void solver_op_add(struct solver_state *ss, int x, int y, int op, const char *desc)
 {
     struct solver_op *sop;
+    int i = y*ss->w + x;
+
+    /* A second copy of an op would do nothing when its turn came. */
+    if (ss->queued[i] & (1 << op))
+        return;
+    ss->queued[i] |= 1 << op;
 
     if (ss->n_alloc < ss->n_ops + 1) {
         ss->n_alloc = (ss->n_alloc + 1) * 2;
@@ -704,6 +739,7 @@ static int solver_ops_do(game_state *state, struct solver_state *ss)
     while (next_op < ss->n_ops) {
         op = ss->ops[next_op++]; /* copy this away, it may get reallocated. */
         i = op.y*state->w + op.x;
+        ss->queued[i] &= ~(1 << op.op);
 
         if (op.op == BLACK) {
             if (state->flags[i] & F_CIRCLE) {
@@ -1009,55 +1045,63 @@ static int solve_offsetpair(game_state *state, struct solver_state *ss)
     return ss->n_ops - n_ops;
 }
 
-static bool solve_hassinglewhiteregion(
-    game_state *state, struct solver_state *ss)
+/*
+ * Do a depth-first search of the non-black squares from 'start', and
+ * set ss->cut for each square that is a cut vertex of them: one whose
+ * blackening would split the white region in two. Returns the number
+ * of squares reached.
+ */
+static int solve_findcuts(game_state *state, struct solver_state *ss, int start)
 {
-    int i, j, nwhite = 0, lwhite = -1, szwhite, start, end, next, a, d, x, y;
+    int w = state->w, *stack = ss->scratch, sp = 0, count = 0, rootkids = 0;
+    int i, j, p, d, x, y;
 
     for (i = 0; i < state->n; i++) {
-        if (!(state->flags[i] & F_BLACK)) {
-            nwhite++;
-            lwhite = i;
-        }
-        state->flags[i] &= ~F_SCRATCH;
+        ss->order[i] = -1;
+        ss->cut[i] = false;
     }
-    if (lwhite == -1) {
-        debug(("solve_hassinglewhite: no white squares found!\n"));
-        state->impossible = true;
-        return false;
-    }
-    /* We don't use connect_dsf here; it's too slow, and there's a quicker
-     * algorithm if all we want is the size of one region. */
-    /* Having written this, this algorithm is only about 5% faster than
-     * using a dsf. */
-    memset(ss->scratch, -1, state->n * sizeof(int));
-    ss->scratch[0] = lwhite;
-    state->flags[lwhite] |= F_SCRATCH;
-    start = 0; end = next = 1;
-    while (start < end) {
-        for (a = start; a < end; a++) {
-            i = ss->scratch[a]; assert(i != -1);
-            for (d = 0; d < 4; d++) {
-                x = (i % state->w) + dxs[d];
-                y = (i / state->w) + dys[d];
-                j = y*state->w + x;
-                if (!INGRID(state, x, y)) continue;
-                if (state->flags[j] & (F_BLACK | F_SCRATCH)) continue;
-                ss->scratch[next++] = j;
-                state->flags[j] |= F_SCRATCH;
-            }
+
+    ss->order[start] = ss->low[start] = count++;
+    ss->parent[start] = -1;
+    ss->dir[start] = 0;
+    stack[sp++] = start;
+    while (sp > 0) {
+        i = stack[sp-1];
+        if (ss->dir[i] < 4) {
+            d = ss->dir[i]++;
+            x = (i % w) + dxs[d];
+            y = (i / w) + dys[d];
+            j = y*w + x;
+            if (!INGRID(state, x, y)) continue;
+            if (state->flags[j] & F_BLACK) continue;
+            if (ss->order[j] < 0) {
+                ss->order[j] = ss->low[j] = count++;
+                ss->parent[j] = i;
+                ss->dir[j] = 0;
+                stack[sp++] = j;
+                if (i == start) rootkids++;
+            } else if (j != ss->parent[i] && ss->order[j] < ss->low[i])
+                ss->low[i] = ss->order[j];
+        } else {
+            /* Finished with i: nothing below it reaches above its
+             * parent, other than through the parent, then the
+             * parent is a cut vertex. (The root is a special case.) */
+            sp--;
+            p = ss->parent[i];
+            if (p < 0) continue;
+            if (ss->low[i] < ss->low[p]) ss->low[p] = ss->low[i];
+            if (p != start && ss->low[i] >= ss->order[p]) ss->cut[p] = true;
         }
-        start = end; end = next;
     }
-    szwhite = next;
-    return (szwhite == nwhite);
+    if (rootkids >= 2) ss->cut[start] = true;
+
+    return count;
 }
 
 static void solve_removesplits_check(game_state *state, struct solver_state *ss,
                                      int x, int y)
 {
     int i = y*state->w + x;
-    bool issingle;
 
     if (!INGRID(state, x, y)) return;
     if ((state->flags[i] & F_CIRCLE) || (state->flags[i] & F_BLACK))
@@ -1065,23 +1109,30 @@ static void solve_removesplits_check(game_state *state, struct solver_state *ss,
 
     /* If putting a black square at (x,y) would make the white region
      * non-contiguous, it must be circled. */
-    state->flags[i] |= F_BLACK;
-    issingle = solve_hassinglewhiteregion(state, ss);
-    state->flags[i] &= ~F_BLACK;
-
-    if (!issingle)
+    if (ss->cut[i])
         solver_op_add(ss, x, y, CIRCLE, "MC: black square here would split white region");
 }
 
 /* For all black squares, search in squares diagonally adjacent to see if
  * we can rule out putting a black square there (because it would make the
- * white region non-contiguous). */
-/* This function is likely to be somewhat slow. */
+ * white region non-contiguous). One search of the white region finds all
+ * the squares where that would happen. */
 static int solve_removesplits(game_state *state, struct solver_state *ss)
 {
-    int i, x, y, n_ops = ss->n_ops;
+    int i, x, y, n_ops = ss->n_ops, nwhite = 0, lwhite = -1;
 
-    if (!solve_hassinglewhiteregion(state, ss)) {
+    for (i = 0; i < state->n; i++) {
+        if (!(state->flags[i] & F_BLACK)) {
+            nwhite++;
+            lwhite = i;
+        }
+    }
+    if (lwhite == -1) {
+        debug(("solve_removesplits: no white squares found!\n"));
+        state->impossible = true;
+        return 0;
+    }
+    if (solve_findcuts(state, ss, lwhite) != nwhite) {
         debug(("solve_removesplits: white region is not contiguous at start!\n"));
         state->impossible = true;
         return 0;
@@ -1327,6 +1378,7 @@ static char *new_game_desc(const game_params *params_orig, random_state *rs,
     int w = state->w, h = state->h, o = state->o;
     char *ret;
     digit *latin;
+    struct latin_generate_scratch *latinscratch;
     struct solver_state *ss = solver_state_new(state);
 
     /* Downgrade difficulty to Easy for puzzles so tiny that they aren't
@@ -1338,19 +1390,20 @@ static char *new_game_desc(const game_params *params_orig, random_state *rs,
     scratch = snewn(state->n, int);
     rownums = snewn(h*o, int);
     colnums = snewn(w*o, int);
+    latin = snewn(state->n, digit);
+    latinscratch = latin_generate_new_scratch(o);
 
 generate:
-    ss->n_ops = 0;
+    solver_ops_clear(ss);
     debug(("Starting game generation, size %dx%d\n", w, h));
 
     memset(state->flags, 0, state->n*sizeof(unsigned int));
 
     /* First, generate the latin rectangle.
      * The order of this, o, is max(w,h). */
-    latin = latin_generate_rect(w, h, rs);
+    latin_generate_rect_with_scratch(latinscratch, w, h, latin, rs);
     for (i = 0; i < state->n; i++)
         state->nums[i] = (int)latin[i];
-    sfree(latin);
     debug_state("State after latin square", state);
 
     /* Add black squares at random, using bits of solver as we go (to lay
@@ -1433,6 +1486,8 @@ randomise:
     sfree(scratch);
     sfree(rownums);
     sfree(colnums);
+    sfree(latin);
+    latin_generate_free_scratch(latinscratch);
 
     return ret;
 }
@@ -1889,7 +1944,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     get_prefs, set_prefs,
     new_ui,
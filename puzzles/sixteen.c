@@ -515,12 +515,158 @@ static void free_game(game_state *state)
     sfree(state);
 }
 
+/*
+ * Checkpoints for save files: the move counts and flags, followed by
+ * the tile array in the same form as a game description.
+ */
+static char *encode_state(const game_state *state)
+{
+    char *ret, *p;
+    int i;
+
+    ret = snewn(80 + state->n * 12, char);
+    p = ret + sprintf(ret, "%d,%d,%d,%d,%d;", state->movecount,
+                      state->completed, state->movetarget,
+                      state->last_movement_sense, state->used_solve ? 1 : 0);
+    for (i = 0; i < state->n; i++)
+        p += sprintf(p, "%s%d", i ? "," : "", state->tiles[i]);
+
+    return ret;
+}
+
+static game_state *decode_state(const game_state *orig, const char *encoding)
+{
+    game_state *ret;
+    game_params params;
+    int movecount, completed, movetarget, sense, used_solve, k = -1, i;
+    const char *p;
+
+    if (sscanf(encoding, "%d,%d,%d,%d,%d;%n", &movecount, &completed,
+               &movetarget, &sense, &used_solve, &k) != 5 || k < 0)
+        return NULL;
+    p = encoding + k;
+    params.w = orig->w;
+    params.h = orig->h;
+    params.movetarget = movetarget;
+    if (validate_desc(&params, p))
+        return NULL;
+
+    ret = dup_game(orig);
+    for (i = 0; i < ret->n; i++) {
+        ret->tiles[i] = atoi(p);
+        while (*p && *p != ',')
+            p++;
+        if (*p) p++;                   /* eat comma */
+    }
+    ret->movecount = movecount;
+    ret->completed = completed;
+    ret->movetarget = movetarget;
+    ret->last_movement_sense = sense;
+    ret->used_solve = used_solve != 0;
+
+    return ret;
+}
+
 static char *solve_game(const game_state *state, const game_state *currstate,
                         const char *aux, const char **error)
 {
     return dupstr("S");
 }
 
+/*
+ * Hints come from a breadth-first search for the first move of a
+ * shortest solution. That covers every position on grids of up to
+ * nine squares (9! arrangements); on bigger grids it only finds one
+ * from positions a few moves from solved.
+ *
+ * Moves are numbered two per row, then two per column: odd numbers
+ * shift right or down, even numbers left or up.
+ */
+#define HINT_MAXSTATES 400000
+
+struct hint_ctx {
+    int w, h;
+};
+
+static void hint_apply(void *vctx, int move, unsigned char *cells)
+{
+    struct hint_ctx *ctx = (struct hint_ctx *)vctx;
+    int first, step, count, k;
+    unsigned char tmp;
+
+    if (move < 2 * ctx->h) {
+        first = (move/2) * ctx->w;
+        step = 1;
+        count = ctx->w;
+    } else {
+        first = (move/2) - ctx->h;
+        step = ctx->w;
+        count = ctx->h;
+    }
+
+    if (move & 1) {
+        tmp = cells[first + (count-1)*step];
+        for (k = count-1; k > 0; k--)
+            cells[first + k*step] = cells[first + (k-1)*step];
+        cells[first] = tmp;
+    } else {
+        tmp = cells[first];
+        for (k = 0; k < count-1; k++)
+            cells[first + k*step] = cells[first + (k+1)*step];
+        cells[first + (count-1)*step] = tmp;
+    }
+}
+
+static bool hint_goal(void *vctx, const unsigned char *cells)
+{
+    struct hint_ctx *ctx = (struct hint_ctx *)vctx;
+    int i;
+
+    for (i = 0; i < ctx->w * ctx->h; i++)
+        if (cells[i] != i+1)
+            return false;
+    return true;
+}
+
+static char *solve_step(const game_state *state, const game_state *currstate,
+                        const char *aux, const char **error)
+{
+    int w = currstate->w, h = currstate->h, n = currstate->n;
+    struct hint_ctx ctx;
+    unsigned char *cells;
+    char buf[80];
+    int i, move;
+
+    if (n > 255 || 2 * (w+h) > 255) {
+        *error = "Puzzle is too large for hints";
+        return NULL;
+    }
+
+    ctx.w = w;
+    ctx.h = h;
+    cells = snewn(n, unsigned char);
+    for (i = 0; i < n; i++)
+        cells[i] = currstate->tiles[i];
+    if (hint_goal(&ctx, cells)) {
+        sfree(cells);
+        *error = "Puzzle is already solved";
+        return NULL;
+    }
+    move = shortest_first_move(cells, n, 2 * (w+h), hint_apply, hint_goal,
+                               &ctx, HINT_MAXSTATES);
+    sfree(cells);
+
+    if (move < 0) {
+        *error = "Too far from the solution for a hint";
+        return NULL;
+    }
+    if (move < 2*h)
+        sprintf(buf, "R%d,%d", move/2, (move & 1 ? +1 : -1));
+    else
+        sprintf(buf, "C%d,%d", move/2 - h, (move & 1 ? +1 : -1));
+    return dupstr(buf);
+}
+
 static bool game_can_format_as_text_now(const game_params *params)
 {
     return true;
@@ -1195,7 +1341,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    encode_state, decode_state,
     true, solve_game,
+    solve_step,
+    NULL, /* grade */
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
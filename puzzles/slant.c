@@ -308,6 +308,21 @@ struct solver_scratch {
      */
     unsigned char *vbitmap;
 
+    /*
+     * The clue points the solver still has to look at, in order.
+     * Once every square around a clue point is filled in, and the
+     * clue has been found to be satisfied, nothing more can be
+     * deduced from it, so it's dropped from this list.
+     */
+    int *live_clues, nlive_clues;
+
+    /*
+     * Once the v-shapes contradicted by a filled square have been
+     * ruled out, ruling them out again does nothing, so edge_done is
+     * set for that square.
+     */
+    bool *edge_done;
+
     /*
      * Useful to have this information automatically passed to
      * solver subroutines. (This pointer is not dynamically
@@ -326,11 +341,15 @@ static struct solver_scratch *new_scratch(int w, int h)
     ret->equiv = dsf_new(w*h);
     ret->slashval = snewn(w*h, signed char);
     ret->vbitmap = snewn(w*h, unsigned char);
+    ret->live_clues = snewn(W*H, int);
+    ret->edge_done = snewn(w*h, bool);
     return ret;
 }
 
 static void free_scratch(struct solver_scratch *sc)
 {
+    sfree(sc->edge_done);
+    sfree(sc->live_clues);
     sfree(sc->vbitmap);
     sfree(sc->slashval);
     dsf_free(sc->equiv);
@@ -490,7 +509,7 @@ static int slant_solve(int w, int h, const signed char *clues,
 		       int difficulty)
 {
     int W = w+1, H = h+1;
-    int x, y, i, j;
+    int x, y, i, j, k, nlive;
     bool done_something;
 
     /*
@@ -522,6 +541,12 @@ static int slant_solve(int w, int h, const signed char *clues,
      */
     memset(sc->vbitmap, 0xF, w*h);
 
+    sc->nlive_clues = 0;
+    for (i = 0; i < W*H; i++)
+        if (clues[i] >= 0)
+            sc->live_clues[sc->nlive_clues++] = i;
+    memset(sc->edge_done, 0, w*h * sizeof(bool));
+
     /*
      * Initialise the `exits' and `border' arrays. These are used
      * to do second-order loop avoidance: the dual of the no loops
@@ -560,201 +585,207 @@ static int slant_solve(int w, int h, const signed char *clues,
 	 * to zero or to the number of remaining undecided
 	 * neighbouring squares can be filled in completely.
 	 */
-	for (y = 0; y < H; y++)
-	    for (x = 0; x < W; x++) {
-		struct {
-		    int pos, slash;
-		} neighbours[4];
-		int nneighbours;
-		int nu, nl, c, s, eq, eq2, last, meq, mj1, mj2;
+	for (k = nlive = 0; k < sc->nlive_clues; k++) {
+	    struct {
+		int pos, slash;
+	    } neighbours[4];
+	    int nneighbours;
+	    int nu, nl, c, s, eq, eq2, last, meq, mj1, mj2;
+
+	    x = sc->live_clues[k] % W;
+	    y = sc->live_clues[k] / W;
+	    c = clues[y*W+x];
+
+	    /*
+	     * We have a clue point. Start by listing its
+	     * neighbouring squares, in order around the point,
+	     * together with the type of slash that would be
+	     * required in that square to connect to the point.
+	     */
+	    nneighbours = 0;
+	    if (x > 0 && y > 0) {
+		neighbours[nneighbours].pos = (y-1)*w+(x-1);
+		neighbours[nneighbours].slash = -1;
+		nneighbours++;
+	    }
+	    if (x > 0 && y < h) {
+		neighbours[nneighbours].pos = y*w+(x-1);
+		neighbours[nneighbours].slash = +1;
+		nneighbours++;
+	    }
+	    if (x < w && y < h) {
+		neighbours[nneighbours].pos = y*w+x;
+		neighbours[nneighbours].slash = -1;
+		nneighbours++;
+	    }
+	    if (x < w && y > 0) {
+		neighbours[nneighbours].pos = (y-1)*w+x;
+		neighbours[nneighbours].slash = +1;
+		nneighbours++;
+	    }
 
-		if ((c = clues[y*W+x]) < 0)
-		    continue;
+	    /*
+	     * Count up the number of undecided neighbours, and
+	     * also the number of lines already present.
+	     *
+	     * If we're not on DIFF_EASY, then in this loop we
+	     * also track whether we've seen two adjacent empty
+	     * squares belonging to the same equivalence class
+	     * (meaning they have the same type of slash). If
+	     * so, we count them jointly as one line.
+	     */
+	    nu = 0;
+	    nl = c;
+	    last = neighbours[nneighbours-1].pos;
+	    if (soln[last] == 0)
+		eq = dsf_canonify(sc->equiv, last);
+	    else
+		eq = -1;
+	    meq = mj1 = mj2 = -1;
+	    for (i = 0; i < nneighbours; i++) {
+		j = neighbours[i].pos;
+		s = neighbours[i].slash;
+		if (soln[j] == 0) {
+		    nu++;          /* undecided */
+		    if (meq < 0 && difficulty > DIFF_EASY) {
+			eq2 = dsf_canonify(sc->equiv, j);
+			if (eq == eq2 && last != j) {
+			    /*
+			     * We've found an equivalent pair.
+			     * Mark it. This also inhibits any
+			     * further equivalence tracking
+			     * around this square, since we can
+			     * only handle one pair (and in
+			     * particular we want to avoid
+			     * being misled by two overlapping
+			     * equivalence pairs).
+			     */
+			    meq = eq;
+			    mj1 = last;
+			    mj2 = j;
+			    nl--;   /* count one line */
+			    nu -= 2;   /* and lose two undecideds */
+			} else
+			    eq = eq2;
+		    }
+		} else {
+		    eq = -1;
+		    if (soln[j] == s)
+			nl--;      /* here's a line */
+		}
+		last = j;
+	    }
 
+	    /*
+	     * Check the counts.
+	     */
+	    if (nl < 0 || nl > nu) {
 		/*
-		 * We have a clue point. Start by listing its
-		 * neighbouring squares, in order around the point,
-		 * together with the type of slash that would be
-		 * required in that square to connect to the point.
+		 * No consistent value for this at all!
 		 */
-		nneighbours = 0;
-		if (x > 0 && y > 0) {
-		    neighbours[nneighbours].pos = (y-1)*w+(x-1);
-		    neighbours[nneighbours].slash = -1;
-		    nneighbours++;
-		}
-		if (x > 0 && y < h) {
-		    neighbours[nneighbours].pos = y*w+(x-1);
-		    neighbours[nneighbours].slash = +1;
-		    nneighbours++;
-		}
-		if (x < w && y < h) {
-		    neighbours[nneighbours].pos = y*w+x;
-		    neighbours[nneighbours].slash = -1;
-		    nneighbours++;
+#ifdef SOLVER_DIAGNOSTICS
+		if (verbose)
+		    printf("need %d / %d lines around clue point at %d,%d!\n",
+			   nl, nu, x, y);
+#endif
+		return 0;          /* impossible */
+	    }
+
+	    if (nu == 0) {
+		/* (Unless nu only reached 0 by dropping a pair.) */
+		if (meq < 0)
+		    continue;      /* drop it from live_clues */
+	    } else if (nl == 0 || nl == nu) {
+#ifdef SOLVER_DIAGNOSTICS
+		if (verbose) {
+		    if (meq >= 0)
+			printf("partially (since %d,%d == %d,%d) ",
+			       mj1%w, mj1/w, mj2%w, mj2/w);
+		    printf("%s around clue point at %d,%d\n",
+			   nl ? "filling" : "emptying", x, y);
 		}
-		if (x < w && y > 0) {
-		    neighbours[nneighbours].pos = (y-1)*w+x;
-		    neighbours[nneighbours].slash = +1;
-		    nneighbours++;
+#endif
+		for (i = 0; i < nneighbours; i++) {
+		    j = neighbours[i].pos;
+		    s = neighbours[i].slash;
+		    if (soln[j] == 0 && j != mj1 && j != mj2) {
+			if (!fill_square(w, h, j%w, j/w, (nl ? s : -s),
+					 soln, sc->connected, sc))
+			    return 0;  /* impossible */
+		    }
 		}
 
+		done_something = true;
+	    } else if (nu == 2 && nl == 1 && difficulty > DIFF_EASY) {
 		/*
-		 * Count up the number of undecided neighbours, and
-		 * also the number of lines already present.
-		 *
-		 * If we're not on DIFF_EASY, then in this loop we
-		 * also track whether we've seen two adjacent empty
-		 * squares belonging to the same equivalence class
-		 * (meaning they have the same type of slash). If
-		 * so, we count them jointly as one line.
+		 * If we have precisely two undecided squares
+		 * and precisely one line to place between
+		 * them, _and_ those squares are adjacent, then
+		 * we can mark them as equivalent to one
+		 * another.
+		 * 
+		 * This even applies if meq >= 0: if we have a
+		 * 2 clue point and two of its neighbours are
+		 * already marked equivalent, we can indeed
+		 * mark the other two as equivalent.
+		 * 
+		 * We don't bother with this on DIFF_EASY,
+		 * since we wouldn't have used the results
+		 * anyway.
 		 */
-		nu = 0;
-		nl = c;
-		last = neighbours[nneighbours-1].pos;
-		if (soln[last] == 0)
-		    eq = dsf_canonify(sc->equiv, last);
-		else
-		    eq = -1;
-		meq = mj1 = mj2 = -1;
+		last = -1;
 		for (i = 0; i < nneighbours; i++) {
 		    j = neighbours[i].pos;
-		    s = neighbours[i].slash;
-		    if (soln[j] == 0) {
-			nu++;	       /* undecided */
-			if (meq < 0 && difficulty > DIFF_EASY) {
-			    eq2 = dsf_canonify(sc->equiv, j);
-			    if (eq == eq2 && last != j) {
-				/*
-				 * We've found an equivalent pair.
-				 * Mark it. This also inhibits any
-				 * further equivalence tracking
-				 * around this square, since we can
-				 * only handle one pair (and in
-				 * particular we want to avoid
-				 * being misled by two overlapping
-				 * equivalence pairs).
-				 */
-				meq = eq;
-				mj1 = last;
-				mj2 = j;
-				nl--;   /* count one line */
-				nu -= 2;   /* and lose two undecideds */
-			    } else
-				eq = eq2;
-			}
-		    } else {
-			eq = -1;
-			if (soln[j] == s)
-			    nl--;      /* here's a line */
+		    if (soln[j] == 0 && j != mj1 && j != mj2) {
+			if (last < 0)
+			    last = i;
+			else if (last == i-1 || (last == 0 && i == 3))
+			    break; /* found a pair */
 		    }
-		    last = j;
 		}
+		if (i < nneighbours) {
+		    int sv1, sv2;
 
-		/*
-		 * Check the counts.
-		 */
-		if (nl < 0 || nl > nu) {
+		    assert(last >= 0);
 		    /*
-		     * No consistent value for this at all!
+		     * neighbours[last] and neighbours[i] are
+		     * the pair. Mark them equivalent.
 		     */
-#ifdef SOLVER_DIAGNOSTICS
-		    if (verbose)
-			printf("need %d / %d lines around clue point at %d,%d!\n",
-			       nl, nu, x, y);
-#endif
-		    return 0;	       /* impossible */
-		}
-
-		if (nu > 0 && (nl == 0 || nl == nu)) {
 #ifdef SOLVER_DIAGNOSTICS
 		    if (verbose) {
 			if (meq >= 0)
-			    printf("partially (since %d,%d == %d,%d) ",
+			    printf("since %d,%d == %d,%d, ",
 				   mj1%w, mj1/w, mj2%w, mj2/w);
-			printf("%s around clue point at %d,%d\n",
-			       nl ? "filling" : "emptying", x, y);
 		    }
 #endif
-		    for (i = 0; i < nneighbours; i++) {
-			j = neighbours[i].pos;
-			s = neighbours[i].slash;
-			if (soln[j] == 0 && j != mj1 && j != mj2) {
-			    if (!fill_square(w, h, j%w, j/w, (nl ? s : -s),
-                                             soln, sc->connected, sc))
-                                return 0;  /* impossible */
-                        }
-		    }
-
-		    done_something = true;
-		} else if (nu == 2 && nl == 1 && difficulty > DIFF_EASY) {
-		    /*
-		     * If we have precisely two undecided squares
-		     * and precisely one line to place between
-		     * them, _and_ those squares are adjacent, then
-		     * we can mark them as equivalent to one
-		     * another.
-		     * 
-		     * This even applies if meq >= 0: if we have a
-		     * 2 clue point and two of its neighbours are
-		     * already marked equivalent, we can indeed
-		     * mark the other two as equivalent.
-		     * 
-		     * We don't bother with this on DIFF_EASY,
-		     * since we wouldn't have used the results
-		     * anyway.
-		     */
-		    last = -1;
-		    for (i = 0; i < nneighbours; i++) {
-			j = neighbours[i].pos;
-			if (soln[j] == 0 && j != mj1 && j != mj2) {
-			    if (last < 0)
-				last = i;
-			    else if (last == i-1 || (last == 0 && i == 3))
-				break; /* found a pair */
-			}
-		    }
-		    if (i < nneighbours) {
-			int sv1, sv2;
-
-			assert(last >= 0);
-			/*
-			 * neighbours[last] and neighbours[i] are
-			 * the pair. Mark them equivalent.
-			 */
+		    mj1 = neighbours[last].pos;
+		    mj2 = neighbours[i].pos;
 #ifdef SOLVER_DIAGNOSTICS
-			if (verbose) {
-			    if (meq >= 0)
-				printf("since %d,%d == %d,%d, ",
-				       mj1%w, mj1/w, mj2%w, mj2/w);
-			}
+		    if (verbose)
+			printf("clue point at %d,%d implies %d,%d == %d,"
+			       "%d\n", x, y, mj1%w, mj1/w, mj2%w, mj2/w);
 #endif
-			mj1 = neighbours[last].pos;
-			mj2 = neighbours[i].pos;
+		    mj1 = dsf_canonify(sc->equiv, mj1);
+		    sv1 = sc->slashval[mj1];
+		    mj2 = dsf_canonify(sc->equiv, mj2);
+		    sv2 = sc->slashval[mj2];
+		    if (sv1 != 0 && sv2 != 0 && sv1 != sv2) {
 #ifdef SOLVER_DIAGNOSTICS
 			if (verbose)
-			    printf("clue point at %d,%d implies %d,%d == %d,"
-				   "%d\n", x, y, mj1%w, mj1/w, mj2%w, mj2/w);
+			    printf("merged two equivalence classes with"
+				   " different slash values!\n");
 #endif
-			mj1 = dsf_canonify(sc->equiv, mj1);
-			sv1 = sc->slashval[mj1];
-			mj2 = dsf_canonify(sc->equiv, mj2);
-			sv2 = sc->slashval[mj2];
-			if (sv1 != 0 && sv2 != 0 && sv1 != sv2) {
-#ifdef SOLVER_DIAGNOSTICS
-			    if (verbose)
-				printf("merged two equivalence classes with"
-				       " different slash values!\n");
-#endif
-			    return 0;
-			}
-			sv1 = sv1 ? sv1 : sv2;
-			dsf_merge(sc->equiv, mj1, mj2);
-			mj1 = dsf_canonify(sc->equiv, mj1);
-			sc->slashval[mj1] = sv1;
+			return 0;
 		    }
+		    sv1 = sv1 ? sv1 : sv2;
+		    dsf_merge(sc->equiv, mj1, mj2);
+		    mj1 = dsf_canonify(sc->equiv, mj1);
+		    sc->slashval[mj1] = sv1;
 		}
 	    }
+	    sc->live_clues[nlive++] = y*W+x;
+	}
+	sc->nlive_clues = nlive;
 
 	if (done_something)
 	    continue;
@@ -892,7 +923,8 @@ static int slant_solve(int w, int h, const signed char *clues,
                  * Any line already placed in a square must rule
                  * out any type of v which contradicts it.
                  */
-                if ((s = soln[y*w+x]) != 0) {
+                if ((s = soln[y*w+x]) != 0 && !sc->edge_done[y*w+x]) {
+                    sc->edge_done[y*w+x] = true;
                     if (x > 0)
                         done_something |=
                         vbitmap_clear(w, h, sc, x-1, y, (s < 0 ? 0x1 : 0x2),
@@ -1105,31 +1137,85 @@ static void slant_generate(int w, int h, signed char *soln, random_state *rs)
     dsf_free(connected);
 }
 
+/*
+ * A copy of the clue set for prune_clues() to remove clues from,
+ * with a solver of its own.
+ */
+struct slant_pruner {
+    int w, h, diff;
+    signed char *clues, *tmpsoln;
+    struct solver_scratch *sc;
+};
+
+static bool slant_prune_check(void *vp, int i)
+{
+    struct slant_pruner *p = (struct slant_pruner *)vp;
+    signed char v = p->clues[i];
+    bool ok;
+
+    p->clues[i] = -1;
+    ok = slant_solve(p->w, p->h, p->clues, p->tmpsoln, p->sc, p->diff) == 1;
+    p->clues[i] = v;
+    return ok;
+}
+
+static void slant_prune_commit(void *vp, int i)
+{
+    struct slant_pruner *p = (struct slant_pruner *)vp;
+    p->clues[i] = -1;
+}
+
+static const struct prune_ops slant_prune_ops = {
+    slant_prune_check, slant_prune_commit,
+};
+
 static char *new_game_desc(const game_params *params, random_state *rs,
 			   char **aux, bool interactive)
 {
     int w = params->w, h = params->h, W = w+1, H = h+1;
     signed char *soln, *tmpsoln, *clues;
-    int *clueindices;
+    int *clueindices, *cands;
     struct solver_scratch *sc;
-    int x, y, v, i, j;
+    struct slant_pruner *pruners;
+    void **vpruners;
+    int x, y, v, i, j, ncands, npruners;
     char *desc;
 
     soln = snewn(w*h, signed char);
     tmpsoln = snewn(w*h, signed char);
     clues = snewn(W*H, signed char);
     clueindices = snewn(W*H, int);
+    cands = snewn(W*H, int);
     sc = new_scratch(w, h);
 
+    /*
+     * The first pruner works directly on our own clue array; any
+     * others get copies of it before each pruning pass.
+     */
+    npruners = prune_nworkers();
+    pruners = snewn(npruners, struct slant_pruner);
+    vpruners = snewn(npruners, void *);
+    for (i = 0; i < npruners; i++) {
+        pruners[i].w = w;
+        pruners[i].h = h;
+        pruners[i].diff = params->diff;
+        pruners[i].clues = i ? snewn(W*H, signed char) : clues;
+        pruners[i].tmpsoln = i ? snewn(w*h, signed char) : tmpsoln;
+        pruners[i].sc = i ? new_scratch(w, h) : sc;
+        vpruners[i] = &pruners[i];
+    }
+
     do {
 	/*
 	 * Create the filled grid.
 	 */
+        generation_phase("grid");
 	slant_generate(w, h, soln, rs);
 
 	/*
 	 * Fill in the complete set of clues.
 	 */
+        generation_phase("clues");
 	for (y = 0; y < H; y++)
 	    for (x = 0; x < W; x++) {
 		v = 0;
@@ -1160,10 +1246,19 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 	 * away without _any_ completely obvious starting points,
 	 * which is even better.
 	 */
+        generation_phase("solve");
 	for (i = 0; i < W*H; i++)
 	    clueindices[i] = i;
 	shuffle(clueindices, W*H, sizeof(*clueindices), rs);
+	for (i = 1; i < npruners; i++)
+	    memcpy(pruners[i].clues, clues, W*H);
 	for (j = 0; j < 2; j++) {
+	    /*
+	     * Clues already removed in pass 0 would come up again in
+	     * pass 1, but removing them again can't fail, so we leave
+	     * them out.
+	     */
+	    ncands = 0;
 	    for (i = 0; i < W*H; i++) {
 		int pass;
                 bool yb, xb;
@@ -1186,13 +1281,10 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 		else
 		    pass = 1;
 
-		if (pass == j) {
-		    clues[y*W+x] = -1;
-		    if (slant_solve(w, h, clues, tmpsoln, sc,
-				    params->diff) != 1)
-			clues[y*W+x] = v;	       /* put it back */
-		}
+		if (pass == j && v >= 0)
+		    cands[ncands++] = y*W+x;
 	    }
+	    prune_clues(&slant_prune_ops, vpruners, npruners, cands, ncands);
 	}
 
 	/*
@@ -1200,6 +1292,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 	 * requested difficulty, by running the solver one level
 	 * down and verifying that it can't manage it.
 	 */
+        generation_phase("grade");
     } while (params->diff > 0 &&
 	     slant_solve(w, h, clues, tmpsoln, sc, params->diff - 1) <= 1);
 
@@ -1250,7 +1343,15 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 	auxbuf[w*h] = '\0';
     }
 
+    for (i = 1; i < npruners; i++) {
+        sfree(pruners[i].clues);
+        sfree(pruners[i].tmpsoln);
+        free_scratch(pruners[i].sc);
+    }
+    sfree(pruners);
+    sfree(vpruners);
     free_scratch(sc);
+    sfree(cands);
     sfree(clueindices);
     sfree(clues);
     sfree(tmpsoln);
@@ -2317,7 +2418,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     get_prefs, set_prefs,
     new_ui,
@@ -2341,7 +2446,7 @@ const struct game thegame = {
     true, false, game_print_size, game_print,
     false,			       /* wants_statusbar */
     false, NULL,                       /* timing_state */
-    0,				       /* flags */
+    SOLVE_FROM_ORIG,				       /* flags */
 };
 
 #ifdef STANDALONE_SOLVER
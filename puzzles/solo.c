@@ -99,6 +99,7 @@ static int solver_show_working, solver_recurse_depth;
 #endif
 
 #include "puzzles.h"
+#include "dlx.h"
 
 /*
  * To save space, I store digits internally as unsigned char. This
@@ -191,7 +192,19 @@ static int find_sum_bits(unsigned long *array, int idx, int value_left,
 
 static void precompute_sum_bits(void)
 {
+    /*
+     * Only the first call does anything, so that once the tables are
+     * filled in, threads generating or solving puzzles concurrently
+     * just read them.
+     */
+    static bool done = false;
     int i;
+
+    cache_lock();
+    if (done) {
+        cache_unlock();
+        return;
+    }
     for (i = 3; i < 31; i++) {
 	int j;
 	if (i < 18) {
@@ -211,6 +224,8 @@ static void precompute_sum_bits(void)
 	if (j < MAX_4SUMS)
 	    sum_bits4[i][j] = 0;
     }
+    done = true;
+    cache_unlock();
 }
 
 struct game_params {
@@ -277,12 +292,28 @@ struct game_state {
     struct block_structure *blocks;
     struct block_structure *kblocks;   /* Blocks for killer puzzles.  */
     bool xtype, killer;
-    digit *grid, *kgrid;
-    bool *pencil;                      /* c*r*c*r elements */
-    bool *immutable;                   /* marks which digits are clues */
+    cow_array *grid;                   /* of digit */
+    digit *kgrid;
+    cow_array *pencil;                 /* of bool; c*r*c*r elements */
+    cow_array *immutable;              /* of bool; marks which digits are clues */
     bool completed, cheated;
 };
 
+#define GRID(state, i) COW_GET(digit, (state)->grid, i)
+#define PENCIL(state, i) COW_GET(bool, (state)->pencil, i)
+#define IMMUTABLE(state, i) COW_GET(bool, (state)->immutable, i)
+
+/*
+ * Return a freshly allocated flat copy of a game_state's grid, for
+ * handing to the functions which work on plain digit arrays.
+ */
+static digit *flat_grid(const game_state *state)
+{
+    digit *grid = snewn(cow_len(state->grid), digit);
+    cow_read_all(state->grid, grid);
+    return grid;
+}
+
 static game_params *default_params(void)
 {
     game_params *ret = snew(game_params);
@@ -990,7 +1021,8 @@ static int solver_intersect(struct solver_usage *usage,
 }
 
 struct solver_scratch {
-    unsigned char *grid, *rowidx, *colidx, *set;
+    unsigned char *grid, *rowidx, *colidx;
+    uint32 *rowmask;
     int *neighbours, *bfsqueue;
     int *indexlist, *indexlist2;
 #ifdef STANDALONE_SOLVER
@@ -1008,10 +1040,10 @@ static int solver_set(struct solver_usage *usage,
 {
     int cr = usage->cr;
     int i, j, n, count;
-    unsigned char *grid = scratch->grid;
     unsigned char *rowidx = scratch->rowidx;
     unsigned char *colidx = scratch->colidx;
-    unsigned char *set = scratch->set;
+    uint32 *rowmask = scratch->rowmask;
+    uint32 set, all, bits;
 
     /*
      * We are passed a cr-by-cr matrix of booleans. Our first job
@@ -1064,11 +1096,19 @@ static int solver_set(struct solver_usage *usage,
     assert(n == j);
 
     /*
-     * And create the smaller matrix.
+     * And create the smaller matrix, as a bitmask per row. Column j
+     * of the matrix is bit n-1-j, so that counting upwards through
+     * the sets of columns below visits them in the same order as a
+     * binary increment on an array of flags would, with column n-1
+     * as the least significant digit. (cr is at most 31, so this
+     * fits.)
      */
-    for (i = 0; i < n; i++)
+    for (i = 0; i < n; i++) {
+        rowmask[i] = 0;
         for (j = 0; j < n; j++)
-            grid[i*cr+j] = usage->cube[indices[rowidx[i]*cr+colidx[j]]];
+            if (usage->cube[indices[rowidx[i]*cr+colidx[j]]])
+                rowmask[i] |= (uint32)1 << (n-1-j);
+    }
 
     /*
      * Having done that, we now have a matrix in which every row
@@ -1078,7 +1118,8 @@ static int solver_set(struct solver_usage *usage,
      * columns) whose width and height add up to n.
      */
 
-    memset(set, 0, n);
+    all = n ? ((uint32)2 << (n-1)) - 1 : 0;
+    set = 0;
     count = 0;
     while (1) {
         /*
@@ -1092,16 +1133,9 @@ static int solver_set(struct solver_usage *usage,
              * the positions listed in `set'.
              */
             int rows = 0;
-            for (i = 0; i < n; i++) {
-                bool ok = true;
-                for (j = 0; j < n; j++)
-                    if (set[j] && grid[i*cr+j]) {
-                        ok = false;
-                        break;
-                    }
-                if (ok)
+            for (i = 0; i < n; i++)
+                if (!(rowmask[i] & set))
                     rows++;
-            }
 
             /*
              * We expect never to be able to get _more_ than
@@ -1142,15 +1176,9 @@ static int solver_set(struct solver_usage *usage,
                  * positions in the cube to meddle with.
                  */
                 for (i = 0; i < n; i++) {
-                    bool ok = true;
-                    for (j = 0; j < n; j++)
-                        if (set[j] && grid[i*cr+j]) {
-                            ok = false;
-                            break;
-                        }
-                    if (!ok) {
+                    if (rowmask[i] & set) {
                         for (j = 0; j < n; j++)
-                            if (!set[j] && grid[i*cr+j]) {
+                            if (rowmask[i] & ~set & ((uint32)1 << (n-1-j))) {
                                 int fpos = indices[rowidx[i]*cr+colidx[j]];
 #ifdef STANDALONE_SOLVER
                                 if (solver_show_working) {
@@ -1189,16 +1217,13 @@ static int solver_set(struct solver_usage *usage,
         }
 
         /*
-         * Binary increment: change the rightmost 0 to a 1, and
-         * change all 1s to the right of it to 0s.
+         * Move on to the next set of columns, and count them.
          */
-        i = n;
-        while (i > 0 && set[i-1])
-            set[--i] = 0, count--;
-        if (i > 0)
-            set[--i] = 1, count++;
-        else
+        set = (set + 1) & all;
+        if (!set)
             break;                     /* done */
+        for (count = 0, bits = set; bits; bits &= bits-1)
+            count++;
     }
 
     return 0;
@@ -1411,6 +1436,30 @@ static int solver_forcing(struct solver_usage *usage,
     return 0;
 }
 
+/*
+ * The smallest and largest digits still possible in a square, or 0
+ * if there are none.
+ */
+static int square_min_digit(struct solver_usage *usage, int x)
+{
+    int cr = usage->cr, n;
+
+    for (n = 1; n <= cr; n++)
+	if (cube2(x, n))
+	    return n;
+    return 0;
+}
+
+static int square_max_digit(struct solver_usage *usage, int x)
+{
+    int n;
+
+    for (n = usage->cr; n > 0; n--)
+	if (cube2(x, n))
+	    return n;
+    return 0;
+}
+
 static int solver_killer_minmax(struct solver_usage *usage,
 				struct block_structure *cages, digit *clues,
 				int b
@@ -1423,33 +1472,30 @@ static int solver_killer_minmax(struct solver_usage *usage,
     int i;
     int ret = 0;
     int nsquares = cages->nr_squares[b];
+    int summin, summax;
 
     if (clues[b] == 0)
 	return 0;
 
+    /*
+     * Keep the minimum and maximum sums of the whole cage, so that
+     * those of all the squares but one are just a subtraction away.
+     * (Ruling digits out of a square changes them for the squares
+     * after it, so they're updated as we go.)
+     */
+    summin = summax = 0;
+    for (i = 0; i < nsquares; i++) {
+	summin += square_min_digit(usage, cages->blocks[b][i]);
+	summax += square_max_digit(usage, cages->blocks[b][i]);
+    }
+
     for (i = 0; i < nsquares; i++) {
 	int n, x = cages->blocks[b][i];
+	int lo = square_min_digit(usage, x), hi = square_max_digit(usage, x);
+	int minval = summin - lo, maxval = summax - hi;
 
 	for (n = 1; n <= cr; n++)
 	    if (cube2(x, n)) {
-		int maxval = 0, minval = 0;
-		int j;
-		for (j = 0; j < nsquares; j++) {
-		    int m;
-		    int y = cages->blocks[b][j];
-		    if (i == j)
-			continue;
-		    for (m = 1; m <= cr; m++)
-			if (cube2(y, m)) {
-			    minval += m;
-			    break;
-			}
-		    for (m = cr; m > 0; m--)
-			if (cube2(y, m)) {
-			    maxval += m;
-			    break;
-			}
-		}
 		if (maxval + n < clues[b]) {
 		    cube2(x, n) = false;
 		    ret = 1;
@@ -1471,6 +1517,9 @@ static int solver_killer_minmax(struct solver_usage *usage,
 #endif
 		}
 	    }
+
+	summin += square_min_digit(usage, x) - lo;
+	summax += square_max_digit(usage, x) - hi;
     }
     return ret;
 }
@@ -1486,7 +1535,7 @@ static int solver_killer_sums(struct solver_usage *usage, int b,
     int cr = usage->cr;
     int i, ret, max_sums;
     int nsquares = cages->nr_squares[b];
-    unsigned long *sumbits, possible_addends;
+    unsigned long *sumbits, possible_addends, square_bits[4];
 
     if (clue == 0) {
 	assert(nsquares == 0);
@@ -1554,8 +1603,20 @@ static int solver_killer_sums(struct solver_usage *usage, int b,
      * For every possible way to get the sum, see if there is
      * one square in the cage that disallows all the required
      * addends.  If we find one such square, this way to compute
-     * the sum is impossible.
+     * the sum is impossible. Each square's possible digits are
+     * collected into the same form of bitmask first, so that
+     * checking a way against a square is a single AND. (The sums
+     * use digits up to 9 whatever cr is, and digits beyond cr have
+     * never been ruled out of any square, so we don't start now.)
      */
+    for (i = 0; i < nsquares; i++) {
+	int n, x = cages->blocks[b][i];
+
+	square_bits[i] = ~0UL << (cr + 1);
+	for (n = 1; n <= cr; n++)
+	    if (cube2(x, n))
+		square_bits[i] |= 1L << n;
+    }
     possible_addends = 0;
     for (i = 0; i < max_sums; i++) {
 	int j;
@@ -1564,17 +1625,9 @@ static int solver_killer_sums(struct solver_usage *usage, int b,
 	if (bits == 0)
 	    break;
 
-	for (j = 0; j < nsquares; j++) {
-	    int n;
-	    unsigned long square_bits = bits;
-	    int x = cages->blocks[b][j];
-	    for (n = 1; n <= cr; n++)
-		if (!cube2(x, n))
-		    square_bits &= ~(1L << n);
-	    if (square_bits == 0) {
+	for (j = 0; j < nsquares; j++)
+	    if (!(bits & square_bits[j]))
 		break;
-	    }
-	}
 	if (j == nsquares)
 	    possible_addends |= bits;
     }
@@ -1615,7 +1668,8 @@ static int solver_killer_sums(struct solver_usage *usage, int b,
 static int filter_whole_cages(struct solver_usage *usage, int *squares, int n,
 			      int *filtered_sum)
 {
-    int b, i, j, off;
+    int b, i, j, k, off, ncages;
+    int *cages;
     *filtered_sum = 0;
 
     /* First, filter squares with a clue.  */
@@ -1626,15 +1680,36 @@ static int filter_whole_cages(struct solver_usage *usage, int *squares, int n,
 	    squares[j++] = squares[i];
     n = j;
 
+    /*
+     * Only the cages which some of the squares are in can be
+     * covered, so find those (in the order of their numbers, in
+     * which we go through them; there can't be more of them than
+     * there are squares).
+     */
+    cages = snewn(max(n, 1), int);
+    ncages = 0;
+    for (i = 0; i < n; i++) {
+	b = usage->kblocks->whichblock[squares[i]];
+	if (b < 0)
+	    continue;
+	for (j = 0; j < ncages && cages[j] < b; j++);
+	if (j < ncages && cages[j] == b)
+	    continue;
+	for (k = ncages++; k > j; k--)
+	    cages[k] = cages[k-1];
+	cages[j] = b;
+    }
+
     /*
      * Filter all cages that are covered entirely by the list of
      * squares.
      */
     off = 0;
-    for (b = 0; b < usage->kblocks->nr_blocks && off < n; b++) {
-	int b_squares = usage->kblocks->nr_squares[b];
-	int matched = 0;
+    for (k = 0; k < ncages && off < n; k++) {
+	int b_squares, matched = 0;
 
+	b = cages[k];
+	b_squares = usage->kblocks->nr_squares[b];
 	if (b_squares == 0)
 	    continue;
 
@@ -1664,44 +1739,30 @@ static int filter_whole_cages(struct solver_usage *usage, int *squares, int n,
 
 	*filtered_sum += usage->kclues[b];
     }
+    sfree(cages);
     assert(off == n);
     return off;
 }
 
-static struct solver_scratch *solver_new_scratch(struct solver_usage *usage)
+static struct solver_scratch *solver_new_scratch(struct solver_usage *usage,
+                                                 arena *a)
 {
-    struct solver_scratch *scratch = snew(struct solver_scratch);
+    struct solver_scratch *scratch = anew(a, struct solver_scratch);
     int cr = usage->cr;
-    scratch->grid = snewn(cr*cr, unsigned char);
-    scratch->rowidx = snewn(cr, unsigned char);
-    scratch->colidx = snewn(cr, unsigned char);
-    scratch->set = snewn(cr, unsigned char);
-    scratch->neighbours = snewn(5*cr, int);
-    scratch->bfsqueue = snewn(cr*cr, int);
+    scratch->grid = anewn(a, cr*cr, unsigned char);
+    scratch->rowidx = anewn(a, cr, unsigned char);
+    scratch->colidx = anewn(a, cr, unsigned char);
+    scratch->rowmask = anewn(a, cr, uint32);
+    scratch->neighbours = anewn(a, 5*cr, int);
+    scratch->bfsqueue = anewn(a, cr*cr, int);
 #ifdef STANDALONE_SOLVER
-    scratch->bfsprev = snewn(cr*cr, int);
+    scratch->bfsprev = anewn(a, cr*cr, int);
 #endif
-    scratch->indexlist = snewn(cr*cr, int);   /* used for set elimination */
-    scratch->indexlist2 = snewn(cr, int);   /* only used for intersect() */
+    scratch->indexlist = anewn(a, cr*cr, int); /* used for set elimination */
+    scratch->indexlist2 = anewn(a, cr, int);   /* only used for intersect() */
     return scratch;
 }
 
-static void solver_free_scratch(struct solver_scratch *scratch)
-{
-#ifdef STANDALONE_SOLVER
-    sfree(scratch->bfsprev);
-#endif
-    sfree(scratch->bfsqueue);
-    sfree(scratch->neighbours);
-    sfree(scratch->set);
-    sfree(scratch->colidx);
-    sfree(scratch->rowidx);
-    sfree(scratch->grid);
-    sfree(scratch->indexlist);
-    sfree(scratch->indexlist2);
-    sfree(scratch);
-}
-
 /*
  * Used for passing information about difficulty levels between the solver
  * and its callers.
@@ -1713,12 +1774,20 @@ struct difficulty {
     int diff, kdiff;
 };
 
+/*
+ * All the solver's working storage, including that of its recursive
+ * calls to itself, comes from the arena a, and is given back to it on
+ * return; so a caller that keeps one arena for a whole run of the
+ * generator doesn't hit malloc once per guess.
+ */
 static void solver(int cr, struct block_structure *blocks,
 		  struct block_structure *kblocks, bool xtype,
-		  digit *grid, digit *kgrid, struct difficulty *dlev)
+		  digit *grid, digit *kgrid, struct difficulty *dlev,
+                  arena *a)
 {
     struct solver_usage *usage;
     struct solver_scratch *scratch;
+    arena_mark mark = arena_save(a);
     int x, y, b, i, n, ret;
     int diff = DIFF_BLOCK;
     int kdiff = DIFF_KSINGLE;
@@ -1727,19 +1796,19 @@ static void solver(int cr, struct block_structure *blocks,
      * Set up a usage structure as a clean slate (everything
      * possible).
      */
-    usage = snew(struct solver_usage);
+    usage = anew(a, struct solver_usage);
     usage->cr = cr;
     usage->blocks = blocks;
     if (kblocks) {
 	usage->kblocks = dup_block_structure(kblocks);
 	usage->extra_cages = alloc_block_structure (kblocks->c, kblocks->r,
 						    cr * cr, cr, cr * cr);
-	usage->extra_clues = snewn(cr*cr, digit);
+	usage->extra_clues = anewn(a, cr*cr, digit);
     } else {
 	usage->kblocks = usage->extra_cages = NULL;
 	usage->extra_clues = NULL;
     }
-    usage->cube = snewn(cr*cr*cr, bool);
+    usage->cube = anewn(a, cr*cr*cr, bool);
     usage->grid = grid;		       /* write straight back to the input */
     if (kgrid) {
 	int nclues;
@@ -1750,7 +1819,7 @@ static void solver(int cr, struct block_structure *blocks,
 	 * Allow for expansion of the killer regions, the absolute
 	 * limit is obviously one region per square.
 	 */
-	usage->kclues = snewn(cr*cr, digit);
+	usage->kclues = anewn(a, cr*cr, digit);
 	for (i = 0; i < nclues; i++) {
 	    for (n = 0; n < kblocks->nr_squares[i]; n++)
 		if (kgrid[kblocks->blocks[i][n]] != 0)
@@ -1765,22 +1834,22 @@ static void solver(int cr, struct block_structure *blocks,
     for (i = 0; i < cr*cr*cr; i++)
         usage->cube[i] = true;
 
-    usage->row = snewn(cr * cr, bool);
-    usage->col = snewn(cr * cr, bool);
-    usage->blk = snewn(cr * cr, bool);
+    usage->row = anewn(a, cr * cr, bool);
+    usage->col = anewn(a, cr * cr, bool);
+    usage->blk = anewn(a, cr * cr, bool);
     memset(usage->row, 0, cr * cr * sizeof(bool));
     memset(usage->col, 0, cr * cr * sizeof(bool));
     memset(usage->blk, 0, cr * cr * sizeof(bool));
 
     if (xtype) {
-	usage->diag = snewn(cr * 2, bool);
+	usage->diag = anewn(a, cr * 2, bool);
 	memset(usage->diag, 0, cr * 2 * sizeof(bool));
     } else
 	usage->diag = NULL; 
 
     usage->nr_regions = cr * 3 + (xtype ? 2 : 0);
-    usage->regions = snewn(cr * usage->nr_regions, int);
-    usage->sq2region = snewn(cr * cr * 3, int *);
+    usage->regions = anewn(a, cr * usage->nr_regions, int);
+    usage->sq2region = anewn(a, cr * cr * 3, int *);
 
     for (n = 0; n < cr; n++) {
 	for (i = 0; i < cr; i++) {
@@ -1796,7 +1865,7 @@ static void solver(int cr, struct block_structure *blocks,
 	}
     }
 
-    scratch = solver_new_scratch(usage);
+    scratch = solver_new_scratch(usage, a);
 
     /*
      * Place all the clue numbers we are given.
@@ -2529,20 +2598,24 @@ static void solver(int cr, struct block_structure *blocks,
 		}
 
 	if (best != -1) {
-	    int i, j;
+	    int i, j, nfilled;
 	    digit *list, *ingrid, *outgrid;
 
 	    diff = DIFF_IMPOSSIBLE;    /* no solution found yet */
 
+	    for (nfilled = i = 0; i < cr * cr; i++)
+		if (grid[i])
+		    nfilled++;
+
 	    /*
 	     * Attempt recursion.
 	     */
 	    y = best / cr;
 	    x = best % cr;
 
-	    list = snewn(cr, digit);
-	    ingrid = snewn(cr * cr, digit);
-	    outgrid = snewn(cr * cr, digit);
+	    list = anewn(a, cr, digit);
+	    ingrid = anewn(a, cr * cr, digit);
+	    outgrid = anewn(a, cr * cr, digit);
 	    memcpy(ingrid, grid, cr * cr);
 
 	    /* Make a list of the possible digits. */
@@ -2568,6 +2641,10 @@ static void solver(int cr, struct block_structure *blocks,
 	     * main solver at every stage.
 	     */
 	    for (i = 0; i < j; i++) {
+		/* Give up if the front end has run out of patience. */
+		if (solver_progress((float)nfilled / (cr * cr)))
+		    break;
+
 		memcpy(outgrid, ingrid, cr * cr);
 		outgrid[y*cr+x] = list[i];
 
@@ -2578,7 +2655,7 @@ static void solver(int cr, struct block_structure *blocks,
 		solver_recurse_depth++;
 #endif
 
-		solver(cr, blocks, kblocks, xtype, outgrid, kgrid, dlev);
+		solver(cr, blocks, kblocks, xtype, outgrid, kgrid, dlev, a);
 
 #ifdef STANDALONE_SOLVER
 		solver_recurse_depth--;
@@ -2614,10 +2691,6 @@ static void solver(int cr, struct block_structure *blocks,
 		if (diff == DIFF_AMBIGUOUS)
 		    break;
 	    }
-
-	    sfree(outgrid);
-	    sfree(ingrid);
-	    sfree(list);
 	}
 
     } else {
@@ -2645,28 +2718,71 @@ static void solver(int cr, struct block_structure *blocks,
 	       "one solution");
 #endif
 
-    sfree(usage->sq2region);
-    sfree(usage->regions);
-    sfree(usage->cube);
-    sfree(usage->row);
-    sfree(usage->col);
-    sfree(usage->blk);
-    sfree(usage->diag);
     if (usage->kblocks) {
 	free_block_structure(usage->kblocks);
 	free_block_structure(usage->extra_cages);
-	sfree(usage->extra_clues);
     }
-    if (usage->kclues) sfree(usage->kclues);
-    sfree(usage);
 
-    solver_free_scratch(scratch);
+    arena_restore(a, mark);
 }
 
 /* ----------------------------------------------------------------------
  * End of solver code.
  */
 
+/* ----------------------------------------------------------------------
+ * Solution counting for Unreasonable puzzles.
+ *
+ * At Unreasonable difficulty, all the generator needs to know about a
+ * candidate puzzle is whether it has a unique solution. solver() would
+ * find out by guessing and rerunning its full set of deductions after
+ * every guess, which gets expensive; an exact cover search gives the
+ * same answer much faster. (solver() is still used to grade the
+ * finished puzzle.)
+ *
+ * Row y*cr*cr + x*cr + n-1 of the exact cover problem is the digit n
+ * at (x,y). Its columns say that the square is filled, and that its
+ * row, column, block and (in X mode) diagonals contain an n. Killer
+ * cages aren't an exact cover constraint, so this isn't used for
+ * Killer puzzles.
+ */
+static dlx *solo_exact_cover(int cr, struct block_structure *blocks,
+                             bool xtype)
+{
+    int area = cr*cr, ncols = (xtype ? 4*area + 2*cr : 4*area);
+    dlx *d = dlx_new(ncols, area * cr * 6);
+    int x, y, n, cols[6], ncols_row;
+
+    for (y = 0; y < cr; y++)
+        for (x = 0; x < cr; x++)
+            for (n = 0; n < cr; n++) {
+                ncols_row = 0;
+                cols[ncols_row++] = y*cr+x;
+                cols[ncols_row++] = area + y*cr+n;
+                cols[ncols_row++] = 2*area + x*cr+n;
+                cols[ncols_row++] = 3*area + blocks->whichblock[y*cr+x]*cr+n;
+                if (xtype && ondiag0(y*cr+x))
+                    cols[ncols_row++] = 4*area + n;
+                if (xtype && ondiag1(y*cr+x))
+                    cols[ncols_row++] = 4*area + cr + n;
+                dlx_add_row(d, cols, ncols_row);
+            }
+
+    return d;
+}
+
+/* Count the solutions of grid, up to a limit of 2. */
+static int solo_count_solutions(dlx *d, int cr, const digit *grid,
+                                int *given)
+{
+    int i, ngiven = 0;
+
+    for (i = 0; i < cr*cr; i++)
+        if (grid[i])
+            given[ngiven++] = i*cr + grid[i]-1;
+    return dlx_count(d, given, ngiven, 2);
+}
+
 /* ----------------------------------------------------------------------
  * Killer set generator.
  */
@@ -3656,11 +3772,13 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     struct block_structure *blocks, *kblocks;
     digit *grid, *grid2, *kgrid;
     struct xy { int x, y; } *locs;
-    int nlocs;
+    int nlocs, *given;
+    dlx *exact;
     char *desc;
     int coords[16], ncoords;
-    int x, y, i, j;
+    int x, y, i, j, attempt;
     struct difficulty dlev;
+    arena *a;
 
     precompute_sum_bits();
 
@@ -3679,6 +3797,8 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     grid = snewn(area, digit);
     locs = snewn(area, struct xy);
     grid2 = snewn(area, digit);
+    given = snewn(area, int);
+    a = arena_new();                   /* for every solver() call below */
 
     blocks = alloc_block_structure (c, r, area, cr, cr);
 
@@ -3694,7 +3814,10 @@ static char *new_game_desc(const game_params *params, random_state *rs,
      * nasty, but it seems to be unpleasantly hard to generate
      * difficult grids otherwise.
      */
-    while (1) {
+    for (attempt = 0;; attempt++) {
+        generation_progress(generation_retry_progress(attempt, 0.0F));
+        generation_phase("grid");
+
         /*
          * Generate a random solved state, starting by
          * constructing the block structure.
@@ -3720,6 +3843,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
         if (!gridgen(cr, blocks, kblocks, params->xtype, grid, rs, area*area))
 	    continue;
         assert(check_valid(cr, blocks, kblocks, NULL, params->xtype, grid));
+        generation_progress(generation_retry_progress(attempt, 0.25F));
 
 	/*
 	 * Save the solved grid in aux.
@@ -3749,13 +3873,14 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 	    struct block_structure *last_cages = NULL;
 	    int ntries = 0;
 
+            generation_phase("solve");
             memcpy(grid2, grid, area);
 
 	    for (;;) {
 		compute_kclues(kblocks, kgrid, grid2, area);
 
 		memset(grid, 0, area * sizeof *grid);
-		solver(cr, blocks, kblocks, params->xtype, grid, kgrid, &dlev);
+		solver(cr, blocks, kblocks, params->xtype, grid, kgrid, &dlev, a);
 		if (dlev.diff == dlev.maxdiff && dlev.kdiff == dlev.maxkdiff) {
 		    /*
 		     * We have one that matches our difficulty.  Store it for
@@ -3812,6 +3937,8 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 	    continue;
 	}
 
+        generation_phase("solve");
+
         /*
          * Find the set of equivalence classes of squares permitted
          * by the selected symmetry. We do this by enumerating all
@@ -3843,35 +3970,54 @@ static char *new_game_desc(const game_params *params, random_state *rs,
         /*
          * Now loop over the shuffled list and, for each element,
          * see whether removing that element (and its reflections)
-         * from the grid will still leave the grid soluble.
+         * from the grid will still leave the grid soluble. At
+         * Unreasonable, that just means uniquely soluble, which is
+         * quicker to check by counting solutions.
          */
+        exact = (dlev.maxdiff == DIFF_RECURSIVE && !params->killer ?
+                 solo_exact_cover(cr, blocks, params->xtype) : NULL);
         for (i = 0; i < nlocs; i++) {
             x = locs[i].x;
             y = locs[i].y;
 
+            generation_progress(generation_retry_progress(
+                attempt, 0.25F + 0.75F * i / nlocs));
+
             memcpy(grid2, grid, area);
             ncoords = symmetries(params, x, y, coords, params->symm);
             for (j = 0; j < ncoords; j++)
                 grid2[coords[2*j+1]*cr+coords[2*j]] = 0;
 
-            solver(cr, blocks, kblocks, params->xtype, grid2, kgrid, &dlev);
+            if (exact) {
+                if (solo_count_solutions(exact, cr, grid2, given) == 1)
+                    for (j = 0; j < ncoords; j++)
+                        grid[coords[2*j+1]*cr+coords[2*j]] = 0;
+                continue;
+            }
+
+            solver(cr, blocks, kblocks, params->xtype, grid2, kgrid, &dlev, a);
             if (dlev.diff <= dlev.maxdiff &&
 		(!params->killer || dlev.kdiff <= dlev.maxkdiff)) {
                 for (j = 0; j < ncoords; j++)
                     grid[coords[2*j+1]*cr+coords[2*j]] = 0;
             }
         }
+        if (exact)
+            dlx_free(exact);
 
+        generation_phase("grade");
         memcpy(grid2, grid, area);
 
-	solver(cr, blocks, kblocks, params->xtype, grid2, kgrid, &dlev);
+	solver(cr, blocks, kblocks, params->xtype, grid2, kgrid, &dlev, a);
 	if (dlev.diff == dlev.maxdiff &&
 	    (!params->killer || dlev.kdiff == dlev.maxkdiff))
 	    break;		       /* found one! */
     }
 
     sfree(grid2);
+    sfree(given);
     sfree(locs);
+    arena_free(a);
 
     /*
      * Now we have the grid as it will be presented to the user.
@@ -4145,6 +4291,7 @@ static game_state *new_game(midend *me, const game_params *params,
 {
     game_state *state = snew(game_state);
     int c = params->c, r = params->r, cr = c*r, area = cr * cr;
+    digit *grid;
     int i;
 
     precompute_sum_bits();
@@ -4153,11 +4300,9 @@ static game_state *new_game(midend *me, const game_params *params,
     state->xtype = params->xtype;
     state->killer = params->killer;
 
-    state->grid = snewn(area, digit);
-    state->pencil = snewn(area * cr, bool);
-    memset(state->pencil, 0, area * cr * sizeof(bool));
-    state->immutable = snewn(area, bool);
-    memset(state->immutable, 0, area * sizeof(bool));
+    grid = snewn(area, digit);
+    state->pencil = cow_new(area * cr, sizeof(bool));
+    state->immutable = cow_new(area, sizeof(bool));
 
     state->blocks = alloc_block_structure (c, r, area, cr, cr);
 
@@ -4170,10 +4315,13 @@ static game_state *new_game(midend *me, const game_params *params,
     }
     state->completed = state->cheated = false;
 
-    desc = spec_to_grid(desc, state->grid, area);
+    desc = spec_to_grid(desc, grid, area);
+    state->grid = cow_new(area, sizeof(digit));
+    cow_write_all(state->grid, grid);
     for (i = 0; i < area; i++)
-	if (state->grid[i] != 0)
-	    state->immutable[i] = true;
+	if (grid[i] != 0)
+	    COW_PUT(bool, state->immutable, i) = true;
+    sfree(grid);
 
     if (r == 1) {
 	const char *err;
@@ -4259,8 +4407,7 @@ static game_state *dup_game(const game_state *state)
     if (ret->kblocks)
 	ret->kblocks->refcount++;
 
-    ret->grid = snewn(area, digit);
-    memcpy(ret->grid, state->grid, area);
+    ret->grid = cow_dup(state->grid);
 
     if (state->killer) {
 	ret->kgrid = snewn(area, digit);
@@ -4268,11 +4415,8 @@ static game_state *dup_game(const game_state *state)
     } else
 	ret->kgrid = NULL;
 
-    ret->pencil = snewn(area * cr, bool);
-    memcpy(ret->pencil, state->pencil, area * cr * sizeof(bool));
-
-    ret->immutable = snewn(area, bool);
-    memcpy(ret->immutable, state->immutable, area * sizeof(bool));
+    ret->pencil = cow_dup(state->pencil);
+    ret->immutable = cow_dup(state->immutable);
 
     ret->completed = state->completed;
     ret->cheated = state->cheated;
@@ -4286,9 +4430,9 @@ static void free_game(game_state *state)
     if (state->kblocks)
 	free_block_structure(state->kblocks);
 
-    sfree(state->immutable);
-    sfree(state->pencil);
-    sfree(state->grid);
+    cow_free(state->immutable);
+    cow_free(state->pencil);
+    cow_free(state->grid);
     if (state->kgrid) sfree(state->kgrid);
     sfree(state);
 }
@@ -4300,6 +4444,7 @@ static char *solve_game(const game_state *state, const game_state *currstate,
     char *ret;
     digit *grid;
     struct difficulty dlev;
+    arena *a;
 
     /*
      * If we already have the solution in ai, save ourselves some
@@ -4308,12 +4453,13 @@ static char *solve_game(const game_state *state, const game_state *currstate,
     if (ai)
         return dupstr(ai);
 
-    grid = snewn(cr*cr, digit);
-    memcpy(grid, state->grid, cr*cr);
+    grid = flat_grid(state);
     dlev.maxdiff = DIFF_RECURSIVE;
     dlev.maxkdiff = DIFF_KINTERSECT;
+    a = arena_new();
     solver(cr, state->blocks, state->kblocks, state->xtype, grid,
-	   state->kgrid, &dlev);
+	   state->kgrid, &dlev, a);
+    arena_free(a);
 
     *error = NULL;
 
@@ -4334,6 +4480,45 @@ static char *solve_game(const game_state *state, const game_state *currstate,
     return ret;
 }
 
+static char *grade_game(const game_state *state, const char **error)
+{
+    /* Named as in game_configure, and the killer levels as by -g */
+    static const char *const diffnames[] = {
+        "Trivial", "Basic", "Intermediate", "Advanced", "Extreme",
+        "Unreasonable"
+    };
+    static const char *const kdiffnames[] = {
+        "Trivial", "Simple", "Intermediate", "Advanced"
+    };
+    struct difficulty dlev;
+    digit *grid;
+    arena *a;
+    char *ret;
+
+    grid = flat_grid(state);
+    dlev.maxdiff = DIFF_RECURSIVE;
+    dlev.maxkdiff = DIFF_KINTERSECT;
+    a = arena_new();
+    solver(state->cr, state->blocks, state->kblocks, state->xtype, grid,
+           state->kgrid, &dlev, a);
+    arena_free(a);
+    sfree(grid);
+
+    if (dlev.diff == DIFF_IMPOSSIBLE) {
+        *error = "No solution exists for this puzzle";
+        return NULL;
+    } else if (dlev.diff == DIFF_AMBIGUOUS) {
+        *error = "Multiple solutions exist for this puzzle";
+        return NULL;
+    }
+    if (!state->kblocks)
+        return dupstr(diffnames[dlev.diff]);
+    ret = snewn(80, char);
+    sprintf(ret, "%s, Killer %s", diffnames[dlev.diff],
+            kdiffnames[dlev.kdiff]);
+    return ret;
+}
+
 static char *grid_text_format(int cr, struct block_structure *blocks,
 			      bool xtype, digit *grid)
 {
@@ -4536,9 +4721,13 @@ static bool game_can_format_as_text_now(const game_params *params)
 
 static char *game_text_format(const game_state *state)
 {
+    digit *grid = flat_grid(state);
+    char *ret;
+
     assert(!state->kblocks);
-    return grid_text_format(state->cr, state->blocks, state->xtype,
-			    state->grid);
+    ret = grid_text_format(state->cr, state->blocks, state->xtype, grid);
+    sfree(grid);
+    return ret;
 }
 
 struct game_ui {
@@ -4631,7 +4820,7 @@ static void game_changed_state(game_ui *ui, const game_state *oldstate,
      * by Redo, or by Solve), then we cancel the highlight.
      */
     if (ui->hshow && ui->hpencil && !ui->hcursor &&
-        newstate->grid[ui->hy * cr + ui->hx] != 0) {
+        GRID(newstate, ui->hy * cr + ui->hx) != 0) {
         ui->hshow = false;
     }
 }
@@ -4670,7 +4859,7 @@ static char *interpret_move(const game_state *state, game_ui *ui,
 
     if (tx >= 0 && tx < cr && ty >= 0 && ty < cr) {
         if (button == LEFT_BUTTON) {
-            if (state->immutable[ty*cr+tx]) {
+            if (IMMUTABLE(state, ty*cr+tx)) {
                 ui->hshow = false;
             } else if (tx == ui->hx && ty == ui->hy &&
                        ui->hshow && !ui->hpencil) {
@@ -4688,7 +4877,7 @@ static char *interpret_move(const game_state *state, game_ui *ui,
             /*
              * Pencil-mode highlighting for non filled squares.
              */
-            if (state->grid[ty*cr+tx] == 0) {
+            if (GRID(state, ty*cr+tx) == 0) {
                 if (tx == ui->hx && ty == ui->hy &&
                     ui->hshow && ui->hpencil) {
                     ui->hshow = false;
@@ -4734,26 +4923,26 @@ static char *interpret_move(const game_state *state, game_ui *ui,
          * Can't overwrite this square. This can only happen here
          * if we're using the cursor keys.
          */
-	if (state->immutable[ui->hy*cr+ui->hx])
+	if (IMMUTABLE(state, ui->hy*cr+ui->hx))
 	    return NULL;
 
         /*
          * Can't make pencil marks in a filled square. Again, this
          * can only become highlighted if we're using cursor keys.
          */
-        if (ui->hpencil && state->grid[ui->hy*cr+ui->hx])
+        if (ui->hpencil && GRID(state, ui->hy*cr+ui->hx))
             return NULL;
 
         /*
          * If you ask to fill a square with what it already contains,
          * or blank it when it's already empty, that has no effect...
          */
-        if ((!ui->hpencil || n == 0) && state->grid[ui->hy*cr+ui->hx] == n) {
+        if ((!ui->hpencil || n == 0) && GRID(state, ui->hy*cr+ui->hx) == n) {
             bool anypencil = false;
             int i;
             for (i = 0; i < cr; i++)
                 anypencil = anypencil ||
-                    state->pencil[(ui->hy*cr+ui->hx) * cr + i];
+                    PENCIL(state, (ui->hy*cr+ui->hx) * cr + i);
             if (!anypencil) {
                 /* ... expect to remove the cursor in mouse mode. */
                 if (!ui->hcursor) {
@@ -4799,13 +4988,16 @@ static game_state *execute_move(const game_state *from, const char *move)
 
 	p = move+1;
 	for (n = 0; n < cr*cr; n++) {
-	    ret->grid[n] = atoi(p);
+	    int d = atoi(p);
 
-	    if (!*p || ret->grid[n] < 1 || ret->grid[n] > cr) {
+	    if (!*p || d < 1 || d > cr) {
 		free_game(ret);
 		return NULL;
 	    }
 
+	    if (GRID(ret, n) != d)
+		COW_PUT(digit, ret->grid, n) = d;
+
 	    while (*p && isdigit((unsigned char)*p)) p++;
 	    if (*p == ',') p++;
 	}
@@ -4818,19 +5010,25 @@ static game_state *execute_move(const game_state *from, const char *move)
 	ret = dup_game(from);
         if (move[0] == 'P' && n > 0) {
             int index = (y*cr+x) * cr + (n-1);
-            ret->pencil[index] = !ret->pencil[index];
+            COW_PUT(bool, ret->pencil, index) ^= true;
         } else {
-            ret->grid[y*cr+x] = n;
-            memset(ret->pencil + (y*cr+x)*cr, 0, cr);
+            int i;
+
+            COW_PUT(digit, ret->grid, y*cr+x) = n;
+            for (i = 0; i < cr; i++)
+                if (PENCIL(ret, (y*cr+x)*cr + i))
+                    COW_PUT(bool, ret->pencil, (y*cr+x)*cr + i) = false;
 
             /*
              * We've made a real change to the grid. Check to see
              * if the game has been completed.
              */
-            if (!ret->completed && check_valid(
-                    cr, ret->blocks, ret->kblocks, ret->kgrid,
-                    ret->xtype, ret->grid)) {
-                ret->completed = true;
+            if (!ret->completed) {
+                digit *grid = flat_grid(ret);
+                if (check_valid(cr, ret->blocks, ret->kblocks, ret->kgrid,
+                                ret->xtype, grid))
+                    ret->completed = true;
+                sfree(grid);
             }
         }
 	return ret;
@@ -4843,10 +5041,10 @@ static game_state *execute_move(const game_state *from, const char *move)
 	ret = dup_game(from);
         for (y = 0; y < cr; y++) {
             for (x = 0; x < cr; x++) {
-                if (!ret->grid[y*cr+x]) {
+                if (!GRID(ret, y*cr+x)) {
                     int i;
                     for (i = 0; i < cr; i++)
-                        ret->pencil[(y*cr+x)*cr + i] = true;
+                        COW_PUT(bool, ret->pencil, (y*cr+x)*cr + i) = true;
                 }
             }
         }
@@ -4965,11 +5163,15 @@ static void draw_number(drawing *dr, game_drawstate *ds,
     int cx, cy, cw, ch;
     int col_killer = (hl & 32 ? COL_ERROR : COL_KILLER);
     char str[20];
+    int i;
 
-    if (ds->grid[y*cr+x] == state->grid[y*cr+x] &&
-        ds->hl[y*cr+x] == hl &&
-        !memcmp(ds->pencil+(y*cr+x)*cr, state->pencil+(y*cr+x)*cr, cr))
-	return;			       /* no change required */
+    if (ds->grid[y*cr+x] == GRID(state, y*cr+x) && ds->hl[y*cr+x] == hl) {
+        for (i = 0; i < cr; i++)
+            if (ds->pencil[(y*cr+x)*cr+i] != PENCIL(state, (y*cr+x)*cr+i))
+                break;
+        if (i == cr)
+            return;                    /* no change required */
+    }
 
     tx = BORDER + x * TILE_SIZE + 1 + GRIDEXTRA;
     ty = BORDER + y * TILE_SIZE + 1 + GRIDEXTRA;
@@ -5113,14 +5315,14 @@ static void draw_number(drawing *dr, game_drawstate *ds,
     }
 
     /* new number needs drawing? */
-    if (state->grid[y*cr+x]) {
+    if (GRID(state, y*cr+x)) {
 	str[1] = '\0';
-	str[0] = state->grid[y*cr+x] + '0';
+	str[0] = GRID(state, y*cr+x) + '0';
 	if (str[0] > '9')
 	    str[0] += 'a' - ('9'+1);
 	draw_text(dr, tx + TILE_SIZE/2, ty + TILE_SIZE/2,
 		  FONT_VARIABLE, TILE_SIZE/2, ALIGN_VCENTRE | ALIGN_HCENTRE,
-		  state->immutable[y*cr+x] ? COL_CLUE : (hl & 16) ? COL_ERROR : COL_USER, str);
+		  IMMUTABLE(state, y*cr+x) ? COL_CLUE : (hl & 16) ? COL_ERROR : COL_USER, str);
     } else {
         int i, j, npencil;
 	int pl, pr, pt, pb;
@@ -5129,7 +5331,7 @@ static void draw_number(drawing *dr, game_drawstate *ds,
 
         /* Count the pencil marks required. */
         for (i = npencil = 0; i < cr; i++)
-            if (state->pencil[(y*cr+x)*cr+i])
+            if (PENCIL(state, (y*cr+x)*cr+i))
 		npencil++;
 	if (npencil) {
 
@@ -5216,7 +5418,7 @@ static void draw_number(drawing *dr, game_drawstate *ds,
 	     * Now actually draw the pencil marks.
 	     */
 	    for (i = j = 0; i < cr; i++)
-		if (state->pencil[(y*cr+x)*cr+i]) {
+		if (PENCIL(state, (y*cr+x)*cr+i)) {
 		    int dx = j % pw, dy = j / pw;
 
 		    str[1] = '\0';
@@ -5236,8 +5438,9 @@ static void draw_number(drawing *dr, game_drawstate *ds,
 
     draw_update(dr, cx, cy, cw, ch);
 
-    ds->grid[y*cr+x] = state->grid[y*cr+x];
-    memcpy(ds->pencil+(y*cr+x)*cr, state->pencil+(y*cr+x)*cr, cr);
+    ds->grid[y*cr+x] = GRID(state, y*cr+x);
+    for (i = 0; i < cr; i++)
+        ds->pencil[(y*cr+x)*cr+i] = PENCIL(state, (y*cr+x)*cr+i);
     ds->hl[y*cr+x] = hl;
 }
 
@@ -5247,6 +5450,7 @@ static void game_redraw(drawing *dr, game_drawstate *ds,
                         float animtime, float flashtime)
 {
     int cr = state->cr;
+    digit *grid = state->kblocks ? flat_grid(state) : NULL;
     int x, y;
 
     if (!ds->started) {
@@ -5268,7 +5472,7 @@ static void game_redraw(drawing *dr, game_drawstate *ds,
 	ds->entered_items[x] = 0;
     for (x = 0; x < cr; x++)
 	for (y = 0; y < cr; y++) {
-	    digit d = state->grid[y*cr+x];
+	    digit d = GRID(state, y*cr+x);
 	    if (d) {
 		int box, kbox;
 
@@ -5304,7 +5508,7 @@ static void game_redraw(drawing *dr, game_drawstate *ds,
     for (x = 0; x < cr; x++) {
 	for (y = 0; y < cr; y++) {
             int highlight = 0;
-            digit d = state->grid[y*cr+x];
+            digit d = GRID(state, y*cr+x);
 
             if (flashtime > 0 &&
                 (flashtime <= FLASH_TIME/3 ||
@@ -5332,7 +5536,7 @@ static void game_redraw(drawing *dr, game_drawstate *ds,
 
 	    if (d && state->kblocks) {
                 if (check_killer_cage_sum(
-                        state->kblocks, state->kgrid, state->grid,
+                        state->kblocks, state->kgrid, grid,
                         state->kblocks->whichblock[y*cr+x]) == 0)
                     highlight |= 32;
 	    }
@@ -5340,6 +5544,7 @@ static void game_redraw(drawing *dr, game_drawstate *ds,
 	    draw_number(dr, ds, state, x, y, highlight);
 	}
     }
+    sfree(grid);
 
     /*
      * Update the _entire_ grid if necessary.
@@ -5649,10 +5854,10 @@ static void game_print(drawing *dr, const game_state *state, const game_ui *ui,
      */
     for (y = 0; y < cr; y++)
 	for (x = 0; x < cr; x++)
-	    if (state->grid[y*cr+x]) {
+	    if (GRID(state, y*cr+x)) {
 		char str[2];
 		str[1] = '\0';
-		str[0] = state->grid[y*cr+x] + '0';
+		str[0] = GRID(state, y*cr+x) + '0';
 		if (str[0] > '9')
 		    str[0] += 'a' - ('9'+1);
 		draw_text(dr, BORDER + x*TILE_SIZE + TILE_SIZE/2,
@@ -5682,7 +5887,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    NULL, /* solve_step */
+    grade_game,
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     get_prefs, set_prefs,
     new_ui,
@@ -5706,7 +5915,7 @@ const struct game thegame = {
     true, false, game_print_size, game_print,
     false,			       /* wants_statusbar */
     false, NULL,                       /* timing_state */
-    REQUIRE_RBUTTON | REQUIRE_NUMPAD,  /* flags */
+    REQUIRE_RBUTTON | REQUIRE_NUMPAD | SOLVE_FROM_ORIG,  /* flags */
 };
 
 #ifdef STANDALONE_SOLVER
@@ -5719,6 +5928,8 @@ int main(int argc, char **argv)
     const char *err;
     bool grade = false;
     struct difficulty dlev;
+    digit *grid;
+    arena *a;
 
     while (--argc > 0) {
         char *p = *++argv;
@@ -5757,7 +5968,10 @@ int main(int argc, char **argv)
 
     dlev.maxdiff = DIFF_RECURSIVE;
     dlev.maxkdiff = DIFF_KINTERSECT;
-    solver(s->cr, s->blocks, s->kblocks, s->xtype, s->grid, s->kgrid, &dlev);
+    grid = flat_grid(s);
+    a = arena_new();
+    solver(s->cr, s->blocks, s->kblocks, s->xtype, grid, s->kgrid, &dlev, a);
+    arena_free(a);
     if (grade) {
 	printf("Difficulty rating: %s\n",
 	       dlev.diff==DIFF_BLOCK ? "Trivial (blockwise positional elimination only)":
@@ -5777,7 +5991,7 @@ int main(int argc, char **argv)
 		   dlev.kdiff==DIFF_KINTERSECT ? "Advanced (sum region intersections)":
 		   "INTERNAL ERROR: unrecognised difficulty code");
     } else {
-        printf("%s\n", grid_text_format(s->cr, s->blocks, s->xtype, s->grid));
+        printf("%s\n", grid_text_format(s->cr, s->blocks, s->xtype, grid));
     }
 
     return 0;
@@ -1,11 +1,20 @@
 /*
- * Implement arraysort() defined in puzzles.h.
+ * Implement arraysort() and the integer sorting helpers defined in
+ * puzzles.h.
  *
- * Strategy: heapsort.
+ * Strategy for arraysort: introsort. That is, quicksort with a
+ * median-of-three pivot (a median of three medians on big
+ * partitions), falling back to heapsort on any partition where the
+ * recursion has gone suspiciously deep, and finishing off small
+ * partitions with insertion sort.
+ *
+ * Strategy for the integer sorts: LSD radix sort, a byte at a time,
+ * skipping any byte position on which all the keys agree.
  */
 
 #include <stddef.h>
 #include <string.h>
+#include <limits.h>
 
 #include "puzzles.h"
 
@@ -17,6 +26,12 @@
 #define RCHILD(i) (2*(i)+2)
 #define PARENT(i) (((i)-1)/2)
 
+/* Partitions this small or smaller are left for insertion sort. */
+#define INSERTION_THRESHOLD 12
+
+/* Partitions bigger than this choose a pivot out of nine elements. */
+#define NINTHER_THRESHOLD 128
+
 static void downheap(void *array, size_t nmemb, size_t size,
                      arraysort_cmpfn_t cmp, void *ctx, size_t i)
 {
@@ -37,8 +52,8 @@ static void downheap(void *array, size_t nmemb, size_t size,
     }
 }
 
-void arraysort_fn(void *array, size_t nmemb, size_t size,
-                  arraysort_cmpfn_t cmp, void *ctx)
+static void heap_sort(void *array, size_t nmemb, size_t size,
+                      arraysort_cmpfn_t cmp, void *ctx)
 {
     size_t i;
 
@@ -69,3 +84,220 @@ void arraysort_fn(void *array, size_t nmemb, size_t size,
         downheap(array, i, size, cmp, ctx, 0);
     }
 }
+
+static void insertion_sort(void *array, size_t nmemb, size_t size,
+                           arraysort_cmpfn_t cmp, void *ctx)
+{
+    size_t i, j;
+
+    for (i = 1; i < nmemb; i++)
+        for (j = i; j > 0 && CMP(j-1, j) > 0; j--)
+            SWAP(j-1, j);
+}
+
+/* Return whichever of the elements at a, b, c has the middle value. */
+static size_t median3(void *array, size_t size, arraysort_cmpfn_t cmp,
+                      void *ctx, size_t a, size_t b, size_t c)
+{
+    if (CMP(a, b) < 0) {
+        if (CMP(b, c) < 0)
+            return b;
+        return CMP(a, c) < 0 ? c : a;
+    } else {
+        if (CMP(a, c) < 0)
+            return a;
+        return CMP(b, c) < 0 ? c : b;
+    }
+}
+
+static void intro_sort(void *array, size_t nmemb, size_t size,
+                       arraysort_cmpfn_t cmp, void *ctx, int depth)
+{
+    while (nmemb > INSERTION_THRESHOLD) {
+        size_t mid = nmemb / 2, last = nmemb - 1, pivot, i, j;
+
+        if (depth-- == 0) {
+            /*
+             * Too many lopsided partitions: the input is
+             * adversarial for our pivot choice, so stop trying and
+             * guarantee n log n.
+             */
+            heap_sort(array, nmemb, size, cmp, ctx);
+            return;
+        }
+
+        if (nmemb > NINTHER_THRESHOLD) {
+            size_t s = nmemb / 8;
+            pivot = median3(array, size, cmp, ctx,
+                            median3(array, size, cmp, ctx, 0, s, 2*s),
+                            median3(array, size, cmp, ctx,
+                                    mid-s, mid, mid+s),
+                            median3(array, size, cmp, ctx,
+                                    last-2*s, last-s, last));
+        } else {
+            pivot = median3(array, size, cmp, ctx, 0, mid, last);
+        }
+
+        /*
+         * Hoare partition, with the pivot parked at index 0. Both
+         * scans stop on elements equal to the pivot, so that runs of
+         * equal elements still split down the middle.
+         */
+        SWAP(0, pivot);
+        i = 0;
+        j = nmemb;
+        while (1) {
+            do i++; while (i < nmemb && CMP(i, 0) < 0);
+            do j--; while (CMP(j, 0) > 0);
+            if (i >= j)
+                break;
+            SWAP(i, j);
+        }
+        SWAP(0, j);
+
+        /*
+         * Now everything before j is <= the pivot and everything
+         * after it is >= it. Recurse into the smaller side and loop
+         * on the larger, to bound the stack depth.
+         */
+        if (j < nmemb - 1 - j) {
+            intro_sort(array, j, size, cmp, ctx, depth);
+            array = PTR(j+1);
+            nmemb -= j+1;
+        } else {
+            intro_sort(PTR(j+1), nmemb - 1 - j, size, cmp, ctx, depth);
+            nmemb = j;
+        }
+    }
+
+    insertion_sort(array, nmemb, size, cmp, ctx);
+}
+
+void arraysort_fn(void *array, size_t nmemb, size_t size,
+                  arraysort_cmpfn_t cmp, void *ctx)
+{
+    size_t n;
+    int depth;
+
+    if (nmemb < 2)
+        return;                        /* trivial */
+
+    /* Allow about twice the recursion depth a balanced sort needs. */
+    for (depth = 0, n = nmemb; n > 1; n >>= 1)
+        depth += 2;
+
+    intro_sort(array, nmemb, size, cmp, ctx, depth);
+}
+
+/*
+ * Radix sort of the array vals, carrying the array items along with
+ * it if it's non-NULL. Both arrays are sorted in place, using
+ * scratch space of the same size. Stable, so usable for sorting by
+ * key.
+ */
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_THRESHOLD 64
+
+static void radixsort(unsigned *vals, int *items, size_t nmemb)
+{
+    unsigned *vtmp, *vsrc, *vdst;
+    int *itmp = NULL, *isrc, *idst;
+    size_t counts[RADIX_BUCKETS];
+    unsigned shift;
+    size_t i;
+
+    vtmp = snewn(nmemb, unsigned);
+    if (items)
+        itmp = snewn(nmemb, int);
+    vsrc = vals; vdst = vtmp;
+    isrc = items; idst = itmp;
+
+    for (shift = 0; shift < CHAR_BIT * sizeof(unsigned);
+         shift += RADIX_BITS) {
+        size_t total;
+        unsigned b;
+
+        memset(counts, 0, sizeof(counts));
+        for (i = 0; i < nmemb; i++)
+            counts[(vsrc[i] >> shift) & (RADIX_BUCKETS-1)]++;
+        if (counts[(vsrc[0] >> shift) & (RADIX_BUCKETS-1)] == nmemb)
+            continue;              /* every key has the same byte here */
+
+        for (b = 0, total = 0; b < RADIX_BUCKETS; b++) {
+            size_t c = counts[b];
+            counts[b] = total;
+            total += c;
+        }
+        for (i = 0; i < nmemb; i++) {
+            size_t pos = counts[(vsrc[i] >> shift) & (RADIX_BUCKETS-1)]++;
+            vdst[pos] = vsrc[i];
+            if (items)
+                idst[pos] = isrc[i];
+        }
+
+        { unsigned *vt = vsrc; vsrc = vdst; vdst = vt; }
+        { int *it = isrc; isrc = idst; idst = it; }
+    }
+
+    if (vsrc != vals) {
+        memcpy(vals, vsrc, nmemb * sizeof(*vals));
+        if (items)
+            memcpy(items, isrc, nmemb * sizeof(*items));
+    }
+
+    sfree(vtmp);
+    sfree(itmp);
+}
+
+/*
+ * Map an int to an unsigned in an order-preserving way, by flipping
+ * the sign bit.
+ */
+#define INT_TO_ORDERED(x) ((unsigned)(x) ^ ((unsigned)INT_MAX + 1U))
+
+void sort_integers(int *array, size_t nmemb)
+{
+    unsigned *vals;
+    size_t i, j;
+
+    if (nmemb < RADIX_THRESHOLD) {
+        for (i = 1; i < nmemb; i++) {
+            int x = array[i];
+            for (j = i; j > 0 && array[j-1] > x; j--)
+                array[j] = array[j-1];
+            array[j] = x;
+        }
+        return;
+    }
+
+    vals = snewn(nmemb, unsigned);
+    for (i = 0; i < nmemb; i++)
+        vals[i] = INT_TO_ORDERED(array[i]);
+    radixsort(vals, NULL, nmemb);
+    for (i = 0; i < nmemb; i++)
+        array[i] = (int)(vals[i] ^ ((unsigned)INT_MAX + 1U));
+    sfree(vals);
+}
+
+void sort_by_int_key(int *array, size_t nmemb, const int *keys)
+{
+    unsigned *vals;
+    size_t i, j;
+
+    if (nmemb < RADIX_THRESHOLD) {
+        for (i = 1; i < nmemb; i++) {
+            int x = array[i];
+            for (j = i; j > 0 && keys[array[j-1]] > keys[x]; j--)
+                array[j] = array[j-1];
+            array[j] = x;
+        }
+        return;
+    }
+
+    vals = snewn(nmemb, unsigned);
+    for (i = 0; i < nmemb; i++)
+        vals[i] = INT_TO_ORDERED(keys[array[i]]);
+    radixsort(vals, array, nmemb);
+    sfree(vals);
+}
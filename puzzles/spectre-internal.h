@@ -189,6 +189,33 @@ static inline Point point_rot(int s)
     return r;
 }
 
+/*
+ * Rotate a Point by s steps around the origin. Equivalent to
+ * point_mul(x, point_rot(s)), but much cheaper, since it only has to
+ * shuffle coefficients around rather than do a general
+ * multiplication.
+ */
+static inline Point point_rotate(Point x, int s)
+{
+    size_t i;
+
+    s = s % 12;
+    if (s < 0)
+        s += 12;
+
+    /* d^6 = -1, so a half turn is just negation */
+    if (s >= 6) {
+        for (i = 0; i < 4; i++)
+            x.coeffs[i] = -x.coeffs[i];
+        s -= 6;
+    }
+
+    while (s-- > 0)
+        x = point_mul_by_d(x);
+
+    return x;
+}
+
 /*
  * SpectreContext is the shared context of a whole run of the
  * algorithm. Its 'prototype' SpectreCoords object represents the
@@ -14,7 +14,6 @@
 #include <string.h>
 
 #include "puzzles.h"
-#include "tree234.h"
 
 #include "spectre-internal.h"
 
@@ -140,8 +139,7 @@ void spectre_place(Spectre *spec, Point u, Point v, int index_of_u)
     for (i = 0; i < 14; i++) {
         spec->vertices[(i + index_of_u) % 14] = u;
         u = point_add(u, disp);
-        disp = point_mul(disp, point_rot(
-                             spectre_angles[(i + 1 + index_of_u) % 14]));
+        disp = point_rotate(disp, spectre_angles[(i + 1 + index_of_u) % 14]);
     }
 }
 
@@ -153,38 +151,72 @@ Spectre *spectre_initial(SpectreContext *ctx)
     return spec;
 }
 
-Spectre *spectre_adjacent(SpectreContext *ctx, const Spectre *src_spec,
-                          unsigned src_edge, unsigned *dst_edge_out)
+/*
+ * Copy all the coordinate data from one SpectreCoords into another
+ * existing one, reusing its storage.
+ */
+static void spectre_coords_copy_into(SpectreCoords *sc_out,
+                                     const SpectreCoords *sc_in)
+{
+    spectre_coords_make_space(sc_out, sc_in->nc);
+    memcpy(sc_out->c, sc_in->c, sc_in->nc * sizeof(*sc_out->c));
+    sc_out->nc = sc_in->nc;
+    sc_out->index = sc_in->index;
+    sc_out->hex_colour = sc_in->hex_colour;
+    sc_out->prev_hex_colour = sc_in->prev_hex_colour;
+    sc_out->incoming_hex_edge = sc_in->incoming_hex_edge;
+}
+
+/*
+ * Fill in dst_spec (which must already have an 'sc' of its own) with
+ * the Spectre adjacent to src_spec along the given edge.
+ */
+static void spectre_adjacent_into(
+    SpectreContext *ctx, const Spectre *src_spec, unsigned src_edge,
+    Spectre *dst_spec, unsigned *dst_edge_out)
 {
     unsigned dst_edge;
-    Spectre *dst_spec = snew(Spectre);
-    dst_spec->sc = spectre_coords_copy(src_spec->sc);
+    spectre_coords_copy_into(dst_spec->sc, src_spec->sc);
     spectrectx_step(ctx, dst_spec->sc, src_edge, &dst_edge);
     spectre_place(dst_spec, src_spec->vertices[(src_edge+1) % 14],
                   src_spec->vertices[src_edge], dst_edge);
     if (dst_edge_out)
         *dst_edge_out = dst_edge;
+}
+
+Spectre *spectre_adjacent(SpectreContext *ctx, const Spectre *src_spec,
+                          unsigned src_edge, unsigned *dst_edge_out)
+{
+    Spectre *dst_spec = snew(Spectre);
+    dst_spec->sc = spectre_coords_new();
+    spectre_adjacent_into(ctx, src_spec, src_edge, dst_spec, dst_edge_out);
     return dst_spec;
 }
 
-static int spectre_cmp(void *av, void *bv)
+/* We should only ever need to compare the first two vertices of any
+ * Spectre, because those force the rest */
+static unsigned long spectre_hash(const void *av)
 {
-    Spectre *a = (Spectre *)av, *b = (Spectre *)bv;
+    const Spectre *a = (const Spectre *)av;
+    int coeffs[8];
     size_t i, j;
 
-    /* We should only ever need to compare the first two vertices of
-     * any Spectre, because those force the rest */
-    for (i = 0; i < 2; i++) {
-        for (j = 0; j < 4; j++) {
-            int ac = a->vertices[i].coeffs[j], bc = b->vertices[i].coeffs[j];
-            if (ac < bc)
-                return -1;
-            if (ac > bc)
-                return +1;
-        }
-    }
+    for (i = 0; i < 2; i++)
+        for (j = 0; j < 4; j++)
+            coeffs[4*i+j] = a->vertices[i].coeffs[j];
+    return hash_ints(coeffs, 8);
+}
 
-    return 0;
+static bool spectre_eq(const void *av, const void *bv)
+{
+    const Spectre *a = (const Spectre *)av, *b = (const Spectre *)bv;
+    size_t i, j;
+
+    for (i = 0; i < 2; i++)
+        for (j = 0; j < 4; j++)
+            if (a->vertices[i].coeffs[j] != b->vertices[i].coeffs[j])
+                return false;
+    return true;
 }
 
 void spectre_free(Spectre *spec)
@@ -435,13 +467,13 @@ void spectrectx_generate(SpectreContext *ctx,
                          bool (*callback)(void *cbctx, const Spectre *spec),
                          void *cbctx)
 {
-    tree234 *placed = newtree234(spectre_cmp);
-    Spectre *qhead = NULL, *qtail = NULL;
+    hashset *placed = hashset_new(spectre_hash, spectre_eq);
+    Spectre *qhead = NULL, *qtail = NULL, *new_spec = NULL;
 
     {
         Spectre *spec = spectre_initial(ctx);
 
-        add234(placed, spec);
+        hashset_add(placed, spec);
 
         spec->next = NULL;
 
@@ -454,34 +486,43 @@ void spectrectx_generate(SpectreContext *ctx,
         Spectre *spec = qhead;
 
         for (edge = 0; edge < 14; edge++) {
-            Spectre *new_spec;
+            /*
+             * Most of the Spectres we find this way are rejected,
+             * so rather than allocating a fresh one each time, keep
+             * reusing the same one until it's accepted.
+             */
+            if (!new_spec) {
+                new_spec = snew(Spectre);
+                new_spec->sc = spectre_coords_new();
+            }
 
-            new_spec = spectre_adjacent(ctx, spec, edge, NULL);
+            spectre_adjacent_into(ctx, spec, edge, new_spec, NULL);
 
-            if (find234(placed, new_spec, NULL)) {
-                spectre_free(new_spec);
+            if (hashset_find(placed, new_spec))
                 continue;
-            }
 
-            if (!callback(cbctx, new_spec)) {
-                spectre_free(new_spec);
+            if (!callback(cbctx, new_spec))
                 continue;
-            }
 
-            add234(placed, new_spec);
+            hashset_add(placed, new_spec);
             qtail->next = new_spec;
             qtail = new_spec;
             new_spec->next = NULL;
+            new_spec = NULL;
         }
 
         qhead = qhead->next;
     }
 
+    if (new_spec)
+        spectre_free(new_spec);
+
     {
         Spectre *spec;
-        while ((spec = delpos234(placed, 0)) != NULL)
+        size_t pos = 0;
+        while ((spec = hashset_next(placed, &pos)) != NULL)
             spectre_free(spec);
-        freetree234(placed);
+        hashset_free(placed);
     }
 }
 
@@ -282,11 +282,13 @@ struct numbers {
 
 struct game_state {
     game_params p;
-    char *grid;
+    cow_array *grid;                   /* of char */
     struct numbers *numbers;
     bool completed, used_solve;
 };
 
+#define GRID(state, i) COW_GET(char, (state)->grid, i)
+
 static game_params *default_params(void)
 {
     game_params *ret = snew(game_params);
@@ -429,6 +431,8 @@ struct solver_scratch {
     char *links;		       /* mapping between trees and tents */
     int *locs;
     char *place, *mrows, *trows;
+    char *lines;		       /* each row/column when last examined */
+    bool *lines_valid;
 };
 
 static struct solver_scratch *new_scratch(int w, int h)
@@ -440,12 +444,16 @@ static struct solver_scratch *new_scratch(int w, int h)
     ret->place = snewn(max(w, h), char);
     ret->mrows = snewn(3 * max(w, h), char);
     ret->trows = snewn(3 * max(w, h), char);
+    ret->lines = snewn((w+h) * max(w, h), char);
+    ret->lines_valid = snewn(w+h, bool);
 
     return ret;
 }
 
 static void free_scratch(struct solver_scratch *sc)
 {
+    sfree(sc->lines_valid);
+    sfree(sc->lines);
     sfree(sc->trows);
     sfree(sc->mrows);
     sfree(sc->place);
@@ -468,6 +476,7 @@ static int tents_solve(int w, int h, const char *grid, int *numbers,
      * Set up solver data.
      */
     memset(sc->links, N, w*h);
+    memset(sc->lines_valid, 0, (w+h) * sizeof(bool));
 
     /*
      * Set up solution array.
@@ -675,6 +684,7 @@ static int tents_solve(int w, int h, const char *grid, int *numbers,
 	 */
 	for (i = 0; i < w+h; i++) {
 	    int start, step, len, start1, start2, n, k;
+	    char *line;
 
 	    if (i < w) {
 		/*
@@ -718,6 +728,21 @@ static int tents_solve(int w, int h, const char *grid, int *numbers,
 		start1 = start2 = -1;
 	    }
 
+	    /*
+	     * If this row or column is just as it was the last time
+	     * we looked at it, we'd only deduce what we deduced then,
+	     * which is all in soln already.
+	     */
+	    line = sc->lines + i * max(w, h);
+	    for (j = 0; j < len; j++)
+		if (line[j] != soln[start+j*step])
+		    break;
+	    if (j == len && sc->lines_valid[i])
+		continue;
+	    for (j = 0; j < len; j++)
+		line[j] = soln[start+j*step];
+	    sc->lines_valid[i] = true;
+
 	    k = numbers[i];
 
 	    /*
@@ -1255,17 +1280,17 @@ static game_state *new_game(midend *me, const game_params *params,
 {
     int w = params->w, h = params->h;
     game_state *state = snew(game_state);
+    char *grid = snewn(w*h, char);
     int i;
 
     state->p = *params;		       /* structure copy */
-    state->grid = snewn(w*h, char);
     state->numbers = snew(struct numbers);
     state->numbers->refcount = 1;
     state->numbers->numbers = snewn(w+h, int);
     state->completed = state->used_solve = false;
 
     i = 0;
-    memset(state->grid, BLANK, w*h);
+    memset(grid, BLANK, w*h);
 
     while (*desc) {
 	int run, type;
@@ -1294,10 +1319,14 @@ static game_state *new_game(midend *me, const game_params *params,
 	    break;
 	} else {
 	    if (type != BLANK)
-		state->grid[i++] = type;
+		grid[i++] = type;
 	}
     }
 
+    state->grid = cow_new(w*h, sizeof(char));
+    cow_write_all(state->grid, grid);
+    sfree(grid);
+
     for (i = 0; i < w+h; i++) {
 	assert(*desc == ',');
 	desc++;
@@ -1312,12 +1341,10 @@ static game_state *new_game(midend *me, const game_params *params,
 
 static game_state *dup_game(const game_state *state)
 {
-    int w = state->p.w, h = state->p.h;
     game_state *ret = snew(game_state);
 
     ret->p = state->p;		       /* structure copy */
-    ret->grid = snewn(w*h, char);
-    memcpy(ret->grid, state->grid, w*h);
+    ret->grid = cow_dup(state->grid);
     ret->numbers = state->numbers;
     state->numbers->refcount++;
     ret->completed = state->completed;
@@ -1332,7 +1359,7 @@ static void free_game(game_state *state)
 	sfree(state->numbers->numbers);
 	sfree(state->numbers);
     }
-    sfree(state->grid);
+    cow_free(state->grid);
     sfree(state);
 }
 
@@ -1349,14 +1376,17 @@ static char *solve_game(const game_state *state, const game_state *currstate,
         return dupstr(aux);
     } else {
 	struct solver_scratch *sc = new_scratch(w, h);
-        char *soln;
+        char *grid, *soln;
         int ret;
         char *move, *p;
         int i;
 
+	grid = snewn(w*h, char);
+	cow_read_all(state->grid, grid);
 	soln = snewn(w*h, char);
-	ret = tents_solve(w, h, state->grid, state->numbers->numbers,
+	ret = tents_solve(w, h, grid, state->numbers->numbers,
                           soln, sc, DIFFCOUNT-1);
+	sfree(grid);
 	free_scratch(sc);
 	if (ret != 1) {
 	    sfree(soln);
@@ -1406,7 +1436,7 @@ static char *game_text_format(const game_state *state)
 	    if (r == h && c == w) /* NOP */;
 	    else if (c == w) n = state->numbers->numbers[w + r];
 	    else if (r == h) n = state->numbers->numbers[c];
-	    else switch (state->grid[i]) {
+	    else switch (GRID(state, i)) {
 		case BLANK: board[center] = '.'; break;
 		case TREE: board[center] = 'T'; break;
 		case TENT: memcpy(board + center - 1, "//\\", 3); break;
@@ -1477,7 +1507,7 @@ static const char *current_key_label(const game_ui *ui,
                                      const game_state *state, int button)
 {
     int w = state->p.w;
-    int v = state->grid[ui->cy*w+ui->cx];
+    int v = GRID(state, ui->cy*w+ui->cx);
 
     if (IS_CURSOR_SELECT(button) && ui->cdisp) {
         switch (v) {
@@ -1640,8 +1670,8 @@ static char *interpret_move(const game_state *state, game_ui *ui,
         sep = "";
         for (y = ymin; y <= ymax; y++)
             for (x = xmin; x <= xmax; x++) {
-                int v = drag_xform(ui, x, y, state->grid[y*w+x]);
-                if (state->grid[y*w+x] != v) {
+                int v = drag_xform(ui, x, y, GRID(state, y*w+x));
+                if (GRID(state, y*w+x) != v) {
                     tmplen = sprintf(tmpbuf, "%s%c%d,%d", sep,
                                      (int)(v == BLANK ? 'B' :
                                            v == TENT ? 'T' : 'N'),
@@ -1680,8 +1710,8 @@ static char *interpret_move(const game_state *state, game_ui *ui,
 
             /* NONTENTify all unique traversed eligible squares */
             for (i = 0; i <= (indices[0] != indices[1]); ++i)
-                if (state->grid[indices[i]] == BLANK ||
-                    (control && state->grid[indices[i]] == TENT)) {
+                if (GRID(state, indices[i]) == BLANK ||
+                    (control && GRID(state, indices[i]) == TENT)) {
                     len += sprintf(tmpbuf + len, "%sN%d,%d", len ? ";" : "",
                                    indices[i] % w, indices[i] / w);
                     assert(len < lenof(tmpbuf));
@@ -1696,7 +1726,7 @@ static char *interpret_move(const game_state *state, game_ui *ui,
     }
     if (ui->cdisp) {
         char rep = 0;
-        int v = state->grid[ui->cy*w+ui->cx];
+        int v = GRID(state, ui->cy*w+ui->cx);
 
         if (v != TREE) {
 #ifdef SINGLE_CURSOR_SELECT
@@ -1742,8 +1772,8 @@ static game_state *execute_move(const game_state *state, const char *move)
              * solve move will fill the tents in over the top.
              */
             for (i = 0; i < w*h; i++)
-                if (ret->grid[i] != TREE)
-                    ret->grid[i] = NONTENT;
+                if (GRID(ret, i) != TREE)
+                    COW_PUT(char, ret->grid, i) = NONTENT;
 	    move++;
 	} else if (c == 'B' || c == 'T' || c == 'N') {
             move++;
@@ -1752,11 +1782,12 @@ static game_state *execute_move(const game_state *state, const char *move)
                 free_game(ret);
                 return NULL;
             }
-            if (ret->grid[y*w+x] == TREE) {
+            if (GRID(ret, y*w+x) == TREE) {
                 free_game(ret);
                 return NULL;
             }
-            ret->grid[y*w+x] = (c == 'B' ? BLANK : c == 'T' ? TENT : NONTENT);
+            COW_PUT(char, ret->grid, y*w+x) =
+                (c == 'B' ? BLANK : c == 'T' ? TENT : NONTENT);
             move += n;
         } else {
             free_game(ret);
@@ -1774,9 +1805,9 @@ static game_state *execute_move(const game_state *state, const char *move)
      * Check for completion.
      */
     for (i = n = m = 0; i < w*h; i++) {
-        if (ret->grid[i] == TENT)
+        if (GRID(ret, i) == TENT)
             n++;
-        else if (ret->grid[i] == TREE)
+        else if (GRID(ret, i) == TREE)
             m++;
     }
     if (n == m) {
@@ -1790,7 +1821,7 @@ static game_state *execute_move(const game_state *state, const char *move)
 	for (i = 0; i < w; i++) {
 	    n = 0;
 	    for (j = 0; j < h; j++)
-		if (ret->grid[j*w+i] == TENT)
+		if (GRID(ret, j*w+i) == TENT)
 		    n++;
 	    if (ret->numbers->numbers[i] != n)
                 goto completion_check_done;
@@ -1798,7 +1829,7 @@ static game_state *execute_move(const game_state *state, const char *move)
 	for (i = 0; i < h; i++) {
             n = 0;
 	    for (j = 0; j < w; j++)
-		if (ret->grid[i*w+j] == TENT)
+		if (GRID(ret, i*w+j) == TENT)
 		    n++;
 	    if (ret->numbers->numbers[w+i] != n)
                 goto completion_check_done;
@@ -1809,17 +1840,17 @@ static game_state *execute_move(const game_state *state, const char *move)
         for (y = 0; y < h; y++)
             for (x = 0; x < w; x++) {
                 if (x+1 < w &&
-                    ret->grid[y*w+x] == TENT && ret->grid[y*w+x+1] == TENT)
+                    GRID(ret, y*w+x) == TENT && GRID(ret, y*w+x+1) == TENT)
                     goto completion_check_done;
                 if (y+1 < h &&
-                    ret->grid[y*w+x] == TENT && ret->grid[(y+1)*w+x] == TENT)
+                    GRID(ret, y*w+x) == TENT && GRID(ret, (y+1)*w+x) == TENT)
                     goto completion_check_done;
                 if (x+1 < w && y+1 < h) {
-                    if (ret->grid[y*w+x] == TENT &&
-                        ret->grid[(y+1)*w+(x+1)] == TENT)
+                    if (GRID(ret, y*w+x) == TENT &&
+                        GRID(ret, (y+1)*w+(x+1)) == TENT)
                         goto completion_check_done;
-                    if (ret->grid[(y+1)*w+x] == TENT &&
-                        ret->grid[y*w+(x+1)] == TENT)
+                    if (GRID(ret, (y+1)*w+x) == TENT &&
+                        GRID(ret, y*w+(x+1)) == TENT)
                         goto completion_check_done;
                 }
             }
@@ -1842,12 +1873,12 @@ static game_state *execute_move(const game_state *state, const char *move)
         /* Assign each tent and tree a consecutive vertex id for
          * matching(). */
         for (i = n = 0; i < w*h; i++) {
-            if (ret->grid[i] == TENT)
+            if (GRID(ret, i) == TENT)
                 gridids[i] = n++;
         }
         assert(n == m);
         for (i = n = 0; i < w*h; i++) {
-            if (ret->grid[i] == TREE)
+            if (GRID(ret, i) == TREE)
                 gridids[i] = n++;
         }
         assert(n == m);
@@ -1856,7 +1887,7 @@ static game_state *execute_move(const game_state *state, const char *move)
         adjptr = adjdata;
         for (y = 0; y < h; y++)
             for (x = 0; x < w; x++)
-                if (ret->grid[y*w+x] == TREE) {
+                if (GRID(ret, y*w+x) == TREE) {
                     int d, treeid = gridids[y*w+x];
                     adjlists[treeid] = adjptr;
 
@@ -1871,7 +1902,7 @@ static game_state *execute_move(const game_state *state, const char *move)
 		    for (d = 1; d < MAXDIR; d++) {
 			int x2 = x + dx(d), y2 = y + dy(d);
 			if (x2 >= 0 && x2 < w && y2 >= 0 && y2 < h &&
-                            ret->grid[y2*w+x2] == TENT) {
+                            GRID(ret, y2*w+x2) == TENT) {
                             *adjptr++ = gridids[y2*w+x2];
                         }
                     }
@@ -2465,23 +2496,20 @@ static void int_redraw(drawing *dr, game_drawstate *ds,
      * the error highlights respond instantly to single clicks, but
      * not giving constant feedback during a right-drag.)
      */
-    if (ui && ui->drag_button >= 0) {
-	tmpgrid = snewn(w*h, char);
-	memcpy(tmpgrid, state->grid, w*h);
+    tmpgrid = snewn(w*h, char);
+    cow_read_all(state->grid, tmpgrid);
+    if (ui && ui->drag_button >= 0)
 	tmpgrid[ui->dsy * w + ui->dsx] =
 	    drag_xform(ui, ui->dsx, ui->dsy, tmpgrid[ui->dsy * w + ui->dsx]);
-	errors = find_errors(state, tmpgrid);
-	sfree(tmpgrid);
-    } else {
-	errors = find_errors(state, state->grid);
-    }
+    errors = find_errors(state, tmpgrid);
+    sfree(tmpgrid);
 
     /*
      * Draw the grid.
      */
     for (y = 0; y < h; y++) {
         for (x = 0; x < w; x++) {
-            int v = state->grid[y*w+x];
+            int v = GRID(state, y*w+x);
             bool credraw = false;
 
             /*
@@ -2646,7 +2674,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
@@ -2670,7 +2702,7 @@ const struct game thegame = {
     true, false, game_print_size, game_print,
     false,			       /* wants_statusbar */
     false, NULL,                       /* timing_state */
-    REQUIRE_RBUTTON | STYLUS_SUPPORT,  /* flags */
+    REQUIRE_RBUTTON | STYLUS_SUPPORT | SOLVE_FROM_ORIG,  /* flags */
 };
 
 #ifdef STANDALONE_SOLVER
@@ -2687,6 +2719,7 @@ int main(int argc, char **argv)
     int ret, diff;
     bool really_verbose = false;
     struct solver_scratch *sc;
+    char *grid, *soln;
 
     while (--argc > 0) {
         char *p = *++argv;
@@ -2725,6 +2758,9 @@ int main(int argc, char **argv)
     s2 = new_game(NULL, p, desc);
 
     sc = new_scratch(p->w, p->h);
+    grid = snewn(p->w * p->h, char);
+    cow_read_all(s->grid, grid);
+    soln = snewn(p->w * p->h, char);
 
     /*
      * When solving an Easy puzzle, we don't want to bother the
@@ -2733,8 +2769,8 @@ int main(int argc, char **argv)
      */
     ret = -1;			       /* placate optimiser */
     for (diff = 0; diff < DIFFCOUNT; diff++) {
-	ret = tents_solve(p->w, p->h, s->grid, s->numbers->numbers,
-			  s2->grid, sc, diff);
+	ret = tents_solve(p->w, p->h, grid, s->numbers->numbers,
+			  soln, sc, diff);
 	if (ret < 2)
 	    break;
     }
@@ -2752,12 +2788,14 @@ int main(int argc, char **argv)
 		printf("Difficulty rating: %s\n", tents_diffnames[diff]);
 	} else {
 	    verbose = really_verbose;
-	    ret = tents_solve(p->w, p->h, s->grid, s->numbers->numbers,
-			      s2->grid, sc, diff);
+	    ret = tents_solve(p->w, p->h, grid, s->numbers->numbers,
+			      soln, sc, diff);
 	    if (ret == 0)
 		printf("Puzzle is inconsistent\n");
-	    else
+	    else {
+		cow_write_all(s2->grid, soln);
 		fputs(game_text_format(s2), stdout);
+	    }
 	}
     }
 
@@ -0,0 +1,140 @@
+/*
+ * threadpool.c: a pool of threads to run parallel_run()'s tasks, for
+ * front ends with POSIX threads (the Unix one, and the web one when
+ * it's built with wasm threads).
+ *
+ * Interactive play generates one puzzle at a time, so unlike
+ * batchgen.c there's no way to use more cores by generating several
+ * puzzles at once; but the generator can split some of its own work
+ * up, such as the candidate checks in prune_clues (see misc.c for
+ * why that gives the same puzzle).
+ *
+ * The calling thread takes tasks alongside the helpers, one at a time
+ * from a shared counter, until there are none left. The pool lasts
+ * until the process exits.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+
+#include "puzzles.h"
+
+/* Beyond this, generators rarely have enough independent work. */
+#define THREADPOOL_MAX_THREADS 8
+
+struct threadpool {
+    pthread_mutex_t lock;
+    pthread_cond_t start, finished;
+    int nthreads;                      /* including the caller */
+
+    /* The current batch, which helpers pick up when 'batch' changes */
+    unsigned batch;
+    parallel_task_fn fn;
+    void *ctx;
+    int next, n;                       /* tasks [next,n) not yet taken */
+    int busy;                          /* helpers still in this batch */
+};
+
+/* Run tasks from the current batch until there are none left. */
+static void threadpool_work(struct threadpool *pool)
+{
+    while (pool->next < pool->n) {
+        int i = pool->next++;
+        pthread_mutex_unlock(&pool->lock);
+        pool->fn(pool->ctx, i);
+        pthread_mutex_lock(&pool->lock);
+    }
+}
+
+static void *threadpool_main(void *vpool)
+{
+    struct threadpool *pool = (struct threadpool *)vpool;
+    unsigned seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    while (1) {
+        while (pool->batch == seen)
+            pthread_cond_wait(&pool->start, &pool->lock);
+        seen = pool->batch;
+
+        threadpool_work(pool);
+
+        if (--pool->busy == 0)
+            pthread_cond_signal(&pool->finished);
+    }
+    return NULL;
+}
+
+static void threadpool_run(void *hookctx, parallel_task_fn fn, void *ctx,
+                           int n)
+{
+    struct threadpool *pool = (struct threadpool *)hookctx;
+
+    pthread_mutex_lock(&pool->lock);
+    assert(pool->busy == 0);           /* not reentrant */
+    pool->fn = fn;
+    pool->ctx = ctx;
+    pool->next = 0;
+    pool->n = n;
+    pool->busy = pool->nthreads - 1;
+    pool->batch++;
+    pthread_cond_broadcast(&pool->start);
+
+    threadpool_work(pool);
+
+    while (pool->busy > 0)
+        pthread_cond_wait(&pool->finished, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/* The cache lock, for games' caches shared between threads. */
+static pthread_mutex_t threadpool_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void threadpool_cache_lock(void *ctx, bool lock)
+{
+    if (lock)
+        pthread_mutex_lock(&threadpool_cache_mutex);
+    else
+        pthread_mutex_unlock(&threadpool_cache_mutex);
+}
+
+void threadpool_lock_caches(void)
+{
+    set_cache_lock_hook(threadpool_cache_lock, NULL);
+}
+
+void threadpool_start(int nthreads)
+{
+    struct threadpool *pool;
+    int i;
+
+    if (nthreads > THREADPOOL_MAX_THREADS)
+        nthreads = THREADPOOL_MAX_THREADS;
+    if (nthreads <= 1)
+        return;
+
+    pool = snew(struct threadpool);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->finished, NULL);
+    pool->nthreads = nthreads;
+    pool->batch = 0;
+    pool->next = pool->n = 0;
+    pool->busy = 0;
+
+    for (i = 1; i < nthreads; i++) {
+        pthread_t thread;
+
+        if (pthread_create(&thread, NULL, threadpool_main, pool)) {
+            /* Make do with the threads we've got. */
+            pool->nthreads = i;
+            break;
+        }
+        pthread_detach(thread);
+    }
+
+    if (pool->nthreads > 1) {
+        threadpool_lock_caches();
+        set_parallel_hook(threadpool_run, pool, pool->nthreads);
+    }
+}
@@ -11,9 +11,9 @@
  *     + the clues outside the grid would have to cope with being
  * 	 multi-digit, meaning in particular that the text formatting
  * 	 would become more unpleasant
- *     + most importantly, though, the solver just isn't fast
- * 	 enough. Even at size 9 it can't really do the solver_hard
- * 	 factorial-time enumeration at a sensible rate. Easy puzzles
+ *     + the solver_hard line analysis takes time and memory
+ * 	 exponential in the grid size (see analyse_line), which is
+ * 	 fine at 9 but wouldn't be much beyond it. Easy puzzles
  * 	 higher than that would be possible, but more latin-squarey
  * 	 than skyscrapery, as it were.
  */
@@ -31,6 +31,7 @@
 
 #include "puzzles.h"
 #include "latin.h"
+#include "tree234.h"
 
 /*
  * Difficulty levels. I do some macro ickery here to ensure that my
@@ -264,8 +265,134 @@ struct solver_ctx {
     int *clues;
     long *iscratch;
     int *dscratch;
+    int *fwd, *bwd;                    /* 1<<w each, for analyse_line */
+    unsigned char *setsize, *settop;   /* likewise */
+    tree234 *lines;                    /* of struct line_analysis */
 };
 
+/*
+ * The result of analysing a line against one clue: given the clue
+ * and the digits still possible in each square of the line, the
+ * digits that can go in each square in some arrangement of the line
+ * which meets the clue. These are cached for the duration of a
+ * solver run, since most lines come up unchanged pass after pass.
+ */
+struct line_analysis {
+    int w, clue;
+    long *cands;                       /* w entries, then w results */
+};
+
+static int line_analysis_cmp(void *av, void *bv)
+{
+    const struct line_analysis *a = (const struct line_analysis *)av;
+    const struct line_analysis *b = (const struct line_analysis *)bv;
+    int i;
+
+    if (a->clue != b->clue)
+        return a->clue < b->clue ? -1 : +1;
+    for (i = 0; i < a->w; i++)
+        if (a->cands[i] != b->cands[i])
+            return a->cands[i] < b->cands[i] ? -1 : +1;
+    return 0;
+}
+
+/*
+ * Work out, into ctx->iscratch, which digits can go in each square
+ * of a line given that the clue at its start is 'clue'.
+ *
+ * Rather than enumerating every arrangement of the line (factorial
+ * time), we observe that after placing some prefix of the line, all
+ * that matters for the rest is the set of digits used so far and how
+ * many towers have been visible, because the tallest tower so far is
+ * just the largest digit in the set. So we work forwards through the
+ * 2^w possible sets, finding which visible counts can reach each,
+ * and backwards, finding from which counts each can go on to meet
+ * the clue. (Each set's square is its number of members.) A digit
+ * can go in a square if it takes some forward-reachable state to
+ * one that can still finish.
+ */
+static void analyse_line(struct latin_solver *solver, struct solver_ctx *ctx,
+                         int clue, int start, int step)
+{
+    int w = ctx->w, nsets = 1 << w;
+    struct line_analysis key, *found;
+    long cands[9];
+    int *fwd = ctx->fwd, *bwd = ctx->bwd;
+    int i, j, set, top, counts, reach;
+
+    assert(w <= lenof(cands));
+    for (i = 0; i < w; i++) {
+        int pos = start + step * i;
+        cands[i] = 0;
+        for (j = 1; j <= w; j++)
+            if (solver->cube[pos*w+j-1])
+                cands[i] |= 1L << j;
+    }
+
+    key.w = w;
+    key.clue = clue;
+    key.cands = cands;
+    found = find234(ctx->lines, &key, NULL);
+    if (found) {
+        for (i = 0; i < w; i++)
+            ctx->iscratch[i] = found->cands[w+i];
+        return;
+    }
+
+    /*
+     * Bit k of fwd[set] or bwd[set] stands for k towers visible.
+     * Digit j is bit j-1 of a set. The backward pass need only look
+     * at sets reachable going forwards, and can collect the results
+     * as it goes.
+     */
+    for (set = 0; set < nsets; set++)
+        fwd[set] = bwd[set] = 0;
+    fwd[0] = 1;
+    bwd[nsets-1] = 1 << clue;
+    for (set = 0; set < nsets - 1; set++) {
+        if (!fwd[set])
+            continue;
+        i = ctx->setsize[set];
+        top = ctx->settop[set];
+        for (j = 1; j <= w; j++) {
+            if ((set & (1 << (j-1))) || !(cands[i] & (1L << j)))
+                continue;
+            counts = (j > top ? fwd[set] << 1 : fwd[set]);
+            fwd[set | (1 << (j-1))] |= counts & ((2 << clue) - 1);
+        }
+    }
+
+    for (i = 0; i < w; i++)
+        ctx->iscratch[i] = 0;
+    for (set = nsets - 1; set-- > 0 ;) {
+        if (!fwd[set])
+            continue;
+        i = ctx->setsize[set];
+        top = ctx->settop[set];
+        for (j = 1; j <= w; j++) {
+            if ((set & (1 << (j-1))) || !(cands[i] & (1L << j)))
+                continue;
+            reach = bwd[set | (1 << (j-1))];
+            if (!reach)
+                continue;
+            counts = (j > top ? fwd[set] << 1 : fwd[set]);
+            if (counts & reach)
+                ctx->iscratch[i] |= 1L << j;
+            bwd[set] |= (j > top ? reach >> 1 : reach);
+        }
+    }
+
+    found = snew(struct line_analysis);
+    found->w = w;
+    found->clue = clue;
+    found->cands = snewn(2*w, long);
+    for (i = 0; i < w; i++) {
+        found->cands[i] = cands[i];
+        found->cands[w+i] = ctx->iscratch[i];
+    }
+    add234(ctx->lines, found);
+}
+
 static int solver_easy(struct latin_solver *solver, void *vctx)
 {
     struct solver_ctx *ctx = (struct solver_ctx *)vctx;
@@ -452,8 +579,7 @@ static int solver_hard(struct latin_solver *solver, void *vctx)
 {
     struct solver_ctx *ctx = (struct solver_ctx *)vctx;
     int w = ctx->w;
-    int c, i, j, n, best, clue, start, step, ret;
-    long bitmap;
+    int c, i, j, clue, start, step, ret;
 #ifdef STANDALONE_SOLVER
     char prefix[256];
 #endif
@@ -467,76 +593,7 @@ static int solver_hard(struct latin_solver *solver, void *vctx)
 	    continue;
 	CSTARTSTEP(start, step, c, w);
 
-	for (i = 0; i < w; i++)
-	    ctx->iscratch[i] = 0;
-
-	/*
-	 * Instead of a tedious physical recursion, I iterate in the
-	 * scratch array through all possibilities. At any given
-	 * moment, i indexes the element of the box that will next
-	 * be incremented.
-	 */
-	i = 0;
-	ctx->dscratch[i] = 0;
-	best = n = 0;
-	bitmap = 0;
-
-	while (1) {
-	    if (i < w) {
-		/*
-		 * Find the next valid value for cell i.
-		 */
-		int limit = (n == clue ? best : w);
-		int pos = start + step * i;
-		for (j = ctx->dscratch[i] + 1; j <= limit; j++) {
-		    if (bitmap & (1L << j))
-			continue;      /* used this one already */
-		    if (!solver->cube[pos*w+j-1])
-			continue;      /* ruled out already */
-
-		    /* Found one. */
-		    break;
-		}
-
-		if (j > limit) {
-		    /* No valid values left; drop back. */
-		    i--;
-		    if (i < 0)
-			break;	       /* overall iteration is finished */
-		    bitmap &= ~(1L << ctx->dscratch[i]);
-		    if (ctx->dscratch[i] == best) {
-			n--;
-			best = 0;
-			for (j = 0; j < i; j++)
-			    if (best < ctx->dscratch[j])
-				best = ctx->dscratch[j];
-		    }
-		} else {
-		    /* Got a valid value; store it and move on. */
-		    bitmap |= 1L << j;
-		    ctx->dscratch[i++] = j;
-		    if (j > best) {
-			best = j;
-			n++;
-		    }
-		    ctx->dscratch[i] = 0;
-		}
-	    } else {
-		if (n == clue) {
-		    for (j = 0; j < w; j++)
-			ctx->iscratch[j] |= 1L << ctx->dscratch[j];
-		}
-		i--;
-		bitmap &= ~(1L << ctx->dscratch[i]);
-		if (ctx->dscratch[i] == best) {
-		    n--;
-		    best = 0;
-		    for (j = 0; j < i; j++)
-			if (best < ctx->dscratch[j])
-			    best = ctx->dscratch[j];
-		}
-	    }
-	}
+	analyse_line(solver, ctx, clue, start, step);
 
 #ifdef STANDALONE_SOLVER
 	if (solver_show_working)
@@ -620,6 +677,8 @@ static int solver(int w, int *clues, digit *soln, int maxdiff)
 {
     int ret;
     struct solver_ctx ctx;
+    struct line_analysis *line;
+    int i, j;
 
     ctx.w = w;
     ctx.diff = maxdiff;
@@ -627,6 +686,19 @@ static int solver(int w, int *clues, digit *soln, int maxdiff)
     ctx.started = false;
     ctx.iscratch = snewn(w, long);
     ctx.dscratch = snewn(w+1, int);
+    ctx.fwd = snewn(1 << w, int);
+    ctx.bwd = snewn(1 << w, int);
+    ctx.setsize = snewn(1 << w, unsigned char);
+    ctx.settop = snewn(1 << w, unsigned char);
+    for (i = 0; i < (1 << w); i++) {
+        ctx.setsize[i] = ctx.settop[i] = 0;
+        for (j = 1; j <= w; j++)
+            if (i & (1 << (j-1))) {
+                ctx.setsize[i]++;
+                ctx.settop[i] = j;
+            }
+    }
+    ctx.lines = newtree234(line_analysis_cmp);
 
     ret = latin_solver(soln, w, maxdiff,
 		       DIFF_EASY, DIFF_HARD, DIFF_EXTREME,
@@ -635,6 +707,15 @@ static int solver(int w, int *clues, digit *soln, int maxdiff)
 
     sfree(ctx.iscratch);
     sfree(ctx.dscratch);
+    sfree(ctx.fwd);
+    sfree(ctx.bwd);
+    sfree(ctx.setsize);
+    sfree(ctx.settop);
+    while ((line = delpos234(ctx.lines, 0)) != NULL) {
+        sfree(line->cands);
+        sfree(line);
+    }
+    freetree234(ctx.lines);
 
     return ret;
 }
@@ -648,6 +729,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 {
     int w = params->w, a = w*w;
     digit *grid, *soln, *soln2;
+    struct latin_generate_scratch *latinscratch;
     int *clues, *order;
     int i, ret;
     int diff = params->diff;
@@ -678,7 +760,8 @@ done
     if (diff > DIFF_HARD && w <= 3)
 	diff = DIFF_HARD;
 
-    grid = NULL;
+    grid = snewn(a, digit);
+    latinscratch = latin_generate_new_scratch(w);
     clues = snewn(4*w, int);
     soln = snewn(a, digit);
     soln2 = snewn(a, digit);
@@ -688,8 +771,7 @@ done
 	/*
 	 * Construct a latin square to be the solution.
 	 */
-	sfree(grid);
-	grid = latin_generate(w, rs);
+	latin_generate_with_scratch(latinscratch, grid, rs);
 
 	/*
 	 * Fill in the clues.
@@ -829,6 +911,7 @@ done
     (*aux)[a+1] = '\0';
 
     sfree(grid);
+    latin_generate_free_scratch(latinscratch);
     sfree(clues);
     sfree(soln);
     sfree(soln2);
@@ -1063,6 +1146,26 @@ static char *solve_game(const game_state *state, const game_state *currstate,
     return out;
 }
 
+static char *grade_game(const game_state *state, const char **error)
+{
+    int w = state->par.w, a = w*w;
+    digit *soln = snewn(a, digit);
+    int ret;
+
+    memcpy(soln, state->clues->immutable, a);
+    ret = solver(w, state->clues->clues, soln, DIFFCOUNT-1);
+    sfree(soln);
+
+    if (ret == diff_impossible) {
+        *error = "No solution exists for this puzzle";
+        return NULL;
+    } else if (ret == diff_ambiguous) {
+        *error = "Multiple solutions exist for this puzzle";
+        return NULL;
+    }
+    return dupstr(towers_diffnames[ret]);
+}
+
 static bool game_can_format_as_text_now(const game_params *params)
 {
     return true;
@@ -2141,7 +2244,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    NULL, /* solve_step */
+    grade_game,
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     get_prefs, set_prefs,
     new_ui,
@@ -2165,7 +2272,7 @@ const struct game thegame = {
     true, false, game_print_size, game_print,
     false,			       /* wants_statusbar */
     false, NULL,                       /* timing_state */
-    REQUIRE_RBUTTON | REQUIRE_NUMPAD,  /* flags */
+    REQUIRE_RBUTTON | REQUIRE_NUMPAD | SOLVE_FROM_ORIG,  /* flags */
 };
 
 #ifdef STANDALONE_SOLVER
@@ -273,7 +273,8 @@ struct game_state {
     game_params p;
     unsigned int *sflags;       /* size w*h */
     struct numbers *numbers;
-    int *num_errors;            /* size w+h */
+    unitcheck *lines;           /* clue status of each column, then row */
+    bool route_ok;              /* no track errors, and A joined to B */
     bool completed, used_solve, impossible;
 };
 
@@ -343,7 +344,8 @@ static void clear_game(game_state *state)
     memset(state->numbers->numbers, 0, (w+h) * sizeof(int));
     state->numbers->col_s = state->numbers->row_s = -1;
 
-    memset(state->num_errors, 0, (w+h) * sizeof(int));
+    unitcheck_touch_all(state->lines);
+    state->route_ok = false;
 
     state->completed = state->used_solve = state->impossible = false;
 }
@@ -361,7 +363,7 @@ static game_state *blank_game(const game_params *params)
     state->numbers->refcount = 1;
     state->numbers->numbers = snewn(w+h, int);
 
-    state->num_errors = snewn(w+h, int);
+    state->lines = unitcheck_new(w+h);
 
     clear_game(state);
 
@@ -387,8 +389,8 @@ static game_state *dup_game(const game_state *state)
 
     ret->numbers = state->numbers;
     state->numbers->refcount++;
-    ret->num_errors = snewn(w+h, int);
-    memcpy(ret->num_errors, state->num_errors, (w+h)*sizeof(int));
+    ret->lines = unitcheck_dup(state->lines);
+    ret->route_ok = state->route_ok;
 
     ret->completed = state->completed;
     ret->used_solve = state->used_solve;
@@ -403,7 +405,7 @@ static void free_game(game_state *state)
         sfree(state->numbers->numbers);
         sfree(state->numbers);
     }
-    sfree(state->num_errors);
+    unitcheck_free(state->lines);
     sfree(state->sflags);
     sfree(state);
 }
@@ -437,7 +439,8 @@ static unsigned int find_direction(game_state *state, random_state *rs,
     return 0; /* no possible directions left. */
 }
 
-static bool check_completion(game_state *state, bool mark);
+static void check_completion(game_state *state, bool route_changed);
+static bool check_solved(game_state *state);
 
 static void lay_path(game_state *state, random_state *rs)
 {
@@ -910,15 +913,93 @@ static game_state *new_game(midend *me, const game_params *params, const char *d
 
     assert(!*desc);
 
+    check_completion(state, true);
+
     return state;
 }
 
+/*
+ * The solver keeps track of which of its deductions could possibly
+ * find anything new, so that each pass only looks at the squares and
+ * lines whose flags have changed since that deduction last looked at
+ * them. Deductions about squares use SD_FLAGS; deductions about whole
+ * rows and columns use one LD_* bit each.
+ */
+#define SD_FLAGS 1      /* solve_update_flags */
+#define SD_BRIDGE 2     /* square is in the 'bchanged' list */
+
+#define LD_COUNT 1      /* solve_count_clues */
+#define LD_SINGLE 2     /* solve_check_single */
+#define LD_LOOSE 4      /* solve_check_loose_ends */
+#define LD_NEIGHBOURS 8 /* solve_check_neighbours, one way */
+#define LD_NEIGHBOURS2 16 /* solve_check_neighbours, both ways */
+#define LD_ALL 31
+
 struct solver_scratch {
-    DSF *dsf;
+    DSF *dsf;                   /* scratch space for solve_bridge_sub */
+
+    /* Connectivity of the TRACK edges laid so far. */
+    DSF *trackdsf;
+
+    /* Number of TRACK and NOTRACK squares in each column, then each
+     * row, indexed like numbers->numbers. */
+    int *ntrack, *nnotrack;
+
+    unsigned char *sdirty;      /* SD_* flags, size w*h */
+    unsigned char *ldirty;      /* LD_* flags, size w+h */
+    bool loop_dirty;            /* anything changed since solve_check_loop */
+
+    /*
+     * Bridges in the graph of unknown edges as of the last
+     * solve_check_bridge_parity, and the squares whose edges have
+     * changed since then.
+     */
+    struct findloopstate *fls;
+    int *bchanged, nbchanged;
 };
 
+/* Note that square i's flags have changed, and by setting an edge if
+ * 'edge' is true. */
+static void solve_mark_square(game_state *state, int i, bool edge,
+                              struct solver_scratch *sc)
+{
+    int w = state->p.w;
+
+    sc->sdirty[i] |= SD_FLAGS;
+    sc->ldirty[i % w] = sc->ldirty[w + i / w] = LD_ALL;
+    sc->loop_dirty = true;
+    if (edge && !(sc->sdirty[i] & SD_BRIDGE)) {
+        sc->sdirty[i] |= SD_BRIDGE;
+        sc->bchanged[sc->nbchanged++] = i;
+    }
+}
+
+/* Check whether a deduction needs to look at a line again, and if so,
+ * note that it has now done so. */
+static bool solve_line_dirty(struct solver_scratch *sc, int line,
+                             unsigned rule)
+{
+    if (!(sc->ldirty[line] & rule))
+        return false;
+    sc->ldirty[line] &= ~rule;
+    return true;
+}
+
+/* Set S_TRACK or S_NOTRACK on square i, which must have neither. */
+static void solve_add_sflag(game_state *state, int i, unsigned int f,
+                            struct solver_scratch *sc)
+{
+    int w = state->p.w, *count = (f == S_TRACK ? sc->ntrack : sc->nnotrack);
+
+    state->sflags[i] |= f;
+    count[i % w]++;
+    count[w + i / w]++;
+    solve_mark_square(state, i, false, sc);
+}
+
 static int solve_set_sflag(game_state *state, int x, int y,
-                           unsigned int f, const char *why)
+                           unsigned int f, const char *why,
+                           struct solver_scratch *sc)
 {
     int w = state->p.w, i = y*w + x;
 
@@ -930,14 +1011,16 @@ static int solve_set_sflag(game_state *state, int x, int y,
         solverdebug(("opposite flag already set there, marking IMPOSSIBLE"));
         state->impossible = true;
     } else
-        state->sflags[i] |= f;
+        solve_add_sflag(state, i, f, sc);
     return 1;
 }
 
 static int solve_set_eflag(game_state *state, int x, int y, int d,
-                           unsigned int f, const char *why)
+                           unsigned int f, const char *why,
+                           struct solver_scratch *sc)
 {
-    int sf = S_E_FLAGS(state, x, y, d);
+    int w = state->p.w, sf = S_E_FLAGS(state, x, y, d), ax, ay;
+    unsigned int ad;
 
     if (sf & f)
         return 0;
@@ -947,33 +1030,44 @@ static int solve_set_eflag(game_state *state, int x, int y, int d,
     if (sf & (f == E_TRACK ? E_NOTRACK : E_TRACK)) {
         solverdebug(("opposite flag already set there, marking IMPOSSIBLE"));
         state->impossible = true;
-    } else
+    } else {
         S_E_SET(state, x, y, d, f);
+        solve_mark_square(state, y*w + x, true, sc);
+        if (S_E_ADJ(state, x, y, d, &ax, &ay, &ad)) {
+            solve_mark_square(state, ay*w + ax, true, sc);
+            if (f == E_TRACK)
+                dsf_merge(sc->trackdsf, y*w + x, ay*w + ax);
+        }
+    }
     return 1;
 }
 
-static int solve_update_flags(game_state *state)
+static int solve_update_flags(game_state *state, struct solver_scratch *sc)
 {
     int x, y, i, w = state->p.w, h = state->p.h, did = 0;
 
     for (x = 0; x < w; x++) {
         for (y = 0; y < h; y++) {
+            if (!(sc->sdirty[y*w + x] & SD_FLAGS))
+                continue;
+            sc->sdirty[y*w + x] &= ~SD_FLAGS;
+
             /* If a square is NOTRACK, all four edges must be. */
             if (state->sflags[y*w + x] & S_NOTRACK) {
                 for (i = 0; i < 4; i++) {
                     unsigned int d = 1<<i;
-                    did += solve_set_eflag(state, x, y, d, E_NOTRACK, "edges around NOTRACK");
+                    did += solve_set_eflag(state, x, y, d, E_NOTRACK, "edges around NOTRACK", sc);
                 }
             }
 
             /* If 3 or more edges around a square are NOTRACK, the square is. */
             if (S_E_COUNT(state, x, y, E_NOTRACK) >= 3) {
-                did += solve_set_sflag(state, x, y, S_NOTRACK, "square has >2 NOTRACK edges");
+                did += solve_set_sflag(state, x, y, S_NOTRACK, "square has >2 NOTRACK edges", sc);
             }
 
             /* If any edge around a square is TRACK, the square is. */
             if (S_E_COUNT(state, x, y, E_TRACK) > 0) {
-                did += solve_set_sflag(state, x, y, S_TRACK, "square has TRACK edge");
+                did += solve_set_sflag(state, x, y, S_TRACK, "square has TRACK edge", sc);
             }
 
             /* If a square is TRACK and 2 edges are NOTRACK,
@@ -985,7 +1079,7 @@ static int solve_update_flags(game_state *state)
                     unsigned int d = 1<<i;
                     if (!(S_E_FLAGS(state, x, y, d) & (E_TRACK|E_NOTRACK))) {
                         did += solve_set_eflag(state, x, y, d, E_TRACK,
-                                               "TRACK square/2 NOTRACK edges");
+                                               "TRACK square/2 NOTRACK edges", sc);
                     }
                 }
             }
@@ -999,7 +1093,7 @@ static int solve_update_flags(game_state *state)
                     unsigned int d = 1<<i;
                     if (!(S_E_FLAGS(state, x, y, d) & (E_TRACK|E_NOTRACK))) {
                         did += solve_set_eflag(state, x, y, d, E_NOTRACK,
-                                               "TRACK square/2 TRACK edges");
+                                               "TRACK square/2 TRACK edges", sc);
                     }
                 }
             }
@@ -1008,70 +1102,49 @@ static int solve_update_flags(game_state *state)
     return did;
 }
 
-static int solve_count_col(game_state *state, int col, unsigned int f)
-{
-    int i, n, c = 0, h = state->p.h, w = state->p.w;
-    for (n = 0, i = col; n < h; n++, i += w) {
-        if (state->sflags[i] & f) c++;
-    }
-    return c;
-}
-
-static int solve_count_row(game_state *state, int row, unsigned int f)
-{
-    int i, n, c = 0, w = state->p.w;
-    for (n = 0, i = w*row; n < state->p.w; n++, i++) {
-        if (state->sflags[i] & f) c++;
-    }
-    return c;
-}
-
 static int solve_count_clues_sub(game_state *state, int si, int id, int n,
-                                 int target, const char *what)
+                                 int line, const char *what,
+                                 struct solver_scratch *sc)
 {
-    int ctrack = 0, cnotrack = 0, did = 0, j, i, w = state->p.w;
+    int target = state->numbers->numbers[line];
+    int ctrack = sc->ntrack[line], cnotrack = sc->nnotrack[line];
+    int did = 0, j, i, w = state->p.w;
 
-    for (j = 0, i = si; j < n; j++, i += id) {
-        if (state->sflags[i] & S_TRACK)
-            ctrack++;
-        if (state->sflags[i] & S_NOTRACK)
-            cnotrack++;
-    }
     if (ctrack == target) {
         /* everything that's not S_TRACK must be S_NOTRACK. */
         for (j = 0, i = si; j < n; j++, i += id) {
             if (!(state->sflags[i] & S_TRACK))
-                did += solve_set_sflag(state, i%w, i/w, S_NOTRACK, what);
+                did += solve_set_sflag(state, i%w, i/w, S_NOTRACK, what, sc);
         }
     }
     if (cnotrack == (n-target)) {
         /* everything that's not S_NOTRACK must be S_TRACK. */
         for (j = 0, i = si; j < n; j++, i += id) {
             if (!(state->sflags[i] & S_NOTRACK))
-                did += solve_set_sflag(state, i%w, i/w, S_TRACK, what);
+                did += solve_set_sflag(state, i%w, i/w, S_TRACK, what, sc);
         }
     }
     return did;
 }
 
-static int solve_count_clues(game_state *state)
+static int solve_count_clues(game_state *state, struct solver_scratch *sc)
 {
-    int w = state->p.w, h = state->p.h, x, y, target, did = 0;
+    int w = state->p.w, h = state->p.h, x, y, did = 0;
 
     for (x = 0; x < w; x++) {
-        target = state->numbers->numbers[x];
-        did += solve_count_clues_sub(state, x, w, h, target, "col count");
+        if (solve_line_dirty(sc, x, LD_COUNT))
+            did += solve_count_clues_sub(state, x, w, h, x, "col count", sc);
     }
     for (y = 0; y < h; y++) {
-        target = state->numbers->numbers[w+y];
-        did += solve_count_clues_sub(state, y*w, 1, w, target, "row count");
+        if (solve_line_dirty(sc, w+y, LD_COUNT))
+            did += solve_count_clues_sub(state, y*w, 1, w, w+y, "row count", sc);
     }
     return did;
 }
 
 static int solve_check_single_sub(game_state *state, int si, int id, int n,
                                   int target, unsigned int perpf,
-                                  const char *what)
+                                  const char *what, struct solver_scratch *sc)
 {
     int ctrack = 0, nperp = 0, did = 0, j, i, w = state->p.w;
     int n1edge = 0, i1edge = 0, ox, oy, x, y;
@@ -1110,31 +1183,37 @@ static int solve_check_single_sub(game_state *state, int si, int id, int n,
         y = i/w;
         if (abs(ox-x) > 1 || abs(oy-y) > 1) {
             if (!(state->sflags[i] & S_TRACK))
-                did += solve_set_sflag(state, x, y, S_NOTRACK, what);
+                did += solve_set_sflag(state, x, y, S_NOTRACK, what, sc);
         }
     }
 
     return did;
 }
 
-static int solve_check_single(game_state *state)
+static int solve_check_single(game_state *state, struct solver_scratch *sc)
 {
     int w = state->p.w, h = state->p.h, x, y, target, did = 0;
 
     for (x = 0; x < w; x++) {
+        if (!solve_line_dirty(sc, x, LD_SINGLE))
+            continue;
         target = state->numbers->numbers[x];
-        did += solve_check_single_sub(state, x, w, h, target, R|L, "single on col");
+        did += solve_check_single_sub(state, x, w, h, target, R|L,
+                                      "single on col", sc);
     }
     for (y = 0; y < h; y++) {
+        if (!solve_line_dirty(sc, w+y, LD_SINGLE))
+            continue;
         target = state->numbers->numbers[w+y];
-        did += solve_check_single_sub(state, y*w, 1, w, target, U|D, "single on row");
+        did += solve_check_single_sub(state, y*w, 1, w, target, U|D,
+                                      "single on row", sc);
     }
     return did;
 }
 
 static int solve_check_loose_sub(game_state *state, int si, int id, int n,
                                  int target, unsigned int perpf,
-                                 const char *what)
+                                 const char *what, struct solver_scratch *sc)
 {
     int nperp = 0, nloose = 0, e2count = 0, did = 0, i, j, k;
     int w = state->p.w;
@@ -1175,7 +1254,8 @@ static int solve_check_loose_sub(game_state *state, int si, int id, int n,
                         !(S_E_DIRS(state, i%w, i/w, E_TRACK) & (1<<k))) {
                     /* set as NOTRACK the edge parallel to the row/column that's
                        not already set. */
-                    did += solve_set_eflag(state, i%w, i/w, 1<<k, E_NOTRACK, what);
+                    did += solve_set_eflag(state, i%w, i/w, 1<<k, E_NOTRACK,
+                                           what, sc);
                 }
             }
         }
@@ -1188,7 +1268,8 @@ static int solve_check_loose_sub(game_state *state, int si, int id, int n,
                 continue; /* skip non-loose ends */
             for (k = 0; k < 4; k++) {
                 if (parf & (1<<k))
-                    did += solve_set_eflag(state, i%w, i/w, 1<<k, E_TRACK, what);
+                    did += solve_set_eflag(state, i%w, i/w, 1<<k, E_TRACK,
+                                           what, sc);
             }
         }
     }
@@ -1196,35 +1277,36 @@ static int solve_check_loose_sub(game_state *state, int si, int id, int n,
     return did;
 }
 
-static int solve_check_loose_ends(game_state *state)
+static int solve_check_loose_ends(game_state *state, struct solver_scratch *sc)
 {
     int w = state->p.w, h = state->p.h, x, y, target, did = 0;
 
     for (x = 0; x < w; x++) {
+        if (!solve_line_dirty(sc, x, LD_LOOSE))
+            continue;
         target = state->numbers->numbers[x];
-        did += solve_check_loose_sub(state, x, w, h, target, R|L, "loose on col");
+        did += solve_check_loose_sub(state, x, w, h, target, R|L,
+                                     "loose on col", sc);
     }
     for (y = 0; y < h; y++) {
+        if (!solve_line_dirty(sc, w+y, LD_LOOSE))
+            continue;
         target = state->numbers->numbers[w+y];
-        did += solve_check_loose_sub(state, y*w, 1, w, target, U|D, "loose on row");
+        did += solve_check_loose_sub(state, y*w, 1, w, target, U|D,
+                                     "loose on row", sc);
     }
     return did;
 }
 
 static void solve_check_neighbours_count(
-    game_state *state, int start, int step, int n, int clueindex,
-    bool *onefill, bool *oneempty)
+    game_state *state, int n, int clueindex, bool *onefill, bool *oneempty,
+    struct solver_scratch *sc)
 {
     int to_fill = state->numbers->numbers[clueindex];
     int to_empty = n - to_fill;
-    int i;
-    for (i = 0; i < n; i++) {
-        int p = start + i*step;
-        if (state->sflags[p] & S_TRACK)
-            to_fill--;
-        if (state->sflags[p] & S_NOTRACK)
-            to_empty--;
-    }
+
+    to_fill -= sc->ntrack[clueindex];
+    to_empty -= sc->nnotrack[clueindex];
     *onefill = (to_fill == 1);
     *oneempty = (to_empty == 1);
 }
@@ -1232,7 +1314,8 @@ static void solve_check_neighbours_count(
 static int solve_check_neighbours_try(game_state *state, int x, int y,
                                       int X, int Y, bool onefill,
                                       bool oneempty, unsigned dir,
-                                      const char *what)
+                                      const char *what,
+                                      struct solver_scratch *sc)
 {
     int w = state->p.w, p = y*w+x, P = Y*w+X;
 
@@ -1264,7 +1347,7 @@ static int solve_check_neighbours_try(game_state *state, int x, int y,
     int did = 0;
     if (onefill) {
         /* But at most one of them can be filled, so it can't be p. */
-        state->sflags[p] |= S_NOTRACK;
+        solve_add_sflag(state, p, S_NOTRACK, sc);
         solverdebug(("square (%d,%d) -> NOTRACK: otherwise, that and (%d,%d) "
                      "would make too many TRACK in %s", x, y, X, Y, what));
         did++;
@@ -1272,7 +1355,7 @@ static int solve_check_neighbours_try(game_state *state, int x, int y,
     if (oneempty) {
         /* Alternatively, at least one of them _must_ be filled, so P
          * must be. */
-        state->sflags[P] |= S_TRACK;
+        solve_add_sflag(state, P, S_TRACK, sc);
         solverdebug(("square (%d,%d) -> TRACK: otherwise, that and (%d,%d) "
                      "would make too many NOTRACK in %s", X, Y, x, y, what));
         did++;
@@ -1280,43 +1363,49 @@ static int solve_check_neighbours_try(game_state *state, int x, int y,
     return did;
 }
 
-static int solve_check_neighbours(game_state *state, bool both_ways)
+static int solve_check_neighbours(game_state *state, bool both_ways,
+                                  struct solver_scratch *sc)
 {
     int w = state->p.w, h = state->p.h, x, y, did = 0;
+    unsigned rule = both_ways ? LD_NEIGHBOURS2 : LD_NEIGHBOURS;
     bool onefill, oneempty;
 
     for (x = 0; x < w; x++) {
-        solve_check_neighbours_count(state, x, w, h, x, &onefill, &oneempty);
+        if (!solve_line_dirty(sc, x, rule))
+            continue;
+        solve_check_neighbours_count(state, h, x, &onefill, &oneempty, sc);
         if (!both_ways)
             oneempty = false; /* disable the harder version of the deduction */
         if (!onefill && !oneempty)
             continue;
         for (y = 0; y+1 < h; y++) {
             did += solve_check_neighbours_try(state, x, y, x, y+1,
-                                              onefill, oneempty, D, "column");
+                                              onefill, oneempty, D, "column", sc);
             did += solve_check_neighbours_try(state, x, y+1, x, y,
-                                              onefill, oneempty, U, "column");
+                                              onefill, oneempty, U, "column", sc);
         }
     }
     for (y = 0; y < h; y++) {
-        solve_check_neighbours_count(state, y*w, 1, w, w+y,
-                                     &onefill, &oneempty);
+        if (!solve_line_dirty(sc, w+y, rule))
+            continue;
+        solve_check_neighbours_count(state, w, w+y, &onefill, &oneempty, sc);
         if (!both_ways)
             oneempty = false; /* disable the harder version of the deduction */
         if (!onefill && !oneempty)
             continue;
         for (x = 0; x+1 < w; x++) {
             did += solve_check_neighbours_try(state, x, y, x+1, y,
-                                              onefill, oneempty, R, "row");
+                                              onefill, oneempty, R, "row", sc);
             did += solve_check_neighbours_try(state, x+1, y, x, y,
-                                              onefill, oneempty, L, "row");
+                                              onefill, oneempty, L, "row", sc);
         }
     }
     return did;
 }
 
 static int solve_check_loop_sub(game_state *state, int x, int y, int dir,
-                                DSF *dsf, int startc, int endc)
+                                DSF *dsf, int startc, int endc,
+                                struct solver_scratch *sc)
 {
     int w = state->p.w, h = state->p.h, i = y*w+x, j, k;
     bool satisfied = true;
@@ -1331,7 +1420,8 @@ static int solve_check_loop_sub(game_state *state, int x, int y, int dir,
         !(S_E_DIRS(state, x, y, E_NOTRACK) & dir)) {
         int ic = dsf_canonify(dsf, i), jc = dsf_canonify(dsf, j);
         if (ic == jc) {
-            return solve_set_eflag(state, x, y, dir, E_NOTRACK, "would close loop");
+            return solve_set_eflag(state, x, y, dir, E_NOTRACK,
+                                   "would close loop", sc);
         }
         if ((ic == startc && jc == endc) || (ic == endc && jc == startc)) {
             solverdebug(("Adding link at (%d,%d) would join start to end", x, y));
@@ -1343,59 +1433,35 @@ static int solve_check_loop_sub(game_state *state, int x, int y, int dir,
                 if (state->sflags[k] & S_TRACK &&
                         dsf_canonify(dsf, k) != startc && dsf_canonify(dsf, k) != endc) {
                     return solve_set_eflag(state, x, y, dir, E_NOTRACK,
-                                           "joins start to end but misses tracks");
+                                           "joins start to end but misses tracks",
+                                           sc);
                 }
             }
-            for (k = 0; k < w; k++) {
-                int target = state->numbers->numbers[k];
-                int ntracks = solve_count_col(state, k, S_TRACK);
-                if (ntracks < target) satisfied = false;
-            }
-            for (k = 0; k < h; k++) {
-                int target = state->numbers->numbers[w+k];
-                int ntracks = solve_count_row(state, k, S_TRACK);
-                if (ntracks < target) satisfied = false;
+            for (k = 0; k < w+h; k++) {
+                if (sc->ntrack[k] < state->numbers->numbers[k])
+                    satisfied = false;
             }
             if (!satisfied) {
                 return solve_set_eflag(state, x, y, dir, E_NOTRACK,
-                                       "joins start to end with incomplete clues");
+                                       "joins start to end with incomplete clues",
+                                       sc);
             }
         }
     }
     return 0;
 }
 
-static int solve_check_loop(game_state *state)
+static int solve_check_loop(game_state *state, struct solver_scratch *sc)
 {
-    int w = state->p.w, h = state->p.h, x, y, i, j, did = 0;
-    DSF *dsf;
+    int w = state->p.w, h = state->p.h, x, y, did = 0;
+    DSF *dsf = sc->trackdsf;
     int startc, endc;
 
-    /* TODO eventually we should pull this out into a solver struct and keep it
-       updated as we connect squares. For now we recreate it every time we try
-       this particular solver step. */
-    dsf = dsf_new(w*h);
-
-    /* Work out the connectedness of the current loop set. */
-    for (x = 0; x < w; x++) {
-        for (y = 0; y < h; y++) {
-            i = y*w + x;
-            if (x < (w-1) && S_E_DIRS(state, x, y, E_TRACK) & R) {
-                /* connection to the right... */
-                j = y*w + (x+1);
-                assert(i < w*h && j < w*h);
-                dsf_merge(dsf, i, j);
-            }
-            if (y < (h-1) && S_E_DIRS(state, x, y, E_TRACK) & D) {
-                /* connection down... */
-                j = (y+1)*w + x;
-                assert(i < w*h && j < w*h);
-                dsf_merge(dsf, i, j);
-            }
-            /* NB no need to check up and left because they'll have been checked
-               by the other side. */
-        }
-    }
+    /* This depends on the whole grid, so there's nothing to be gained
+       by looking again unless something has changed somewhere. */
+    if (!sc->loop_dirty)
+        return 0;
+    sc->loop_dirty = false;
 
     startc = dsf_canonify(dsf, state->numbers->row_s*w);
     endc = dsf_canonify(dsf, (h-1)*w+state->numbers->col_s);
@@ -1406,24 +1472,23 @@ static int solve_check_loop(game_state *state)
     for (x = 0; x < w; x++) {
         for (y = 0; y < h; y++) {
             if (x < (w-1))
-              did += solve_check_loop_sub(state, x, y, R, dsf, startc, endc);
+              did += solve_check_loop_sub(state, x, y, R, dsf, startc, endc, sc);
             if (y < (h-1))
-              did += solve_check_loop_sub(state, x, y, D, dsf, startc, endc);
+              did += solve_check_loop_sub(state, x, y, D, dsf, startc, endc, sc);
         }
     }
 
-    dsf_free(dsf);
-
     return did;
 }
 
-static void solve_discount_edge(game_state *state, int x, int y, int d)
+static void solve_discount_edge(game_state *state, int x, int y, int d,
+                                struct solver_scratch *sc)
 {
     if (S_E_DIRS(state, x, y, E_TRACK) & d) {
         assert(state->sflags[y*state->p.w + x] & S_CLUE);
         return; /* (only) clue squares can have outer edges set. */
     }
-    solve_set_eflag(state, x, y, d, E_NOTRACK, "outer edge");
+    solve_set_eflag(state, x, y, d, E_NOTRACK, "outer edge", sc);
 }
 
 static int solve_bridge_sub(game_state *state, int x, int y, int d,
@@ -1501,7 +1566,7 @@ static int solve_bridge_sub(game_state *state, int x, int y, int d,
         }
     }
 
-    solve_set_eflag(state, x, y, d, parity ? E_TRACK : E_NOTRACK, "parity");
+    solve_set_eflag(state, x, y, d, parity ? E_TRACK : E_NOTRACK, "parity", sc);
     return 1;
 }
 
@@ -1536,13 +1601,29 @@ static int solve_check_bridge_parity(game_state *state,
                                      struct solver_scratch *sc)
 {
     int w = state->p.w, h = state->p.h, wh = w*h;
-    struct findloopstate *fls;
+    struct findloopstate *fls = sc->fls;
     struct solve_bridge_neighbour_ctx ctx[1];
-    int x, y, did = 0;
+    int i, x, y, did = 0;
 
+    /*
+     * Every bridge we found last time was filled in, so if no edge
+     * has been filled in since then, there are no bridges now.
+     * Otherwise, only the parts of the graph containing the changed
+     * edges need to be searched again.
+     */
     ctx->state = state;
-    fls = findloop_new_state(wh);
-    findloop_run(fls, wh, solve_bridge_neighbour, ctx);
+    if (!fls) {
+        fls = sc->fls = findloop_new_state(wh);
+        findloop_run(fls, wh, solve_bridge_neighbour, ctx);
+    } else if (sc->nbchanged == 0) {
+        return 0;
+    } else {
+        findloop_rerun(fls, wh, sc->bchanged, sc->nbchanged,
+                       solve_bridge_neighbour, ctx);
+    }
+    for (i = 0; i < sc->nbchanged; i++)
+        sc->sdirty[sc->bchanged[i]] &= ~SD_BRIDGE;
+    sc->nbchanged = 0;
 
     for (x = 0; x < w; x++) {
         for (y = 0; y < h; y++) {
@@ -1553,30 +1634,62 @@ static int solve_check_bridge_parity(game_state *state,
         }
     }
 
-    findloop_free_state(fls);
-
     return did;
 }
 
 static int tracks_solve(game_state *state, int diff, int *max_diff_out)
 {
-    int x, y, w = state->p.w, h = state->p.h;
+    int x, y, i, w = state->p.w, h = state->p.h, wh = w*h;
     struct solver_scratch sc[1];
     int max_diff = DIFF_EASY;
 
     sc->dsf = NULL;
+    sc->trackdsf = dsf_new(wh);
+    sc->ntrack = snewn(w+h, int);
+    sc->nnotrack = snewn(w+h, int);
+    sc->sdirty = snewn(wh, unsigned char);
+    sc->ldirty = snewn(w+h, unsigned char);
+    sc->fls = NULL;
+    sc->bchanged = snewn(wh, int);
+    sc->nbchanged = 0;
+
+    /* Every deduction starts off needing to look at everything. */
+    memset(sc->sdirty, SD_FLAGS, wh);
+    memset(sc->ldirty, LD_ALL, w+h);
+    sc->loop_dirty = true;
+
+    /* Work out the connectedness and counts of what's already there. */
+    for (i = 0; i < w+h; i++)
+        sc->ntrack[i] = sc->nnotrack[i] = 0;
+    for (x = 0; x < w; x++) {
+        for (y = 0; y < h; y++) {
+            i = y*w + x;
+            if (x < (w-1) && S_E_DIRS(state, x, y, E_TRACK) & R)
+                dsf_merge(sc->trackdsf, i, i+1);
+            if (y < (h-1) && S_E_DIRS(state, x, y, E_TRACK) & D)
+                dsf_merge(sc->trackdsf, i, i+w);
+            if (state->sflags[i] & S_TRACK) {
+                sc->ntrack[x]++;
+                sc->ntrack[w+y]++;
+            }
+            if (state->sflags[i] & S_NOTRACK) {
+                sc->nnotrack[x]++;
+                sc->nnotrack[w+y]++;
+            }
+        }
+    }
 
     debug(("solve..."));
     state->impossible = false;
 
     /* Set all the outer border edges as no-track. */
     for (x = 0; x < w; x++) {
-        solve_discount_edge(state, x, 0, U);
-        solve_discount_edge(state, x, h-1, D);
+        solve_discount_edge(state, x, 0, U, sc);
+        solve_discount_edge(state, x, h-1, D, sc);
     }
     for (y = 0; y < h; y++) {
-        solve_discount_edge(state, 0, y, L);
-        solve_discount_edge(state, w-1, y, R);
+        solve_discount_edge(state, 0, y, L, sc);
+        solve_discount_edge(state, w-1, y, R, sc);
     }
 
     while (!state->impossible) {
@@ -1589,15 +1702,15 @@ static int tracks_solve(game_state *state, int diff, int *max_diff_out)
             continue;                                   \
         } else ((void)0)
 
-        TRY(DIFF_EASY, solve_update_flags(state));
-        TRY(DIFF_EASY, solve_count_clues(state));
-        TRY(DIFF_EASY, solve_check_loop(state));
+        TRY(DIFF_EASY, solve_update_flags(state, sc));
+        TRY(DIFF_EASY, solve_count_clues(state, sc));
+        TRY(DIFF_EASY, solve_check_loop(state, sc));
 
-        TRY(DIFF_TRICKY, solve_check_single(state));
-        TRY(DIFF_TRICKY, solve_check_loose_ends(state));
-        TRY(DIFF_TRICKY, solve_check_neighbours(state, false));
+        TRY(DIFF_TRICKY, solve_check_single(state, sc));
+        TRY(DIFF_TRICKY, solve_check_loose_ends(state, sc));
+        TRY(DIFF_TRICKY, solve_check_neighbours(state, false, sc));
 
-        TRY(DIFF_HARD, solve_check_neighbours(state, true));
+        TRY(DIFF_HARD, solve_check_neighbours(state, true, sc));
         TRY(DIFF_HARD, solve_check_bridge_parity(state, sc));
 
 #undef TRY
@@ -1606,11 +1719,19 @@ static int tracks_solve(game_state *state, int diff, int *max_diff_out)
     }
 
     dsf_free(sc->dsf);
+    dsf_free(sc->trackdsf);
+    sfree(sc->ntrack);
+    sfree(sc->nnotrack);
+    sfree(sc->sdirty);
+    sfree(sc->ldirty);
+    if (sc->fls)
+        findloop_free_state(sc->fls);
+    sfree(sc->bchanged);
 
     if (max_diff_out)
         *max_diff_out = max_diff;
 
-    return state->impossible ? -1 : check_completion(state, false) ? 1 : 0;
+    return state->impossible ? -1 : check_solved(state) ? 1 : 0;
 }
 
 static char *move_string_diff(const game_state *before, const game_state *after, bool issolve)
@@ -1687,6 +1808,24 @@ static char *solve_game(const game_state *state, const game_state *currstate,
     return move;
 }
 
+static char *grade_game(const game_state *state, const char **error)
+{
+    game_state *solved = dup_game(state);
+    int ret, diff;
+
+    ret = tracks_solve(solved, DIFFCOUNT, &diff);
+    free_game(solved);
+
+    if (ret < 0) {
+        *error = "No solution exists for this puzzle";
+        return NULL;
+    } else if (ret == 0) {
+        *error = "Unable to find solution";
+        return NULL;
+    }
+    return dupstr(tracks_diffnames[diff]);
+}
+
 static bool game_can_format_as_text_now(const game_params *params)
 {
     return true;
@@ -1854,28 +1993,25 @@ static void set_flash_data(game_state *state)
     } while (INGRID(state, x, y));
 }
 
-static bool check_completion(game_state *state, bool mark)
+/*
+ * Mark the squares whose track is in error - branching, part of a
+ * loop, or (once there is a route from A to B) off that route - and
+ * return whether there were none and the route exists.
+ */
+static bool check_route(game_state *state)
 {
-    int w = state->p.w, h = state->p.h, x, y, i, target;
-    bool ret = true, pathret;
-    int ntrack, nnotrack, ntrackcomplete;
+    int w = state->p.w, h = state->p.h, x, y, i;
+    bool ret = true;
     DSF *dsf;
     int pathclass;
     struct findloopstate *fls;
     struct tracks_neighbour_ctx ctx;
 
-    if (mark) {
-        for (i = 0; i < w+h; i++) {
-            state->num_errors[i] = 0;
-        }
-        for (i = 0; i < w*h; i++) {
-            state->sflags[i] &= ~S_ERROR;
-            if (S_E_COUNT(state, i%w, i/w, E_TRACK) > 0) {
-                if (S_E_COUNT(state, i%w, i/w, E_TRACK) > 2) {
-                    ret = false;
-                    state->sflags[i] |= S_ERROR;
-                }
-            }
+    for (i = 0; i < w*h; i++) {
+        state->sflags[i] &= ~S_ERROR;
+        if (S_E_COUNT(state, i%w, i/w, E_TRACK) > 2) {
+            ret = false;
+            state->sflags[i] |= S_ERROR;
         }
     }
 
@@ -1893,114 +2029,147 @@ static bool check_completion(game_state *state, bool mark)
     if (findloop_run(fls, w*h, tracks_neighbour, &ctx)) {
         debug(("loop detected, not complete"));
         ret = false; /* no loop allowed */
-        if (mark) {
-            for (x = 0; x < w; x++) {
-                for (y = 0; y < h; y++) {
-                    int u, v;
-
-                    u = y*w + x;
-                    for (v = tracks_neighbour(u, &ctx); v >= 0;
-                         v = tracks_neighbour(-1, &ctx))
-                        if (findloop_is_loop_edge(fls, u, v))
-                            state->sflags[y*w+x] |= S_ERROR;
-                }
+        for (x = 0; x < w; x++) {
+            for (y = 0; y < h; y++) {
+                int u, v;
+
+                u = y*w + x;
+                for (v = tracks_neighbour(u, &ctx); v >= 0;
+                     v = tracks_neighbour(-1, &ctx))
+                    if (findloop_is_loop_edge(fls, u, v))
+                        state->sflags[y*w+x] |= S_ERROR;
             }
         }
     }
     findloop_free_state(fls);
 
-    if (mark) {
-        pathclass = dsf_canonify(dsf, state->numbers->row_s*w);
-        if (pathclass == dsf_canonify(dsf, (h-1)*w + state->numbers->col_s)) {
-            /* We have a continuous path between the entrance and the exit: any
-               other path must be in error. */
-            for (i = 0; i < w*h; i++) {
-                if ((dsf_canonify(dsf, i) != pathclass) &&
-                    ((state->sflags[i] & S_TRACK) ||
-                     (S_E_COUNT(state, i%w, i/w, E_TRACK) > 0))) {
-                    ret = false;
-                    state->sflags[i] |= S_ERROR;
-                }
+    pathclass = dsf_canonify(dsf, state->numbers->row_s*w);
+    if (pathclass == dsf_canonify(dsf, (h-1)*w + state->numbers->col_s)) {
+        /* We have a continuous path between the entrance and the exit: any
+           other path must be in error. */
+        for (i = 0; i < w*h; i++) {
+            if ((dsf_canonify(dsf, i) != pathclass) &&
+                ((state->sflags[i] & S_TRACK) ||
+                 (S_E_COUNT(state, i%w, i/w, E_TRACK) > 0))) {
+                ret = false;
+                state->sflags[i] |= S_ERROR;
             }
-        } else {
-            /* If we _don't_ have such a path, then certainly the game
-             * can't be in a winning state. So even if we're not
-             * highlighting any _errors_, we certainly shouldn't
-             * return true. */
-            ret = false;
         }
+    } else {
+        /* If we _don't_ have such a path, then certainly the game
+         * can't be in a winning state. So even if we're not
+         * highlighting any _errors_, we certainly shouldn't
+         * return true. */
+        ret = false;
     }
 
-    /*
-     * A cell is 'complete', for the purposes of marking the game as
-     * finished, if it has two edges marked as TRACK. But it only has
-     * to have one edge marked as TRACK, or be filled in as trackful
-     * without any specific edges known, to count towards checking
-     * row/column clue errors.
-     *
-     * This changes if we haven't found any other errors by this
-     * point, so the player has constructed a route from A to B.  In
-     * that case, we highlight any row/column where the actually laid
-     * tracks don't match the clue.
-     */
-    pathret = ret; /* Do we have a plausible solution so far? */
-    for (x = 0; x < w; x++) {
-        target = state->numbers->numbers[x];
-        ntrack = nnotrack = ntrackcomplete = 0;
-        for (y = 0; y < h; y++) {
-            if (S_E_COUNT(state, x, y, E_TRACK) > 0 ||
-                state->sflags[y*w+x] & S_TRACK)
-                ntrack++;
-            if (S_E_COUNT(state, x, y, E_TRACK) == 2)
-                ntrackcomplete++;
-            if (state->sflags[y*w+x] & S_NOTRACK)
-                nnotrack++;
-        }
-        if (mark) {
-            if (ntrack > target || nnotrack > (h-target) ||
-                (pathret && ntrackcomplete != target)) {
-                debug(("col %d error: target %d, track %d, notrack %d, "
-                       "pathret %d, trackcomplete %d",
-                       x, target, ntrack, nnotrack, pathret, ntrackcomplete));
-                state->num_errors[x] = 1;
-                ret = false;
-            }
-        }
-        if (ntrackcomplete != target)
-            ret = false;
+    dsf_free(dsf);
+    return ret;
+}
+
+/*
+ * Count the squares in a line (columns first, then rows) with track,
+ * without track, and with a complete piece of track.
+ *
+ * A cell is 'complete', for the purposes of marking the game as
+ * finished, if it has two edges marked as TRACK. But it only has
+ * to have one edge marked as TRACK, or be filled in as trackful
+ * without any specific edges known, to count towards checking
+ * row/column clue errors.
+ */
+static void count_line(const game_state *state, int line, int *ntrack,
+                       int *nnotrack, int *ntrackcomplete)
+{
+    int w = state->p.w, h = state->p.h, x, y, dx, dy, len;
+
+    if (line < w) {
+        x = line; y = 0; dx = 0; dy = 1; len = h;
+    } else {
+        x = 0; y = line - w; dx = 1; dy = 0; len = w;
     }
-    for (y = 0; y < h; y++) {
-        target = state->numbers->numbers[w+y];
-        ntrack = nnotrack = ntrackcomplete = 0;
-        for (x = 0; x < w; x++) {
-            if (S_E_COUNT(state, x, y, E_TRACK) > 0 ||
-                state->sflags[y*w+x] & S_TRACK)
-                ntrack++;
-            if (S_E_COUNT(state, x, y, E_TRACK) == 2)
-                ntrackcomplete++;
-            if (state->sflags[y*w+x] & S_NOTRACK)
-                nnotrack++;
-        }
-        if (mark) {
-            if (ntrack > target || nnotrack > (w-target) ||
-                (pathret && ntrackcomplete != target)) {
-                debug(("row %d error: target %d, track %d, notrack %d, "
-                       "pathret %d, trackcomplete %d",
-                       y, target, ntrack, nnotrack, pathret, ntrackcomplete));
-                state->num_errors[w+y] = 1;
-                ret = false;
-            }
+    *ntrack = *nnotrack = *ntrackcomplete = 0;
+    for (; len > 0; len--, x += dx, y += dy) {
+        if (S_E_COUNT(state, x, y, E_TRACK) > 0 ||
+            state->sflags[y*w+x] & S_TRACK)
+            (*ntrack)++;
+        if (S_E_COUNT(state, x, y, E_TRACK) == 2)
+            (*ntrackcomplete)++;
+        if (state->sflags[y*w+x] & S_NOTRACK)
+            (*nnotrack)++;
+    }
+}
+
+/*
+ * unitcheck function for a line's clue. Once the player has
+ * constructed a route from A to B without any other errors, we
+ * highlight any row/column where the actually laid tracks don't
+ * match the clue.
+ */
+static int check_line(void *vstate, int line)
+{
+    const game_state *state = (const game_state *)vstate;
+    int w = state->p.w, h = state->p.h, len = (line < w ? h : w);
+    int target = state->numbers->numbers[line];
+    int ntrack, nnotrack, ntrackcomplete;
+
+    count_line(state, line, &ntrack, &nnotrack, &ntrackcomplete);
+    if (ntrack > target || nnotrack > (len-target) ||
+        (state->route_ok && ntrackcomplete != target)) {
+        debug(("line %d error: target %d, track %d, notrack %d, "
+               "route_ok %d, trackcomplete %d", line, target, ntrack,
+               nnotrack, state->route_ok, ntrackcomplete));
+        return UNIT_ERROR;
+    }
+    return ntrackcomplete == target ? UNIT_OK : UNIT_INCOMPLETE;
+}
+
+/*
+ * Bring the error highlights and completion flag up to date after a
+ * move. The route needs rechecking only if the move changed some
+ * track; the clues need rechecking only for the lines the move
+ * touched, unless the route's status changed, which affects all of
+ * them.
+ */
+static void check_completion(game_state *state, bool route_changed)
+{
+    int w = state->p.w, h = state->p.h;
+
+    if (route_changed) {
+        bool route_ok = check_route(state);
+        if (route_ok != state->route_ok) {
+            state->route_ok = route_ok;
+            unitcheck_touch_all(state->lines);
         }
-        if (ntrackcomplete != target)
-            ret = false;
     }
+    unitcheck_run(state->lines, check_line, state);
+
+    state->completed = state->route_ok &&
+        unitcheck_count(state->lines, UNIT_OK) == w+h;
+    if (state->completed) set_flash_data(state);
+}
+
+/* The solver's test: no loops, and every clue met by complete track. */
+static bool check_solved(game_state *state)
+{
+    int w = state->p.w, h = state->p.h, line;
+    int ntrack, nnotrack, ntrackcomplete;
+    struct findloopstate *fls;
+    struct tracks_neighbour_ctx ctx;
+    bool loop;
+
+    fls = findloop_new_state(w*h);
+    ctx.state = state;
+    loop = findloop_run(fls, w*h, tracks_neighbour, &ctx);
+    findloop_free_state(fls);
+    if (loop)
+        return false;
 
-    if (mark) {
-        state->completed = ret;
-        if (ret) set_flash_data(state);
+    for (line = 0; line < w+h; line++) {
+        count_line(state, line, &ntrack, &nnotrack, &ntrackcomplete);
+        if (ntrackcomplete != state->numbers->numbers[line])
+            return false;
     }
-    dsf_free(dsf);
-    return ret;
+    return true;
 }
 
 /* Code borrowed from Pearl. */
@@ -2403,12 +2572,21 @@ static char *interpret_move(const game_state *state, game_ui *ui,
     return NULL;
 }
 
+/* Mark a square's row and column for rechecking, if it's on the grid. */
+static void touch_square(game_state *state, int x, int y)
+{
+    if (INGRID(state, x, y)) {
+        unitcheck_touch(state->lines, x);
+        unitcheck_touch(state->lines, state->p.w + y);
+    }
+}
+
 static game_state *execute_move(const game_state *state, const char *move)
 {
     int w = state->p.w, x, y, n, i;
     char c, d;
     unsigned f;
-    bool move_is_solve = false;
+    bool move_is_solve = false, route_changed = false;
     game_state *ret = dup_game(state);
 
     /* this is breaking the bank on GTK, which vsprintf's into a fixed-size buffer
@@ -2429,6 +2607,8 @@ static game_state *execute_move(const game_state *state, const char *move)
             if (!INGRID(state, x, y)) goto badmove;
 
             f = (c == 'T' || c == 't') ? S_TRACK : S_NOTRACK;
+            if (f == S_TRACK)
+                route_changed = true;
 
             if (d == 'S') {
                 if (!ui_can_flip_square(ret, x, y, f == S_NOTRACK) &&
@@ -2438,6 +2618,7 @@ static game_state *execute_move(const game_state *state, const char *move)
                     ret->sflags[y*w+x] |= f;
                 else
                     ret->sflags[y*w+x] &= ~f;
+                touch_square(ret, x, y);
             } else if (d == 'U' || d == 'D' || d == 'L' || d == 'R') {
                 for (i = 0; i < 4; i++) {
                     unsigned df = 1<<i;
@@ -2450,6 +2631,8 @@ static game_state *execute_move(const game_state *state, const char *move)
                             S_E_SET(ret, x, y, df, f);
                         else
                             S_E_CLEAR(ret, x, y, df, f);
+                        touch_square(ret, x, y);
+                        touch_square(ret, x + DX(df), y + DY(df));
                     }
                 }
             } else
@@ -2457,6 +2640,8 @@ static game_state *execute_move(const game_state *state, const char *move)
             move += n;
         } else if (c == 'H') {
             tracks_solve(ret, DIFFCOUNT, NULL);
+            unitcheck_touch_all(ret->lines);
+            route_changed = true;
             move++;
         } else {
             goto badmove;
@@ -2467,7 +2652,7 @@ static game_state *execute_move(const game_state *state, const char *move)
             goto badmove;
     }
 
-    check_completion(ret, true);
+    check_completion(ret, route_changed);
 
     return ret;
 
@@ -2889,8 +3074,9 @@ static void game_redraw(drawing *dr, game_drawstate *ds, const game_state *oldst
     }
 
     for (i = 0; i < w+h; i++) {
-        if (force || (state->num_errors[i] != ds->num_errors[i])) {
-            ds->num_errors[i] = state->num_errors[i];
+        int err = (unitcheck_status(state->lines, i) == UNIT_ERROR);
+        if (force || (err != ds->num_errors[i])) {
+            ds->num_errors[i] = err;
             draw_clue(dr, ds, w, state->numbers->numbers[i], i,
                       ds->num_errors[i] ? COL_ERROR : COL_CLUE,
 		      ds->num_errors[i] ? COL_ERROR_BACKGROUND : COL_BACKGROUND);
@@ -3050,7 +3236,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    NULL, /* solve_step */
+    grade_game,
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
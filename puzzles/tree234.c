@@ -48,6 +48,128 @@ static void logprintf(const char *fmt, ...)
 #define LOG(x)
 #endif
 
+/*
+ * Nodes are not allocated individually. Each tree draws them from a
+ * pool, which hands them out of geometrically growing blocks and
+ * keeps a free list (threaded through the parent pointers) of nodes
+ * released by deletion. Freeing a tree then only has to free the
+ * blocks, rather than walking every node.
+ *
+ * A pool can be shared by more than one tree: splitting a tree
+ * leaves both halves in the original pool, since their nodes are
+ * interleaved within its blocks. The pool is freed when the last
+ * tree using it goes away.
+ */
+#define POOL234_MINBLOCK 16
+#define POOL234_MAXBLOCK 4096
+
+struct pool234block {
+    struct pool234block *next;
+    node234 *nodes;
+};
+
+struct pool234_Tag {
+    int refcount;		       /* number of trees using the pool */
+    node234 *freelist;
+    struct pool234block *blocks;       /* most recent first */
+    int used, size;		       /* occupancy of blocks->nodes */
+};
+
+static pool234 *newpool234(void) {
+    pool234 *pool = snew(pool234);
+    pool->refcount = 1;
+    pool->freelist = NULL;
+    pool->blocks = NULL;
+    pool->used = pool->size = 0;
+    return pool;
+}
+
+static void unrefpool234(pool234 *pool) {
+    assert(pool->refcount > 0);
+    if (--pool->refcount == 0) {
+	while (pool->blocks) {
+	    struct pool234block *b = pool->blocks;
+	    pool->blocks = b->next;
+	    sfree(b->nodes);
+	    sfree(b);
+	}
+	sfree(pool);
+    }
+}
+
+static node234 *allocnode234(pool234 *pool) {
+    node234 *n;
+
+    if (pool->freelist) {
+	n = pool->freelist;
+	pool->freelist = n->parent;
+	return n;
+    }
+
+    if (pool->used == pool->size) {
+	struct pool234block *b = snew(struct pool234block);
+	int size = pool->size * 2;
+	if (size < POOL234_MINBLOCK)
+	    size = POOL234_MINBLOCK;
+	if (size > POOL234_MAXBLOCK)
+	    size = POOL234_MAXBLOCK;
+	b->nodes = snewn(size, node234);
+	b->next = pool->blocks;
+	pool->blocks = b;
+	pool->used = 0;
+	pool->size = size;
+    }
+
+    return &pool->blocks->nodes[pool->used++];
+}
+
+static void releasenode234(pool234 *pool, node234 *n) {
+    n->parent = pool->freelist;
+    pool->freelist = n;
+}
+
+/*
+ * Move all the storage in pool `from' into pool `into', and free
+ * `from'. Only valid if nothing else still refers to `from'.
+ */
+static void mergepool234(pool234 *into, pool234 *from) {
+    struct pool234block *last;
+
+    assert(from->refcount == 1);
+
+    /* Unused tail of from's current block goes on the free list. */
+    while (from->used < from->size)
+	releasenode234(from, &from->blocks->nodes[from->used++]);
+
+    if (from->blocks) {
+	/*
+	 * Keep into's current block at the head of its list, so
+	 * that its used/size fields stay meaningful.
+	 */
+	for (last = from->blocks; last->next; last = last->next)
+	    continue;
+	if (into->blocks) {
+	    last->next = into->blocks->next;
+	    into->blocks->next = from->blocks;
+	} else {
+	    into->blocks = from->blocks;
+	    into->used = into->size = 0;
+	}
+	from->blocks = NULL;
+    }
+
+    if (from->freelist) {
+	node234 *n;
+	for (n = from->freelist; n->parent; n = n->parent)
+	    continue;
+	n->parent = into->freelist;
+	into->freelist = from->freelist;
+	from->freelist = NULL;
+    }
+
+    sfree(from);
+}
+
 /*
  * Create a 2-3-4 tree.
  */
@@ -56,26 +178,97 @@ tree234 *newtree234(cmpfn234 cmp) {
     LOG(("created tree %p\n", ret));
     ret->root = NULL;
     ret->cmp = cmp;
+    ret->pool = newpool234();
     return ret;
 }
 
 /*
  * Free a 2-3-4 tree (not including freeing the elements).
  */
-static void freenode234(node234 *n) {
+static void freenode234(pool234 *pool, node234 *n) {
     if (!n)
 	return;
-    freenode234(n->kids[0]);
-    freenode234(n->kids[1]);
-    freenode234(n->kids[2]);
-    freenode234(n->kids[3]);
-    sfree(n);
+    freenode234(pool, n->kids[0]);
+    freenode234(pool, n->kids[1]);
+    freenode234(pool, n->kids[2]);
+    freenode234(pool, n->kids[3]);
+    releasenode234(pool, n);
 }
 void freetree234(tree234 *t) {
-    freenode234(t->root);
+    /*
+     * If another tree still shares our pool, hand our nodes back
+     * to it individually; otherwise they all go with the pool.
+     */
+    if (t->pool->refcount > 1)
+	freenode234(t->pool, t->root);
+    unrefpool234(t->pool);
     sfree(t);
 }
 
+/*
+ * Build a subtree of the given depth (0 meaning a leaf) containing
+ * exactly the n elements starting at elems, splitting them as
+ * evenly as possible between the fewest children that can hold
+ * them.
+ */
+static node234 *buildnode234(pool234 *pool, void **elems, int n, int depth) {
+    node234 *node = allocnode234(pool);
+    int i, k, cap, sub, extra;
+
+    node->parent = NULL;
+    for (i = 0; i < 4; i++) {
+	node->kids[i] = NULL;
+	node->counts[i] = 0;
+    }
+    for (i = 0; i < 3; i++)
+	node->elems[i] = NULL;
+
+    if (depth == 0) {
+	assert(n >= 1 && n <= 3);
+	for (i = 0; i < n; i++)
+	    node->elems[i] = elems[i];
+	return node;
+    }
+
+    /* Largest number of elements a subtree one level down can hold. */
+    for (cap = 1, i = 0; i < depth; i++)
+	cap *= 4;
+    cap--;
+
+    for (k = 2; k < 4 && n - (k-1) > k * cap; k++)
+	continue;
+    assert(n - (k-1) <= k * cap);
+
+    sub = (n - (k-1)) / k;
+    extra = (n - (k-1)) % k;
+    for (i = 0; i < k; i++) {
+	int size = sub + (i < extra ? 1 : 0);
+	node->kids[i] = buildnode234(pool, elems, size, depth-1);
+	node->kids[i]->parent = node;
+	node->counts[i] = size;
+	elems += size;
+	if (i < k-1)
+	    node->elems[i] = *elems++;
+    }
+    return node;
+}
+tree234 *buildsorted234(cmpfn234 cmp, void **elems, int n) {
+    tree234 *t = newtree234(cmp);
+    int depth, cap;
+
+    if (n > 0) {
+	/*
+	 * Use the smallest height at which n elements fit. Every
+	 * subtree then ends up with at least the 2^(depth+1)-1
+	 * elements that height requires.
+	 */
+	for (depth = 0, cap = 3; cap < n; depth++)
+	    cap = cap * 4 + 3;
+	t->root = buildnode234(t->pool, elems, n, depth);
+    }
+    return t;
+}
+
 /*
  * Internal function to count a node.
  */
@@ -106,8 +299,8 @@ int count234(tree234 *t) {
  * Propagate a node overflow up a tree until it stops. Returns 0 or
  * 1, depending on whether the root had to be split or not.
  */
-static int add234_insert(node234 *left, void *e, node234 *right,
-			 node234 **root, node234 *n, int ki) {
+static int add234_insert(pool234 *pool, node234 *left, void *e,
+			 node234 *right, node234 **root, node234 *n, int ki) {
     int lcount, rcount;
     /*
      * We need to insert the new left/element/right set in n at
@@ -179,7 +372,7 @@ static int add234_insert(node234 *left, void *e, node234 *right,
 	    LOG(("  done\n"));
 	    break;
 	} else {
-	    node234 *m = snew(node234);
+	    node234 *m = allocnode234(pool);
 	    m->parent = n->parent;
 	    LOG(("  splitting a 4-node; created new node %p\n", m));
 	    /*
@@ -275,7 +468,7 @@ static int add234_insert(node234 *left, void *e, node234 *right,
 	return 0;		       /* root unchanged */
     } else {
 	LOG(("  root is overloaded, split into two\n"));
-	(*root) = snew(node234);
+	(*root) = allocnode234(pool);
 	(*root)->kids[0] = left;     (*root)->counts[0] = lcount;
 	(*root)->elems[0] = e;
 	(*root)->kids[1] = right;    (*root)->counts[1] = rcount;
@@ -306,7 +499,7 @@ static void *add234_internal(tree234 *t, void *e, int index) {
 
     LOG(("adding element \"%s\" to tree %p\n", e, t));
     if (t->root == NULL) {
-	t->root = snew(node234);
+	t->root = allocnode234(t->pool);
 	t->root->elems[1] = t->root->elems[2] = NULL;
 	t->root->kids[0] = t->root->kids[1] = NULL;
 	t->root->kids[2] = t->root->kids[3] = NULL;
@@ -374,7 +567,7 @@ static void *add234_internal(tree234 *t, void *e, int index) {
 	n = n->kids[ki];
     } while (n);
 
-    add234_insert(NULL, e, NULL, &t->root, n, ki);
+    add234_insert(t->pool, NULL, e, NULL, &t->root, n, ki);
 
     return orig_e;
 }
@@ -771,7 +964,8 @@ static void trans234_subtree_left(node234 *n, int ki, int *k, int *index) {
  *   /     \       ->        |
  *  a   b B c C d      a A b B c C d
  */
-static void trans234_subtree_merge(node234 *n, int ki, int *k, int *index) {
+static void trans234_subtree_merge(pool234 *pool, node234 *n, int ki,
+				  int *k, int *index) {
     node234 *left, *right;
     int i, leftlen, rightlen, lsize, rsize;
 
@@ -815,7 +1009,7 @@ static void trans234_subtree_merge(node234 *n, int ki, int *k, int *index) {
 
     n->counts[ki] += rightlen + 1;
 
-    sfree(right);
+    releasenode234(pool, right);
 
     /*
      * Move the rest of n up by one.
@@ -942,7 +1136,8 @@ static void *delpos234_internal(tree234 *t, int index) {
 		 * ki is small with only small neighbours. Pick a
 		 * neighbour and merge with it.
 		 */
-		trans234_subtree_merge(n, ki>0 ? ki-1 : ki, &ki, &index);
+		trans234_subtree_merge(t->pool, n, ki>0 ? ki-1 : ki,
+				       &ki, &index);
 		sub = n->kids[ki];
 
 		if (!n->elems[0]) {
@@ -953,7 +1148,7 @@ static void *delpos234_internal(tree234 *t, int index) {
 		    LOG(("  shifting root!\n"));
 		    t->root = sub;
 		    sub->parent = NULL;
-		    sfree(n);
+		    releasenode234(t->pool, n);
 		    n = NULL;
 		}
 	    }
@@ -985,7 +1180,7 @@ static void *delpos234_internal(tree234 *t, int index) {
     if (!n->elems[0]) {
 	LOG(("  removed last element in tree, destroying empty root\n"));
 	assert(n == t->root);
-	sfree(n);
+	releasenode234(t->pool, n);
 	t->root = NULL;
     }
 
@@ -1017,7 +1212,7 @@ void *del234(tree234 *t, void *e) {
  * resulting tree is the same height as the original larger one, or
  * one higher.
  */
-static node234 *join234_internal(node234 *left, void *sep,
+static node234 *join234_internal(pool234 *pool, node234 *left, void *sep,
 				 node234 *right, int *height) {
     node234 *root, *node;
     int relht = *height;
@@ -1032,7 +1227,7 @@ static node234 *join234_internal(node234 *left, void *sep,
 	 * nodes.
 	 */
 	node234 *newroot;
-	newroot = snew(node234);
+	newroot = allocnode234(pool);
 	newroot->kids[0] = left;     newroot->counts[0] = countnode234(left);
 	newroot->elems[0] = sep;
 	newroot->kids[1] = right;    newroot->counts[1] = countnode234(right);
@@ -1092,10 +1287,56 @@ static node234 *join234_internal(node234 *left, void *sep,
     /*
      * Now proceed as for addition.
      */
-    *height = add234_insert(left, sep, right, &root, node, ki);
+    *height = add234_insert(pool, left, sep, right, &root, node, ki);
 
     return root;
 }
+/*
+ * Before joining the nodes of tree `from' on to tree `into', make
+ * sure they live in the pool `into' will end up using.
+ */
+static node234 *rehomenode234(pool234 *into, pool234 *from, node234 *n) {
+    node234 *n2;
+    int i;
+
+    if (!n)
+	return NULL;
+    n2 = allocnode234(into);
+    *n2 = *n;
+    for (i = 0; i < 4; i++) {
+	if (n2->kids[i]) {
+	    n2->kids[i] = rehomenode234(into, from, n2->kids[i]);
+	    n2->kids[i]->parent = n2;
+	}
+    }
+    releasenode234(from, n);
+    return n2;
+}
+static void adoptnodes234(tree234 *into, tree234 *from) {
+    if (into->pool == from->pool)
+	return;			       /* nothing to do */
+
+    if (from->pool->refcount == 1) {
+	/* from's pool is all its own, so take the whole thing over. */
+	mergepool234(into->pool, from->pool);
+	from->pool = into->pool;
+	into->pool->refcount++;
+    } else if (into->pool->refcount == 1) {
+	/* Or the other way round: move into the donor's pool. */
+	mergepool234(from->pool, into->pool);
+	into->pool = from->pool;
+	into->pool->refcount++;
+    } else {
+	/*
+	 * Both pools are shared with other trees, so the donor's
+	 * nodes have to be copied across one by one.
+	 */
+	from->root = rehomenode234(into->pool, from->pool, from->root);
+	if (from->root)
+	    from->root->parent = NULL;
+    }
+}
+
 int height234(tree234 *t) {
     int level = 0;
     node234 *n = t->root;
@@ -1119,8 +1360,10 @@ tree234 *join234(tree234 *t1, tree234 *t2) {
 	}
 
 	element = delpos234(t2, 0);
+	adoptnodes234(t1, t2);
 	relht = height234(t1) - height234(t2);
-	t1->root = join234_internal(t1->root, element, t2->root, &relht);
+	t1->root = join234_internal(t1->pool, t1->root, element, t2->root,
+				    &relht);
 	t2->root = NULL;
     }
     return t1;
@@ -1139,8 +1382,10 @@ tree234 *join234r(tree234 *t1, tree234 *t2) {
 	}
 
 	element = delpos234(t1, size1-1);
+	adoptnodes234(t2, t1);
 	relht = height234(t1) - height234(t2);
-	t2->root = join234_internal(t1->root, element, t2->root, &relht);
+	t2->root = join234_internal(t2->pool, t1->root, element, t2->root,
+				    &relht);
 	t1->root = NULL;
     }
     return t2;
@@ -1209,7 +1454,7 @@ static node234 *split234_internal(tree234 *t, int index) {
 	 * new node pointers in halves[0] and halves[1], and go up
 	 * a level.
 	 */
-	sib = snew(node234);
+	sib = allocnode234(t->pool);
 	for (i = 0; i < 3; i++) {
 	    if (i+ki < 3 && n->elems[i+ki]) {
 		sib->elems[i] = n->elems[i+ki];
@@ -1284,7 +1529,7 @@ static node234 *split234_internal(tree234 *t, int index) {
 	while (halves[half] && !halves[half]->elems[0]) {
 	    LOG(("  root %p is undersize, throwing away\n", halves[half]));
 	    halves[half] = halves[half]->kids[0];
-	    sfree(halves[half]->parent);
+	    releasenode234(t->pool, halves[half]->parent);
 	    halves[half]->parent = NULL;
 	    LOG(("  new root is %p\n", halves[half]));
 	}
@@ -1341,7 +1586,7 @@ static node234 *split234_internal(tree234 *t, int index) {
 		     * Neighbour is small, or possibly neighbour is
 		     * medium and we are undersize.
 		     */
-		    trans234_subtree_merge(n, merge, NULL, NULL);
+		    trans234_subtree_merge(t->pool, n, merge, NULL, NULL);
 		    sub = n->kids[merge];
 		    if (!n->elems[0]) {
 			/*
@@ -1352,7 +1597,7 @@ static node234 *split234_internal(tree234 *t, int index) {
 			LOG(("  shifting root!\n"));
 			halves[half] = sub;
 			halves[half]->parent = NULL;
-			sfree(n);
+			releasenode234(t->pool, n);
 		    }
 		} else {
 		    /* Neighbour is big enough to move trees over. */
@@ -1376,7 +1621,10 @@ tree234 *splitpos234(tree234 *t, int index, bool before) {
     count = countnode234(t->root);
     if (index < 0 || index > count)
 	return NULL;		       /* error */
-    ret = newtree234(t->cmp);
+    ret = snew(tree234);
+    ret->cmp = t->cmp;
+    ret->pool = t->pool;	       /* both halves stay in t's pool */
+    ret->pool->refcount++;
     n = split234_internal(t, index);
     if (before) {
 	/* We want to return the ones before the index. */
@@ -1409,9 +1657,10 @@ tree234 *split234(tree234 *t, void *e, cmpfn234 cmp, int rel) {
     return splitpos234(t, index+1, before);
 }
 
-static node234 *copynode234(node234 *n, copyfn234 copyfn, void *copyfnstate) {
+static node234 *copynode234(pool234 *pool, node234 *n,
+			    copyfn234 copyfn, void *copyfnstate) {
     int i;
-    node234 *n2 = snew(node234);
+    node234 *n2 = allocnode234(pool);
 
     for (i = 0; i < 3; i++) {
 	if (n->elems[i] && copyfn)
@@ -1422,7 +1671,7 @@ static node234 *copynode234(node234 *n, copyfn234 copyfn, void *copyfnstate) {
 
     for (i = 0; i < 4; i++) {
 	if (n->kids[i]) {
-	    n2->kids[i] = copynode234(n->kids[i], copyfn, copyfnstate);
+	    n2->kids[i] = copynode234(pool, n->kids[i], copyfn, copyfnstate);
 	    n2->kids[i]->parent = n2;
 	} else {
 	    n2->kids[i] = NULL;
@@ -1437,7 +1686,7 @@ tree234 *copytree234(tree234 *t, copyfn234 copyfn, void *copyfnstate) {
 
     t2 = newtree234(t->cmp);
     if (t->root) {
-	t2->root = copynode234(t->root, copyfn, copyfnstate);
+	t2->root = copynode234(t2->pool, t->root, copyfn, copyfnstate);
 	t2->root->parent = NULL;
     } else
 	t2->root = NULL;
@@ -45,10 +45,12 @@ typedef void *(*copyfn234)(void *state, void *element);
 
 #ifdef TREE234_INTERNALS
 typedef struct node234_Tag node234;
+typedef struct pool234_Tag pool234;
 
 struct tree234_Tag {
     node234 *root;
     cmpfn234 cmp;
+    pool234 *pool;		       /* where this tree's nodes live */
 };
 
 struct node234_Tag {
@@ -69,7 +71,18 @@ int height234(tree234 *t);
 tree234 *newtree234(cmpfn234 cmp);
 
 /*
- * Free a 2-3-4 tree (not including freeing the elements).
+ * Create a 2-3-4 tree containing the n elements in `elems', in
+ * one pass and in O(n) time. If `cmp' is non-NULL, the elements
+ * must already be in strictly increasing order under it; if it is
+ * NULL, they are placed in the tree at indices 0,...,n-1 in array
+ * order. Either way, the array itself is not retained.
+ */
+tree234 *buildsorted234(cmpfn234 cmp, void **elems, int n);
+
+/*
+ * Free a 2-3-4 tree (not including freeing the elements). Tree
+ * nodes are allocated from a pool owned by the tree, so this does
+ * not normally need to walk the tree at all.
  */
 void freetree234(tree234 *t);
 
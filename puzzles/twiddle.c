@@ -542,6 +542,84 @@ static char *solve_game(const game_state *state, const game_state *currstate,
     return dupstr("S");
 }
 
+/*
+ * Hints come from a breadth-first search for the first move of a
+ * shortest solution. That covers every position of the default 3x3
+ * puzzle (9! arrangements); on bigger grids, or with orientation, it
+ * only finds one from positions a few moves from solved.
+ */
+#define HINT_MAXSTATES 400000
+
+struct hint_ctx {
+    int w, h, n;
+    bool orientable;
+    int *grid;
+};
+
+static void hint_apply(void *vctx, int move, unsigned char *cells)
+{
+    struct hint_ctx *ctx = (struct hint_ctx *)vctx;
+    int wh = ctx->w * ctx->h, nx = ctx->w - ctx->n + 1, i;
+
+    for (i = 0; i < wh; i++)
+        ctx->grid[i] = cells[i];
+    do_rotate(ctx->grid, ctx->w, ctx->h, ctx->n, ctx->orientable,
+              (move/2) % nx, (move/2) / nx, (move & 1 ? +1 : -1));
+    for (i = 0; i < wh; i++)
+        cells[i] = ctx->grid[i];
+}
+
+static bool hint_goal(void *vctx, const unsigned char *cells)
+{
+    struct hint_ctx *ctx = (struct hint_ctx *)vctx;
+    int wh = ctx->w * ctx->h, i;
+
+    for (i = 0; i < wh; i++)
+        ctx->grid[i] = cells[i];
+    return grid_complete(ctx->grid, wh, ctx->orientable);
+}
+
+static char *solve_step(const game_state *state, const game_state *currstate,
+                        const char *aux, const char **error)
+{
+    int w = currstate->w, h = currstate->h, n = currstate->n, wh = w*h;
+    int nmoves = 2 * (w-n+1) * (h-n+1);
+    struct hint_ctx ctx;
+    unsigned char *cells;
+    char buf[80];
+    int i, move;
+
+    if (grid_complete(currstate->grid, wh, currstate->orientable)) {
+        *error = "Puzzle is already solved";
+        return NULL;
+    }
+    if (wh * 4 + 3 > 255 || nmoves > 255) {
+        *error = "Puzzle is too large for hints";
+        return NULL;
+    }
+
+    ctx.w = w;
+    ctx.h = h;
+    ctx.n = n;
+    ctx.orientable = currstate->orientable;
+    ctx.grid = snewn(wh, int);
+    cells = snewn(wh, unsigned char);
+    for (i = 0; i < wh; i++)
+        cells[i] = currstate->grid[i];
+    move = shortest_first_move(cells, wh, nmoves, hint_apply, hint_goal,
+                               &ctx, HINT_MAXSTATES);
+    sfree(cells);
+    sfree(ctx.grid);
+
+    if (move < 0) {
+        *error = "Too far from the solution for a hint";
+        return NULL;
+    }
+    sprintf(buf, "M%d,%d,%d", (move/2) % (w-n+1), (move/2) / (w-n+1),
+            (move & 1 ? +1 : -1));
+    return dupstr(buf);
+}
+
 static bool game_can_format_as_text_now(const game_params *params)
 {
     return true;
@@ -1289,7 +1367,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    solve_step,
+    NULL, /* grade */
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
@@ -928,58 +928,318 @@ static bool solve_iterative(game_state *state, struct path *paths) {
     return solved;
 }
 
-static bool solve_bruteforce(game_state *state, struct path *paths) {
-    bool solved, correct;
-    int number_solutions;
-    int p,i;
+/*
+ * When solve_iterative gets stuck, we search for solutions by
+ * guessing, with constraint propagation at every step.
+ *
+ * Each path is looked at from both ends. For every cell a path passes
+ * through (counted once per visit, since a path can cross the same
+ * cell twice), we precompute the set of monsters which would be seen
+ * there from that end: zombies always, vampires before the first
+ * mirror and ghosts after it. A cell whose remaining possibilities all
+ * lie in that set is definitely seen; one with none of them in it is
+ * definitely not. Comparing those two bounds with the clue either
+ * rules the path out, or lets us force every undecided cell on it.
+ */
+struct view {
+    int clue;
+    int start, n;               /* range in bf_solver's cell/sees lists */
+};
 
-    struct guess loop;
+struct bf_solver {
+    int ncells, nviews;
+    struct view *views;
+    int *cell, *sees;           /* cell visited, and monsters seen there */
+    int *celldeg, *cellviews;   /* the views each cell takes part in */
+    int nghosts, nvampires, nzombies;
+    bool exact;             /* do the monster counts add up to the total? */
+    int *queue;
+    bool *queued;
+    int nsolutions;
+    int *solution;
+};
 
-    loop.guess = snewn(state->common->num_total,int);
-    loop.possible = snewn(state->common->num_total,int);
+static void bf_add_view(struct bf_solver *s, const struct path *path,
+                        bool forwards, int *nvisits)
+{
+    struct view *v = &s->views[s->nviews++];
+    bool mirror = false;
+    int i, k;
+
+    v->clue = forwards ? path->sightings_start : path->sightings_end;
+    v->start = *nvisits;
+    for (k = 0; k < path->length; k++) {
+        i = path->p[forwards ? k : path->length-1-k];
+        if (i == -1) {
+            mirror = true;
+        } else {
+            s->cell[*nvisits] = i;
+            s->sees[*nvisits] = 4 | (mirror ? 1 : 2);
+            (*nvisits)++;
+        }
+    }
+    v->n = *nvisits - v->start;
+}
 
-    for (i=0;i<state->common->num_total;i++) {
-        loop.possible[i] = state->guess[i];
-        switch (state->guess[i]) {
-          case 1: loop.guess[i] = 1; break;
-          case 2: loop.guess[i] = 2; break;
-          case 3: loop.guess[i] = 1; break;
-          case 4: loop.guess[i] = 4; break;
-          case 5: loop.guess[i] = 1; break;
-          case 6: loop.guess[i] = 2; break;
-          case 7: loop.guess[i] = 1; break;
+static struct bf_solver *bf_new(game_state *state, struct path *paths)
+{
+    struct bf_solver *s = snew(struct bf_solver);
+    int p, i, k, nvisits, total;
+
+    s->ncells = state->common->num_total;
+    s->nviews = 0;
+    s->views = snewn(2 * state->common->num_paths, struct view);
+
+    total = 0;
+    for (p = 0; p < state->common->num_paths; p++)
+        total += 2 * paths[p].length;
+    s->cell = snewn(total, int);
+    s->sees = snewn(total, int);
+    nvisits = 0;
+    for (p = 0; p < state->common->num_paths; p++) {
+        bf_add_view(s, &paths[p], true, &nvisits);
+        bf_add_view(s, &paths[p], false, &nvisits);
+    }
+
+    /* Index the views by the cells they pass through, as a list of
+     * view numbers for each cell with celldeg[] as offsets into it. */
+    s->celldeg = snewn(s->ncells + 1, int);
+    for (i = 0; i <= s->ncells; i++)
+        s->celldeg[i] = 0;
+    for (k = 0; k < nvisits; k++)
+        s->celldeg[s->cell[k] + 1]++;
+    for (i = 0; i < s->ncells; i++)
+        s->celldeg[i+1] += s->celldeg[i];
+    s->cellviews = snewn(nvisits + 1, int);
+    {
+        int *pos = snewn(s->ncells, int);
+        for (i = 0; i < s->ncells; i++)
+            pos[i] = s->celldeg[i];
+        for (p = 0; p < s->nviews; p++)
+            for (k = s->views[p].start;
+                 k < s->views[p].start + s->views[p].n; k++)
+                s->cellviews[pos[s->cell[k]]++] = p;
+        sfree(pos);
+    }
+
+    s->nghosts = state->common->num_ghosts;
+    s->nvampires = state->common->num_vampires;
+    s->nzombies = state->common->num_zombies;
+    s->exact = (s->nghosts + s->nvampires + s->nzombies == s->ncells);
+
+    s->queue = snewn(s->nviews, int);
+    s->queued = snewn(s->nviews, bool);
+    s->nsolutions = 0;
+    s->solution = snewn(s->ncells, int);
+
+    return s;
+}
+
+static void bf_free(struct bf_solver *s)
+{
+    sfree(s->views);
+    sfree(s->cell);
+    sfree(s->sees);
+    sfree(s->celldeg);
+    sfree(s->cellviews);
+    sfree(s->queue);
+    sfree(s->queued);
+    sfree(s->solution);
+    sfree(s);
+}
+
+/*
+ * Restrict cell i to the monsters in mask, queueing the views through
+ * it for another look. Returns false if nothing is left.
+ */
+static bool bf_restrict(struct bf_solver *s, int *possible, int i, int mask,
+                        int *qtail)
+{
+    int k;
+
+    if ((possible[i] & mask) == possible[i])
+        return true;
+    possible[i] &= mask;
+    if (!possible[i])
+        return false;
+    for (k = s->celldeg[i]; k < s->celldeg[i+1]; k++) {
+        int v = s->cellviews[k];
+        if (!s->queued[v]) {
+            s->queued[v] = true;
+            s->queue[(*qtail)++ % s->nviews] = v;
         }
     }
+    return true;
+}
 
-    solved = false;
-    number_solutions = 0;
+/*
+ * Check the monster totals. Placing the last monster of one kind
+ * rules that kind out everywhere else; if every cell's monster is
+ * counted, running out of candidates for a kind forces the rest.
+ */
+static bool bf_counts(struct bf_solver *s, int *possible, int *qtail)
+{
+    static const int kinds[3] = { 1, 2, 4 };
+    int targets[3];
+    int j, i, definite, maybe;
 
-    while (true) {
+    targets[0] = s->nghosts;
+    targets[1] = s->nvampires;
+    targets[2] = s->nzombies;
 
-        correct = true;
-        if (!check_numbers(state,loop.guess)) correct = false;
-        else 
-            for (p=0;p<state->common->num_paths;p++)
-                if (!check_solution(loop.guess,paths[p])) {
-                    correct = false; break;
+    for (j = 0; j < 3; j++) {
+        definite = maybe = 0;
+        for (i = 0; i < s->ncells; i++) {
+            if (possible[i] == kinds[j]) definite++;
+            else if (possible[i] & kinds[j]) maybe++;
+        }
+        if (definite > targets[j])
+            return false;
+        if (s->exact && definite + maybe < targets[j])
+            return false;
+        if (maybe == 0)
+            continue;
+        if (definite == targets[j]) {
+            for (i = 0; i < s->ncells; i++)
+                if (possible[i] != kinds[j] && (possible[i] & kinds[j]))
+                    if (!bf_restrict(s, possible, i, ~kinds[j], qtail))
+                        return false;
+        } else if (s->exact && definite + maybe == targets[j]) {
+            for (i = 0; i < s->ncells; i++)
+                if (possible[i] & kinds[j])
+                    if (!bf_restrict(s, possible, i, kinds[j], qtail))
+                        return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Propagate the view and count constraints until nothing changes,
+ * starting from the views through one newly decided cell, or from all
+ * of them if cell is -1. Returns false on a contradiction.
+ */
+static bool bf_propagate(struct bf_solver *s, int *possible, int cell)
+{
+    int qhead = 0, qtail = 0, v, k, lo, hi, mask;
+
+    for (v = 0; v < s->nviews; v++)
+        s->queued[v] = (cell < 0);
+    if (cell < 0) {
+        for (v = 0; v < s->nviews; v++)
+            s->queue[qtail++] = v;
+    } else {
+        for (k = s->celldeg[cell]; k < s->celldeg[cell+1]; k++) {
+            v = s->cellviews[k];
+            if (!s->queued[v]) {
+                s->queued[v] = true;
+                s->queue[qtail++] = v;
+            }
+        }
+    }
+
+    while (true) {
+        while (qhead < qtail) {
+            const struct view *vw;
+
+            v = s->queue[qhead++ % s->nviews];
+            s->queued[v] = false;
+            vw = &s->views[v];
+
+            lo = hi = 0;
+            for (k = vw->start; k < vw->start + vw->n; k++) {
+                mask = possible[s->cell[k]];
+                if (mask & s->sees[k]) {
+                    hi++;
+                    if (!(mask & ~s->sees[k])) lo++;
+                }
+            }
+            if (vw->clue < lo || vw->clue > hi)
+                return false;
+            if (lo == hi)
+                continue;
+            if (vw->clue == lo || vw->clue == hi) {
+                /* Every undecided visit must go the same way. */
+                for (k = vw->start; k < vw->start + vw->n; k++) {
+                    int i = s->cell[k];
+                    mask = possible[i];
+                    if ((mask & s->sees[k]) && (mask & ~s->sees[k]))
+                        if (!bf_restrict(s, possible, i, vw->clue == lo ?
+                                         ~s->sees[k] : s->sees[k], &qtail))
+                            return false;
                 }
-        if (correct) {
-            number_solutions++;
-            solved = true;
-            if(number_solutions > 1) {
-                solved = false;
-                break; 
             }
-            for (i=0;i<state->common->num_total;i++)
-                state->guess[i] = loop.guess[i];
         }
-        if (!next_list(&loop,state->common->num_total -1)) {
-            break;
+
+        if (!bf_counts(s, possible, &qtail))
+            return false;
+        if (qhead == qtail)
+            return true;
+    }
+}
+
+/*
+ * Search for solutions below the current possibilities, stopping as
+ * soon as we have found two.
+ */
+static void bf_search(struct bf_solver *s, int *possible, int cell)
+{
+    static const int kinds[3] = { 1, 2, 4 };
+    int i, j, best, bestn, n;
+    int *copy;
+
+    if (!bf_propagate(s, possible, cell))
+        return;
+
+    /* Guess at a cell with as few possibilities left as we can find. */
+    best = -1;
+    bestn = 4;
+    for (i = 0; i < s->ncells; i++) {
+        if (possible[i] == 1 || possible[i] == 2 || possible[i] == 4)
+            continue;
+        n = (possible[i] & 1) + ((possible[i] >> 1) & 1) +
+            ((possible[i] >> 2) & 1);
+        if (n < bestn) {
+            best = i;
+            bestn = n;
+            if (n == 2) break;
         }
     }
 
-    sfree(loop.possible);
-    sfree(loop.guess);
+    if (best < 0) {
+        if (s->nsolutions++ == 0)
+            memcpy(s->solution, possible, s->ncells * sizeof(int));
+        return;
+    }
+
+    copy = snewn(s->ncells, int);
+    for (j = 0; j < 3 && s->nsolutions < 2; j++) {
+        if (!(possible[best] & kinds[j]))
+            continue;
+        memcpy(copy, possible, s->ncells * sizeof(int));
+        copy[best] = kinds[j];
+        bf_search(s, copy, best);
+    }
+    sfree(copy);
+}
+
+static bool solve_bruteforce(game_state *state, struct path *paths) {
+    struct bf_solver *s;
+    int *possible;
+    bool solved;
+
+    s = bf_new(state, paths);
+    possible = snewn(s->ncells, int);
+    memcpy(possible, state->guess, s->ncells * sizeof(int));
+
+    bf_search(s, possible, -1);
+
+    if (s->nsolutions > 0)
+        memcpy(state->guess, s->solution, s->ncells * sizeof(int));
+    solved = (s->nsolutions == 1);
+
+    sfree(possible);
+    bf_free(s);
 
     return solved;
 }
@@ -3022,7 +3282,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     get_prefs, set_prefs,
     new_ui,
@@ -553,6 +553,23 @@ struct solver_ctx {
 
     int nlinks, alinks;
     struct solver_link *links;
+
+    /*
+     * The latin solver calls us after every deduction it makes, but
+     * most of the links (or adjacency edges) are no more use than
+     * they were last time. So we give each square a version number,
+     * bumped whenever it loses a candidate or gains a value, and
+     * each link or edge remembers the versions of its two squares
+     * when it was last looked at; if neither has changed since, it
+     * can't tell us anything new and we skip it.
+     *
+     * (Candidates are only ever removed within one solver run, so a
+     * square's candidate count and value are enough to notice a
+     * change.)
+     */
+    int *cellsig, *cellver;
+    int *linkver;             /* 2 per link */
+    int *adjver, *setver;     /* 2 per (square, direction), adjacent mode */
 };
 
 static void solver_add_link(struct solver_ctx *ctx,
@@ -584,8 +601,23 @@ static struct solver_ctx *new_ctx(game_state *state)
     ctx->links = NULL;
     ctx->state = state;
 
-    if (state->mode == MODE_ADJACENT)
-        return ctx; /* adjacent mode doesn't use links. */
+    ctx->cellsig = snewn(o*o, int);
+    ctx->cellver = snewn(o*o, int);
+    for (i = 0; i < o*o; i++) {
+        ctx->cellsig[i] = -1;          /* so the first look counts */
+        ctx->cellver[i] = 0;
+    }
+    ctx->linkver = NULL;
+    ctx->adjver = ctx->setver = NULL;
+
+    if (state->mode == MODE_ADJACENT) {
+        /* adjacent mode doesn't use links. */
+        ctx->adjver = snewn(o*o*4*2, int);
+        ctx->setver = snewn(o*o*4*2, int);
+        for (i = 0; i < o*o*4*2; i++)
+            ctx->adjver[i] = ctx->setver[i] = -1;
+        return ctx;
+    }
 
     for (x = 0; x < o; x++) {
         for (y = 0; y < o; y++) {
@@ -597,6 +629,10 @@ static struct solver_ctx *new_ctx(game_state *state)
         }
     }
 
+    ctx->linkver = snewn(ctx->nlinks*2 + 1, int);
+    for (i = 0; i < ctx->nlinks*2; i++)
+        ctx->linkver[i] = -1;
+
     return ctx;
 }
 
@@ -610,9 +646,54 @@ static void free_ctx(void *vctx)
 {
     struct solver_ctx *ctx = (struct solver_ctx *)vctx;
     if (ctx->links) sfree(ctx->links);
+    sfree(ctx->cellsig);
+    sfree(ctx->cellver);
+    sfree(ctx->linkver);
+    sfree(ctx->adjver);
+    sfree(ctx->setver);
     sfree(ctx);
 }
 
+/* Bump the version of square (x,y) if it has changed since last time. */
+static void solver_touch(struct latin_solver *solver, struct solver_ctx *ctx,
+                         int x, int y)
+{
+    int o = solver->o, n, sig = grid(x,y) << 8;
+
+    for (n = 0; n < o; n++)
+        if (cube(x,y,n+1)) sig++;
+    if (sig != ctx->cellsig[gridpos(x,y)]) {
+        ctx->cellsig[gridpos(x,y)] = sig;
+        ctx->cellver[gridpos(x,y)]++;
+    }
+}
+
+static void solver_touch_all(struct latin_solver *solver,
+                             struct solver_ctx *ctx)
+{
+    int x, y;
+
+    for (x = 0; x < solver->o; x++)
+        for (y = 0; y < solver->o; y++)
+            solver_touch(solver, ctx, x, y);
+}
+
+/*
+ * Returns false if neither of squares a and b has changed since the
+ * last call with the same 'seen' pair, which is updated either way.
+ * (It records the versions from before any deductions the caller
+ * then makes, so that, as before, a link is looked at once more after
+ * changing one of its own squares.)
+ */
+static bool solver_changed(struct solver_ctx *ctx, int *seen, int a, int b)
+{
+    if (seen[0] == ctx->cellver[a] && seen[1] == ctx->cellver[b])
+        return false;
+    seen[0] = ctx->cellver[a];
+    seen[1] = ctx->cellver[b];
+    return true;
+}
+
 static void solver_nminmax(struct latin_solver *solver,
                            int x, int y, int *min_r, int *max_r,
                            unsigned char **ns_r)
@@ -646,8 +727,16 @@ static int solver_links(struct latin_solver *solver, void *vctx)
     unsigned char *gns, *lns;
     struct solver_link *link;
 
+    solver_touch_all(solver, ctx);
+
     for (i = 0; i < ctx->nlinks; i++) {
+        int before = nchanged;
+
         link = &ctx->links[i];
+        if (!solver_changed(ctx, ctx->linkver + 2*i,
+                            gridpos(link->gx, link->gy),
+                            gridpos(link->lx, link->ly)))
+            continue;
         solver_nminmax(solver, link->gx, link->gy, NULL, &gmax, &gns);
         solver_nminmax(solver, link->lx, link->ly, &lmin, NULL, &lns);
 
@@ -689,6 +778,10 @@ static int solver_links(struct latin_solver *solver, void *vctx)
                 }
             }
         }
+        if (nchanged > before) {
+            solver_touch(solver, ctx, link->gx, link->gy);
+            solver_touch(solver, ctx, link->lx, link->ly);
+        }
     }
     return nchanged;
 }
@@ -700,6 +793,8 @@ static int solver_adjacent(struct latin_solver *solver, void *vctx)
 
     /* Update possible values based on known values and adjacency clues. */
 
+    solver_touch_all(solver, ctx);
+
     for (x = 0; x < o; x++) {
         for (y = 0; y < o; y++) {
             if (grid(x, y) == 0) continue;
@@ -710,10 +805,15 @@ static int solver_adjacent(struct latin_solver *solver, void *vctx)
             for (i = 0; i < 4; i++) {
                 bool isadjacent =
                     (GRID(ctx->state, flags, x, y) & adjthan[i].f);
+                int before = nchanged;
 
                 nx = x + adjthan[i].dx, ny = y + adjthan[i].dy;
                 if (nx < 0 || ny < 0 || nx >= o || ny >= o)
                     continue;
+                if (!solver_changed(ctx,
+                                    ctx->adjver + (gridpos(x,y)*4+i)*2,
+                                    gridpos(x,y), gridpos(nx,ny)))
+                    continue;
 
                 for (n = 0; n < o; n++) {
                     /* Continue past numbers the adjacent square _could_ be,
@@ -737,6 +837,8 @@ static int solver_adjacent(struct latin_solver *solver, void *vctx)
                     cube(nx, ny, n+1) = false;
                     nchanged++;
                 }
+                if (nchanged > before)
+                    solver_touch(solver, ctx, nx, ny);
             }
         }
     }
@@ -753,15 +855,22 @@ static int solver_adjacent_set(struct latin_solver *solver, void *vctx)
     /* Update possible values based on other possible values
      * of adjacent squares, and adjacency clues. */
 
+    solver_touch_all(solver, ctx);
+
     for (x = 0; x < o; x++) {
         for (y = 0; y < o; y++) {
             for (i = 0; i < 4; i++) {
                 bool isadjacent =
                     (GRID(ctx->state, flags, x, y) & adjthan[i].f);
+                int before = nchanged;
 
                 nx = x + adjthan[i].dx, ny = y + adjthan[i].dy;
                 if (nx < 0 || ny < 0 || nx >= o || ny >= o)
                     continue;
+                if (!solver_changed(ctx,
+                                    ctx->setver + (gridpos(x,y)*4+i)*2,
+                                    gridpos(x,y), gridpos(nx,ny)))
+                    continue;
 
                 /* We know the current possibles for the square (x,y)
                  * and also the adjacency clue from (x,y) to (nx,ny).
@@ -802,10 +911,13 @@ static int solver_adjacent_set(struct latin_solver *solver, void *vctx)
                     cube(nx, ny, n+1) = false;
                     nchanged++;
                 }
+                if (nchanged > before)
+                    solver_touch(solver, ctx, nx, ny);
             }
         }
     }
 
+    sfree(scratch);
     return nchanged;
 }
 
@@ -898,7 +1010,8 @@ static bool unequal_valid(struct latin_solver *solver, void *vctx)
     return true;
 }
 
-static int solver_state(game_state *state, int maxdiff)
+/* Returns the hardest difficulty used, or DIFF_IMPOSSIBLE etc. */
+static int solver_state_diff(game_state *state, int maxdiff)
 {
     struct solver_ctx *ctx = new_ctx(state);
     struct latin_solver solver;
@@ -919,6 +1032,13 @@ static int solver_state(game_state *state, int maxdiff)
 
     latin_solver_free(&solver);
 
+    return diff;
+}
+
+static int solver_state(game_state *state, int maxdiff)
+{
+    int diff = solver_state_diff(state, maxdiff);
+
     if (diff == DIFF_IMPOSSIBLE)
         return -1;
     if (diff == DIFF_UNFINISHED)
@@ -1093,7 +1213,12 @@ static int maxtries;
 #else
 #define MAXTRIES 50
 #endif
-static int gg_solved;
+#ifdef STANDALONE_SOLVER
+static int gg_solved;                  /* for reporting only */
+#define COUNT_SOLVE() (gg_solved++)
+#else
+#define COUNT_SOLVE() ((void)0)
+#endif
 
 static int game_assemble(game_state *new, int *scratch, digit *latin,
                          int difficulty)
@@ -1118,7 +1243,7 @@ static int game_assemble(game_state *new, int *scratch, digit *latin,
 #endif
 
     while(1) {
-        gg_solved++;
+        COUNT_SOLVE();
         if (solver_state(copy, difficulty) == 1) break;
 
         best = gg_best_clue(copy, scratch, latin);
@@ -1149,7 +1274,7 @@ static void game_strip(game_state *new, int *scratch, digit *latin,
 
         memcpy(copy->nums,  new->nums,  o2 * sizeof(digit));
         memcpy(copy->flags, new->flags, o2 * sizeof(unsigned int));
-        gg_solved++;
+        COUNT_SOLVE();
         if (solver_state(copy, difficulty) != 1) {
             /* put clue back, we can't solve without it. */
             bool ret = gg_place_clue(new, scratch[i], latin, false);
@@ -1199,7 +1324,9 @@ static char *new_game_desc(const game_params *params_in, random_state *rs,
 {
     game_params params_copy = *params_in; /* structure copy */
     game_params *params = &params_copy;
-    digit *sq = NULL;
+    digit *sq = snewn(params->order * params->order, digit);
+    struct latin_generate_scratch *latinscratch =
+        latin_generate_new_scratch(params->order);
     int i, x, y, retlen, k, nsol;
     int o2 = params->order * params->order, ntries = 1;
     int *scratch, lscratch = o2*5;
@@ -1217,8 +1344,7 @@ generate:
         printf("new_game_desc: generating %s puzzle, ntries so far %d\n",
                unequal_diffnames[params->diff], ntries);
 #endif
-    if (sq) sfree(sq);
-    sq = latin_generate(params->order, rs);
+    latin_generate_with_scratch(latinscratch, sq, rs);
     latin_debug(sq, params->order);
     /* Separately shuffle the numeric and inequality clues */
     shuffle(scratch, lscratch/5, sizeof(int), rs);
@@ -1232,7 +1358,9 @@ generate:
         add_adjacent_flags(state, sq);
     }
 
+#ifdef STANDALONE_SOLVER
     gg_solved = 0;
+#endif
     if (game_assemble(state, scratch, sq, params->diff) < 0)
         goto generate;
     game_strip(state, scratch, sq, params->diff);
@@ -1285,6 +1413,7 @@ generate:
 
     free_game(state);
     sfree(sq);
+    latin_generate_free_scratch(latinscratch);
     sfree(scratch);
 
     return ret;
@@ -1438,6 +1567,28 @@ static char *solve_game(const game_state *state, const game_state *currstate,
     return ret;
 }
 
+static char *grade_game(const game_state *state, const char **error)
+{
+    game_state *solved = dup_game(state);
+    int r, diff;
+
+    for (r = 0; r < state->order*state->order; r++) {
+        if (!(solved->flags[r] & F_IMMUTABLE))
+            solved->nums[r] = 0;
+    }
+    diff = solver_state_diff(solved, DIFFCOUNT-1);
+    free_game(solved);
+
+    if (diff == DIFF_IMPOSSIBLE) {
+        *error = "No solution exists for this puzzle";
+        return NULL;
+    } else if (diff == DIFF_AMBIGUOUS) {
+        *error = "Multiple solutions exist for this puzzle";
+        return NULL;
+    }
+    return dupstr(unequal_diffnames[diff]);
+}
+
 /* ----------------------------------------------------------
  * Game UI input processing.
  */
@@ -2204,7 +2355,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    NULL, /* solve_step */
+    grade_game,
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     get_prefs, set_prefs,
     new_ui,
@@ -2228,7 +2383,7 @@ const struct game thegame = {
     true, false, game_print_size, game_print,
     false,			       /* wants_statusbar */
     false, NULL,                       /* timing_state */
-    REQUIRE_RBUTTON | REQUIRE_NUMPAD,  /* flags */
+    REQUIRE_RBUTTON | REQUIRE_NUMPAD | SOLVE_FROM_ORIG,  /* flags */
 };
 
 /* ----------------------------------------------------------------------
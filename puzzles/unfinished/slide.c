@@ -39,7 +39,6 @@
 #endif
 
 #include "puzzles.h"
-#include "tree234.h"
 
 /*
  * The implementation of this game revolves around the insight
@@ -74,7 +73,7 @@
  * pointing back through all the other squares in the same block.
  *
  * So the solver simply does a bfs over all reachable positions,
- * encoding them in this format and storing them in a tree234 to
+ * encoding them in this format and storing them in a hash set to
  * ensure it doesn't ever revisit an already-analysed position.
  */
 
@@ -364,27 +363,47 @@ static char *board_text_format(int w, int h, unsigned char *data,
 
 /*
  * During solver execution, the set of visited board positions is
- * stored as a tree234 of the following structures. `w', `h' and
+ * stored as a hashset of the following structures. `w', `h' and
  * `data' are obvious in meaning; `dist' represents the minimum
  * distance to reach this position from the starting point.
  * 
  * `prev' links each board to the board position from which it was
  * most efficiently derived.
+ *
+ * `hash' is a Zobrist hash of `data': the XOR of one key for each
+ * square's contents, taken from a table indexed by square*256 +
+ * contents. So a move's hash can be worked out from its parent's by
+ * XORing in and out the keys for just the squares the piece leaves
+ * and enters, and a move back to a position we've already seen can
+ * be spotted without allocating a new board for it.
  */
 struct board {
     int w, h;
     int dist;
     struct board *prev;
+    unsigned long hash;
     unsigned char *data;
 };
 
-static int boardcmp(void *av, void *bv)
+static unsigned long boardhash(const void *av)
+{
+    return ((const struct board *)av)->hash;
+}
+
+static bool boardeq(const void *av, const void *bv)
 {
-    struct board *a = (struct board *)av;
-    struct board *b = (struct board *)bv;
-    return memcmp(a->data, b->data, a->w * a->h);
+    const struct board *a = (const struct board *)av;
+    const struct board *b = (const struct board *)bv;
+    return !memcmp(a->data, b->data, a->w * a->h);
 }
 
+/*
+ * The solver gives up, rather than run out of memory, if it has to
+ * look at more positions than this. (Generating the largest preset
+ * can take searches of three-quarters of a million positions.)
+ */
+#define SOLVER_MAX_POSITIONS 2000000
+
 static struct board *newboard(int w, int h, unsigned char *data)
 {
     struct board *b = malloc(sizeof(struct board) + w*h);
@@ -400,7 +419,8 @@ static struct board *newboard(int w, int h, unsigned char *data)
 /*
  * The actual solver. Given a board, attempt to find the minimum
  * length of move sequence which moves MAINANCHOR to (tx,ty), or
- * -1 if no solution exists. Returns that minimum length.
+ * -1 if no solution exists, or -2 if the search got too big to
+ * finish. Returns that minimum length.
  * 
  * Also, if `moveout' is provided, writes out the moves in the
  * form of a sequence of pairs of integers indicating the source
@@ -414,13 +434,16 @@ static int solve_board(int w, int h, unsigned char *board,
 		       int movelimit, int **moveout)
 {
     int wh = w*h;
-    struct board *b, *b2, *b3;
+    struct board *b, *b2, *scratch;
     int *next, *which;
     bool *anchors, *movereached;
     int *movequeue, mqhead, mqtail;
-    tree234 *sorted, *queue;
+    hashset *sorted;
+    struct board **queue;
+    unsigned long *zobrist;
     int i, j, dir;
-    int qlen, lastdist;
+    int qhead, qlen, qsize, lastdist;
+    bool gaveup = false;
     int ret;
 
 #ifdef SOLVER_DIAGNOSTICS
@@ -448,15 +471,31 @@ static int solve_board(int w, int h, unsigned char *board,
     }
 #endif
 
-    sorted = newtree234(boardcmp);
-    queue = newtree234(NULL);
+    zobrist = snewn(wh * 256, unsigned long);
+    for (i = 0; i < wh * 256; i++)
+        zobrist[i] = hash_ints(&i, 1);
+
+    /*
+     * Every board we see goes on the end of `queue', so the part of
+     * it before qhead is the list of boards already expanded, and
+     * the whole thing is the list of boards to free at the end.
+     */
+    sorted = hashset_new(boardhash, boardeq);
+    qsize = 1024;
+    queue = snewn(qsize, struct board *);
 
     b = newboard(w, h, board);
     b->dist = 0;
-    add234(sorted, b);
-    addpos234(queue, b, 0);
+    b->hash = 0;
+    for (i = 0; i < wh; i++)
+        b->hash ^= zobrist[i*256 + b->data[i]];
+    hashset_add(sorted, b);
+    queue[0] = b;
+    qhead = 0;
     qlen = 1;
 
+    scratch = newboard(w, h, board);
+
     next = snewn(wh, int);
     anchors = snewn(wh, bool);
     which = snewn(wh, int);
@@ -464,8 +503,8 @@ static int solve_board(int w, int h, unsigned char *board,
     movequeue = snewn(wh, int);
     lastdist = -1;
 
-    while ((b = delpos234(queue, 0)) != NULL) {
-	qlen--;
+    while (qhead < qlen) {
+	b = queue[qhead++];
 	if (movelimit >= 0 && b->dist >= movelimit) {
 	    /*
 	     * The problem is not soluble in under `movelimit'
@@ -553,22 +592,40 @@ static int solve_board(int w, int h, unsigned char *board,
 		    /*
 		     * We have a viable move. Make it.
 		     */
-		    b2 = newboard(w, h, b->data);
-		    for (j = i; j >= 0; j = next[j])
-			b2->data[j] = EMPTY;
-		    for (j = i; j >= 0; j = next[j])
-			b2->data[j+d] = b->data[j];
-
-		    b3 = add234(sorted, b2);
-		    if (b3 != b2) {
-			sfree(b2);	       /* we already got one */
-		    } else {
-			b2->dist = b->dist + 1;
-			b2->prev = b;
-			addpos234(queue, b2, qlen++);
-			if (b2->data[ty*w+tx] == MAINANCHOR)
-			    goto done;     /* search completed! */
+		    memcpy(scratch->data, b->data, wh);
+		    scratch->hash = b->hash;
+		    for (j = i; j >= 0; j = next[j]) {
+			scratch->hash ^= zobrist[j*256 + scratch->data[j]] ^
+			    zobrist[j*256 + EMPTY];
+			scratch->data[j] = EMPTY;
+		    }
+		    for (j = i; j >= 0; j = next[j]) {
+			scratch->hash ^=
+			    zobrist[(j+d)*256 + scratch->data[j+d]] ^
+			    zobrist[(j+d)*256 + b->data[j]];
+			scratch->data[j+d] = b->data[j];
 		    }
+
+		    if (hashset_find(sorted, scratch))
+			continue;      /* we already got one */
+
+		    if (qlen == SOLVER_MAX_POSITIONS) {
+			gaveup = true;
+			b2 = NULL;
+			goto done;
+		    }
+		    if (qlen == qsize) {
+			qsize *= 2;
+			queue = sresize(queue, qsize, struct board *);
+		    }
+		    b2 = newboard(w, h, scratch->data);
+		    b2->hash = scratch->hash;
+		    b2->dist = b->dist + 1;
+		    b2->prev = b;
+		    hashset_add(sorted, b2);
+		    queue[qlen++] = b2;
+		    if (b2->data[ty*w+tx] == MAINANCHOR)
+			goto done;     /* search completed! */
 		}
 	    }
 	}
@@ -616,16 +673,17 @@ static int solve_board(int w, int h, unsigned char *board,
 	    assert(j == 0);
 	}
     } else {
-	ret = -1;		       /* no solution */
+	ret = gaveup ? -2 : -1;	       /* no solution, or no answer */
 	if (moveout)
 	    *moveout = NULL;
     }
 
-    freetree234(queue);
-
-    while ((b = delpos234(sorted, 0)) != NULL)
-	sfree(b);
-    freetree234(sorted);
+    for (i = 0; i < qlen; i++)
+	sfree(queue[i]);
+    sfree(queue);
+    hashset_free(sorted);
+    sfree(scratch);
+    sfree(zobrist);
 
     sfree(next);
     sfree(anchors);
@@ -1147,6 +1205,10 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 			 state->imm->forcefield, state->tx, state->ty,
 			 -1, &moves);
 
+    if (nmoves == -2) {
+	*error = "Too many positions to search for a solution";
+	return NULL;
+    }
     if (nmoves < 0) {
 	*error = "Unable to find a solution to this puzzle";
 	return NULL;
@@ -2331,7 +2393,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
@@ -2412,7 +2478,9 @@ int main(int argc, char **argv)
 
     ret = solve_board(s->w, s->h, s->board, s->imm->forcefield,
 		      s->tx, s->ty, -1, &moves);
-    if (ret < 0) {
+    if (ret == -2) {
+	printf("Gave up: too many positions to search\n");
+    } else if (ret < 0) {
 	printf("No solution found\n");
     } else {
 	int index = 0;
@@ -0,0 +1,123 @@
+/*
+ * unitcheck.c: incremental error checking, for games whose rules are
+ * a set of constraints each depending on only a few cells.
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "puzzles.h"
+
+/*
+ * Implementation: an array of each unit's last known status, plus a
+ * count of the units in each status (so that 'is everything OK?' is
+ * a constant-time question), plus a de-duplicated list of the units
+ * touched since the last unitcheck_run. Touching everything just
+ * sets a flag, rather than filling the list.
+ */
+
+struct unitcheck {
+    int n;
+    unsigned char *status;
+    int counts[UNIT_NSTATUS];
+    int *pending, npending;
+    bool *touched;
+    bool all_touched;
+};
+
+unitcheck *unitcheck_new(int n)
+{
+    unitcheck *uc = snew(unitcheck);
+    int i;
+
+    uc->n = n;
+    uc->status = snewn(n, unsigned char);
+    uc->pending = snewn(n, int);
+    uc->touched = snewn(n, bool);
+    for (i = 0; i < n; i++) {
+        uc->status[i] = UNIT_INCOMPLETE;
+        uc->touched[i] = false;
+    }
+    for (i = 0; i < UNIT_NSTATUS; i++)
+        uc->counts[i] = 0;
+    uc->counts[UNIT_INCOMPLETE] = n;
+    uc->npending = 0;
+    uc->all_touched = true;
+    return uc;
+}
+
+unitcheck *unitcheck_dup(const unitcheck *uc)
+{
+    unitcheck *ret = snew(unitcheck);
+    int n = uc->n;
+
+    *ret = *uc;                        /* structure copy */
+    ret->status = snewn(n, unsigned char);
+    memcpy(ret->status, uc->status, n * sizeof(unsigned char));
+    ret->pending = snewn(n, int);
+    memcpy(ret->pending, uc->pending, uc->npending * sizeof(int));
+    ret->touched = snewn(n, bool);
+    memcpy(ret->touched, uc->touched, n * sizeof(bool));
+    return ret;
+}
+
+void unitcheck_free(unitcheck *uc)
+{
+    sfree(uc->status);
+    sfree(uc->pending);
+    sfree(uc->touched);
+    sfree(uc);
+}
+
+void unitcheck_touch(unitcheck *uc, int unit)
+{
+    assert(0 <= unit && unit < uc->n);
+    if (!uc->touched[unit]) {
+        uc->touched[unit] = true;
+        uc->pending[uc->npending++] = unit;
+    }
+}
+
+void unitcheck_touch_all(unitcheck *uc)
+{
+    uc->all_touched = true;
+}
+
+static void recheck(unitcheck *uc, int unit, unitcheck_fn_t check, void *ctx)
+{
+    int status = check(ctx, unit);
+
+    assert(0 <= status && status < UNIT_NSTATUS);
+    uc->counts[uc->status[unit]]--;
+    uc->counts[status]++;
+    uc->status[unit] = status;
+}
+
+void unitcheck_run(unitcheck *uc, unitcheck_fn_t check, void *ctx)
+{
+    int i;
+
+    if (uc->all_touched) {
+        for (i = 0; i < uc->n; i++)
+            recheck(uc, i, check, ctx);
+    } else {
+        for (i = 0; i < uc->npending; i++)
+            recheck(uc, uc->pending[i], check, ctx);
+    }
+    for (i = 0; i < uc->npending; i++)
+        uc->touched[uc->pending[i]] = false;
+    uc->npending = 0;
+    uc->all_touched = false;
+}
+
+int unitcheck_status(const unitcheck *uc, int unit)
+{
+    assert(0 <= unit && unit < uc->n);
+    return uc->status[unit];
+}
+
+int unitcheck_count(const unitcheck *uc, int status)
+{
+    assert(0 <= status && status < UNIT_NSTATUS);
+    return uc->counts[status];
+}
@@ -2117,7 +2117,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
 	dup_game,
 	free_game,
+	NULL, NULL, /* encode_state, decode_state */
 	true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
 	true, game_can_format_as_text_now, game_text_format,
     NULL, NULL, /* get_prefs, set_prefs */
 	new_ui,
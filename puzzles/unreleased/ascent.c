@@ -813,6 +813,16 @@ struct solver_scratch {
 
 	/* Scratch space for solver_overlap */
 	bitmap *overlap;
+
+	/*
+	 * Whether solver_near has already cleared the marks of each number
+	 * (n2) too far away from the placed number n. GET_BIT n*s+n2
+	 */
+	bitmap *near_done;
+
+	/* The cells near each cell (as in is_near), 8 slots per cell */
+	cell *neighbours;
+	int *nneighbours;
 };
 
 static struct solver_scratch *new_scratch(int w, int h, int mode, number last)
@@ -839,6 +849,23 @@ static struct solver_scratch *new_scratch(int w, int h, int mode, number last)
 	memset(ret->path, 0, n*sizeof(int));
 
 	ret->overlap = snewn(BITMAP_SIZE(w*h*2), bitmap);
+	ret->near_done = snewn(BITMAP_SIZE(n*n), bitmap);
+
+	ret->neighbours = snewn(n*8, cell);
+	ret->nneighbours = snewn(n, int);
+	for(i = 0; i < n; i++)
+	{
+		int d, x, y, count = 0;
+		for(d = 0; d < ret->movement->dircount; d++)
+		{
+			x = i%w + ret->movement->dirs[d].dx;
+			y = i/w + ret->movement->dirs[d].dy;
+			if(x < 0 || x >= w || y < 0 || y >= h) continue;
+			assert(is_near(i, y*w+x, w, mode));
+			ret->neighbours[i*8 + count++] = y*w+x;
+		}
+		ret->nneighbours[i] = count;
+	}
 
 	return ret;
 }
@@ -850,6 +877,9 @@ static void free_scratch(struct solver_scratch *scratch)
 	sfree(scratch->marks);
 	sfree(scratch->path);
 	sfree(scratch->overlap);
+	sfree(scratch->near_done);
+	sfree(scratch->neighbours);
+	sfree(scratch->nneighbours);
 	sfree(scratch);
 }
 
@@ -900,7 +930,10 @@ static int solver_single_position(struct solver_scratch *scratch)
 			if(found == CELL_NONE)
 				found = i;
 			else
+			{
 				found = CELL_MULTIPLE;
+				break;
+			}
 		}
 		assert(found != CELL_NONE);
 		if(found >= 0)
@@ -931,7 +964,10 @@ static int solver_single_number(struct solver_scratch *scratch, bool simple)
 			if(found == NUMBER_EMPTY)
 				found = n;
 			else
+			{
 				found = NUMBER_WALL;
+				break;
+			}
 		}
 		assert(found != NUMBER_EMPTY);
 		if(found >= 0)
@@ -992,6 +1028,20 @@ static int solver_near(struct solver_scratch *scratch, cell near, number num, in
 	return ret;
 }
 
+static int solver_near_number(struct solver_scratch *scratch, number n, number n2)
+{
+	/* 
+	 * Remove marks of n2 which are too far away from the placed number n.
+	 * Marks are never added back, so this only needs doing once.
+	 */
+	int s = scratch->w*scratch->h;
+
+	if(GET_BIT(scratch->near_done, n*s+n2))
+		return 0;
+	SET_BIT(scratch->near_done, n*s+n2);
+	return solver_near(scratch, scratch->positions[n], n2, abs(n-n2));
+}
+
 static int solver_proximity_simple(struct solver_scratch *scratch)
 {
 	/* Remove marks which aren't adjacent to a given sequential number */
@@ -1006,9 +1056,9 @@ static int solver_proximity_simple(struct solver_scratch *scratch)
 		if(i < 0) continue;
 		
 		if(n > 0 && scratch->positions[n-1] == CELL_NONE)
-			ret += solver_near(scratch, i, n-1, 1);
+			ret += solver_near_number(scratch, n, n-1);
 		if(n < end-1 && scratch->positions[n+1] == CELL_NONE)
-			ret += solver_near(scratch, i, n+1, 1);
+			ret += solver_near_number(scratch, n, n+1);
 	}
 	
 	return ret;
@@ -1030,13 +1080,13 @@ static int solver_proximity_full(struct solver_scratch *scratch)
 		n2 = n-1;
 		while(n2 >= 0 && scratch->positions[n2] == CELL_NONE)
 		{
-			ret += solver_near(scratch, i, n2, abs(n-n2));
+			ret += solver_near_number(scratch, n, n2);
 			n2--;
 		}
 		n2 = n+1;
 		while(n2 <= end-1 && scratch->positions[n2] == CELL_NONE)
 		{
-			ret += solver_near(scratch, i, n2, abs(n-n2));
+			ret += solver_near_number(scratch, n, n2);
 			n2++;
 		}
 	}
@@ -1387,7 +1437,8 @@ static int solver_overlap(struct solver_scratch *scratch)
 	 */
 	int ret = 0;
 	int w = scratch->w, h = scratch->h, s = w*h;
-	cell i1, i2; number n;
+	cell i1; number n;
+	int j;
 
 	for(n = 0; n < scratch->end; n++)
 	{
@@ -1402,11 +1453,8 @@ static int solver_overlap(struct solver_scratch *scratch)
 			{
 				if(GET_BIT(scratch->marks, i1*s+(n-1)))
 				{
-					for(i2 = 0; i2 < s; i2++)
-					{
-						if(is_near(i1, i2, scratch->w, scratch->mode))
-							SET_BIT(scratch->overlap, i2);
-					}
+					for(j = 0; j < scratch->nneighbours[i1]; j++)
+						SET_BIT(scratch->overlap, scratch->neighbours[i1*8+j]);
 				}
 			}
 		}
@@ -1417,11 +1465,8 @@ static int solver_overlap(struct solver_scratch *scratch)
 			{
 				if(GET_BIT(scratch->marks, i1*s+(n+1)))
 				{
-					for(i2 = 0; i2 < s; i2++)
-					{
-						if(is_near(i1, i2, w, scratch->mode))
-							SET_BIT(scratch->overlap, i2 + s);
-					}
+					for(j = 0; j < scratch->nneighbours[i1]; j++)
+						SET_BIT(scratch->overlap, scratch->neighbours[i1*8+j] + s);
 				}
 			}
 		}
@@ -1472,6 +1517,7 @@ static void ascent_solve(const number *puzzle, int diff, struct solver_scratch *
 		memcpy(scratch->grid, puzzle, s*sizeof(number));
 	update_positions(scratch->positions, scratch->grid, s);
 	memset(scratch->marks, 0, BITMAP_SIZE(s*s));
+	memset(scratch->near_done, 0, BITMAP_SIZE(s*s));
 	
 	/* Set possibilities for numbers */
 	for(n = 0; n < s; n++)
@@ -4010,7 +4056,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
 	dup_game,
 	free_game,
+	NULL, NULL, /* encode_state, decode_state */
 	true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
 	true, game_can_format_as_text_now, game_text_format,
     get_prefs, set_prefs,
 	new_ui,
@@ -86,6 +86,7 @@ enum {
 
 #define NO_CLUE (-1)
 #define IS_SHIP(x) ( (x) >= SHIP_VAGUE )
+#define MAX_FLEET 9
 
 struct game_params {
 	int w;
@@ -369,7 +370,7 @@ static game_params *custom_params(const config_item *cfg)
     ret->diff = cfg[4].u.choices.selected;
     ret->strip = cfg[5].u.boolean.bval;
 
-	if(ret->fleet < 1 || ret->fleet > 9)
+	if(ret->fleet < 1 || ret->fleet > MAX_FLEET)
 		ret->fleetdata = NULL;
 	else if(strcmp(cfg[3].u.string.sval, ""))
 		ret->fleetdata = boats_decode_fleet(cfg[3].u.string.sval, ret->fleet);
@@ -893,12 +894,12 @@ static char boats_check_fleet(const game_state *state, int *fleetcount, int *err
 	int w = state->w;
 	int h = state->h;
 	int x, y, i, len;
-	char hasfleetcount = fleetcount != NULL;
+	int localfleet[MAX_FLEET];
 	char ret = STATUS_COMPLETE;
 	bool inship, iserror;
 	
-	if(!hasfleetcount)
-		fleetcount = snewn(fleet, int);
+	if(!fleetcount)
+		fleetcount = localfleet;
 	
 	memset(fleetcount, 0, fleet * sizeof(int));
 	
@@ -908,19 +909,6 @@ static char boats_check_fleet(const game_state *state, int *fleetcount, int *err
 			errs[i] &= ~FE_FLEET;
 	}
 	
-	/* Count singles */
-	for(x = 0; x < w; x++)
-	for(y = 0; y < h; y++)
-	{
-		if(fleet >= 1 && state->grid[y*w+x] == SHIP_SINGLE)
-		{
-			if(errs && state->fleetdata[0] == 0)
-				errs[y*w+x] |= FE_FLEET;
-			
-			fleetcount[0]++;
-		}
-	}
-	
 	/* Count vertical ships */
 	for(x = 0; x < w; x++)
 	{
@@ -965,13 +953,21 @@ static char boats_check_fleet(const game_state *state, int *fleetcount, int *err
 		}
 	}
 	
-	/* Count horizontal ships */
+	/* Count horizontal ships, and singles */
 	for(y = 0; y < h; y++)
 	{
 		len = 0;
 		inship = false;
 		for(x = 0; x < w; x++)
 		{
+			if(state->grid[y*w+x] == SHIP_SINGLE)
+			{
+				if(errs && state->fleetdata[0] == 0)
+					errs[y*w+x] |= FE_FLEET;
+				
+				fleetcount[0]++;
+			}
+			
 			iserror = false;
 			if(state->grid[y*w+x] == SHIP_LEFT)
 				inship = true;
@@ -1017,9 +1013,6 @@ static char boats_check_fleet(const game_state *state, int *fleetcount, int *err
 			ret = STATUS_INVALID;
 	}
 	
-	if(!hasfleetcount)
-		sfree(fleetcount);
-	
 	return ret;
 }
 
@@ -1204,8 +1197,8 @@ static char boats_check_dsf(game_state *state, DSF *dsf, int *fleetcount)
 	int w = state->w;
 	int h = state->h;
 	int end = w*h;
-	int x, y, i;
-	int *tempfleet = snewn(state->fleet, int);
+	int x, y, i, c;
+	int tempfleet[MAX_FLEET];
 	char ret = STATUS_COMPLETE;
 	
 	memcpy(tempfleet, fleetcount, sizeof(int)*state->fleet);
@@ -1233,14 +1226,14 @@ static char boats_check_dsf(game_state *state, DSF *dsf, int *fleetcount)
 		else if(state->grid[i] == SHIP_BOTTOM && state->grid[dsf_canonify(dsf, i)] == SHIP_TOP)
 			dsf_merge(dsf, i, end);
 	}
-	for(y = 0; y < h; y++)
-	for(x = 0; x < w; x++)
+	end = dsf_canonify(dsf, end);
+	for(i = 0; i < w*h; i++)
 	{
-		i = y*w+x;
-		if(dsf_canonify(dsf, i) == dsf_canonify(dsf, end))
+		c = dsf_canonify(dsf, i);
+		if(c == end)
 			continue;
 		
-		if(i == dsf_canonify(dsf, i))
+		if(i == c)
 		{
 			if(ret != STATUS_INVALID) ret = STATUS_INCOMPLETE;
 			if(dsf_size(dsf, i) > state->fleet)
@@ -1259,7 +1252,6 @@ static char boats_check_dsf(game_state *state, DSF *dsf, int *fleetcount)
 			ret = STATUS_INVALID;
 	}
 	
-	sfree(tempfleet);
 	return ret;
 }
 
@@ -1282,9 +1274,13 @@ static char boats_validate_full_state(game_state *state, int *blankcounts, int *
 	}
 	
 	adjuststatus = boats_adjust_ships(state);
+	if(adjuststatus == STATUS_INVALID)
+		return STATUS_INVALID;
 	
+	/* Stop at the first check which fails, as nothing can change that */
 	status = max(status, boats_check_fleet(state, fleetcount, NULL));
-	status = max(status, boats_validate_gridclues(state, NULL));
+	if(status != STATUS_INVALID)
+		status = max(status, boats_validate_gridclues(state, NULL));
 	
 	if(status != STATUS_INVALID && dsf)
 		status = max(status, boats_check_dsf(state, dsf, fleetcount));
@@ -2821,7 +2817,7 @@ static const char *validate_params(const game_params *params, bool full)
 		return "Fleet size must be at least 1";
 	if(fleet > w && fleet > h)
 		return "Fleet size must be smaller than the width and height";
-	if(fleet > 9)
+	if(fleet > MAX_FLEET)
 		return "Fleet size must be no more than 9";
 		
 	for(i = 0; i < fleet; i++)
@@ -4091,7 +4087,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
 	dup_game,
 	free_game,
+	NULL, NULL, /* encode_state, decode_state */
 	true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
 	true, game_can_format_as_text_now, game_text_format,
     NULL, NULL, /* get_prefs, set_prefs */
 	new_ui,
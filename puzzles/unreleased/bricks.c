@@ -536,11 +536,96 @@ static void free_game(game_state *state)
  * Solver *
  * ****** */
 
+static bool bricks_error_at(int w, int h, const cell *grid, int x, int y)
+{
+	/*
+	 * Check the rules of bricks_validate_threes, _gravity and _counts
+	 * which start at this cell, without marking any errors.
+	 */
+	int i = y*w+x;
+	int s, x2, y2, shade, unshade;
+	cell n, n2, n3;
+
+	if (x > 0 && x < w-1 &&
+			(grid[i-1] & COL_MASK) == F_SHADE &&
+			(grid[i] & COL_MASK) == F_SHADE &&
+			(grid[i+1] & COL_MASK) == F_SHADE)
+		return true;
+
+	if (y < h-1 && (grid[i] & COL_MASK) == F_SHADE) {
+		n2 = x == 0 ? F_BOUND : grid[i+w-1];
+		if(!(n2 & F_BOUND))
+			n2 &= COL_MASK;
+		n3 = grid[i+w];
+		if(!(n3 & F_BOUND))
+			n3 &= COL_MASK;
+
+		if ((!n2 || n2 == F_UNSHADE || n2 == F_BOUND) &&
+				(!n3 || n3 == F_UNSHADE || n3 == F_BOUND))
+			return true;
+	}
+
+	n = grid[i];
+	if((n & COL_MASK) || n & F_BOUND) return false;
+	n &= NUM_MASK;
+	if(n == 7) return false;
+
+	shade = unshade = 0;
+	for(s = 0; s < 6; s++) {
+		x2 = x + bricks_steps[s].dx;
+		y2 = y + bricks_steps[s].dy;
+
+		if(x2 < 0 || x2 >= w || y2 < 0 || y2 >= h)
+			unshade++;
+		else {
+			n2 = grid[y2*w+x2];
+			if(n2 & COL_MASK) {
+				n2 &= COL_MASK;
+				if(n2 == F_SHADE)
+					shade++;
+				else if(n2 == F_UNSHADE)
+					unshade++;
+			} else
+				unshade++;
+		}
+	}
+
+	return shade > n || 6 - unshade < n;
+}
+
+static bool bricks_error_around(int w, int h, const cell *grid, int i)
+{
+	/*
+	 * Every rule which looks at cell i starts within one row and
+	 * column of it, so this finds out whether filling it made the
+	 * grid invalid.
+	 */
+	int x = i % w, y = i / w;
+	int x2, y2;
+
+	for (y2 = max(y-1, 0); y2 <= min(y+1, h-1); y2++)
+		for (x2 = max(x-1, 0); x2 <= min(x+1, w-1); x2++)
+			if (bricks_error_at(w, h, grid, x2, y2))
+				return true;
+
+	return false;
+}
+
 static int bricks_solver_try(game_state *state)
 {
 	int w = state->w, h = state->h, s = w * h;
 	int i, d;
 	int ret = 0;
+	int last = -1;
+	cell lastcol = F_EMPTY, old;
+	bool invalid;
+
+	/*
+	 * Filling a cell never turns an error back into a valid cell, so
+	 * once the grid is invalid it stays invalid, and otherwise each
+	 * attempt only needs checking around the cell itself.
+	 */
+	invalid = bricks_validate(w, h, state->grid, false) == STATUS_INVALID;
 
 	for (i = 0; i < s; i++)
 	{
@@ -551,10 +636,14 @@ static int bricks_solver_try(game_state *state)
 		{
 			/* See if this leads to an invalid state */
 			state->grid[i] = d ? F_SHADE : F_UNSHADE;
-			if (bricks_validate(w, h, state->grid, false) == STATUS_INVALID)
+			last = i;
+			lastcol = state->grid[i];
+			if (invalid || bricks_error_around(w, h, state->grid, i))
 			{
 				state->grid[i] = d ? F_UNSHADE : F_SHADE;
 				ret++;
+				if (!invalid)
+					invalid = bricks_error_around(w, h, state->grid, i);
 				break;
 			}
 			else
@@ -562,6 +651,18 @@ static int bricks_solver_try(game_state *state)
 		}
 	}
 
+	/*
+	 * Leave the error flags as a full validation of the last attempt
+	 * would have.
+	 */
+	if (last >= 0)
+	{
+		old = state->grid[last];
+		state->grid[last] = lastcol;
+		bricks_validate(w, h, state->grid, false);
+		state->grid[last] = old;
+	}
+
 	return ret;
 }
 
@@ -1649,7 +1750,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
 	dup_game,
 	free_game,
+	NULL, NULL, /* encode_state, decode_state */
 	true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
 	true, game_can_format_as_text_now, game_text_format,
     NULL, NULL, /* get_prefs, set_prefs */
 	new_ui,
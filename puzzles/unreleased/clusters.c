@@ -192,12 +192,32 @@ static int clusters_count(const game_state *state, int x, int y, int col,
 
 enum { STATUS_COMPLETE, STATUS_UNFINISHED, STATUS_INVALID };
 
+static bool clusters_cell_error(const game_state *state, int x, int y)
+{
+	/* Check a filled cell against its neighbours */
+	int w = state->w;
+	int col = state->grid[y*w + x] & COLMASK;
+	int count = 0, othercount = 0, emptycount = 0, maxcount = 0;
+
+	maxcount += clusters_count(state, x - 1, y, col, &count, &othercount, &emptycount);
+	maxcount += clusters_count(state, x + 1, y, col, &count, &othercount, &emptycount);
+	maxcount += clusters_count(state, x, y - 1, col, &count, &othercount, &emptycount);
+	maxcount += clusters_count(state, x, y + 1, col, &count, &othercount, &emptycount);
+
+	if (othercount == maxcount)
+		return true;
+	if (state->grid[y*w + x] & F_SINGLE && count > 1)
+		return true;
+	if (!(state->grid[y*w + x] & F_SINGLE) && othercount == maxcount - 1)
+		return true;
+	return false;
+}
+
 static int clusters_validate(game_state *state)
 {
 	int w = state->w;
 	int h = state->h;
-	int x, y, col, count, othercount, emptycount, maxcount;
-	bool error;
+	int x, y;
 	char ret = STATUS_COMPLETE;
 
 	for (y = 0; y < h; y++)
@@ -208,23 +228,8 @@ static int clusters_validate(game_state *state)
 				if(ret == STATUS_COMPLETE) ret = STATUS_UNFINISHED;
 				continue;
 			}
-			col = state->grid[y*w + x] & COLMASK;
-			count = othercount = emptycount = maxcount = 0;
-			error = false;
-
-			maxcount += clusters_count(state, x - 1, y, col, &count, &othercount, &emptycount);
-			maxcount += clusters_count(state, x + 1, y, col, &count, &othercount, &emptycount);
-			maxcount += clusters_count(state, x, y - 1, col, &count, &othercount, &emptycount);
-			maxcount += clusters_count(state, x, y + 1, col, &count, &othercount, &emptycount);
-
-			if (othercount == maxcount)
-				error = true;
-			else if (state->grid[y*w + x] & F_SINGLE && count > 1)
-				error = true;
-			else if (!(state->grid[y*w + x] & F_SINGLE) && othercount == maxcount - 1)
-				error = true;
-
-			if (error)
+
+			if (clusters_cell_error(state, x, y))
 			{
 				ret = STATUS_INVALID;
 				state->grid[y*w + x] |= F_ERROR;
@@ -367,11 +372,43 @@ static void free_game(game_state *state)
  * Solver *
  * ****** */
 
+static bool clusters_error_around(const game_state *state, int i)
+{
+	/*
+	 * Filling cell i can only change whether i and its neighbours are
+	 * errors, so this finds out whether it made the grid invalid.
+	 */
+	int w = state->w, h = state->h;
+	int x = i % w, y = i / w;
+
+	if (clusters_cell_error(state, x, y))
+		return true;
+	if (x > 0 && state->grid[i-1] && clusters_cell_error(state, x-1, y))
+		return true;
+	if (x < w-1 && state->grid[i+1] && clusters_cell_error(state, x+1, y))
+		return true;
+	if (y > 0 && state->grid[i-w] && clusters_cell_error(state, x, y-1))
+		return true;
+	if (y < h-1 && state->grid[i+w] && clusters_cell_error(state, x, y+1))
+		return true;
+	return false;
+}
+
 static int clusters_solver_try(game_state *state)
 {
 	int s = state->w*state->h;
 	int i, d;
 	int ret = 0;
+	int last = -1;
+	char lastcol = 0, old;
+	bool invalid;
+
+	/*
+	 * Filling a cell never turns an error back into a valid cell, so
+	 * once the grid is invalid it stays invalid, and otherwise each
+	 * attempt only needs checking around the cell itself.
+	 */
+	invalid = clusters_validate(state) == STATUS_INVALID;
 
 	for (i = 0; i < s; i++)
 	{
@@ -382,10 +419,14 @@ static int clusters_solver_try(game_state *state)
 		{
 			/* See if this leads to an invalid state */
 			state->grid[i] = d ? F_COLOR_1 : F_COLOR_0;
-			if (clusters_validate(state) == STATUS_INVALID)
+			last = i;
+			lastcol = state->grid[i];
+			if (invalid || clusters_error_around(state, i))
 			{
 				state->grid[i] = d ? F_COLOR_0 : F_COLOR_1;
 				ret++;
+				if (!invalid)
+					invalid = clusters_error_around(state, i);
 				break;
 			}
 			else
@@ -393,6 +434,18 @@ static int clusters_solver_try(game_state *state)
 		}
 	}
 
+	/*
+	 * Leave the error flags as a full validation of the last attempt
+	 * would have, since the generator carries them over.
+	 */
+	if (last >= 0)
+	{
+		old = state->grid[last];
+		state->grid[last] = lastcol;
+		clusters_validate(state);
+		state->grid[last] = old;
+	}
+
 	return ret;
 }
 
@@ -1145,7 +1198,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
 	dup_game,
 	free_game,
+	NULL, NULL, /* encode_state, decode_state */
 	true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
 	true, game_can_format_as_text_now, game_text_format,
     NULL, NULL, /* get_prefs, set_prefs */
 	new_ui,
@@ -878,109 +878,214 @@ static int crossing_solve_game(game_state *state)
 }
 
 enum { GEN_BLANK, GEN_WALL, GEN_CELL };
-static bool crossing_gen_walls_checkpool(int w, int h, char *walls)
+
+/*
+ * The generator adds one cell at a time until no 2x2 block is without
+ * a cell and all cells are connected. Rather than rescanning the grid
+ * after each cell, keep counts of the cells in each 2x2 block and a
+ * DSF of the cells, and update them as squares change.
+ */
+struct crossing_gen {
+	int w, h;
+	char *walls;
+	/* Number of GEN_CELL in each 2x2 block, indexed by its top-left square */
+	int *blockcells;
+	/* Number of blocks without GEN_CELL */
+	int emptyblocks;
+	/* Number of those which the current pool check had already passed */
+	int passedblocks;
+	/* Connected groups of GEN_CELL, rebuilt when a cell is removed */
+	DSF *dsf;
+	bool dsfstale;
+	int cells, lastcell;
+};
+
+static struct crossing_gen *crossing_gen_new(int w, int h)
 {
-	/* Find a 2x2 area without GEN_CELL */
-	/* Also ensure no 2x2 area of GEN_CELL exists */
-	bool ret = true;
-	int x, y;
+	struct crossing_gen *gen = snew(struct crossing_gen);
+	int i;
 	
-	for(y = 0; y < h-1; y++)
-	for(x = 0; x < w-1; x++)
+	gen->w = w;
+	gen->h = h;
+	gen->walls = snewn(w*h, char);
+	gen->blockcells = snewn(w*h, int);
+	for(i = 0; i < w*h; i++)
 	{
-		/* Contains block of no cell */
-		if(walls[y*w+x] != GEN_CELL &&
-				walls[y*w+x+1] != GEN_CELL &&
-				walls[(y+1)*w+x] != GEN_CELL &&
-				walls[(y+1)*w+x+1] != GEN_CELL)
+		gen->walls[i] = GEN_BLANK;
+		gen->blockcells[i] = 0;
+	}
+	gen->emptyblocks = (w-1)*(h-1);
+	gen->passedblocks = 0;
+	gen->dsf = dsf_new(w*h);
+	gen->dsfstale = false;
+	gen->cells = 0;
+	gen->lastcell = -1;
+	
+	return gen;
+}
+
+static void crossing_gen_free(struct crossing_gen *gen)
+{
+	dsf_free(gen->dsf);
+	sfree(gen->blockcells);
+	sfree(gen->walls);
+	sfree(gen);
+}
+
+/*
+ * Change one square. 'visiting' is the block the pool check is
+ * looking at, if any, to know which blocks it has already passed.
+ */
+static void crossing_gen_set(struct crossing_gen *gen, int i, char v, int visiting)
+{
+	int w = gen->w, h = gen->h;
+	int x = i%w, y = i/w;
+	int bx, by, b, d;
+	char old = gen->walls[i];
+	
+	gen->walls[i] = v;
+	d = (v == GEN_CELL) - (old == GEN_CELL);
+	if(!d)
+		return;
+	
+	gen->cells += d;
+	for(by = max(y-1, 0); by <= min(y, h-2); by++)
+	for(bx = max(x-1, 0); bx <= min(x, w-2); bx++)
+	{
+		b = by*w+bx;
+		if(!gen->blockcells[b])
+			gen->emptyblocks--;
+		gen->blockcells[b] += d;
+		if(!gen->blockcells[b])
 		{
-			ret = false;
+			gen->emptyblocks++;
+			if(b <= visiting)
+				gen->passedblocks++;
 		}
+	}
+	
+	if(d < 0)
+	{
+		gen->dsfstale = true;
+		return;
+	}
+	
+	gen->lastcell = i;
+	if(gen->dsfstale)
+		return;
+	if(x > 0 && gen->walls[i-1] == GEN_CELL)
+		dsf_merge(gen->dsf, i, i-1);
+	if(x < w-1 && gen->walls[i+1] == GEN_CELL)
+		dsf_merge(gen->dsf, i, i+1);
+	if(y > 0 && gen->walls[i-w] == GEN_CELL)
+		dsf_merge(gen->dsf, i, i-w);
+	if(y < h-1 && gen->walls[i+w] == GEN_CELL)
+		dsf_merge(gen->dsf, i, i+w);
+}
+
+static int crossing_gen_cmp_block(const void *va, const void *vb)
+{
+	int a = *(const int *)va, b = *(const int *)vb;
+	return a < b ? -1 : a > b ? 1 : 0;
+}
+
+static bool crossing_gen_walls_checkpool(struct crossing_gen *gen, const int *changed, int nchanged)
+{
+	/* Find a 2x2 area without GEN_CELL */
+	/* Also ensure no 2x2 area of GEN_CELL exists */
+	int w = gen->w, h = gen->h;
+	char *walls = gen->walls;
+	int blocks[8];
+	int nblocks = 0;
+	int i, b, x, y, bx, by;
+	
+	/*
+	 * Only the blocks around the squares which changed since the last
+	 * check can form new walls. Visit them in the order of a full scan.
+	 */
+	for(i = 0; i < nchanged; i++)
+	{
+		x = changed[i]%w;
+		y = changed[i]/w;
+		for(by = max(y-1, 0); by <= min(y, h-2); by++)
+		for(bx = max(x-1, 0); bx <= min(x, w-2); bx++)
+			blocks[nblocks++] = by*w+bx;
+	}
+	qsort(blocks, nblocks, sizeof(int), crossing_gen_cmp_block);
+	
+	gen->passedblocks = 0;
+	for(i = 0; i < nblocks; i++)
+	{
+		b = blocks[i];
+		if(i > 0 && b == blocks[i-1])
+			continue;
 		
 		/* Wall on top-left */
-		if(walls[y*w+x+1] == GEN_CELL &&
-				walls[(y+1)*w+x] == GEN_CELL &&
-				walls[(y+1)*w+x+1] == GEN_CELL)
+		if(walls[b+1] == GEN_CELL &&
+				walls[b+w] == GEN_CELL &&
+				walls[b+w+1] == GEN_CELL)
 		{
-			walls[y*w+x] = GEN_WALL;
+			crossing_gen_set(gen, b, GEN_WALL, b);
 		}
 		
 		/* Wall on top-right */
-		if(walls[y*w+x] == GEN_CELL &&
-				walls[(y+1)*w+x] == GEN_CELL &&
-				walls[(y+1)*w+x+1] == GEN_CELL)
+		if(walls[b] == GEN_CELL &&
+				walls[b+w] == GEN_CELL &&
+				walls[b+w+1] == GEN_CELL)
 		{
-			walls[y*w+x+1] = GEN_WALL;
+			crossing_gen_set(gen, b+1, GEN_WALL, b);
 		}
 		
 		/* Wall on bottom-left */
-		if(walls[y*w+x] == GEN_CELL &&
-				walls[y*w+x+1] == GEN_CELL &&
-				walls[(y+1)*w+x+1] == GEN_CELL)
+		if(walls[b] == GEN_CELL &&
+				walls[b+1] == GEN_CELL &&
+				walls[b+w+1] == GEN_CELL)
 		{
-			walls[(y+1)*w+x] = GEN_WALL;
+			crossing_gen_set(gen, b+w, GEN_WALL, b);
 		}
 		
 		/* Wall on bottom-right */
-		if(walls[y*w+x] == GEN_CELL &&
-				walls[y*w+x+1] == GEN_CELL &&
-				walls[(y+1)*w+x] == GEN_CELL)
+		if(walls[b] == GEN_CELL &&
+				walls[b+1] == GEN_CELL &&
+				walls[b+w] == GEN_CELL)
 		{
-			walls[(y+1)*w+x+1] = GEN_WALL;
+			crossing_gen_set(gen, b+w+1, GEN_WALL, b);
 		}
 	}
-	return ret;
+	
+	/*
+	 * A full scan would only have noticed the empty blocks it reached
+	 * after they were emptied.
+	 */
+	return gen->emptyblocks == gen->passedblocks;
 }
 
-static bool crossing_gen_walls_checkdsf(int w, int h, char *walls)
+static bool crossing_gen_walls_checkdsf(struct crossing_gen *gen)
 {
-	DSF *dsf = dsf_new(w*h);
-	int i, s, i1, i2, x, y;
-	int maxsize, maxcell, total;
+	int w = gen->w, h = gen->h;
+	char *walls = gen->walls;
+	int x, y, i;
 	
-	/* Horizontal merger */
-	for(y = 0; y < h; y++)
-	for(x = 0; x < w-1; x++)
+	if(gen->dsfstale)
 	{
-		i1 = y*w+x;
-		i2 = y*w+x+1;
-		if(walls[i1] == walls[i2])
-		{
-			dsf_merge(dsf, dsf_canonify(dsf, i1), dsf_canonify(dsf, i2));
-		}
-	}
-	
-	/* Vertical merger */
-	for(y = 0; y < h-1; y++)
-	for(x = 0; x < w; x++)
-	{
-		i1 = y*w+x;
-		i2 = (y+1)*w+x;
-		if(walls[i1] == walls[i2])
+		dsf_reinit(gen->dsf);
+		gen->lastcell = -1;
+		for(y = 0; y < h; y++)
+		for(x = 0; x < w; x++)
 		{
-			dsf_merge(dsf, dsf_canonify(dsf, i1), dsf_canonify(dsf, i2));
+			i = y*w+x;
+			if(walls[i] != GEN_CELL)
+				continue;
+			gen->lastcell = i;
+			if(x < w-1 && walls[i+1] == GEN_CELL)
+				dsf_merge(gen->dsf, i, i+1);
+			if(y < h-1 && walls[i+w] == GEN_CELL)
+				dsf_merge(gen->dsf, i, i+w);
 		}
+		gen->dsfstale = false;
 	}
 	
-	total = 0;
-	maxsize = -1;
-	maxcell = -1;
-	for(i = 0; i < w*h; i++)
-	{
-		if(walls[i] != GEN_CELL)
-			continue;
-		
-		total++;
-		s = dsf_size(dsf, i);
-		if(s > maxsize)
-		{
-			maxsize = s;
-			maxcell = dsf_canonify(dsf, i);
-		}
-	}
-	dsf_free(dsf);
-	(void)maxcell;
-	return maxsize == total;
+	return gen->cells > 0 && dsf_size(gen->dsf, gen->lastcell) == gen->cells;
 }
 
 static bool crossing_gen_walls(struct crossing_puzzle *puzzle, random_state *rs, bool sym)
@@ -989,24 +1094,33 @@ static bool crossing_gen_walls(struct crossing_puzzle *puzzle, random_state *rs,
 	int h = puzzle->h;
 	int s = w*h;
 	int i, j;
-	char *walls = snewn(s, char);
-	for(i = 0; i < s; i++) walls[i] = GEN_BLANK;
+	struct crossing_gen *gen = crossing_gen_new(w, h);
+	char *walls = gen->walls;
+	int changed[2];
+	int nchanged = 0;
 	int *spaces = snewn(s, int);
 	for(i = 0; i < s; i++) spaces[i] = i;
 	shuffle(spaces, s, sizeof(int), rs);
 	
 	for(j = 0; j < s; j++)
 	{
-		if(crossing_gen_walls_checkpool(w, h, walls) && 
-				crossing_gen_walls_checkdsf(w, h, walls))
+		if(crossing_gen_walls_checkpool(gen, changed, nchanged) && 
+				crossing_gen_walls_checkdsf(gen))
 			break;
 		
 		i = spaces[j];
+		nchanged = 0;
 		
 		if(walls[i] == GEN_BLANK)
-			walls[i] = GEN_CELL;
+		{
+			crossing_gen_set(gen, i, GEN_CELL, -1);
+			changed[nchanged++] = i;
+		}
 		if(sym && walls[s-(i+1)] == GEN_BLANK)
-			walls[s-(i+1)] = GEN_CELL;
+		{
+			crossing_gen_set(gen, s-(i+1), GEN_CELL, -1);
+			changed[nchanged++] = s-(i+1);
+		}
 	}
 	
 	/* Return wall array */
@@ -1016,7 +1130,7 @@ static bool crossing_gen_walls(struct crossing_puzzle *puzzle, random_state *rs,
 	}
 	
 	sfree(spaces);
-	sfree(walls);
+	crossing_gen_free(gen);
 	
 	return true;
 }
@@ -1899,7 +2013,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
 	dup_game,
 	free_game,
+	NULL, NULL, /* encode_state, decode_state */
 	true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
 	true, game_can_format_as_text_now, game_text_format,
     NULL, NULL, /* get_prefs, set_prefs */
 	new_ui,
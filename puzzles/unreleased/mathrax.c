@@ -386,6 +386,40 @@ static void free_game(game_state *state)
 enum { STATUS_COMPLETE, STATUS_UNFINISHED, STATUS_INVALID };
 #define BIT(d) (marks_t)(1<<((d)-1))
 
+/*
+ * Get the digits which form the clue together with digit a.
+ */
+static marks_t mathrax_partners(clue_t cluetype, int cnum, digit a)
+{
+	marks_t ret = 0;
+	switch(cluetype)
+	{
+		case CLUE_ADD:
+			if(cnum - a >= 1 && cnum - a <= 9)
+				ret |= BIT(cnum - a);
+			break;
+		case CLUE_SUB:
+			if(a + cnum <= 9)
+				ret |= BIT(a + cnum);
+			if(a - cnum >= 1)
+				ret |= BIT(a - cnum);
+			break;
+		case CLUE_MUL:
+			if(cnum % a == 0 && cnum / a >= 1 && cnum / a <= 9)
+				ret |= BIT(cnum / a);
+			break;
+		case CLUE_DIV:
+			if(cnum < 1)
+				break;
+			if(cnum <= 9 && a * cnum <= 9)
+				ret |= BIT(a * cnum);
+			if(a % cnum == 0)
+				ret |= BIT(a / cnum);
+			break;
+	}
+	return ret;
+}
+
 /*
  * Get all marks which are valid when combined with the marks in the opposite square.
  */
@@ -408,21 +442,11 @@ static marks_t mathrax_options(int o, clue_t clue, marks_t mark, bool simple)
 
 			int cnum = CLUENUM(clue);
 			marks_t ret = 0;
-			digit a, b;
+			digit a;
 			for(a = 1; a <= 9; a++)
 			{
-				if(!(mark & BIT(a))) continue;
-				for(b = 1; b <= 9; b++)
-				{
-					if(cluetype == CLUE_ADD && a + b == cnum)
-						ret |= BIT(b);
-					else if(cluetype == CLUE_SUB && abs(a - b) == cnum)
-						ret |= BIT(b);
-					else if(cluetype == CLUE_MUL && a * b == cnum)
-						ret |= BIT(b);
-					else if(cluetype == CLUE_DIV && max(a, b) / min(a, b) == cnum && max(a, b) % min(a, b) == 0)
-						ret |= BIT(b);
-				}
+				if(mark & BIT(a))
+					ret |= mathrax_partners(cluetype, cnum, a);
 			}
 
 			return ret;
@@ -585,11 +609,14 @@ static int mathrax_solver_apply_options(struct latin_solver *solver, struct solv
 
 	for(y = 0; y < o; y++)
 	for(x = 0; x < o; x++)
-	for(d = 1; d <= o; d++)
 	{
 		/* Synchronize our own marks array with the latin solver. */
-		if(!cube(x,y,d))
-			ctx->marks[y*o+x] &= ~BIT(d);
+		unsigned char *c = &cube(x,y,1);
+		for(d = 1; d <= o; d++)
+		{
+			if(!c[d-1])
+				ctx->marks[y*o+x] &= ~BIT(d);
+		}
 	}
 
 	for(y = 0; y < o; y++)
@@ -616,12 +643,13 @@ static int mathrax_solver_apply_options(struct latin_solver *solver, struct solv
 		if (diff <= DIFF_NORMAL && (marks & (marks - 1)))
 			continue;
 
+		unsigned char *c = &cube(x,y,1);
 		for(d = 1; d <= o; d++)
 		{
 			/* Synchronize the bitmap back to the latin solver. */
-			if(cube(x,y,d) && !(marks & BIT(d)))
+			if(c[d-1] && !(marks & BIT(d)))
 			{
-				cube(x,y,d) = false;
+				c[d-1] = false;
 				ret++;
 			}
 		}
@@ -1773,7 +1801,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
 	dup_game,
 	free_game,
+	NULL, NULL, /* encode_state, decode_state */
 	true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
 	false, game_can_format_as_text_now, game_text_format,
     NULL, NULL, /* get_prefs, set_prefs */
 	new_ui,
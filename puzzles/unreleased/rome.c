@@ -2286,7 +2286,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
 	dup_game,
 	free_game,
+	NULL, NULL, /* encode_state, decode_state */
 	true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
 	false, game_can_format_as_text_now, game_text_format,
     get_prefs, set_prefs,
 	new_ui,
@@ -325,6 +325,8 @@ struct solver_ctx {
 	game_state *state;
 	int order;
 	int nums;
+	/* Scratch space for latinholes_solver_count */
+	int *counts;
 };
 
 static struct solver_ctx *new_ctx(game_state *state, int order, int nums)
@@ -333,6 +335,7 @@ static struct solver_ctx *new_ctx(game_state *state, int order, int nums)
 	ctx->state = state;
 	ctx->order = order;
 	ctx->nums = nums;
+	ctx->counts = snewn(4 * order, int);
 	
 	return ctx;
 }
@@ -348,6 +351,7 @@ static void *clone_ctx(void *vctx)
 static void free_ctx(void *vctx)
 {
 	struct solver_ctx *ctx = (struct solver_ctx *)vctx;
+	sfree(ctx->counts);
 	sfree(ctx);
 }
 
@@ -362,6 +366,7 @@ static int latinholes_solver_sync(struct latin_solver *solver, struct solver_ctx
 	bool match;
 	int nums = sctx->nums;
 	int nchanged = 0;
+	unsigned char *c;
 	
 	if(nums == o)
 		return 0;
@@ -371,11 +376,13 @@ static int latinholes_solver_sync(struct latin_solver *solver, struct solver_ctx
 		if(sctx->state->holes[i])
 			continue;
 		
+		c = &cube(i%o, i/o, 1);
+		
 		/* Check for possibilities for numbers */
 		match = false;
-		for(n = 0; n < nums; n++)
+		for(n = 0; n < nums && !match; n++)
 		{
-			if(cube(i%o, i/o, n+1))
+			if(c[n])
 				match = true;
 		}
 		if(!match)
@@ -392,9 +399,9 @@ static int latinholes_solver_sync(struct latin_solver *solver, struct solver_ctx
 		
 		/* Check for possibilities for hole */
 		match = false;
-		for(n = nums; n < o; n++)
+		for(n = nums; n < o && !match; n++)
 		{
-			if(cube(i%o, i/o, n+1))
+			if(c[n])
 				match = true;
 		}
 		if(!match)
@@ -466,6 +473,26 @@ static int latinholes_solver_count(struct latin_solver *solver, struct solver_ct
 	int dir, holecount, circlecount;
 	int x, y, i, j;
 	int nchanged = 0;
+	int *holes = sctx->counts, *circles = sctx->counts + 2*o;
+	char h;
+	
+	/* Count the marks in every row and column in one pass */
+	memset(sctx->counts, 0, 4 * o * sizeof(int));
+	for(y = 0; y < o; y++)
+	for(x = 0; x < o; x++)
+	{
+		h = sctx->state->holes[y*o+x];
+		if(h == LATINH_CROSS)
+		{
+			holes[y]++;
+			holes[o+x]++;
+		}
+		else if(h == LATINH_CIRCLE)
+		{
+			circles[y]++;
+			circles[o+x]++;
+		}
+	}
 	
 	x = 0; y = 0;
 	
@@ -475,17 +502,8 @@ static int latinholes_solver_count(struct latin_solver *solver, struct solver_ct
 		{
 			if(dir) x = i; else y = i;
 			
-			holecount = 0;
-			circlecount = 0;
-			for(j = 0; j < o; j++)
-			{
-				if(dir) y = j; else x = j;
-				
-				if(sctx->state->holes[y*o+x] == LATINH_CROSS)
-					holecount++;
-				if(sctx->state->holes[y*o+x] == LATINH_CIRCLE)
-					circlecount++;
-			}
+			holecount = holes[dir*o + i];
+			circlecount = circles[dir*o + i];
 			
 			if(holecount == (o-nums))
 			{
@@ -605,6 +623,12 @@ static int salad_letters_solver_dir(struct latin_solver *solver, struct solver_c
 	bool found = false;
 	bool outofrange = false;
 	
+	/* Walk the cube along with i, instead of dividing i for each cell */
+	int x = si%o, y = si/o;
+	int dx = (di == 1 || di == -1) ? di : 0;
+	int dy = dx ? 0 : di/o;
+	unsigned char *c;
+	
 	/* 
 	 * Determine max. distance by counting the holes
 	 * which can never be used for the clue
@@ -616,8 +640,10 @@ static int salad_letters_solver_dir(struct latin_solver *solver, struct solver_c
 			maxdist--;
 	}
 	
-	for(i = si; i != ei; i+=di)
+	for(i = si; i != ei; i+=di, x+=dx, y+=dy)
 	{
+		c = &cube(x, y, 1);
+		
 		/* Rule out other possibilities near clue */
 		if(!found)
 		{
@@ -626,13 +652,13 @@ static int salad_letters_solver_dir(struct latin_solver *solver, struct solver_c
 				if(j == clue)
 					continue;
 				
-				if(cube(i%o, i/o, j))
+				if(c[j-1])
 				{
 #ifdef STANDALONE_SOLVER
 					if(solver_show_working)
-						printf("Border %c (%d) rules out %c at %d,%d\n", clue+'A'-1, cd, j+'A'-1, i%o, i/o);
+						printf("Border %c (%d) rules out %c at %d,%d\n", clue+'A'-1, cd, j+'A'-1, x, y);
 #endif
-					cube(i%o, i/o, j) = false;
+					c[j-1] = false;
 					nchanged++;
 				}
 			}
@@ -645,13 +671,13 @@ static int salad_letters_solver_dir(struct latin_solver *solver, struct solver_c
 		
 		if(outofrange)
 		{
-			if(cube(i%o, i/o, clue))
+			if(c[clue-1])
 			{
 #ifdef STANDALONE_SOLVER
 				if(solver_show_working)
-					printf("Border %c is too far away from %d,%d\n", clue+'A'-1, i%o, i/o);
+					printf("Border %c is too far away from %d,%d\n", clue+'A'-1, x, y);
 #endif
-				cube(i%o, i/o, clue) = false;
+				c[clue-1] = false;
 				nchanged++;
 			}
 		}
@@ -2490,7 +2516,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
 	dup_game,
 	free_game,
+	NULL, NULL, /* encode_state, decode_state */
 	true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
 	true, game_can_format_as_text_now, game_text_format,
     NULL, NULL, /* get_prefs, set_prefs */
 	new_ui,
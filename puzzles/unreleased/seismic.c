@@ -308,6 +308,72 @@ static void free_game(game_state *state)
 #define AREA_BITS(x) ( NUM_BIT((x)+1)-1 )
 #define FM_MARKS AREA_BITS(9)
 
+struct seismic_scratch {
+	/* The canonical cell of the area each cell is in */
+	int *area;
+	/* The next cell in the same area, going round in a cycle */
+	int *next;
+	/* The marks each area must contain, indexed by canonical cell */
+	int *areabits;
+	
+	/* Room for seismic_solver_areas and seismic_solver_attempt */
+	int *singles, *doubles;
+	char *grid;
+	int *marks;
+};
+
+static struct seismic_scratch *seismic_new_scratch(game_state *state)
+{
+	/* The areas don't change while solving, so look them up once */
+	
+	int s = state->w * state->h;
+	int i, c;
+	struct seismic_scratch *scratch = snew(struct seismic_scratch);
+	int *last = snewn(s, int);
+	
+	scratch->area = snewn(s, int);
+	scratch->next = snewn(s, int);
+	scratch->areabits = snewn(s, int);
+	scratch->singles = snewn(s, int);
+	scratch->doubles = snewn(s, int);
+	scratch->grid = snewn(s, char);
+	scratch->marks = snewn(s, int);
+	
+	for(i = 0; i < s; i++)
+	{
+		c = scratch->area[i] = dsf_canonify(state->dsf, i);
+		if(c == i)
+		{
+			scratch->areabits[i] = AREA_BITS(dsf_size(state->dsf, i));
+			scratch->next[i] = last[i] = i;
+		}
+	}
+	for(i = 0; i < s; i++)
+	{
+		c = scratch->area[i];
+		if(c == i)
+			continue;
+		scratch->next[i] = c;
+		scratch->next[last[c]] = i;
+		last[c] = i;
+	}
+	
+	sfree(last);
+	return scratch;
+}
+
+static void seismic_free_scratch(struct seismic_scratch *scratch)
+{
+	sfree(scratch->area);
+	sfree(scratch->next);
+	sfree(scratch->areabits);
+	sfree(scratch->singles);
+	sfree(scratch->doubles);
+	sfree(scratch->grid);
+	sfree(scratch->marks);
+	sfree(scratch);
+}
+
 static int seismic_unset(game_state *state, int x, int y, char n)
 {
 	/* Remove one mark from a cell */
@@ -325,10 +391,12 @@ static int seismic_unset(game_state *state, int x, int y, char n)
 	return 0;
 }
 
-static int seismic_place_number(game_state *state, int x, int y, char n)
+static int seismic_place_number(game_state *state, struct seismic_scratch *scratch,
+	int x, int y, char n)
 {
 	/* Place a number in the grid, and rule out this number
-	 * in all cells in range, and in the rest of the region. */
+	 * in all cells in range, and in the rest of the region.
+	 * Without a scratch, the region is found using the dsf. */
 	
 	int ret = 0;
 	int w = state->w;
@@ -372,19 +440,27 @@ static int seismic_place_number(game_state *state, int x, int y, char n)
 			}
 	}
 	
-	c1 = dsf_canonify(state->dsf, i);
-	for(j = 0; j < w*h; j++)
+	if(scratch)
 	{
-		if(j == i)
-			continue;
-		if(c1 == dsf_canonify(state->dsf, j))
+		for(j = scratch->next[i]; j != i; j = scratch->next[j])
 			ret += seismic_unset(state, j%w, j/w, n);
 	}
+	else if(dsf_size(state->dsf, i) > 1)
+	{
+		c1 = dsf_canonify(state->dsf, i);
+		for(j = 0; j < w*h; j++)
+		{
+			if(j == i)
+				continue;
+			if(c1 == dsf_canonify(state->dsf, j))
+				ret += seismic_unset(state, j%w, j/w, n);
+		}
+	}
 	
 	return ret;
 }
 
-static void seismic_solver_init(game_state *state)
+static void seismic_solver_init(game_state *state, struct seismic_scratch *scratch)
 {
 	/* Add the maximum amount of marks to each cell, and 
 	 * process the marks for each given clue. */
@@ -395,16 +471,16 @@ static void seismic_solver_init(game_state *state)
 	int i;
 	
 	for(i = 0; i < w*h; i++)
-		state->marks[i] = AREA_BITS(dsf_size(state->dsf, i));
+		state->marks[i] = scratch->areabits[scratch->area[i]];
 	
 	for(i = 0; i < s; i++)
 	{
 		if(state->grid[i] != 0)
-			seismic_place_number(state, i%w, i/w, state->grid[i]);
+			seismic_place_number(state, scratch, i%w, i/w, state->grid[i]);
 	}
 }
 
-static int seismic_solver_marks(game_state *state)
+static int seismic_solver_marks(game_state *state, struct seismic_scratch *scratch)
 {
 	/* Check if a cell has one mark left, then place that number */
 	
@@ -423,14 +499,14 @@ static int seismic_solver_marks(game_state *state)
 		for(j = 1; j <= 9; j++)
 		{
 			if(state->marks[i] == NUM_BIT(j))
-				ret += seismic_place_number(state, i%w, i/w, j);
+				ret += seismic_place_number(state, scratch, i%w, i/w, j);
 		}
 	}
 	
 	return ret;
 }
 
-static int seismic_solver_areas(game_state *state)
+static int seismic_solver_areas(game_state *state, struct seismic_scratch *scratch)
 {
 	/* Check if a region has a single possibility for a certain number,
 	 * then remove all other marks from that cell */
@@ -443,23 +519,23 @@ static int seismic_solver_areas(game_state *state)
 	int ret = 0;
 	
 	/* Marks which appear at least once */
-	int *singles = snewn(s, int);
+	int *singles = scratch->singles;
 	/* Marks which appear at least twice */
-	int *doubles = snewn(s, int);
+	int *doubles = scratch->doubles;
 	
 	memset(singles, 0, s*sizeof(int));
 	memset(doubles, 0, s*sizeof(int));
 	
 	for(i = 0; i < s; i++)
 	{
-		c = dsf_canonify(state->dsf, i);
+		c = scratch->area[i];
 		doubles[c] |= state->marks[i] & singles[c];
 		singles[c] |= state->marks[i];
 	}
 	
 	for(i = 0; i < s; i++)
 	{
-		c = dsf_canonify(state->dsf, i);
+		c = scratch->area[i];
 		prev = state->marks[i];
 		if(state->marks[i] & (singles[c] ^ doubles[c]))
 			state->marks[i] &= singles[c] ^ doubles[c];
@@ -468,12 +544,10 @@ static int seismic_solver_areas(game_state *state)
 			ret++;
 	}
 	
-	sfree(singles);
-	sfree(doubles);
 	return ret;
 }
 
-static int seismic_solver_attempt(game_state *state)
+static int seismic_solver_attempt(game_state *state, struct seismic_scratch *scratch)
 {
 	/* Try to place a number, and see if this directly leads to an error */
 	
@@ -483,9 +557,9 @@ static int seismic_solver_attempt(game_state *state)
 	int i, j, n;
 	bool valid;
 	
-	char *grid = snewn(s, char);
-	int *marks = snewn(s, int);
-	int *areas = snewn(s, int);
+	char *grid = scratch->grid;
+	int *marks = scratch->marks;
+	int *areas = scratch->singles;
 	
 	for(i = 0; i < s; i++)
 	{
@@ -502,21 +576,21 @@ static int seismic_solver_attempt(game_state *state)
 			memset(areas, 0, s*sizeof(int));
 			
 			valid = true;
-			seismic_place_number(state, i%w, i/w, n);
+			seismic_place_number(state, scratch, i%w, i/w, n);
 			
 			/* Get all marks for each region */
 			for(j = 0; j < s; j++)
 			{
-				areas[dsf_canonify(state->dsf, j)] |= state->marks[j];
+				areas[scratch->area[j]] |= state->marks[j];
 			}
 			
 			/* If any number no longer appears in the total marks, 
 			 * we have found an error */
 			for(j = 0; j < s && valid; j++)
 			{
-				if(j != dsf_canonify(state->dsf, j)) continue;
+				if(j != scratch->area[j]) continue;
 				
-				if(areas[j] != AREA_BITS(dsf_size(state->dsf, j)))
+				if(areas[j] != scratch->areabits[j])
 					valid = false;
 			}
 			
@@ -530,9 +604,6 @@ static int seismic_solver_attempt(game_state *state)
 		}
 	}
 	
-	sfree(grid);
-	sfree(marks);
-	sfree(areas);
 	return ret;
 }
 
@@ -641,30 +712,33 @@ static int seismic_validate_game(game_state *state)
 static int seismic_solve_game(game_state *state, int maxdiff)
 {
 	int diff = DIFF_EASY;
+	struct seismic_scratch *scratch = seismic_new_scratch(state);
 	
-	seismic_solver_init(state);
+	seismic_solver_init(state, scratch);
 	
 	while(true)
 	{
 		if(seismic_validate_game(state) != STATUS_UNFINISHED)
 			break;
 		
-		if(seismic_solver_marks(state))
+		if(seismic_solver_marks(state, scratch))
 			continue;
 		
-		if(seismic_solver_areas(state))
+		if(seismic_solver_areas(state, scratch))
 			continue;
 			
 		if(maxdiff < DIFF_HARD)
 			break;
 		diff = max(diff, DIFF_HARD);
 		
-		if(seismic_solver_attempt(state))
+		if(seismic_solver_attempt(state, scratch))
 			continue;
 		
 		break;
 	}
 	
+	seismic_free_scratch(scratch);
+	
 	if(seismic_validate_game(state) != STATUS_COMPLETE)
 		return -1;
 	
@@ -697,12 +771,15 @@ static bool seismic_gen_numbers(game_state *state, random_state *rs)
 		{
 			if(state->marks[i] & NUM_BIT(k))
 			{
-				seismic_place_number(state, i%w, i/w, k);
+				seismic_place_number(state, NULL, i%w, i/w, k);
 				break;
 			}
 		}
 		if (k > 9)
+		{
+			sfree(spaces);
 			return false;
+		}
 	}
 	
 	sfree(spaces);
@@ -732,7 +809,7 @@ static bool tectonic_gen_numbers(game_state *state, random_state *rs)
 			k = spaces[j];
 			if (state->marks[i] & NUM_BIT(k))
 			{
-				seismic_place_number(state, i%w, i/w, k);
+				seismic_place_number(state, NULL, i%w, i/w, k);
 				counts[k - 1]++;
 				break;
 			}
@@ -1931,7 +2008,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
 	dup_game,
 	free_game,
+	NULL, NULL, /* encode_state, decode_state */
 	true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
 	true, game_can_format_as_text_now, game_text_format,
     NULL, NULL, /* get_prefs, set_prefs */
 	new_ui,
@@ -161,12 +161,15 @@ typedef struct unruly_common {
 struct game_state {
     int w2, h2;
     bool unique;
-    char *grid;
+    cow_array *grid;                   /* of char */
     unruly_common *common;
 
     bool completed, cheated;
 };
 
+#define GRID(state, i) COW_GET(char, (state)->grid, i)
+#define GRID_PUT(state, i) COW_PUT(char, (state)->grid, i)
+
 static game_params *default_params(void)
 {
     game_params *ret = snew(game_params);
@@ -379,8 +382,7 @@ static game_state *blank_state(int w2, int h2, bool unique, bool new_common)
     state->w2 = w2;
     state->h2 = h2;
     state->unique = unique;
-    state->grid = snewn(s, char);
-    memset(state->grid, EMPTY, s);
+    state->grid = cow_new(s, sizeof(char));     /* all EMPTY */
 
     if (new_common) {
 	state->common = snew(unruly_common);
@@ -409,14 +411,14 @@ static game_state *new_game(midend *me, const game_params *params,
         if (*p >= 'a' && *p < 'z') {
             pos += (*p - 'a');
             if (pos < s) {
-                state->grid[pos] = N_ZERO;
+                GRID_PUT(state, pos) = N_ZERO;
                 state->common->immutable[pos] = true;
             }
             pos++;
         } else if (*p >= 'A' && *p < 'Z') {
             pos += (*p - 'A');
             if (pos < s) {
-                state->grid[pos] = N_ONE;
+                GRID_PUT(state, pos) = N_ONE;
                 state->common->immutable[pos] = true;
             }
             pos++;
@@ -434,12 +436,12 @@ static game_state *new_game(midend *me, const game_params *params,
 
 static game_state *dup_game(const game_state *state)
 {
-    int w2 = state->w2, h2 = state->h2;
-    int s = w2 * h2;
+    game_state *ret = snew(game_state);
 
-    game_state *ret = blank_state(w2, h2, state->unique, false);
-
-    memcpy(ret->grid, state->grid, s);
+    ret->w2 = state->w2;
+    ret->h2 = state->h2;
+    ret->unique = state->unique;
+    ret->grid = cow_dup(state->grid);
     ret->common = state->common;
     ret->common->refcount++;
 
@@ -451,7 +453,7 @@ static game_state *dup_game(const game_state *state)
 
 static void free_game(game_state *state)
 {
-    sfree(state->grid);
+    cow_free(state->grid);
     if (--state->common->refcount == 0) {
         sfree(state->common->immutable);
         sfree(state->common);
@@ -477,7 +479,7 @@ static char *game_text_format(const game_state *state)
     for (y = 0; y < h2; y++) {
         for (x = 0; x < w2; x++) {
             /* Place number */
-            char c = state->grid[y * w2 + x];
+            char c = GRID(state, y * w2 + x);
             *p++ = (c == N_ONE ? '1' : c == N_ZERO ? '0' : '.');
             *p++ = ' ';
         }
@@ -494,17 +496,33 @@ static char *game_text_format(const game_state *state)
  * Solver *
  * ****** */
 
+/*
+ * Alongside the counts of each number in each row and column, the
+ * solver keeps every row and column as a pair of bitmaps: one bit per
+ * square for where the 1s are, and one for the 0s. Row bitmaps have
+ * bit x for column x; column bitmaps have bit y for row y. The rules
+ * about three in a row and about identical rows then work on whole
+ * words at a time.
+ */
 struct unruly_scratch {
     int *ones_rows;
     int *ones_cols;
     int *zeros_rows;
     int *zeros_cols;
+
+    int rwords, cwords;         /* words in a row and a column bitmap */
+    unsigned long *ones_rbits;  /* h2 row bitmaps */
+    unsigned long *zeros_rbits;
+    unsigned long *ones_cbits;  /* w2 column bitmaps */
+    unsigned long *zeros_cbits;
+    unsigned long *tmp;         /* 4 bitmaps of the longer length */
 };
 
 static void unruly_solver_update_remaining(const game_state *state,
                                            struct unruly_scratch *scratch)
 {
     int w2 = state->w2, h2 = state->h2;
+    int rw = scratch->rwords, cw = scratch->cwords;
     int x, y;
 
     /* Reset all scratch data */
@@ -512,15 +530,23 @@ static void unruly_solver_update_remaining(const game_state *state,
     memset(scratch->ones_cols, 0, w2 * sizeof(int));
     memset(scratch->zeros_rows, 0, h2 * sizeof(int));
     memset(scratch->zeros_cols, 0, w2 * sizeof(int));
+    memset(scratch->ones_rbits, 0, h2 * rw * sizeof(unsigned long));
+    memset(scratch->zeros_rbits, 0, h2 * rw * sizeof(unsigned long));
+    memset(scratch->ones_cbits, 0, w2 * cw * sizeof(unsigned long));
+    memset(scratch->zeros_cbits, 0, w2 * cw * sizeof(unsigned long));
 
     for (x = 0; x < w2; x++)
         for (y = 0; y < h2; y++) {
-            if (state->grid[y * w2 + x] == N_ONE) {
+            if (GRID(state, y * w2 + x) == N_ONE) {
                 scratch->ones_rows[y]++;
                 scratch->ones_cols[x]++;
-            } else if (state->grid[y * w2 + x] == N_ZERO) {
+                BITMAP_SET(scratch->ones_rbits + y * rw, x);
+                BITMAP_SET(scratch->ones_cbits + x * cw, y);
+            } else if (GRID(state, y * w2 + x) == N_ZERO) {
                 scratch->zeros_rows[y]++;
                 scratch->zeros_cols[x]++;
+                BITMAP_SET(scratch->zeros_rbits + y * rw, x);
+                BITMAP_SET(scratch->zeros_cbits + x * cw, y);
             }
         }
 }
@@ -536,6 +562,14 @@ static struct unruly_scratch *unruly_new_scratch(const game_state *state)
     ret->zeros_rows = snewn(h2, int);
     ret->zeros_cols = snewn(w2, int);
 
+    ret->rwords = BITMAP_WORDS(w2);
+    ret->cwords = BITMAP_WORDS(h2);
+    ret->ones_rbits = snewn(h2 * ret->rwords, unsigned long);
+    ret->zeros_rbits = snewn(h2 * ret->rwords, unsigned long);
+    ret->ones_cbits = snewn(w2 * ret->cwords, unsigned long);
+    ret->zeros_cbits = snewn(w2 * ret->cwords, unsigned long);
+    ret->tmp = snewn(4 * max(ret->rwords, ret->cwords), unsigned long);
+
     unruly_solver_update_remaining(state, ret);
 
     return ret;
@@ -547,74 +581,128 @@ static void unruly_free_scratch(struct unruly_scratch *scratch)
     sfree(scratch->ones_cols);
     sfree(scratch->zeros_rows);
     sfree(scratch->zeros_cols);
+    sfree(scratch->ones_rbits);
+    sfree(scratch->zeros_rbits);
+    sfree(scratch->ones_cbits);
+    sfree(scratch->zeros_cbits);
+    sfree(scratch->tmp);
 
     sfree(scratch);
 }
 
-static int unruly_solver_check_threes(game_state *state, int *rowcount,
-                                      int *colcount, bool horizontal,
-                                      char check, char block)
+/* Fill in an empty square, keeping the counts and bitmaps up to date. */
+static void unruly_solver_place(game_state *state,
+                                struct unruly_scratch *scratch,
+                                int i, char c)
 {
-    int w2 = state->w2, h2 = state->h2;
+    int w2 = state->w2, x = i % w2, y = i / w2;
+
+    assert(GRID(state, i) == EMPTY);
+    GRID_PUT(state, i) = c;
+    if (c == N_ONE) {
+        scratch->ones_rows[y]++;
+        scratch->ones_cols[x]++;
+        BITMAP_SET(scratch->ones_rbits + y * scratch->rwords, x);
+        BITMAP_SET(scratch->ones_cbits + x * scratch->cwords, y);
+    } else {
+        scratch->zeros_rows[y]++;
+        scratch->zeros_cols[x]++;
+        BITMAP_SET(scratch->zeros_rbits + y * scratch->rwords, x);
+        BITMAP_SET(scratch->zeros_cbits + x * scratch->cwords, y);
+    }
+}
 
-    int dx = horizontal ? 1 : 0, dy = 1 - dx;
-    int sx = dx, sy = dy;
-    int ex = w2 - dx, ey = h2 - dy;
+/* Shift an n-word bitmap towards higher (up) or lower bit numbers. */
+static void unruly_bits_shift(unsigned long *dst, const unsigned long *src,
+                              int n, int k, bool up)
+{
+    int j;
 
-    int x, y;
-    int ret = 0;
+    for (j = 0; j < n; j++) {
+        if (up)
+            dst[j] = (src[j] << k) |
+                (j > 0 ? src[j-1] >> (BITMAP_WORD_BITS - k) : 0);
+        else
+            dst[j] = (src[j] >> k) |
+                (j+1 < n ? src[j+1] << (BITMAP_WORD_BITS - k) : 0);
+    }
+}
 
-    /* Check for any three squares which almost form three in a row */
-    for (y = sy; y < ey; y++) {
-        for (x = sx; x < ex; x++) {
-            int i1 = (y-dy) * w2 + (x-dx);
-            int i2 = y * w2 + x;
-            int i3 = (y+dy) * w2 + (x+dx);
+static int unruly_bits_count(const unsigned long *bits, int n)
+{
+    int j, ret = 0;
+    unsigned long b;
 
-            if (state->grid[i1] == check && state->grid[i2] == check
-                && state->grid[i3] == EMPTY) {
-                ret++;
-#ifdef STANDALONE_SOLVER
-                if (solver_verbose) {
-                    printf("Solver: %i,%i and %i,%i confirm %c at %i,%i\n",
-                           i1 % w2, i1 / w2, i2 % w2, i2 / w2,
-                           (block == N_ONE ? '1' : '0'), i3 % w2,
-                           i3 / w2);
-                }
-#endif
-                state->grid[i3] = block;
-                rowcount[i3 / w2]++;
-                colcount[i3 % w2]++;
+    for (j = 0; j < n; j++)
+        for (b = bits[j]; b; b &= b - 1)
+            ret++;
+    return ret;
+}
+
+static int unruly_solver_check_threes(game_state *state,
+                                      struct unruly_scratch *scratch,
+                                      bool horizontal,
+                                      char check, char block)
+{
+    int w2 = state->w2, h2 = state->h2;
+    int rw = scratch->rwords;
+    const unsigned long *cbits =
+        (check == N_ONE ? scratch->ones_rbits : scratch->zeros_rbits);
+    unsigned long *l1 = scratch->tmp, *l2 = l1 + rw;
+    unsigned long *r1 = l2 + rw, *r2 = r1 + rw;
+    unsigned long force;
+
+    int x, y, j;
+    int ret = 0;
+
+    /*
+     * Find every empty square next to two squares of 'check' in a
+     * line, in this row (horizontally) or between this row and its
+     * neighbours above and below (vertically). Squares filled in here
+     * never count as 'check', so the set of squares to fill can all be
+     * worked out up front.
+     */
+    for (y = 0; y < h2; y++) {
+        const unsigned long *c = cbits + y * rw;
+        const unsigned long *ones = scratch->ones_rbits + y * rw;
+        const unsigned long *zeros = scratch->zeros_rbits + y * rw;
+
+        if (horizontal) {
+            unruly_bits_shift(l1, c, rw, 1, true);
+            unruly_bits_shift(l2, c, rw, 2, true);
+            unruly_bits_shift(r1, c, rw, 1, false);
+            unruly_bits_shift(r2, c, rw, 2, false);
+        } else {
+            /* 'l' is above this row and 'r' below it. */
+            for (j = 0; j < rw; j++) {
+                l1[j] = (y >= 1 ? cbits[(y-1) * rw + j] : 0);
+                l2[j] = (y >= 2 ? cbits[(y-2) * rw + j] : 0);
+                r1[j] = (y+1 < h2 ? cbits[(y+1) * rw + j] : 0);
+                r2[j] = (y+2 < h2 ? cbits[(y+2) * rw + j] : 0);
             }
-            if (state->grid[i1] == check && state->grid[i2] == EMPTY
-                && state->grid[i3] == check) {
-                ret++;
-#ifdef STANDALONE_SOLVER
-                if (solver_verbose) {
-                    printf("Solver: %i,%i and %i,%i confirm %c at %i,%i\n",
-                           i1 % w2, i1 / w2, i3 % w2, i3 / w2,
-                           (block == N_ONE ? '1' : '0'), i2 % w2,
-                           i2 / w2);
+        }
+
+        for (j = 0; j < rw; j++) {
+            force = ~(ones[j] | zeros[j]) &
+                ((l1[j] & l2[j]) | (l1[j] & r1[j]) | (r1[j] & r2[j]));
+            for (; force; force &= force - 1) {
+                unsigned long b = force & -force;
+                x = j * BITMAP_WORD_BITS;
+                while (!(b & 1)) {
+                    b >>= 1;
+                    x++;
                 }
-#endif
-                state->grid[i2] = block;
-                rowcount[i2 / w2]++;
-                colcount[i2 % w2]++;
-            }
-            if (state->grid[i1] == EMPTY && state->grid[i2] == check
-                && state->grid[i3] == check) {
+                if (x >= w2)
+                    break;
                 ret++;
 #ifdef STANDALONE_SOLVER
                 if (solver_verbose) {
-                    printf("Solver: %i,%i and %i,%i confirm %c at %i,%i\n",
-                           i2 % w2, i2 / w2, i3 % w2, i3 / w2,
-                           (block == N_ONE ? '1' : '0'), i1 % w2,
-                           i1 / w2);
+                    printf("Solver: %s neighbours confirm %c at %i,%i\n",
+                           horizontal ? "horizontal" : "vertical",
+                           (block == N_ONE ? '1' : '0'), x, y);
                 }
 #endif
-                state->grid[i1] = block;
-                rowcount[i1 / w2]++;
-                colcount[i1 % w2]++;
+                unruly_solver_place(state, scratch, y * w2 + x, block);
             }
         }
     }
@@ -627,19 +715,10 @@ static int unruly_solver_check_all_threes(game_state *state,
 {
     int ret = 0;
 
-    ret +=
-        unruly_solver_check_threes(state, scratch->zeros_rows,
-                                   scratch->zeros_cols, true, N_ONE, N_ZERO);
-    ret +=
-        unruly_solver_check_threes(state, scratch->ones_rows,
-                                   scratch->ones_cols, true, N_ZERO, N_ONE);
-    ret +=
-        unruly_solver_check_threes(state, scratch->zeros_rows,
-                                   scratch->zeros_cols, false, N_ONE,
-                                   N_ZERO);
-    ret +=
-        unruly_solver_check_threes(state, scratch->ones_rows,
-                                   scratch->ones_cols, false, N_ZERO, N_ONE);
+    ret += unruly_solver_check_threes(state, scratch, true, N_ONE, N_ZERO);
+    ret += unruly_solver_check_threes(state, scratch, true, N_ZERO, N_ONE);
+    ret += unruly_solver_check_threes(state, scratch, false, N_ONE, N_ZERO);
+    ret += unruly_solver_check_threes(state, scratch, false, N_ZERO, N_ONE);
 
     return ret;
 }
@@ -654,9 +733,15 @@ static int unruly_solver_check_uniques(game_state *state, int *rowcount,
     int cmult = (horizontal ? 1 : w2);
     int nr = (horizontal ? h2 : w2);
     int nc = (horizontal ? w2 : h2);
+    int nw = (horizontal ? scratch->rwords : scratch->cwords);
     int max = nc / 2;
+    const unsigned long *bits =
+        (horizontal ?
+         (check == N_ONE ? scratch->ones_rbits : scratch->zeros_rbits) :
+         (check == N_ONE ? scratch->ones_cbits : scratch->zeros_cbits));
+    unsigned long *match = scratch->tmp, *nonmatch = match + nw;
 
-    int r, r2, c;
+    int r, r2, c, j;
     int ret = 0;
 
     /*
@@ -666,26 +751,27 @@ static int unruly_solver_check_uniques(game_state *state, int *rowcount,
      * that it's different.
      */
     for (r = 0; r < nr; r++) {
+        const unsigned long *br = bits + r * nw;
         if (rowcount[r] != max)
             continue;
         for (r2 = 0; r2 < nr; r2++) {
-            int nmatch = 0, nonmatch = -1;
+            const unsigned long *br2 = bits + r2 * nw;
             if (rowcount[r2] != max-1)
                 continue;
-            for (c = 0; c < nc; c++) {
-                if (state->grid[r*rmult + c*cmult] == check) {
-                    if (state->grid[r2*rmult + c*cmult] == check)
-                        nmatch++;
-                    else
-                        nonmatch = c;
-                }
+            for (j = 0; j < nw; j++) {
+                match[j] = br[j] & br2[j];
+                nonmatch[j] = br[j] & ~br2[j];
             }
-            if (nmatch == max-1) {
-                int i1 = r2 * rmult + nonmatch * cmult;
-                assert(nonmatch != -1);
-                if (state->grid[i1] == block)
+            if (unruly_bits_count(match, nw) == max-1) {
+                int i1;
+                for (c = nc - 1; c >= 0; c--)
+                    if (BITMAP_GET(nonmatch, c))
+                        break;
+                assert(c >= 0);
+                i1 = r2 * rmult + c * cmult;
+                if (GRID(state, i1) == block)
                     continue;
-                assert(state->grid[i1] == EMPTY);
+                assert(GRID(state, i1) == EMPTY);
 #ifdef STANDALONE_SOLVER
                 if (solver_verbose) {
                     printf("Solver: matching %s %i, %i gives %c at %i,%i\n",
@@ -694,14 +780,7 @@ static int unruly_solver_check_uniques(game_state *state, int *rowcount,
                            i1 / w2);
                 }
 #endif
-                state->grid[i1] = block;
-                if (block == N_ONE) {
-                    scratch->ones_rows[i1 / w2]++;
-                    scratch->ones_cols[i1 % w2]++;
-                } else {
-                    scratch->zeros_rows[i1 / w2]++;
-                    scratch->zeros_cols[i1 % w2]++;
-                }
+                unruly_solver_place(state, scratch, i1, block);
                 ret++;
             }
         }
@@ -727,7 +806,7 @@ static int unruly_solver_check_all_uniques(game_state *state,
 }
 
 static int unruly_solver_fill_row(game_state *state, int i, bool horizontal,
-                                  int *rowcount, int *colcount, char fill)
+                                  struct unruly_scratch *scratch, char fill)
 {
     int ret = 0;
     int w2 = state->w2, h2 = state->h2;
@@ -744,7 +823,7 @@ static int unruly_solver_fill_row(game_state *state, int i, bool horizontal,
     for (j = 0; j < (horizontal ? w2 : h2); j++) {
         int p = (horizontal ? i * w2 + j : j * w2 + i);
 
-        if (state->grid[p] == EMPTY) {
+        if (GRID(state, p) == EMPTY) {
 #ifdef STANDALONE_SOLVER
             if (solver_verbose) {
                 printf(" (%i,%i)", (horizontal ? j : i),
@@ -752,9 +831,7 @@ static int unruly_solver_fill_row(game_state *state, int i, bool horizontal,
             }
 #endif
             ret++;
-            state->grid[p] = fill;
-            rowcount[(horizontal ? i : j)]++;
-            colcount[(horizontal ? j : i)]++;
+            unruly_solver_place(state, scratch, p, fill);
         }
     }
 
@@ -770,7 +847,8 @@ static int unruly_solver_fill_row(game_state *state, int i, bool horizontal,
 static int unruly_solver_check_single_gap(game_state *state,
                                           int *complete, bool horizontal,
                                           int *rowcount, int *colcount,
-                                          char fill)
+                                          char fill,
+                                          struct unruly_scratch *scratch)
 {
     int w2 = state->w2, h2 = state->h2;
     int count = (horizontal ? h2 : w2); /* number of rows to check */
@@ -789,8 +867,7 @@ static int unruly_solver_check_single_gap(game_state *state,
                        "%c\n", i, (fill == N_ZERO ? '0' : '1'));
             }
 #endif
-            ret += unruly_solver_fill_row(state, i, horizontal, rowcount,
-                                          colcount, fill);
+            ret += unruly_solver_fill_row(state, i, horizontal, scratch, fill);
         }
     }
 
@@ -805,19 +882,19 @@ static int unruly_solver_check_all_single_gap(game_state *state,
     ret +=
         unruly_solver_check_single_gap(state, scratch->ones_rows, true,
                                        scratch->zeros_rows,
-                                       scratch->zeros_cols, N_ZERO);
+                                       scratch->zeros_cols, N_ZERO, scratch);
     ret +=
         unruly_solver_check_single_gap(state, scratch->ones_cols, false,
                                        scratch->zeros_rows,
-                                       scratch->zeros_cols, N_ZERO);
+                                       scratch->zeros_cols, N_ZERO, scratch);
     ret +=
         unruly_solver_check_single_gap(state, scratch->zeros_rows, true,
                                        scratch->ones_rows,
-                                       scratch->ones_cols, N_ONE);
+                                       scratch->ones_cols, N_ONE, scratch);
     ret +=
         unruly_solver_check_single_gap(state, scratch->zeros_cols, false,
                                        scratch->ones_rows,
-                                       scratch->ones_cols, N_ONE);
+                                       scratch->ones_cols, N_ONE, scratch);
 
     return ret;
 }
@@ -825,7 +902,8 @@ static int unruly_solver_check_all_single_gap(game_state *state,
 static int unruly_solver_check_complete_nums(game_state *state,
                                              int *complete, bool horizontal,
                                              int *rowcount, int *colcount,
-                                             char fill)
+                                             char fill,
+                                             struct unruly_scratch *scratch)
 {
     int w2 = state->w2, h2 = state->h2;
     int count = (horizontal ? h2 : w2); /* number of rows to check */
@@ -844,8 +922,7 @@ static int unruly_solver_check_complete_nums(game_state *state,
                        (fill != N_ZERO ? '0' : '1'));
             }
 #endif
-            ret += unruly_solver_fill_row(state, i, horizontal, rowcount,
-                                          colcount, fill);
+            ret += unruly_solver_fill_row(state, i, horizontal, scratch, fill);
         }
     }
 
@@ -860,19 +937,19 @@ static int unruly_solver_check_all_complete_nums(game_state *state,
     ret +=
         unruly_solver_check_complete_nums(state, scratch->ones_rows, true,
                                           scratch->zeros_rows,
-                                          scratch->zeros_cols, N_ZERO);
+                                          scratch->zeros_cols, N_ZERO, scratch);
     ret +=
         unruly_solver_check_complete_nums(state, scratch->ones_cols, false,
                                           scratch->zeros_rows,
-                                          scratch->zeros_cols, N_ZERO);
+                                          scratch->zeros_cols, N_ZERO, scratch);
     ret +=
         unruly_solver_check_complete_nums(state, scratch->zeros_rows, true,
                                           scratch->ones_rows,
-                                          scratch->ones_cols, N_ONE);
+                                          scratch->ones_cols, N_ONE, scratch);
     ret +=
         unruly_solver_check_complete_nums(state, scratch->zeros_cols, false,
                                           scratch->ones_rows,
-                                          scratch->ones_cols, N_ONE);
+                                          scratch->ones_cols, N_ONE, scratch);
 
     return ret;
 }
@@ -880,7 +957,8 @@ static int unruly_solver_check_all_complete_nums(game_state *state,
 static int unruly_solver_check_near_complete(game_state *state,
                                              int *complete, bool horizontal,
                                              int *rowcount, int *colcount,
-                                             char fill)
+                                             char fill,
+                                             struct unruly_scratch *scratch)
 {
     int w2 = state->w2, h2 = state->h2;
     int w = w2/2, h = h2/2;
@@ -925,14 +1003,14 @@ static int unruly_solver_check_near_complete(game_state *state,
             i2 = y * w2 + x;
             i3 = (y+dy) * w2 + (x+dx);
 
-            if (state->grid[i1] == fill && state->grid[i2] == EMPTY
-                && state->grid[i3] == EMPTY) {
+            if (GRID(state, i1) == fill && GRID(state, i2) == EMPTY
+                && GRID(state, i3) == EMPTY) {
                 /*
                  * Temporarily fill the empty spaces with something else.
                  * This avoids raising the counts for the row and column
                  */
-                state->grid[i2] = BOGUS;
-                state->grid[i3] = BOGUS;
+                GRID_PUT(state, i2) = BOGUS;
+                GRID_PUT(state, i3) = BOGUS;
 
 #ifdef STANDALONE_SOLVER
                 if (solver_verbose) {
@@ -941,17 +1019,16 @@ static int unruly_solver_check_near_complete(game_state *state,
                 }
 #endif
                 ret +=
-                    unruly_solver_fill_row(state, i, horizontal, rowcount,
-                                         colcount, fill);
+                    unruly_solver_fill_row(state, i, horizontal, scratch, fill);
 
-                state->grid[i2] = EMPTY;
-                state->grid[i3] = EMPTY;
+                GRID_PUT(state, i2) = EMPTY;
+                GRID_PUT(state, i3) = EMPTY;
             }
 
-            else if (state->grid[i1] == EMPTY && state->grid[i2] == fill
-                     && state->grid[i3] == EMPTY) {
-                state->grid[i1] = BOGUS;
-                state->grid[i3] = BOGUS;
+            else if (GRID(state, i1) == EMPTY && GRID(state, i2) == fill
+                     && GRID(state, i3) == EMPTY) {
+                GRID_PUT(state, i1) = BOGUS;
+                GRID_PUT(state, i3) = BOGUS;
 
 #ifdef STANDALONE_SOLVER
                 if (solver_verbose) {
@@ -960,17 +1037,16 @@ static int unruly_solver_check_near_complete(game_state *state,
                 }
 #endif
                 ret +=
-                    unruly_solver_fill_row(state, i, horizontal, rowcount,
-                                         colcount, fill);
+                    unruly_solver_fill_row(state, i, horizontal, scratch, fill);
 
-                state->grid[i1] = EMPTY;
-                state->grid[i3] = EMPTY;
+                GRID_PUT(state, i1) = EMPTY;
+                GRID_PUT(state, i3) = EMPTY;
             }
 
-            else if (state->grid[i1] == EMPTY && state->grid[i2] == EMPTY
-                     && state->grid[i3] == fill) {
-                state->grid[i1] = BOGUS;
-                state->grid[i2] = BOGUS;
+            else if (GRID(state, i1) == EMPTY && GRID(state, i2) == EMPTY
+                     && GRID(state, i3) == fill) {
+                GRID_PUT(state, i1) = BOGUS;
+                GRID_PUT(state, i2) = BOGUS;
 
 #ifdef STANDALONE_SOLVER
                 if (solver_verbose) {
@@ -979,18 +1055,17 @@ static int unruly_solver_check_near_complete(game_state *state,
                 }
 #endif
                 ret +=
-                    unruly_solver_fill_row(state, i, horizontal, rowcount,
-                                         colcount, fill);
+                    unruly_solver_fill_row(state, i, horizontal, scratch, fill);
 
-                state->grid[i1] = EMPTY;
-                state->grid[i2] = EMPTY;
+                GRID_PUT(state, i1) = EMPTY;
+                GRID_PUT(state, i2) = EMPTY;
             }
 
-            else if (state->grid[i1] == EMPTY && state->grid[i2] == EMPTY
-                     && state->grid[i3] == EMPTY) {
-                state->grid[i1] = BOGUS;
-                state->grid[i2] = BOGUS;
-                state->grid[i3] = BOGUS;
+            else if (GRID(state, i1) == EMPTY && GRID(state, i2) == EMPTY
+                     && GRID(state, i3) == EMPTY) {
+                GRID_PUT(state, i1) = BOGUS;
+                GRID_PUT(state, i2) = BOGUS;
+                GRID_PUT(state, i3) = BOGUS;
 
 #ifdef STANDALONE_SOLVER
                 if (solver_verbose) {
@@ -999,12 +1074,11 @@ static int unruly_solver_check_near_complete(game_state *state,
                 }
 #endif
                 ret +=
-                    unruly_solver_fill_row(state, i, horizontal, rowcount,
-                                         colcount, fill);
+                    unruly_solver_fill_row(state, i, horizontal, scratch, fill);
 
-                state->grid[i1] = EMPTY;
-                state->grid[i2] = EMPTY;
-                state->grid[i3] = EMPTY;
+                GRID_PUT(state, i1) = EMPTY;
+                GRID_PUT(state, i2) = EMPTY;
+                GRID_PUT(state, i3) = EMPTY;
             }
         }
     }
@@ -1020,19 +1094,19 @@ static int unruly_solver_check_all_near_complete(game_state *state,
     ret +=
         unruly_solver_check_near_complete(state, scratch->ones_rows, true,
                                         scratch->zeros_rows,
-                                        scratch->zeros_cols, N_ZERO);
+                                        scratch->zeros_cols, N_ZERO, scratch);
     ret +=
         unruly_solver_check_near_complete(state, scratch->ones_cols, false,
                                         scratch->zeros_rows,
-                                        scratch->zeros_cols, N_ZERO);
+                                        scratch->zeros_cols, N_ZERO, scratch);
     ret +=
         unruly_solver_check_near_complete(state, scratch->zeros_rows, true,
                                         scratch->ones_rows,
-                                        scratch->ones_cols, N_ONE);
+                                        scratch->ones_cols, N_ONE, scratch);
     ret +=
         unruly_solver_check_near_complete(state, scratch->zeros_cols, false,
                                         scratch->ones_rows,
-                                        scratch->ones_cols, N_ONE);
+                                        scratch->ones_cols, N_ONE, scratch);
 
     return ret;
 }
@@ -1062,8 +1136,8 @@ static int unruly_validate_rows(const game_state *state, bool horizontal,
             int i2 = y * w2 + x;
             int i3 = (y+dy) * w2 + (x+dx);
 
-            if (state->grid[i1] == check && state->grid[i2] == check
-                && state->grid[i3] == check) {
+            if (GRID(state, i1) == check && GRID(state, i2) == check
+                && GRID(state, i3) == check) {
                 ret++;
                 if (errors) {
                     errors[i1] |= err1;
@@ -1096,15 +1170,15 @@ static int unruly_validate_unique(const game_state *state, bool horizontal,
     for (r = 0; r < nr; r++) {
         int nfull = 0;
         for (c = 0; c < nc; c++)
-            if (state->grid[r*rmult + c*cmult] != EMPTY)
+            if (GRID(state, r*rmult + c*cmult) != EMPTY)
                 nfull++;
         if (nfull != nc)
             continue;
         for (r2 = r+1; r2 < nr; r2++) {
             bool match = true;
             for (c = 0; c < nc; c++)
-                if (state->grid[r*rmult + c*cmult] !=
-                    state->grid[r2*rmult + c*cmult])
+                if (GRID(state, r*rmult + c*cmult) !=
+                    GRID(state, r2*rmult + c*cmult))
                     match = false;
             if (match) {
                 if (errors) {
@@ -1301,7 +1375,7 @@ static char *solve_game(const game_state *state, const game_state *currstate,
         *p++ = 'S';
 
         for (i = 0; i < s; i++)
-            *p++ = (solved->grid[i] == N_ONE ? '1' : '0');
+            *p++ = (GRID(solved, i) == N_ONE ? '1' : '0');
 
         *p++ = '\0';
     } else if (result == 1)
@@ -1347,18 +1421,11 @@ static bool unruly_fill_game(game_state *state, struct unruly_scratch *scratch,
     for (j = 0; j < s; j++) {
         i = spaces[j];
 
-        if (state->grid[i] != EMPTY)
+        if (GRID(state, i) != EMPTY)
             continue;
 
-        if (random_upto(rs, 2)) {
-            state->grid[i] = N_ONE;
-            scratch->ones_rows[i / w2]++;
-            scratch->ones_cols[i % w2]++;
-        } else {
-            state->grid[i] = N_ZERO;
-            scratch->zeros_rows[i / w2]++;
-            scratch->zeros_cols[i % w2]++;
-        }
+        unruly_solver_place(state, scratch, i,
+                            random_upto(rs, 2) ? N_ONE : N_ZERO);
 
         unruly_solve_game(state, scratch, DIFFCOUNT);
     }
@@ -1435,8 +1502,8 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 
             i = spaces[j];
 
-            c = state->grid[i];
-            state->grid[i] = EMPTY;
+            c = GRID(state, i);
+            GRID_PUT(state, i) = EMPTY;
 
             solver = dup_game(state);
             scratch = unruly_new_scratch(state);
@@ -1444,7 +1511,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
             unruly_solve_game(solver, scratch, params->diff);
 
             if (unruly_validate_counts(solver, scratch, NULL) != 0)
-                state->grid[i] = c;
+                GRID_PUT(state, i) = c;
 
             free_game(solver);
             unruly_free_scratch(scratch);
@@ -1494,14 +1561,14 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     p = ret;
     run = 0;
     for (i = 0; i < s+1; i++) {
-        if (i == s || state->grid[i] == N_ZERO) {
+        if (i == s || GRID(state, i) == N_ZERO) {
             while (run > 24) {
                 *p++ = 'z';
                 run -= 25;
             }
             *p++ = 'a' + run;
             run = 0;
-        } else if (state->grid[i] == N_ONE) {
+        } else if (GRID(state, i) == N_ONE) {
             while (run > 24) {
                 *p++ = 'Z';
                 run -= 25;
@@ -1553,7 +1620,7 @@ static const char *current_key_label(const game_ui *ui,
 {
     int hx = ui->cx, hy = ui->cy;
     int w2 = state->w2;
-    char i = state->grid[hy * w2 + hx];
+    char i = GRID(state, hy * w2 + hx);
 
     if (ui->cursor && IS_CURSOR_SELECT(button)) {
         if (state->common->immutable[hy * w2 + hx]) return "";
@@ -1660,7 +1727,7 @@ static char *interpret_move(const game_state *state, game_ui *ui,
             return nullret;
 
         c = '-';
-        i = state->grid[hy * w2 + hx];
+        i = GRID(state, hy * w2 + hx);
 
         if (button == '0' || button == '2')
             c = '0';
@@ -1675,7 +1742,7 @@ static char *interpret_move(const game_state *state, game_ui *ui,
         else if (button == CURSOR_SELECT || button == LEFT_BUTTON)
             c = (i == EMPTY ? '1' : i == N_ONE ? '0' : '-');
 
-        if (state->grid[hy * w2 + hx] ==
+        if (GRID(state, hy * w2 + hx) ==
             (c == '0' ? N_ZERO : c == '1' ? N_ONE : EMPTY))
             return nullret; /* don't put no-ops on the undo chain */
 
@@ -1708,7 +1775,7 @@ static game_state *execute_move(const game_state *state, const char *move)
                 return NULL;
             }
 
-            ret->grid[i] = (*p == '1' ? N_ONE : N_ZERO);
+            GRID_PUT(ret, i) = (*p == '1' ? N_ONE : N_ZERO);
             p++;
         }
 
@@ -1726,7 +1793,7 @@ static game_state *execute_move(const game_state *state, const char *move)
             return NULL;
         }
 
-        ret->grid[i] = (c == '1' ? N_ONE : c == '0' ? N_ZERO : EMPTY);
+        GRID_PUT(ret, i) = (c == '1' ? N_ONE : c == '0' ? N_ZERO : EMPTY);
 
         if (!ret->completed && unruly_validate_counts(ret, NULL, NULL) == 0
             && (unruly_validate_all_rows(ret, NULL) == 0))
@@ -1924,11 +1991,11 @@ static void game_redraw(drawing *dr, game_drawstate *ds,
 
             tile = ds->gridfs[i];
 
-            if (state->grid[i] == N_ONE) {
+            if (GRID(state, i) == N_ONE) {
                 tile |= FF_ONE;
                 if (ds->rowfs[y] || ds->rowfs[2*h2 + x])
                     tile |= FE_COUNT;
-            } else if (state->grid[i] == N_ZERO) {
+            } else if (GRID(state, i) == N_ZERO) {
                 tile |= FF_ZERO;
                 if (ds->rowfs[h2 + y] || ds->rowfs[2*h2 + w2 + x])
                     tile |= FE_COUNT;
@@ -2019,9 +2086,9 @@ static void game_print(drawing *dr, const game_state *state, const game_ui *ui,
             coords[7] = ty + tilesize - 1;
             draw_polygon(dr, coords, 4, -1, ink);
 
-            if (state->grid[y * w2 + x] == N_ONE)
+            if (GRID(state, y * w2 + x) == N_ONE)
                 draw_rect(dr, tx, ty, tilesize, tilesize, ink);
-            else if (state->grid[y * w2 + x] == N_ZERO)
+            else if (GRID(state, y * w2 + x) == N_ZERO)
                 draw_circle(dr, tx + tilesize/2, ty + tilesize/2,
                             tilesize/12, ink, ink);
         }
@@ -2047,7 +2114,11 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+    NULL, NULL, /* encode_state, decode_state */
     true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
     NULL, NULL, /* get_prefs, set_prefs */
     new_ui,
@@ -2071,7 +2142,7 @@ const struct game thegame = {
     true, false, game_print_size, game_print,
     false,                      /* wants_statusbar */
     false, NULL,                       /* timing_state */
-    0,                          /* flags */
+    SOLVE_FROM_ORIG,                          /* flags */
 };
 
 /* ***************** *
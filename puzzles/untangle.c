@@ -109,7 +109,8 @@ struct game_state {
     point *pts;
     struct graph *graph;
 #ifndef EDITOR
-    int *crosses;		       /* mark edges which are crossed */
+    int *crosses;		       /* number of edges crossing each edge */
+    int ncrossings;		       /* total number of crossing pairs */
     bool completed, cheated, just_solved;
 #endif
 };
@@ -423,6 +424,54 @@ static bool cross(point a1, point a2, point b1, point b2)
     return true;
 }
 
+/*
+ * Integer bounding boxes of edges, rounded outwards, so that two
+ * edges whose boxes are apart certainly don't cross() and we can
+ * skip the exact test. 'e' is the edge's index in the edge tree.
+ */
+struct edgebox {
+    long x0, y0, x1, y1;
+    int e;
+};
+
+static long floordiv(long x, long d)
+{
+    return x >= 0 ? x / d : -((d - 1 - x) / d);
+}
+
+static void edge_box(const point *pts, const edge *e, int index,
+                     struct edgebox *box)
+{
+    long xa = floordiv(pts[e->a].x, pts[e->a].d);
+    long ya = floordiv(pts[e->a].y, pts[e->a].d);
+    long xb = floordiv(pts[e->b].x, pts[e->b].d);
+    long yb = floordiv(pts[e->b].y, pts[e->b].d);
+
+    box->x0 = min(xa, xb);
+    box->x1 = max(xa, xb);
+    box->y0 = min(ya, yb);
+    box->y1 = max(ya, yb);
+    box->e = index;
+}
+
+static bool boxes_apart(const struct edgebox *a, const struct edgebox *b)
+{
+    return (a->x1 < b->x0 || b->x1 < a->x0 ||
+            a->y1 < b->y0 || b->y1 < a->y0);
+}
+
+static int edgeboxcmp(const void *av, const void *bv)
+{
+    const struct edgebox *a = (const struct edgebox *)av;
+    const struct edgebox *b = (const struct edgebox *)bv;
+
+    if (a->x0 < b->x0)
+        return -1;
+    else if (a->x0 > b->x0)
+        return +1;
+    return a->e < b->e ? -1 : a->e > b->e ? +1 : 0;
+}
+
 #endif /* EDITOR */
 
 static unsigned long squarert(unsigned long n) {
@@ -493,6 +542,43 @@ static bool isedge(tree234 *edges, int a, int b)
     return find234(edges, &e, NULL) != NULL;
 }
 
+#ifndef EDITOR
+/*
+ * While the generator is building a graph, it runs through all the
+ * edges so far for every edge it considers adding. So it keeps them
+ * in a plain array, and in a hashset to check quickly whether one is
+ * already there.
+ */
+static unsigned long edgehash(const void *ev)
+{
+    const edge *e = (const edge *)ev;
+    int ends[2];
+
+    ends[0] = e->a;
+    ends[1] = e->b;
+    return hash_ints(ends, 2);
+}
+
+static bool edgeeq(const void *av, const void *bv)
+{
+    const edge *a = (const edge *)av, *b = (const edge *)bv;
+
+    return a->a == b->a && a->b == b->b;
+}
+
+static bool isedge_hashed(hashset *edgeset, int a, int b)
+{
+    edge e;
+
+    assert(a != b);
+
+    e.a = min(a, b);
+    e.b = max(a, b);
+
+    return hashset_find(edgeset, &e) != NULL;
+}
+#endif
+
 typedef struct vertex {
     int param;
     int vindex;
@@ -562,24 +648,24 @@ static void make_circle(point *pts, int n, int w)
  * If mapping != NULL, then it is expected to be a mapping from the
  * graph's original vertex numbers to output vertex numbers.
  */
-static char *encode_graph(const game_params *params, tree234 *edges,
-                          const long *mapping)
+static char *encode_graph(const game_params *params, const edge *edges,
+                          int m, const long *mapping)
 {
     const char *sep;
     char buf[80];
-    int i, k, m, retlen;
-    edge *e, *ea;
+    int i, k, retlen;
+    const edge *e;
+    edge *ea;
     char *ret;
 
     retlen = 0;
     if (params)
         retlen += sprintf(buf, "%d:", params->n);
 
-    m = count234(edges);
     ea = snewn(m, edge);
-    for (i = 0; (e = index234(edges, i)) != NULL; i++) {
+    for (i = 0; i < m; i++) {
         int ma, mb;
-        assert(i < m);
+        e = &edges[i];
         if (mapping) {
             ma = mapping[e->a];
             mb = mapping[e->b];
@@ -593,7 +679,6 @@ static char *encode_graph(const game_params *params, tree234 *edges,
             retlen++; /* comma separator after the previous edge */
         retlen += sprintf(buf, "%d-%d", ea[i].a, ea[i].b);
     }
-    assert(i == m);
     /* Re-sort to prevent side channels, if mapping was used */
     qsort(ea, m, sizeof(*ea), edgecmpC);
 
@@ -622,9 +707,12 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     long w, h, j, k, m;
     point *pts, *pts2;
     long *tmp;
-    tree234 *edges, *vertices;
-    edge *e, *e2;
+    tree234 *vertices;
+    hashset *edgeset;
+    edge *edges, *e, *e2;
+    int nedges;
     vertex *v, *vs, *vlist;
+    void **vps;
     char *ret;
 
     w = h = COORDLIMIT(n);
@@ -657,14 +745,18 @@ static char *new_game_desc(const game_params *params, random_state *rs,
      *  (c) does not intersect any actual point.
      */
     vs = snewn(n, vertex);
-    vertices = newtree234(vertcmp);
+    vps = snewn(n, void *);
     for (i = 0; i < n; i++) {
 	v = vs + i;
 	v->param = 0;		       /* in this tree, param is the degree */
 	v->vindex = i;
-	add234(vertices, v);
+	vps[i] = v;		       /* already in vertcmp order */
     }
-    edges = newtree234(edgecmp);
+    vertices = buildsorted234(vertcmp, vps, n);
+    sfree(vps);
+    edges = snewn(n * MAXDEGREE / 2, edge);
+    nedges = 0;
+    edgeset = hashset_new(edgehash, edgeeq);
     vlist = snewn(n, vertex);
     while (1) {
         bool added = false;
@@ -690,7 +782,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 		int ki = kv->vindex;
 		int dx, dy;
 
-		if (kv->param >= MAXDEGREE || isedge(edges, ki, j))
+		if (kv->param >= MAXDEGREE || isedge_hashed(edgeset, ki, j))
 		    continue;
 
 		vlist[m].vindex = ki;
@@ -705,30 +797,46 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 	    for (k = 0; k < m; k++) {
 		int p;
 		int ki = vlist[k].vindex;
+		long x0 = min(pts[ki].x, pts[j].x), x1 = max(pts[ki].x, pts[j].x);
+		long y0 = min(pts[ki].y, pts[j].y), y1 = max(pts[ki].y, pts[j].y);
 
 		/*
 		 * Check to see whether this edge intersects any
-		 * existing edge or point.
+		 * existing edge or point. All the points are on the
+		 * integer grid at this stage, so anything outside
+		 * the new edge's bounding box can be ruled out
+		 * without calling cross().
 		 */
 		for (p = 0; p < n; p++)
-		    if (p != ki && p != j && cross(pts[ki], pts[j],
-						   pts[p], pts[p]))
+		    if (p != ki && p != j &&
+			pts[p].x >= x0 && pts[p].x <= x1 &&
+			pts[p].y >= y0 && pts[p].y <= y1 &&
+			cross(pts[ki], pts[j], pts[p], pts[p]))
 			break;
 		if (p < n)
 		    continue;
-		for (p = 0; (e = index234(edges, p)) != NULL; p++)
+		for (p = 0; p < nedges; p++) {
+		    e = &edges[p];
 		    if (e->a != ki && e->a != j &&
 			e->b != ki && e->b != j &&
+			min(pts[e->a].x, pts[e->b].x) <= x1 &&
+			max(pts[e->a].x, pts[e->b].x) >= x0 &&
+			min(pts[e->a].y, pts[e->b].y) <= y1 &&
+			max(pts[e->a].y, pts[e->b].y) >= y0 &&
 			cross(pts[ki], pts[j], pts[e->a], pts[e->b]))
 			break;
-		if (e)
+		}
+		if (p < nedges)
 		    continue;
 
 		/*
 		 * We're done! Add this edge, modify the degrees of
 		 * the two vertices involved, and break.
 		 */
-		addedge(edges, j, ki);
+		e = &edges[nedges++];
+		e->a = min(j, ki);
+		e->b = max(j, ki);
+		hashset_add(edgeset, e);
 		added = true;
 		del234(vertices, vs+j);
 		vs[j].param++;
@@ -759,8 +867,10 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     make_circle(pts2, n, w);
     while (1) {
 	shuffle(tmp, n, sizeof(*tmp), rs);
-	for (i = 0; (e = index234(edges, i)) != NULL; i++) {
-	    for (j = i+1; (e2 = index234(edges, j)) != NULL; j++) {
+	for (i = 0; i < nedges; i++) {
+	    e = &edges[i];
+	    for (j = i+1; j < nedges; j++) {
+		e2 = &edges[j];
 		if (e2->a == e->a || e2->a == e->b ||
 		    e2->b == e->a || e2->b == e->b)
 		    continue;
@@ -768,17 +878,17 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 			  pts2[tmp[e->a]], pts2[tmp[e->b]]))
 		    break;
 	    }
-	    if (e2)
+	    if (j < nedges)
 		break;
 	}
-	if (e)
+	if (i < nedges)
 	    break;		       /* we've found a crossing */
     }
 
     /*
      * We're done. Encode the output graph as a string.
      */
-    ret = encode_graph(NULL, edges, tmp);
+    ret = encode_graph(NULL, edges, nedges, tmp);
 
     /*
      * Encode the solution we started with as an aux_info string.
@@ -817,9 +927,8 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     sfree(vlist);
     freetree234(vertices);
     sfree(vs);
-    while ((e = delpos234(edges, 0)) != NULL)
-	sfree(e);
-    freetree234(edges);
+    hashset_free(edgeset);
+    sfree(edges);
     sfree(pts);
 
     return ret;
@@ -857,37 +966,133 @@ static const char *validate_desc(const game_params *params, const char *desc)
 }
 
 #ifndef EDITOR
+static bool edges_cross(const point *pts, const edge *e, const edge *e2)
+{
+    if (e2->a == e->a || e2->a == e->b ||
+        e2->b == e->a || e2->b == e->b)
+        return false;
+    return cross(pts[e2->a], pts[e2->b], pts[e->a], pts[e->b]);
+}
+
 static void mark_crossings(game_state *state)
 {
-    bool ok = true;
+    int nedges = count234(state->graph->edges);
+    struct edgebox *boxes = snewn(nedges, struct edgebox);
     int i, j;
-    edge *e, *e2;
 
-    for (i = 0; (e = index234(state->graph->edges, i)) != NULL; i++)
-	state->crosses[i] = false;
+    for (i = 0; i < nedges; i++) {
+	state->crosses[i] = 0;
+        edge_box(state->pts, index234(state->graph->edges, i), i, &boxes[i]);
+    }
+    state->ncrossings = 0;
 
     /*
      * Check correctness: for every pair of edges, see whether they
-     * cross.
+     * cross. We sweep across the edges from left to right, so that
+     * each edge need only be compared with the ones whose x range
+     * overlaps its own.
      */
-    for (i = 0; (e = index234(state->graph->edges, i)) != NULL; i++) {
-	for (j = i+1; (e2 = index234(state->graph->edges, j)) != NULL; j++) {
-	    if (e2->a == e->a || e2->a == e->b ||
-		e2->b == e->a || e2->b == e->b)
-		continue;
-	    if (cross(state->pts[e2->a], state->pts[e2->b],
-		      state->pts[e->a], state->pts[e->b])) {
-		ok = false;
-		state->crosses[i] = state->crosses[j] = true;
+    qsort(boxes, nedges, sizeof(*boxes), edgeboxcmp);
+    for (i = 0; i < nedges; i++) {
+        edge *e = index234(state->graph->edges, boxes[i].e);
+
+	for (j = i+1; j < nedges && boxes[j].x0 <= boxes[i].x1; j++) {
+            if (boxes_apart(&boxes[i], &boxes[j]))
+                continue;
+	    if (edges_cross(state->pts, e,
+                            index234(state->graph->edges, boxes[j].e))) {
+		state->crosses[boxes[i].e]++;
+		state->crosses[boxes[j].e]++;
+                state->ncrossings++;
 	    }
 	}
     }
+    sfree(boxes);
 
-    /*
-     * e == NULL if we've gone through all the edge pairs
-     * without finding a crossing.
-     */
-    if (ok)
+    if (state->ncrossings == 0)
+	state->completed = true;
+}
+
+/*
+ * Bring the crossing counts up to date after some of the points have
+ * moved, given where they all were before. Only the edges with a
+ * moved endpoint can have changed their crossings: each of those is
+ * re-tested against every other edge, in its old and new positions,
+ * and the difference applied to the counts.
+ */
+static void update_crossings(game_state *state, const point *oldpts)
+{
+    tree234 *edges = state->graph->edges;
+    int n = state->params.n, nedges = count234(edges);
+    struct edgebox *oldboxes, *newboxes;
+    bool *moved, *dirty;
+    int i, j, ndirty = 0;
+
+    moved = snewn(n, bool);
+    for (i = 0; i < n; i++)
+        moved[i] = (state->pts[i].x != oldpts[i].x ||
+                    state->pts[i].y != oldpts[i].y ||
+                    state->pts[i].d != oldpts[i].d);
+
+    dirty = snewn(nedges, bool);
+    for (i = 0; i < nedges; i++) {
+        edge *e = index234(edges, i);
+        dirty[i] = moved[e->a] || moved[e->b];
+        if (dirty[i])
+            ndirty++;
+    }
+
+    /* If most of the picture has changed, start again. */
+    if (ndirty * 4 > nedges) {
+        sfree(dirty);
+        sfree(moved);
+        mark_crossings(state);
+        return;
+    }
+
+    oldboxes = snewn(nedges, struct edgebox);
+    newboxes = snewn(nedges, struct edgebox);
+    for (i = 0; i < nedges; i++) {
+        edge *e = index234(edges, i);
+        edge_box(oldpts, e, i, &oldboxes[i]);
+        edge_box(state->pts, e, i, &newboxes[i]);
+    }
+
+    for (i = 0; i < nedges; i++) {
+        edge *e;
+
+        if (!dirty[i])
+            continue;
+        e = index234(edges, i);
+
+        for (j = 0; j < nedges; j++) {
+            edge *e2;
+            int delta = 0;
+
+            /* Pairs of two moved edges are handled once, from the lower. */
+            if (j == i || (dirty[j] && j < i))
+                continue;
+            e2 = index234(edges, j);
+
+            if (!boxes_apart(&oldboxes[i], &oldboxes[j]) &&
+                edges_cross(oldpts, e, e2))
+                delta--;
+            if (!boxes_apart(&newboxes[i], &newboxes[j]) &&
+                edges_cross(state->pts, e, e2))
+                delta++;
+
+            state->crosses[i] += delta;
+            state->crosses[j] += delta;
+            state->ncrossings += delta;
+        }
+    }
+
+    sfree(oldboxes);
+    sfree(newboxes);
+    sfree(dirty);
+    sfree(moved);
+
+    if (state->ncrossings == 0)
 	state->completed = true;
 }
 #endif
@@ -953,6 +1158,7 @@ static game_state *dup_game(const game_state *state)
     ret->crosses = snewn(count234(ret->graph->edges), int);
     memcpy(ret->crosses, state->crosses,
 	   count234(ret->graph->edges) * sizeof(int));
+    ret->ncrossings = state->ncrossings;
 #else
     /* For the graph editor, we must clone the whole graph */
     ret->graph = snew(struct graph);
@@ -986,6 +1192,72 @@ static void free_game(game_state *state)
     sfree(state);
 }
 
+#ifndef EDITOR
+/*
+ * Checkpoints for save files: the flags, and then the position of
+ * every point, in the same form as a move. The graph is shared with
+ * the initial state.
+ */
+static char *encode_state(const game_state *state)
+{
+    int n = state->params.n, i;
+    char *ret = snewn(8 + n * 3 * 24, char), *p = ret;
+
+    if (state->completed) *p++ = 'C';
+    if (state->cheated) *p++ = 'S';
+    if (state->just_solved) *p++ = 'J';
+    for (i = 0; i < n; i++)
+        p += sprintf(p, "%s%ld,%ld/%ld", i ? ";" : ":", state->pts[i].x,
+                     state->pts[i].y, state->pts[i].d);
+
+    return ret;
+}
+
+static game_state *decode_state(const game_state *orig, const char *encoding)
+{
+    int n = orig->params.n, i, k;
+    game_state *ret = dup_game(orig);
+    const char *p = encoding;
+    bool completed = false;
+
+    ret->cheated = ret->just_solved = false;
+    for (; *p && *p != ':'; p++) {
+        if (*p == 'C')
+            completed = true;
+        else if (*p == 'S')
+            ret->cheated = true;
+        else if (*p == 'J')
+            ret->just_solved = true;
+        else
+            goto fail;
+    }
+    for (i = 0; i < n; i++) {
+        long x, y, d;
+
+        if (*p++ != (i ? ';' : ':') ||
+            sscanf(p, "%ld,%ld/%ld%n", &x, &y, &d, &k) != 3 || d <= 0)
+            goto fail;
+        ret->pts[i].x = x;
+        ret->pts[i].y = y;
+        ret->pts[i].d = d;
+        p += k;
+    }
+    if (*p)
+        goto fail;
+
+    ret->completed = false;
+    mark_crossings(ret);
+    if (completed)
+        ret->completed = true;
+
+    return ret;
+
+  fail:
+    free_game(ret);
+    return NULL;
+}
+#endif
+
 #ifndef EDITOR
 static char *solve_game(const game_state *state, const game_state *currstate,
                         const char *aux, const char **error)
@@ -1142,7 +1414,16 @@ static bool game_can_format_as_text_now(const game_params *params)
 
 static char *game_text_format(const game_state *state)
 {
-    return encode_graph(&state->params, state->graph->edges, NULL);
+    tree234 *edges = state->graph->edges;
+    int i, m = count234(edges);
+    edge *ea = snewn(m, edge);
+    char *ret;
+
+    for (i = 0; i < m; i++)
+        ea[i] = *(edge *)index234(edges, i);
+    ret = encode_graph(&state->params, ea, m, NULL);
+    sfree(ea);
+    return ret;
 }
 #endif /* EDITOR */
 
@@ -1685,7 +1966,7 @@ static game_state *execute_move(const game_state *state, const char *move)
     }
 
 #ifndef EDITOR
-    mark_crossings(ret);
+    update_crossings(ret, state->pts);
 #endif
 
     return ret;
@@ -2035,11 +2316,22 @@ const struct game thegame = {
     NULL, /* set_public_desc */
     dup_game,
     free_game,
+#ifndef EDITOR
+    encode_state, decode_state,
+#else
+    NULL, NULL, /* encode_state, decode_state */
+#endif
 #ifndef EDITOR
     true, solve_game,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
     false, NULL, NULL, /* can_format_as_text_now, text_format */
 #else
     false, NULL,
+    NULL, /* solve_step */
+    NULL, /* grade */
+    NULL, /* speculate */
     true, game_can_format_as_text_now, game_text_format,
 #endif
     get_prefs, set_prefs,
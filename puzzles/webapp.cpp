@@ -1,6 +1,11 @@
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cassert>
 #include <cstdarg>
 #include <cstdint>
+#include <cstring>
+#include <limits>
 #include <optional>
 #include <memory>
 #include <span>
@@ -10,6 +15,13 @@
 
 #include <emscripten.h>
 #include <emscripten/bind.h>
+#include <emscripten/heap.h>
+#ifdef __EMSCRIPTEN_PTHREADS__
+#include <emscripten/threading.h>
+#endif
+#ifdef WEBAPP_SHARED_CORE
+#include <dlfcn.h>
+#endif
 
 // EM_ASM doesn't work properly, because we share generated JS between puzzles.
 // (But EM_JS works just fine.)
@@ -28,6 +40,23 @@ EM_JS(void, throw_js_error, (const char* message), {
     throw new Error(UTF8ToString(message));
 });
 
+#ifdef WEBAPP_SHARED_CORE
+// In the shared core build, this file is linked into puzzles-core.wasm,
+// and the game is in a side module (<puzzle>.side.wasm) that the worker
+// loads along with it. So look up its thegame at runtime.
+static const game *get_game() {
+    static const game *g =
+        static_cast<const game *>(dlsym(RTLD_DEFAULT, "thegame"));
+    if (!g)
+        throw_js_error("No puzzle side module loaded");
+    return g;
+}
+#else
+static const game *get_game() {
+    return &thegame;
+}
+#endif
+
 std::string slugify(const std::string& text) {
     std::string slug;
     slug.reserve(text.length());
@@ -196,54 +225,6 @@ typedef std::array<float, 3> Colour;
 
 EMSCRIPTEN_DECLARE_VAL_TYPE(ColourList);
 
-// JS-ified options for DrawingAPI.drawText
-EMSCRIPTEN_DECLARE_VAL_TYPE(TextAlign); // "left" | "center" | "right"
-EMSCRIPTEN_DECLARE_VAL_TYPE(TextBaseline); // "alphabetic" | "mathematical"
-EMSCRIPTEN_DECLARE_VAL_TYPE(FontType); // "fixed" | "variable"
-
-struct DrawTextOptions {
-    TextAlign align;
-    TextBaseline baseline;
-    FontType fontType;
-    int size;
-
-    DrawTextOptions() : align(to_halign(ALIGN_HLEFT)),
-                        baseline(to_valign(ALIGN_VNORMAL)),
-                        fontType(to_fontType(FONT_VARIABLE)),
-                        size(12) {}
-
-    // From drawing_api draw_text params:
-    DrawTextOptions(
-        int _fonttype, int _fontsize, int _align
-    ) : align(to_halign(_align)),
-        baseline(to_valign(_align)),
-        fontType(to_fontType(_fonttype)),
-        size(_fontsize) {}
-
-private:
-    static TextAlign to_halign(int align) {
-        static constexpr int ALIGN_HMASK = ALIGN_HLEFT | ALIGN_HCENTRE | ALIGN_HRIGHT;
-        if ((align & ALIGN_HMASK) == ALIGN_HLEFT)
-            return val("left").as<TextAlign>();
-        if ((align & ALIGN_HMASK) == ALIGN_HCENTRE)
-            return val("center").as<TextAlign>();
-        return val("right").as<TextAlign>();
-    }
-
-    static TextBaseline to_valign(int align) {
-        static constexpr int ALIGN_VMASK = ALIGN_VCENTRE | ALIGN_VNORMAL;
-        if ((align & ALIGN_VMASK) == ALIGN_VCENTRE)
-            return val("mathematical").as<TextBaseline>();
-        return val("alphabetic").as<TextBaseline>();
-    }
-
-    static FontType to_fontType(int fonttype) {
-        if (fonttype == FONT_FIXED)
-            return val("fixed").as<FontType>();
-        return val("variable").as<FontType>();
-    }
-};
-
 struct KeyLabel {
     std::string label;
     int button = 0;
@@ -267,17 +248,8 @@ struct Point {
 
     Point(const int _x, const int _y)
         : x(static_cast<float>(_x)), y(static_cast<float>(_y)) {}
-
-    // IntPoint is useful for draw_polygon argument coercion.
-    typedef struct {
-        int x, y;
-    } IntPoint;
-
-    explicit Point(const IntPoint &_p) : Point(_p.x, _p.y) {}
 };
 
-EMSCRIPTEN_DECLARE_VAL_TYPE(PointList);
-
 struct Rect {
     int x, y, w, h;
     Rect() : x(0), y(0), w(0), h(0) {}
@@ -301,24 +273,12 @@ EMSCRIPTEN_BINDINGS(utilities) {
         .element(emscripten::index<2>());
     register_type<ColourList>("Colour[]");
 
-    // Would like to use lib.dom.d.ts CanvasTextAlign and CanvasTextBaseline,
-    // but tsgen throws `BindingError: emval::as has unknown type 15CanvasTextAlign`.
-    register_type<TextAlign>(R"("left" | "center" | "right")");
-    register_type<TextBaseline>(R"("alphabetic" | "mathematical")");
-    register_type<FontType>(R"("fixed" | "variable")");
-    value_object<DrawTextOptions>("DrawTextOptions")
-        .field("align", &DrawTextOptions::align)
-        .field("baseline", &DrawTextOptions::baseline)
-        .field("fontType", &DrawTextOptions::fontType)
-        .field("size", &DrawTextOptions::size);
-
     value_object<KeyLabel>("KeyLabel")
         .field("label", &KeyLabel::label)
         .field("button", &KeyLabel::button);
     register_type<KeyLabelList>("KeyLabel[]");
 
     value_object<Point>("Point").field("x", &Point::x).field("y", &Point::y);
-    register_type<PointList>("Point[]");
 
     value_object<Rect>("Rect")
         .field("x", &Rect::x)
@@ -335,6 +295,12 @@ EMSCRIPTEN_BINDINGS(utilities) {
     register_type<StringList>("string[]");
 }
 
+EMSCRIPTEN_DECLARE_VAL_TYPE(Blitter);
+EMSCRIPTEN_DECLARE_VAL_TYPE(Int32Array);
+EMSCRIPTEN_DECLARE_VAL_TYPE(Float32Array);
+EMSCRIPTEN_DECLARE_VAL_TYPE(Float64Array);
+EMSCRIPTEN_DECLARE_VAL_TYPE(OptionalInt32Array);
+
 /*
  * Drawing class -- implemented in JS
  */
@@ -359,43 +325,20 @@ EMSCRIPTEN_BINDINGS(utilities) {
 // (the object type that must be passed to `Frontend.setDrawing`), and a module property
 // `Drawing` that is used to bind an instance of the JS DrawingWrapper's
 // implementation to C code, by calling `module.Drawing.implement(instance)`.
-
-EMSCRIPTEN_DECLARE_VAL_TYPE(Blitter);
-
-constexpr float default_line_thickness = 1.0f;
+//
+// The drawing primitives (text, rect, line, polygon, circle, clip)
+// arrive in JS batched through drawCommands (see DrawCommandBuffer below).
+// draw_update rectangles are merged into a DamageRegion, delivered once
+// per frame through endDraw. Blitters need a JS value back, or must observe
+// the canvas contents, so remain individual calls (after flushing any
+// pending commands).
 
 class Drawing {
 public:
     virtual ~Drawing() = default;
 
-    virtual void drawText(
-        const Point &origin, const DrawTextOptions &options, int colour,
-        const std::string &text
-    ) = 0;
-
-    virtual void drawRect(const Rect &rect, int colour) = 0;
-
-    virtual void drawLine(
-        const Point &start, const Point &end, int colour, float thickness
-    ) = 0;
-
-    void drawLine(const Point &start, const Point &end, int colour) {
-        return drawLine(start, end, colour, default_line_thickness);
-    }
-
-    virtual void drawPolygon(
-        const PointList &coords, int fillcolour, int outlinecolour
-    ) = 0;
-
-    virtual void drawCircle(
-        const Point &origin, int radius, int fillcolour, int outlinecolour
-    ) = 0;
-
-    virtual void drawUpdate(const Rect &rect) = 0;
-    virtual void clip(const Rect &rect) = 0;
-    virtual void unclip() = 0;
-    virtual void startDraw() = 0;
-    virtual void endDraw() = 0;
+    virtual void drawCommands(const Int32Array &commands) = 0;
+    virtual void endDraw(const Int32Array &damage) = 0;
     virtual Blitter blitterNew(const Size &size) = 0;
     virtual void blitterFree(const Blitter &bl) = 0;
     virtual void blitterSave(const Blitter &bl, const Point &origin) = 0;
@@ -406,48 +349,14 @@ class DrawingWrapper : public wrapper<Drawing> {
 public:
     EMSCRIPTEN_WRAPPER(explicit DrawingWrapper);
 
-    void drawText(
-        const Point &origin, const DrawTextOptions &options, int colour,
-        const std::string &text
-    ) override {
-        return call<void>("drawText", origin, options, colour, text);
+    void drawCommands(const Int32Array &commands) override {
+        return call<void>("drawCommands", commands);
     }
 
-    void drawRect(const Rect &rect, int colour) override {
-        return call<void>("drawRect", rect, colour);
+    void endDraw(const Int32Array &damage) override {
+        return call<void>("endDraw", damage);
     }
 
-    void drawLine(
-        const Point &start, const Point &end, int colour, float thickness
-    ) override {
-        // This combines drawing_api's draw_line and draw_thick_line.
-        return call<void>("drawLine", start, end, colour, thickness);
-    }
-
-    void drawPolygon(
-        const PointList &coords, int fillcolour, int outlinecolour
-    ) override {
-        return call<void>("drawPolygon", coords, fillcolour, outlinecolour);
-    }
-
-    void drawCircle(
-        const Point &origin, int radius, int fillcolour, int outlinecolour
-    ) override {
-        return call<void>("drawCircle", origin, radius, fillcolour, outlinecolour);
-    }
-
-    void drawUpdate(const Rect &rect) override {
-        return call<void>("drawUpdate", rect);
-    }
-
-    void clip(const Rect &rect) override { return call<void>("clip", rect); }
-
-    void unclip() override { return call<void>("unclip"); }
-
-    void startDraw() override { return call<void>("startDraw"); }
-
-    void endDraw() override { return call<void>("endDraw"); }
-
     Blitter blitterNew(const Size &size) override {
         return call<Blitter>("blitterNew", size).as<Blitter>();
     }
@@ -469,26 +378,13 @@ public:
 
 EMSCRIPTEN_BINDINGS(drawing) {
     register_type<Blitter>("unknown");
+    register_type<Int32Array>("Int32Array");
 
     // ReSharper disable once CppExpressionWithoutSideEffects
     class_<Drawing>("Drawing")
         .smart_ptr<std::shared_ptr<Drawing> >("Drawing")
-        .function("drawText(origin, options, colour, text)", &DrawingWrapper::drawText)
-        .function("drawRect(rect, colour)", &DrawingWrapper::drawRect)
-        .function("drawLine(p1, p2, colour, thickness)", &DrawingWrapper::drawLine)
-        .function(
-            "drawPolygon(coords, fillcolour, outlinecolour)",
-            &DrawingWrapper::drawPolygon
-        )
-        .function(
-            "drawCircle(centre, radius, fillcolour, outlinecolour)",
-            &DrawingWrapper::drawCircle
-        )
-        .function("drawUpdate(rect)", &DrawingWrapper::drawUpdate)
-        .function("clip(rect)", &DrawingWrapper::clip)
-        .function("unclip", &DrawingWrapper::unclip)
-        .function("startDraw", &DrawingWrapper::startDraw)
-        .function("endDraw", &DrawingWrapper::endDraw)
+        .function("drawCommands(commands)", &DrawingWrapper::drawCommands)
+        .function("endDraw(damage)", &DrawingWrapper::endDraw)
         .function("blitterNew(size)", &DrawingWrapper::blitterNew)
         .function("blitterFree(blitter)", &DrawingWrapper::blitterFree)
         .function("blitterSave(blitter, origin)", &DrawingWrapper::blitterSave)
@@ -496,11 +392,296 @@ EMSCRIPTEN_BINDINGS(drawing) {
         .allow_subclass<DrawingWrapper>("DrawingWrapper");
 }
 
+/*
+ * Draw command buffer
+ */
+
+// Rather than making an embind call into JS for every drawing_api primitive,
+// the primitives are encoded into a compact command stream in wasm memory,
+// which is handed to JS (as an Int32Array view on the heap) once per
+// start_draw/end_draw bracket, and decoded there in a single pass.
+//
+// Each command is a DrawCommand opcode word followed by its operands.
+// Most operands are int32; the LINE command's coordinates and thickness
+// are float32 bit patterns (to cover draw_thick_line). TEXT is followed by
+// the UTF-8 byte length of its text, then the bytes, padded to a whole word.
+//
+// The opcodes and operand layouts must be kept in sync with
+// drawCommands() in src/puzzle/drawing.ts.
+
+enum class DrawCommand : int32_t {
+    // TEXT x y fonttype fontsize halign valign colour nbytes bytes...
+    TEXT = 1,
+    // RECT x y w h colour (printing only: the canvas gets RECTS)
+    RECT = 2,
+    // LINE x1 y1 x2 y2 (float) colour thickness (float)
+    // (printing only: the canvas gets LINES)
+    LINE = 3,
+    // POLYGON npoints fillcolour outlinecolour x0 y0 x1 y1 ...
+    POLYGON = 4,
+    // CIRCLE cx cy radius fillcolour outlinecolour
+    CIRCLE = 5,
+    // (6 was UPDATE, now handled by DamageRegion)
+    // CLIP x y w h
+    CLIP = 7,
+    // UNCLIP
+    UNCLIP = 8,
+    // The rest appear only when printing (see Printing below):
+    // BEGIN_PUZZLE xm xc ym yc (float) pw ph wmm (float)
+    BEGIN_PUZZLE = 9,
+    // END_PUZZLE
+    END_PUZZLE = 10,
+    // LINE_WIDTH width (float)
+    LINE_WIDTH = 11,
+    // LINE_DOTTED dotted
+    LINE_DOTTED = 12,
+    // RECTS colour count, then count times: x y w h
+    RECTS = 13,
+    // LINES colour thickness (float) count, then count times:
+    //   x1 y1 x2 y2 (float)
+    LINES = 14,
+    // Sprites (see js_sprite_new below):
+    // SPRITE_BEGIN id w h (then commands drawing the sprite)
+    SPRITE_BEGIN = 15,
+    // SPRITE_END
+    SPRITE_END = 16,
+    // SPRITE_DRAW id x y angle (float)
+    SPRITE_DRAW = 17,
+    // SPRITE_FREE id
+    SPRITE_FREE = 18,
+};
+
+// TEXT operand encodings (JS-ified drawing_api draw_text params)
+enum class TextHAlign : int32_t { LEFT = 0, CENTER = 1, RIGHT = 2 };
+enum class TextVAlign : int32_t { ALPHABETIC = 0, MATHEMATICAL = 1 };
+enum class TextFontType : int32_t { FIXED = 0, VARIABLE = 1 };
+
+// The draw_update rectangles for a frame, merged into a short list for
+// Drawing.endDraw (which presents only those areas of the canvas).
+// Rectangles that overlap or abut are merged if their bounding box covers
+// no more area than the two did separately, so a row or block of updated
+// tiles becomes a single rectangle, but scattered tiles stay separate.
+// If that still leaves too many, everything collapses into one bounding box.
+class DamageRegion {
+    struct Box {
+        int x0, y0, x1, y1; // x1, y1 exclusive
+
+        [[nodiscard]] long area() const {
+            return static_cast<long>(x1 - x0) * (y1 - y0);
+        }
+
+        [[nodiscard]] bool touches(const Box &other) const {
+            return x0 <= other.x1 && other.x0 <= x1 &&
+                   y0 <= other.y1 && other.y0 <= y1;
+        }
+
+        [[nodiscard]] Box merged(const Box &other) const {
+            return {
+                min(x0, other.x0), min(y0, other.y0),
+                max(x1, other.x1), max(y1, other.y1)
+            };
+        }
+    };
+
+    static constexpr size_t maxBoxes = 16;
+    std::vector<Box> boxes;
+    std::vector<int32_t> words; // x y w h for each box, for endDraw
+
+public:
+    [[nodiscard]] bool empty() const { return boxes.empty(); }
+
+    void clear() { boxes.clear(); }
+
+    void add(const int x, const int y, const int w, const int h) {
+        if (w <= 0 || h <= 0)
+            return;
+        Box box = {x, y, x + w, y + h};
+        // Merging can make box touch others it didn't before, so repeat.
+        for (size_t i = 0; i < boxes.size();) {
+            const Box candidate = box.merged(boxes[i]);
+            if (box.touches(boxes[i]) &&
+                candidate.area() <= box.area() + boxes[i].area()) {
+                box = candidate;
+                boxes[i] = boxes.back();
+                boxes.pop_back();
+                i = 0;
+            } else {
+                i++;
+            }
+        }
+        boxes.push_back(box);
+        if (boxes.size() > maxBoxes) {
+            for (size_t i = 1; i < boxes.size(); i++)
+                boxes[0] = boxes[0].merged(boxes[i]);
+            boxes.resize(1);
+        }
+    }
+
+    // Hands the region to JS and clears it.
+    void present(Drawing *drawing) {
+        words.clear();
+        for (const auto &box : boxes) {
+            words.push_back(box.x0);
+            words.push_back(box.y0);
+            words.push_back(box.x1 - box.x0);
+            words.push_back(box.y1 - box.y0);
+        }
+        boxes.clear();
+        // (As for drawCommands, the view must be consumed synchronously.)
+        const auto view = val(typed_memory_view(words.size(), words.data()));
+        drawing->endDraw(view.as<Int32Array>());
+    }
+};
+
+class DrawCommandBuffer {
+    std::vector<int32_t> words;
+    bool in_draw = false;
+    bool in_sprite = false;
+
+    // Consecutive same-colour rects, and same-colour, same-thickness
+    // lines, are merged into a single RECTS or LINES command, which
+    // Drawing fills or strokes as one path. batch is the index of the
+    // last command's opcode if it's one that can still be extended.
+    static constexpr size_t no_batch = SIZE_MAX;
+    size_t batch = no_batch;
+
+public:
+    // draw_update rectangles since start()
+    DamageRegion damage;
+
+    DrawCommandBuffer() { words.reserve(4096); }
+
+    void start() {
+        words.clear();
+        batch = no_batch;
+        damage.clear();
+        in_draw = true;
+    }
+
+    // Passes the pending commands to fn, as an Int32Array, and clears
+    // the buffer. The view must be consumed synchronously: it is
+    // invalidated by any heap growth. (So fn mustn't call back into wasm.)
+    template <typename F>
+    void take(F &&fn) {
+        const auto view = val(typed_memory_view(words.size(), words.data()));
+        fn(view.as<Int32Array>());
+        words.clear();
+        batch = no_batch;
+    }
+
+    // Hands any pending commands to JS and clears the buffer.
+    // Must be called before any Drawing call that depends on the
+    // canvas contents (e.g., blitterSave), to preserve ordering.
+    void flush(Drawing *drawing) {
+        if (words.empty())
+            return;
+        take([drawing](const Int32Array &commands) {
+            drawing->drawCommands(commands);
+        });
+    }
+
+    void end(Drawing *drawing) {
+        flush(drawing);
+        // (Even with no damage: endDraw marks the end of the frame.)
+        damage.present(drawing);
+        in_draw = false;
+    }
+
+    // Drawing outside start_draw/end_draw is unusual, but allowed:
+    // commands are delivered immediately rather than batched.
+    // (Except while drawing a sprite: Drawing needs all of a sprite's
+    // commands in one batch, so it can keep them to re-render it.)
+    void complete(Drawing *drawing) {
+        if (!in_draw && !in_sprite)
+            flush(drawing);
+    }
+
+    void begin_sprite() { in_sprite = true; }
+
+    void end_sprite(Drawing *drawing) {
+        in_sprite = false;
+        complete(drawing);
+    }
+
+    void update(Drawing *drawing, int x, int y, int w, int h) {
+        damage.add(x, y, w, h);
+        if (!in_draw) {
+            flush(drawing);
+            damage.present(drawing);
+        }
+    }
+
+    DrawCommandBuffer &op(DrawCommand command) {
+        words.push_back(static_cast<int32_t>(command));
+        batch = no_batch;
+        return *this;
+    }
+
+    // Appends a rect to a RECTS command.
+    DrawCommandBuffer &rect(int x, int y, int w, int h, int colour) {
+        if (batch == no_batch
+            || words[batch] != static_cast<int32_t>(DrawCommand::RECTS)
+            || words[batch + 1] != colour) {
+            op(DrawCommand::RECTS).i(colour).i(0);
+            batch = words.size() - 3;
+        }
+        words[batch + 2]++;
+        return i(x).i(y).i(w).i(h);
+    }
+
+    // Appends a line to a LINES command.
+    DrawCommandBuffer &line(
+        float x1, float y1, float x2, float y2, int colour, float thickness
+    ) {
+        if (batch == no_batch
+            || words[batch] != static_cast<int32_t>(DrawCommand::LINES)
+            || words[batch + 1] != colour
+            || words[batch + 2] != std::bit_cast<int32_t>(thickness)) {
+            op(DrawCommand::LINES).i(colour).f(thickness).i(0);
+            batch = words.size() - 4;
+        }
+        words[batch + 3]++;
+        return f(x1).f(y1).f(x2).f(y2);
+    }
+
+    DrawCommandBuffer &i(const int value) {
+        words.push_back(value);
+        return *this;
+    }
+
+    DrawCommandBuffer &f(const float value) {
+        words.push_back(std::bit_cast<int32_t>(value));
+        return *this;
+    }
+
+    template <typename E>
+    DrawCommandBuffer &e(const E value) {
+        words.push_back(static_cast<int32_t>(value));
+        return *this;
+    }
+
+    DrawCommandBuffer &text(const char *str) {
+        const size_t nbytes = strlen(str);
+        const size_t nwords = (nbytes + sizeof(int32_t) - 1) / sizeof(int32_t);
+        words.push_back(static_cast<int32_t>(nbytes));
+        const size_t start = words.size();
+        words.resize(start + nwords, 0);
+        memcpy(words.data() + start, str, nbytes);
+        return *this;
+    }
+
+    DrawCommandBuffer &ints(const int *values, const size_t count) {
+        words.insert(words.end(), values, values + count);
+        return *this;
+    }
+};
+
 /*
  * Drawing API
  */
 
 Drawing *DRAWING(const drawing *dr);
+DrawCommandBuffer &DRAW_COMMANDS(const drawing *dr);
 
 struct blitter {
     // an emscripten::val -- any JS object or value
@@ -509,59 +690,93 @@ struct blitter {
     explicit blitter(Blitter _value) : js_value(std::move(_value)) {}
 };
 
+static TextHAlign to_text_halign(const int align) {
+    static constexpr int ALIGN_HMASK = ALIGN_HLEFT | ALIGN_HCENTRE | ALIGN_HRIGHT;
+    if ((align & ALIGN_HMASK) == ALIGN_HLEFT)
+        return TextHAlign::LEFT;
+    if ((align & ALIGN_HMASK) == ALIGN_HCENTRE)
+        return TextHAlign::CENTER;
+    return TextHAlign::RIGHT;
+}
+
+static TextVAlign to_text_valign(const int align) {
+    static constexpr int ALIGN_VMASK = ALIGN_VCENTRE | ALIGN_VNORMAL;
+    if ((align & ALIGN_VMASK) == ALIGN_VCENTRE)
+        return TextVAlign::MATHEMATICAL;
+    return TextVAlign::ALPHABETIC;
+}
+
+static TextFontType to_text_font_type(const int fonttype) {
+    if (fonttype == FONT_FIXED)
+        return TextFontType::FIXED;
+    return TextFontType::VARIABLE;
+}
+
 void js_draw_text(
     drawing *dr, int x, int y, int fonttype, int fontsize, int align,
     int colour, const char *text
 ) {
-    const auto options = DrawTextOptions(fonttype, fontsize, align);
-    DRAWING(dr)->drawText(Point(x, y), options, colour, std::string(text));
+    DRAW_COMMANDS(dr).op(DrawCommand::TEXT)
+        .i(x).i(y)
+        .e(to_text_font_type(fonttype)).i(fontsize)
+        .e(to_text_halign(align)).e(to_text_valign(align))
+        .i(colour)
+        .text(text)
+        .complete(DRAWING(dr));
 }
 
 void js_draw_rect(drawing *dr, int x, int y, int w, int h, int colour) {
-    DRAWING(dr)->drawRect(Rect(x, y, w, h), colour);
+    DRAW_COMMANDS(dr).rect(x, y, w, h, colour)
+        .complete(DRAWING(dr));
 }
 
+constexpr float default_line_thickness = 1.0f;
+
 void js_draw_line(drawing *dr, int x1, int y1, int x2, int y2, int colour) {
-    DRAWING(dr)->drawLine(Point(x1, y1), Point(x2, y2), colour);
+    DRAW_COMMANDS(dr).line(
+            static_cast<float>(x1), static_cast<float>(y1),
+            static_cast<float>(x2), static_cast<float>(y2),
+            colour, default_line_thickness)
+        .complete(DRAWING(dr));
 }
 
 void js_draw_polygon(
     drawing *dr, const int *coords, int npoints, int fillcolour,
     int outlinecolour
 ) {
-    static_assert(
-        sizeof(Point::IntPoint) == 2 * sizeof(*coords),
-        "_IntPoint doesn't match draw_polygon coords layout"
-    );
-    auto points = reinterpret_cast<const Point::IntPoint *>(coords);
-    auto points_vec = std::vector<Point>();
-    points_vec.reserve(npoints);
-    for (const auto point_ptr: std::span(points, npoints))
-        points_vec.emplace_back(point_ptr);
-    auto point_list = val::array(points_vec).as<PointList>();
-    DRAWING(dr)->drawPolygon(point_list, fillcolour, outlinecolour);
+    DRAW_COMMANDS(dr).op(DrawCommand::POLYGON)
+        .i(npoints).i(fillcolour).i(outlinecolour)
+        .ints(coords, 2 * npoints)
+        .complete(DRAWING(dr));
 }
 
 void js_draw_circle(
     drawing *dr, int cx, int cy, int radius, int fillcolour,
     int outlinecolour
 ) {
-    DRAWING(dr)->drawCircle(Point(cx, cy), radius, fillcolour, outlinecolour);
+    DRAW_COMMANDS(dr).op(DrawCommand::CIRCLE)
+        .i(cx).i(cy).i(radius).i(fillcolour).i(outlinecolour)
+        .complete(DRAWING(dr));
 }
 
 void js_draw_update(drawing *dr, int x, int y, int w, int h) {
-    DRAWING(dr)->drawUpdate(Rect(x, y, w, h));
+    DRAW_COMMANDS(dr).update(DRAWING(dr), x, y, w, h);
 }
 
 void js_clip(drawing *dr, int x, int y, int w, int h) {
-    DRAWING(dr)->clip(Rect(x, y, w, h));
+    DRAW_COMMANDS(dr).op(DrawCommand::CLIP)
+        .i(x).i(y).i(w).i(h)
+        .complete(DRAWING(dr));
 }
 
-void js_unclip(drawing *dr) { DRAWING(dr)->unclip(); }
+void js_unclip(drawing *dr) {
+    DRAW_COMMANDS(dr).op(DrawCommand::UNCLIP)
+        .complete(DRAWING(dr));
+}
 
-void js_start_draw(drawing *dr) { DRAWING(dr)->startDraw(); }
+void js_start_draw(drawing *dr) { DRAW_COMMANDS(dr).start(); }
 
-void js_end_draw(drawing *dr) { DRAWING(dr)->endDraw(); }
+void js_end_draw(drawing *dr) { DRAW_COMMANDS(dr).end(DRAWING(dr)); }
 
 blitter *js_blitter_new(drawing *dr, int w, int h) {
     Blitter js_value = DRAWING(dr)->blitterNew(Size(w, h));
@@ -574,10 +789,12 @@ void js_blitter_free(drawing *dr, blitter *bl) {
 }
 
 void js_blitter_save(drawing *dr, blitter *bl, int x, int y) {
+    DRAW_COMMANDS(dr).flush(DRAWING(dr));
     DRAWING(dr)->blitterSave(bl->js_value, Point(x, y));
 }
 
 void js_blitter_load(drawing *dr, blitter *bl, int x, int y) {
+    DRAW_COMMANDS(dr).flush(DRAWING(dr));
     DRAWING(dr)->blitterLoad(bl->js_value, Point(x, y));
 }
 
@@ -585,7 +802,302 @@ void js_draw_thick_line(
     drawing *dr, float thickness, float x1, float y1, float x2,
     float y2, int colour
 ) {
-    DRAWING(dr)->drawLine(Point(x1, y1), Point(x2, y2), colour, thickness);
+    DRAW_COMMANDS(dr).line(x1, y1, x2, y2, colour, thickness)
+        .complete(DRAWING(dr));
+}
+
+// Sprites live in Drawing, keyed by id: drawing one is a drawImage
+// (with a rotation) from its canvas, rather than replaying the commands
+// that drew it. Ids are never reused, so a stale one can't draw the
+// wrong picture.
+struct sprite {
+    const int id;
+    const int w, h;
+
+    sprite(int _id, int _w, int _h) : id(_id), w(_w), h(_h) {}
+};
+
+static int next_sprite_id = 1;
+
+sprite *js_sprite_new(drawing *, int w, int h) {
+    return new sprite(next_sprite_id++, w, h);
+}
+
+void js_sprite_free(drawing *dr, sprite *sp) {
+    DRAW_COMMANDS(dr).op(DrawCommand::SPRITE_FREE)
+        .i(sp->id)
+        .complete(DRAWING(dr));
+    delete sp;
+}
+
+void js_sprite_begin(drawing *dr, sprite *sp) {
+    DRAW_COMMANDS(dr).op(DrawCommand::SPRITE_BEGIN)
+        .i(sp->id).i(sp->w).i(sp->h)
+        .begin_sprite();
+}
+
+void js_sprite_end(drawing *dr, sprite *) {
+    DRAW_COMMANDS(dr).op(DrawCommand::SPRITE_END)
+        .end_sprite(DRAWING(dr));
+}
+
+void js_sprite_draw(drawing *dr, sprite *sp, int x, int y, float angle) {
+    DRAW_COMMANDS(dr).op(DrawCommand::SPRITE_DRAW)
+        .i(sp->id).i(x).i(y).f(angle)
+        .complete(DRAWING(dr));
+}
+
+
+/*
+ * Printing
+ */
+
+// Printing (e.g., for PDF export) uses a separate drawing, whose handle is
+// a printer rather than the frontend. printing.c lays out the puzzles on
+// pages and the games draw them as usual, and the primitives are encoded
+// just as for the canvas (plus the print-only DrawCommands), but nothing
+// is delivered until the page is finished: then the whole page goes to
+// PrintSink.page in a single call.
+//
+// Colours in a page's commands are indices into its colour table, which
+// has four floats per colour: hatch r g b. hatch is -1 for a solid colour,
+// else one of the HATCH_* values from puzzles.h (and r g b are unused).
+// When not printing in colour, r g b are all the grey level.
+//
+// The PrintSink's page() implementation is declared through embind in the
+// same way as Drawing's methods (see above).
+
+class PrintSink {
+public:
+    virtual ~PrintSink() = default;
+
+    virtual void page(
+        int number, const Int32Array &commands, const Float32Array &colours
+    ) = 0;
+};
+
+class PrintSinkWrapper : public wrapper<PrintSink> {
+public:
+    EMSCRIPTEN_WRAPPER(explicit PrintSinkWrapper);
+
+    void page(
+        int number, const Int32Array &commands, const Float32Array &colours
+    ) override {
+        return call<void>("page", number, commands, colours);
+    }
+};
+
+EMSCRIPTEN_BINDINGS(print_sink) {
+    register_type<Float32Array>("Float32Array");
+
+    // ReSharper disable once CppExpressionWithoutSideEffects
+    class_<PrintSink>("PrintSink")
+        .smart_ptr<std::shared_ptr<PrintSink> >("PrintSink")
+        .function("page(number, commands, colours)", &PrintSinkWrapper::page)
+        .allow_subclass<PrintSinkWrapper>("PrintSinkWrapper");
+}
+
+struct PrintOptions {
+    int count = 1; // number of puzzles, starting with the current one
+    int across = 1; // puzzles per page
+    int down = 1;
+    float scale = 1.0f; // relative to each puzzle's preferred print size
+    bool withSolutions = false; // add solution pages after the puzzles
+    bool colour = false; // else greyscale (and hatching)
+
+    PrintOptions() = default;
+};
+
+const drawing_api *get_js_print_drawing_api();
+
+class printer {
+    PrintSink *sink;
+    bool colour;
+    int ncolours = 0; // 1 + highest colour index used on this page
+    std::vector<float> colourTable;
+
+public:
+    std::unique_ptr<drawing, decltype(&drawing_free)> dr;
+    DrawCommandBuffer commands;
+    float lineWidth = 1.0f; // for LINE commands (print_line_width)
+
+    printer(PrintSink *_sink, bool _colour)
+        : sink(_sink), colour(_colour),
+          dr(drawing_new(get_js_print_drawing_api(), nullptr, this),
+             drawing_free) {}
+
+    // Notes that a command refers to colour, so the page's colour
+    // table must include it.
+    int use(const int colour) {
+        ncolours = max(ncolours, colour + 1);
+        return colour;
+    }
+
+    void endPage(const int number) {
+        colourTable.clear();
+        for (int colour = 0; colour < ncolours; colour++) {
+            int hatch;
+            float r = 0, g = 0, b = 0;
+            print_get_colour(dr.get(), colour, this->colour, &hatch, &r, &g, &b);
+            colourTable.insert(
+                colourTable.end(), {static_cast<float>(hatch), r, g, b}
+            );
+        }
+        ncolours = 0;
+
+        const auto colours =
+            val(typed_memory_view(colourTable.size(), colourTable.data()));
+        commands.take([&](const Int32Array &words) {
+            sink->page(number, words, colours.as<Float32Array>());
+        });
+    }
+};
+
+static printer &PRINTER(const drawing *dr) {
+    return *static_cast<printer *>(dr->handle);
+}
+
+void js_print_draw_text(
+    drawing *dr, int x, int y, int fonttype, int fontsize, int align,
+    int colour, const char *text
+) {
+    auto &pr = PRINTER(dr);
+    pr.commands.op(DrawCommand::TEXT)
+        .i(x).i(y)
+        .e(to_text_font_type(fonttype)).i(fontsize)
+        .e(to_text_halign(align)).e(to_text_valign(align))
+        .i(pr.use(colour))
+        .text(text);
+}
+
+void js_print_draw_rect(drawing *dr, int x, int y, int w, int h, int colour) {
+    auto &pr = PRINTER(dr);
+    pr.commands.op(DrawCommand::RECT)
+        .i(x).i(y).i(w).i(h).i(pr.use(colour));
+}
+
+void js_print_draw_line(
+    drawing *dr, int x1, int y1, int x2, int y2, int colour
+) {
+    auto &pr = PRINTER(dr);
+    pr.commands.op(DrawCommand::LINE)
+        .f(static_cast<float>(x1)).f(static_cast<float>(y1))
+        .f(static_cast<float>(x2)).f(static_cast<float>(y2))
+        .i(pr.use(colour)).f(pr.lineWidth);
+}
+
+void js_print_draw_polygon(
+    drawing *dr, const int *coords, int npoints, int fillcolour,
+    int outlinecolour
+) {
+    auto &pr = PRINTER(dr);
+    pr.commands.op(DrawCommand::POLYGON)
+        .i(npoints).i(pr.use(fillcolour)).i(pr.use(outlinecolour))
+        .ints(coords, 2 * npoints);
+}
+
+void js_print_draw_circle(
+    drawing *dr, int cx, int cy, int radius, int fillcolour,
+    int outlinecolour
+) {
+    auto &pr = PRINTER(dr);
+    pr.commands.op(DrawCommand::CIRCLE)
+        .i(cx).i(cy).i(radius).i(pr.use(fillcolour)).i(pr.use(outlinecolour));
+}
+
+void js_print_clip(drawing *dr, int x, int y, int w, int h) {
+    PRINTER(dr).commands.op(DrawCommand::CLIP).i(x).i(y).i(w).i(h);
+}
+
+void js_print_unclip(drawing *dr) {
+    PRINTER(dr).commands.op(DrawCommand::UNCLIP);
+}
+
+void js_print_begin_doc(drawing *, int) {}
+
+void js_print_begin_page(drawing *dr, int) {
+    PRINTER(dr).lineWidth = 1.0f;
+}
+
+void js_print_begin_puzzle(
+    drawing *dr, float xm, float xc, float ym, float yc, int pw, int ph,
+    float wmm
+) {
+    PRINTER(dr).commands.op(DrawCommand::BEGIN_PUZZLE)
+        .f(xm).f(xc).f(ym).f(yc).i(pw).i(ph).f(wmm);
+}
+
+void js_print_end_puzzle(drawing *dr) {
+    PRINTER(dr).commands.op(DrawCommand::END_PUZZLE);
+}
+
+void js_print_end_page(drawing *dr, int number) {
+    PRINTER(dr).endPage(number);
+}
+
+void js_print_end_doc(drawing *) {}
+
+void js_print_line_width(drawing *dr, float width) {
+    auto &pr = PRINTER(dr);
+    pr.lineWidth = width;
+    pr.commands.op(DrawCommand::LINE_WIDTH).f(width);
+}
+
+void js_print_line_dotted(drawing *dr, bool dotted) {
+    PRINTER(dr).commands.op(DrawCommand::LINE_DOTTED).i(dotted);
+}
+
+// PDF and SVG can show any UTF-8 text the fonts have glyphs for.
+char *js_print_text_fallback(drawing *, const char *const *strings, int) {
+    return dupstr(strings[0]);
+}
+
+void js_print_draw_thick_line(
+    drawing *dr, float thickness, float x1, float y1, float x2,
+    float y2, int colour
+) {
+    auto &pr = PRINTER(dr);
+    pr.commands.op(DrawCommand::LINE)
+        .f(x1).f(y1).f(x2).f(y2)
+        .i(pr.use(colour)).f(thickness);
+}
+
+static constexpr drawing_api js_print_drawing_api = {
+    1, // version
+    js_print_draw_text,
+    js_print_draw_rect,
+    js_print_draw_line,
+    js_print_draw_polygon,
+    js_print_draw_circle,
+    nullptr, // draw_update
+    js_print_clip,
+    js_print_unclip,
+    nullptr, // start_draw
+    nullptr, // end_draw
+    nullptr, // status_bar
+    nullptr, // blitter_new
+    nullptr, // blitter_free
+    nullptr, // blitter_save
+    nullptr, // blitter_load
+    js_print_begin_doc,
+    js_print_begin_page,
+    js_print_begin_puzzle,
+    js_print_end_puzzle,
+    js_print_end_page,
+    js_print_end_doc,
+    js_print_line_width,
+    js_print_line_dotted,
+    js_print_text_fallback,
+    js_print_draw_thick_line,
+    nullptr, // sprite_new
+    nullptr, // sprite_free
+    nullptr, // sprite_begin
+    nullptr, // sprite_end
+    nullptr, // sprite_draw
+};
+
+const drawing_api *get_js_print_drawing_api() {
+    return &js_print_drawing_api;
 }
 
 
@@ -677,8 +1189,48 @@ struct NotifyStatusBarChange {
     explicit NotifyStatusBarChange(std::string text): statusBarText(std::move(text)) {}
 };
 
+// Sent during game generation (newGame or generateGame):
+// progress 0 at start, 1 when done, and throttled estimates in between.
+EMSCRIPTEN_DECLARE_VAL_TYPE(NotifyGenerationProgressType);
+VAL_CONSTANT(NotifyGenerationProgressType, GENERATION_PROGRESS, "generation-progress")
+struct NotifyGenerationProgress {
+    NotifyGenerationProgressType type = GENERATION_PROGRESS();
+    float progress = 0;
+
+    NotifyGenerationProgress() = default;
+
+    explicit NotifyGenerationProgress(float _progress): progress(_progress) {}
+};
+
+// Sent during a solve() that runs long enough for it to matter:
+// throttled estimates of how far the solver has got.
+EMSCRIPTEN_DECLARE_VAL_TYPE(NotifySolveProgressType);
+VAL_CONSTANT(NotifySolveProgressType, SOLVE_PROGRESS, "solve-progress")
+struct NotifySolveProgress {
+    NotifySolveProgressType type = SOLVE_PROGRESS();
+    float progress = 0;
+
+    NotifySolveProgress() = default;
+
+    explicit NotifySolveProgress(float _progress): progress(_progress) {}
+};
+
 EMSCRIPTEN_DECLARE_VAL_TYPE(NotifyCallbackFunc);
 
+// The compact alternative to NotifyGameStateChange, for the per-move
+// notification: the same fields as int32s, in a view onto wasm memory
+// that the callback must copy synchronously. (Order must match
+// GameStateField in src/puzzle/shared-state.ts.)
+enum class GameStateField : size_t {
+    STATUS,         // midend_status: 0 ongoing, 1 solved, -1 lost
+    CURRENT_MOVE,
+    TOTAL_MOVES,
+    CAN_UNDO,
+    CAN_REDO,
+    COUNT
+};
+EMSCRIPTEN_DECLARE_VAL_TYPE(NotifyGameStateFunc);
+
 EMSCRIPTEN_BINDINGS(notifiations) {
     register_type<NotifyGameIdChangeType>("\"game-id-change\"");
     value_object<NotifyGameIdChange>("NotifyGameIdChange")
@@ -706,6 +1258,16 @@ EMSCRIPTEN_BINDINGS(notifiations) {
         .field("type", &NotifyStatusBarChange::type)
         .field("statusBarText", &NotifyStatusBarChange::statusBarText);
 
+    register_type<NotifyGenerationProgressType>("\"generation-progress\"");
+    value_object<NotifyGenerationProgress>("NotifyGenerationProgress")
+        .field("type", &NotifyGenerationProgress::type)
+        .field("progress", &NotifyGenerationProgress::progress);
+
+    register_type<NotifySolveProgressType>("\"solve-progress\"");
+    value_object<NotifySolveProgress>("NotifySolveProgress")
+        .field("type", &NotifySolveProgress::type)
+        .field("progress", &NotifySolveProgress::progress);
+
     // (Must inline the Notification union to get Emscripten to emit it.)
     register_type<NotifyCallbackFunc>(R"(
         (message:
@@ -713,8 +1275,11 @@ EMSCRIPTEN_BINDINGS(notifiations) {
             | NotifyGameStateChange
             | NotifyParamsChange
             | NotifyStatusBarChange
+            | NotifyGenerationProgress
+            | NotifySolveProgress
         ) => void
     )");
+    register_type<NotifyGameStateFunc>("(state: Int32Array) => void");
 };
 
 
@@ -725,41 +1290,31 @@ EMSCRIPTEN_BINDINGS(notifiations) {
 
 EMSCRIPTEN_DECLARE_VAL_TYPE(Uint8Array);
 
+// Serialisation is accumulated in wasm memory, and only copied out to JS
+// once (in finalize). Deserialisation copies its input into wasm memory
+// once (in the constructor), and then reads from there. This avoids
+// crossing the JS boundary for each of the (many, small) chunks the
+// midend writes or reads.
+
 class WriteBuffer {
-    val buffer;
-    size_t position = 0;
+    std::vector<uint8_t> buffer;
 
 public:
     explicit WriteBuffer(size_t initial_size = 4096) {
-        buffer = val::global("Uint8Array").new_(initial_size);
+        buffer.reserve(initial_size);
     }
 
     void append(const void *data, size_t len) {
-        const size_t new_position = position + len;
-        const auto current_size = buffer["length"].as<size_t>();
-
-        // Grow if needed
-        if (new_position > current_size) {
-            size_t new_size = (std::max)(current_size * 2, new_position);
-            const auto new_buffer = val::global("Uint8Array").new_(new_size);
-            new_buffer.call<void>("set", buffer);
-            buffer = new_buffer;
-        }
-
-        // Copy data directly
-        const auto view = val::global("Uint8Array").new_(
-            buffer["buffer"], position, len
-        );
-        view.call<void>(
-            "set", typed_memory_view(len, static_cast<const uint8_t *>(data))
-        );
-        position = new_position;
+        const auto bytes = static_cast<const uint8_t *>(data);
+        buffer.insert(buffer.end(), bytes, bytes + len);
     }
 
     Uint8Array finalize() {
-        // Return exactly-sized buffer
-        return val::global("Uint8Array").new_(buffer["buffer"], 0, position).as<
-            Uint8Array>();
+        // Return an exactly-sized copy in its own ArrayBuffer (which callers
+        // can transfer). A view directly onto the heap would be invalidated
+        // by heap growth, and transferring its buffer would detach the heap.
+        const auto view = val(typed_memory_view(buffer.size(), buffer.data()));
+        return view.call<val>("slice").as<Uint8Array>();
     }
 
     static void write_callback(void *ctx, const void *buf, int len) {
@@ -767,42 +1322,23 @@ public:
     }
 };
 
-// JS-side helper for copying from (non-heap) ArrayBuffer into heap buffer
-EM_JS(void, copy_from_js_buffer, (
-    EM_VAL js_buffer,
-    size_t js_position,
-    size_t length,
-    uint8_t* dest_ptr
-), {
-    const sourceBuffer = Emval.toValue(js_buffer);
-    const sourceView = new Uint8Array(
-        sourceBuffer.buffer,
-        sourceBuffer.byteOffset + js_position,
-        length
-    );
-    const destView = new Uint8Array(HEAPU8.buffer, dest_ptr, length);
-    destView.set(sourceView);
-});
-
 class ReadBuffer {
-    Uint8Array buffer;
+    std::vector<uint8_t> buffer;
     size_t position = 0;
-    size_t total_size;
 
 public:
     explicit ReadBuffer(const Uint8Array &uint8_array)
-        : buffer(uint8_array), total_size(uint8_array["length"].as<size_t>()) {}
+        : buffer(uint8_array["length"].as<size_t>()) {
+        // Single copy from the JS array into the heap
+        val(typed_memory_view(buffer.size(), buffer.data()))
+            .call<void>("set", uint8_array);
+    }
 
     bool read(void *buf, size_t len) {
-        if (position + len > total_size) {
+        if (len > buffer.size() - position) {
             return false; // Not enough data
         }
-        copy_from_js_buffer(
-            buffer.as_handle(),
-            position,
-            len,
-            static_cast<uint8_t *>(buf)
-        );
+        memcpy(buf, buffer.data() + position, len);
         position += len;
         return true;
     }
@@ -950,6 +1486,58 @@ struct PresetMenuEntry {
     }
 };
 
+// A traced midend call (see midend_set_trace_clock), timed in ms
+// by the worker's performance.now().
+struct TraceEvent {
+    std::string name;
+    double start = 0;
+    double end = 0;
+    int depth = 0;
+
+    TraceEvent() = default;
+
+    explicit TraceEvent(const midend_trace_event &event) :
+        name(event.name),
+        start(event.start),
+        end(event.end),
+        depth(event.depth) {}
+};
+
+EMSCRIPTEN_DECLARE_VAL_TYPE(TraceEventList);
+
+// Memory use: the wasm heap's size (which only ever grows), and
+// malloc.c's counts (see memory_stats_get), which are only kept in
+// builds with MEMORY_STATS.
+struct MemoryStats {
+    bool enabled = false;
+    double heapSize = 0;
+    double live = 0;
+    double peak = 0;
+    double allocs = 0;
+};
+
+// The result of saveGameChanges: a complete save, or a change record
+// to append to the previous one (see midend_serialise_changes).
+EMSCRIPTEN_DECLARE_VAL_TYPE(SavedGameChanges);
+
+// A game generated ahead of time by Frontend.generateGame,
+// to be started (in any Frontend for the same puzzle) by newGameFromGenerated.
+struct GeneratedGame {
+    std::string seed; // full random seed, including params
+    std::string desc;
+    std::optional<std::string> auxInfo = std::nullopt;
+
+    GeneratedGame() = default;
+
+    explicit GeneratedGame(midend *me) {
+        char *_seed, *_desc, *_aux_info;
+        midend_generate_game(me, &_seed, &_desc, &_aux_info);
+        seed = allocated_char_ptr(_seed).as_string();
+        desc = allocated_char_ptr(_desc).as_string();
+        auxInfo = allocated_char_ptr(_aux_info).as_optional_string();
+    }
+};
+
 EMSCRIPTEN_DECLARE_VAL_TYPE(ConfigDescription);
 EMSCRIPTEN_DECLARE_VAL_TYPE(ConfigValues);
 EMSCRIPTEN_DECLARE_VAL_TYPE(ConfigValuesIn);
@@ -963,6 +1551,8 @@ struct FrontendConstructorArgs {
     DeactivateTimerFunc deactivateTimer = val::undefined().as<DeactivateTimerFunc>();
     TextFallbackFunc textFallback = val::undefined().as<TextFallbackFunc>();
     NotifyCallbackFunc notifyChange = val::undefined().as<NotifyCallbackFunc>();
+    // Optional: if provided, used instead of NotifyGameStateChange
+    NotifyGameStateFunc notifyGameState = val::undefined().as<NotifyGameStateFunc>();
 
     FrontendConstructorArgs() = default;
 };
@@ -984,25 +1574,70 @@ private:
     DeactivateTimerFunc deactivateTimer;
     TextFallbackFunc textFallback;
     NotifyCallbackFunc notifyChange;
+    NotifyGameStateFunc notifyGameState;
+
+    // Frame pacing for timer()
+    static constexpr int maxSkippedTicks = 3;
+    bool timerActive = false;
+    double tickIntervalMs = 1000.0 / 60; // smoothed
+    float pendingTimerSecs = 0;
+    int ticksToSkip = 0;
+
+    // Minimum interval between NotifyGenerationProgress estimates
+    static constexpr double generationProgressIntervalMs = 50;
+    double lastGenerationProgressMs = 0;
+
+    // The current solve's limits (see solve()): the solver is stopped
+    // at its next progress report after the deadline, or after JS
+    // stores a nonzero value in solveCancel[0].
+    static constexpr double solveProgressIntervalMs = 50;
+    double solveDeadlineMs = std::numeric_limits<double>::infinity();
+    val solveCancel = val::undefined();
+    bool solveNotify = false;
+    bool solveCancelled = false;
+    float solveDone = 0;
+    double lastSolveProgressMs = 0;
+
+    // Built on first use, and discarded by notifyParamsChange.
+    // (Building them walks the midend's config_items and presets into
+    // new JS objects, which the UI asks for far more often than they change.)
+    mutable std::optional<PresetMenuEntryList> presetsCache;
+    mutable std::optional<ConfigDescription> customParamsConfigCache;
+    mutable std::optional<ConfigDescription> preferencesConfigCache;
 
 public:
     // Allow late binding of JS Drawing, by passing myself as the drhandle.
     // (Unwound in DRAWING() accessor below.)
     Drawing *drawing = nullptr;
 
+    // drawing_api primitives pending delivery to the JS Drawing.
+    DrawCommandBuffer drawCommands;
+
     explicit frontend(const FrontendConstructorArgs &args)
         : me_ptr(
               // For midend purposes, the frontend is also the drhandle.
-              midend_new(this, &thegame, get_js_drawing_api(), this),
+              midend_new(this, get_game(), get_js_drawing_api(), this),
               midend_free
           ),
           activateTimer(args.activateTimer),
           deactivateTimer(args.deactivateTimer),
           textFallback(args.textFallback),
-          notifyChange(args.notifyChange) {
+          notifyChange(args.notifyChange),
+          notifyGameState(args.notifyGameState) {
 
         midend_request_params_changes(me(), notify_params_changes, this);
         midend_request_id_changes(me(), notify_id_changes, this);
+        midend_request_generation_progress(me(), notify_generation_progress, this);
+        midend_request_solve_progress(me(), notify_solve_progress, this);
+
+#ifdef __EMSCRIPTEN_PTHREADS__
+        // Once per wasm instance: give parallel_run() the other cores.
+        static bool threadpool_started = false;
+        if (!threadpool_started) {
+            threadpool_start(emscripten_num_logical_cores());
+            threadpool_started = true;
+        }
+#endif
 
         // Notify the default params.
         notifyParamsChange();
@@ -1021,17 +1656,113 @@ private:
         static_cast<frontend *>(ctx)->notifyGameIdChange();
     }
 
+    // midend_set_trace_clock callback
+    static double trace_clock(void *) {
+        return emscripten_get_now();
+    }
+
+    // midend_request_generation_progress callback
+    static void notify_generation_progress(void *ctx, float done) {
+        static_cast<frontend *>(ctx)->notifyGenerationProgress(done);
+    }
+
+    void notifyGenerationProgress(float done) {
+        // Some generators report thousands of estimates per second:
+        // forwarding them all to the main thread would only slow things down.
+        auto const now = emscripten_get_now();
+        if (done > 0 && done < 1 &&
+            now - lastGenerationProgressMs < generationProgressIntervalMs)
+            return;
+        lastGenerationProgressMs = now;
+        auto message = NotifyGenerationProgress(done);
+        notifyChange(message);
+    }
+
+    // midend_request_solve_progress callback
+    static bool notify_solve_progress(void *ctx, float done) {
+        return static_cast<frontend *>(ctx)->notifySolveProgress(done);
+    }
+
+    // Returns true to stop the solver.
+    bool notifySolveProgress(float done) {
+        solveDone = done;
+        auto const now = emscripten_get_now();
+        if (now >= solveDeadlineMs)
+            return true;
+        // Polling the cancel flag means a call into JS, so it's
+        // throttled along with the notifications.
+        if (now - lastSolveProgressMs < solveProgressIntervalMs)
+            return false;
+        lastSolveProgressMs = now;
+        if (!solveCancel.isUndefined() &&
+            val::global("Atomics").call<int>("load", solveCancel, 0) != 0) {
+            solveCancelled = true;
+            return true;
+        }
+        if (solveNotify) {
+            auto message = NotifySolveProgress(done);
+            notifyChange(message);
+        }
+        return false;
+    }
+
+    // Runs midend_solve within the given limits. Returns midend_solve's
+    // error, or (if the solver was stopped) a more helpful one.
+    std::optional<std::string> solveWithin(
+        double budgetMs, const val &cancel, bool notify) {
+        const auto start = emscripten_get_now();
+        solveDeadlineMs = budgetMs >= 0 ? start + budgetMs
+                                        : std::numeric_limits<double>::infinity();
+        solveCancel = cancel;
+        solveNotify = notify;
+        solveCancelled = false;
+        solveDone = 0;
+        lastSolveProgressMs = start;
+
+        const static_char_ptr error(midend_solve(me()));
+        std::optional<std::string> result = error.as_optional_string();
+        if (result && *result == "Solver interrupted") {
+            const auto percent = std::to_string(static_cast<int>(solveDone * 100));
+            result = (solveCancelled ? "Solver cancelled" : "Solver ran out of time")
+                + std::string(" (about ") + percent + "% of the way)";
+        }
+
+        solveDeadlineMs = std::numeric_limits<double>::infinity();
+        solveCancel = val::undefined();
+        solveNotify = false;
+        return result;
+    }
+
     void notifyGameIdChange() const {
         auto message = NotifyGameIdChange(me());
         notifyChange(message);
     }
 
     void notifyGameStateChange() const {
-        auto message = NotifyGameStateChange(me());
-        notifyChange(message);
+        if (notifyGameState.isUndefined()) {
+            auto message = NotifyGameStateChange(me());
+            notifyChange(message);
+            return;
+        }
+
+        // (No strings or objects: this happens after every move.)
+        std::array<int32_t, static_cast<size_t>(GameStateField::COUNT)> state{};
+        auto field = [&state](GameStateField f) -> int32_t & {
+            return state[static_cast<size_t>(f)];
+        };
+        field(GameStateField::STATUS) = midend_status(me());
+        midend_get_move_count(
+            me(), &field(GameStateField::CURRENT_MOVE),
+            &field(GameStateField::TOTAL_MOVES));
+        field(GameStateField::CAN_UNDO) = midend_can_undo(me());
+        field(GameStateField::CAN_REDO) = midend_can_redo(me());
+        notifyGameState(val(typed_memory_view(state.size(), state.data())));
     }
 
     void notifyParamsChange() const {
+        presetsCache.reset();
+        customParamsConfigCache.reset();
+        preferencesConfigCache.reset();
         auto message = NotifyParamsChange(me());
         notifyChange(message);
     }
@@ -1051,6 +1782,10 @@ public:
         return midend_which_game(me())->can_solve;
     }
 
+    [[nodiscard]] bool getCanHint() const {
+        return midend_which_game(me())->solve_step != nullptr;
+    }
+
     [[nodiscard]] bool getNeedsRightButton() const {
         return midend_which_game(me())->flags & REQUIRE_RBUTTON;
     }
@@ -1089,6 +1824,80 @@ public:
         notifyGameStateChange();
     }
 
+    /**
+     * Generates a new game for the current params, without starting it
+     * or otherwise affecting the current game. (Intended for use in a
+     * separate, background Frontend, to generate games ahead of time.)
+     */
+    [[nodiscard]] GeneratedGame generateGame() const {
+        return GeneratedGame(me());
+    }
+
+    /**
+     * Starts a game previously returned by generateGame (possibly from
+     * another Frontend for the same puzzle), as if newGame had just
+     * generated it. Returns undefined if successful, else error message.
+     */
+    [[nodiscard]] std::optional<std::string> newGameFromGenerated(
+        const GeneratedGame &generated
+    ) const {
+        const static_char_ptr error(midend_supply_game(
+            me(), generated.seed.c_str(), generated.desc.c_str(),
+            generated.auxInfo ? generated.auxInfo->c_str() : nullptr
+        ));
+        if (!error) {
+            newGame();
+        }
+        return error.as_optional_string();
+    }
+
+    /**
+     * Prints the current puzzle, followed by options.count - 1 newly
+     * generated ones with the same params (without affecting the current
+     * game), delivering each page to sink as soon as it's laid out.
+     * Returns undefined if successful, else error message.
+     */
+    [[nodiscard]] std::optional<std::string> print(
+        PrintSink *sink, const PrintOptions &options
+    ) const {
+        const game *ourgame = midend_which_game(me());
+        if (!ourgame->can_print)
+            return "This puzzle does not support printing";
+        if (options.count < 1 || options.across < 1 || options.down < 1)
+            return "Nothing to print";
+
+        printer pr(sink, options.colour && ourgame->can_print_in_colour);
+        std::unique_ptr<document, decltype(&document_free)> doc(
+            document_new(options.across, options.down, options.scale),
+            document_free
+        );
+        document_stream_begin(doc.get(), pr.dr.get());
+
+        const char *error = midend_print_puzzle(
+            me(), doc.get(), options.withSolutions
+        );
+        if (!error && options.count > 1) {
+            // (No frontend: nothing is drawn, and timers are ignored.)
+            std::unique_ptr<midend, decltype(&midend_free)> scratch(
+                midend_new(nullptr, ourgame, nullptr, nullptr),
+                midend_free
+            );
+            game_params *params = midend_get_params(me());
+            midend_set_params(scratch.get(), params);
+            ourgame->free_params(params);
+            for (int i = 1; !error && i < options.count; i++) {
+                midend_new_game(scratch.get());
+                error = midend_print_puzzle(
+                    scratch.get(), doc.get(), options.withSolutions
+                );
+            }
+        }
+
+        // (Even after an error, to deliver the pages already printed.)
+        document_stream_end(doc.get());
+        return static_char_ptr(error).as_optional_string();
+    }
+
     void restartGame() const {
         midend_restart_game(me());
         notifyGameStateChange();
@@ -1113,6 +1922,41 @@ public:
         return result == PKR_SOME_EFFECT || result == PKR_NO_EFFECT;
     }
 
+    /**
+     * Processes a batch of events, given as consecutive (x, y, button)
+     * triples, as if by processKey for each, but with only one redraw
+     * and game state change notification at the end. (For replaying
+     * recorded input, auto-repeat and tests.) Returns processKey's
+     * result for each event, as 1 or 0.
+     */
+    [[nodiscard]] Uint8Array processKeys(const Int32Array &events) const {
+        auto triples = std::vector<int32_t>(events["length"].as<size_t>());
+        val(typed_memory_view(triples.size(), triples.data()))
+            .call<void>("set", events);
+
+        auto results = std::vector<uint8_t>(triples.size() / 3);
+        bool changed = false;
+        midend_defer_redraws(me(), true);
+        for (size_t i = 0; i < results.size(); i++) {
+            const int x = triples[3 * i];
+            const int y = triples[3 * i + 1];
+            const int button = triples[3 * i + 2];
+            const auto result = midend_process_key(me(), x, y, button);
+            // (As in processKey, drags alone don't notify.)
+            if (result == PKR_SOME_EFFECT && !IS_MOUSE_DRAG(button)) {
+                changed = true;
+            }
+            results[i] = result == PKR_SOME_EFFECT || result == PKR_NO_EFFECT;
+        }
+        midend_defer_redraws(me(), false);
+        if (changed) {
+            notifyGameStateChange();
+        }
+
+        const auto view = val(typed_memory_view(results.size(), results.data()));
+        return view.call<val>("slice").as<Uint8Array>();
+    }
+
     [[nodiscard]] KeyLabelList requestKeys() const {
         int nkeys;
         auto key_labels = midend_request_keys(me(), &nkeys);
@@ -1164,7 +2008,30 @@ public:
 
     void freezeTimer(float tprop) const { midend_freeze_timer(me(), tprop); }
 
-    void timer(float tplus) const { midend_timer(me(), tplus); }
+    // Called on each animation frame while the timer is active. Normally
+    // each tick runs midend_timer (and so a redraw, if anything is
+    // animating). But if that takes longer than the interval between
+    // ticks, the next few ticks are skipped, their time coalesced into
+    // the next one that runs, so that a slow device isn't kept busy
+    // redrawing the whole time and input still gets a look in.
+    // Animations are timed, so they just run at a lower frame rate.
+    // Each skipped tick is traced as a "dropped_frame".
+    void timer(float tplus) {
+        pendingTimerSecs += tplus;
+        const double intervalMs = std::clamp(tplus * 1000.0, 4.0, 50.0);
+        tickIntervalMs += (intervalMs - tickIntervalMs) / 8;
+        if (ticksToSkip > 0) {
+            ticksToSkip--;
+            midend_trace_mark(me(), "dropped_frame");
+            return;
+        }
+
+        const double start = emscripten_get_now();
+        midend_timer(me(), pendingTimerSecs);
+        pendingTimerSecs = 0;
+        const double cost = emscripten_get_now() - start;
+        ticksToSkip = std::min(maxSkippedTicks, static_cast<int>(cost / tickIntervalMs));
+    }
 
     [[nodiscard]] bool getWantsStatusbar() const {
         return midend_wants_statusbar(me());
@@ -1329,7 +2196,9 @@ private:
 
 public:
     [[nodiscard]] ConfigDescription getPreferencesConfig() const {
-        return build_config_description(CFG_PREFS);
+        if (!preferencesConfigCache)
+            preferencesConfigCache = build_config_description(CFG_PREFS);
+        return *preferencesConfigCache;
     }
 
     [[nodiscard]] ConfigValues getPreferences() const {
@@ -1376,12 +2245,17 @@ public:
     }
 
     [[nodiscard]] PresetMenuEntryList getPresets() const {
-        const auto *presets = midend_get_presets(me(), nullptr);
-        return PresetMenuEntry::build_menu(me(), presets);
+        if (!presetsCache) {
+            const auto *presets = midend_get_presets(me(), nullptr);
+            presetsCache = PresetMenuEntry::build_menu(me(), presets);
+        }
+        return *presetsCache;
     }
 
     [[nodiscard]] ConfigDescription getCustomParamsConfig() const {
-        return build_config_description(CFG_SETTINGS);
+        if (!customParamsConfigCache)
+            customParamsConfigCache = build_config_description(CFG_SETTINGS);
+        return *customParamsConfigCache;
     }
 
     [[nodiscard]] ConfigValues getCustomParams() const {
@@ -1476,8 +2350,104 @@ public:
         return formatted.as_optional_string();
     }
 
-    [[nodiscard]] std::optional<std::string> solve() const {
-        const static_char_ptr error(midend_solve(me()));
+    // Gives up (with an error) after budgetMs (if not negative), or once
+    // cancel[0] is set nonzero (for cancel on a SharedArrayBuffer, from
+    // another thread). Sends NotifySolveProgress while it's working.
+    [[nodiscard]] std::optional<std::string> solve(
+        double budgetMs, const OptionalInt32Array &cancel) {
+        auto error = solveWithin(budgetMs, cancel, true);
+        if (!error) {
+            notifyGameStateChange();
+        }
+        return error;
+    }
+
+    // For games whose solution doesn't depend on the current state, work it
+    // out now (during idle time) so a later solve() is instant. The midend
+    // keeps it with the game, so it's saved along with it.
+    // (Within a fixed budget: an idle-time solve mustn't hold up the
+    // worker for long. On failure, solve() will try again in its turn.)
+    void precomputeSolution() {
+        static constexpr double precomputeBudgetMs = 2000;
+        solveDeadlineMs = emscripten_get_now() + precomputeBudgetMs;
+        midend_precompute_solution(me());
+        solveDeadlineMs = std::numeric_limits<double>::infinity();
+    }
+
+    // Do some of the work a game's first move will need (see the backend's
+    // speculate function), a step at a time during idle time. Returns true
+    // if there's more to do.
+    [[nodiscard]] bool speculate() const {
+        return midend_speculate(me());
+    }
+
+/*
+ * Benchmarks (for the benchmark page: see src/benchmark-page.ts)
+ */
+
+    // Each of these runs a fixed workload `count` times and returns the
+    // time each run took, in ms. Games come from fixed seeds ("bench0",
+    // "bench1", ...) with the current params, so that every build and
+    // browser does exactly the same work.
+
+    // Generate games. The last one is left as the current game.
+    [[nodiscard]] Float64Array benchmarkGenerate(int count) const {
+        std::vector<double> times;
+        for (int i = 0; i < count; i++) {
+            startBenchmarkGame(i);
+            const double start = emscripten_get_now();
+            midend_new_game(me());
+            times.push_back(emscripten_get_now() - start);
+        }
+        notifyGameStateChange();
+        return benchmark_times(times);
+    }
+
+    // Solve the same games from their starting positions (generating
+    // them isn't timed). A game the solver gives up on gets NaN.
+    [[nodiscard]] Float64Array benchmarkSolve(int count) const {
+        std::vector<double> times;
+        for (int i = 0; i < count; i++) {
+            startBenchmarkGame(i);
+            midend_new_game(me());
+            const double start = emscripten_get_now();
+            const bool solved = midend_solve(me()) == nullptr;
+            times.push_back(solved ? emscripten_get_now() - start
+                                   : std::numeric_limits<double>::quiet_NaN());
+        }
+        notifyGameStateChange();
+        return benchmark_times(times);
+    }
+
+    // Redraw the current game from scratch, into whatever Drawing is set.
+    [[nodiscard]] Float64Array benchmarkRedraw(int count) const {
+        std::vector<double> times;
+        for (int i = 0; drawing != nullptr && i < count; i++) {
+            const double start = emscripten_get_now();
+            midend_force_redraw(me());
+            times.push_back(emscripten_get_now() - start);
+        }
+        return benchmark_times(times);
+    }
+
+private:
+    void startBenchmarkGame(int i) const {
+        const auto id = getParams() + "#bench" + std::to_string(i);
+        midend_game_id(me(), id.c_str());
+    }
+
+    static Float64Array benchmark_times(const std::vector<double> &times) {
+        const auto view = val(typed_memory_view(times.size(), times.data()));
+        return view.call<val>("slice").as<Float64Array>();
+    }
+
+public:
+
+    // Apply just the next deduction the solver can make from the current
+    // state, as an ordinary (undoable) move. Returns an error message
+    // if there isn't one.
+    [[nodiscard]] std::optional<std::string> hint() const {
+        const static_char_ptr error(midend_hint(me()));
         if (!error) {
             notifyGameStateChange();
         }
@@ -1496,17 +2466,54 @@ public:
         }
     }
 
+    // Jump to move (as in NotifyGameStateChange.currentMove) in one step,
+    // rather than by repeated undo or redo.
+    void gotoMove(int move) const {
+        if (midend_goto_move(me(), move)) {
+            notifyGameStateChange();
+        }
+    }
+
     // Undocumented midend functions (maybe private?):
     // void midend_supersede_game_desc(midend *me, const char *desc,
     //                                 const char *privdesc);
     // char *midend_rewrite_statusbar(midend *me, const char *text);
 
-    [[nodiscard]] Uint8Array saveGame() const {
+    // Calls serialise(write, wctx) to write into buffer: through a
+    // binsave_writer if binary, to get the compact binary save format
+    // (which only loadGame accepts, not other versions of Puzzles).
+    template <typename F>
+    static auto serialiseInto(WriteBuffer &buffer, bool binary, F serialise) {
+        if (!binary)
+            return serialise(WriteBuffer::write_callback, static_cast<void *>(&buffer));
+        const std::unique_ptr<binsave_writer, decltype(&binsave_writer_free)> writer(
+            binsave_writer_new(WriteBuffer::write_callback, &buffer),
+            binsave_writer_free);
+        return serialise(binsave_write, static_cast<void *>(writer.get()));
+    }
+
+    [[nodiscard]] Uint8Array saveGame(bool binary) const {
         WriteBuffer buffer;
-        midend_serialise(me(), WriteBuffer::write_callback, &buffer);
+        serialiseInto(buffer, binary, [this](auto write, void *wctx) {
+            midend_serialise(me(), write, wctx);
+        });
         return buffer.finalize();
     }
 
+    // Save just what has changed since the last call, for autosaving.
+    // (loadGame accepts a complete save followed by any change records.)
+    [[nodiscard]] SavedGameChanges saveGameChanges(bool full, bool binary) const {
+        WriteBuffer buffer;
+        const bool complete =
+            serialiseInto(buffer, binary, [this, full](auto write, void *wctx) {
+                return midend_serialise_changes(me(), full, write, wctx);
+            });
+        auto result = val::object();
+        result.set("complete", complete);
+        result.set("data", buffer.finalize());
+        return result.as<SavedGameChanges>();
+    }
+
     [[nodiscard]] std::optional<std::string> loadGame(const Uint8Array &data) const {
         ReadBuffer buffer(data);
         const static_char_ptr error(midend_deserialise(me(), ReadBuffer::read_callback, &buffer));
@@ -1525,6 +2532,42 @@ public:
         return std::nullopt;
     }
 
+    // Start or stop recording trace events. (They're only ever
+    // recorded in builds with MIDEND_TRACING: see WASM_TRACING.)
+    void setTracing(bool enabled) const {
+        midend_set_trace_clock(me(), enabled ? trace_clock : nullptr, nullptr);
+    }
+
+    // Return (and forget) the trace events recorded since last time.
+    [[nodiscard]] TraceEventList getTraceEvents() const {
+        midend_trace_event events[MIDEND_TRACE_EVENTS];
+        const int n = midend_take_trace_events(me(), events, MIDEND_TRACE_EVENTS);
+        auto event_vec = std::vector<TraceEvent>();
+        event_vec.reserve(n);
+        for (const auto &event: std::span(events, n))
+            event_vec.emplace_back(event);
+        return val::array(event_vec).as<TraceEventList>();
+    }
+
+    // Memory use since the last resetMemoryStats, so that calling that
+    // before (say) generating a game and this after gives the
+    // generation's peak.
+    [[nodiscard]] MemoryStats getMemoryStats() const {
+        memory_stats stats;
+        memory_stats_get(&stats);
+        MemoryStats result;
+        result.enabled = memory_stats_enabled();
+        result.heapSize = static_cast<double>(emscripten_get_heap_size());
+        result.live = static_cast<double>(stats.live);
+        result.peak = static_cast<double>(stats.peak);
+        result.allocs = static_cast<double>(stats.allocs);
+        return result;
+    }
+
+    void resetMemoryStats() const {
+        memory_stats_reset();
+    }
+
     // ???: int midend_tilesize(midend *me);
     // (only seems useful with midend_which_game(me)->preferred_tilesize)
 
@@ -1535,11 +2578,19 @@ public:
     // Frontend APIs used by the midend, as callbacks into JS
     //
 
-    void activate_timer() const {
+    void activate_timer() {
+        // (The midend calls this after every tick, while still active.)
+        if (!timerActive) {
+            // Don't carry skipped time into a new animation.
+            timerActive = true;
+            pendingTimerSecs = 0;
+            ticksToSkip = 0;
+        }
         (void) activateTimer();
     }
 
-    void deactivate_timer() const {
+    void deactivate_timer() {
+        timerActive = false;
         (void) deactivateTimer();
     }
 
@@ -1571,6 +2622,8 @@ public:
 
 EMSCRIPTEN_BINDINGS(frontend) {
     register_type<Uint8Array>("Uint8Array");
+    register_type<Float64Array>("Float64Array");
+    register_type<OptionalInt32Array>("Int32Array | undefined");
 
     value_object<PresetMenuEntry>("PresetMenuEntry")
         .field("title", &PresetMenuEntry::title)
@@ -1580,6 +2633,35 @@ EMSCRIPTEN_BINDINGS(frontend) {
     register_type<PresetMenuEntryList>("PresetMenuEntry[]");
     register_optional<PresetMenuEntryList>();
 
+    value_object<TraceEvent>("TraceEvent")
+        .field("name", &TraceEvent::name)
+        .field("start", &TraceEvent::start)
+        .field("end", &TraceEvent::end)
+        .field("depth", &TraceEvent::depth);
+    register_type<TraceEventList>("TraceEvent[]");
+
+    value_object<MemoryStats>("MemoryStats")
+        .field("enabled", &MemoryStats::enabled)
+        .field("heapSize", &MemoryStats::heapSize)
+        .field("live", &MemoryStats::live)
+        .field("peak", &MemoryStats::peak)
+        .field("allocs", &MemoryStats::allocs);
+
+    register_type<SavedGameChanges>("{ complete: boolean; data: Uint8Array }");
+
+    value_object<PrintOptions>("PrintOptions")
+        .field("count", &PrintOptions::count)
+        .field("across", &PrintOptions::across)
+        .field("down", &PrintOptions::down)
+        .field("scale", &PrintOptions::scale)
+        .field("withSolutions", &PrintOptions::withSolutions)
+        .field("colour", &PrintOptions::colour);
+
+    value_object<GeneratedGame>("GeneratedGame")
+        .field("seed", &GeneratedGame::seed)
+        .field("desc", &GeneratedGame::desc)
+        .field("auxInfo", &GeneratedGame::auxInfo);
+
     register_type<ConfigDescription>(R"({
         title: string;
         items: {
@@ -1600,7 +2682,8 @@ EMSCRIPTEN_BINDINGS(frontend) {
         .field("activateTimer", &FrontendConstructorArgs::activateTimer)
         .field("deactivateTimer", &FrontendConstructorArgs::deactivateTimer)
         .field("textFallback", &FrontendConstructorArgs::textFallback)
-        .field("notifyChange", &FrontendConstructorArgs::notifyChange);
+        .field("notifyChange", &FrontendConstructorArgs::notifyChange)
+        .field("notifyGameState", &FrontendConstructorArgs::notifyGameState);
 
     // ReSharper disable once CppExpressionWithoutSideEffects
     class_<frontend>("Frontend")
@@ -1609,14 +2692,19 @@ EMSCRIPTEN_BINDINGS(frontend) {
         .property("name", &frontend::getName)
         .property("canConfigure", &frontend::getCanConfigure)
         .property("canSolve", &frontend::getCanSolve)
+        .property("canHint", &frontend::getCanHint)
         .property("needsRightButton", &frontend::getNeedsRightButton)
         .property("isTimed", &frontend::getIsTimed)
         .function("size(maxSize, isUserSize, devicePixelRatio)", &frontend::size)
         .function("preferredSize", &frontend::preferredSize)
         .function("resetTileSize", &frontend::resetTileSize)
         .function("newGame", &frontend::newGame)
+        .function("generateGame", &frontend::generateGame)
+        .function("newGameFromGenerated(generated)", &frontend::newGameFromGenerated)
+        .function("print(sink, options)", &frontend::print, allow_raw_pointers())
         .function("restartGame", &frontend::restartGame)
         .function("processKey(x, y, button)", &frontend::processKey)
+        .function("processKeys(events)", &frontend::processKeys)
         .property("statusbarText", &frontend::getStatusbarText)
         .function("requestKeys", &frontend::requestKeys)
         .function("currentKeyLabel(button)", &frontend::currentKeyLabel)
@@ -1644,12 +2732,24 @@ EMSCRIPTEN_BINDINGS(frontend) {
         .property("randomSeed", &frontend::getRandomSeed)
         .property("canFormatAsText", &frontend::getCanFormatAsText)
         .function("formatAsText", &frontend::formatAsText)
-        .function("solve", &frontend::solve)
+        .function("solve(budgetMs, cancel)", &frontend::solve)
+        .function("precomputeSolution", &frontend::precomputeSolution)
+        .function("speculate", &frontend::speculate)
+        .function("benchmarkGenerate(count)", &frontend::benchmarkGenerate)
+        .function("benchmarkSolve(count)", &frontend::benchmarkSolve)
+        .function("benchmarkRedraw(count)", &frontend::benchmarkRedraw)
+        .function("hint", &frontend::hint)
         .function("undo", &frontend::undo)
         .function("redo", &frontend::redo)
-        .function("saveGame", &frontend::saveGame)
+        .function("gotoMove(move)", &frontend::gotoMove)
+        .function("saveGame(binary)", &frontend::saveGame)
+        .function("saveGameChanges(full, binary)", &frontend::saveGameChanges)
         .function("loadGame(data)", &frontend::loadGame)
-        .function("getCursorLocation", &frontend::getCursorLocation);
+        .function("getCursorLocation", &frontend::getCursorLocation)
+        .function("setTracing(enabled)", &frontend::setTracing)
+        .function("getTraceEvents", &frontend::getTraceEvents)
+        .function("getMemoryStats", &frontend::getMemoryStats)
+        .function("resetMemoryStats", &frontend::resetMemoryStats);
 }
 
 Drawing *DRAWING(const drawing *dr) {
@@ -1660,6 +2760,10 @@ Drawing *DRAWING(const drawing *dr) {
     return fe->drawing;
 }
 
+DrawCommandBuffer &DRAW_COMMANDS(const drawing *dr) {
+    return static_cast<frontend *>(dr->handle)->drawCommands;
+}
+
 // These two drawing_api functions aren't really canvas-specific (and may
 // need to run before the canvas is installed), so treat them as part of frontend
 // or Frontend rather than Drawing.
@@ -1700,6 +2804,11 @@ static constexpr drawing_api js_drawing_api = {
     nullptr, // line_dotted
     js_text_fallback,
     js_draw_thick_line,
+    js_sprite_new,
+    js_sprite_free,
+    js_sprite_begin,
+    js_sprite_end,
+    js_sprite_draw,
 };
 
 const drawing_api *get_js_drawing_api() {
@@ -1709,12 +2818,15 @@ const drawing_api *get_js_drawing_api() {
 extern "C" {
     // Implement the C frontend functions used by the midend
 
+    // (fe is null for Frontend.print's scratch midend.)
     void activate_timer(frontend *fe) {
-        fe->activate_timer();
+        if (fe)
+            fe->activate_timer();
     }
 
     void deactivate_timer(frontend *fe) {
-        fe->deactivate_timer();
+        if (fe)
+            fe->deactivate_timer();
     }
 
     void frontend_default_colour(frontend *fe, float *output) {
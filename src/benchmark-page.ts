@@ -0,0 +1,199 @@
+// Hidden benchmark page (benchmark.html): times each wasm build of the
+// puzzles on whatever device it's opened on. Not linked from the app.
+import * as Sentry from "@sentry/browser";
+import { wrap } from "comlink";
+import { puzzleIds, puzzleMetadataMap, version } from "./puzzle/catalog.ts";
+import type {
+  BenchmarkTimes,
+  RemoteWorkerPuzzleFactory,
+  WasmFlavour,
+} from "./puzzle/worker.ts";
+import { initSentry } from "./utils/sentry.ts";
+
+const allFlavours: WasmFlavour[] = ["baseline", "simd", "threads", "shared-core"];
+const canvasSize = { w: 600, h: 600 };
+
+interface Summary {
+  count: number;
+  failures: number; // (NaN times: e.g., solver gave up)
+  mean: number;
+  median: number;
+  min: number;
+  max: number;
+  times: number[];
+}
+
+interface Result {
+  puzzleId: string;
+  params: string;
+  flavour: WasmFlavour;
+  loadMs: number;
+  generate: Summary;
+  solve?: Summary;
+  redraw: Summary;
+}
+
+interface Failure {
+  puzzleId: string;
+  flavour: WasmFlavour;
+  error: string;
+}
+
+function summarize(times: Float64Array): Summary {
+  const ok = [...times].filter((t) => !Number.isNaN(t)).sort((a, b) => a - b);
+  const mid = Math.floor(ok.length / 2);
+  return {
+    count: times.length,
+    failures: times.length - ok.length,
+    mean: ok.reduce((sum, t) => sum + t, 0) / ok.length,
+    median: ok.length % 2 ? ok[mid] : (ok[mid - 1] + ok[mid]) / 2,
+    min: ok[0] ?? Number.NaN,
+    max: ok[ok.length - 1] ?? Number.NaN,
+    times: [...times],
+  };
+}
+
+// "?puzzles=net,loopy:10x10t0dh" => [["net", default], ["loopy", "10x10t0dh"]]
+function requestedPuzzles(query: URLSearchParams): [string, string][] {
+  const entries = query.get("puzzles")?.split(",") ?? puzzleIds;
+  return entries.map((entry) => {
+    const [puzzleId, params] = entry.split(":", 2);
+    return [puzzleId, params ?? puzzleMetadataMap[puzzleId]?.defaultParams ?? ""];
+  });
+}
+
+async function runOne(
+  puzzleId: string,
+  params: string,
+  flavour: WasmFlavour,
+  count: number,
+): Promise<Result> {
+  const worker = new Worker(new URL("./puzzle/worker.ts", import.meta.url), {
+    type: "module",
+    name: `benchmark-${puzzleId}-${flavour}`,
+  });
+  try {
+    const workerFactory = wrap<RemoteWorkerPuzzleFactory>(worker);
+    const start = performance.now();
+    const workerPuzzle = await workerFactory.create(puzzleId, undefined, flavour);
+    const loadMs = performance.now() - start;
+    const times: BenchmarkTimes = await workerPuzzle.runBenchmark(
+      params,
+      count,
+      canvasSize,
+    );
+    return {
+      puzzleId,
+      params,
+      flavour: await workerPuzzle.getFlavour(),
+      loadMs,
+      generate: summarize(times.generate),
+      solve: times.solve && summarize(times.solve),
+      redraw: summarize(times.redraw),
+    };
+  } finally {
+    worker.terminate();
+  }
+}
+
+function addRow(cells: string[], errorMessage?: string) {
+  const row = document.createElement("tr");
+  for (const text of cells) {
+    const cell = document.createElement("td");
+    cell.textContent = text;
+    row.append(cell);
+  }
+  if (errorMessage) {
+    const cell = document.createElement("td");
+    cell.className = "error";
+    cell.colSpan = 4;
+    cell.textContent = errorMessage;
+    row.append(cell);
+  }
+  document.getElementById("results")?.append(row);
+}
+
+// Median, starred if any runs failed
+const ms = (summary?: Summary) =>
+  summary ? `${summary.median.toFixed(1)}${summary.failures ? "*" : ""}` : "–";
+
+async function run() {
+  const query = new URLSearchParams(window.location.search);
+  const count = Number.parseInt(query.get("count") ?? "5", 10) || 5;
+  const flavours = (query.get("flavours")?.split(",") ?? allFlavours) as WasmFlavour[];
+  const status = document.getElementById("status");
+  const results: Result[] = [];
+  const errors: Failure[] = [];
+
+  for (const [puzzleId, params] of requestedPuzzles(query)) {
+    for (const flavour of flavours) {
+      if (status) {
+        status.textContent = `${puzzleId} (${flavour})…`;
+      }
+      try {
+        const result = await runOne(puzzleId, params, flavour, count);
+        results.push(result);
+        addRow([
+          puzzleId,
+          params,
+          result.flavour,
+          result.loadMs.toFixed(0),
+          ms(result.generate),
+          ms(result.solve),
+          ms(result.redraw),
+        ]);
+      } catch (error) {
+        // Typically a build that this browser (or deployment) doesn't have.
+        errors.push({ puzzleId, flavour, error: String(error) });
+        addRow([puzzleId, params, flavour], String(error));
+      }
+    }
+  }
+
+  const report = {
+    version: import.meta.env.VITE_APP_VERSION ?? version,
+    date: new Date().toISOString(),
+    userAgent: navigator.userAgent,
+    hardwareConcurrency: navigator.hardwareConcurrency,
+    crossOriginIsolated: self.crossOriginIsolated,
+    count,
+    results,
+    errors,
+  };
+  const json = JSON.stringify(report, null, 2);
+  const pre = document.getElementById("json");
+  if (pre) {
+    pre.textContent = json;
+  }
+
+  let uploaded = false;
+  if (upload && import.meta.env.VITE_SENTRY_DSN) {
+    Sentry.withScope((scope) => {
+      scope.addAttachment({
+        filename: "benchmark.json",
+        data: json,
+        contentType: "application/json",
+      });
+      Sentry.captureMessage("Benchmark results", "info");
+    });
+    uploaded = true;
+  }
+  if (status) {
+    status.textContent = uploaded ? "Done (results uploaded)" : "Done";
+  }
+}
+
+const upload = new URLSearchParams(window.location.search).get("upload") === "1";
+if (upload && import.meta.env.VITE_SENTRY_DSN) {
+  initSentry();
+}
+
+const runButton = document.getElementById("run") as HTMLButtonElement | null;
+runButton?.addEventListener("click", async () => {
+  runButton.disabled = true;
+  try {
+    await run();
+  } finally {
+    runButton.disabled = false;
+  }
+});
@@ -11,6 +11,7 @@ import { savedGames } from "./store/saved-games.ts";
 import { settings } from "./store/settings.ts";
 import { cssNative, cssWATweaks } from "./utils/css.ts";
 import { ScrollAnimationController } from "./utils/scroll-animation-controller.ts";
+import { prerender } from "./utils/speculation.ts";
 
 // Register components
 import "@awesome.me/webawesome/dist/components/button/button.js";
@@ -41,7 +42,12 @@ export class HomeScreen extends SignalWatcher(Screen) {
         this.size === "large" ? this.renderWideHeader() : this.renderCompactHeader()
       }</header>
 
-      <div @favorite-change=${this.handleFavoriteChange}>
+      <div
+        @favorite-change=${this.handleFavoriteChange}
+        @pointerover=${this.handleCardIntent}
+        @pointerout=${this.cancelCardIntent}
+        @focusin=${this.handleCardIntent}
+      >
         ${settings.showIntro ? this.renderIntro() : nothing}
         ${this.renderFavorites()}
         ${this.renderCatalog()}
@@ -210,6 +216,32 @@ export class HomeScreen extends SignalWatcher(Screen) {
     settings.showIntro = !settings.showIntro;
   }
 
+  // Hovering over (or focusing) a puzzle's card for a moment prerenders
+  // its page, which loads the puzzle's worker and first game ahead of the
+  // click. (The delay avoids prerendering everything the pointer crosses.)
+  private static readonly intentDelay = 200; // ms
+  private intentTimer?: ReturnType<typeof setTimeout>;
+
+  private handleCardIntent(event: Event) {
+    const card = event
+      .composedPath()
+      .find(
+        (target): target is Element =>
+          target instanceof Element && target.localName === "catalog-card",
+      );
+    const href = card?.getAttribute("href");
+    if (href) {
+      this.cancelCardIntent();
+      const delay = event.type === "focusin" ? 0 : HomeScreen.intentDelay;
+      this.intentTimer = setTimeout(() => prerender(href), delay);
+    }
+  }
+
+  private cancelCardIntent() {
+    clearTimeout(this.intentTimer);
+    this.intentTimer = undefined;
+  }
+
   private handleFavoriteChange(event: FavoriteChangeEvent) {
     const { puzzleId, isFavorite } = event.detail;
     settings.setFavoritePuzzle(puzzleId, isFavorite);
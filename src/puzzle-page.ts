@@ -1,6 +1,10 @@
 import "./main.ts";
 
+import { puzzleMetadataMap } from "./puzzle/catalog.ts";
+import { Puzzle } from "./puzzle/puzzle.ts";
 import { navigateToHomePage, type PuzzleUrlParams, parsePuzzleUrl } from "./routing.ts";
+import { savedGames } from "./store/saved-games.ts";
+import { settings } from "./store/settings.ts";
 
 // Register components
 import "./puzzle-screen.ts";
@@ -32,11 +36,45 @@ function initialize({ puzzleId, puzzleParams, puzzleGameId }: PuzzleUrlParams) {
   appRoot.replaceChildren(puzzleScreen);
 }
 
+// While prerendered (speculatively, from the home page), get the puzzle's
+// worker and its first new game ready, but leave the rest until the page
+// is shown: the puzzle-screen would autosave a game the user never saw.
+async function prepareWhilePrerendering({
+  puzzleId,
+  puzzleParams,
+  puzzleGameId,
+}: PuzzleUrlParams) {
+  if (puzzleGameId) {
+    return;
+  }
+  // (Chosen as the puzzle-screen will: see handlePuzzleLoaded)
+  const params =
+    puzzleParams ??
+    (await settings.getParams(puzzleId)) ??
+    puzzleMetadataMap[puzzleId]?.defaultParams;
+  const restoring =
+    !puzzleParams && (await savedGames.findMostRecentAutoSave(puzzleId));
+  Puzzle.prewarm(puzzleId, restoring ? undefined : params);
+}
+
+const isPrerendering = () =>
+  (document as Document & { prerendering?: boolean }).prerendering === true;
+
 const urlParams = parsePuzzleUrl();
 if (!urlParams?.puzzleId) {
   navigateToHomePage();
-} else if (document.readyState === "loading") {
-  document.addEventListener("DOMContentLoaded", () => initialize(urlParams));
+} else if (isPrerendering()) {
+  Puzzle.prewarm(urlParams.puzzleId); // (without waiting for settings)
+  void prepareWhilePrerendering(urlParams);
+  document.addEventListener("prerenderingchange", () => initialize(urlParams), {
+    once: true,
+  });
 } else {
-  initialize(urlParams);
+  // Start the worker now, rather than when the puzzle-screen gets to it.
+  Puzzle.prewarm(urlParams.puzzleId);
+  if (document.readyState === "loading") {
+    document.addEventListener("DOMContentLoaded", () => initialize(urlParams));
+  } else {
+    initialize(urlParams);
+  }
 }
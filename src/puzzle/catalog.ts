@@ -1,4 +1,6 @@
 import { puzzles } from "../assets/puzzles/catalog.json";
+import metadata from "../assets/puzzles/puzzle-metadata.json";
+import type { ConfigDescription, PresetMenuEntry } from "./types.ts";
 
 export { puzzleIds, version } from "../assets/puzzles/catalog.json";
 
@@ -15,3 +17,34 @@ export interface PuzzleData {
 }
 
 export const puzzleDataMap: Readonly<PuzzleDataMap> = puzzles;
+
+/**
+ * Static attributes of each puzzle, precomputed by puzzles/puzzlemeta.c
+ * at build time, so they're available without loading the puzzle's wasm.
+ * (Matches what the puzzle's Frontend would report for them.)
+ */
+export interface PuzzleMetadata {
+  name: string; // (the midend's name, which may differ from PuzzleData's)
+  canConfigure: boolean;
+  canSolve: boolean;
+  canHint: boolean;
+  canFormatAsTextEver: boolean;
+  canPrint: boolean;
+  canPrintInColour: boolean;
+  wantsStatusbar: boolean;
+  isTimed: boolean;
+  needsRightButton: boolean;
+  flags: number;
+  preferredTilesize: number;
+  defaultParams: string;
+  presets: PresetMenuEntry[];
+  customParamsConfig: ConfigDescription;
+  preferencesConfig: ConfigDescription;
+}
+
+export interface PuzzleMetadataMap {
+  [id: string]: PuzzleMetadata;
+}
+
+// (The JSON's config item types are plain strings to TypeScript.)
+export const puzzleMetadataMap = metadata as unknown as Readonly<PuzzleMetadataMap>;
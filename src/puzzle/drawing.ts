@@ -1,7 +1,6 @@
 import type {
   Drawing as DrawingHandle,
   DrawingImpl,
-  DrawTextOptions,
   FontInfo,
   Point,
   PuzzleModule,
@@ -17,32 +16,234 @@ export const defaultFontInfo: FontInfo = {
   fontStyle: "normal",
 } as const;
 
+export interface DrawTextOptions {
+  align: "left" | "center" | "right";
+  baseline: "alphabetic" | "mathematical";
+  fontType: "fixed" | "variable";
+  size: number;
+}
+
+// Opcodes in the draw command stream from webapp.cpp.
+// (Must match DrawCommand in puzzles/webapp.cpp.)
+export const DrawCommand = {
+  TEXT: 1,
+  RECT: 2, // (printing only: the canvas gets RECTS)
+  LINE: 3, // (printing only: the canvas gets LINES)
+  POLYGON: 4,
+  CIRCLE: 5,
+  // (6 was UPDATE, now delivered to endDraw)
+  CLIP: 7,
+  UNCLIP: 8,
+  // Printing only (see printing.ts)
+  BEGIN_PUZZLE: 9,
+  END_PUZZLE: 10,
+  LINE_WIDTH: 11,
+  LINE_DOTTED: 12,
+  // Runs of same-colour rects and lines
+  RECTS: 13,
+  LINES: 14,
+  // Sprites (canvas only)
+  SPRITE_BEGIN: 15,
+  SPRITE_END: 16,
+  SPRITE_DRAW: 17,
+  SPRITE_FREE: 18,
+} as const;
+
+// Decoding for DrawCommand.TEXT operands (TextHAlign, TextVAlign, TextFontType)
+export const textAligns = ["left", "center", "right"] as const;
+export const textBaselines = ["alphabetic", "mathematical"] as const;
+export const textFontTypes = ["fixed", "variable"] as const;
+
+export const textDecoder = new TextDecoder();
+
 interface Blitter {
   w: number;
   h: number;
-  imageData?: ImageData;
+  // Saved pixels, at device resolution (allocated by the first save)
+  canvas?: OffscreenCanvas;
   $type: "blitter";
 }
 
+// Freed blitter canvases kept for reuse, per device pixel size
+const maxPooledBlitterCanvases = 4;
+
+interface Sprite {
+  w: number;
+  h: number;
+  // Rendered contents, at device resolution dpr
+  canvas: OffscreenCanvas;
+  context: OffscreenCanvasRenderingContext2D;
+  dpr: number;
+  // Its SPRITE_BEGIN..SPRITE_END commands, to re-render at a new dpr
+  commands?: Int32Array;
+}
+
+// A text run rendered in a TextAtlas, in device pixels. (dx, dy) is the
+// offset of the atlas rect's top left from the run's (whole pixel) origin.
+interface TextRun {
+  sx: number;
+  sy: number;
+  sw: number;
+  sh: number;
+  dx: number;
+  dy: number;
+}
+
 /**
- * Drawing class for canvas-based rendering
+ * Cache of rendered text runs, packed in rows ("shelves") on one canvas.
+ * Shaping and rasterising text is the most expensive part of drawing the
+ * number-heavy puzzles, which draw the same few strings over and over;
+ * copying them from here with drawImage is much cheaper than fillText.
+ *
+ * When the atlas fills up it is simply emptied and refilled.
+ */
+class TextAtlas {
+  static readonly size = 1024; // device pixels square
+  private static readonly padding = 1; // for antialiasing
+
+  private readonly canvas = new OffscreenCanvas(TextAtlas.size, TextAtlas.size);
+  private readonly context: OffscreenCanvasRenderingContext2D;
+  private readonly runs = new Map<string, TextRun>();
+  private shelfX = 0;
+  private shelfY = 0;
+  private shelfH = 0;
+
+  constructor() {
+    const context = this.canvas.getContext("2d");
+    if (!context) {
+      throw new Error("Failed to get text atlas 2d context");
+    }
+    this.context = context;
+  }
+
+  clear(): void {
+    this.runs.clear();
+    this.shelfX = this.shelfY = this.shelfH = 0;
+    this.context.clearRect(0, 0, TextAtlas.size, TextAtlas.size);
+  }
+
+  /**
+   * Draw text with its alphabetic baseline origin at device pixel (x, y)
+   * on context, whose transform must be the identity. font must be in
+   * device pixels. Returns false (having drawn nothing) if the run is
+   * too big to cache.
+   */
+  draw(
+    context: OffscreenCanvasRenderingContext2D,
+    x: number,
+    y: number,
+    font: string,
+    align: CanvasTextAlign,
+    fillStyle: string,
+    text: string,
+  ): boolean {
+    // Runs are positioned to whole device pixels, with any fraction
+    // rendered into the atlas (and so part of the key).
+    const [ix, iy] = [Math.floor(x), Math.floor(y)];
+    const key = `${font}\n${align}\n${fillStyle}\n${x - ix}\n${y - iy}\n${text}`;
+    let run = this.runs.get(key);
+    if (!run) {
+      run = this.render(font, align, fillStyle, x - ix, y - iy, text);
+      if (!run) {
+        return false;
+      }
+      this.runs.set(key, run);
+    }
+    const { sx, sy, sw, sh, dx, dy } = run;
+    context.drawImage(this.canvas, sx, sy, sw, sh, ix + dx, iy + dy, sw, sh);
+    return true;
+  }
+
+  private render(
+    font: string,
+    align: CanvasTextAlign,
+    fillStyle: string,
+    fx: number,
+    fy: number,
+    text: string,
+  ): TextRun | undefined {
+    const { context } = this;
+    const pad = TextAtlas.padding;
+    context.font = font;
+    context.textAlign = align;
+    context.textBaseline = "alphabetic";
+    const metrics = context.measureText(text);
+    const left = Math.ceil(metrics.actualBoundingBoxLeft - fx) + pad;
+    const right = Math.ceil(metrics.actualBoundingBoxRight + fx) + pad;
+    const ascent = Math.ceil(metrics.actualBoundingBoxAscent - fy) + pad;
+    const descent = Math.ceil(metrics.actualBoundingBoxDescent + fy) + pad;
+    const sw = Math.max(1, left + right);
+    const sh = Math.max(1, ascent + descent);
+    if (sw > TextAtlas.size || sh > TextAtlas.size) {
+      return undefined;
+    }
+
+    if (this.shelfX + sw > TextAtlas.size) {
+      this.shelfX = 0;
+      this.shelfY += this.shelfH;
+      this.shelfH = 0;
+    }
+    if (this.shelfY + sh > TextAtlas.size) {
+      this.clear();
+      context.font = font;
+      context.textAlign = align;
+      context.textBaseline = "alphabetic";
+    }
+    const [sx, sy] = [this.shelfX, this.shelfY];
+    this.shelfX += sw;
+    this.shelfH = Math.max(this.shelfH, sh);
+
+    context.fillStyle = fillStyle;
+    context.fillText(text, sx + left + fx, sy + ascent + fy);
+    return { sx, sy, sw, sh, dx: -left, dy: -ascent };
+  }
+}
+
+/**
+ * Drawing class for canvas-based rendering.
+ *
+ * All drawing happens on a private back buffer. At the end of each frame,
+ * only the areas the puzzle reported changed (via draw_update) are copied
+ * to the canvas, so a frame that changes a few tiles of a large puzzle
+ * doesn't cost a full-canvas update.
  */
 export class Drawing implements DrawingImpl<Blitter> {
   private readonly canvas: OffscreenCanvas;
+  private readonly presentContext: OffscreenCanvasRenderingContext2D;
+  private readonly backCanvas: OffscreenCanvas;
+  private readonly backContext: OffscreenCanvasRenderingContext2D;
+  // Where drawing goes: backContext, or currentSprite's context
   private context: OffscreenCanvasRenderingContext2D;
+  private currentSprite?: Sprite;
+  private presentAll = true; // next endDraw must copy the whole back buffer
   private palette: string[] = [];
   private fontInfo: FontInfo;
   private dpr = 1; // devicePixelRatio of the canvas
+  private blitterPool = new Map<string, OffscreenCanvas[]>();
+  private sprites = new Map<number, Sprite>();
+  private textAtlas = new TextAtlas();
+
+  // Context state last set by setUpContext and drawText. Canvas state
+  // changes are expensive, so they're only made when these differ.
+  // (undefined: unknown, so must be set before next use.)
+  private fillColour?: number;
+  private strokeColour?: number;
+  private lineWidth?: number;
+  private font?: string;
+  private textAlign?: CanvasTextAlign;
+  private textBaseline?: CanvasTextBaseline;
 
   /**
    * Create a new Drawing instance
    */
   constructor(canvas: OffscreenCanvas, fontInfo?: FontInfo) {
     this.canvas = canvas;
+    this.backCanvas = new OffscreenCanvas(canvas.width, canvas.height);
     this.fontInfo = fontInfo ?? defaultFontInfo;
 
-    // Get context
-    const context = this.canvas.getContext("2d", {
+    // Get contexts
+    const presentContext = this.canvas.getContext("2d", { alpha: false });
+    const context = this.backCanvas.getContext("2d", {
       alpha: false,
       // willReadFrequently causes lost context when used with
       // OffscreenCanvas transferred to worker in Android Chrome:
@@ -50,10 +251,12 @@ export class Drawing implements DrawingImpl<Blitter> {
       // (Otherwise it would be helpful for blitter use.)
       //   willReadFrequently: true,
     });
-    if (!context) {
+    if (!presentContext || !context) {
       throw new Error("Failed to get canvas 2d context");
     }
-    this.context = context;
+    this.presentContext = presentContext;
+    this.backContext = this.context = context;
+    this.resetContextState();
   }
 
   bind(module: PuzzleModule): DrawingHandle {
@@ -69,6 +272,8 @@ export class Drawing implements DrawingImpl<Blitter> {
   setPalette(colors: string[]): boolean {
     const hadPalette = this.palette.length > 0;
     this.palette = colors;
+    this.fillColour = this.strokeColour = undefined;
+    this.textAtlas.clear();
     return hadPalette;
   }
 
@@ -80,6 +285,7 @@ export class Drawing implements DrawingImpl<Blitter> {
   public setFontInfo(fontInfo: FontInfo): boolean {
     const hadCustomFont = this.fontInfo !== defaultFontInfo;
     this.fontInfo = { ...fontInfo };
+    this.textAtlas.clear();
     return hadCustomFont;
   }
 
@@ -96,9 +302,24 @@ export class Drawing implements DrawingImpl<Blitter> {
     // will anti-alias the integral offscreen original.)
     const effectiveDpr = Math.ceil(dpr);
     this.dpr = effectiveDpr;
-    this.canvas.width = w * effectiveDpr;
-    this.canvas.height = h * effectiveDpr;
-    this.context.scale(effectiveDpr, effectiveDpr);
+    this.canvas.width = this.backCanvas.width = w * effectiveDpr;
+    this.canvas.height = this.backCanvas.height = h * effectiveDpr;
+    this.backContext.scale(effectiveDpr, effectiveDpr);
+    // Resizing cleared both canvases, and reset the context state
+    this.presentAll = true;
+    this.resetContextState();
+    // Pooled blitter canvases and cached text are likely the wrong size
+    this.blitterPool.clear();
+    this.textAtlas.clear();
+    // (Sprites are re-rendered when next drawn, if the dpr changed.)
+  }
+
+  /**
+   * Make the next frame copy the entire back buffer to the canvas,
+   * regardless of what changed.
+   */
+  public invalidate(): void {
+    this.presentAll = true;
   }
 
   /**
@@ -108,13 +329,122 @@ export class Drawing implements DrawingImpl<Blitter> {
    * the result will be type image/png.
    */
   public async getImage(options?: ImageEncodeOptions): Promise<Blob> {
-    return this.canvas.convertToBlob(options);
+    return this.backCanvas.convertToBlob(options);
   }
 
   /*
    * DrawingImpl
    */
 
+  /**
+   * Execute a batch of drawing commands encoded by webapp.cpp's
+   * DrawCommandBuffer. The commands array is a view onto wasm memory,
+   * so it must be fully consumed before returning.
+   */
+  drawCommands(commands: Int32Array): void {
+    const words = commands;
+    const floats = new Float32Array(words.buffer, words.byteOffset, words.length);
+    const end = words.length;
+    let i = 0;
+    let spriteStart = -1; // index of the current SPRITE_BEGIN
+    while (i < end) {
+      const command = words[i++];
+      switch (command) {
+        case DrawCommand.TEXT: {
+          const x = words[i];
+          const y = words[i + 1];
+          const fontType = textFontTypes[words[i + 2]];
+          const size = words[i + 3];
+          const align = textAligns[words[i + 4]];
+          const baseline = textBaselines[words[i + 5]];
+          const colour = words[i + 6];
+          const nbytes = words[i + 7];
+          i += 8;
+          // (TextDecoder won't decode from shared memory, so copy with slice.)
+          const text = textDecoder.decode(
+            new Uint8Array(words.buffer, words.byteOffset + i * 4, nbytes).slice(),
+          );
+          i += (nbytes + 3) >> 2;
+          this.drawText({ x, y }, { align, baseline, fontType, size }, colour, text);
+          break;
+        }
+        case DrawCommand.RECTS: {
+          const colour = words[i];
+          const count = words[i + 1];
+          i += 2;
+          this.drawRects(words.subarray(i, i + 4 * count), colour);
+          i += 4 * count;
+          break;
+        }
+        case DrawCommand.LINES: {
+          const colour = words[i];
+          const thickness = floats[i + 1];
+          const count = words[i + 2];
+          i += 3;
+          this.drawLines(floats.subarray(i, i + 4 * count), colour, thickness);
+          i += 4 * count;
+          break;
+        }
+        case DrawCommand.POLYGON: {
+          const npoints = words[i];
+          const fillcolour = words[i + 1];
+          const outlinecolour = words[i + 2];
+          i += 3;
+          const coords: Point[] = new Array(npoints);
+          for (let p = 0; p < npoints; p++, i += 2) {
+            coords[p] = { x: words[i], y: words[i + 1] };
+          }
+          this.drawPolygon(coords, fillcolour, outlinecolour);
+          break;
+        }
+        case DrawCommand.CIRCLE:
+          this.drawCircle(
+            { x: words[i], y: words[i + 1] },
+            words[i + 2],
+            words[i + 3],
+            words[i + 4],
+          );
+          i += 5;
+          break;
+        case DrawCommand.CLIP:
+          this.clip({
+            x: words[i],
+            y: words[i + 1],
+            w: words[i + 2],
+            h: words[i + 3],
+          });
+          i += 4;
+          break;
+        case DrawCommand.UNCLIP:
+          this.unclip();
+          break;
+        case DrawCommand.SPRITE_BEGIN:
+          spriteStart = i - 1;
+          this.spriteBegin(words[i], words[i + 1], words[i + 2]);
+          i += 3;
+          break;
+        case DrawCommand.SPRITE_END:
+          if (spriteStart < 0) {
+            throw new Error(`SPRITE_END without SPRITE_BEGIN at ${i - 1}`);
+          }
+          // (webapp.cpp delivers a sprite's commands in a single batch.)
+          this.spriteEnd(words.slice(spriteStart, i));
+          spriteStart = -1;
+          break;
+        case DrawCommand.SPRITE_DRAW:
+          this.spriteDraw(words[i], words[i + 1], words[i + 2], floats[i + 3]);
+          i += 4;
+          break;
+        case DrawCommand.SPRITE_FREE:
+          this.sprites.delete(words[i]);
+          i += 1;
+          break;
+        default:
+          throw new Error(`Unknown draw command ${command} at ${i - 1}`);
+      }
+    }
+  }
+
   // cached text metrics
   private mathematicalBaselineOffset: { [font: string]: number } = {};
 
@@ -128,59 +458,114 @@ export class Drawing implements DrawingImpl<Blitter> {
       // console.warn(`Drawing.drawText ignoring size=${size}`);
       return;
     }
-    this.context.font = [
-      this.fontInfo.fontStyle,
-      this.fontInfo.fontWeight,
-      `${size}px`,
-      fontType === "variable" ? this.fontInfo.fontFamily : "monospace",
-    ].join(" ");
-    this.context.textAlign = align;
+    const fontFamily = fontType === "variable" ? this.fontInfo.fontFamily : "monospace";
+    const font = (pixels: number): string =>
+      [
+        this.fontInfo.fontStyle,
+        this.fontInfo.fontWeight,
+        `${pixels}px`,
+        fontFamily,
+      ].join(" ");
+    const cssFont = font(size);
     if (baseline === "mathematical") {
       // CanvasRenderingContext2D.textBaseline doesn't support "mathematical".
       // (And "middle" centers on em height--including descenders--which is not
       // what the puzzles want.) Approximate mathematical alignment by centering
       // digits. (Relies on TextMetrics.actual* props that landed ~2018-2020.)
-      this.context.textBaseline = "alphabetic";
-      let offset = this.mathematicalBaselineOffset[this.context.font];
+      let offset = this.mathematicalBaselineOffset[cssFont];
       if (offset === undefined) {
         // Measure digits only: puzzles tend to center digits or digits+lowercase,
         // not uppercase. (Compare js_canvas_find_font_midpoint in emcclib.js.)
+        this.setUpText(cssFont, align);
         const { actualBoundingBoxAscent, actualBoundingBoxDescent } =
           this.context.measureText("0123456789");
         offset = (actualBoundingBoxAscent + actualBoundingBoxDescent) / 2;
-        this.mathematicalBaselineOffset[this.context.font] = offset;
+        this.mathematicalBaselineOffset[cssFont] = offset;
       }
       y += offset;
-    } else {
-      this.context.textBaseline = baseline;
     }
-    this.setUpContext({ fillColor: colour });
-    this.context.fillText(text, x, y);
+
+    // Copy the run from the text atlas, in device pixels.
+    const fillStyle = this.palette[colour];
+    if (fillStyle === undefined) {
+      throw new Error(`fillColor ${colour} not in palette`);
+    }
+    const { dpr } = this;
+    this.context.setTransform(1, 0, 0, 1, 0, 0);
+    const drawn = this.textAtlas.draw(
+      this.context,
+      x * dpr,
+      y * dpr,
+      font(size * dpr),
+      align,
+      fillStyle,
+      text,
+    );
+    this.context.setTransform(dpr, 0, 0, dpr, 0, 0);
+    if (!drawn) {
+      this.setUpText(cssFont, align);
+      this.setUpContext({ fillColor: colour });
+      this.context.fillText(text, x, y);
+    }
   }
 
-  drawRect({ x, y, w, h }: Rect, colour: number): void {
-    if (w < 1 || h < 1) {
-      // console.warn(`Drawing.drawRect ignoring w=${w} h=${h}`);
+  private setUpText(font: string, align: CanvasTextAlign): void {
+    if (font !== this.font) {
+      this.context.font = this.font = font;
+    }
+    if (align !== this.textAlign) {
+      this.context.textAlign = this.textAlign = align;
+    }
+    if (this.textBaseline !== "alphabetic") {
+      this.context.textBaseline = this.textBaseline = "alphabetic";
+    }
+  }
+
+  /**
+   * Fill a run of same-colour rects (x, y, w, h in rects) as one path.
+   */
+  drawRects(rects: Int32Array, colour: number): void {
+    this.setUpContext({ fillColor: colour });
+    if (rects.length === 4) {
+      const [x, y, w, h] = rects;
+      if (w >= 1 && h >= 1) {
+        this.context.fillRect(x, y, w, h);
+      }
       return;
     }
-    this.setUpContext({ fillColor: colour, strokeColor: colour, lineWidth: 1 });
-    this.context.fillRect(x, y, w, h);
+    this.context.beginPath();
+    for (let i = 0; i < rects.length; i += 4) {
+      const [x, y, w, h] = rects.subarray(i, i + 4);
+      if (w >= 1 && h >= 1) {
+        this.context.rect(x, y, w, h);
+      }
+    }
+    this.context.fill();
   }
 
-  drawLine(p1: Point, p2: Point, colour: number, thickness: number): void {
+  /**
+   * Stroke a run of same-colour, same-thickness lines (x1, y1, x2, y2 in
+   * lines) as one path.
+   */
+  drawLines(lines: Float32Array, colour: number, thickness: number): void {
     if (thickness <= 0) {
-      // console.warn(`Drawing.drawLine ignoring thickness=${thickness}`);
+      // console.warn(`Drawing.drawLines ignoring thickness=${thickness}`);
       return;
     }
-    this.context.beginPath();
-    // Drawing API points are pixel center; canvas is pixel top left.
-    this.context.moveTo(p1.x + 0.5, p1.y + 0.5);
-    this.context.lineTo(p2.x + 0.5, p2.y + 0.5);
     this.setUpContext({ strokeColor: colour, fillColor: colour, lineWidth: thickness });
+    this.context.beginPath();
+    for (let i = 0; i < lines.length; i += 4) {
+      // Drawing API points are pixel center; canvas is pixel top left.
+      this.context.moveTo(lines[i] + 0.5, lines[i + 1] + 0.5);
+      this.context.lineTo(lines[i + 2] + 0.5, lines[i + 3] + 0.5);
+    }
     this.context.stroke();
-    // Draw the pixel at each end of the line (copied from emcclib.js).
-    this.context.fillRect(p1.x, p1.y, 1, 1);
-    this.context.fillRect(p2.x, p2.y, 1, 1);
+    // Draw the pixel at each end of each line (copied from emcclib.js).
+    this.context.beginPath();
+    for (let i = 0; i < lines.length; i += 2) {
+      this.context.rect(lines[i], lines[i + 1], 1, 1);
+    }
+    this.context.fill();
   }
 
   drawPolygon(coords: Point[], fillcolour: number, outlinecolour: number): void {
@@ -224,14 +609,30 @@ export class Drawing implements DrawingImpl<Blitter> {
     this.context.stroke();
   }
 
-  // Invalidation region management (startDraw/drawUpdate/endDraw):
-  // Because our offscreen canvas automatically syncs to the onscreen canvas,
-  // there's no need to keep track of the dirty region or notify about updates.
-  startDraw(): void {}
-
-  drawUpdate(_rect: Rect): void {}
-
-  endDraw(): void {}
+  /**
+   * Present a frame: copy the damaged areas of the back buffer to the canvas.
+   * damage is a list of x, y, w, h rects (merged by webapp.cpp's DamageRegion),
+   * and like drawCommands' commands is a view onto wasm memory.
+   */
+  endDraw(damage: Int32Array): void {
+    const { width, height } = this.canvas;
+    if (this.presentAll) {
+      this.presentAll = false;
+      this.presentContext.drawImage(this.backCanvas, 0, 0);
+      return;
+    }
+    for (let i = 0; i + 3 < damage.length; i += 4) {
+      // drawImage ignores the back context's transform: apply dpr scaling,
+      // and clamp to the canvas (puzzles may report updates that overhang it).
+      const x = Math.max(0, damage[i] * this.dpr);
+      const y = Math.max(0, damage[i + 1] * this.dpr);
+      const w = Math.min(width, (damage[i] + damage[i + 2]) * this.dpr) - x;
+      const h = Math.min(height, (damage[i + 1] + damage[i + 3]) * this.dpr) - y;
+      if (w > 0 && h > 0) {
+        this.presentContext.drawImage(this.backCanvas, x, y, w, h, x, y, w, h);
+      }
+    }
+  }
 
   clip({ x, y, w, h }: Rect): void {
     this.context.save();
@@ -246,6 +647,8 @@ export class Drawing implements DrawingImpl<Blitter> {
 
   unclip(): void {
     this.context.restore();
+    // (Which undid any state changes since clip.)
+    this.resetContextState();
   }
 
   blitterNew({ w, h }: Size): Blitter {
@@ -253,9 +656,22 @@ export class Drawing implements DrawingImpl<Blitter> {
   }
 
   blitterFree(blitter: Blitter): void {
-    blitter.imageData = undefined;
+    const canvas = blitter.canvas;
+    blitter.canvas = undefined;
+    if (canvas) {
+      const key = `${canvas.width}x${canvas.height}`;
+      const pool = this.blitterPool.get(key) ?? [];
+      if (pool.length < maxPooledBlitterCanvases) {
+        pool.push(canvas);
+        this.blitterPool.set(key, pool);
+      }
+    }
   }
 
+  // Blitters copy pixels with drawImage between canvases, rather than
+  // getImageData/putImageData, so the pixels never leave the GPU.
+  // (A readback per drag frame is slow, particularly at high dpr.)
+
   blitterSave(blitter: Blitter, { x, y }: Point): void {
     const { w, h } = blitter;
     if (w < 1 || h < 1) {
@@ -263,13 +679,23 @@ export class Drawing implements DrawingImpl<Blitter> {
       return;
     }
 
-    // getImageData ignores the transformation matrix, so must apply dpr scaling.
-    blitter.imageData = this.context.getImageData(
-      x * this.dpr,
-      y * this.dpr,
-      w * this.dpr,
-      h * this.dpr,
-    );
+    // Copy in device pixels (the back buffer's transform is dpr scaling).
+    const dw = w * this.dpr;
+    const dh = h * this.dpr;
+    if (blitter.canvas?.width !== dw || blitter.canvas.height !== dh) {
+      this.blitterFree(blitter);
+      blitter.canvas =
+        this.blitterPool.get(`${dw}x${dh}`)?.pop() ?? new OffscreenCanvas(dw, dh);
+    }
+    const context = blitter.canvas.getContext("2d");
+    if (!context) {
+      throw new Error("Failed to get blitter 2d context");
+    }
+    // Parts of the area outside the back buffer are saved as transparent,
+    // and so leave the canvas unchanged when loaded.
+    context.clearRect(0, 0, dw, dh);
+    const [sx, sy] = [x * this.dpr, y * this.dpr];
+    context.drawImage(this.backCanvas, sx, sy, dw, dh, 0, 0, dw, dh);
   }
 
   blitterLoad(blitter: Blitter, { x, y }: Point): void {
@@ -278,16 +704,99 @@ export class Drawing implements DrawingImpl<Blitter> {
       // console.warn(`Drawing.blitterLoad ignoring w=${w} h=${h}`);
       return;
     }
-    if (!blitter.imageData) {
+    if (!blitter.canvas) {
       throw new Error("Blitter loaded before saved");
     }
-    this.context.putImageData(blitter.imageData, x * this.dpr, y * this.dpr);
+    this.context.save();
+    this.context.setTransform(1, 0, 0, 1, 0, 0);
+    this.context.drawImage(blitter.canvas, x * this.dpr, y * this.dpr);
+    this.context.restore();
+  }
+
+  // Sprites are drawn once into their own canvas, then copied (possibly
+  // rotated) to the back buffer with drawImage. Drawing commands between
+  // SPRITE_BEGIN and SPRITE_END go to the sprite, in sprite coordinates.
+
+  private spriteBegin(id: number, w: number, h: number): void {
+    const { dpr } = this;
+    const [dw, dh] = [Math.max(1, w * dpr), Math.max(1, h * dpr)];
+    let sprite = this.sprites.get(id);
+    if (!sprite) {
+      const canvas = new OffscreenCanvas(dw, dh);
+      const context = canvas.getContext("2d");
+      if (!context) {
+        throw new Error("Failed to get sprite 2d context");
+      }
+      sprite = { w, h, canvas, context, dpr };
+      this.sprites.set(id, sprite);
+    } else if (sprite.canvas.width !== dw || sprite.canvas.height !== dh) {
+      // (Which clears it and resets the context state.)
+      sprite.canvas.width = dw;
+      sprite.canvas.height = dh;
+    } else {
+      sprite.context.setTransform(1, 0, 0, 1, 0, 0);
+      sprite.context.clearRect(0, 0, dw, dh);
+    }
+    Object.assign(sprite, { w, h, dpr, commands: undefined });
+    sprite.context.setTransform(dpr, 0, 0, dpr, 0, 0);
+    this.currentSprite = sprite;
+    this.context = sprite.context;
+    this.resetContextState();
+  }
+
+  private spriteEnd(commands: Int32Array): void {
+    if (this.currentSprite) {
+      this.currentSprite.commands = commands;
+      this.currentSprite = undefined;
+    }
+    this.context = this.backContext;
+    this.resetContextState();
+  }
+
+  /**
+   * Draw a sprite with its top left at (x, y), rotated angle degrees
+   * anticlockwise about its centre.
+   */
+  private spriteDraw(id: number, x: number, y: number, angle: number): void {
+    const sprite = this.sprites.get(id);
+    if (!sprite) {
+      throw new Error(`Sprite ${id} drawn before rendered`);
+    }
+    if (sprite.dpr !== this.dpr && sprite.commands) {
+      this.drawCommands(sprite.commands);
+    }
+    const { w, h, canvas } = sprite;
+    if (angle === 0) {
+      this.context.drawImage(canvas, x, y, w, h);
+      return;
+    }
+    this.context.save();
+    this.context.translate(x + w / 2, y + h / 2);
+    this.context.rotate((-angle * Math.PI) / 180);
+    this.context.drawImage(canvas, -w / 2, -h / 2, w, h);
+    this.context.restore();
+  }
+
+  /**
+   * Set the context state that never changes, and forget what
+   * setUpContext and drawText last set.
+   */
+  private resetContextState(): void {
+    this.context.lineCap = "round";
+    this.context.lineJoin = "round";
+    this.fillColour = undefined;
+    this.strokeColour = undefined;
+    this.lineWidth = undefined;
+    this.font = undefined;
+    this.textAlign = undefined;
+    this.textBaseline = undefined;
   }
 
   /**
    * Set up the drawing context for filling/stroking paths.
    * lineWidth defaults to 1 (the puzzle drawing_api standard width).
-   * If fillColor is not provided, fillStyle will not be changed.
+   * If fillColor is not provided, fillStyle will not be changed
+   * (and likewise strokeColor and strokeStyle).
    */
   private setUpContext({
     strokeColor,
@@ -298,22 +807,27 @@ export class Drawing implements DrawingImpl<Blitter> {
     fillColor?: number;
     lineWidth?: number;
   }): void {
-    this.context.lineWidth = lineWidth ?? 1;
-    this.context.lineCap = "round";
-    this.context.lineJoin = "round";
     if (strokeColor !== undefined) {
-      const strokeStyle = this.palette[strokeColor];
-      if (strokeStyle === undefined) {
-        throw new Error(`strokeColor ${strokeColor} not in palette`);
+      const width = lineWidth ?? 1;
+      if (width !== this.lineWidth) {
+        this.context.lineWidth = this.lineWidth = width;
+      }
+      if (strokeColor !== this.strokeColour) {
+        const strokeStyle = this.palette[strokeColor];
+        if (strokeStyle === undefined) {
+          throw new Error(`strokeColor ${strokeColor} not in palette`);
+        }
+        this.context.strokeStyle = strokeStyle;
+        this.strokeColour = strokeColor;
       }
-      this.context.strokeStyle = strokeStyle;
     }
-    if (fillColor !== undefined) {
+    if (fillColor !== undefined && fillColor !== this.fillColour) {
       const fillStyle = this.palette[fillColor];
       if (fillStyle === undefined) {
         throw new Error(`fillColor ${fillColor} not in palette`);
       }
       this.context.fillStyle = fillStyle;
+      this.fillColour = fillColor;
     }
   }
 }
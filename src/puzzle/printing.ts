@@ -0,0 +1,266 @@
+import {
+  DrawCommand,
+  defaultFontInfo,
+  textAligns,
+  textBaselines,
+  textDecoder,
+  textFontTypes,
+} from "./drawing.ts";
+import type {
+  FontInfo,
+  PrintSink as PrintSinkHandle,
+  PrintSinkImpl,
+  PuzzleModule,
+} from "./types.ts";
+
+/**
+ * Paper size in millimetres
+ */
+export interface PaperSize {
+  w: number;
+  h: number;
+}
+
+export const a4Paper: PaperSize = { w: 210, h: 297 } as const;
+
+// Hatch patterns (HATCH_* in puzzles/puzzles.h)
+const HATCH_SLASH = 1;
+const HATCH_BACKSLASH = 2;
+const HATCH_HORIZ = 3;
+const HATCH_VERT = 4;
+const HATCH_PLUS = 5;
+const HATCH_X = 6;
+
+// Hatching is drawn 1mm apart, 0.2mm thick (as in puzzles/ps.c)
+const hatchSpaceMm = 1;
+const hatchThickMm = 0.2;
+
+const fmt = (n: number): string => String(Math.round(n * 1000) / 1000);
+
+const escapeXml = (text: string): string =>
+  text.replace(
+    /[<>&"]/g,
+    (c) => ({ "<": "&lt;", ">": "&gt;", "&": "&amp;", '"': "&quot;" })[c] ?? c,
+  );
+
+/**
+ * PrintSink that renders each page from Frontend.print as a
+ * standalone SVG document, sized in millimetres for the given paper.
+ * (The browser can print these, or save them as PDF.)
+ *
+ * Each page's commands are decoded as they arrive (they're a view onto
+ * wasm memory), so the pages accumulate as SVG strings in `pages`.
+ */
+export class SvgPrinter implements PrintSinkImpl {
+  readonly pages: string[] = [];
+  private readonly paper: PaperSize;
+  private readonly fontInfo: FontInfo;
+  private nextId = 0;
+
+  constructor(paper: PaperSize = a4Paper, fontInfo: FontInfo = defaultFontInfo) {
+    this.paper = paper;
+    this.fontInfo = fontInfo;
+  }
+
+  bind(module: PuzzleModule): PrintSinkHandle {
+    return module.PrintSink.implement(this);
+  }
+
+  /*
+   * PrintSinkImpl
+   */
+
+  page(_number: number, commands: Int32Array, colours: Float32Array): void {
+    const words = commands;
+    const floats = new Float32Array(words.buffer, words.byteOffset, words.length);
+    const { w: paperW, h: paperH } = this.paper;
+    const out: string[] = [
+      `<svg xmlns="http://www.w3.org/2000/svg" width="${paperW}mm" height="${paperH}mm"`,
+      ` viewBox="0 0 ${paperW} ${paperH}">`,
+    ];
+
+    // Per-puzzle state
+    let puzzleId = "";
+    let unitsPerMm = 1;
+    let lineWidth = 1;
+    let dotted = false;
+    let clipDepth = 0;
+    const hatches = new Set<number>();
+
+    const colour = (index: number): string => {
+      const hatch = colours[index * 4];
+      if (hatch >= 0) {
+        if (!hatches.has(hatch)) {
+          hatches.add(hatch);
+          out.push(this.hatchPattern(`${puzzleId}h${hatch}`, hatch, unitsPerMm));
+        }
+        return `url(#${puzzleId}h${hatch})`;
+      }
+      const [r, g, b] = [1, 2, 3].map((i) =>
+        Math.round(Math.min(Math.max(colours[index * 4 + i], 0), 1) * 255),
+      );
+      return `rgb(${r},${g},${b})`;
+    };
+    const stroke = (index: number): string =>
+      ` fill="none" stroke="${colour(index)}" stroke-width="${fmt(lineWidth)}"` +
+      (dotted ? ` stroke-dasharray="${fmt(lineWidth * 3)}"` : "");
+    const closeClip = () => {
+      for (; clipDepth > 0; clipDepth--) out.push("</g>");
+    };
+
+    const end = words.length;
+    let i = 0;
+    while (i < end) {
+      const command = words[i++];
+      switch (command) {
+        case DrawCommand.BEGIN_PUZZLE: {
+          const [xm, xc, ym, yc] = [floats[i], floats[i + 1], floats[i + 2], floats[i + 3]];
+          const pw = words[i + 4];
+          const wmm = floats[i + 6];
+          i += 7;
+          puzzleId = `p${this.nextId++}`;
+          unitsPerMm = pw / wmm;
+          lineWidth = 1;
+          dotted = false;
+          hatches.clear();
+          const x = xm * paperW + xc;
+          const y = ym * paperH + yc;
+          out.push(`<g transform="translate(${fmt(x)} ${fmt(y)}) scale(${fmt(wmm / pw)})">`);
+          break;
+        }
+        case DrawCommand.END_PUZZLE:
+          closeClip();
+          out.push("</g>");
+          break;
+        case DrawCommand.LINE_WIDTH:
+          lineWidth = floats[i++];
+          break;
+        case DrawCommand.LINE_DOTTED:
+          dotted = words[i++] !== 0;
+          break;
+        case DrawCommand.TEXT: {
+          const x = words[i];
+          const y = words[i + 1];
+          const fontType = textFontTypes[words[i + 2]];
+          const size = words[i + 3];
+          const align = textAligns[words[i + 4]];
+          const baseline = textBaselines[words[i + 5]];
+          const fill = colour(words[i + 6]);
+          const nbytes = words[i + 7];
+          i += 8;
+          // (TextDecoder won't decode from shared memory, so copy with slice.)
+          const text = textDecoder.decode(
+            new Uint8Array(words.buffer, words.byteOffset + i * 4, nbytes).slice(),
+          );
+          i += (nbytes + 3) >> 2;
+          const family = fontType === "variable" ? this.fontInfo.fontFamily : "monospace";
+          const anchor = { left: "start", center: "middle", right: "end" }[align];
+          out.push(
+            `<text x="${x}" y="${y}" font-family="${escapeXml(family)}"` +
+              ` font-size="${size}" text-anchor="${anchor}"` +
+              (baseline === "mathematical" ? ` dominant-baseline="central"` : "") +
+              ` fill="${fill}">${escapeXml(text)}</text>`,
+          );
+          break;
+        }
+        case DrawCommand.RECT:
+          // Offset by half a unit, as for the canvas (pixel centres).
+          out.push(
+            `<rect x="${words[i] - 0.5}" y="${words[i + 1] - 0.5}"` +
+              ` width="${words[i + 2]}" height="${words[i + 3]}"` +
+              ` fill="${colour(words[i + 4])}"/>`,
+          );
+          i += 5;
+          break;
+        case DrawCommand.LINE: {
+          const saved = lineWidth;
+          lineWidth = floats[i + 5];
+          out.push(
+            `<line x1="${fmt(floats[i])}" y1="${fmt(floats[i + 1])}"` +
+              ` x2="${fmt(floats[i + 2])}" y2="${fmt(floats[i + 3])}"` +
+              `${stroke(words[i + 4])}/>`,
+          );
+          lineWidth = saved;
+          i += 6;
+          break;
+        }
+        case DrawCommand.POLYGON: {
+          const npoints = words[i];
+          const fillcolour = words[i + 1];
+          const outlinecolour = words[i + 2];
+          i += 3;
+          const points = Array.from(words.subarray(i, i + 2 * npoints)).join(" ");
+          i += 2 * npoints;
+          if (fillcolour >= 0) {
+            out.push(`<polygon points="${points}" fill="${colour(fillcolour)}"/>`);
+          }
+          out.push(`<polygon points="${points}"${stroke(outlinecolour)}/>`);
+          break;
+        }
+        case DrawCommand.CIRCLE: {
+          const [cx, cy, r, fillcolour, outlinecolour] = words.subarray(i, i + 5);
+          i += 5;
+          const circle = `<circle cx="${cx}" cy="${cy}" r="${r}"`;
+          if (fillcolour >= 0) {
+            out.push(`${circle} fill="${colour(fillcolour)}"/>`);
+          }
+          out.push(`${circle}${stroke(outlinecolour)}/>`);
+          break;
+        }
+        case DrawCommand.CLIP: {
+          // A new clip replaces any previous one (as in puzzles/ps.c).
+          closeClip();
+          const clipId = `${puzzleId}c${this.nextId++}`;
+          out.push(
+            `<clipPath id="${clipId}"><rect x="${words[i] - 0.5}" y="${words[i + 1] - 0.5}"` +
+              ` width="${words[i + 2]}" height="${words[i + 3]}"/></clipPath>`,
+            `<g clip-path="url(#${clipId})">`,
+          );
+          clipDepth++;
+          i += 4;
+          break;
+        }
+        case DrawCommand.UNCLIP:
+          closeClip();
+          break;
+        default:
+          throw new Error(`Unknown print command ${command} at ${i - 1}`);
+      }
+    }
+
+    out.push("</svg>");
+    this.pages.push(out.join("\n"));
+  }
+
+  /**
+   * An SVG pattern for one of the HATCH_* fills, in the units of the
+   * puzzle being drawn (of which there are unitsPerMm to the millimetre).
+   */
+  private hatchPattern(id: string, hatch: number, unitsPerMm: number): string {
+    const s = hatchSpaceMm * unitsPerMm;
+    const t = fmt(hatchThickMm * unitsPerMm);
+    const lines: string[] = [];
+    if (hatch === HATCH_VERT || hatch === HATCH_PLUS) {
+      lines.push(`M0 0V${fmt(s)}`);
+    }
+    if (hatch === HATCH_HORIZ || hatch === HATCH_PLUS) {
+      lines.push(`M0 0H${fmt(s)}`);
+    }
+    // Diagonals are spaced s apart perpendicular to the lines.
+    const d = s * Math.SQRT2;
+    if (hatch === HATCH_SLASH || hatch === HATCH_X) {
+      lines.push(`M0 ${fmt(d)}L${fmt(d)} 0`);
+    }
+    if (hatch === HATCH_BACKSLASH || hatch === HATCH_X) {
+      lines.push(`M0 0L${fmt(d)} ${fmt(d)}`);
+    }
+    const size = hatch === HATCH_SLASH || hatch === HATCH_BACKSLASH || hatch === HATCH_X
+      ? fmt(d)
+      : fmt(s);
+    return (
+      `<pattern id="${id}" patternUnits="userSpaceOnUse" width="${size}" height="${size}">` +
+      `<path d="${lines.join("")}" stroke="black" stroke-width="${t}" stroke-linecap="square"/>` +
+      "</pattern>"
+    );
+  }
+}
@@ -0,0 +1,166 @@
+import type { EncodedParams, GeneratedGame, PuzzleId } from "./types.ts";
+
+/**
+ * Packs of games generated at build time, for puzzles whose slower presets
+ * would otherwise keep the player waiting (see puzzles/puzzlepack.c, which
+ * also documents the format). A pack is fetched once per session, and cached
+ * for offline use by the service worker. Each of its games is handed out only
+ * once (per browser, as far as localStorage allows), after which newGame()
+ * is back to generating games itself.
+ */
+
+// Pack URLs, by puzzleId. (Only some puzzles have packs, and a build may
+// have none at all.)
+const packUrls = new Map(
+  Object.entries(
+    import.meta.glob<string>("../assets/puzzles/packs/*.pack", {
+      query: "?url",
+      import: "default",
+    }),
+  ).map(([path, url]) => [path.replace(/^.*\/(.*)\.pack$/, "$1"), url]),
+);
+
+const PACK_MAGIC = "PZPK";
+const PACK_VERSION = 1;
+
+interface Pack {
+  data: Uint8Array<ArrayBuffer>;
+  // Each params' compressed block, and once decompressed, its games
+  blocks: Map<EncodedParams, { offset: number; length: number }>;
+  games: Map<EncodedParams, Promise<GeneratedGame[]>>;
+}
+
+const packs = new Map<PuzzleId, Promise<Pack | undefined>>();
+
+async function loadPack(puzzleId: PuzzleId): Promise<Pack | undefined> {
+  const url = packUrls.get(puzzleId);
+  if (!url || typeof DecompressionStream === "undefined") {
+    return undefined;
+  }
+  const response = await fetch(await url());
+  if (!response.ok) {
+    throw new Error(`HTTP ${response.status} fetching ${puzzleId} pack`);
+  }
+  const data = new Uint8Array(await response.arrayBuffer());
+  const view = new DataView(data.buffer);
+  const decoder = new TextDecoder();
+  if (
+    decoder.decode(data.subarray(0, 4)) !== PACK_MAGIC ||
+    view.getUint32(4, true) !== PACK_VERSION
+  ) {
+    throw new Error(`Unrecognised ${puzzleId} pack`);
+  }
+  const blocks = new Map<EncodedParams, { offset: number; length: number }>();
+  const count = view.getUint32(8, true);
+  for (let i = 0; i < count; i++) {
+    const [paramsOffset, paramsLength, offset, length] = [0, 4, 8, 12].map((field) =>
+      view.getUint32(12 + 16 * i + field, true),
+    );
+    const params = decoder.decode(
+      data.subarray(paramsOffset, paramsOffset + paramsLength),
+    );
+    blocks.set(params, { offset, length });
+  }
+  return { data, blocks, games: new Map() };
+}
+
+async function unpackGames(
+  pack: Pack,
+  params: EncodedParams,
+  offset: number,
+  length: number,
+): Promise<GeneratedGame[]> {
+  const stream = new Blob([pack.data.subarray(offset, offset + length)])
+    .stream()
+    .pipeThrough(new DecompressionStream("deflate"));
+  const text = await new Response(stream).text();
+  return text
+    .split("\n")
+    .filter((line) => line !== "")
+    .map((line) => {
+      const [seed, desc, auxInfo] = line.split("\t");
+      return { seed: `${params}#${seed}`, desc, auxInfo: auxInfo || undefined };
+    });
+}
+
+// How many of each params' games have been used, and where this browser
+// started in them. (A different start for each browser means fewer people
+// see the same games.) Kept in memory too, in case localStorage is blocked.
+interface PackPosition {
+  start: number;
+  taken: number;
+}
+
+const positions = new Map<string, PackPosition>();
+
+function loadPosition(key: string, count: number): PackPosition {
+  let position = positions.get(key);
+  if (!position) {
+    try {
+      const [start, taken] = (localStorage.getItem(key) ?? "").split(":").map(Number);
+      if (Number.isInteger(start) && Number.isInteger(taken)) {
+        position = { start, taken };
+      }
+    } catch {
+      // A privacy manager is blocking localStorage
+    }
+    position ??= { start: Math.floor(Math.random() * count), taken: 0 };
+    positions.set(key, position);
+  }
+  return position;
+}
+
+function savePosition(key: string, position: PackPosition) {
+  try {
+    localStorage.setItem(key, `${position.start}:${position.taken}`);
+  } catch {
+    // (Games may be repeated in a later session.)
+  }
+}
+
+/**
+ * Return a game for params from the puzzle's pack, never the same one twice.
+ * Resolves undefined if there's no pack for the puzzle or params, or if all of
+ * its games have been used (or if anything goes wrong, since the caller can
+ * always generate a game instead).
+ */
+export async function takePackedGame(
+  puzzleId: PuzzleId,
+  params: EncodedParams,
+): Promise<GeneratedGame | undefined> {
+  if (!packUrls.has(puzzleId)) {
+    return undefined;
+  }
+  try {
+    let packPromise = packs.get(puzzleId);
+    if (!packPromise) {
+      packPromise = loadPack(puzzleId);
+      packs.set(puzzleId, packPromise);
+    }
+    const pack = await packPromise;
+    const block = pack?.blocks.get(params);
+    if (!pack || !block) {
+      return undefined;
+    }
+    let gamesPromise = pack.games.get(params);
+    if (!gamesPromise) {
+      gamesPromise = unpackGames(pack, params, block.offset, block.length);
+      pack.games.set(params, gamesPromise);
+    }
+    const games = await gamesPromise;
+
+    const key = `puzzlePack:${puzzleId}:${params}`;
+    const position = loadPosition(key, games.length);
+    if (position.taken >= games.length) {
+      return undefined;
+    }
+    const game = games[(position.start + position.taken) % games.length];
+    position.taken++;
+    savePosition(key, position);
+    return game;
+  } catch (error) {
+    console.warn(`takePackedGame(${puzzleId}) failed`, error);
+    packs.set(puzzleId, Promise.resolve(undefined));
+    return undefined;
+  }
+}
@@ -59,6 +59,9 @@ export class PuzzleView extends SignalWatcher(LitElement) {
   @state()
   protected renderedColorScheme?: string;
 
+  @state()
+  protected renderedWorkerEpoch?: number;
+
   @query("[part=content]")
   protected contentPart?: HTMLElement;
 
@@ -81,11 +84,17 @@ export class PuzzleView extends SignalWatcher(LitElement) {
     this.renderedPuzzleGameId = this.puzzle?.currentGameId;
     this.renderedPuzzleParams = this.puzzle?.currentParams;
     this.renderedColorScheme = currentColorScheme.get();
+    this.renderedWorkerEpoch = this.puzzle?.workerEpoch;
   }
 
   protected override async updated(changedProperties: Map<string, unknown>) {
-    if (changedProperties.has("puzzle") && this.canvas) {
-      // Changing Puzzle: any existing canvas belongs to another (probably deleted) worker.
+    if (
+      (changedProperties.has("puzzle") ||
+        changedProperties.has("renderedWorkerEpoch")) &&
+      this.canvas
+    ) {
+      // Changing Puzzle (or its worker): any existing canvas belongs to
+      // another (probably deleted) worker.
       this.destroyCanvas();
     }
 
@@ -400,10 +409,16 @@ export class PuzzleView extends SignalWatcher(LitElement) {
     //   backgrounds. Instead, give the puzzle a gray background of equivalent
     //   lightness (working in OKLCH space) and then colorize it later.
     const [bgl, bgc, bgh] = bglch;
+    const darkModeBackgroundColour = oklchToColour([1, 0, 0]); // pure white
     const defaultBackgroundColour = isDarkMode
-      ? oklchToColour([1, 0, 0]) // generate from pure white in dark mode
+      ? darkModeBackgroundColour
       : oklchToColour([bgl, 0, 0]);
     const paletteRGB = await this.puzzle.getColourPalette(defaultBackgroundColour);
+    if (!isDarkMode) {
+      // Have the dark mode palette ready too. (The light mode one depends on
+      // the light mode CSS, so can't be prepared ahead the other way round.)
+      void this.puzzle.getColourPalette(darkModeBackgroundColour);
+    }
     let palette = paletteRGB.map(colourToOKLCH);
 
     // Apply dark mode adjustments and overrides from puzzleAugmentations
@@ -7,7 +7,10 @@ import {
 } from "../utils/errors.ts";
 import { nextAnimationFrame } from "../utils/timing.ts";
 import { puzzleAugmentations } from "./augmentation.ts";
-import { puzzleDataMap } from "./catalog.ts";
+import { type PuzzleMetadata, puzzleDataMap, puzzleMetadataMap } from "./catalog.ts";
+import { takePackedGame } from "./puzzle-pack.ts";
+import { type GameState, SharedStateReader } from "./shared-state.ts";
+import { PuzzleButton } from "./types.ts";
 import type {
   ChangeNotification,
   Colour,
@@ -15,11 +18,16 @@ import type {
   ConfigValues,
   FontInfo,
   GameStatus,
+  GeneratedGame,
   KeyLabel,
+  MemoryStats,
   Point,
   PresetMenuEntry,
   PuzzleStaticAttributes,
+  SavedGameChanges,
   Size,
+  Thumbnails,
+  TraceEvent,
 } from "./types.ts";
 import type { RemoteWorkerPuzzle, RemoteWorkerPuzzleFactory } from "./worker.ts";
 
@@ -30,6 +38,14 @@ if (sentryWebWorkerIntegration) {
   Sentry.addIntegration(sentryWebWorkerIntegration);
 }
 
+// Compiled wasm modules, by puzzleId, most recently used last. Compiling
+// is most of a worker's startup time, and a puzzle starts several workers
+// (main, generator, prefetch, and again when reopened), so each compiled
+// module is passed on to later workers rather than compiled again.
+// (Which wasm file a puzzle uses can't change during the page's lifetime.)
+const compiledModules = new Map<string, WebAssembly.Module>();
+const maxCompiledModules = 8;
+
 /**
  * Public API to the remote WASM puzzle module running in a worker.
  * Exposes reactive properties for puzzle state.
@@ -40,9 +56,78 @@ export class Puzzle {
     if (import.meta.env.VITE_SENTRY_DSN) {
       Sentry.setTag("puzzleId", puzzleId);
     }
+    let warm = Puzzle.warmWorker;
+    Puzzle.warmWorker = undefined;
+    if (warm?.puzzleId !== puzzleId) {
+      void Puzzle.terminateWorker(warm?.worker);
+      warm = undefined;
+    }
+    const { worker, workerPuzzle } = await (warm?.worker ??
+      Puzzle.createWorker(puzzleId, `puzzle-worker-${puzzleId}`));
+
+    const metadata = puzzleMetadataMap[puzzleId];
+    const staticProps = metadata
+      ? { ...metadata, displayName: metadata.name }
+      : await workerPuzzle.getStaticProperties();
+    const puzzle = new Puzzle(puzzleId, worker, workerPuzzle, staticProps);
+    const aheadGame = await warm?.aheadGame;
+    if (warm?.aheadParams !== undefined && aheadGame) {
+      // Becomes the first newGame() for those params (if they're still current)
+      puzzle.prefetchParams = warm.aheadParams;
+      puzzle.prefetchedGames = [aheadGame];
+    }
+    await puzzle.initialize();
+    return puzzle;
+  }
+
+  // One worker, started before it's needed, for the next Puzzle.create().
+  private static warmWorker?: {
+    puzzleId: string;
+    worker: Promise<{ worker: Worker; workerPuzzle: RemoteWorkerPuzzle }>;
+    aheadParams?: string;
+    aheadGame?: Promise<GeneratedGame | undefined>;
+  };
+
+  /**
+   * Start loading puzzleId's worker (runtime, wasm and frontend) now,
+   * so that a later Puzzle.create(puzzleId) can adopt it rather than
+   * starting from scratch. Replaces any other puzzle's warm worker.
+   *
+   * With aheadParams, the warm worker also generates a game for them,
+   * to become the puzzle's first newGame(). That holds up everything
+   * else in the worker, so is only worth it when there's time to spare
+   * (e.g., while the page is being prerendered).
+   */
+  public static prewarm(puzzleId: string, aheadParams?: string): void {
+    let warm = Puzzle.warmWorker;
+    if (warm?.puzzleId !== puzzleId) {
+      void Puzzle.terminateWorker(warm?.worker);
+      warm = {
+        puzzleId,
+        worker: Puzzle.createWorker(puzzleId, `puzzle-worker-${puzzleId}`),
+      };
+      // (An unused warm worker's failure is reported by whoever adopts it.)
+      warm.worker.catch(() => {});
+      Puzzle.warmWorker = warm;
+    }
+    if (aheadParams !== undefined && warm.aheadParams === undefined) {
+      warm.aheadParams = aheadParams;
+      warm.aheadGame = warm.worker
+        .then(({ workerPuzzle }) => workerPuzzle.generateGame(aheadParams))
+        .catch((error: unknown) => {
+          console.warn("Puzzle.prewarm generateGame failed", error);
+          return undefined;
+        });
+    }
+  }
+
+  private static async createWorker(
+    puzzleId: string,
+    name: string,
+  ): Promise<{ worker: Worker; workerPuzzle: RemoteWorkerPuzzle }> {
     const worker = new Worker(new URL("./worker.ts", import.meta.url), {
       type: "module",
-      name: `puzzle-worker-${puzzleId}`,
+      name,
     });
     if (sentryWebWorkerIntegration) {
       sentryWebWorkerIntegration.addWorker(worker);
@@ -63,23 +148,84 @@ export class Puzzle {
     }
     installWorkerErrorReceivers(worker);
     const workerFactory = wrap<RemoteWorkerPuzzleFactory>(worker);
-    const workerPuzzle = await workerFactory.create(puzzleId);
+    let compiled = compiledModules.get(puzzleId);
+    const workerPuzzle = await workerFactory.create(puzzleId, compiled);
+    compiled ??= await workerPuzzle.getWasmModule();
+    if (compiled) {
+      compiledModules.delete(puzzleId);
+      compiledModules.set(puzzleId, compiled);
+      if (compiledModules.size > maxCompiledModules) {
+        compiledModules.delete(compiledModules.keys().next().value as string);
+      }
+    }
+    return { worker, workerPuzzle };
+  }
 
-    const staticProps = await workerPuzzle.getStaticProperties();
-    const puzzle = new Puzzle(puzzleId, worker, workerPuzzle, staticProps);
-    await puzzle.initialize();
-    return puzzle;
+  // Workers for renderThumbnails, by puzzleId, most recently used last.
+  // (Kept so that lists of saved games can be reopened without waiting.)
+  private static thumbnailWorkers = new Map<
+    string,
+    Promise<{ worker: Worker; workerPuzzle: RemoteWorkerPuzzle }>
+  >();
+  private static readonly maxThumbnailWorkers = 2;
+  private static readonly thumbnailBackground: Colour = [0.95, 0.95, 0.95];
+
+  /**
+   * Draw the current position of each of saves (complete saves, as from
+   * saveGame) for puzzleId, fitted to size, all into one atlas image.
+   * Runs in a worker of its own, so needs no Puzzle (and disturbs none).
+   * The saves' buffers are transferred to the worker.
+   */
+  public static async renderThumbnails(
+    puzzleId: string,
+    saves: Uint8Array<ArrayBuffer>[],
+    size: Size,
+  ): Promise<Thumbnails> {
+    const workers = Puzzle.thumbnailWorkers;
+    const thumbnailWorker =
+      workers.get(puzzleId) ??
+      Puzzle.createWorker(puzzleId, `puzzle-thumbnail-worker-${puzzleId}`);
+    workers.delete(puzzleId);
+    workers.set(puzzleId, thumbnailWorker);
+    if (workers.size > Puzzle.maxThumbnailWorkers) {
+      const oldest = workers.keys().next().value as string;
+      void Puzzle.terminateWorker(workers.get(oldest));
+      workers.delete(oldest);
+    }
+    const dropWorker = () => {
+      if (workers.get(puzzleId) === thumbnailWorker) {
+        workers.delete(puzzleId);
+        void Puzzle.terminateWorker(thumbnailWorker);
+      }
+    };
+    try {
+      const { workerPuzzle } = await thumbnailWorker;
+      const buffers = [...new Set(saves.map((data) => data.buffer))];
+      const thumbnails = await workerPuzzle.renderThumbnails(
+        transfer(saves, buffers),
+        size,
+        Puzzle.thumbnailBackground,
+      );
+      if (await Puzzle.isBloated(workerPuzzle)) {
+        dropWorker();
+      }
+      return thumbnails;
+    } catch (error) {
+      dropWorker();
+      throw error;
+    }
   }
 
   // Private constructor; use Puzzle.create(puzzleId) to instantiate a Puzzle.
   private constructor(
     public readonly puzzleId: string,
-    private readonly worker: Worker,
-    private readonly workerPuzzle: RemoteWorkerPuzzle,
+    private worker: Worker,
+    private workerPuzzle: RemoteWorkerPuzzle,
     {
       displayName,
       canConfigure,
       canSolve,
+      canHint,
       needsRightButton,
       isTimed,
       wantsStatusbar,
@@ -92,6 +238,7 @@ export class Puzzle {
     this.isUnfinished = catalogData?.unfinished ?? false;
     this.canConfigure = canConfigure;
     this.canSolve = canSolve;
+    this.canHint = canHint;
     this.needsRightButton = needsRightButton;
     this.isTimed = isTimed;
     this.wantsStatusbar = wantsStatusbar;
@@ -102,9 +249,55 @@ export class Puzzle {
       proxy(this.notifyChange),
       proxy(this.notifyTimerState),
     );
+    const sharedState = await this.workerPuzzle.enableSharedState();
+    if (sharedState) {
+      this.sharedState = new SharedStateReader(sharedState);
+      requestAnimationFrame(this.pollSharedState);
+    }
+  }
+
+  // When available, game state and status bar changes arrive through
+  // shared memory, polled every animation frame, rather than notifyChange.
+  private sharedState?: SharedStateReader;
+
+  private pollSharedState = () => {
+    if (!this.sharedState) {
+      return; // deleted
+    }
+    const changes = this.sharedState.read();
+    if (changes) {
+      this.updateGameState(changes.state);
+      if (this._statusbarText.get() !== changes.statusBarText) {
+        this._statusbarText.set(changes.statusBarText);
+      }
+      this.captureSentryContext();
+    }
+    requestAnimationFrame(this.pollSharedState);
+  };
+
+  private updateGameState(state: GameState) {
+    function update<T>(signal: Signal.State<T>, newValue: T) {
+      if (signal.get() !== newValue) {
+        signal.set(newValue);
+      }
+    }
+
+    this.purgeInvalidCheckpoints(state.totalMoves);
+    update(this._status, state.status);
+    update(this._currentMove, state.currentMove);
+    update(this._totalMoves, state.totalMoves);
+    update(this._canUndo, state.canUndo);
+    update(this._canRedo, state.canRedo);
   }
 
   public async delete(): Promise<void> {
+    await this.recycling;
+    this.sharedState = undefined;
+    this.cancelNewGame();
+    this.cancelPrecomputeSolution?.();
+    this.cancelSpeculate?.();
+    await this.deleteGeneratorWorker();
+    await this.deletePrefetchWorker();
     await this.detachCanvas();
     await this.workerPuzzle.delete();
     this.workerPuzzle[releaseProxy]();
@@ -144,19 +337,31 @@ export class Puzzle {
         break;
       }
       case "game-state-change":
-        this.purgeInvalidCheckpoints(message.totalMoves);
-        update(this._status, message.status);
-        update(this._currentMove, message.currentMove);
-        update(this._totalMoves, message.totalMoves);
-        update(this._canUndo, message.canUndo);
-        update(this._canRedo, message.canRedo);
+        if (this.sharedState) {
+          return; // (stale: sent before enableSharedState)
+        }
+        this.updateGameState(message);
         break;
       case "params-change":
+        this.configCache.clear();
         update(this._params, message.params);
+        this.discardStalePrefetchedGames(message.params);
+        if (this.generation && this.generation.params !== message.params) {
+          this.cancelNewGame();
+        }
         break;
       case "status-bar-change":
+        if (this.sharedState) {
+          return; // (stale: sent before enableSharedState)
+        }
         update(this._statusbarText, message.statusBarText);
         break;
+      case "generation-progress":
+        update(this._generationProgress, message.progress);
+        return; // (no need to update Sentry context)
+      case "solve-progress":
+        update(this._solveProgress, message.progress);
+        return;
       default:
         // @ts-expect-error: message.type never
         throw new Error(`Unknown notifyChange type ${message.type}`);
@@ -170,6 +375,7 @@ export class Puzzle {
   public readonly isUnfinished: boolean; // "experimental" puzzle status
   public readonly canConfigure: boolean;
   public readonly canSolve: boolean;
+  public readonly canHint: boolean;
   public readonly needsRightButton: boolean;
   public readonly isTimed: boolean;
   public readonly wantsStatusbar: boolean;
@@ -192,6 +398,8 @@ export class Puzzle {
   private _canFormatAsText = signal(false);
   private _statusbarText = signal<string>("");
   private _generatingGame = signal<boolean>(false);
+  private _generationProgress = signal<number>(0);
+  private _solveProgress = signal<number>(0);
 
   public get status(): GameStatus {
     return this._status.get();
@@ -247,15 +455,57 @@ export class Puzzle {
     return this._generatingGame.get();
   }
 
+  // Estimated fraction (0-1) of the game generation in progress.
+  // Only meaningful while generatingGame.
+  public get generationProgress(): number {
+    return this._generationProgress.get();
+  }
+
+  // Estimated fraction (0-1) of a slow solve() in progress (from the
+  // solvers that report it). Only meaningful while solve() is pending.
+  public get solveProgress(): number {
+    return this._solveProgress.get();
+  }
+
   // Methods
   public async newGame(): Promise<void> {
+    this.cancelNewGame();
+    this.cancelSpeculate?.();
+    let generated =
+      this.takePrefetchedGame(this.params) ??
+      (await takePackedGame(this.puzzleId, this.params));
+    // (The first game is generated in place: until it exists, there's
+    // nothing to keep responsive, so it's not worth loading another worker.)
+    if (!generated && this.currentGameId !== undefined) {
+      const result = await this.generateInBackground(this.params);
+      if (result === "cancelled") {
+        return;
+      }
+      generated = result;
+    }
+    if (generated) {
+      const error = await this.workerPuzzle.newGameFromGenerated(generated);
+      if (!error) {
+        this.speculateWhenIdle();
+        return;
+      }
+      console.warn(`Discarding generated game '${generated.seed}': ${error}`);
+    }
+    this._generationProgress.set(0);
     this._generatingGame.set(true);
     await this.workerPuzzle.newGame();
     this._generatingGame.set(false);
+    await this.recycleWorkerIfBloated();
+    this.speculateWhenIdle();
   }
 
   public async newGameFromId(id: string): Promise<string | undefined> {
-    return this.workerPuzzle.newGameFromId(id);
+    const error = await this.workerPuzzle.newGameFromId(id);
+    if (!error) {
+      this.precomputeSolutionWhenIdle();
+      this.speculateWhenIdle();
+    }
+    return error;
   }
 
   public async restartGame(): Promise<void> {
@@ -270,16 +520,139 @@ export class Puzzle {
     await this.workerPuzzle.redo();
   }
 
-  public async solve(): Promise<string | undefined> {
-    return this.workerPuzzle.solve();
+  // Resolves with an error message if the solver failed, ran out of
+  // budget, or was aborted. (Aborting can only interrupt the solver
+  // when crossOriginIsolated; otherwise, it has to wait for the budget.)
+  public async solve({
+    budgetMs = Puzzle.defaultSolveBudgetMs,
+    signal,
+  }: { budgetMs?: number; signal?: AbortSignal } = {}): Promise<string | undefined> {
+    const cancel =
+      signal && self.crossOriginIsolated
+        ? new Int32Array(new SharedArrayBuffer(Int32Array.BYTES_PER_ELEMENT))
+        : undefined;
+    const onAbort = () => cancel && Atomics.store(cancel, 0, 1);
+    signal?.addEventListener("abort", onAbort);
+    this._solveProgress.set(0);
+    try {
+      if (signal?.aborted) {
+        return "Solver cancelled";
+      }
+      const error = await this.workerPuzzle.solve(budgetMs, cancel);
+      await this.recycleWorkerIfBloated();
+      return error;
+    } finally {
+      signal?.removeEventListener("abort", onAbort);
+    }
+  }
+
+  private static readonly defaultSolveBudgetMs = 20_000;
+
+  public async hint(): Promise<string | undefined> {
+    return this.workerPuzzle.hint();
+  }
+
+  // Games entered by id or loaded from a file have no aux_info, so solving
+  // them can mean running the full solver. Do that while nothing else is
+  // going on, so Solve is instant later. (The midend only does it for games
+  // whose solution doesn't depend on the moves made, and only once.)
+  private cancelPrecomputeSolution?: () => void;
+
+  private precomputeSolutionWhenIdle(): void {
+    this.cancelPrecomputeSolution?.();
+    const precompute = () => {
+      this.cancelPrecomputeSolution = undefined;
+      void this.workerPuzzle.precomputeSolution();
+    };
+    if (typeof requestIdleCallback === "function") {
+      const handle = requestIdleCallback(precompute, { timeout: 5000 });
+      this.cancelPrecomputeSolution = () => cancelIdleCallback(handle);
+    } else {
+      const handle = setTimeout(precompute, 1000);
+      this.cancelPrecomputeSolution = () => clearTimeout(handle);
+    }
+  }
+
+  // Some games can't do all their generating until the first move (Mines
+  // places its mines around the first square opened). Do it in idle time
+  // for the likeliest first moves, a step at a time, so that move doesn't
+  // have to wait for it.
+  private cancelSpeculate?: () => void;
+
+  private speculateWhenIdle(): void {
+    this.cancelSpeculate?.();
+    const speculate = async () => {
+      this.cancelSpeculate = undefined;
+      if (await this.workerPuzzle.speculate()) {
+        this.speculateWhenIdle();
+      }
+    };
+    if (typeof requestIdleCallback === "function") {
+      const handle = requestIdleCallback(() => void speculate(), { timeout: 5000 });
+      this.cancelSpeculate = () => cancelIdleCallback(handle);
+    } else {
+      const handle = setTimeout(() => void speculate(), 1000);
+      this.cancelSpeculate = () => clearTimeout(handle);
+    }
+  }
+
+  // Input events go to the worker one at a time, in order. Drags are
+  // coalesced: while one is waiting its turn, a newer drag just replaces its
+  // position, so a slow interpret_move or redraw doesn't build up a backlog of
+  // stale positions. Any other event ends the coalescing, so the midend still
+  // sees press, drag..., release in order (just with fewer drags).
+  private inputQueue: Promise<unknown> = Promise.resolve();
+  private waitingDrag?: { point: Point; button: number; result: Promise<boolean> };
+
+  private static isDrag(button: number): boolean {
+    const base = button & ~PuzzleButton.MOD_MASK;
+    return base >= PuzzleButton.LEFT_DRAG && base <= PuzzleButton.RIGHT_DRAG;
+  }
+
+  private queueInput<T>(send: () => Promise<T>): Promise<T> {
+    const result = this.inputQueue.then(send);
+    this.inputQueue = result.catch(() => undefined); // (caller sees errors)
+    return result;
   }
 
   public async processKey(key: number): Promise<boolean> {
-    return this.workerPuzzle.processKey(key);
+    this.waitingDrag = undefined;
+    return this.queueInput(() => this.workerPuzzle.processKey(key));
   }
 
+  // (A coalesced drag resolves with the result of the drag that replaced it.)
   public async processMouse({ x, y }: Point, button: number): Promise<boolean> {
-    return this.workerPuzzle.processMouse({ x, y }, button);
+    if (!Puzzle.isDrag(button)) {
+      this.waitingDrag = undefined;
+      return this.queueInput(() => this.workerPuzzle.processMouse({ x, y }, button));
+    }
+    if (this.waitingDrag) {
+      this.waitingDrag.point = { x, y };
+      this.waitingDrag.button = button;
+      return this.waitingDrag.result;
+    }
+    const drag = { point: { x, y }, button, result: Promise.resolve(false) };
+    drag.result = this.queueInput(() => {
+      if (this.waitingDrag === drag) {
+        this.waitingDrag = undefined;
+      }
+      return this.workerPuzzle.processMouse(drag.point, drag.button);
+    });
+    this.waitingDrag = drag;
+    return drag.result;
+  }
+
+  // Process a batch of [x, y, button] events (keys with x = y = 0) with a
+  // single redraw and state change notification. Each result is 1 if the
+  // puzzle used that event (as processKey or processMouse would return).
+  public async processKeys(
+    events: readonly (readonly [number, number, number])[],
+  ): Promise<Uint8Array<ArrayBuffer>> {
+    const triples = new Int32Array(events.flat());
+    this.waitingDrag = undefined;
+    return this.queueInput(() =>
+      this.workerPuzzle.processKeys(transfer(triples, [triples.buffer])),
+    );
   }
 
   public async requestKeys(): Promise<KeyLabel[]> {
@@ -316,8 +689,32 @@ export class Puzzle {
     return "Custom type";
   }
 
+  // Descriptions that only change with the params (see Frontend's caches),
+  // kept here to save a worker round trip each time the UI asks for them.
+  // (Or taken from the build's puzzle metadata, which has them all.)
+  private configCache = new Map<string, Promise<unknown>>();
+
+  private cachedConfig<
+    K extends "presets" | "customParamsConfig" | "preferencesConfig",
+  >(key: K, fetch: () => Promise<PuzzleMetadata[K]>): Promise<PuzzleMetadata[K]> {
+    const metadata = puzzleMetadataMap[this.puzzleId];
+    if (metadata) {
+      return Promise.resolve(metadata[key]);
+    }
+    type T = PuzzleMetadata[K];
+    let result = this.configCache.get(key) as Promise<T> | undefined;
+    if (!result) {
+      result = fetch();
+      this.configCache.set(key, result);
+      result.catch(() => this.configCache.delete(key));
+    }
+    return result;
+  }
+
   public async getPresets(flat = false): Promise<PresetMenuEntry[]> {
-    let presets = await this.workerPuzzle.getPresets();
+    let presets = await this.cachedConfig("presets", () =>
+      this.workerPuzzle.getPresets(),
+    );
     if (flat) {
       const flatten = (items: PresetMenuEntry[]): PresetMenuEntry[] => {
         return items.flatMap((item) => [
@@ -331,7 +728,9 @@ export class Puzzle {
   }
 
   public async getCustomParamsConfig(): Promise<ConfigDescription> {
-    return this.workerPuzzle.getCustomParamsConfig();
+    return this.cachedConfig("customParamsConfig", () =>
+      this.workerPuzzle.getCustomParamsConfig(),
+    );
   }
 
   public async getCustomParams(): Promise<ConfigValues> {
@@ -351,7 +750,9 @@ export class Puzzle {
   }
 
   public async getPreferencesConfig(): Promise<ConfigDescription> {
-    return this.workerPuzzle.getPreferencesConfig();
+    return this.cachedConfig("preferencesConfig", () =>
+      this.workerPuzzle.getPreferencesConfig(),
+    );
   }
 
   public async getPreferences(): Promise<ConfigValues> {
@@ -379,8 +780,20 @@ export class Puzzle {
     await this.workerPuzzle.redraw();
   }
 
+  // Palettes by default background. A backend's colours depend on nothing
+  // else, so they're kept for the Puzzle's lifetime: switching colour scheme
+  // (and back) needn't wait on the worker to recompute them.
+  private paletteCache = new Map<string, Promise<Colour[]>>();
+
   public async getColourPalette(defaultBackground: Colour): Promise<Colour[]> {
-    return this.workerPuzzle.getColourPalette(defaultBackground);
+    const key = defaultBackground.join(",");
+    let palette = this.paletteCache.get(key);
+    if (!palette) {
+      palette = this.workerPuzzle.getColourPalette(defaultBackground);
+      this.paletteCache.set(key, palette);
+      palette.catch(() => this.paletteCache.delete(key));
+    }
+    return palette;
   }
 
   // Whether size() has been successfully called yet.
@@ -410,25 +823,389 @@ export class Puzzle {
     return this.workerPuzzle.formatAsText();
   }
 
+  // Midend tracing (only in wasm built with WASM_TRACING; otherwise
+  // there are never any events). Event times are ms since the epoch.
+  public async setTracing(enabled: boolean): Promise<void> {
+    return this.workerPuzzle.setTracing(enabled);
+  }
+
+  public async getTraceEvents(): Promise<TraceEvent[]> {
+    return this.workerPuzzle.getTraceEvents();
+  }
+
+  // Memory use (see MEMORY_STATS; without it, only heapSize is known).
+  public async getMemoryStats(): Promise<MemoryStats> {
+    return this.workerPuzzle.getMemoryStats();
+  }
+
+  public async resetMemoryStats(): Promise<void> {
+    return this.workerPuzzle.resetMemoryStats();
+  }
+
   public async loadGame(data: Uint8Array<ArrayBuffer>): Promise<string | undefined> {
-    return this.workerPuzzle.loadGame(transfer(data, [data.buffer]));
+    const error = await this.workerPuzzle.loadGame(transfer(data, [data.buffer]));
+    if (!error) {
+      this.precomputeSolutionWhenIdle();
+      this.speculateWhenIdle();
+    }
+    return error;
   }
 
-  public async saveGame(): Promise<Uint8Array<ArrayBuffer>> {
-    const result = this.workerPuzzle.saveGame();
+  // For autosaving: a complete save (if full, or if there's nothing to add
+  // to), or else a change record to append to whatever was saved last time.
+  // loadGame accepts a complete save followed by its change records.
+  // If binary, in the compact binary save format, which only loadGame
+  // accepts (not other Puzzles apps): so not for exporting.
+  public async saveGameChanges(
+    full = false,
+    binary = false,
+  ): Promise<SavedGameChanges> {
+    return this.workerPuzzle.saveGameChanges(full, binary);
+  }
+
+  public async saveGame(binary = false): Promise<Uint8Array<ArrayBuffer>> {
+    const result = this.workerPuzzle.saveGame(binary);
     if (import.meta.env.VITE_SENTRY_DSN) {
       // Capture the most recent (auto-)save as a Sentry attachment.
       // (There's no way to replace a specific attachment, so just clear all.)
       Sentry.getCurrentScope().clearAttachments();
       Sentry.getCurrentScope().addAttachment({
-        filename: "save.txt",
+        filename: binary ? "save.bin" : "save.txt",
         data: await result,
-        contentType: "text/plain",
+        contentType: binary ? "application/octet-stream" : "text/plain",
       });
     }
     return result;
   }
 
+  //
+  // Background generation
+  //
+
+  // The newGame() generation in progress in generatorWorker, if any.
+  private generation?: { params: string; cancel: () => void };
+  private generatorWorker?: Promise<{
+    worker: Worker;
+    workerPuzzle: RemoteWorkerPuzzle;
+  }>;
+
+  /**
+   * Abandon any newGame() that is still generating, leaving the current
+   * game in place. (The abandoned newGame() resolves without effect.)
+   */
+  public cancelNewGame(): void {
+    const generation = this.generation;
+    if (generation) {
+      this.generation = undefined;
+      this._generatingGame.set(false);
+      generation.cancel();
+      // new_desc can't be interrupted, so the only way to stop it
+      // burning CPU is to terminate its worker.
+      void this.deleteGeneratorWorker();
+    }
+  }
+
+  /**
+   * Generate a game for params in a separate worker, so the puzzle worker
+   * remains responsive (to a cancel, among other things) while it runs.
+   * Resolves undefined if the generator worker failed, in which case the
+   * caller should fall back to generating in the puzzle worker.
+   */
+  private async generateInBackground(
+    params: string,
+  ): Promise<GeneratedGame | "cancelled" | undefined> {
+    let cancel = () => {};
+    const cancelled = new Promise<"cancelled">((resolve) => {
+      cancel = () => resolve("cancelled");
+    });
+    const generation = { params, cancel };
+    this.generation = generation;
+    this._generationProgress.set(0);
+    this._generatingGame.set(true);
+    try {
+      this.generatorWorker ??= this.createGeneratorWorker();
+      const generatorWorker = this.generatorWorker;
+      return await Promise.race([
+        generatorWorker.then(async ({ workerPuzzle }) => {
+          const generated = await workerPuzzle.generateGame(params);
+          if (
+            this.generatorWorker === generatorWorker &&
+            (await Puzzle.isBloated(workerPuzzle))
+          ) {
+            // (A fresh one is created for the next generation.)
+            void this.deleteGeneratorWorker();
+          }
+          return generated;
+        }),
+        cancelled,
+      ]);
+    } catch (error) {
+      console.warn("Puzzle.generateInBackground failed", error);
+      await this.deleteGeneratorWorker();
+      return undefined;
+    } finally {
+      if (this.generation === generation) {
+        this.generation = undefined;
+        this._generatingGame.set(false);
+      }
+    }
+  }
+
+  private async createGeneratorWorker() {
+    const generatorWorker = await Puzzle.createWorker(
+      this.puzzleId,
+      `puzzle-generator-worker-${this.puzzleId}`,
+    );
+    // Only progress is of interest: the generator worker's params and
+    // (non-existent) game state aren't the puzzle's.
+    await generatorWorker.workerPuzzle.setCallbacks(
+      proxy((message: ChangeNotification) => {
+        if (message.type === "generation-progress") {
+          void this.notifyChange(message);
+        }
+      }),
+      proxy(() => {}),
+    );
+    return generatorWorker;
+  }
+
+  private async deleteGeneratorWorker(): Promise<void> {
+    const generatorWorker = this.generatorWorker;
+    this.generatorWorker = undefined;
+    await Puzzle.terminateWorker(generatorWorker);
+  }
+
+  // Terminate a generator or prefetch worker (which has no game to keep).
+  private static async terminateWorker(
+    workerPromise?: Promise<{ worker: Worker; workerPuzzle: RemoteWorkerPuzzle }>,
+  ): Promise<void> {
+    if (workerPromise) {
+      try {
+        const { worker, workerPuzzle } = await workerPromise;
+        workerPuzzle[releaseProxy]();
+        uninstallWorkerErrorReceivers(worker);
+        worker.terminate();
+      } catch {
+        // Failed to create; nothing to clean up
+      }
+    }
+  }
+
+  //
+  // Generate-ahead pool
+  //
+
+  // Upper bound on prefetchGames count
+  public static readonly maxPrefetchedGames = 4;
+
+  // Games generated in the background, for params prefetchParams.
+  // (Only one params at a time: anything else would be stale.)
+  private prefetchParams?: string;
+  private prefetchCount = 0;
+  private prefetchedGames: GeneratedGame[] = [];
+  private prefetching?: Promise<void>;
+  private prefetchWorker?: Promise<{
+    worker: Worker;
+    workerPuzzle: RemoteWorkerPuzzle;
+  }>;
+
+  /**
+   * Generate up to count games for params in a separate, background worker,
+   * so that a later newGame() with those params can start immediately.
+   * Replaces any earlier prefetch for different params. The pool is kept
+   * topped up to count as newGame() consumes it.
+   */
+  public prefetchGames(params: string, count = 1) {
+    if (params !== this.prefetchParams) {
+      this.prefetchParams = params;
+      this.prefetchedGames = [];
+    }
+    this.prefetchCount = Math.max(0, Math.min(count, Puzzle.maxPrefetchedGames));
+    this.prefetchedGames.splice(this.prefetchCount);
+    this.fillPrefetchPool();
+  }
+
+  private fillPrefetchPool() {
+    if (this.prefetching) {
+      return; // already running (and will pick up any changes)
+    }
+    this.prefetching = (async () => {
+      try {
+        while (
+          this.prefetchParams !== undefined &&
+          this.prefetchedGames.length < this.prefetchCount
+        ) {
+          const params = this.prefetchParams;
+          this.prefetchWorker ??= Puzzle.createWorker(
+            this.puzzleId,
+            `puzzle-prefetch-worker-${this.puzzleId}`,
+          );
+          const prefetchWorker = this.prefetchWorker;
+          const { workerPuzzle } = await prefetchWorker;
+          const generated = await workerPuzzle.generateGame(params);
+          // Params may have changed while we were generating
+          if (
+            params === this.prefetchParams &&
+            this.prefetchedGames.length < this.prefetchCount
+          ) {
+            this.prefetchedGames.push(generated);
+          }
+          if (
+            this.prefetchWorker === prefetchWorker &&
+            (await Puzzle.isBloated(workerPuzzle))
+          ) {
+            // (A fresh one is created for the next generation.)
+            this.prefetchWorker = undefined;
+            await Puzzle.terminateWorker(prefetchWorker);
+          }
+        }
+      } catch (error) {
+        // Prefetching is only an optimization: newGame() will still work.
+        console.warn("Puzzle.prefetchGames failed", error);
+        this.prefetchParams = undefined;
+        this.prefetchedGames = [];
+      } finally {
+        this.prefetching = undefined;
+      }
+    })();
+  }
+
+  private takePrefetchedGame(params: string): GeneratedGame | undefined {
+    if (params !== this.prefetchParams) {
+      return undefined;
+    }
+    const generated = this.prefetchedGames.shift();
+    if (generated) {
+      this.fillPrefetchPool();
+    }
+    return generated;
+  }
+
+  private discardStalePrefetchedGames(params: string) {
+    if (this.prefetchParams !== undefined && params !== this.prefetchParams) {
+      this.prefetchParams = undefined;
+      this.prefetchedGames = [];
+    }
+  }
+
+  private async deletePrefetchWorker(): Promise<void> {
+    this.prefetchParams = undefined;
+    this.prefetchedGames = [];
+    const prefetchWorker = this.prefetchWorker;
+    this.prefetchWorker = undefined;
+    await Puzzle.terminateWorker(prefetchWorker);
+  }
+
+  //
+  // Worker recycling
+  //
+
+  // Wasm memory can grow but never shrink, so one memory-hungry generation
+  // or solve (Loopy on a big aperiodic grid, say) would otherwise leave its
+  // worker holding all that memory for the rest of the session. Workers
+  // whose heap has grown past this are replaced with fresh ones.
+  public static readonly maxWorkerHeapSize = 128 * 1024 * 1024;
+
+  private static async isBloated(workerPuzzle: RemoteWorkerPuzzle): Promise<boolean> {
+    const { heapSize } = await workerPuzzle.getMemoryStats();
+    return heapSize > Puzzle.maxWorkerHeapSize;
+  }
+
+  private _workerEpoch = signal(0);
+
+  /**
+   * Changes whenever the puzzle moves to a fresh worker. A canvas attached
+   * to the old worker went with it, so views must attach a new one.
+   */
+  public get workerEpoch(): number {
+    return this._workerEpoch.get();
+  }
+
+  private recycling?: Promise<void>;
+
+  private recycleWorkerIfBloated(): Promise<void> {
+    this.recycling ??= (async () => {
+      try {
+        if (this.currentGameId && (await Puzzle.isBloated(this.workerPuzzle))) {
+          await this.recycleWorker();
+        }
+      } catch (error) {
+        // The old worker is still in place: carry on with that.
+        console.warn("Puzzle.recycleWorker failed", error);
+      } finally {
+        this.recycling = undefined;
+      }
+    })();
+    return this.recycling;
+  }
+
+  /**
+   * Move the game and preferences to a new worker (through the same
+   * save formats the app persists them in), and terminate the old one.
+   */
+  private async recycleWorker(): Promise<void> {
+    const oldWorker = this.worker;
+    const oldWorkerPuzzle = this.workerPuzzle;
+    const { worker, workerPuzzle } = await Puzzle.createWorker(
+      this.puzzleId,
+      `puzzle-worker-${this.puzzleId}`,
+    );
+    try {
+      // (Set first, so the timer state follows the loaded game.)
+      await workerPuzzle.setCallbacks(
+        proxy(this.notifyChange),
+        proxy(this.notifyTimerState),
+      );
+      const preferences = await oldWorkerPuzzle.savePreferences();
+      const error = await workerPuzzle.loadPreferences(
+        transfer(preferences, [preferences.buffer]),
+      );
+      if (error) {
+        throw new Error(`loadPreferences: ${error}`);
+      }
+      // Moves made meanwhile still go to the old worker, so load
+      // again until its save stops changing.
+      let saved = await oldWorkerPuzzle.saveGame();
+      for (;;) {
+        const data = saved.slice();
+        const error = await workerPuzzle.loadGame(transfer(data, [data.buffer]));
+        if (error) {
+          throw new Error(`loadGame: ${error}`);
+        }
+        const latest = await oldWorkerPuzzle.saveGame();
+        if (
+          latest.length === saved.length &&
+          latest.every((byte, i) => byte === saved[i])
+        ) {
+          break;
+        }
+        saved = latest;
+      }
+    } catch (error) {
+      workerPuzzle[releaseProxy]();
+      uninstallWorkerErrorReceivers(worker);
+      worker.terminate();
+      throw error;
+    }
+
+    this.cancelPrecomputeSolution?.();
+    this.cancelSpeculate?.();
+    this.worker = worker;
+    this.workerPuzzle = workerPuzzle;
+    this.hasSize = false;
+    const sharedState = await workerPuzzle.enableSharedState();
+    this.sharedState = sharedState ? new SharedStateReader(sharedState) : undefined;
+    this._workerEpoch.set(this._workerEpoch.get() + 1);
+
+    try {
+      await oldWorkerPuzzle.delete();
+    } finally {
+      oldWorkerPuzzle[releaseProxy]();
+      uninstallWorkerErrorReceivers(oldWorker);
+      oldWorker.terminate();
+    }
+  }
+
   //
   // Checkpoints
   //
@@ -480,16 +1257,7 @@ export class Puzzle {
     if (checkpoint < 0 || checkpoint > this.totalMoves) {
       throw new RangeError(`Move ${checkpoint} out of bounds`);
     }
-    const delta = checkpoint - this.currentMove;
-    if (delta < 0) {
-      for (let i = 0; i < -delta; i++) {
-        await this.undo();
-      }
-    } else if (delta > 0) {
-      for (let i = 0; i < delta; i++) {
-        await this.redo();
-      }
-    }
+    await this.workerPuzzle.gotoMove(checkpoint);
   }
 
   private purgeInvalidCheckpoints(totalMoves: number) {
@@ -0,0 +1,131 @@
+import type { GameStatus } from "./types.ts";
+
+/**
+ * Shared-memory channel for the puzzle state that changes with every move.
+ *
+ * Sending a "game-state-change" ChangeNotification after each move means
+ * a structured clone and a postMessage per move, which adds up during rapid
+ * input and replays. When cross-origin isolated, the worker instead keeps
+ * the state in a SharedArrayBuffer, updating it in place, and the main
+ * thread polls it once per animation frame.
+ *
+ * The block is an Int32Array of:
+ *   SEQUENCE: incremented before and after each update (so odd while
+ *             the worker is writing, seqlock style)
+ *   STATE: GameStateField.COUNT slots, as from webapp.cpp's notifyGameState
+ *   STATUS_BAR_LENGTH: length in bytes of...
+ *   STATUS_BAR_TEXT: the status bar text, UTF-8, to the end of the block
+ */
+
+// Slots of the Int32Array passed to notifyGameState.
+// (Must match GameStateField in puzzles/webapp.cpp.)
+export const GameStateField = {
+  STATUS: 0, // midend_status: 0 ongoing, 1 solved, -1 lost
+  CURRENT_MOVE: 1,
+  TOTAL_MOVES: 2,
+  CAN_UNDO: 3,
+  CAN_REDO: 4,
+  COUNT: 5,
+} as const;
+
+const SEQUENCE = 0;
+const STATE = 1;
+const STATUS_BAR_LENGTH = STATE + GameStateField.COUNT;
+const STATUS_BAR_TEXT = STATUS_BAR_LENGTH + 1;
+const statusBarCapacity = 1024; // bytes (longer text is truncated)
+const blockBytes = STATUS_BAR_TEXT * 4 + statusBarCapacity;
+
+export interface GameState {
+  status: GameStatus;
+  currentMove: number;
+  totalMoves: number;
+  canUndo: boolean;
+  canRedo: boolean;
+}
+
+export const decodeGameState = (state: Int32Array): GameState => {
+  const status = state[GameStateField.STATUS];
+  return {
+    status: status < 0 ? "lost" : status > 0 ? "solved" : "ongoing",
+    currentMove: state[GameStateField.CURRENT_MOVE],
+    totalMoves: state[GameStateField.TOTAL_MOVES],
+    canUndo: state[GameStateField.CAN_UNDO] !== 0,
+    canRedo: state[GameStateField.CAN_REDO] !== 0,
+  };
+};
+
+/**
+ * Whether the shared channel can be used (SharedArrayBuffer is only
+ * available when cross-origin isolated).
+ */
+export const sharedStateSupported = (): boolean =>
+  typeof SharedArrayBuffer !== "undefined" && globalThis.crossOriginIsolated;
+
+/**
+ * The worker's end: updates the block in place.
+ */
+export class SharedStateWriter {
+  readonly buffer = new SharedArrayBuffer(blockBytes);
+  private readonly words = new Int32Array(this.buffer, 0, STATUS_BAR_TEXT);
+  private readonly text = new Uint8Array(this.buffer, STATUS_BAR_TEXT * 4);
+  private readonly encoder = new TextEncoder();
+  private readonly scratch = new Uint8Array(statusBarCapacity);
+
+  writeGameState(state: Int32Array): void {
+    this.write(() => this.words.set(state, STATE));
+  }
+
+  writeStatusBar(text: string): void {
+    // (encodeInto only writes whole characters.)
+    const { written } = this.encoder.encodeInto(text, this.scratch);
+    this.write(() => {
+      this.text.set(this.scratch.subarray(0, written));
+      this.words[STATUS_BAR_LENGTH] = written;
+    });
+  }
+
+  private write(update: () => void): void {
+    const sequence = Atomics.load(this.words, SEQUENCE);
+    Atomics.store(this.words, SEQUENCE, sequence + 1);
+    update();
+    Atomics.store(this.words, SEQUENCE, sequence + 2);
+  }
+}
+
+/**
+ * The main thread's end: reads the block when it has changed.
+ */
+export class SharedStateReader {
+  private readonly words: Int32Array;
+  private readonly text: Uint8Array;
+  private readonly decoder = new TextDecoder();
+  private sequence = 0;
+
+  constructor(buffer: SharedArrayBuffer) {
+    this.words = new Int32Array(buffer, 0, STATUS_BAR_TEXT);
+    this.text = new Uint8Array(buffer, STATUS_BAR_TEXT * 4);
+  }
+
+  /**
+   * The current state and status bar text, or undefined if they haven't
+   * changed since the last read (or are being written, in which case
+   * try again later).
+   */
+  read(): { state: GameState; statusBarText: string } | undefined {
+    const sequence = Atomics.load(this.words, SEQUENCE);
+    if (sequence === this.sequence || sequence % 2 !== 0) {
+      return undefined;
+    }
+    const state = decodeGameState(
+      this.words.slice(STATE, STATE + GameStateField.COUNT),
+    );
+    const length = Math.min(this.words[STATUS_BAR_LENGTH], statusBarCapacity);
+    // (TextDecoder won't decode from shared memory, so copy with slice.)
+    const statusBarText = this.decoder.decode(this.text.slice(0, length));
+    if (Atomics.load(this.words, SEQUENCE) !== sequence) {
+      return undefined; // written while reading
+    }
+    this.sequence = sequence;
+    return { state, statusBarText };
+  }
+}
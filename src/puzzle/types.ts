@@ -9,9 +9,13 @@ import type {
   MainModule,
   NotifyGameIdChange,
   NotifyGameStateChange,
+  NotifyGenerationProgress,
   NotifyParamsChange,
+  NotifySolveProgress,
   NotifyStatusBarChange,
   Point,
+  PrintSinkWrapper,
+  Rect,
   Size,
 } from "../assets/puzzles/emcc-runtime";
 
@@ -20,18 +24,24 @@ export type {
   Colour,
   Drawing,
   DrawingWrapper,
-  DrawTextOptions,
   Frontend,
   FrontendConstructorArgs,
+  GeneratedGame,
   KeyLabel,
+  MemoryStats,
   NotifyGameIdChange,
   NotifyGameStateChange,
+  NotifyGenerationProgress,
   NotifyParamsChange,
+  NotifySolveProgress,
   NotifyStatusBarChange,
   Point,
   PresetMenuEntry,
+  PrintOptions,
+  PrintSink,
   Rect,
   Size,
+  TraceEvent,
 } from "../assets/puzzles/emcc-runtime";
 
 export type PuzzleId = string;
@@ -40,12 +50,15 @@ export type EncodedParams = string;
 export type ConfigDescription = ReturnType<Frontend["getPreferencesConfig"]>;
 export type ConfigItem = ReturnType<Frontend["getPreferencesConfig"]>["items"]["any"];
 export type ConfigValues = ReturnType<Frontend["getPreferences"]>;
+export type SavedGameChanges = ReturnType<Frontend["saveGameChanges"]>;
 
 export type ChangeNotification =
   | NotifyGameIdChange
   | NotifyGameStateChange
   | NotifyParamsChange
-  | NotifyStatusBarChange;
+  | NotifyStatusBarChange
+  | NotifyGenerationProgress
+  | NotifySolveProgress;
 
 export type GameStatus = NotifyGameStateChange["status"];
 
@@ -87,12 +100,21 @@ export interface PuzzleStaticAttributes {
   displayName: string;
   canConfigure: boolean;
   canSolve: boolean;
+  canHint: boolean;
   // TODO: canFormatAsTextEver: boolean;
   needsRightButton: boolean;
   isTimed: boolean;
   wantsStatusbar: boolean;
 }
 
+// From WorkerPuzzle.renderThumbnails: one image (of atlasSize) holding
+// all the thumbnails, and where each is within it (undefined for failures).
+export interface Thumbnails {
+  atlas: Blob;
+  atlasSize: Size;
+  rects: (Rect | undefined)[];
+}
+
 /**
  * Required JS-side implementation for Drawing API
  */
@@ -106,6 +128,15 @@ export interface DrawingImpl<Blitter = unknown>
   blitterLoad(blitter: Blitter, origin?: Point): void;
 }
 
+/**
+ * Required JS-side implementation for Frontend.print's page sink
+ */
+export type PrintSinkImpl = Omit<
+  PrintSinkWrapper,
+  keyof ClassHandle | "notifyOnDestruction"
+> &
+  Partial<Pick<PrintSinkWrapper, "notifyOnDestruction">>;
+
 /**
  * The Emscripten generated module object
  */
@@ -115,6 +146,11 @@ export interface PuzzleModule extends MainModule {
     implement(drawing: DrawingImpl): DrawingWrapper;
     extend: MainModule["Drawing"]["extend"];
   };
+  // Likewise PrintSink.implement()
+  PrintSink: {
+    implement(sink: PrintSinkImpl): PrintSinkWrapper;
+    extend: MainModule["PrintSink"]["extend"];
+  };
 }
 
 /**
@@ -11,7 +11,14 @@ if (import.meta.env.VITE_SENTRY_DSN) {
 import { expose, proxy, type Remote, transfer } from "comlink";
 import createModule from "../assets/puzzles/emcc-runtime";
 import { installErrorHandlersInWorker } from "../utils/errors-worker.ts";
-import { Drawing } from "./drawing.ts";
+import { Drawing, defaultFontInfo } from "./drawing.ts";
+import { type PaperSize, SvgPrinter } from "./printing.ts";
+import {
+  decodeGameState,
+  GameStateField,
+  SharedStateWriter,
+  sharedStateSupported,
+} from "./shared-state.ts";
 import type {
   ChangeNotification,
   Colour,
@@ -21,12 +28,19 @@ import type {
   FontInfo,
   Frontend,
   FrontendConstructorArgs,
+  GeneratedGame,
   KeyLabel,
+  MemoryStats,
   Point,
   PresetMenuEntry,
+  PrintOptions,
   PuzzleModule,
   PuzzleStaticAttributes,
+  Rect,
+  SavedGameChanges,
   Size,
+  Thumbnails,
+  TraceEvent,
 } from "./types.ts";
 
 installErrorHandlersInWorker();
@@ -39,46 +53,178 @@ const addBreadcrumb = (breadcrumb: Sentry.Breadcrumb) => {
   }
 };
 
+// Whether this browser supports wasm SIMD128, tested by validating a
+// minimal module that uses a v128 instruction (the same test as
+// wasm-feature-detect's simd()).
+const wasmSimdSupported = WebAssembly.validate(
+  new Uint8Array([
+    0, 97, 115, 109, 1, 0, 0, 0, 1, 5, 1, 96, 0, 1, 123, 3, 2, 1, 0, 10, 10, 1, 8, 0,
+    65, 0, 253, 15, 253, 98, 11,
+  ]),
+);
+
+// The wasm threads build, if there is one, has its own emcc runtime.
+// It can only run when cross-origin isolated (for SharedArrayBuffer).
+// (import.meta.glob, unlike import(), is fine with the runtime not existing.)
+const threadsRuntime: (() => Promise<{ default: typeof createModule }>) | undefined =
+  import.meta.env.VITE_WASM_THREADS && self.crossOriginIsolated
+    ? Object.values(
+        import.meta.glob<{ default: typeof createModule }>(
+          "../assets/puzzles/emcc-runtime-threads.js",
+        ),
+      )[0]
+    : undefined;
+
+// Likewise the shared core build: puzzles-core.wasm, with the puzzle's
+// own code in a side module that the core's runtime links at load time.
+const sharedCoreRuntime: (() => Promise<{ default: typeof createModule }>) | undefined =
+  import.meta.env.VITE_WASM_SHARED_CORE
+    ? Object.values(
+        import.meta.glob<{ default: typeof createModule }>(
+          "../assets/puzzles/emcc-runtime-core.js",
+        ),
+      )[0]
+    : undefined;
+
+/**
+ * The builds of a puzzle's wasm (see create). "simd" falls back to
+ * "baseline" when chosen automatically.
+ */
+export type WasmFlavour = "baseline" | "simd" | "threads" | "shared-core";
+
+/**
+ * Raw timings (in ms) from WorkerPuzzle.runBenchmark. A solve the
+ * solver gave up on is NaN; solve is undefined for puzzles without one.
+ */
+export interface BenchmarkTimes {
+  generate: Float64Array<ArrayBuffer>;
+  solve?: Float64Array<ArrayBuffer>;
+  redraw: Float64Array<ArrayBuffer>;
+}
+
 /**
  * Worker-side implementation of main-thread Puzzle class
  */
 export class WorkerPuzzle implements FrontendConstructorArgs {
-  static async create(puzzleId: string): Promise<WorkerPuzzle> {
-    const url = new URL(`../assets/puzzles/${puzzleId}.wasm`, import.meta.url).href;
-    const module = await createModule({
+  /**
+   * Load puzzleId's wasm (or instantiate compiled, from an earlier
+   * worker). The flavour is normally picked to suit the browser and
+   * build; the benchmark page asks for a specific one, which then has
+   * no fallback.
+   */
+  static async create(
+    puzzleId: string,
+    compiled?: WebAssembly.Module,
+    flavour?: WasmFlavour,
+  ): Promise<WorkerPuzzle> {
+    const baselineUrl = new URL(`../assets/puzzles/${puzzleId}.wasm`, import.meta.url)
+      .href;
+    const simdUrl = new URL(`../assets/puzzles/${puzzleId}.simd.wasm`, import.meta.url)
+      .href;
+    const threadsUrl = new URL(
+      `../assets/puzzles/${puzzleId}.threads.wasm`,
+      import.meta.url,
+    ).href;
+    const coreUrl = new URL("../assets/puzzles/puzzles-core.wasm", import.meta.url)
+      .href;
+    const sideUrl = new URL(`../assets/puzzles/${puzzleId}.side.wasm`, import.meta.url)
+      .href;
+    const flavourUrls: Record<WasmFlavour, string> = {
+      baseline: baselineUrl,
+      simd: simdUrl,
+      threads: threadsUrl,
+      "shared-core": coreUrl,
+    };
+    // Prefer the SIMD build where the browser supports it, but keep the
+    // baseline as a fallback: the SIMD flavour is optional in the build.
+    // The threads and shared core builds need their own runtimes, so have
+    // no fallback.
+    const flavours: WasmFlavour[] = flavour
+      ? [flavour]
+      : threadsRuntime
+        ? ["threads"]
+        : sharedCoreRuntime
+          ? ["shared-core"]
+          : wasmSimdSupported
+            ? ["simd", "baseline"]
+            : ["baseline"];
+    const runtime =
+      flavours[0] === "threads"
+        ? threadsRuntime
+        : flavours[0] === "shared-core"
+          ? sharedCoreRuntime
+          : undefined;
+    if (
+      (flavours[0] === "simd" && !wasmSimdSupported) ||
+      ((flavours[0] === "threads" || flavours[0] === "shared-core") && !runtime)
+    ) {
+      throw new Error(`The ${flavours[0]} wasm build isn't available here`);
+    }
+    const createModuleFn = runtime ? (await runtime()).default : createModule;
+    // The shared core's runtime fetches the side module itself, once the
+    // core is instantiated. (locateFile would otherwise prefix the
+    // already-absolute URL with the runtime's directory.)
+    const sideModuleArgs =
+      flavours[0] === "shared-core"
+        ? { dynamicLibraries: [sideUrl], locateFile: (path: string) => path }
+        : {};
+    let wasmModule = compiled;
+    let loadedFlavour = flavours[0];
+    const module = await createModuleFn({
+      ...sideModuleArgs,
       // Emscripten's generated wasm loading includes code that (in workers only)
       // falls back to XHR and ignores any HTTP error. That leads to cryptic errors
       // like "expected magic word 00 61 73 6d, found 46 69 6c 65" for 404 responses.
       // Substitute our own wasm loader.
       instantiateWasm: async (
         imports: WebAssembly.Imports,
-        successCallback: (instance: WebAssembly.Instance) => void,
+        successCallback: (
+          instance: WebAssembly.Instance,
+          module: WebAssembly.Module,
+        ) => void,
       ) => {
+        if (compiled) {
+          // Already compiled by an earlier worker for this puzzle.
+          successCallback(await WebAssembly.instantiate(compiled, imports), compiled);
+          return;
+        }
         // failureCallback is not currently exposed to instantiateWasm:
         // https://github.com/emscripten-core/emscripten/issues/23038
-        const response = await fetch(url);
-        if (import.meta.env.VITE_SENTRY_DSN) {
-          addBreadcrumb({
-            type: "http",
-            category: "fetch",
-            data: {
-              url,
-              method: "GET",
-              status_code: response.status,
-              reason: response.statusText,
-            },
-          });
-        }
-        if (!response.ok) {
-          throw new Error(
-            `Error ${response.status}: ${response.statusText} loading ${url}`,
-          );
+        for (const [i, candidate] of flavours.entries()) {
+          const url = flavourUrls[candidate];
+          try {
+            const response = await fetch(url);
+            if (import.meta.env.VITE_SENTRY_DSN) {
+              addBreadcrumb({
+                type: "http",
+                category: "fetch",
+                data: {
+                  url,
+                  method: "GET",
+                  status_code: response.status,
+                  reason: response.statusText,
+                },
+              });
+            }
+            if (!response.ok) {
+              throw new Error(
+                `Error ${response.status}: ${response.statusText} loading ${url}`,
+              );
+            }
+            const result = await WebAssembly.instantiateStreaming(response, imports);
+            wasmModule = result.module;
+            loadedFlavour = candidate;
+            successCallback(result.instance, result.module);
+            return;
+          } catch (error) {
+            if (i === flavours.length - 1) {
+              throw error;
+            }
+          }
         }
-        const result = await WebAssembly.instantiateStreaming(response, imports);
-        successCallback(result.instance);
       },
     });
-    return new WorkerPuzzle(puzzleId, module);
+    return new WorkerPuzzle(puzzleId, module, wasmModule, loadedFlavour);
   }
 
   private readonly frontend: Frontend;
@@ -86,12 +232,17 @@ export class WorkerPuzzle implements FrontendConstructorArgs {
   private constructor(
     public readonly puzzleId: string,
     private readonly module: PuzzleModule,
+    private readonly wasmModule?: WebAssembly.Module,
+    // (When created from compiled, whichever flavour it was compiled from
+    // is unknown: this is the first that would have been tried.)
+    private readonly flavour: WasmFlavour = "baseline",
   ) {
     this.frontend = new module.Frontend({
       activateTimer: this.activateTimer,
       deactivateTimer: this.deactivateTimer,
       textFallback: this.textFallback,
       notifyChange: this.notifyChange,
+      notifyGameState: this.notifyGameState,
     });
   }
 
@@ -100,6 +251,15 @@ export class WorkerPuzzle implements FrontendConstructorArgs {
     this.deleteDrawing();
   }
 
+  // The compiled wasm, for passing to WorkerPuzzle.create in other workers.
+  getWasmModule(): WebAssembly.Module | undefined {
+    return this.wasmModule;
+  }
+
+  getFlavour(): WasmFlavour {
+    return this.flavour;
+  }
+
   //
   // Remote callbacks (to main thread via Comlink)
   //
@@ -123,6 +283,31 @@ export class WorkerPuzzle implements FrontendConstructorArgs {
     this.earlyChangeNotifications = [];
   }
 
+  // Shared-memory channel for game state and status bar changes, once
+  // enabled. (Until then, and if unsupported, they're sent through
+  // notifyChange.)
+  private sharedState?: SharedStateWriter;
+  private gameState = new Int32Array(GameStateField.COUNT);
+  private statusBarText = "";
+
+  /**
+   * Switch game state and status bar changes to a SharedArrayBuffer (see
+   * shared-state.ts), and return it; or undefined if not supported.
+   */
+  enableSharedState(): SharedArrayBuffer | undefined {
+    if (!sharedStateSupported()) {
+      return undefined;
+    }
+    if (!this.sharedState) {
+      // Start from the latest state, so that the main thread can ignore
+      // any notifications still on their way.
+      this.sharedState = new SharedStateWriter();
+      this.sharedState.writeGameState(this.gameState);
+      this.sharedState.writeStatusBar(this.statusBarText);
+    }
+    return this.sharedState.buffer;
+  }
+
   //
   // Frontend methods (available via Comlink proxy in main thead)
   //
@@ -132,6 +317,7 @@ export class WorkerPuzzle implements FrontendConstructorArgs {
       displayName: this.frontend.name,
       canConfigure: this.frontend.canConfigure,
       canSolve: this.frontend.canSolve,
+      canHint: this.frontend.canHint,
       needsRightButton: this.frontend.needsRightButton,
       isTimed: this.frontend.isTimed,
       wantsStatusbar: this.frontend.wantsStatusbar,
@@ -146,6 +332,104 @@ export class WorkerPuzzle implements FrontendConstructorArgs {
     return this.frontend.newGameFromId(id);
   }
 
+  /**
+   * Generate (but don't start) a game for params.
+   * Used in a separate background WorkerPuzzle to generate games ahead of time.
+   */
+  generateGame(params: string): GeneratedGame {
+    if (this.frontend.getParams() !== params) {
+      const error = this.frontend.setParams(params);
+      if (error) {
+        throw new Error(`generateGame: invalid params '${params}': ${error}`);
+      }
+    }
+    return this.frontend.generateGame();
+  }
+
+  newGameFromGenerated(generated: GeneratedGame): string | undefined {
+    return this.frontend.newGameFromGenerated(generated);
+  }
+
+  /**
+   * Print the current game (plus options.count - 1 more generated with the
+   * same params), returning one SVG document per page.
+   */
+  print(options: PrintOptions, paper?: PaperSize, fontInfo?: FontInfo): string[] {
+    const printer = new SvgPrinter(paper, fontInfo);
+    const handle = printer.bind(this.module);
+    try {
+      const error = this.frontend.print(handle, options);
+      if (error) {
+        throw new Error(`print: ${error}`);
+      }
+    } finally {
+      handle.delete();
+    }
+    return printer.pages;
+  }
+
+  /**
+   * Draw the current position of each of saves (from saveGame), fitted
+   * to size, for lists of saved games. This uses a scratch Frontend,
+   * leaving this puzzle's own game alone, and draws them all into one
+   * atlas image: each save's rect says where (undefined if it wouldn't
+   * load).
+   */
+  async renderThumbnails(
+    saves: Uint8Array<ArrayBuffer>[],
+    size: Size,
+    defaultBackground: Colour,
+  ): Promise<Thumbnails> {
+    const columns = Math.max(1, Math.ceil(Math.sqrt(saves.length)));
+    const rows = Math.max(1, Math.ceil(saves.length / columns));
+    const atlas = new OffscreenCanvas(columns * size.w, rows * size.h);
+    const atlasContext = atlas.getContext("2d");
+    if (!atlasContext) {
+      throw new Error("Failed to get thumbnail atlas 2d context");
+    }
+    const noop = () => {};
+    const frontend = new this.module.Frontend({
+      activateTimer: noop,
+      deactivateTimer: noop,
+      textFallback: this.textFallback,
+      notifyChange: noop,
+    });
+    const canvas = new OffscreenCanvas(size.w, size.h);
+    const drawing = new Drawing(canvas);
+    const handle = drawing.bind(this.module);
+    const rects: (Rect | undefined)[] = [];
+    try {
+      frontend.setDrawing(handle);
+      drawing.setPalette(
+        frontend
+          .getColourPalette(defaultBackground)
+          .map(([r, g, b]) => `rgb(${r * 100}% ${g * 100}% ${b * 100}%)`),
+      );
+      for (const [i, data] of saves.entries()) {
+        if (frontend.loadGame(data)) {
+          rects.push(undefined);
+          continue;
+        }
+        const { w, h } = frontend.size(size, false, 1);
+        drawing.resize(w, h, 1);
+        frontend.forceRedraw();
+        // (Centred in its cell.)
+        const x = (i % columns) * size.w + Math.floor((size.w - w) / 2);
+        const y = Math.floor(i / columns) * size.h + Math.floor((size.h - h) / 2);
+        atlasContext.drawImage(canvas, x, y);
+        rects.push({ x, y, w, h });
+      }
+    } finally {
+      frontend.delete();
+      handle.delete();
+    }
+    return {
+      atlas: await atlas.convertToBlob(),
+      atlasSize: { w: atlas.width, h: atlas.height },
+      rects,
+    };
+  }
+
   restartGame(): void {
     this.frontend.restartGame();
   }
@@ -158,8 +442,66 @@ export class WorkerPuzzle implements FrontendConstructorArgs {
     this.frontend.redo();
   }
 
-  solve(): string | undefined {
-    return this.frontend.solve();
+  gotoMove(move: number): void {
+    this.frontend.gotoMove(move);
+  }
+
+  // Stops after budgetMs, or once cancel[0] is set nonzero (cancel must
+  // be on a SharedArrayBuffer for the main thread's store to be seen).
+  solve(budgetMs: number, cancel?: Int32Array): string | undefined {
+    return this.frontend.solve(budgetMs, cancel);
+  }
+
+  hint(): string | undefined {
+    return this.frontend.hint();
+  }
+
+  precomputeSolution(): void {
+    this.frontend.precomputeSolution();
+  }
+
+  speculate(): boolean {
+    return this.frontend.speculate();
+  }
+
+  /**
+   * Time generating, solving and redrawing count games with params, all
+   * from fixed seeds, for the benchmark page. Redraws go to an
+   * offscreen canvas of (at most) size, created here if no canvas is
+   * attached. Leaves the first game as the current game.
+   */
+  runBenchmark(params: string, count: number, size: Size): BenchmarkTimes {
+    const error = this.frontend.setParams(params);
+    if (error) {
+      throw new Error(`runBenchmark: invalid params '${params}': ${error}`);
+    }
+    // Nobody's listening, so don't queue change notifications for later.
+    this.notifyChangeRemote ??= () => {};
+    if (!this.drawing) {
+      this.attachCanvas(new OffscreenCanvas(size.w, size.h), defaultFontInfo);
+      this.drawing?.setPalette(
+        this.frontend
+          .getColourPalette([0.9, 0.9, 0.9])
+          .map(([r, g, b]) => `rgb(${r * 100}% ${g * 100}% ${b * 100}%)`),
+      );
+    }
+    type Times = Float64Array<ArrayBuffer>;
+    const generate = this.frontend.benchmarkGenerate(count) as Times;
+    const solve = this.frontend.canSolve
+      ? (this.frontend.benchmarkSolve(count) as Times)
+      : undefined;
+    // Redraw the first game's starting position. (benchmarkSolve left
+    // its last game solved.)
+    this.frontend.benchmarkGenerate(1);
+    const { w, h } = this.frontend.size(size, false, 1);
+    this.drawing?.resize(w, h, 1);
+    const redraw = this.frontend.benchmarkRedraw(count) as Times;
+    const times: BenchmarkTimes = { generate, solve, redraw };
+    return transfer(times, [
+      generate.buffer,
+      redraw.buffer,
+      ...(solve ? [solve.buffer] : []),
+    ]);
   }
 
   processKey(key: number): boolean {
@@ -170,6 +512,11 @@ export class WorkerPuzzle implements FrontendConstructorArgs {
     return this.frontend.processKey(x, y, button);
   }
 
+  processKeys(events: Int32Array<ArrayBuffer>): Uint8Array<ArrayBuffer> {
+    const results = this.frontend.processKeys(events) as Uint8Array<ArrayBuffer>;
+    return transfer(results, [results.buffer]);
+  }
+
   requestKeys(): KeyLabel[] {
     return this.frontend.requestKeys();
   }
@@ -228,6 +575,9 @@ export class WorkerPuzzle implements FrontendConstructorArgs {
   }
 
   redraw(): void {
+    // Explicit redraws (e.g., after the onscreen canvas was lost) should
+    // repaint everything, not just what the puzzle thinks has changed.
+    this.drawing?.invalidate();
     this.frontend.redraw();
   }
 
@@ -247,15 +597,47 @@ export class WorkerPuzzle implements FrontendConstructorArgs {
     return this.frontend.formatAsText();
   }
 
+  setTracing(enabled: boolean): void {
+    this.frontend.setTracing(enabled);
+  }
+
+  // Trace events since the last call, with times converted from this
+  // worker's performance.now() to milliseconds since the epoch (as the
+  // main thread's clock differs).
+  getTraceEvents(): TraceEvent[] {
+    const origin = performance.timeOrigin;
+    return this.frontend.getTraceEvents().map((event) => ({
+      ...event,
+      start: origin + event.start,
+      end: origin + event.end,
+    }));
+  }
+
+  // Memory use (malloc.c's counts only in wasm built with MEMORY_STATS)
+  // since the last resetMemoryStats. The wasm heap never shrinks, so
+  // heapSize is the most the worker has ever needed.
+  getMemoryStats(): MemoryStats {
+    return this.frontend.getMemoryStats();
+  }
+
+  resetMemoryStats(): void {
+    this.frontend.resetMemoryStats();
+  }
+
   loadGame(data: Uint8Array<ArrayBuffer>): string | undefined {
     return this.frontend.loadGame(data);
   }
 
-  saveGame(): Uint8Array<ArrayBuffer> {
-    const data = this.frontend.saveGame() as Uint8Array<ArrayBuffer>;
+  saveGame(binary = false): Uint8Array<ArrayBuffer> {
+    const data = this.frontend.saveGame(binary) as Uint8Array<ArrayBuffer>;
     return transfer(data, [data.buffer]);
   }
 
+  saveGameChanges(full: boolean, binary = false): SavedGameChanges {
+    const changes = this.frontend.saveGameChanges(full, binary);
+    return transfer(changes, [changes.data.buffer]);
+  }
+
   //
   // Drawing
   //
@@ -369,13 +751,33 @@ export class WorkerPuzzle implements FrontendConstructorArgs {
     return strings[0];
   };
 
+  notifyGameState = (state: Int32Array): void => {
+    // (state is a view onto wasm memory, so must be copied now.)
+    this.gameState.set(state);
+    if (this.sharedState) {
+      this.sharedState.writeGameState(state);
+    } else {
+      this.notifyChange({ type: "game-state-change", ...decodeGameState(state) });
+    }
+  };
+
   notifyChange = (message: ChangeNotification): void => {
+    if (message.type === "status-bar-change") {
+      this.statusBarText = message.statusBarText;
+      if (this.sharedState) {
+        this.sharedState.writeStatusBar(message.statusBarText);
+        return;
+      }
+    }
     if (this.notifyChangeRemote) {
       this.notifyChangeRemote(message);
-    } else {
+    } else if (
+      message.type !== "generation-progress" &&
+      message.type !== "solve-progress"
+    ) {
       // Early notification before main thread has installed callbacks
       // (e.g., initial state in Frontend constructor). Queue for delivery
-      // when callbacks installed.
+      // when callbacks installed. (Progress would be stale by then.)
       this.earlyChangeNotifications.push(message);
     }
   };
@@ -383,11 +785,15 @@ export class WorkerPuzzle implements FrontendConstructorArgs {
 
 // Factory function to create puzzle instances
 interface WorkerPuzzleFactory {
-  create(puzzleId: string): Promise<WorkerPuzzle>;
+  create(
+    puzzleId: string,
+    compiled?: WebAssembly.Module,
+    flavour?: WasmFlavour,
+  ): Promise<WorkerPuzzle>;
 }
 const workerPuzzleFactory: WorkerPuzzleFactory = {
-  async create(puzzleId: string) {
-    const workerPuzzle = await WorkerPuzzle.create(puzzleId);
+  async create(puzzleId: string, compiled?: WebAssembly.Module, flavour?: WasmFlavour) {
+    const workerPuzzle = await WorkerPuzzle.create(puzzleId, compiled, flavour);
     return proxy(workerPuzzle);
   },
 };
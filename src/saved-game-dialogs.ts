@@ -1,6 +1,6 @@
 import { css, html, LitElement, nothing } from "lit";
 import { query } from "lit/decorators/query.js";
-import { customElement, property } from "lit/decorators.js";
+import { customElement, property, state } from "lit/decorators.js";
 import { cssWATweaks } from "./utils/css.ts";
 import { isRunningAsApp } from "./utils/pwa.ts";
 
@@ -96,9 +96,23 @@ export class LoadGameDialog extends GameFileDialog {
   @property({ type: Boolean, attribute: "game-in-progress" })
   gameInProgress: boolean = false;
 
+  // Whether the dialog is showing (so the list's thumbnails are wanted)
+  @state()
+  private showing = false;
+
+  private handleDialogShowHide(event: Event) {
+    // (Ignore the help popover's events.)
+    if (event.target === this.dialog) {
+      this.showing = event.type === "wa-show";
+    }
+  }
+
   protected override render() {
     return html`
-      <wa-dialog>
+      <wa-dialog
+          @wa-show=${this.handleDialogShowHide}
+          @wa-after-hide=${this.handleDialogShowHide}
+      >
         <div slot="label">Load game</div>
         <wa-button
             slot="header-actions"
@@ -114,6 +128,7 @@ export class LoadGameDialog extends GameFileDialog {
 
         <saved-game-list
             puzzleid=${this.puzzleId}
+            ?thumbnails=${this.showing}
             @dblclick=${this.handleSavedGameDoubleClick}
             @saved-game-list-select=${this.handleSavedGameSelect}
         >
@@ -2,7 +2,10 @@ import { computed, type Signal, SignalWatcher } from "@lit-labs/signals";
 import { css, html, LitElement, nothing } from "lit";
 import { customElement, property, state } from "lit/decorators.js";
 import { repeat } from "lit/directives/repeat.js";
+import { styleMap } from "lit/directives/style-map.js";
 import { puzzleDataMap } from "./puzzle/catalog.ts";
+import { Puzzle } from "./puzzle/puzzle.ts";
+import type { Rect, Size } from "./puzzle/types.ts";
 import type { SavedGameMetadata } from "./store/db.ts";
 import { savedGames } from "./store/saved-games.ts";
 import { cssWATweaks } from "./utils/css.ts";
@@ -49,6 +52,16 @@ const sortFunctions: {
 const makeKey = ({ puzzleId, filename }: SavedGameMetadata) =>
   `${puzzleId}:${filename}`;
 
+// Where to find an item's thumbnail: rect within an atlas image at url.
+interface Thumbnail {
+  url: string;
+  atlasSize: Size;
+  rect: Rect;
+  scale: number; // device pixels per CSS pixel
+}
+
+const thumbnailSize = 48; // CSS pixels square
+
 /**
  * <saved-game-list> displays a tabular list of saved games,
  * with sortable columns for name, date, puzzle type, and status.
@@ -68,6 +81,13 @@ export class SavedGameList extends SignalWatcher(LitElement) {
   @property({ type: String, reflect: true, attribute: "sort-order" })
   sortOrder: "asc" | "desc" = "asc";
 
+  /**
+   * Show a thumbnail of each game's current position.
+   * (They're kept while this is turned off, so can be hidden cheaply.)
+   */
+  @property({ type: Boolean })
+  thumbnails = false;
+
   @state()
   private columns: SavedGameListColumn[] = [
     {
@@ -102,6 +122,8 @@ export class SavedGameList extends SignalWatcher(LitElement) {
   override disconnectedCallback(): void {
     super.disconnectedCallback();
 
+    this.discardThumbnails();
+
     // Release live query signal
     this._savedGamesSignal = undefined;
     this._itemsSignal = undefined;
@@ -144,6 +166,106 @@ export class SavedGameList extends SignalWatcher(LitElement) {
     if (this.selectedItemKey) {
       this.scrollSelectedItemIntoView();
     }
+    if (this.thumbnails) {
+      void this.loadThumbnails();
+    }
+  }
+
+  //
+  // Thumbnails
+  //
+
+  @state()
+  private thumbnailMap = new Map<string, Thumbnail>();
+  private thumbnailUrls: string[] = [];
+  // The items (and their timestamps) thumbnailMap is for, or being loaded for
+  private thumbnailsFor?: string;
+
+  private async loadThumbnails() {
+    const items = this.items;
+    const thumbnailsFor = items
+      .map(({ key, timestamp }) => `${key}@${timestamp}`)
+      .join("\n");
+    if (thumbnailsFor === this.thumbnailsFor) {
+      return;
+    }
+    this.thumbnailsFor = thumbnailsFor;
+
+    // One batch (and one atlas) per puzzle
+    const byPuzzle = new Map<string, SavedGameListItem[]>();
+    for (const item of items) {
+      byPuzzle.set(item.puzzleId, [...(byPuzzle.get(item.puzzleId) ?? []), item]);
+    }
+    const scale = Math.ceil(window.devicePixelRatio ?? 1);
+    const size = { w: thumbnailSize * scale, h: thumbnailSize * scale };
+    const thumbnailMap = new Map<string, Thumbnail>();
+    const urls: string[] = [];
+    try {
+      for (const [puzzleId, puzzleItems] of byPuzzle) {
+        const saves = await savedGames.loadSavedGameData(
+          puzzleId,
+          puzzleItems.map((item) => item.filename),
+        );
+        const found = puzzleItems.filter((_, i) => saves[i]);
+        if (found.length === 0) {
+          continue;
+        }
+        const { atlas, atlasSize, rects } = await Puzzle.renderThumbnails(
+          puzzleId,
+          saves.filter((data) => data !== undefined),
+          size,
+        );
+        const url = URL.createObjectURL(atlas);
+        urls.push(url);
+        for (const [i, item] of found.entries()) {
+          const rect = rects[i];
+          if (rect) {
+            thumbnailMap.set(item.key, { url, atlasSize, rect, scale });
+          }
+        }
+      }
+    } catch (error) {
+      // Thumbnails are only decoration: show the list without them.
+      console.warn("SavedGameList.loadThumbnails failed", error);
+    }
+
+    if (thumbnailsFor !== this.thumbnailsFor) {
+      // Superseded while loading
+      for (const url of urls) {
+        URL.revokeObjectURL(url);
+      }
+      return;
+    }
+    for (const url of this.thumbnailUrls) {
+      URL.revokeObjectURL(url);
+    }
+    this.thumbnailUrls = urls;
+    this.thumbnailMap = thumbnailMap;
+  }
+
+  private discardThumbnails() {
+    for (const url of this.thumbnailUrls) {
+      URL.revokeObjectURL(url);
+    }
+    this.thumbnailUrls = [];
+    this.thumbnailMap = new Map();
+    this.thumbnailsFor = undefined;
+  }
+
+  private renderThumbnail(item: SavedGameListItem) {
+    const thumbnail = this.thumbnailMap.get(item.key);
+    if (!thumbnail) {
+      return nothing;
+    }
+    const { url, atlasSize, rect, scale } = thumbnail;
+    const style = {
+      width: `${rect.w / scale}px`,
+      height: `${rect.h / scale}px`,
+      "background-image": `url(${url})`,
+      "background-size": `${atlasSize.w / scale}px ${atlasSize.h / scale}px`,
+      "background-position": `${-rect.x / scale}px ${-rect.y / scale}px`,
+    };
+    return html`<div class="thumbnail" style=${styleMap(style)}></div>`;
   }
 
   protected override render() {
@@ -161,6 +283,11 @@ export class SavedGameList extends SignalWatcher(LitElement) {
       >
         <thead>
         <tr role="row">
+          ${
+            this.thumbnails
+              ? html`<th scope="col" role="columnheader" class="thumbnail"></th>`
+              : nothing
+          }
           ${this.columns.map((column) => this.renderColumnHeader(column))}
         </tr>
         </thead>
@@ -218,6 +345,12 @@ export class SavedGameList extends SignalWatcher(LitElement) {
           aria-selected=${isSelected}
           @click=${this.handleRowClick}
       >
+        ${
+          this.thumbnails
+            ? html`
+              <td role="gridcell" class="thumbnail">${this.renderThumbnail(item)}</td>`
+            : nothing
+        }
         ${values.map((value) => html`<td role="gridcell">${value}</td>`)}
       </tr>`;
   }
@@ -225,7 +358,7 @@ export class SavedGameList extends SignalWatcher(LitElement) {
   private renderPlaceholder() {
     return html`
       <tr class="placeholder">
-        <td colspan=${this.columns.length}>
+        <td colspan=${this.columns.length + (this.thumbnails ? 1 : 0)}>
           <slot name="placeholder"></slot>
         </td>
       </tr>
@@ -445,6 +578,19 @@ export class SavedGameList extends SignalWatcher(LitElement) {
         overflow: hidden;
         text-overflow: ellipsis;
       }
+      th.thumbnail,
+      td.thumbnail {
+        box-sizing: content-box;
+        width: ${thumbnailSize}px;
+      }
+      td.thumbnail {
+        padding-block: var(--wa-space-2xs);
+      }
+      div.thumbnail {
+        margin: auto;
+        background-repeat: no-repeat;
+      }
+      
       tr.placeholder td {
         text-align: center;
         vertical-align: middle;
@@ -65,6 +65,8 @@ export const TIMESTAMP_MIN = Dexie.minKey;
 export const TIMESTAMP_MAX = Dexie.maxKey;
 export const PUZZLE_ID_MIN = Dexie.minKey;
 export const PUZZLE_ID_MAX = Dexie.maxKey;
+export const SEQ_MIN = Dexie.minKey;
+export const SEQ_MAX = Dexie.maxKey;
 
 export interface SavedGameMetadata {
   filename: string; // user filename or autoSaveFilename
@@ -81,9 +83,23 @@ export interface SavedGameRecord extends SavedGameMetadata {
   checkpoints?: readonly number[];
 }
 
+// A change record for an autosave, to be appended to its SavedGameRecord's data
+// when loading it, in order of seq. (See Puzzle.saveGameChanges.)
+export interface SavedGameChangesRecord {
+  puzzleId: PuzzleId;
+  saveType: SaveType;
+  filename: string;
+  seq: number;
+  data: Uint8Array<ArrayBuffer>;
+}
+
 class Database extends Dexie {
   settings!: EntityTable<SettingsRecord, "id">;
   savedGames!: Table<SavedGameRecord, [PuzzleId, SaveType, string]>;
+  savedGameChanges!: Table<
+    SavedGameChangesRecord,
+    [PuzzleId, SaveType, string, number]
+  >;
 
   constructor() {
     super("PuzzleAppData");
@@ -95,6 +111,11 @@ class Database extends Dexie {
         "[saveType+puzzleId+timestamp]", // supports query by saveType, most recent
       ].join(", "),
     });
+    this.version(3).stores({
+      savedGameChanges: [
+        "&[puzzleId+saveType+filename+seq]", // compound primary key
+      ].join(", "),
+    });
   }
 
   override open() {
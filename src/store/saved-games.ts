@@ -7,12 +7,66 @@ import {
   PUZZLE_ID_MAX,
   PUZZLE_ID_MIN,
   type SavedGameMetadata,
+  type SavedGameRecord,
   SaveType,
+  SEQ_MAX,
+  SEQ_MIN,
   TIMESTAMP_MAX,
   TIMESTAMP_MIN,
 } from "./db.ts";
 
+// Autosaves are written incrementally: a complete save, followed by a change
+// record for each later autosave (in db.savedGameChanges), until the changes
+// add up to more than the complete save did, when a new complete save
+// replaces them all. So each autosave costs about as much as the moves made
+// since the last one, rather than the whole game history.
+interface AutoSaveLog {
+  filename: string;
+  seq: number; // of the last change record written, 0 if none
+  size: number; // total bytes of change records
+  completeSize: number; // bytes of the complete save
+}
+
+// Saves are stored in the midend's compact binary format, and user saves are
+// gzipped too, when that makes them smaller. (Not autosaves: compressing would
+// mean another await before writing, which could let a later change record
+// reach the database before the complete save it follows.) readFromDB
+// recognises gzipped data by its magic number, and the midend recognises
+// either format, so text saves from earlier versions still load.
+const COMPRESS_MIN_SIZE = 512;
+
+async function pipeThrough(
+  data: Uint8Array<ArrayBuffer>,
+  stream: CompressionStream | DecompressionStream,
+): Promise<Uint8Array<ArrayBuffer>> {
+  const response = new Response(new Blob([data]).stream().pipeThrough(stream));
+  return new Uint8Array(await response.arrayBuffer());
+}
+
+async function compressSave(
+  data: Uint8Array<ArrayBuffer>,
+): Promise<Uint8Array<ArrayBuffer>> {
+  if (data.length < COMPRESS_MIN_SIZE || typeof CompressionStream === "undefined") {
+    return data;
+  }
+  const compressed = await pipeThrough(data, new CompressionStream("gzip"));
+  return compressed.length < data.length ? compressed : data;
+}
+
+async function decompressSave(
+  data: Uint8Array<ArrayBuffer>,
+): Promise<Uint8Array<ArrayBuffer>> {
+  // (Neither save format can start with gzip's 1f 8b.)
+  if (data.length < 2 || data[0] !== 0x1f || data[1] !== 0x8b) {
+    return data;
+  }
+  return pipeThrough(data, new DecompressionStream("gzip"));
+}
+
 class SavedGames {
+  // The autosave each puzzle's change records currently continue, if any
+  private autoSaveLogs = new WeakMap<Puzzle, AutoSaveLog>();
+
   /**
    * Return a list of saved games for puzzleId if provided, or all puzzles if not.
    */
@@ -162,19 +216,78 @@ class SavedGames {
   /**
    * Create or update the autosave record for puzzle.
    */
-  async autoSaveGame(puzzle: Puzzle, autoSaveFilename: string) {
-    await this.saveToDB({
-      puzzle,
-      filename: autoSaveFilename,
-      saveType: SaveType.Auto,
-    });
+  async autoSaveGame(puzzle: Puzzle, autoSaveFilename: string): Promise<void> {
+    const puzzleId = puzzle.puzzleId;
+    const filename = autoSaveFilename;
+    const saveType = SaveType.Auto;
+    const metadata = {
+      timestamp: Date.now(),
+      status: puzzle.status,
+      gameId: puzzle.currentGameId ?? "",
+      checkpoints: [...puzzle.checkpoints],
+    };
+
+    let log = this.autoSaveLogs.get(puzzle);
+    const full = log?.filename !== filename || log.size > log.completeSize;
+    const { complete, data } = await puzzle.saveGameChanges(full, true);
+    // (Update the log before any further await, so that overlapping
+    // autosaves number their records in the order the puzzle wrote them.)
+    if (complete || !log) {
+      log = { filename, seq: 0, size: 0, completeSize: data.length };
+    } else {
+      log = { ...log, seq: log.seq + 1, size: log.size + data.length };
+    }
+    this.autoSaveLogs.set(puzzle, log);
+    const { seq } = log;
+
+    let written: boolean;
+    try {
+      written = await db.transaction(
+        "rw",
+        db.savedGames,
+        db.savedGameChanges,
+        async () => {
+          if (complete) {
+            await db.savedGames.put({
+              puzzleId,
+              filename,
+              saveType,
+              ...metadata,
+              data,
+            });
+            await this.savedGameChanges(puzzleId, saveType, filename).delete();
+            return true;
+          }
+          // (Table.update returns 0 if the complete save has since been deleted.)
+          const found = await db.savedGames.update(
+            [puzzleId, saveType, filename],
+            metadata,
+          );
+          if (found) {
+            await db.savedGameChanges.add({ puzzleId, saveType, filename, seq, data });
+          }
+          return found > 0;
+        },
+      );
+    } catch (error) {
+      // The puzzle considers these changes saved, so start again from the top.
+      this.autoSaveLogs.delete(puzzle);
+      throw error;
+    }
+    if (!written) {
+      this.autoSaveLogs.delete(puzzle);
+      await this.autoSaveGame(puzzle, autoSaveFilename);
+    }
   }
 
   async removeAutoSavedGame(puzzleOrId: Puzzle | PuzzleId, autoSaveFilename: string) {
     const puzzleId = typeof puzzleOrId === "string" ? puzzleOrId : puzzleOrId.puzzleId;
-    // (Table.delete does nothing if primary key not in table.)
-    // (Unlike Table.get, compound primary key must be passed as array.)
-    await db.savedGames.delete([puzzleId, SaveType.Auto, autoSaveFilename]);
+    await db.transaction("rw", db.savedGames, db.savedGameChanges, async () => {
+      // (Table.delete does nothing if primary key not in table.)
+      // (Unlike Table.get, compound primary key must be passed as array.)
+      await db.savedGames.delete([puzzleId, SaveType.Auto, autoSaveFilename]);
+      await this.savedGameChanges(puzzleId, SaveType.Auto, autoSaveFilename).delete();
+    });
   }
 
   async restoreAutoSavedGame(
@@ -193,20 +306,60 @@ class SavedGames {
   }
 
   async removeAllAutoSavedGames() {
-    await db.savedGames
-      .where("[saveType+puzzleId+timestamp]")
-      .between(
-        [SaveType.Auto, PUZZLE_ID_MIN, TIMESTAMP_MIN],
-        [SaveType.Auto, PUZZLE_ID_MAX, TIMESTAMP_MAX],
-      )
-      .delete();
+    await db.transaction("rw", db.savedGames, db.savedGameChanges, async () => {
+      await db.savedGames
+        .where("[saveType+puzzleId+timestamp]")
+        .between(
+          [SaveType.Auto, PUZZLE_ID_MIN, TIMESTAMP_MIN],
+          [SaveType.Auto, PUZZLE_ID_MAX, TIMESTAMP_MAX],
+        )
+        .delete();
+      // (Only autosaves have change records.)
+      await db.savedGameChanges.clear();
+    });
   }
 
   /**
    * Delete all saved games of any type (clear the savedGames table)
    */
   async removeAll() {
-    await db.savedGames.clear();
+    await db.transaction("rw", db.savedGames, db.savedGameChanges, async () => {
+      await db.savedGames.clear();
+      await db.savedGameChanges.clear();
+    });
+  }
+
+  /**
+   * The change records for a saved game, in order.
+   */
+  private savedGameChanges(puzzleId: PuzzleId, saveType: SaveType, filename: string) {
+    return db.savedGameChanges
+      .where("[puzzleId+saveType+filename+seq]")
+      .between(
+        [puzzleId, saveType, filename, SEQ_MIN],
+        [puzzleId, saveType, filename, SEQ_MAX],
+      );
+  }
+
+  /**
+   * The saved data for each of filenames (user saves of puzzleId), in
+   * the form Puzzle.loadGame takes, or undefined for any not found.
+   * (For Puzzle.renderThumbnails.)
+   */
+  async loadSavedGameData(
+    puzzleId: PuzzleId,
+    filenames: readonly string[],
+  ): Promise<(Uint8Array<ArrayBuffer> | undefined)[]> {
+    return Promise.all(
+      filenames.map(async (filename) => {
+        const saved = await this.readFromDB({
+          puzzleId,
+          filename,
+          saveType: SaveType.User,
+        });
+        return saved?.data;
+      }),
+    );
   }
 
   /**
@@ -223,14 +376,49 @@ class SavedGames {
     filename: string;
     saveType: SaveType;
   }): Promise<{ found: boolean; error?: string; gameId?: string }> {
-    const record = await db.savedGames.get({
+    const saved = await this.readFromDB({
       puzzleId: puzzle.puzzleId,
-      saveType,
       filename,
+      saveType,
     });
-    if (!record) {
+    if (!saved) {
       return { found: false };
     }
+    const { record, data } = saved;
+    const error = await puzzle.loadGame(data);
+    if (error) {
+      return { found: true, error };
+    }
+    puzzle.checkpoints = record.checkpoints ?? [];
+    return { found: true, gameId: record.gameId };
+  }
+
+  /**
+   * Reads filename's record and its complete data (including any change
+   * records), or undefined if it does not exist.
+   */
+  private async readFromDB({
+    puzzleId,
+    filename,
+    saveType,
+  }: {
+    puzzleId: PuzzleId;
+    filename: string;
+    saveType: SaveType;
+  }): Promise<{ record: SavedGameRecord; data: Uint8Array<ArrayBuffer> } | undefined> {
+    const [record, changes] = await db.transaction(
+      "r",
+      db.savedGames,
+      db.savedGameChanges,
+      () =>
+        Promise.all([
+          db.savedGames.get({ puzzleId, saveType, filename }),
+          this.savedGameChanges(puzzleId, saveType, filename).toArray(),
+        ]),
+    );
+    if (!record) {
+      return undefined;
+    }
 
     let data: Uint8Array<ArrayBuffer>;
     if (record.data instanceof Blob) {
@@ -240,12 +428,18 @@ class SavedGames {
     } else {
       data = record.data;
     }
-    const error = await puzzle.loadGame(data);
-    if (error) {
-      return { found: true, error };
+    data = await decompressSave(data);
+    if (changes.length > 0) {
+      // The midend loads a complete save followed by its change records.
+      const parts = [data, ...changes.map((change) => change.data)];
+      data = new Uint8Array(parts.reduce((total, part) => total + part.length, 0));
+      let offset = 0;
+      for (const part of parts) {
+        data.set(part, offset);
+        offset += part.length;
+      }
     }
-    puzzle.checkpoints = record.checkpoints ?? [];
-    return { found: true, gameId: record.gameId };
+    return { record, data };
   }
 
   /**
@@ -264,7 +458,9 @@ class SavedGames {
     const timestamp = Date.now();
     const status = puzzle.status;
     const gameId = puzzle.currentGameId ?? "";
-    const data: Uint8Array<ArrayBuffer> = await puzzle.saveGame();
+    const data: Uint8Array<ArrayBuffer> = await compressSave(
+      await puzzle.saveGame(true),
+    );
     // (Earlier versions converted data to a Blob, which is both unnecessary
     // and not supported in IndexedDB by Safari private browsing mode.)
     const checkpoints = [...puzzle.checkpoints];
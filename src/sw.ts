@@ -5,6 +5,7 @@ import {
   cleanupOutdatedCaches,
   precacheAndRoute,
 } from "workbox-precaching";
+import { registerRoute } from "workbox-routing";
 
 declare let self: ServiceWorkerGlobalScope;
 
@@ -77,3 +78,34 @@ precacheAndRoute(manifest, {
   // All URL parameters are handled locally:
   ignoreURLParametersMatching: [/.*/],
 });
+
+// Packs of pregenerated games (see puzzle/puzzle-pack.ts) are too big to
+// precache for every puzzle, so each is cached when first fetched instead.
+// Their names include a content hash, so a cached pack is never stale, but
+// is replaced when a new version is fetched. (Names are "<puzzleId>-<hash>",
+// and puzzle ids have no hyphens, though hashes may.)
+const PACKS_CACHE = "puzzle-packs";
+
+const packName = (url: string) =>
+  new URL(url).pathname.replace(/^.*\/([^/-]*)-[^/]*\.pack$/, "$1");
+
+registerRoute(
+  ({ url }) => url.origin === self.location.origin && url.pathname.endsWith(".pack"),
+  async ({ request }) => {
+    const cache = await caches.open(PACKS_CACHE);
+    const cached = await cache.match(request);
+    if (cached) {
+      return cached;
+    }
+    const response = await fetch(request);
+    if (response.ok) {
+      for (const key of await cache.keys()) {
+        if (packName(key.url) === packName(request.url)) {
+          await cache.delete(key);
+        }
+      }
+      await cache.put(request, response.clone());
+    }
+    return response;
+  },
+);
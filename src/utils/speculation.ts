@@ -0,0 +1,29 @@
+// Speculative prerendering of pages the user looks likely to open next,
+// via the Speculation Rules API (where supported; elsewhere, a no-op).
+
+const supported =
+  typeof HTMLScriptElement !== "undefined" &&
+  HTMLScriptElement.supports?.("speculationrules") === true;
+
+const requested = new Set<string>();
+
+// (Browsers also cap the number of prerenders; the oldest are dropped.)
+const maxRequested = 8;
+
+/**
+ * Ask the browser to prerender url (same-origin) in the background,
+ * so that navigating to it is (nearly) instant.
+ */
+export function prerender(url: string | URL): void {
+  const href = new URL(url, window.location.href).href;
+  if (!supported || requested.has(href) || requested.size >= maxRequested) {
+    return;
+  }
+  requested.add(href);
+  const script = document.createElement("script");
+  script.type = "speculationrules";
+  script.textContent = JSON.stringify({
+    prerender: [{ source: "list", urls: [href], eagerness: "immediate" }],
+  });
+  document.head.append(script);
+}
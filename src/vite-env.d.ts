@@ -13,6 +13,8 @@ interface ImportMetaEnv {
   readonly VITE_GIT_SHA?: string;
   readonly VITE_SENTRY_DSN?: string;
   readonly VITE_SENTRY_FILTER_APPLICATION_ID?: string;
+  readonly VITE_WASM_SHARED_CORE?: string; // use puzzles-core.wasm + *.side.wasm
+  readonly VITE_WASM_THREADS?: string; // serve COOP/COEP and use *.threads.wasm
 }
 
 interface ImportMeta {
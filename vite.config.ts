@@ -75,6 +75,14 @@ function securityHeaders(options: {
     "frame-ancestors": "'none'",
   };
 
+  if (env.VITE_WASM_THREADS) {
+    // The wasm threads build needs SharedArrayBuffer, which requires
+    // cross-origin isolation. (Any cross-origin subresource, such as an
+    // analytics script, must then opt in with Cross-Origin-Resource-Policy.)
+    headers["Cross-Origin-Opener-Policy"] = "same-origin";
+    headers["Cross-Origin-Embedder-Policy"] = "require-corp";
+  }
+
   if (env.VITE_SENTRY_DSN) {
     const sentryDsnOrigin = new URL(env.VITE_SENTRY_DSN).origin;
     csp["connect-src"] += ` ${sentryDsnOrigin}`;
@@ -333,6 +341,8 @@ export default defineConfig(async ({ command, mode }) => {
         input: [
           // See also extraPages plugin below, which adds index, puzzle and help page inputs
           "unsupported.html",
+          // Hidden wasm benchmark page (not linked from anywhere)
+          "benchmark.html",
         ],
         output: {
           manualChunks: (id) => {
@@ -569,12 +579,22 @@ export default defineConfig(async ({ command, mode }) => {
         filename: "sw.ts",
         injectManifest: {
           // enableWorkboxModulesLogs: true, // see workbox logging in production
-          globIgnores: ["404.html", "**/unsupported*.{html,css,js}"],
+          globIgnores: [
+            "404.html",
+            "**/unsupported*.{html,css,js}",
+            "**/benchmark*.{html,css,js}",
+          ],
           globPatterns: [
             // Include all help files, icons, etc.
             // But include wasm's only for the intended puzzles (skip nullgame, etc.)
+            // and, for the shared core build, only the core and side modules.
             "**/*.{css,html,js,json,png,svg}",
-            `assets/@(${puzzleIds.join("|")})*.wasm`,
+            ...(env.VITE_WASM_SHARED_CORE
+              ? [
+                  "assets/puzzles-core-*.wasm",
+                  `assets/@(${puzzleIds.join("|")}).side-*.wasm`,
+                ]
+              : [`assets/@(${puzzleIds.join("|")})*.wasm`]),
           ],
         },
       }),
@@ -585,9 +605,10 @@ export default defineConfig(async ({ command, mode }) => {
         changefreq: "weekly",
         generateRobotsTxt: true,
         exclude: [
-          // Skip 404.html and unsupported.html
+          // Skip 404.html, unsupported.html and benchmark.html
           "/404",
           "/unsupported",
+          "/benchmark",
           // vite-plugin-sitemap clean urls bug: .../docindex.html becomes .../doc.
           // Strip it here, add it back in manually below:
           "/help/manual/doc",